@@ -0,0 +1,147 @@
+// 日志调用开销基准：每行同步写文件（最初实现：加锁→取大小→打开→写入→关闭） / 常驻句柄同步写 vs 异步环 + 写线程
+// 场景：threads 个线程并发写日志，每线程 lines 行，行内容与 Logger 的格式相近（约 120 字节）
+// 对比指标：调用方视角的单次调用延迟分位数（p50/p99/p99.9/max）、调用侧吞吐、实际落盘行数的端到端吞吐与丢弃数
+// 异步分两种：普通行（队列满即丢弃）与重要行（队列满时退让重试，最多 2ms 后才丢弃）
+// 用法：bench_async_log [threads=16] [lines=20000] [path=/tmp/bench_async_log.log]
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <mutex>
+#include <string>
+#include <sys/stat.h>
+#include <thread>
+#include <vector>
+
+#include "core/AsyncLog.hpp"
+
+using Clock = std::chrono::steady_clock;
+
+static std::string MakeLine(int t, int i) {
+    char buf[160];
+    snprintf(buf, sizeof(buf),
+             "[2026-01-11 12:00:00] [PID:1234][TID:%d] [调试] SOCKS5: 连接请求 example.com:443 seq=%d 状态=成功", t, i);
+    return std::string(buf);
+}
+
+// 最初实现：全局锁内取文件大小、打开、追加一行、关闭
+struct SyncReopenSink {
+    explicit SyncReopenSink(const char* p) : path(p) {}
+    const char* path;
+    std::mutex mtx;
+    void Log(std::string&& line, bool) {
+        std::lock_guard<std::mutex> lock(mtx);
+        struct stat st;
+        (void)stat(path, &st);
+        FILE* f = fopen(path, "a");
+        if (!f) return;
+        fwrite(line.data(), 1, line.size(), f);
+        fputc('\n', f);
+        fclose(f);
+    }
+    void Finish() {}
+    uint64_t Dropped() const { return 0; }
+};
+
+// 常驻句柄：仍在调用方线程加锁写入（每行 flush，保证与旧实现相同的落盘可见性）
+struct SyncKeepOpenSink {
+    explicit SyncKeepOpenSink(const char* p) { f = fopen(p, "a"); }
+    ~SyncKeepOpenSink() { if (f) fclose(f); }
+    FILE* f = nullptr;
+    std::mutex mtx;
+    void Log(std::string&& line, bool) {
+        std::lock_guard<std::mutex> lock(mtx);
+        if (!f) return;
+        fwrite(line.data(), 1, line.size(), f);
+        fputc('\n', f);
+        fflush(f);
+    }
+    void Finish() {}
+    uint64_t Dropped() const { return 0; }
+};
+
+// 异步：调用方只入队，写线程按批写出（与 Logger 相同的 AsyncLogWriter<4096>）
+struct AsyncSink {
+    explicit AsyncSink(const char* p)
+        : writer([this](const std::string& batch, uint64_t) {
+              if (!f) return;
+              fwrite(batch.data(), 1, batch.size(), f);
+              fflush(f);
+          }) {
+        f = fopen(p, "a");
+        writer.BeginAccepting();
+        thread = std::thread([this]() { writer.RunWriterLoop(); });
+    }
+    ~AsyncSink() {
+        Finish();
+        if (f) fclose(f);
+    }
+    FILE* f = nullptr;
+    Core::AsyncLogWriter<4096> writer;
+    std::thread thread;
+    void Log(std::string&& line, bool important) { writer.Submit(std::move(line), important); }
+    void Finish() {
+        if (!thread.joinable()) return;
+        writer.RequestStop();
+        thread.join();
+    }
+    uint64_t Dropped() const { return writer.Dropped(); }
+};
+
+template <typename Sink>
+static void Run(const char* name, int threads, int lines, const char* path, bool important) {
+    remove(path);
+    Sink sink(path);
+    std::vector<std::vector<uint32_t>> lat((size_t)threads);
+    std::atomic<int> ready{0};
+    std::atomic<bool> go{false};
+    std::vector<std::thread> workers;
+    for (int t = 0; t < threads; ++t) {
+        workers.emplace_back([&, t]() {
+            auto& mine = lat[(size_t)t];
+            mine.reserve((size_t)lines);
+            ready.fetch_add(1);
+            while (!go.load(std::memory_order_acquire)) std::this_thread::yield();
+            for (int i = 0; i < lines; ++i) {
+                std::string line = MakeLine(t, i);
+                const auto t0 = Clock::now();
+                sink.Log(std::move(line), important);
+                mine.push_back((uint32_t)std::min<int64_t>(
+                    std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - t0).count(), UINT32_MAX));
+            }
+        });
+    }
+    while (ready.load() < threads) std::this_thread::yield();
+    const auto start = Clock::now();
+    go.store(true, std::memory_order_release);
+    for (auto& w : workers) w.join();
+    const double callSec = std::chrono::duration<double>(Clock::now() - start).count();
+    sink.Finish();
+    const double totalSec = std::chrono::duration<double>(Clock::now() - start).count();
+
+    std::vector<uint32_t> all;
+    for (auto& v : lat) all.insert(all.end(), v.begin(), v.end());
+    std::sort(all.begin(), all.end());
+    auto pct = [&](double p) { return all[std::min(all.size() - 1, (size_t)(p * (double)all.size()))] / 1000.0; };
+    const double n = (double)all.size();
+    const double written = n - (double)sink.Dropped();
+    printf("  %-24s p50 %8.2f us  p99 %9.2f us  p99.9 %9.2f us  max %10.1f us  calls %9.0f/s  disk %9.0f/s  dropped=%llu\n",
+           name, pct(0.50), pct(0.99), pct(0.999), all.back() / 1000.0, n / callSec, written / totalSec,
+           (unsigned long long)sink.Dropped());
+}
+
+int main(int argc, char** argv) {
+    const int threads = argc > 1 ? atoi(argv[1]) : 16;
+    const int lines = argc > 2 ? atoi(argv[2]) : 20000;
+    const char* path = argc > 3 ? argv[3] : "/tmp/bench_async_log.log";
+    if (threads <= 0 || lines <= 0) return 1;
+    printf("threads=%d lines/thread=%d path=%s\n", threads, lines, path);
+    Run<SyncReopenSink>("sync reopen per line", threads, lines, path, false);
+    Run<SyncKeepOpenSink>("sync keep-open", threads, lines, path, false);
+    Run<AsyncSink>("async (drop when full)", threads, lines, path, false);
+    Run<AsyncSink>("async (important lines)", threads, lines, path, true);
+    remove(path);
+    return 0;
+}
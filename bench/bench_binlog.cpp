@@ -0,0 +1,169 @@
+// 结构化日志编码开销与体积基准：逐行拼接文本（最初实现） / 事件目录文本渲染 vs 二进制编码（事件 ID + 原始参数）
+// 场景：按 connect/ConnectEx/BYPASS/closesocket 等热路径调试事件的混合比例循环生成 events 条，主机名取自 hosts 个域名
+// 对比指标：调用方线程每事件耗时（ns）、每事件字节数；以及离线解码吞吐
+// 用法：bench_binlog [events=200000] [hosts=64]
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <ctime>
+#include <iomanip>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "core/BinLog.hpp"
+
+using namespace Core;
+using Clock = std::chrono::steady_clock;
+
+static volatile size_t g_sink = 0;
+
+struct Sample {
+    unsigned long long sock;
+    std::string host;
+    uint16_t port;
+    LogAddr addr;
+    unsigned long sendLen;
+    void* overlapped;
+};
+
+// 最初实现的时间戳：localtime + ostringstream + put_time
+static std::string LegacyTimestamp() {
+    auto now = std::time(nullptr);
+    struct tm tm {};
+    localtime_r(&now, &tm);
+    std::ostringstream oss;
+    oss << std::put_time(&tm, "%Y-%m-%d %H:%M:%S");
+    return oss.str();
+}
+
+static std::string LegacyAddr(const LogAddr& a) {
+    char buf[32];
+    snprintf(buf, sizeof(buf), "%u.%u.%u.%u", a.bytes[0], a.bytes[1], a.bytes[2], a.bytes[3]);
+    return std::string(buf) + ":" + std::to_string(a.port);
+}
+
+// 最初实现：调用方线程拼接完整文本行
+static std::string LegacyLine(int kind, const Sample& s) {
+    std::string prefix = "[" + LegacyTimestamp() + "] [PID:" + std::to_string(4321) + "][TID:" + std::to_string(8765) + "] [调试] ";
+    switch (kind) {
+        case 0:
+            return prefix + std::string("connect") + ": 调用, sock=" + std::to_string(s.sock) + ", dst=" + LegacyAddr(s.addr) +
+                   ", family=" + std::to_string(2) + ", namelen=" + std::to_string(16);
+        case 1:
+            return prefix + "ConnectEx: 调用, sock=" + std::to_string(s.sock) + ", dst=" + LegacyAddr(s.addr) +
+                   ", send_len=" + std::to_string(s.sendLen) +
+                   ", overlapped=" + std::to_string((unsigned long long)(uintptr_t)s.overlapped);
+        case 2:
+            return prefix + "BYPASS(proxy-self): sock=" + std::to_string(s.sock) + ", target=" + s.host + ":" +
+                   std::to_string(s.port) + ", proxy=" + std::string("127.0.0.1") + ":" + std::to_string(7890);
+        default:
+            return prefix + "closesocket: 完成, sock=" + std::to_string(s.sock);
+    }
+}
+
+template <typename Fn>
+static void ForEvent(int kind, const Sample& s, const std::string& proxyHost, Fn&& fn) {
+    switch (kind) {
+        case 0: {
+            const auto a = MakeLogArgs("connect", s.sock, s.addr, 2, 16);
+            fn(LogEvent::ConnectCall, a.data(), a.size());
+            break;
+        }
+        case 1: {
+            const auto a = MakeLogArgs(s.sock, s.addr, s.sendLen, s.overlapped);
+            fn(LogEvent::ConnectExCall, a.data(), a.size());
+            break;
+        }
+        case 2: {
+            const auto a = MakeLogArgs(s.sock, LogHost(s.host), s.port, LogHost(proxyHost), 7890);
+            fn(LogEvent::BypassProxySelf, a.data(), a.size());
+            break;
+        }
+        default: {
+            const auto a = MakeLogArgs(s.sock);
+            fn(LogEvent::CloseSocketDone, a.data(), a.size());
+            break;
+        }
+    }
+}
+
+int main(int argc, char** argv) {
+    const int events = argc > 1 ? atoi(argv[1]) : 200000;
+    const int hosts = argc > 2 ? atoi(argv[2]) : 64;
+    if (events <= 0 || hosts <= 0) return 1;
+
+    std::vector<Sample> samples((size_t)hosts);
+    int dummy = 0;
+    for (int i = 0; i < hosts; ++i) {
+        Sample& s = samples[(size_t)i];
+        s.sock = 1000 + (unsigned long long)i * 4;
+        s.host = "svc" + std::to_string(i) + ".api.example.com";
+        s.port = 443;
+        s.addr.family = 4;
+        s.addr.port = 443;
+        s.addr.bytes[0] = 198;
+        s.addr.bytes[1] = 18;
+        s.addr.bytes[2] = (uint8_t)(i >> 8);
+        s.addr.bytes[3] = (uint8_t)i;
+        s.sendLen = 0;
+        s.overlapped = &dummy;
+    }
+    const std::string proxyHost = "127.0.0.1";
+    printf("events=%d hosts=%d\n", events, hosts);
+
+    // 1) 逐行拼接文本
+    size_t legacyBytes = 0;
+    auto t0 = Clock::now();
+    for (int i = 0; i < events; ++i) {
+        const std::string line = LegacyLine(i & 3, samples[(size_t)i % samples.size()]);
+        legacyBytes += line.size() + 1;
+    }
+    const double legacyNs = std::chrono::duration<double, std::nano>(Clock::now() - t0).count() / events;
+
+    // 2) 事件目录文本渲染（文本模式：snprintf 时间戳 + 占位符替换）
+    size_t textBytes = 0;
+    t0 = Clock::now();
+    for (int i = 0; i < events; ++i) {
+        ForEvent(i & 3, samples[(size_t)i % samples.size()], proxyHost, [&](LogEvent ev, const LogArg* a, size_t n) {
+            std::string line = "[" + BinLog::FormatTimestamp(1700000000000000ull) + "] [PID:4321][TID:8765] [调试] ";
+            FormatLogEvent(line, GetLogEventInfo(ev).format, a, n);
+            textBytes += line.size() + 1;
+        });
+    }
+    const double textNs = std::chrono::duration<double, std::nano>(Clock::now() - t0).count() / events;
+
+    // 3) 二进制编码（每条独立 std::string，与入队时相同）
+    StringInterner interner;
+    std::string file;
+    BinLog::AppendSessionHeader(file, &interner);
+    const size_t headerBytes = file.size();
+    t0 = Clock::now();
+    for (int i = 0; i < events; ++i) {
+        ForEvent(i & 3, samples[(size_t)i % samples.size()], proxyHost, [&](LogEvent ev, const LogArg* a, size_t n) {
+            std::string record;
+            record.reserve(96);
+            BinLog::AppendEventRecord(record, &interner, ev, LogLevel::Debug, 1700000000000000ull + (uint64_t)i, 4321, 8765, a, n);
+            file += record;
+        });
+    }
+    const double binNs = std::chrono::duration<double, std::nano>(Clock::now() - t0).count() / events;
+
+    // 4) 离线解码
+    size_t decodedBytes = 0;
+    BinLog::Reader reader;
+    t0 = Clock::now();
+    const auto st = reader.Decode((const uint8_t*)file.data(), file.size(),
+                                  [&](const std::string& line, const BinLog::DecodedEvent&) { decodedBytes += line.size() + 1; });
+    const double decodeSec = std::chrono::duration<double>(Clock::now() - t0).count();
+    g_sink = g_sink + decodedBytes;
+
+    printf("  %-28s %10.1f ns/event %8.1f B/event\n", "legacy concat", legacyNs, (double)legacyBytes / events);
+    printf("  %-28s %10.1f ns/event %8.1f B/event\n", "catalog text render", textNs, (double)textBytes / events);
+    printf("  %-28s %10.1f ns/event %8.1f B/event  (header %zu B, %zu strings)\n", "binary encode", binNs,
+           (double)(file.size() - headerBytes) / events, headerBytes, interner.Size());
+    printf("  size ratio text/binary: %.2fx   decode: %.0f events/s (%zu events)\n",
+           (double)legacyBytes / (double)file.size(), (double)st.events / decodeSec, st.events);
+    return 0;
+}
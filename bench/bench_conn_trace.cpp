@@ -0,0 +1,85 @@
+// 连接阶段追踪开销基准：send/recv 热路径上的 OnSend/OnRecv（未追踪 socket、已追踪但首包已过），
+// 以及一个连接完整生命周期（Begin + 各阶段 Mark + 首次收发 + 结束入直方图）的耗时
+// 对比指标：每次调用耗时（ns）；4 线程并发生命周期的吞吐（连接/秒）
+// 用法：bench_conn_trace [ops=5000000] [connections=500000]
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include "core/ConnTrace.hpp"
+
+using Core::ConnTrace;
+using Core::TraceStage;
+using Clock = std::chrono::steady_clock;
+
+static double NsPerOp(Clock::time_point start, uint64_t ops) {
+    return std::chrono::duration<double, std::nano>(Clock::now() - start).count() / (double)ops;
+}
+
+static void Lifecycle(ConnTrace& t, uint64_t s, uint64_t base) {
+    t.Begin(s, "bench.example.com", 443, base);
+    t.Mark(s, TraceStage::ProxyConnected, base + 10);
+    t.Mark(s, TraceStage::GreetingDone, base + 20);
+    t.Mark(s, TraceStage::TunnelReady, base + 30);
+    t.OnSend(s, base + 40);
+    t.OnRecv(s, base + 50);
+    t.Finish(s, false);
+}
+
+int main(int argc, char** argv) {
+    const uint64_t ops = argc > 1 ? strtoull(argv[1], nullptr, 10) : 5000000;
+    const uint64_t conns = argc > 2 ? strtoull(argv[2], nullptr, 10) : 500000;
+    if (ops == 0 || conns == 0) return 1;
+    printf("ops=%llu connections=%llu\n", (unsigned long long)ops, (unsigned long long)conns);
+
+    std::unique_ptr<ConnTrace> trace(new ConnTrace());
+    trace->Configure(true, 100);
+
+    // 1) 热路径：未追踪的 socket（直连、UDP、已结束的连接）
+    auto start = Clock::now();
+    for (uint64_t i = 0; i < ops; ++i) trace->OnSend(1000 + (i & 1023));
+    printf("OnSend 未追踪:        %6.2f ns/次\n", NsPerOp(start, ops));
+
+    // 2) 热路径：已追踪、隧道未就绪（握手期间的收发）
+    trace->Begin(7, "bench.example.com", 443, 1);
+    start = Clock::now();
+    for (uint64_t i = 0; i < ops; ++i) trace->OnRecv(7);
+    printf("OnRecv 握手期间:      %6.2f ns/次\n", NsPerOp(start, ops));
+
+    // 3) 热路径：首次发送已记录后的后续发送
+    trace->Mark(7, TraceStage::TunnelReady, 2);
+    trace->OnSend(7, 3);
+    start = Clock::now();
+    for (uint64_t i = 0; i < ops; ++i) trace->OnSend(7);
+    printf("OnSend 首包之后:      %6.2f ns/次\n", NsPerOp(start, ops));
+    trace->Finish(7, false);
+
+    // 4) 完整生命周期（单线程），含 1/100 采样入环
+    start = Clock::now();
+    for (uint64_t i = 0; i < conns; ++i) Lifecycle(*trace, 100000 + i, i * 100 + 1);
+    printf("生命周期 单线程:      %6.1f ns/连接\n", NsPerOp(start, conns));
+
+    // 5) 4 线程并发生命周期
+    const int kThreads = 4;
+    start = Clock::now();
+    std::vector<std::thread> threads;
+    for (int th = 0; th < kThreads; ++th) {
+        threads.emplace_back([&, th]() {
+            for (uint64_t i = 0; i < conns / kThreads; ++i) Lifecycle(*trace, (uint64_t)(th + 1) * 10000000 + i, i * 100 + 1);
+        });
+    }
+    for (auto& t : threads) t.join();
+    const double secs = std::chrono::duration<double>(Clock::now() - start).count();
+    printf("生命周期 %d 线程:      %.0f 连接/秒\n", kThreads, (double)(conns / kThreads * kThreads) / secs);
+
+    const auto stats = trace->GetStats();
+    const auto total = trace->ReadSpan(Core::TraceSpan::Total);
+    printf("追踪=%llu 首字节=%llu 未追踪=%llu 采样=%llu total.p99=%lluus\n", (unsigned long long)stats.begun,
+           (unsigned long long)stats.completed, (unsigned long long)stats.dropped, (unsigned long long)stats.sampled,
+           (unsigned long long)total.Percentile(0.99));
+    return 0;
+}
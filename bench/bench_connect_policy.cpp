@@ -0,0 +1,133 @@
+// connect 决策前导开销基准：配置字符串比较 + 白名单二分查找（旧实现） vs 编译后的运行时策略
+// 覆盖 PerformProxyConnect 在真正建立隧道之前的判定：socket 类型 / 地址族 / UDP / IPv6 / DNS / 端口白名单，
+// 以及 CreateProcess Hook 的子进程注入判定（旧实现每次调用对列表逐项 ToLower）
+// 用法：bench_connect_policy [calls=5000000]
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+#include "core/RuntimePolicy.hpp"
+
+// 旧实现使用的字符串配置
+struct LegacyConfig {
+    uint16_t proxyPort = 7890;
+    std::string dnsMode = "direct";
+    std::string ipv6Mode = "proxy";
+    std::string udpMode = "block";
+    std::vector<uint16_t> allowedPorts{80, 443, 8080, 8443};
+    std::string childInjectionMode = "filtered";
+    std::vector<std::string> childInjectionExclude{"CrashPad_Handler", "WerFault"};
+    std::vector<std::string> targetProcesses{"Antigravity.exe", "Language_Server_Windows", "Code.exe", "node.exe"};
+};
+
+static std::string ToLowerCopy(std::string s) {
+    std::transform(s.begin(), s.end(), s.begin(), [](unsigned char c) { return (char)std::tolower(c); });
+    return s;
+}
+
+// 返回值：0=继续走代理，其它=提前分流（直连/阻止）
+static int LegacyDecide(const LegacyConfig& c, const Core::ConnectFacts& f) {
+    if (c.proxyPort != 0 && f.socket != Core::SocketKind::Stream) {
+        if (f.socket == Core::SocketKind::Datagram) {
+            if (c.udpMode == "block") return (f.loopback || f.port == 53) ? 1 : 2;
+            if (c.udpMode == "proxy") return 3;
+            return 1;
+        }
+        return 1;
+    }
+    if (f.addr == Core::AddrKind::IPv6) {
+        if (c.proxyPort != 0) {
+            const std::string& ipv6Mode = c.ipv6Mode;
+            if (ipv6Mode == "direct") return 1;
+            if (ipv6Mode != "proxy") return 2;
+        } else {
+            return 1;
+        }
+    } else if (f.addr == Core::AddrKind::Other) {
+        return c.proxyPort != 0 ? 2 : 1;
+    }
+    if (f.port == 53 && (c.dnsMode == "direct" || c.dnsMode.empty())) return 1;
+    if (!c.allowedPorts.empty() && !std::binary_search(c.allowedPorts.begin(), c.allowedPorts.end(), f.port)) return 1;
+    return 0;
+}
+
+static int CompiledDecide(const Core::RuntimePolicy& p, const Core::ConnectFacts& f) {
+    switch (Core::DecideConnectPrologue(p, f)) {
+        case Core::ConnectPrologue::Continue: break;
+        case Core::ConnectPrologue::UdpProxy: return 3;
+        case Core::ConnectPrologue::UdpBlocked:
+        case Core::ConnectPrologue::Ipv6Blocked:
+        case Core::ConnectPrologue::FamilyBlocked: return 2;
+        default: return 1;
+    }
+    return Core::DecideConnectPort(p, f.port) == Core::PortDecision::Proxy ? 0 : 1;
+}
+
+static bool LegacyShouldInjectChild(const LegacyConfig& c, const std::string& name) {
+    const std::string lowerName = ToLowerCopy(name);
+    for (const auto& item : c.childInjectionExclude) {
+        const std::string lowerItem = ToLowerCopy(item);
+        if (!lowerItem.empty() && lowerName.find(lowerItem) != std::string::npos) return false;
+    }
+    if (ToLowerCopy(c.childInjectionMode) == "inherit") return true;
+    if (c.targetProcesses.empty()) return true;
+    for (const auto& target : c.targetProcesses) {
+        if (lowerName.find(ToLowerCopy(target)) != std::string::npos) return true;
+    }
+    return false;
+}
+
+template <typename Fn>
+static double NsPerCall(int calls, Fn fn) {
+    const auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < calls; ++i) fn(i);
+    return std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / calls;
+}
+
+int main(int argc, char** argv) {
+    const int calls = argc > 1 ? atoi(argv[1]) : 5000000;
+    LegacyConfig legacy;
+    Core::RuntimePolicy policy;
+    policy.allowedPorts.Assign(legacy.allowedPorts);
+    policy.targetProcesses.Assign(legacy.targetProcesses);
+    policy.childInjectionExclude.Assign(legacy.childInjectionExclude);
+
+    // 典型混合：多数为 IPv4 TCP，少量 IPv6 / UDP(QUIC) / DNS / 非白名单端口
+    std::vector<Core::ConnectFacts> mix;
+    const uint16_t ports[] = {443, 443, 80, 443, 8443, 53, 22, 443};
+    for (int i = 0; i < 64; ++i) {
+        Core::ConnectFacts f;
+        f.port = ports[i % 8];
+        if (i % 16 == 3) f.addr = Core::AddrKind::IPv6;
+        if (i % 16 == 7) f.socket = Core::SocketKind::Datagram;
+        if (i % 32 == 11) f.addr = Core::AddrKind::IPv4MappedIPv6;
+        mix.push_back(f);
+    }
+    for (const auto& f : mix) {
+        if (LegacyDecide(legacy, f) != CompiledDecide(policy, f)) {
+            printf("决策不一致: port=%u\n", (unsigned)f.port);
+            return 1;
+        }
+    }
+
+    volatile int sink = 0;
+    printf("calls=%d\n", calls);
+    const double a = NsPerCall(calls, [&](int i) { sink += LegacyDecide(legacy, mix[(size_t)i & 63]); });
+    const double b = NsPerCall(calls, [&](int i) { sink += CompiledDecide(policy, mix[(size_t)i & 63]); });
+    printf("  %-40s %8.2f ns/call\n", "connect prologue: string config", a);
+    printf("  %-40s %8.2f ns/call\n", "connect prologue: compiled policy", b);
+
+    const std::vector<std::string> names{"node.exe", "crashpad_handler.exe", "Antigravity.exe", "chrome.exe",
+                                         "language_server_windows_x64.exe", "git.exe"};
+    const int childCalls = calls / 10 > 0 ? calls / 10 : 1;
+    const double c = NsPerCall(childCalls, [&](int i) { sink += LegacyShouldInjectChild(legacy, names[(size_t)i % names.size()]) ? 1 : 0; });
+    const double d = NsPerCall(childCalls, [&](int i) { sink += policy.ShouldInjectChildProcess(names[(size_t)i % names.size()]) ? 1 : 0; });
+    printf("  %-40s %8.2f ns/call\n", "child injection: lower per call", c);
+    printf("  %-40s %8.2f ns/call\n", "child injection: pre-lowered lists", d);
+    return sink == -1 ? 1 : 0;
+}
@@ -0,0 +1,144 @@
+// ConnectEx 未完成上下文过期清理基准：每次登记全表扫描（最初实现） / 每秒最多扫描一次（限频扫描） vs 时间轮 + 代数句柄 slab
+// 场景：维持 outstanding 个未完成 ConnectEx，每次操作先完成最早的一个、再登记一个新的；
+//       模拟时钟每次操作前进 step_ms，使一部分上下文在完成前超过 TTL 被清理
+// 对比指标：每次操作的平均耗时与最大耗时（限频扫描的抖动体现在最大耗时）
+// 用法：bench_connectex_expiry [outstanding=10000] [ops=50000] [step_ms=10]
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "network/ExpiringSlab.hpp"
+
+static const uint64_t kTtlMs = 60000;
+
+struct Ctx {
+    uintptr_t sock = 0;
+    std::string host;
+    uint16_t port = 0;
+    uintptr_t ovl = 0;
+};
+
+// 旧实现：全局锁 + map，登记时扫描全表（scanIntervalMs=0 即每次都扫描）
+struct ScanState {
+    explicit ScanState(uint64_t interval) : scanIntervalMs(interval) {}
+    struct Entry {
+        Ctx ctx;
+        uint64_t createdTick = 0;
+    };
+    std::mutex mtx;
+    std::unordered_map<uintptr_t, Entry> pending;
+    uint64_t scanIntervalMs;
+    uint64_t lastScan = 0;
+    size_t expired = 0;
+
+    void Save(uintptr_t ovl, Ctx ctx, uint64_t now) {
+        std::lock_guard<std::mutex> lock(mtx);
+        if (now - lastScan >= scanIntervalMs) {
+            lastScan = now;
+            for (auto it = pending.begin(); it != pending.end();) {
+                if (now - it->second.createdTick > kTtlMs) {
+                    it = pending.erase(it);
+                    ++expired;
+                } else {
+                    ++it;
+                }
+            }
+        }
+        pending[ovl] = Entry{std::move(ctx), now};
+    }
+
+    bool Pop(uintptr_t ovl, Ctx* out) {
+        std::lock_guard<std::mutex> lock(mtx);
+        auto it = pending.find(ovl);
+        if (it == pending.end()) return false;
+        *out = std::move(it->second.ctx);
+        pending.erase(it);
+        return true;
+    }
+};
+
+// 新实现：overlapped -> 句柄索引 + 时间轮 slab（与 Hooks.cpp 的 g_overlapped + g_connectExPending 对应）
+struct WheelState {
+    std::mutex mtx;
+    std::unordered_map<uintptr_t, uint64_t> index;
+    Network::ExpiringSlab<Ctx> slab;
+    size_t expired = 0;
+
+    void Save(uintptr_t ovl, Ctx ctx, uint64_t now) {
+        slab.Expire(now, [this](uint64_t h, Ctx&& c) {
+            std::lock_guard<std::mutex> lock(mtx);
+            auto it = index.find(c.ovl);
+            if (it != index.end() && it->second == h) index.erase(it);
+            ++expired;
+        });
+        ctx.ovl = ovl;
+        const uint64_t h = slab.Insert(std::move(ctx), now, kTtlMs);
+        std::lock_guard<std::mutex> lock(mtx);
+        index[ovl] = h;
+    }
+
+    bool Pop(uintptr_t ovl, Ctx* out) {
+        uint64_t h = 0;
+        {
+            std::lock_guard<std::mutex> lock(mtx);
+            auto it = index.find(ovl);
+            if (it == index.end()) return false;
+            h = it->second;
+            index.erase(it);
+        }
+        return slab.Take(h, out);
+    }
+};
+
+template <typename State>
+static void Run(const char* name, State& state, int outstanding, int ops, uint64_t stepMs) {
+    uint64_t now = 1000000;
+    std::vector<uintptr_t> ring((size_t)outstanding);
+    for (int i = 0; i < outstanding; ++i) {
+        ring[(size_t)i] = (uintptr_t)(i + 1) * 64;
+        state.Save(ring[(size_t)i], Ctx{(uintptr_t)i * 4, "example.com", 443, 0}, now);
+    }
+    size_t completed = 0;
+    double maxNs = 0;
+    const auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < ops; ++i) {
+        now += stepMs;
+        const auto t0 = std::chrono::steady_clock::now();
+        const size_t slot = (size_t)i % ring.size();
+        Ctx ctx;
+        if (state.Pop(ring[slot], &ctx)) ++completed;
+        state.Save(ring[slot], Ctx{(uintptr_t)i * 4, "example.com", 443, 0}, now);
+        const double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - t0).count();
+        if (ns > maxNs) maxNs = ns;
+    }
+    const double total = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+    printf("  %-28s %12.1f ns/op %14.1f us max   completed=%zu expired=%zu\n",
+           name, total / ops, maxNs / 1000.0, completed, state.expired);
+}
+
+int main(int argc, char** argv) {
+    const int outstanding = argc > 1 ? atoi(argv[1]) : 10000;
+    const int ops = argc > 2 ? atoi(argv[2]) : 50000;
+    const uint64_t stepMs = argc > 3 ? (uint64_t)atoll(argv[3]) : 10;
+    if (outstanding <= 0 || ops <= 0) return 1;
+    printf("outstanding=%d ops=%d step_ms=%llu ttl_ms=%llu\n", outstanding, ops,
+           (unsigned long long)stepMs, (unsigned long long)kTtlMs);
+    {
+        ScanState state(0);
+        Run("full scan per save", state, outstanding, ops, stepMs);
+    }
+    {
+        ScanState state(1000);
+        Run("scan at most once per sec", state, outstanding, ops, stepMs);
+    }
+    {
+        WheelState state;
+        Run("timer wheel + slab", state, outstanding, ops, stepMs);
+    }
+    return 0;
+}
@@ -0,0 +1,136 @@
+// 飞行记录器开销基准：每事件写入内存环（常开） vs 调试级文本渲染（打开 Debug 时调用方线程的开销，不含磁盘 I/O）
+// 场景：按 connect/路由决策/SOCKS5 步骤/closesocket 的混合比例循环生成 events 条；threads 个线程同时写入各自的环
+// 对比指标：每事件耗时（ns；多线程为墙钟时间 / 总事件数，CPU 少于线程数时不代表单次调用的开销）；以及一次转储（收集 + 渲染 dump 条）的耗时
+// 用法：bench_flight_recorder [events=2000000] [threads=4] [dump=200]
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "core/FlightRecorder.hpp"
+
+using namespace Core;
+using Clock = std::chrono::steady_clock;
+
+static volatile size_t g_sink = 0;
+static std::atomic<uint32_t> g_nextTid{1};
+
+static uint64_t NowUs() {
+    return (uint64_t)std::chrono::duration_cast<std::chrono::microseconds>(
+               std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+static uint32_t ThreadId() {
+    thread_local uint32_t t_tid = g_nextTid.fetch_add(1);
+    return t_tid;
+}
+
+struct Sample {
+    unsigned long long sock;
+    std::string host;
+    LogAddr addr;
+};
+
+template <typename Fn>
+static void ForEvent(int kind, const Sample& s, Fn&& fn) {
+    switch (kind) {
+        case 0: {
+            const auto a = MakeLogArgs("connect", s.sock, s.addr, 2, 16);
+            fn(LogEvent::ConnectCall, a.data(), a.size());
+            break;
+        }
+        case 1: {
+            const auto a = MakeLogArgs(s.sock, LogHost(s.host), (uint16_t)443, "proxy", "(default)");
+            fn(LogEvent::RouteMatch, a.data(), a.size());
+            break;
+        }
+        case 2: {
+            const auto a = MakeLogArgs("[2/3] 发送 CONNECT 请求", s.sock);
+            fn(LogEvent::Socks5Step, a.data(), a.size());
+            break;
+        }
+        default: {
+            const auto a = MakeLogArgs(s.sock);
+            fn(LogEvent::CloseSocketDone, a.data(), a.size());
+            break;
+        }
+    }
+}
+
+template <typename Body>
+static double RunThreads(int threads, int events, Body&& body) {
+    std::vector<std::thread> workers;
+    const auto t0 = Clock::now();
+    for (int t = 0; t < threads; ++t) {
+        workers.emplace_back([&, t]() { body(t, events / threads); });
+    }
+    for (auto& w : workers) w.join();
+    return std::chrono::duration<double, std::nano>(Clock::now() - t0).count();
+}
+
+int main(int argc, char** argv) {
+    const int events = argc > 1 ? atoi(argv[1]) : 2000000;
+    const int threads = argc > 2 ? atoi(argv[2]) : 4;
+    const int dump = argc > 3 ? atoi(argv[3]) : 200;
+    if (events <= 0 || threads <= 0 || dump <= 0) return 1;
+
+    std::vector<Sample> samples(64);
+    for (size_t i = 0; i < samples.size(); ++i) {
+        Sample& s = samples[i];
+        s.sock = 1000 + (unsigned long long)i * 4;
+        s.host = "svc" + std::to_string(i) + ".api.example.com";
+        s.addr.family = 4;
+        s.addr.port = 443;
+        s.addr.bytes[0] = 198;
+        s.addr.bytes[1] = 18;
+        s.addr.bytes[3] = (uint8_t)i;
+    }
+    printf("events=%d threads=%d dump=%d\n", events, threads, dump);
+
+    FlightRecorder recorder(&NowUs, &ThreadId);
+
+    // 1) 飞行记录器：单线程 / 多线程（每线程各自的环，无共享写入）
+    const double single = RunThreads(1, events, [&](int, int n) {
+        for (int i = 0; i < n; ++i) {
+            ForEvent(i & 3, samples[(size_t)i % samples.size()],
+                     [&](LogEvent ev, const LogArg* a, size_t c) { recorder.Record(ev, a, c); });
+        }
+    }) / events;
+    const double multi = RunThreads(threads, events, [&](int, int n) {
+        for (int i = 0; i < n; ++i) {
+            ForEvent(i & 3, samples[(size_t)i % samples.size()],
+                     [&](LogEvent ev, const LogArg* a, size_t c) { recorder.Record(ev, a, c); });
+        }
+    }) / events;
+
+    // 2) 调试级文本渲染（时间戳 + 占位符替换；真实 Debug 日志还要加上入队与写盘）
+    const double text = RunThreads(1, events, [&](int, int n) {
+        size_t bytes = 0;
+        for (int i = 0; i < n; ++i) {
+            ForEvent(i & 3, samples[(size_t)i % samples.size()], [&](LogEvent ev, const LogArg* a, size_t c) {
+                std::string line = "[" + BinLog::FormatTimestamp(1700000000000000ull) + "] [PID:4321][TID:8765] [调试] ";
+                FormatLogEvent(line, GetLogEventInfo(ev).format, a, c);
+                bytes += line.size();
+            });
+        }
+        g_sink = g_sink + bytes;
+    }) / events;
+
+    // 3) 转储：收集全部线程的环并渲染最近 dump 条
+    const auto t0 = Clock::now();
+    const auto entries = recorder.Collect(0, (size_t)dump);
+    std::string out;
+    FlightRecorder::AppendEntries(out, entries, "    ");
+    const double dumpUs = std::chrono::duration<double, std::micro>(Clock::now() - t0).count();
+    g_sink = g_sink + out.size();
+
+    printf("  %-28s %10.1f ns/event\n", "flight record (1 thread)", single);
+    printf("  %-28s %10.1f ns/event  (%d threads)\n", "flight record (N threads)", multi, threads);
+    printf("  %-28s %10.1f ns/event\n", "debug text render", text);
+    printf("  %-28s %10.1f us  (%zu events, %zu B)\n", "dump collect+render", dumpUs, entries.size(), out.size());
+    return 0;
+}
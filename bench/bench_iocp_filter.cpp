@@ -0,0 +1,149 @@
+// IOCP 批量出队附加开销基准：GetQueuedCompletionStatusEx Hook 对每个出队条目查询 ConnectEx / UDP 登记
+// 对比：全局锁 + 两张 map（最初实现） / 分片表两次探测 / 无锁预过滤 + 分片表
+// 场景：每批 64 个条目，其中 tracked_per_batch 个为已登记的代理 OVERLAPPED（出队后重新登记，模拟持续的代理流量）
+// 对比指标：每个出队条目附加的纳秒数（已扣除空循环基线），以及多线程并发出队下的表现
+// 用法：bench_iocp_filter [batches=200000] [tracked_per_batch=1] [max_threads=8]
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "network/PointerFilter.hpp"
+#include "network/SocketContextTable.hpp"
+
+static const int kBatch = 64;
+static volatile uint64_t g_sink = 0;
+
+struct Entry {
+    uint8_t kind = 0; // 1=ConnectEx 2=UDP
+    uintptr_t sock = 0;
+};
+
+// 最初实现：ConnectEx 与 UDP 各一把全局锁 + 一张 map
+struct LegacyState {
+    std::mutex connectExMtx;
+    std::unordered_map<const void*, Entry> connectEx;
+    std::mutex udpMtx;
+    std::unordered_map<const void*, Entry> udp;
+
+    void Track(const void* ovl) {
+        std::lock_guard<std::mutex> lock(udpMtx);
+        udp[ovl] = Entry{2, 4};
+    }
+
+    bool OnDequeue(const void* ovl) {
+        {
+            std::lock_guard<std::mutex> lock(connectExMtx);
+            if (connectEx.erase(ovl)) return true;
+        }
+        std::lock_guard<std::mutex> lock(udpMtx);
+        return udp.erase(ovl) != 0;
+    }
+};
+
+// 分片表：每个条目两次 EraseWhere（各自加分片写锁并探测）
+struct ShardedState {
+    Network::ShardedTable<const void*, Entry> table;
+
+    void Track(const void* ovl) { table.InsertOrAssign(ovl, Entry{2, 4}); }
+
+    bool OnDequeue(const void* ovl) {
+        Entry e;
+        if (table.EraseWhere(ovl, [](const Entry& x) { return x.kind == 1; }, &e)) return true;
+        return table.EraseWhere(ovl, [](const Entry& x) { return x.kind == 2; }, &e);
+    }
+};
+
+// 预过滤 + 分片表：未登记条目只需一次原子读取
+struct FilteredState {
+    Network::ShardedTable<const void*, Entry> table;
+    Network::PointerFilter<> filter;
+
+    void Track(const void* ovl) {
+        filter.Add(ovl);
+        bool replaced = false;
+        table.InsertIfAbsent(ovl, Entry{2, 4}, [&](Entry& existing) {
+            existing = Entry{2, 4};
+            replaced = true;
+        });
+        if (replaced) filter.Remove(ovl);
+    }
+
+    bool OnDequeue(const void* ovl) {
+        if (!filter.MayContain(ovl)) return false;
+        Entry e;
+        if (table.EraseWhere(ovl, [](const Entry& x) { return x.kind == 1; }, &e) ||
+            table.EraseWhere(ovl, [](const Entry& x) { return x.kind == 2; }, &e)) {
+            filter.Remove(ovl);
+            return true;
+        }
+        return false;
+    }
+};
+
+struct BaselineState {
+    void Track(const void*) {}
+    bool OnDequeue(const void*) { return false; }
+};
+
+// 返回每个出队条目的平均耗时（ns）
+template <typename State>
+static double Run(int threads, int batches, int trackedPerBatch) {
+    State state;
+    std::atomic<int> ready{0};
+    std::atomic<bool> go{false};
+    std::atomic<uint64_t> hits{0};
+    std::vector<std::thread> workers;
+    for (int t = 0; t < threads; ++t) {
+        workers.emplace_back([&]() {
+            // 每线程：一批普通 OVERLAPPED（应用自身读写）+ 若干代理登记的 OVERLAPPED
+            std::vector<uint64_t> plain(kBatch * 4);
+            std::vector<uint64_t> tracked((size_t)(trackedPerBatch > 0 ? trackedPerBatch : 1) * 4);
+            for (int i = 0; i < trackedPerBatch; ++i) state.Track(&tracked[(size_t)i * 4]);
+            ready.fetch_add(1);
+            while (!go.load(std::memory_order_acquire)) std::this_thread::yield();
+            uint64_t localHits = 0;
+            for (int b = 0; b < batches; ++b) {
+                for (int i = 0; i < kBatch; ++i) {
+                    const void* ovl = i < trackedPerBatch ? (const void*)&tracked[(size_t)i * 4]
+                                                          : (const void*)&plain[(size_t)i * 4];
+                    if (state.OnDequeue(ovl)) {
+                        ++localHits;
+                        state.Track(ovl); // 代理流量持续：出队后立即投递下一次操作
+                    }
+                }
+            }
+            hits.fetch_add(localHits);
+        });
+    }
+    while (ready.load() < threads) std::this_thread::yield();
+    const auto start = std::chrono::steady_clock::now();
+    go.store(true, std::memory_order_release);
+    for (auto& w : workers) w.join();
+    const double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+    g_sink = g_sink + hits.load();
+    // 线程并行执行：按单线程视角折算为每个条目的墙钟耗时
+    return ns / ((double)batches * kBatch);
+}
+
+int main(int argc, char** argv) {
+    const int batches = argc > 1 ? atoi(argv[1]) : 200000;
+    const int trackedPerBatch = argc > 2 ? atoi(argv[2]) : 1;
+    const int maxThreads = argc > 3 ? atoi(argv[3]) : 8;
+    if (batches <= 0 || trackedPerBatch < 0 || trackedPerBatch > kBatch) return 1;
+    printf("batch=%d batches=%d tracked_per_batch=%d\n", kBatch, batches, trackedPerBatch);
+    printf("  %-8s %18s %18s %18s  (附加 ns/条目)\n", "threads", "global mutex", "sharded x2", "filter+sharded");
+    for (int threads = 1; threads <= maxThreads; threads *= 2) {
+        const double base = Run<BaselineState>(threads, batches, trackedPerBatch);
+        const double legacy = Run<LegacyState>(threads, batches, trackedPerBatch) - base;
+        const double sharded = Run<ShardedState>(threads, batches, trackedPerBatch) - base;
+        const double filtered = Run<FilteredState>(threads, batches, trackedPerBatch) - base;
+        printf("  %-8d %18.2f %18.2f %18.2f\n", threads, legacy, sharded, filtered);
+    }
+    return 0;
+}
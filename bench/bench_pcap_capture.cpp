@@ -0,0 +1,102 @@
+// 抓包开销基准：收发路径入环（记录头 + snaplen 字节 memcpy）vs 在调用线程直接编码 pcapng 报文
+// 场景：每次收发 1400 字节，snaplen=256；编码只生成 pcapng 字节，不写盘
+// 对比指标：每次收发在调用线程上的耗时（ns），以及编码吞吐（记录/秒）
+// 用法：bench_pcap_capture [ops=2000000] [snaplen=256]
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+#include "network/Pcapng.hpp"
+
+using namespace Network;
+using Clock = std::chrono::steady_clock;
+
+static volatile size_t g_sink = 0;
+
+static void OpenFlow(PcapngWriter& writer, std::string* out) {
+    CaptureFlowInfo info;
+    info.local.family = 4;
+    info.local.addr[0] = 10;
+    info.local.addr[3] = 1;
+    info.local.port = 50000;
+    info.remote.port = 443;
+    info.host = "bench.example.com";
+    uint8_t buf[kCaptureFlowInfoMaxBytes];
+    CaptureRecord rec;
+    rec.type = CaptureRecordType::FlowOpen;
+    rec.flow = 1;
+    rec.capLen = (uint32_t)SerializeCaptureFlowInfo(info, buf);
+    writer.Append(rec, buf, out);
+}
+
+static CaptureRecord DataRecord(int i, uint32_t bytes, uint32_t snap) {
+    CaptureRecord rec;
+    rec.flow = 1;
+    rec.dir = (i & 1) ? CaptureDirection::Recv : CaptureDirection::Send;
+    rec.tsUs = (uint64_t)i;
+    rec.origLen = bytes;
+    rec.capLen = bytes < snap ? bytes : snap;
+    return rec;
+}
+
+int main(int argc, char** argv) {
+    const int ops = argc > 1 ? atoi(argv[1]) : 2000000;
+    const uint32_t snap = argc > 2 ? (uint32_t)atoi(argv[2]) : 256;
+    if (ops <= 0 || snap == 0 || snap > 2048) return 1;
+    printf("ops=%d snaplen=%u payload=1400\n", ops, snap);
+
+    std::vector<uint8_t> payload(1400, 0x5A);
+    const CaptureSegment seg{payload.data(), payload.size()};
+
+    // 1) 入环：调用线程只做 memcpy；每入环半个环容量后由同一线程取出编码（只计入环的耗时）
+    //    单线程交替进行，结果不受 CPU 数影响；写线程的编码开销见 2)
+    static CaptureRing<1024, 2048> ring;
+    PcapngWriter writer(snap);
+    std::string out;
+    writer.BeginSection(&out);
+    OpenFlow(writer, &out);
+    double pushTotalNs = 0;
+    uint64_t encoded = 0;
+    for (int base = 0; base < ops; base += 512) {
+        const int n = ops - base < 512 ? ops - base : 512;
+        const auto t0 = Clock::now();
+        for (int i = 0; i < n; ++i) {
+            if (!ring.TryPush(DataRecord(base + i, 1400, snap), &seg, 1)) return 2;
+        }
+        pushTotalNs += std::chrono::duration<double, std::nano>(Clock::now() - t0).count();
+        while (ring.Consume([&](const CaptureRecord& rec, const uint8_t* data) {
+            writer.Append(rec, data, &out);
+            ++encoded;
+        })) {
+        }
+        if (out.size() > (1u << 20)) {
+            g_sink = g_sink + out.size();
+            out.clear();
+        }
+    }
+    const double pushNs = pushTotalNs / ops;
+
+    // 2) 调用线程直接编码（不使用环）
+    PcapngWriter inlineWriter(snap);
+    out.clear();
+    inlineWriter.BeginSection(&out);
+    OpenFlow(inlineWriter, &out);
+    std::vector<uint8_t> clipped(payload.begin(), payload.begin() + snap);
+    const auto t0 = Clock::now();
+    for (int i = 0; i < ops; ++i) {
+        inlineWriter.Append(DataRecord(i, 1400, snap), clipped.data(), &out);
+        if (out.size() > (1u << 20)) {
+            g_sink = g_sink + out.size();
+            out.clear();
+        }
+    }
+    const double inlineNs = std::chrono::duration<double, std::nano>(Clock::now() - t0).count() / ops;
+
+    printf("  %-28s %10.1f ns/op\n", "ring push (memcpy)", pushNs);
+    printf("  %-28s %10.1f ns/op  (%.1f M records/s)\n", "inline encode", inlineNs, 1000.0 / inlineNs);
+    printf("  %-28s %10llu\n", "records encoded via ring", (unsigned long long)encoded);
+    return 0;
+}
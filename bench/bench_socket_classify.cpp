@@ -0,0 +1,104 @@
+// send/recv Detour 判定开销基准（直连 TCP socket）：每次 getsockopt(SO_TYPE) + 配置字符串比较（旧实现） vs 分类缓存
+// 对比指标：每次调用的判定耗时，以及连同一次 64B loopback send 的总耗时
+// 用法：bench_socket_classify [calls=1000000]
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+#include "network/SocketCompat.hpp"
+#include "network/SocketClassCache.hpp"
+
+struct FakeConfig {
+    uint16_t proxyPort = 7890;
+    std::string udpMode = "proxy";
+};
+
+// 旧实现：udp_mode=proxy 时每次调用都读取一次 SO_TYPE
+static bool LegacyTakesUdpPath(SOCKET s, const FakeConfig& config) {
+    if (config.proxyPort != 0 && config.udpMode == "proxy") {
+        int soType = 0;
+        socklen_t optLen = sizeof(soType);
+        if (getsockopt(s, SOL_SOCKET, SO_TYPE, (char*)&soType, &optLen) == 0 && soType == SOCK_DGRAM) {
+            return true;
+        }
+    }
+    return false;
+}
+
+static Network::SocketClassCache<> g_cache;
+
+// 新实现：已分类为 TCP 的 socket 一次原子读取即返回
+static bool CachedTakesUdpPath(SOCKET s, const FakeConfig& config) {
+    const Network::SocketClass cls = g_cache.Get((uintptr_t)s);
+    if (Network::IsStreamSocketClass(cls)) return false;
+    if (config.proxyPort == 0 || config.udpMode != "proxy") return false;
+    if (cls != Network::SocketClass::Unknown) return Network::IsDatagramSocketClass(cls);
+    int soType = 0;
+    socklen_t optLen = sizeof(soType);
+    if (getsockopt(s, SOL_SOCKET, SO_TYPE, (char*)&soType, &optLen) != 0) return false;
+    return Network::IsDatagramSocketClass(g_cache.Publish(
+        (uintptr_t)s, soType == SOCK_DGRAM ? Network::SocketClass::Udp : Network::SocketClass::DirectTcp));
+}
+
+template <typename Fn>
+static double NsPerCall(int calls, Fn fn) {
+    const auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < calls; ++i) fn();
+    return std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / calls;
+}
+
+int main(int argc, char** argv) {
+#ifdef _WIN32
+    WSADATA wsa{};
+    if (WSAStartup(MAKEWORD(2, 2), &wsa) != 0) return 1;
+#endif
+    const int calls = argc > 1 ? atoi(argv[1]) : 1000000;
+    FakeConfig config;
+
+    // 直连 TCP：loopback 连接对，对端持续丢弃数据
+    SOCKET listener = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+    sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    bind(listener, (sockaddr*)&addr, sizeof(addr));
+    socklen_t len = sizeof(addr);
+    getsockname(listener, (sockaddr*)&addr, &len);
+    listen(listener, 1);
+    SOCKET client = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+    connect(client, (sockaddr*)&addr, sizeof(addr));
+    SOCKET server = accept(listener, nullptr, nullptr);
+    u_long nb = 1;
+    ioctlsocket(server, FIONBIO, &nb);
+
+    volatile int sink = 0;
+    printf("calls=%d socket=direct-tcp\n", calls);
+    const double legacy = NsPerCall(calls, [&]() { sink += LegacyTakesUdpPath(client, config) ? 1 : 0; });
+    const double cached = NsPerCall(calls, [&]() { sink += CachedTakesUdpPath(client, config) ? 1 : 0; });
+    printf("  %-36s %8.1f ns/call\n", "decision: getsockopt per call", legacy);
+    printf("  %-36s %8.1f ns/call\n", "decision: classification cache", cached);
+
+    // 连同一次真实 send：体现判定开销在整次 Detour 调用中的占比
+    char payload[64] = {};
+    std::vector<char> drain(1 << 16);
+    const int sendCalls = calls / 10 > 0 ? calls / 10 : 1;
+    auto sendOnce = [&](bool useCache) {
+        const bool udp = useCache ? CachedTakesUdpPath(client, config) : LegacyTakesUdpPath(client, config);
+        sink += udp ? 1 : 0;
+        send(client, payload, (int)sizeof(payload), 0);
+        recv(server, drain.data(), (int)drain.size(), 0);
+    };
+    const double legacySend = NsPerCall(sendCalls, [&]() { sendOnce(false); });
+    const double cachedSend = NsPerCall(sendCalls, [&]() { sendOnce(true); });
+    printf("  %-36s %8.1f ns/call\n", "send 64B + getsockopt per call", legacySend);
+    printf("  %-36s %8.1f ns/call\n", "send 64B + classification cache", cachedSend);
+
+    closesocket(server);
+    closesocket(client);
+    closesocket(listener);
+#ifdef _WIN32
+    WSACleanup();
+#endif
+    return sink == -1 ? 1 : 0;
+}
@@ -0,0 +1,115 @@
+// SocketIo 就绪等待基准：select（旧实现）vs poll（WSAPoll），以及 SendAll/RecvExact 在回环连接上的吞吐
+// 场景 1：socket 已可写，等待立即返回，测单次等待开销；fd 值较大时 select 需扫描/复制整个 fd_set
+// 场景 2：非阻塞连接对上反复发送/接收握手大小的报文（64 字节请求 + 10 字节应答），测每次往返耗时
+// 用法：bench_socket_io [waits=200000] [roundtrips=50000]
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <thread>
+#include <vector>
+
+#include "network/SocketIo.hpp"
+
+using namespace Network;
+using Clock = std::chrono::steady_clock;
+
+// 旧实现：每次等待构造 fd_set 与 timeval
+static bool SelectWaitWritable(SOCKET sock, int timeoutMs) {
+    fd_set writeSet;
+    FD_ZERO(&writeSet);
+    FD_SET(sock, &writeSet);
+    timeval tv{};
+    tv.tv_sec = timeoutMs / 1000;
+    tv.tv_usec = (timeoutMs % 1000) * 1000;
+    const int rc = select(SocketCompat::SelectNfds(sock), nullptr, &writeSet, nullptr, &tv);
+    return rc > 0;
+}
+
+static SOCKET Connected(SOCKET* server) {
+    SOCKET l = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+    sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    if (l == INVALID_SOCKET || bind(l, (const sockaddr*)&addr, sizeof(addr)) != 0 || listen(l, 1) != 0) return INVALID_SOCKET;
+    SocketCompat::SockLen len = sizeof(addr);
+    getsockname(l, (sockaddr*)&addr, &len);
+    SOCKET c = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+    if (connect(c, (const sockaddr*)&addr, sizeof(addr)) != 0) return INVALID_SOCKET;
+    *server = accept(l, nullptr, nullptr);
+    closesocket(l);
+    unsigned long nb = 1;
+    ioctlsocket(c, FIONBIO, &nb);
+    ioctlsocket(*server, FIONBIO, &nb);
+    return c;
+}
+
+template <typename Fn>
+static double NsPerOp(int ops, Fn&& fn) {
+    const auto start = Clock::now();
+    for (int i = 0; i < ops; ++i) fn(i);
+    return (double)std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - start).count() / ops;
+}
+
+int main(int argc, char** argv) {
+    const int waits = argc > 1 ? atoi(argv[1]) : 200000;
+    const int roundtrips = argc > 2 ? atoi(argv[2]) : 50000;
+    if (waits <= 0 || roundtrips <= 0) return 1;
+#ifdef _WIN32
+    WSADATA wsa{};
+    if (WSAStartup(MAKEWORD(2, 2), &wsa) != 0) return 1;
+#endif
+    SOCKET server = INVALID_SOCKET;
+    SOCKET client = Connected(&server);
+    if (client == INVALID_SOCKET || server == INVALID_SOCKET) return 1;
+
+    // 1) 单次等待开销（socket 已可写）
+    int ready = 0;
+    const double selNs = NsPerOp(waits, [&](int) { ready += SelectWaitWritable(client, 1000) ? 1 : 0; });
+    const double pollNs = NsPerOp(waits, [&](int) { ready += SocketIo::WaitWritable(client, 1000) ? 1 : 0; });
+    printf("wait (ready)        select: %7.1f ns   poll: %7.1f ns   (ready=%d)\n", selNs, pollNs, ready);
+
+#ifndef _WIN32
+    // 高编号 fd：select 的开销随 nfds 增长（Winsock 的 fd_set 为数组，不受此影响）
+    std::vector<SOCKET> filler;
+    SOCKET high = client;
+    while (high < 900) {
+        SOCKET d = dup(client);
+        if (d < 0) break;
+        filler.push_back(d);
+        high = d;
+    }
+    const double selHighNs = NsPerOp(waits, [&](int) { ready += SelectWaitWritable(high, 1000) ? 1 : 0; });
+    const double pollHighNs = NsPerOp(waits, [&](int) { ready += SocketIo::WaitWritable(high, 1000) ? 1 : 0; });
+    printf("wait (fd=%-4d)       select: %7.1f ns   poll: %7.1f ns\n", (int)high, selHighNs, pollHighNs);
+    for (SOCKET d : filler) closesocket(d);
+#endif
+
+    // 2) 握手式往返：对端线程回显应答；每次 RecvExact 通常需要一次等待
+    std::thread echo([&]() {
+        uint8_t req[64];
+        const uint8_t resp[10] = {5, 0, 0, 1, 0, 0, 0, 0, 0, 0};
+        for (int i = 0; i < roundtrips; ++i) {
+            if (!SocketIo::RecvExact(server, req, (int)sizeof(req), 5000)) return;
+            if (!SocketIo::SendAll(server, (const char*)resp, (int)sizeof(resp), 5000)) return;
+        }
+    });
+    uint8_t req[64] = {5, 1, 0};
+    uint8_t resp[10];
+    int ok = 0;
+    const double rtNs = NsPerOp(roundtrips, [&](int) {
+        if (SocketIo::SendAll(client, (const char*)req, (int)sizeof(req), 5000) &&
+            SocketIo::RecvExact(client, resp, (int)sizeof(resp), 5000)) {
+            ok++;
+        }
+    });
+    echo.join();
+    printf("roundtrip 64B/10B   %7.1f us   (ok=%d/%d)\n", rtNs / 1000.0, ok, roundtrips);
+
+    closesocket(client);
+    closesocket(server);
+#ifdef _WIN32
+    WSACleanup();
+#endif
+    return ok == roundtrips ? 0 : 1;
+}
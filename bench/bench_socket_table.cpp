@@ -0,0 +1,154 @@
+// per-socket 状态查表竞争基准：全局锁 + 多张 unordered_map（旧实现） vs 分片 socket 上下文表
+// 模拟一次 overlapped UDP 发送的热路径：查 UDP 代理状态 -> 登记 overlapped -> 完成时摘除 -> 查目标（日志）
+// 对比指标：不同线程数下每秒完成的操作数
+// 用法：bench_socket_table [ops_per_thread=200000] [sockets_per_thread=256] [max_threads=16]
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "network/SocketContextTable.hpp"
+
+using SocketKey = uintptr_t;
+using OverlappedKey = uintptr_t;
+
+struct TargetInfo {
+    std::string host;
+    uint16_t port = 0;
+};
+
+struct UdpState {
+    bool relayConnected = true;
+    uint8_t header[22] = {};
+    size_t headerLen = 10;
+};
+
+// 旧实现：每类状态一张全局 map，各自一把全局锁
+struct LegacyState {
+    std::mutex targetsMtx;
+    std::unordered_map<SocketKey, TargetInfo> targets;
+    std::mutex udpMtx;
+    std::unordered_map<SocketKey, UdpState> udp;
+    std::mutex ovlMtx;
+    std::unordered_map<OverlappedKey, SocketKey> overlapped;
+
+    void Add(SocketKey s) {
+        { std::lock_guard<std::mutex> lock(targetsMtx); targets[s] = TargetInfo{"example.com", 443}; }
+        { std::lock_guard<std::mutex> lock(udpMtx); udp[s] = UdpState{}; }
+    }
+
+    bool Op(SocketKey s, OverlappedKey ovl) {
+        size_t headerLen = 0;
+        {
+            std::lock_guard<std::mutex> lock(udpMtx);
+            auto it = udp.find(s);
+            if (it == udp.end() || !it->second.relayConnected) return false;
+            headerLen = it->second.headerLen;
+        }
+        {
+            std::lock_guard<std::mutex> lock(ovlMtx);
+            overlapped[ovl] = s;
+        }
+        {
+            std::lock_guard<std::mutex> lock(ovlMtx);
+            overlapped.erase(ovl);
+        }
+        std::lock_guard<std::mutex> lock(targetsMtx);
+        auto it = targets.find(s);
+        return it != targets.end() && it->second.port != 0 && headerLen != 0;
+    }
+};
+
+// 新实现：分片 socket 记录表 + 分片 overlapped 索引，记录内一把锁
+struct SocketRecord : Network::RefCounted<SocketRecord> {
+    std::mutex mtx;
+    TargetInfo target;
+    UdpState udp;
+    std::vector<OverlappedKey> pending;
+};
+
+struct ShardedState {
+    Network::RefTable<SocketKey, SocketRecord> sockets;
+    Network::ShardedTable<OverlappedKey, SocketKey> overlapped;
+
+    void Add(SocketKey s) {
+        auto r = sockets.FindOrCreate(s, []() { return new SocketRecord(); });
+        std::lock_guard<std::mutex> lock(r->mtx);
+        r->target = TargetInfo{"example.com", 443};
+    }
+
+    bool Op(SocketKey s, OverlappedKey ovl) {
+        auto r = sockets.Find(s);
+        if (!r) return false;
+        size_t headerLen = 0;
+        {
+            std::lock_guard<std::mutex> lock(r->mtx);
+            if (!r->udp.relayConnected) return false;
+            headerLen = r->udp.headerLen;
+            r->pending.push_back(ovl);
+        }
+        overlapped.InsertOrAssign(ovl, s);
+        SocketKey owner = 0;
+        overlapped.Erase(ovl, &owner);
+        std::lock_guard<std::mutex> lock(r->mtx);
+        r->pending.pop_back();
+        return owner == s && r->target.port != 0 && headerLen != 0;
+    }
+};
+
+template <typename State>
+static double Run(int threads, int opsPerThread, int socketsPerThread, uint64_t* failures) {
+    State state;
+    for (int t = 0; t < threads; ++t) {
+        for (int i = 0; i < socketsPerThread; ++i) state.Add((SocketKey)((t * socketsPerThread + i + 1) * 4));
+    }
+    std::atomic<int> ready{0};
+    std::atomic<bool> go{false};
+    std::atomic<uint64_t> bad{0};
+    std::vector<std::thread> workers;
+    for (int t = 0; t < threads; ++t) {
+        workers.emplace_back([&, t]() {
+            // 每线程一个 OVERLAPPED 数组，模拟各自的 IO 请求
+            std::vector<uint64_t> ovls((size_t)socketsPerThread);
+            ready.fetch_add(1);
+            while (!go.load(std::memory_order_acquire)) std::this_thread::yield();
+            uint64_t localBad = 0;
+            for (int i = 0; i < opsPerThread; ++i) {
+                const int idx = i % socketsPerThread;
+                const SocketKey s = (SocketKey)((t * socketsPerThread + idx + 1) * 4);
+                if (!state.Op(s, (OverlappedKey)&ovls[(size_t)idx])) ++localBad;
+            }
+            bad.fetch_add(localBad);
+        });
+    }
+    while (ready.load() < threads) std::this_thread::yield();
+    const auto start = std::chrono::steady_clock::now();
+    go.store(true, std::memory_order_release);
+    for (auto& w : workers) w.join();
+    const double sec = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    *failures = bad.load();
+    return (double)threads * opsPerThread / sec;
+}
+
+int main(int argc, char** argv) {
+    const int opsPerThread = argc > 1 ? atoi(argv[1]) : 200000;
+    const int socketsPerThread = argc > 2 ? atoi(argv[2]) : 256;
+    const int maxThreads = argc > 3 ? atoi(argv[3]) : 16;
+    printf("ops_per_thread=%d sockets_per_thread=%d hw_threads=%u\n",
+           opsPerThread, socketsPerThread, std::thread::hardware_concurrency());
+    printf("  %-8s %16s %16s %8s\n", "threads", "legacy Mops/s", "sharded Mops/s", "speedup");
+    for (int threads = 1; threads <= maxThreads; threads *= 2) {
+        uint64_t badLegacy = 0, badSharded = 0;
+        const double legacy = Run<LegacyState>(threads, opsPerThread, socketsPerThread, &badLegacy);
+        const double sharded = Run<ShardedState>(threads, opsPerThread, socketsPerThread, &badSharded);
+        printf("  %-8d %16.2f %16.2f %7.2fx%s\n", threads, legacy / 1e6, sharded / 1e6, sharded / legacy,
+               (badLegacy || badSharded) ? "  (失败计数非零)" : "");
+    }
+    return 0;
+}
@@ -0,0 +1,193 @@
+// SOCKS5 UDP 封装基准：整包复制（旧 Wrap） vs 头部编码 + 聚合发送
+// 对比指标：每数据报耗时、每数据报堆分配次数；可选地经 loopback 实际发送
+// 用法：bench_socks5_udp_wrap [iterations=2000000] [payload=1200]
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+#include <string>
+#include <vector>
+
+#include "network/SocketCompat.hpp"
+#include "network/Socks5Protocol.hpp"
+
+#ifndef _WIN32
+#include <sys/uio.h>
+#endif
+
+// 统计堆分配次数
+static std::atomic<uint64_t> g_allocs{0};
+
+void* operator new(size_t size) {
+    g_allocs.fetch_add(1, std::memory_order_relaxed);
+    if (void* p = malloc(size ? size : 1)) return p;
+    throw std::bad_alloc();
+}
+void operator delete(void* p) noexcept { free(p); }
+void operator delete(void* p, size_t) noexcept { free(p); }
+
+// 旧实现：地址字节与整包各一个 vector，payload 整体复制
+static bool LegacyWrap(const std::string& host, uint16_t port, const uint8_t* payload, size_t payloadLen,
+                       std::vector<uint8_t>* outPacket) {
+    outPacket->clear();
+    uint8_t atyp = Network::Socks5::ATYP_DOMAIN;
+    std::vector<uint8_t> addrBytes;
+    in_addr addr4{};
+    in6_addr addr6{};
+    if (!host.empty() && inet_pton(AF_INET, host.c_str(), &addr4) == 1) {
+        atyp = Network::Socks5::ATYP_IPV4;
+        addrBytes.resize(4);
+        memcpy(addrBytes.data(), &addr4, 4);
+    } else if (!host.empty() && inet_pton(AF_INET6, host.c_str(), &addr6) == 1) {
+        atyp = Network::Socks5::ATYP_IPV6;
+        addrBytes.resize(16);
+        memcpy(addrBytes.data(), &addr6, 16);
+    } else {
+        if (host.size() > 255) return false;
+        addrBytes.reserve(1 + host.size());
+        addrBytes.push_back((uint8_t)host.size());
+        addrBytes.insert(addrBytes.end(), host.begin(), host.end());
+    }
+    const size_t headerLen = 2 + 1 + 1 + addrBytes.size() + 2;
+    outPacket->reserve(headerLen + payloadLen);
+    outPacket->push_back(0x00);
+    outPacket->push_back(0x00);
+    outPacket->push_back(0x00);
+    outPacket->push_back(atyp);
+    outPacket->insert(outPacket->end(), addrBytes.begin(), addrBytes.end());
+    outPacket->push_back((uint8_t)((port >> 8) & 0xFF));
+    outPacket->push_back((uint8_t)(port & 0xFF));
+    outPacket->insert(outPacket->end(), payload, payload + payloadLen);
+    return true;
+}
+
+static volatile uint64_t g_sink = 0;
+
+struct Sample {
+    double nsPerOp = 0;
+    double allocsPerOp = 0;
+};
+
+template <typename Fn>
+static Sample Measure(int iterations, Fn fn) {
+    const uint64_t allocsBefore = g_allocs.load();
+    const auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < iterations; ++i) fn(i);
+    const double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+    Sample s;
+    s.nsPerOp = ns / iterations;
+    s.allocsPerOp = (double)(g_allocs.load() - allocsBefore) / iterations;
+    return s;
+}
+
+static void Report(const char* name, const Sample& s, int payloadBytes) {
+    const double gbps = s.nsPerOp > 0 ? (payloadBytes / s.nsPerOp) : 0; // bytes/ns == GB/s
+    printf("  %-28s %8.1f ns/op  %5.2f allocs/op  %7.2f GB/s payload\n", name, s.nsPerOp, s.allocsPerOp, gbps);
+}
+
+// 经 loopback 实际发送：整包复制 + send vs 头部 + payload 聚合发送
+static bool SendGather(SOCKET s, const uint8_t* header, size_t headerLen, const uint8_t* payload, size_t payloadLen) {
+#ifdef _WIN32
+    WSABUF bufs[2];
+    bufs[0].buf = (CHAR*)header;
+    bufs[0].len = (ULONG)headerLen;
+    bufs[1].buf = (CHAR*)payload;
+    bufs[1].len = (ULONG)payloadLen;
+    DWORD sent = 0;
+    return WSASend(s, bufs, 2, &sent, 0, NULL, NULL) == 0;
+#else
+    iovec iov[2];
+    iov[0].iov_base = (void*)header;
+    iov[0].iov_len = headerLen;
+    iov[1].iov_base = (void*)payload;
+    iov[1].iov_len = payloadLen;
+    msghdr msg{};
+    msg.msg_iov = iov;
+    msg.msg_iovlen = 2;
+    return sendmsg(s, &msg, 0) == (ssize_t)(headerLen + payloadLen);
+#endif
+}
+
+static void RunLoopback(int iterations, const std::vector<uint8_t>& payload) {
+    SOCKET rx = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+    SOCKET tx = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+    sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    bind(rx, (sockaddr*)&addr, sizeof(addr));
+    socklen_t len = sizeof(addr);
+    getsockname(rx, (sockaddr*)&addr, &len);
+    connect(tx, (sockaddr*)&addr, sizeof(addr));
+    unsigned long nb = 1;
+    ioctlsocket(rx, FIONBIO, &nb);
+
+    // 接收端非阻塞丢弃，避免缓冲区满导致发送端阻塞影响计时
+    std::vector<char> drain(65535);
+    auto drainAll = [&]() {
+        while (recv(rx, drain.data(), (int)drain.size(), 0) > 0) {}
+    };
+    const std::string host = "198.18.0.1";
+    uint8_t header[32];
+    const size_t headerLen = Network::Socks5::EncodeUdpHeader(host, 443, header, sizeof(header));
+    printf("loopback send (%d datagrams):\n", iterations);
+    Report("copy + send", Measure(iterations, [&](int i) {
+        std::vector<uint8_t> packet;
+        LegacyWrap(host, 443, payload.data(), payload.size(), &packet);
+        send(tx, (const char*)packet.data(), (int)packet.size(), 0);
+        if ((i & 63) == 0) drainAll();
+    }), (int)payload.size());
+    drainAll();
+    Report("cached header + gather send", Measure(iterations, [&](int i) {
+        SendGather(tx, header, headerLen, payload.data(), payload.size());
+        if ((i & 63) == 0) drainAll();
+    }), (int)payload.size());
+    drainAll();
+    closesocket(tx);
+    closesocket(rx);
+}
+
+int main(int argc, char** argv) {
+#ifdef _WIN32
+    WSADATA wsa{};
+    if (WSAStartup(MAKEWORD(2, 2), &wsa) != 0) return 1;
+#endif
+    const int iterations = argc > 1 ? atoi(argv[1]) : 2000000;
+    const int payloadBytes = argc > 2 ? atoi(argv[2]) : 1200;
+    std::vector<uint8_t> payload((size_t)payloadBytes, 0x5A);
+    printf("iterations=%d payload=%dB\n", iterations, payloadBytes);
+
+    const char* hosts[] = {"198.18.0.1", "2001:db8::1", "www.example.com"};
+    for (const char* h : hosts) {
+        const std::string host = h;
+        printf("host=%s\n", h);
+        // 旧发送路径：每个数据报新建整包 vector
+        Report("legacy Wrap (copy)", Measure(iterations, [&](int) {
+            std::vector<uint8_t> packet;
+            LegacyWrap(host, 443, payload.data(), payload.size(), &packet);
+            g_sink += packet.size();
+        }), payloadBytes);
+
+        // sendto 路径：每个数据报在栈上编码头部，payload 不复制
+        Report("per-datagram EncodeUdpHeader", Measure(iterations, [&](int) {
+            uint8_t header[64 + 255];
+            g_sink += Network::Socks5::EncodeUdpHeader(host, 443, header, sizeof(header));
+        }), payloadBytes);
+
+        // send/WSASend 路径：头部已缓存在 socket 上下文，仅拷贝头部
+        uint8_t cached[64 + 255];
+        const size_t cachedLen = Network::Socks5::EncodeUdpHeader(host, 443, cached, sizeof(cached));
+        Report("cached header", Measure(iterations, [&](int) {
+            uint8_t header[64 + 255];
+            memcpy(header, cached, cachedLen);
+            g_sink += header[cachedLen - 1];
+        }), payloadBytes);
+    }
+
+    RunLoopback(iterations / 10 > 0 ? iterations / 10 : 1, payload);
+#ifdef _WIN32
+    WSACleanup();
+#endif
+    return 0;
+}
@@ -0,0 +1,87 @@
+// 流量监控开销基准：分片计数器（现行） vs 逐包十六进制摘要（旧 traffic_logging，仅格式化，不含入队与写盘）
+// 场景：threads 个线程各自对 sockets 个 socket 交替收发共 ops 次，每次 1400 字节
+// 对比指标：每次收发的耗时（ns；多线程为墙钟时间 / 总次数，CPU 少于线程数时不代表单次调用的开销）；以及一次全量读取的耗时
+// 用法：bench_traffic_counters [ops=4000000] [threads=4] [sockets=256]
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "network/TrafficCounters.hpp"
+
+using namespace Network;
+using Clock = std::chrono::steady_clock;
+
+static volatile size_t g_sink = 0;
+
+// 旧实现：每次收发都把前 32 字节格式化为十六进制摘要行
+static std::string OldHexSummary(const char* direction, uintptr_t s, const char* buf, int len) {
+    std::string result = "[" + std::string(direction) + "] Socket=" + std::to_string(s);
+    result += " Len=" + std::to_string(len);
+    if (len > 0 && buf) {
+        result += " Data=";
+        const int displayLen = (len > 32) ? 32 : len;
+        for (int i = 0; i < displayLen; i++) {
+            char hex[4];
+            snprintf(hex, sizeof(hex), "%02X ", (unsigned char)buf[i]);
+            result += hex;
+        }
+        if (len > 32) result += "...";
+    }
+    return result;
+}
+
+template <typename Body>
+static double RunThreads(int threads, int ops, Body&& body) {
+    std::vector<std::thread> workers;
+    const auto t0 = Clock::now();
+    for (int t = 0; t < threads; ++t) {
+        workers.emplace_back([&, t]() { body(t, ops / threads); });
+    }
+    for (auto& w : workers) w.join();
+    return std::chrono::duration<double, std::nano>(Clock::now() - t0).count() / ops;
+}
+
+int main(int argc, char** argv) {
+    const int ops = argc > 1 ? atoi(argv[1]) : 4000000;
+    const int threads = argc > 2 ? atoi(argv[2]) : 4;
+    const int sockets = argc > 3 ? atoi(argv[3]) : 256;
+    if (ops <= 0 || threads <= 0 || sockets <= 0) return 1;
+    printf("ops=%d threads=%d sockets=%d\n", ops, threads, sockets);
+
+    std::vector<char> payload(1400, 'x');
+    static TrafficCounters<> counters;
+
+    auto countBody = [&](int t, int n) {
+        for (int i = 0; i < n; ++i) {
+            const uintptr_t s = 1000 + (uintptr_t)((i + t * 7) % sockets) * 4;
+            counters.Add(s, (i & 1) ? TrafficDirection::Recv : TrafficDirection::Send, payload.size());
+        }
+    };
+    const double single = RunThreads(1, ops, countBody);
+    const double multi = RunThreads(threads, ops, countBody);
+
+    const double hex = RunThreads(1, ops / 10, [&](int, int n) {
+        size_t bytes = 0;
+        for (int i = 0; i < n; ++i) {
+            const uintptr_t s = 1000 + (uintptr_t)(i % sockets) * 4;
+            bytes += OldHexSummary((i & 1) ? "RECV" : "SEND", s, payload.data(), (int)payload.size()).size();
+        }
+        g_sink = g_sink + bytes;
+    });
+
+    const auto t0 = Clock::now();
+    const auto live = counters.Sockets();
+    const TrafficTotals total = counters.Total();
+    const double readUs = std::chrono::duration<double, std::micro>(Clock::now() - t0).count();
+    g_sink = g_sink + live.size() + (size_t)total.opsSent;
+
+    printf("  %-28s %10.1f ns/op\n", "counters (1 thread)", single);
+    printf("  %-28s %10.1f ns/op  (%d threads)\n", "counters (N threads)", multi, threads);
+    printf("  %-28s %10.1f ns/op\n", "old hex summary (format)", hex);
+    printf("  %-28s %10.1f us  (%zu sockets)\n", "read (sockets + total)", readUs, live.size());
+    return 0;
+}
@@ -0,0 +1,200 @@
+// SOCKS5 UDP 接收基准：每次接收 make_shared 上下文 + 整包缓冲 + 复制（旧路径） vs 上下文池 + 就地散布接收
+// 另测池化整包复制（用户缓冲区过多、无法就地接收时的回退路径）：整包缓冲随上下文复用
+// 对比指标：每数据报耗时、每数据报堆分配次数、每数据报复制字节数（经 loopback 实际收包）
+// 用法：bench_udp_recv_inplace [datagrams=200000] [payload=1200]
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <new>
+#include <string>
+#include <vector>
+
+#include "network/SocketCompat.hpp"
+#include "network/Socks5Protocol.hpp"
+#include "network/SlabPool.hpp"
+#include "network/UdpRecvInPlace.hpp"
+
+#ifndef _WIN32
+#include <sys/uio.h>
+#endif
+
+// 统计堆分配次数
+static std::atomic<uint64_t> g_allocs{0};
+
+void* operator new(size_t size) {
+    g_allocs.fetch_add(1, std::memory_order_relaxed);
+    if (void* p = malloc(size ? size : 1)) return p;
+    throw std::bad_alloc();
+}
+void operator delete(void* p) noexcept { free(p); }
+void operator delete(void* p, size_t) noexcept { free(p); }
+
+using Network::UdpRecvInPlace::Segment;
+
+// 旧实现的上下文形态：每次接收新建，整包缓冲随上下文释放
+struct LegacyRecvCtx {
+    std::vector<uint8_t> recvBuf;
+    sockaddr_storage fromTmp{};
+};
+
+// 池化上下文：散布布局、平移暂存区与整包缓冲随上下文复用
+struct PooledRecvCtx {
+    Segment segs[Network::UdpRecvInPlace::kMaxUserSegments + 2];
+    uint8_t scratch[Network::UdpRecvInPlace::kMaxHeaderBytes];
+    uint8_t tail[Network::UdpRecvInPlace::kMaxHeaderBytes];
+    std::vector<uint8_t> fixup;
+    std::vector<uint8_t> recvBuf;
+};
+
+static int RecvScatter(SOCKET s, Segment* segs, size_t count) {
+#ifdef _WIN32
+    WSABUF bufs[Network::UdpRecvInPlace::kMaxUserSegments + 2];
+    for (size_t i = 0; i < count; ++i) {
+        bufs[i].buf = (CHAR*)segs[i].data;
+        bufs[i].len = (ULONG)segs[i].len;
+    }
+    DWORD bytes = 0;
+    DWORD flags = 0;
+    if (WSARecv(s, bufs, (DWORD)count, &bytes, &flags, NULL, NULL) != 0) return -1;
+    return (int)bytes;
+#else
+    iovec iov[Network::UdpRecvInPlace::kMaxUserSegments + 2];
+    for (size_t i = 0; i < count; ++i) {
+        iov[i].iov_base = segs[i].data;
+        iov[i].iov_len = segs[i].len;
+    }
+    msghdr msg{};
+    msg.msg_iov = iov;
+    msg.msg_iovlen = count;
+    return (int)recvmsg(s, &msg, 0);
+#endif
+}
+
+struct Sample {
+    double nsPerOp = 0;
+    double allocsPerOp = 0;
+    double copyBytesPerOp = 0;
+    uint64_t bad = 0;
+};
+
+static void Report(const char* name, const Sample& s) {
+    printf("  %-34s %8.1f ns/dgram  %5.2f allocs/dgram  %7.1f copy B/dgram  bad=%llu\n",
+           name, s.nsPerOp, s.allocsPerOp, s.copyBytesPerOp, (unsigned long long)s.bad);
+}
+
+// 批量发送 SOCKS5 UDP 回包后逐个接收，只对接收计时
+template <typename RecvFn>
+static Sample Run(SOCKET tx, const std::vector<uint8_t>& datagram, int total, RecvFn recvOne) {
+    Sample out;
+    const int batch = 64;
+    double ns = 0;
+    uint64_t allocs = 0;
+    uint64_t copyBytes = 0;
+    for (int done = 0; done < total; done += batch) {
+        for (int i = 0; i < batch; ++i) {
+            send(tx, (const char*)datagram.data(), (int)datagram.size(), 0);
+        }
+        const uint64_t allocsBefore = g_allocs.load();
+        const auto start = std::chrono::steady_clock::now();
+        for (int i = 0; i < batch; ++i) {
+            size_t copied = 0;
+            if (!recvOne(&copied)) ++out.bad;
+            copyBytes += copied;
+        }
+        ns += std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+        allocs += g_allocs.load() - allocsBefore;
+    }
+    out.nsPerOp = ns / total;
+    out.allocsPerOp = (double)allocs / total;
+    out.copyBytesPerOp = (double)copyBytes / total;
+    return out;
+}
+
+int main(int argc, char** argv) {
+#ifdef _WIN32
+    WSADATA wsa{};
+    if (WSAStartup(MAKEWORD(2, 2), &wsa) != 0) return 1;
+#endif
+    const int total = argc > 1 ? atoi(argv[1]) : 200000;
+    const int payloadBytes = argc > 2 ? atoi(argv[2]) : 1200;
+
+    SOCKET rx = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+    SOCKET tx = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+    sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    bind(rx, (sockaddr*)&addr, sizeof(addr));
+    socklen_t len = sizeof(addr);
+    getsockname(rx, (sockaddr*)&addr, &len);
+    connect(tx, (sockaddr*)&addr, sizeof(addr));
+    int rcvbuf = 4 * 1024 * 1024;
+    setsockopt(rx, SOL_SOCKET, SO_RCVBUF, (const char*)&rcvbuf, sizeof(rcvbuf));
+
+    // 用户缓冲区：QUIC 栈常见的单块 1500B 接收缓冲
+    std::vector<uint8_t> user(1500);
+    const size_t userCap = user.size();
+    printf("datagrams=%d payload=%dB user_buffer=%zuB\n", total, payloadBytes, userCap);
+
+    Network::SlabPool<PooledRecvCtx, 64> pool;
+    const char* replyHosts[] = {"203.0.113.9", "2001:db8::1"};
+    for (const char* host : replyHosts) {
+        uint8_t header[Network::UdpRecvInPlace::kMaxHeaderBytes];
+        const size_t headerLen = Network::Socks5::EncodeUdpHeader(host, 443, header, sizeof(header));
+        std::vector<uint8_t> datagram(header, header + headerLen);
+        datagram.resize(headerLen + (size_t)payloadBytes, 0x5A);
+        printf("reply src=%s (header=%zuB)\n", host, headerLen);
+
+        Report("legacy make_shared + copy", Run(tx, datagram, total, [&](size_t* copied) {
+            auto ctx = std::make_shared<LegacyRecvCtx>();
+            ctx->recvBuf.resize(userCap + Network::UdpRecvInPlace::kMaxHeaderBytes);
+            const int n = recv(rx, (char*)ctx->recvBuf.data(), (int)ctx->recvBuf.size(), 0);
+            Network::Socks5::UdpHeaderView view{};
+            if (n <= 0 || !Network::Socks5::DecodeUdpHeader(ctx->recvBuf.data(), (size_t)n, &view)) return false;
+            const size_t payloadLen = (size_t)n - view.headerLen;
+            const size_t c = payloadLen < userCap ? payloadLen : userCap;
+            memcpy(user.data(), ctx->recvBuf.data() + view.headerLen, c);
+            *copied = c;
+            return true;
+        }));
+
+        // 预测按 IPv4 回包头：IPv4 源命中（零复制），IPv6 源走平移
+        Report("pooled in-place (hint=10)", Run(tx, datagram, total, [&](size_t* copied) {
+            PooledRecvCtx* ctx = pool.Acquire();
+            ctx->segs[0] = {ctx->scratch, Network::UdpRecvInPlace::kDefaultHeaderHint};
+            ctx->segs[1] = {user.data(), userCap};
+            ctx->segs[2] = {ctx->tail, sizeof(ctx->tail)};
+            const int n = RecvScatter(rx, ctx->segs, 3);
+            Network::UdpRecvInPlace::Result r{};
+            const bool ok = n > 0 && Network::UdpRecvInPlace::Finalize(ctx->segs, 3, (size_t)n, &ctx->fixup, &r);
+            *copied = r.copiedBytes;
+            pool.Release(ctx);
+            return ok;
+        }));
+
+        Report("pooled copy fallback", Run(tx, datagram, total, [&](size_t* copied) {
+            PooledRecvCtx* ctx = pool.Acquire();
+            ctx->recvBuf.resize(userCap + Network::UdpRecvInPlace::kMaxHeaderBytes);
+            const int n = recv(rx, (char*)ctx->recvBuf.data(), (int)ctx->recvBuf.size(), 0);
+            Network::Socks5::UdpHeaderView view{};
+            const bool ok = n > 0 && Network::Socks5::DecodeUdpHeader(ctx->recvBuf.data(), (size_t)n, &view);
+            if (ok) {
+                const size_t payloadLen = (size_t)n - view.headerLen;
+                const size_t c = payloadLen < userCap ? payloadLen : userCap;
+                memcpy(user.data(), ctx->recvBuf.data() + view.headerLen, c);
+                *copied = c;
+            }
+            pool.Release(ctx);
+            return ok;
+        }));
+    }
+
+    closesocket(tx);
+    closesocket(rx);
+#ifdef _WIN32
+    WSACleanup();
+#endif
+    return 0;
+}
@@ -0,0 +1,354 @@
+// UDP 中继基准：逐 socket Associate vs 多路复用（UdpRelayMux）
+// 对比指标：代理端控制连接数、数据报往返吞吐、错投数
+// 目标场景：ip（各 socket 访问不同 IP）、domain（各 socket 访问不同域名，代理回包来源为解析后的 IP，等价于 FakeIP）、
+//           same_target（所有 socket 访问同一 host:port）；任一场景出现丢包/错投时以非零退出码结束
+// 用法：bench_udp_relay_mux [sockets=64] [rounds=2000] [payload=1200]
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "network/SocketCompat.hpp"
+#include "network/Socks5Protocol.hpp"
+#include "network/UdpRelayMux.hpp"
+
+using Network::UdpRelayMux;
+
+static sockaddr_in Loopback(uint16_t port) {
+    sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    addr.sin_port = htons(port);
+    return addr;
+}
+
+static void SetRecvTimeout(SOCKET s, int ms) {
+#ifdef _WIN32
+    DWORD tv = (DWORD)ms;
+#else
+    timeval tv{};
+    tv.tv_sec = ms / 1000;
+    tv.tv_usec = (ms % 1000) * 1000;
+#endif
+    setsockopt(s, SOL_SOCKET, SO_RCVTIMEO, (const char*)&tv, sizeof(tv));
+}
+
+static bool RecvExact(SOCKET s, uint8_t* buf, int len) {
+    int got = 0;
+    while (got < len) {
+        const int n = recv(s, (char*)buf + got, len - got, 0);
+        if (n <= 0) return false;
+        got += n;
+    }
+    return true;
+}
+
+// 本地 SOCKS5 UDP 替身：每个 UDP ASSOCIATE 分配独立 relay 端口，并把收到的数据报回显给发送端口
+// （回显报文的 SOCKS5 头即原目标地址，与真实代理“回包来源=目标”的语义一致；
+//   目标为域名时与真实代理一样改写为解析后的 IP，回包头里不再有域名）
+class Socks5UdpStandIn {
+public:
+    std::atomic<int> controlConnections{0};
+
+    bool Start() {
+        m_listener = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+        if (m_listener == INVALID_SOCKET) return false;
+        sockaddr_in addr = Loopback(0);
+        if (bind(m_listener, (sockaddr*)&addr, sizeof(addr)) != 0) return false;
+        if (listen(m_listener, 256) != 0) return false;
+        socklen_t len = sizeof(addr);
+        if (getsockname(m_listener, (sockaddr*)&addr, &len) != 0) return false;
+        port = ntohs(addr.sin_port);
+        m_acceptor = std::thread([this]() { AcceptLoop(); });
+        return true;
+    }
+
+    void Stop() {
+        m_stop = true;
+        SOCKET wake = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+        sockaddr_in addr = Loopback(port);
+        connect(wake, (sockaddr*)&addr, sizeof(addr));
+        closesocket(wake);
+        m_acceptor.join();
+        closesocket(m_listener);
+        for (auto& t : m_sessions) t.join();
+    }
+
+    uint16_t port = 0;
+
+private:
+    void AcceptLoop() {
+        while (!m_stop.load()) {
+            SOCKET c = accept(m_listener, nullptr, nullptr);
+            if (c == INVALID_SOCKET) continue;
+            if (m_stop.load()) {
+                closesocket(c);
+                break;
+            }
+            m_sessions.emplace_back([this, c]() { Session(c); });
+        }
+    }
+
+    void Session(SOCKET control) {
+        uint8_t greeting[3];
+        uint8_t request[10];
+        if (!RecvExact(control, greeting, 3) || greeting[0] != Network::Socks5::VERSION) {
+            closesocket(control);
+            return;
+        }
+        const uint8_t auth[2] = {Network::Socks5::VERSION, Network::Socks5::AUTH_NONE};
+        send(control, (const char*)auth, 2, 0);
+        if (!RecvExact(control, request, 10) || request[1] != Network::Socks5::CMD_UDP_ASSOCIATE) {
+            closesocket(control);
+            return;
+        }
+        controlConnections++;
+
+        SOCKET relay = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+        sockaddr_in relayAddr = Loopback(0);
+        bind(relay, (sockaddr*)&relayAddr, sizeof(relayAddr));
+        socklen_t relayLen = sizeof(relayAddr);
+        getsockname(relay, (sockaddr*)&relayAddr, &relayLen);
+        const int bufBytes = 4 * 1024 * 1024;
+        setsockopt(relay, SOL_SOCKET, SO_RCVBUF, (const char*)&bufBytes, sizeof(bufBytes));
+
+        uint8_t reply[10] = {Network::Socks5::VERSION, Network::Socks5::REPLY_SUCCESS, 0x00, Network::Socks5::ATYP_IPV4};
+        memcpy(reply + 4, &relayAddr.sin_addr, 4);
+        memcpy(reply + 8, &relayAddr.sin_port, 2);
+        send(control, (const char*)reply, 10, 0);
+
+        std::vector<char> buf(65535);
+        while (true) {
+            Network::SocketCompat::PollFd fds[2] = {};
+            fds[0].fd = control;
+            fds[0].events = POLLIN;
+            fds[1].fd = relay;
+            fds[1].events = POLLIN;
+            const int rc = Network::SocketCompat::Poll(fds, 2, 200);
+            if (rc < 0 || m_stop.load()) break;
+            if (fds[0].revents & (POLLIN | POLLERR | POLLHUP)) {
+                char probe[16];
+                if (recv(control, probe, sizeof(probe), 0) <= 0) break;
+            }
+            if (fds[1].revents & POLLIN) {
+                sockaddr_storage from{};
+                socklen_t fromLen = sizeof(from);
+                const int n = recvfrom(relay, buf.data(), (int)buf.size(), 0, (sockaddr*)&from, &fromLen);
+                if (n <= 0) continue;
+                Network::Socks5::UdpHeaderView view;
+                if (Network::Socks5::DecodeUdpHeader((const uint8_t*)buf.data(), (size_t)n, &view) &&
+                    view.atyp == Network::Socks5::ATYP_DOMAIN) {
+                    uint8_t header[32];
+                    const size_t headerLen = Network::Socks5::EncodeUdpHeader("203.0.113.7", view.port, header, sizeof(header));
+                    std::vector<char> out(header, header + headerLen);
+                    out.insert(out.end(), buf.data() + view.headerLen, buf.data() + n);
+                    sendto(relay, out.data(), (int)out.size(), 0, (sockaddr*)&from, fromLen);
+                } else {
+                    sendto(relay, buf.data(), n, 0, (sockaddr*)&from, fromLen);
+                }
+            }
+        }
+        closesocket(relay);
+        closesocket(control);
+    }
+
+    SOCKET m_listener = INVALID_SOCKET;
+    std::atomic<bool> m_stop{false};
+    std::thread m_acceptor;
+    std::vector<std::thread> m_sessions;
+};
+
+// 最小 SOCKS5 UDP ASSOCIATE 客户端（等价于 Socks5Udp::UdpAssociate 的成功路径）
+static SOCKET Associate(uint16_t proxyPort, sockaddr_in* relay) {
+    SOCKET tcp = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+    if (tcp == INVALID_SOCKET) return INVALID_SOCKET;
+    sockaddr_in proxy = Loopback(proxyPort);
+    uint8_t auth[2];
+    uint8_t reply[10];
+    const uint8_t greeting[3] = {Network::Socks5::VERSION, 0x01, Network::Socks5::AUTH_NONE};
+    const uint8_t request[10] = {Network::Socks5::VERSION, Network::Socks5::CMD_UDP_ASSOCIATE, 0x00,
+                                 Network::Socks5::ATYP_IPV4, 0, 0, 0, 0, 0, 0};
+    if (connect(tcp, (sockaddr*)&proxy, sizeof(proxy)) != 0 ||
+        send(tcp, (const char*)greeting, 3, 0) != 3 || !RecvExact(tcp, auth, 2) ||
+        send(tcp, (const char*)request, 10, 0) != 10 || !RecvExact(tcp, reply, 10) ||
+        reply[1] != Network::Socks5::REPLY_SUCCESS) {
+        closesocket(tcp);
+        return INVALID_SOCKET;
+    }
+    *relay = sockaddr_in{};
+    relay->sin_family = AF_INET;
+    memcpy(&relay->sin_addr, reply + 4, 4);
+    memcpy(&relay->sin_port, reply + 8, 2);
+    return tcp;
+}
+
+enum class Scenario { Ip, Domain, SameTarget };
+
+static const char* ScenarioName(Scenario scenario) {
+    switch (scenario) {
+        case Scenario::Domain: return "domain";
+        case Scenario::SameTarget: return "same_target";
+        default: return "ip";
+    }
+}
+
+static std::string TargetHost(Scenario scenario, size_t i) {
+    switch (scenario) {
+        case Scenario::Domain: return "quic-" + std::to_string(i) + ".example.com";
+        case Scenario::SameTarget: return "198.18.0.1";
+        default: return "198.18." + std::to_string((i >> 8) & 0xFF) + "." + std::to_string(i & 0xFF);
+    }
+}
+
+struct RunResult {
+    int controlConnections = 0;
+    uint64_t datagrams = 0;
+    uint64_t lost = 0;
+    uint64_t misrouted = 0;
+    double seconds = 0;
+};
+
+// 每轮每个 socket 发 1 个数据报（目标端口 443，payload 首 4 字节为 socket 序号）并等待回显
+static void Drive(const std::vector<SOCKET>& socks, Scenario scenario, int rounds, int payloadBytes, RunResult* r) {
+    std::vector<std::vector<uint8_t>> packets(socks.size());
+    for (size_t i = 0; i < socks.size(); ++i) {
+        const std::string host = TargetHost(scenario, i);
+        uint8_t header[300];
+        const size_t headerLen = Network::Socks5::EncodeUdpHeader(host, 443, header, sizeof(header));
+        packets[i].assign(header, header + headerLen);
+        packets[i].resize(headerLen + (size_t)payloadBytes, 0xAB);
+        const uint32_t tag = (uint32_t)i;
+        memcpy(packets[i].data() + headerLen, &tag, sizeof(tag));
+    }
+    std::vector<uint8_t> buf(65535);
+    const auto start = std::chrono::steady_clock::now();
+    for (int round = 0; round < rounds; ++round) {
+        for (size_t i = 0; i < socks.size(); ++i) {
+            send(socks[i], (const char*)packets[i].data(), (int)packets[i].size(), 0);
+        }
+        for (size_t i = 0; i < socks.size(); ++i) {
+            const int n = recv(socks[i], (char*)buf.data(), (int)buf.size(), 0);
+            if (n <= 0) {
+                r->lost++;
+                continue;
+            }
+            Network::Socks5::UdpHeaderView view;
+            uint32_t tag = 0xFFFFFFFFu;
+            if (Network::Socks5::DecodeUdpHeader(buf.data(), (size_t)n, &view) && (size_t)n >= view.headerLen + 4) {
+                memcpy(&tag, buf.data() + view.headerLen, sizeof(tag));
+            }
+            if (tag != (uint32_t)i) r->misrouted++;
+            r->datagrams++;
+        }
+    }
+    r->seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+static SOCKET OpenAppSocket(const sockaddr* relay, int relayLen) {
+    SOCKET s = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+    if (s == INVALID_SOCKET) return INVALID_SOCKET;
+    SetRecvTimeout(s, 1000);
+    if (connect(s, relay, relayLen) != 0) {
+        closesocket(s);
+        return INVALID_SOCKET;
+    }
+    return s;
+}
+
+static bool RunPerSocket(int sockets, Scenario scenario, int rounds, int payloadBytes, RunResult* r) {
+    Socks5UdpStandIn proxy;
+    if (!proxy.Start()) return false;
+    std::vector<SOCKET> controls;
+    std::vector<SOCKET> apps;
+    for (int i = 0; i < sockets; ++i) {
+        sockaddr_in relay{};
+        SOCKET control = Associate(proxy.port, &relay);
+        if (control == INVALID_SOCKET) return false;
+        controls.push_back(control);
+        apps.push_back(OpenAppSocket((sockaddr*)&relay, sizeof(relay)));
+    }
+    r->controlConnections = proxy.controlConnections.load();
+    Drive(apps, scenario, rounds, payloadBytes, r);
+    for (SOCKET s : apps) closesocket(s);
+    for (SOCKET s : controls) closesocket(s);
+    proxy.Stop();
+    return true;
+}
+
+static bool RunMux(int sockets, Scenario scenario, int rounds, int payloadBytes, RunResult* r) {
+    Socks5UdpStandIn proxy;
+    if (!proxy.Start()) return false;
+    sockaddr_in relay{};
+    SOCKET control = Associate(proxy.port, &relay);
+    if (control == INVALID_SOCKET) return false;
+    auto mux = std::make_shared<UdpRelayMux>();
+    if (!mux->Start(control, (sockaddr*)&relay, sizeof(relay))) return false;
+    sockaddr_storage endpoint{};
+    int endpointLen = 0;
+    mux->GetLocalEndpoint(&endpoint, &endpointLen);
+    std::vector<SOCKET> apps;
+    for (int i = 0; i < sockets; ++i) {
+        apps.push_back(OpenAppSocket((sockaddr*)&endpoint, endpointLen));
+    }
+    r->controlConnections = proxy.controlConnections.load();
+    Drive(apps, scenario, rounds, payloadBytes, r);
+    for (SOCKET s : apps) closesocket(s);
+    const auto stats = mux->GetStats();
+    printf("  mux: up=%llu down=%llu unrouted=%llu dropped=%llu flows=%llu\n",
+           (unsigned long long)stats.upPackets, (unsigned long long)stats.downPackets,
+           (unsigned long long)stats.unrouted, (unsigned long long)stats.dropped,
+           (unsigned long long)stats.flows);
+    mux->Stop(2000);
+    proxy.Stop();
+    return true;
+}
+
+// 返回 false 表示存在丢包或错投
+static bool Report(const char* mode, Scenario scenario, const RunResult& r, int payloadBytes) {
+    const double pps = r.seconds > 0 ? (double)r.datagrams / r.seconds : 0;
+    const bool delivered = r.lost == 0 && r.misrouted == 0;
+    printf("%-10s %-11s control_conns=%-4d datagrams=%-8llu lost=%-5llu misrouted=%-5llu %.2fs  %.0f rt/s  %.1f MB/s  %s\n",
+           mode, ScenarioName(scenario), r.controlConnections, (unsigned long long)r.datagrams,
+           (unsigned long long)r.lost, (unsigned long long)r.misrouted, r.seconds, pps,
+           pps * payloadBytes * 2 / (1024.0 * 1024.0), delivered ? "ok" : "FAIL");
+    return delivered;
+}
+
+int main(int argc, char** argv) {
+#ifdef _WIN32
+    WSADATA wsa{};
+    if (WSAStartup(MAKEWORD(2, 2), &wsa) != 0) return 1;
+#endif
+    const int sockets = argc > 1 ? atoi(argv[1]) : 64;
+    const int rounds = argc > 2 ? atoi(argv[2]) : 2000;
+    const int payloadBytes = argc > 3 ? atoi(argv[3]) : 1200;
+    printf("sockets=%d rounds=%d payload=%dB\n", sockets, rounds, payloadBytes);
+
+    bool allDelivered = true;
+    const Scenario scenarios[] = {Scenario::Ip, Scenario::Domain, Scenario::SameTarget};
+    for (Scenario scenario : scenarios) {
+        RunResult perSocket;
+        if (!RunPerSocket(sockets, scenario, rounds, payloadBytes, &perSocket)) {
+            fprintf(stderr, "per_socket 运行失败\n");
+            return 1;
+        }
+        allDelivered = Report("per_socket", scenario, perSocket, payloadBytes) && allDelivered;
+
+        RunResult mux;
+        if (!RunMux(sockets, scenario, rounds, payloadBytes, &mux)) {
+            fprintf(stderr, "mux 运行失败\n");
+            return 1;
+        }
+        allDelivered = Report("mux", scenario, mux, payloadBytes) && allDelivered;
+    }
+#ifdef _WIN32
+    WSACleanup();
+#endif
+    return allDelivered ? 0 : 1;
+}
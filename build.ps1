@@ -19,6 +19,7 @@ param(
     
     [switch]$StaticRuntime,
     [switch]$DynamicRuntime,
+    [switch]$StripDebugLog,
     [switch]$Clean,
     [switch]$SkipTests,
     [switch]$Help
@@ -68,6 +69,7 @@ Antigravity-Proxy 编译脚本
     -Arch   <x64|x86>        目标架构 (默认: x64)
     -StaticRuntime           使用静态运行库 (/MT) (默认启用)
     -DynamicRuntime          使用动态运行库 (/MD)
+    -StripDebugLog           Release 构建中移除调试级别日志调用 (LOG_STRIP_DEBUG，log_level=debug 将不再输出)
     -Clean                   清理后重新编译
     -SkipTests               跳过测试步骤（当前脚本默认不执行自动测试，此参数用于 CI 显式声明）
     -Verbose                 输出详细构建日志（PowerShell 通用参数）
@@ -78,6 +80,7 @@ Antigravity-Proxy 编译脚本
     .\build.ps1 -Config Debug        # Debug x64 编译
     .\build.ps1 -Arch x86            # Release x86 编译
     .\build.ps1 -DynamicRuntime      # 使用动态运行库编译
+    .\build.ps1 -StripDebugLog       # 移除调试日志的 Release 编译
     .\build.ps1 -Clean -Config Debug # 清理后 Debug 编译
     .\build.ps1 -Verbose             # 显示详细编译输出
 "@
@@ -183,6 +186,11 @@ try {
     } else {
         $cmakeArgs += "-DSTATIC_RUNTIME=OFF"
     }
+    if ($StripDebugLog) {
+        $cmakeArgs += "-DLOG_STRIP_DEBUG=ON"
+    } else {
+        $cmakeArgs += "-DLOG_STRIP_DEBUG=OFF"
+    }
 
     $cmakeResult = & cmake @cmakeArgs 2>&1
     $cmakeFailed = ($LASTEXITCODE -ne 0)
@@ -0,0 +1,250 @@
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <utility>
+
+namespace Core {
+
+    // 有界多生产者单消费者日志环（Vyukov 序号环）
+    // 设计要点：
+    // - 生产者用一次 CAS 抢占写位置，随后移动整行字符串进槽位，不加锁、不做 I/O
+    // - 满时 TryPush 立即返回 false（不阻塞调用方），由上层决定丢弃还是短暂退让重试
+    // - 消费者只有一个（写线程或同步冲刷路径，由 AsyncLogWriter 的消费锁保证）
+    // 说明：本文件不依赖 Windows/Logger，可在非 Windows 平台独立测试。
+    template <size_t Capacity>
+    class LogRing {
+        static_assert(Capacity >= 2 && (Capacity & (Capacity - 1)) == 0, "容量必须为 2 的幂");
+
+    public:
+        LogRing() {
+            for (size_t i = 0; i < Capacity; ++i) m_cells[i].seq.store(i, std::memory_order_relaxed);
+        }
+
+        LogRing(const LogRing&) = delete;
+        LogRing& operator=(const LogRing&) = delete;
+
+        // 失败时 line 保持原样（调用方可降级为同步写入）
+        bool TryPush(std::string&& line) {
+            size_t pos = m_tail.load(std::memory_order_relaxed);
+            for (;;) {
+                Cell& cell = m_cells[pos & (Capacity - 1)];
+                const size_t seq = cell.seq.load(std::memory_order_acquire);
+                const intptr_t diff = (intptr_t)seq - (intptr_t)pos;
+                if (diff == 0) {
+                    if (m_tail.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                        cell.line = std::move(line);
+                        cell.seq.store(pos + 1, std::memory_order_release);
+                        return true;
+                    }
+                } else if (diff < 0) {
+                    return false; // 已满
+                } else {
+                    pos = m_tail.load(std::memory_order_relaxed);
+                }
+            }
+        }
+
+        // 仅限单消费者调用
+        bool TryPop(std::string* out) {
+            const size_t pos = m_head.load(std::memory_order_relaxed);
+            Cell& cell = m_cells[pos & (Capacity - 1)];
+            const size_t seq = cell.seq.load(std::memory_order_acquire);
+            if (seq != pos + 1) return false;
+            m_head.store(pos + 1, std::memory_order_relaxed);
+            if (out) out->swap(cell.line);
+            cell.line.clear(); // 保留容量：槽位字符串在下一轮复用
+            cell.seq.store(pos + Capacity, std::memory_order_release);
+            return true;
+        }
+
+        bool Empty() const {
+            const size_t pos = m_head.load(std::memory_order_relaxed);
+            return m_cells[pos & (Capacity - 1)].seq.load(std::memory_order_acquire) != pos + 1;
+        }
+
+        static constexpr size_t kCapacity = Capacity;
+
+    private:
+        struct Cell {
+            std::atomic<size_t> seq{0};
+            std::string line;
+        };
+
+        alignas(64) std::atomic<size_t> m_tail{0};
+        alignas(64) std::atomic<size_t> m_head{0};
+        Cell m_cells[Capacity];
+    };
+
+    // 异步日志写入器：调用方线程只负责入队，专用写线程批量取出并交给 sink 一次写出
+    // 使用方式：BeginAccepting() 后在任意线程调用 RunWriterLoop()（Logger 用 CreateThread，测试用 std::thread）
+    // 丢弃/背压策略：
+    // - 普通行：队列满即丢弃并计数（绝不阻塞 connect 等热路径）
+    // - 重要行（警告/错误）：先退让重试最多 kHighPriorityWaitUs 微秒，仍满才丢弃
+    // - 丢弃数量随下一批一起交给 sink（由 sink 写一条汇总行），不会静默丢失
+    // 停止/冲刷：
+    // - RequestStop() 后不再接受新行（Submit 返回 NotRunning，调用方改走同步写入）
+    // - 写线程退出前会取空队列；WaitStopped() 可限时等待写线程退出循环
+    // - Drain() 在调用方线程同步取空队列（崩溃/卸载路径），消费锁限时获取，写线程已被终止也不会死锁
+    template <size_t Capacity = 4096>
+    class AsyncLogWriter {
+    public:
+        // batch：以 '\n' 结尾的若干行（或拼接的二进制记录）；droppedSinceLast：自上一批以来丢弃的行数
+        using Sink = std::function<void(const std::string& batch, uint64_t droppedSinceLast)>;
+
+        enum class SubmitResult {
+            Queued,
+            Dropped,
+            NotRunning,
+        };
+
+        static constexpr size_t kMaxBatchBytes = 64 * 1024;
+        static constexpr uint32_t kIdleWaitMs = 50;
+        static constexpr uint32_t kHighPriorityWaitUs = 2000;
+
+        // lineTerminated=false：条目为自带长度前缀的二进制记录，批内直接拼接不追加 '\n'
+        explicit AsyncLogWriter(Sink sink, bool lineTerminated = true)
+            : m_sink(std::move(sink)), m_lineTerminated(lineTerminated) {}
+
+        AsyncLogWriter(const AsyncLogWriter&) = delete;
+        AsyncLogWriter& operator=(const AsyncLogWriter&) = delete;
+
+        void BeginAccepting() {
+            m_stopRequested.store(false, std::memory_order_relaxed);
+            m_loopExited.store(false, std::memory_order_relaxed);
+            m_accepting.store(true, std::memory_order_release);
+        }
+
+        bool IsAccepting() const { return m_accepting.load(std::memory_order_acquire); }
+
+        // 返回 NotRunning 时 line 未被移动，调用方可直接同步写入
+        SubmitResult Submit(std::string&& line, bool important) {
+            if (!m_accepting.load(std::memory_order_acquire)) return SubmitResult::NotRunning;
+            bool queued = m_ring.TryPush(std::move(line));
+            if (!queued && important) {
+                WakeWriter();
+                const auto deadline = std::chrono::steady_clock::now() +
+                                      std::chrono::microseconds(kHighPriorityWaitUs);
+                while (!queued && std::chrono::steady_clock::now() < deadline) {
+                    std::this_thread::yield();
+                    queued = m_ring.TryPush(std::move(line));
+                }
+            }
+            if (!queued) {
+                m_dropped.fetch_add(1, std::memory_order_relaxed);
+                return SubmitResult::Dropped;
+            }
+            m_enqueued.fetch_add(1, std::memory_order_relaxed);
+            // 与写线程“置 sleeping → 检查队列”配对的全屏障：两者至少一方能看到对方
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            if (m_sleeping.load(std::memory_order_relaxed)) WakeWriter();
+            return SubmitResult::Queued;
+        }
+
+        // 写线程主循环：直到 RequestStop() 且队列取空后返回
+        void RunWriterLoop() {
+            for (;;) {
+                if (ConsumeBatch(std::chrono::steady_clock::time_point::max())) continue;
+                if (m_stopRequested.load(std::memory_order_acquire)) break;
+
+                std::unique_lock<std::mutex> lock(m_wakeMtx);
+                m_sleeping.store(true, std::memory_order_relaxed);
+                std::atomic_thread_fence(std::memory_order_seq_cst);
+                m_cv.wait_for(lock, std::chrono::milliseconds(kIdleWaitMs), [this]() {
+                    return m_stopRequested.load(std::memory_order_acquire) || !m_ring.Empty();
+                });
+                m_sleeping.store(false, std::memory_order_relaxed);
+            }
+            {
+                std::lock_guard<std::mutex> lock(m_wakeMtx);
+                m_loopExited.store(true, std::memory_order_release);
+                m_cv.notify_all();
+            }
+        }
+
+        void RequestStop() {
+            m_accepting.store(false, std::memory_order_release);
+            std::lock_guard<std::mutex> lock(m_wakeMtx);
+            m_stopRequested.store(true, std::memory_order_release);
+            m_cv.notify_all();
+        }
+
+        // 限时等待写线程退出循环（不 join：DllMain 中等待线程句柄会因加载器锁死锁）
+        bool WaitStopped(uint32_t timeoutMs) {
+            std::unique_lock<std::mutex> lock(m_wakeMtx);
+            return m_cv.wait_for(lock, std::chrono::milliseconds(timeoutMs), [this]() {
+                return m_loopExited.load(std::memory_order_acquire);
+            });
+        }
+
+        // 在调用方线程同步取空队列；消费锁在 timeoutMs 内拿不到则放弃（返回 false）
+        bool Drain(uint32_t timeoutMs) {
+            const auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeoutMs);
+            while (ConsumeBatch(deadline)) {
+            }
+            return m_ring.Empty();
+        }
+
+        uint64_t Enqueued() const { return m_enqueued.load(std::memory_order_relaxed); }
+        uint64_t Dropped() const { return m_dropped.load(std::memory_order_relaxed); }
+        uint64_t Written() const { return m_written.load(std::memory_order_relaxed); }
+
+    private:
+        void WakeWriter() {
+            if (!m_sleeping.load(std::memory_order_relaxed)) return;
+            { std::lock_guard<std::mutex> lock(m_wakeMtx); }
+            m_cv.notify_one();
+        }
+
+        // 取出一批并交给 sink；返回是否写出了内容（含仅有丢弃汇总的情况）
+        bool ConsumeBatch(std::chrono::steady_clock::time_point lockDeadline) {
+            std::unique_lock<std::mutex> lock(m_consumerMtx, std::defer_lock);
+            while (!lock.try_lock()) {
+                if (std::chrono::steady_clock::now() >= lockDeadline) return false;
+                std::this_thread::yield();
+            }
+
+            m_batch.clear();
+            uint64_t lines = 0;
+            while (m_batch.size() < kMaxBatchBytes && m_ring.TryPop(&m_line)) {
+                m_batch.append(m_line);
+                if (m_lineTerminated) m_batch.push_back('\n');
+                ++lines;
+            }
+            const uint64_t dropped = m_dropped.load(std::memory_order_relaxed);
+            const uint64_t droppedSinceLast = dropped - m_reportedDropped;
+            if (lines == 0 && droppedSinceLast == 0) return false;
+            m_reportedDropped = dropped;
+            if (m_sink) m_sink(m_batch, droppedSinceLast);
+            m_written.fetch_add(lines, std::memory_order_relaxed);
+            return true;
+        }
+
+        LogRing<Capacity> m_ring;
+        Sink m_sink;
+        bool m_lineTerminated = true;
+
+        std::atomic<bool> m_accepting{false};
+        std::atomic<bool> m_stopRequested{false};
+        std::atomic<bool> m_loopExited{false};
+        std::atomic<bool> m_sleeping{false};
+        std::mutex m_wakeMtx;
+        std::condition_variable m_cv;
+
+        std::mutex m_consumerMtx; // 保护以下消费侧状态
+        std::string m_batch;
+        std::string m_line;
+        uint64_t m_reportedDropped = 0;
+
+        std::atomic<uint64_t> m_enqueued{0};
+        std::atomic<uint64_t> m_dropped{0};
+        std::atomic<uint64_t> m_written{0};
+    };
+
+} // namespace Core
@@ -0,0 +1,39 @@
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <string_view>
+
+namespace Core {
+
+    // 定长字符串：按 8 字节打包进原子字，超长截断，末尾至少保留一个 0
+    // 每个字单独原子读写：与序号锁配合使用时，读方可以在不加锁的情况下拷出一致的内容（数据竞争检测也不会误报）
+    template <size_t Bytes>
+    struct AtomicText {
+        static_assert(Bytes % 8 == 0 && Bytes >= 8, "长度必须为 8 的倍数");
+        std::atomic<uint64_t> words[Bytes / 8];
+
+        void Store(std::string_view s) {
+            char buf[Bytes] = {};
+            if (!s.empty()) memcpy(buf, s.data(), std::min(s.size(), Bytes - 1));
+            for (size_t i = 0; i < Bytes / 8; ++i) {
+                uint64_t w;
+                memcpy(&w, buf + i * 8, 8);
+                words[i].store(w, std::memory_order_relaxed);
+            }
+        }
+
+        std::string Load() const {
+            char buf[Bytes];
+            for (size_t i = 0; i < Bytes / 8; ++i) {
+                const uint64_t w = words[i].load(std::memory_order_relaxed);
+                memcpy(buf + i * 8, &w, 8);
+            }
+            buf[Bytes - 1] = 0;
+            return std::string(buf, strnlen(buf, Bytes));
+        }
+    };
+}
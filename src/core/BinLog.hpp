@@ -0,0 +1,582 @@
+#pragma once
+#include <array>
+#include <charconv>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+#include <deque>
+#include <mutex>
+#include <shared_mutex>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "LogEvents.hpp"
+
+namespace Core {
+
+    // ========== 结构化日志参数 ==========
+
+    // 主机名（二进制模式下驻留为字符串 ID，同一主机名只写一次正文）
+    struct LogHost {
+        explicit LogHost(const std::string& s) : value(s) {}
+        std::string_view value;
+    };
+
+    // 原始地址（调用方从 sockaddr 直接拷贝字节，渲染推迟到输出时）
+    // family：4=IPv4，6=IPv6，0=未知（渲染为“(未知)”）；port 为主机字节序
+    struct LogAddr {
+        uint8_t family = 0;
+        uint16_t port = 0;
+        uint8_t bytes[16] = {};
+    };
+
+    struct LogArg {
+        enum class Type : uint8_t {
+            None = 0,
+            U64 = 1,
+            I64 = 2,
+            Str = 3,
+            StrRef = 4,
+            Addr = 5,
+        };
+        Type type = Type::None;
+        uint64_t u = 0;
+        int64_t i = 0;
+        std::string_view s;
+        LogAddr addr;
+    };
+
+    template <typename T, typename std::enable_if<std::is_integral<T>::value && std::is_unsigned<T>::value, int>::type = 0>
+    inline LogArg MakeLogArg(T v) {
+        LogArg a;
+        a.type = LogArg::Type::U64;
+        a.u = (uint64_t)v;
+        return a;
+    }
+
+    template <typename T, typename std::enable_if<std::is_integral<T>::value && std::is_signed<T>::value, int>::type = 0>
+    inline LogArg MakeLogArg(T v) {
+        LogArg a;
+        a.type = LogArg::Type::I64;
+        a.i = (int64_t)v;
+        return a;
+    }
+
+    // 指针按十进制地址记录（与原先 std::to_string((ULONG_PTR)p) 的输出一致）
+    template <typename T>
+    inline LogArg MakeLogArg(T* p) {
+        return MakeLogArg((uint64_t)(uintptr_t)p);
+    }
+
+    inline LogArg MakeLogArg(std::string_view v) {
+        LogArg a;
+        a.type = LogArg::Type::Str;
+        a.s = v;
+        return a;
+    }
+
+    inline LogArg MakeLogArg(const char* v) { return MakeLogArg(std::string_view(v ? v : "")); }
+    inline LogArg MakeLogArg(const std::string& v) { return MakeLogArg(std::string_view(v)); }
+
+    inline LogArg MakeLogArg(const LogHost& v) {
+        LogArg a;
+        a.type = LogArg::Type::StrRef;
+        a.s = v.value;
+        return a;
+    }
+
+    inline LogArg MakeLogArg(const LogAddr& v) {
+        LogArg a;
+        a.type = LogArg::Type::Addr;
+        a.addr = v;
+        return a;
+    }
+
+    template <typename... Args>
+    inline std::array<LogArg, sizeof...(Args)> MakeLogArgs(const Args&... args) {
+        return {{MakeLogArg(args)...}};
+    }
+
+    // ========== 文本渲染（文本模式的调用方线程与离线解码共用） ==========
+
+    inline void AppendLogAddr(std::string& out, const LogAddr& a) {
+        char buf[64];
+        if (a.family == 4) {
+            snprintf(buf, sizeof(buf), "%u.%u.%u.%u:%u", a.bytes[0], a.bytes[1], a.bytes[2], a.bytes[3], (unsigned)a.port);
+            out += buf;
+            return;
+        }
+        if (a.family != 6) {
+            out += "(未知)";
+            return;
+        }
+        // IPv6：按 RFC 5952 压缩最长的连续零组（至少 2 组），v4-mapped 以点分十进制结尾
+        uint16_t groups[8];
+        for (int g = 0; g < 8; ++g) groups[g] = (uint16_t)((a.bytes[g * 2] << 8) | a.bytes[g * 2 + 1]);
+        const bool v4Mapped = groups[0] == 0 && groups[1] == 0 && groups[2] == 0 && groups[3] == 0 &&
+                              groups[4] == 0 && groups[5] == 0xFFFF;
+        if (v4Mapped) {
+            snprintf(buf, sizeof(buf), "::ffff:%u.%u.%u.%u:%u", a.bytes[12], a.bytes[13], a.bytes[14], a.bytes[15],
+                     (unsigned)a.port);
+            out += buf;
+            return;
+        }
+        int bestStart = -1, bestLen = 0;
+        for (int g = 0; g < 8;) {
+            if (groups[g] != 0) {
+                ++g;
+                continue;
+            }
+            int end = g;
+            while (end < 8 && groups[end] == 0) ++end;
+            if (end - g > bestLen) {
+                bestStart = g;
+                bestLen = end - g;
+            }
+            g = end;
+        }
+        if (bestLen < 2) bestStart = -1;
+        for (int g = 0; g < 8; ++g) {
+            if (g == bestStart) {
+                out += "::";
+                g += bestLen - 1;
+                continue;
+            }
+            if (g > 0 && g != bestStart + bestLen) out.push_back(':');
+            snprintf(buf, sizeof(buf), "%x", (unsigned)groups[g]);
+            out += buf;
+        }
+        snprintf(buf, sizeof(buf), ":%u", (unsigned)a.port);
+        out += buf;
+    }
+
+    inline void AppendLogArg(std::string& out, const LogArg& a) {
+        char buf[32];
+        switch (a.type) {
+            case LogArg::Type::U64: {
+                auto r = std::to_chars(buf, buf + sizeof(buf), a.u);
+                out.append(buf, r.ptr);
+                return;
+            }
+            case LogArg::Type::I64: {
+                auto r = std::to_chars(buf, buf + sizeof(buf), a.i);
+                out.append(buf, r.ptr);
+                return;
+            }
+            case LogArg::Type::Str:
+            case LogArg::Type::StrRef:
+                out.append(a.s.data(), a.s.size());
+                return;
+            case LogArg::Type::Addr:
+                AppendLogAddr(out, a.addr);
+                return;
+            case LogArg::Type::None:
+                return;
+        }
+    }
+
+    // 按 {} 顺序替换参数；参数不足时保留 {}，多余参数忽略
+    inline void FormatLogEvent(std::string& out, const char* format, const LogArg* args, size_t count) {
+        size_t next = 0;
+        for (const char* p = format; *p; ++p) {
+            if (p[0] == '{' && p[1] == '}' && next < count) {
+                AppendLogArg(out, args[next++]);
+                ++p;
+                continue;
+            }
+            out.push_back(*p);
+        }
+    }
+
+    // ========== 字符串驻留 ==========
+    // 主机名等高重复字符串只在首次出现时写出正文（字符串定义记录），之后事件只记录 ID
+    // 上限 kMaxEntries 条；超限或过长的字符串改为内联写出，保证不会无限增长
+    class StringInterner {
+    public:
+        static constexpr size_t kMaxEntries = 4096;
+        static constexpr size_t kMaxLength = 255;
+
+        // 返回 0 表示不驻留（调用方内联写出）；*isNew 为 true 时调用方负责写出定义记录
+        uint32_t Intern(std::string_view s, bool* isNew) {
+            if (isNew) *isNew = false;
+            if (s.empty() || s.size() > kMaxLength) return 0;
+            {
+                std::shared_lock<std::shared_mutex> lock(m_mtx);
+                auto it = m_ids.find(s);
+                if (it != m_ids.end()) return it->second;
+                if (m_storage.size() >= kMaxEntries) return 0;
+            }
+            std::unique_lock<std::shared_mutex> lock(m_mtx);
+            auto it = m_ids.find(s);
+            if (it != m_ids.end()) return it->second;
+            if (m_storage.size() >= kMaxEntries) return 0;
+            m_storage.emplace_back(s);
+            const uint32_t id = (uint32_t)m_storage.size();
+            m_ids.emplace(std::string_view(m_storage.back()), id);
+            if (isNew) *isNew = true;
+            return id;
+        }
+
+        // 新文件开头需要重写全部定义（文件截断/跨天后旧定义不可见）
+        std::vector<std::pair<uint32_t, std::string>> Snapshot() const {
+            std::shared_lock<std::shared_mutex> lock(m_mtx);
+            std::vector<std::pair<uint32_t, std::string>> out;
+            out.reserve(m_storage.size());
+            uint32_t id = 0;
+            for (const auto& s : m_storage) out.emplace_back(++id, s);
+            return out;
+        }
+
+        size_t Size() const {
+            std::shared_lock<std::shared_mutex> lock(m_mtx);
+            return m_storage.size();
+        }
+
+    private:
+        mutable std::shared_mutex m_mtx;
+        std::deque<std::string> m_storage; // deque：追加不搬移已有元素，m_ids 的 string_view 保持有效
+        std::unordered_map<std::string_view, uint32_t> m_ids;
+    };
+
+    // ========== 二进制日志格式 ==========
+    // 文件 = 若干会话；会话 = 8 字节魔数 + 记录序列
+    // 记录 = varint(正文长度) + 正文；正文首字节为记录类型：
+    // - Catalog：varint 事件ID, u8 等级, str 格式串, str 事件名（会话开头写出完整目录）
+    // - String ：varint 字符串ID, str 正文
+    // - Event  ：varint 事件ID, u8 等级, varint 时间戳(微秒, Unix 纪元), varint PID, varint TID, u8 参数个数, 参数...
+    // 参数 = u8 类型 + 值：U64 varint / I64 zigzag varint / Str str / StrRef varint ID / Addr u8 family + varint port + 4|16 字节
+    // 其中 str = varint 长度 + 字节
+    namespace BinLog {
+        static constexpr char kMagic[8] = {'A', 'G', 'P', 'B', 'L', 'O', 'G', '1'};
+
+        enum RecordType : uint8_t {
+            kRecordCatalog = 1,
+            kRecordString = 2,
+            kRecordEvent = 3,
+        };
+
+        inline void PutVarint(std::string& out, uint64_t v) {
+            while (v >= 0x80) {
+                out.push_back((char)(uint8_t)(v | 0x80));
+                v >>= 7;
+            }
+            out.push_back((char)(uint8_t)v);
+        }
+
+        inline bool GetVarint(const uint8_t*& p, const uint8_t* end, uint64_t* v) {
+            uint64_t result = 0;
+            for (int shift = 0; shift < 64 && p < end; shift += 7) {
+                const uint8_t b = *p++;
+                result |= (uint64_t)(b & 0x7F) << shift;
+                if (!(b & 0x80)) {
+                    *v = result;
+                    return true;
+                }
+            }
+            return false;
+        }
+
+        inline void PutStr(std::string& out, std::string_view s) {
+            PutVarint(out, s.size());
+            out.append(s.data(), s.size());
+        }
+
+        // 在 start 处补上正文长度前缀（正文已追加在 out 末尾）
+        inline void FinishRecord(std::string& out, size_t start) {
+            char prefix[10];
+            size_t n = 0;
+            uint64_t len = out.size() - start;
+            while (len >= 0x80) {
+                prefix[n++] = (char)(uint8_t)(len | 0x80);
+                len >>= 7;
+            }
+            prefix[n++] = (char)(uint8_t)len;
+            out.insert(start, prefix, n);
+        }
+
+        inline void AppendStringRecord(std::string& out, uint32_t id, std::string_view s) {
+            const size_t start = out.size();
+            out.push_back((char)kRecordString);
+            PutVarint(out, id);
+            PutStr(out, s);
+            FinishRecord(out, start);
+        }
+
+        // 会话头：魔数 + 完整事件目录 + 已驻留字符串
+        inline void AppendSessionHeader(std::string& out, const StringInterner* interner) {
+            out.append(kMagic, sizeof(kMagic));
+            for (size_t id = 0; id < (size_t)LogEvent::Count; ++id) {
+                const LogEventInfo& info = LogEventTable()[id];
+                const size_t start = out.size();
+                out.push_back((char)kRecordCatalog);
+                PutVarint(out, id);
+                out.push_back((char)(uint8_t)info.level);
+                PutStr(out, info.format);
+                PutStr(out, info.name);
+                FinishRecord(out, start);
+            }
+            if (interner) {
+                for (const auto& kv : interner->Snapshot()) AppendStringRecord(out, kv.first, kv.second);
+            }
+        }
+
+        // 编码一条事件；新驻留的字符串先写出定义记录。返回是否写出了定义（调用方应按重要行入队，避免定义被丢弃）
+        inline bool AppendEventRecord(std::string& out, StringInterner* interner, LogEvent ev, LogLevel level,
+                                      uint64_t tsUs, uint32_t pid, uint32_t tid, const LogArg* args, size_t count) {
+            bool defined = false;
+            uint32_t refIds[16] = {};
+            if (count > 16) count = 16;
+            for (size_t i = 0; i < count; ++i) {
+                if (args[i].type != LogArg::Type::StrRef || !interner) continue;
+                bool isNew = false;
+                refIds[i] = interner->Intern(args[i].s, &isNew);
+                if (isNew) {
+                    AppendStringRecord(out, refIds[i], args[i].s);
+                    defined = true;
+                }
+            }
+
+            const size_t start = out.size();
+            out.push_back((char)kRecordEvent);
+            PutVarint(out, (uint64_t)ev);
+            out.push_back((char)(uint8_t)level);
+            PutVarint(out, tsUs);
+            PutVarint(out, pid);
+            PutVarint(out, tid);
+            out.push_back((char)(uint8_t)count);
+            for (size_t i = 0; i < count; ++i) {
+                const LogArg& a = args[i];
+                LogArg::Type type = a.type;
+                if (type == LogArg::Type::StrRef && refIds[i] == 0) type = LogArg::Type::Str;
+                out.push_back((char)type);
+                switch (type) {
+                    case LogArg::Type::U64: PutVarint(out, a.u); break;
+                    case LogArg::Type::I64: PutVarint(out, ((uint64_t)a.i << 1) ^ (uint64_t)(a.i >> 63)); break;
+                    case LogArg::Type::Str: PutStr(out, a.s); break;
+                    case LogArg::Type::StrRef: PutVarint(out, refIds[i]); break;
+                    case LogArg::Type::Addr:
+                        out.push_back((char)a.addr.family);
+                        PutVarint(out, a.addr.port);
+                        if (a.addr.family == 4) out.append((const char*)a.addr.bytes, 4);
+                        if (a.addr.family == 6) out.append((const char*)a.addr.bytes, 16);
+                        break;
+                    case LogArg::Type::None: break;
+                }
+            }
+            FinishRecord(out, start);
+            return defined;
+        }
+
+        // 本地时间 "YYYY-MM-DD HH:MM:SS"（与文本日志的时间戳格式一致）
+        inline std::string FormatTimestamp(uint64_t tsUs) {
+            const std::time_t t = (std::time_t)(tsUs / 1000000);
+            struct tm tm {};
+        #ifdef _WIN32
+            localtime_s(&tm, &t);
+        #else
+            localtime_r(&t, &tm);
+        #endif
+            char buf[80];
+            snprintf(buf, sizeof(buf), "%04d-%02d-%02d %02d:%02d:%02d", tm.tm_year + 1900, tm.tm_mon + 1, tm.tm_mday,
+                     tm.tm_hour, tm.tm_min, tm.tm_sec);
+            return std::string(buf);
+        }
+
+        struct DecodedEvent {
+            uint16_t id = 0;
+            LogLevel level = LogLevel::Info;
+            uint64_t tsUs = 0;
+            uint32_t pid = 0;
+            uint32_t tid = 0;
+            std::vector<LogArg> args; // Str 指向输入缓冲区；StrRef 在渲染时按会话字符串表解析
+            uint64_t refIds[16] = {};
+        };
+
+        struct DecodeStats {
+            size_t sessions = 0;
+            size_t events = 0;
+            size_t strings = 0;
+            size_t unknownRecords = 0;
+            size_t trailingBytes = 0; // 末尾不完整的记录（写入中途进程被终止）
+        };
+
+        // 离线解码器：逐会话解析，会话结束时按原始顺序渲染文本行
+        // 说明：多线程写入时字符串定义可能晚于引用它的事件入队，因此先收集整个会话再渲染
+        class Reader {
+        public:
+            struct CatalogEntry {
+                LogLevel level = LogLevel::Info;
+                std::string format;
+                std::string name;
+            };
+
+            // onLine(const std::string& line, const DecodedEvent& ev)
+            template <typename Fn>
+            DecodeStats Decode(const uint8_t* data, size_t size, Fn&& onLine) {
+                DecodeStats stats;
+                const uint8_t* p = data;
+                const uint8_t* end = data + size;
+                bool inSession = false;
+                while (p < end) {
+                    if ((size_t)(end - p) >= sizeof(kMagic) && memcmp(p, kMagic, sizeof(kMagic)) == 0) {
+                        if (inSession) Flush(onLine);
+                        ResetSession();
+                        inSession = true;
+                        ++stats.sessions;
+                        p += sizeof(kMagic);
+                        continue;
+                    }
+                    const uint8_t* recStart = p;
+                    uint64_t len = 0;
+                    if (!GetVarint(p, end, &len) || len == 0 || len > (uint64_t)(end - p)) {
+                        stats.trailingBytes = (size_t)(end - recStart);
+                        break;
+                    }
+                    const uint8_t* body = p;
+                    const uint8_t* bodyEnd = p + len;
+                    p = bodyEnd;
+                    if (!inSession) {
+                        ++stats.unknownRecords;
+                        continue;
+                    }
+                    if (!ParseRecord(body, bodyEnd, &stats)) ++stats.unknownRecords;
+                }
+                if (inSession) Flush(onLine);
+                return stats;
+            }
+
+            std::string Render(const DecodedEvent& ev) const {
+                std::string line;
+                line.reserve(128);
+                line += "[" + FormatTimestamp(ev.tsUs) + "] [PID:" + std::to_string(ev.pid) +
+                        "][TID:" + std::to_string(ev.tid) + "] ";
+                line += LogLevelTag(ev.level);
+                line.push_back(' ');
+
+                std::vector<LogArg> args = ev.args;
+                for (size_t i = 0; i < args.size() && i < 16; ++i) {
+                    if (args[i].type != LogArg::Type::StrRef) continue;
+                    auto it = m_strings.find(ev.refIds[i]);
+                    args[i].s = it != m_strings.end() ? std::string_view(it->second) : std::string_view("<str#?>");
+                }
+                auto cat = m_catalog.find(ev.id);
+                if (cat != m_catalog.end()) {
+                    FormatLogEvent(line, cat->second.format.c_str(), args.data(), args.size());
+                } else {
+                    line += "<event#" + std::to_string(ev.id) + ">";
+                    for (const auto& a : args) {
+                        line.push_back(' ');
+                        AppendLogArg(line, a);
+                    }
+                }
+                return line;
+            }
+
+        private:
+            void ResetSession() {
+                m_catalog.clear();
+                m_strings.clear();
+                m_events.clear();
+            }
+
+            template <typename Fn>
+            void Flush(Fn& onLine) {
+                for (const auto& ev : m_events) onLine(Render(ev), ev);
+                m_events.clear();
+            }
+
+            bool ParseRecord(const uint8_t* p, const uint8_t* end, DecodeStats* stats) {
+                const uint8_t type = *p++;
+                uint64_t v = 0;
+                auto getStr = [&](std::string_view* out) {
+                    uint64_t n = 0;
+                    if (!GetVarint(p, end, &n) || n > (uint64_t)(end - p)) return false;
+                    *out = std::string_view((const char*)p, (size_t)n);
+                    p += n;
+                    return true;
+                };
+                if (type == kRecordCatalog) {
+                    std::string_view fmt, name;
+                    if (!GetVarint(p, end, &v) || p >= end) return false;
+                    CatalogEntry entry;
+                    entry.level = (LogLevel)*p++;
+                    if (!getStr(&fmt) || !getStr(&name)) return false;
+                    entry.format.assign(fmt.data(), fmt.size());
+                    entry.name.assign(name.data(), name.size());
+                    m_catalog[(uint16_t)v] = std::move(entry);
+                    return true;
+                }
+                if (type == kRecordString) {
+                    std::string_view s;
+                    if (!GetVarint(p, end, &v) || !getStr(&s)) return false;
+                    m_strings[v] = std::string(s);
+                    ++stats->strings;
+                    return true;
+                }
+                if (type != kRecordEvent) return false;
+
+                DecodedEvent ev;
+                uint64_t ts = 0, pid = 0, tid = 0;
+                if (!GetVarint(p, end, &v) || p >= end) return false;
+                ev.id = (uint16_t)v;
+                ev.level = (LogLevel)*p++;
+                if (!GetVarint(p, end, &ts) || !GetVarint(p, end, &pid) || !GetVarint(p, end, &tid) || p >= end) {
+                    return false;
+                }
+                ev.tsUs = ts;
+                ev.pid = (uint32_t)pid;
+                ev.tid = (uint32_t)tid;
+                const size_t count = *p++;
+                for (size_t i = 0; i < count; ++i) {
+                    if (p >= end) return false;
+                    LogArg a;
+                    a.type = (LogArg::Type)*p++;
+                    switch (a.type) {
+                        case LogArg::Type::U64:
+                            if (!GetVarint(p, end, &a.u)) return false;
+                            break;
+                        case LogArg::Type::I64:
+                            if (!GetVarint(p, end, &v)) return false;
+                            a.i = (int64_t)(v >> 1) ^ -(int64_t)(v & 1);
+                            break;
+                        case LogArg::Type::Str:
+                            if (!getStr(&a.s)) return false;
+                            break;
+                        case LogArg::Type::StrRef:
+                            if (!GetVarint(p, end, &v)) return false;
+                            if (i < 16) ev.refIds[i] = v;
+                            break;
+                        case LogArg::Type::Addr: {
+                            if (p >= end) return false;
+                            a.addr.family = *p++;
+                            if (!GetVarint(p, end, &v)) return false;
+                            a.addr.port = (uint16_t)v;
+                            const size_t n = a.addr.family == 4 ? 4 : (a.addr.family == 6 ? 16 : 0);
+                            if ((size_t)(end - p) < n) return false;
+                            memcpy(a.addr.bytes, p, n);
+                            p += n;
+                            break;
+                        }
+                        default:
+                            return false;
+                    }
+                    ev.args.push_back(a);
+                }
+                m_events.push_back(std::move(ev));
+                ++stats->events;
+                return true;
+            }
+
+            std::unordered_map<uint16_t, CatalogEntry> m_catalog;
+            std::unordered_map<uint64_t, std::string> m_strings;
+            std::vector<DecodedEvent> m_events;
+        };
+    } // namespace BinLog
+
+} // namespace Core
@@ -13,6 +13,7 @@
 #include <string_view>
 #include <utility>
 #include "Logger.hpp"
+#include "RuntimePolicy.hpp"
 
 namespace Core {
     struct ProxyConfig {
@@ -31,6 +32,44 @@ namespace Core {
         int connect_ms = 5000;
         int send_ms = 5000;
         int recv_ms = 5000;
+        // 自适应超时：按上游代理实测往返时间（SRTT + 4*RTTVAR）缩短连接代理与 SOCKS5 认证协商的超时，上述固定值作为上限；
+        // CONNECT 应答含代理连接目标的时间，不收紧。默认关闭：需按部署确认代理往返稳定后再开启
+        bool adaptive = false;
+        int adaptive_min_ms = 200; // 自适应超时下限
+    };
+
+    // ============= 上游代理熔断配置 =============
+    // 连续 failure_threshold 次连接/握手失败后熔断 cooldown_ms，期间按 open_action 快速失败或直连
+    struct CircuitBreakerConfig {
+        bool enabled = true;
+        int failure_threshold = 5;
+        int cooldown_ms = 10000;
+        int half_open_probes = 1;
+        std::string open_action = "fail"; // fail/direct
+    };
+
+    // 抓包（pcapng）：默认关闭；开启后按流采样隧道内负载，写入日志目录下的 .pcapng
+    struct CaptureConfig {
+        bool enabled = false;
+        int sample_every = 1;  // 每 N 个流采样 1 个
+        int snaplen = 256;     // 每次收发最多保存的负载字节数
+        int max_file_mb = 64;  // 单文件上限，达到后截断重写
+    };
+
+    // 指标端点（Prometheus 文本格式）：默认关闭；开启后在 127.0.0.1 上监听，每个被注入的进程各占一个端口
+    struct MetricsConfig {
+        bool enabled = false;
+        int port = 9464;       // 起始端口；被占用时依次尝试后续端口，0=由系统分配（端口写入日志）
+        int port_range = 16;   // 最多尝试的端口数
+        bool shared_memory = false;     // 发布到跨进程共享统计段（agtop 查看）；与 enabled 相互独立
+        int publish_interval_ms = 1000; // 共享统计段发布间隔
+    };
+
+    // 连接生命周期耗时追踪：默认开启（只统计阶段耗时直方图，代价为每个代理连接几次原子操作）；
+    // sample_every>0 时另按 1/N 保留完整时间线，退出时写入日志目录下的 .trace.json（Chrome trace 格式）
+    struct LatencyTraceConfig {
+        bool enabled = true;
+        int sample_every = 0;
     };
 
     // ============= 路由规则配置（支持 IP/CIDR/域名通配符/端口/协议） =============
@@ -46,12 +85,20 @@ namespace Core {
         std::vector<std::string> protocols; // tcp
     };
 
+    // default_action=learn：未命中规则的域名走代理并探测直连，之后的连接按学习到的域名偏好选路
+    struct RouteLearnConfig {
+        int half_life_hours = 24; // 偏好分数半衰期（约 1~2 个半衰期后重新探测验证）
+        int max_entries = 4096;   // 偏好表条目上限
+        bool persist = true;      // 后台线程定期合并写入日志目录下的 route-prefs.txt，首次按偏好选路时读回
+    };
+
     struct RoutingConfig {
         bool enabled = true;
         std::string priority_mode = "order"; // order/number
-        std::string default_action = "proxy";
+        std::string default_action = "proxy"; // proxy/direct/learn
         bool use_default_private = true;
         std::vector<RoutingRule> rules;
+        RouteLearnConfig learn;
     };
 
     // ============= 代理路由规则 =============
@@ -83,6 +130,16 @@ namespace Core {
         // "direct" - 失败回退直连（风险更高，但可用于“代理不支持 UDP”时的兼容模式）
         std::string udp_fallback = "block";
 
+        // UDP Associate 预热池（仅 udp_mode=proxy 且 proxy.type=socks5 时生效）
+        // 后台维持若干已完成 UDP Associate 的控制连接，新 UDP socket 领取后无需再等待 connect + 握手
+        int udp_pool_size = 2;            // 0=禁用
+        int udp_pool_max_idle_ms = 30000; // 会话空闲超过该时长则丢弃重建（代理端可能回收空闲控制连接）
+
+        // UDP 中继模式（仅 udp_mode=proxy 时生效）
+        // "per_socket" - 每个 UDP socket 独立 UDP Associate + 控制连接（默认）
+        // "mux"        - 所有 UDP socket 共享一个 Associate 控制连接，本地中继为每个 socket 分配独立上游端口（减少代理端控制连接）
+        std::string udp_relay_mode = "per_socket";
+
         // 路由规则（内网/域名/端口/协议分流）
         RoutingConfig routing;
 
@@ -508,7 +565,7 @@ namespace Core {
                           const char* protocol, std::string* outAction, std::string* outRule) const {
             if (!routing.enabled) return false;
             std::string action = ToLower(routing.default_action);
-            if (action != "proxy" && action != "direct") {
+            if (action != "proxy" && action != "direct" && action != "learn") {
                 action = "proxy";
             }
 
@@ -630,8 +687,13 @@ namespace Core {
         ProxyConfig proxy;
         FakeIPConfig fakeIp;
         TimeoutConfig timeout;
+        CircuitBreakerConfig circuitBreaker; // 上游代理熔断
+        CaptureConfig capture;          // 抓包（pcapng）
+        MetricsConfig metrics;          // 回环指标端点
+        LatencyTraceConfig latencyTrace; // 连接阶段耗时追踪
         ProxyRules rules;               // 代理路由规则
-        bool trafficLogging = false;    // Phase 3: 是否启用流量监控日志
+        bool trafficLogging = false;    // Phase 3: 是否启用流量监控日志（连接关闭时输出流量摘要 + 采样负载预览）
+        int trafficSampleEvery = 1000;  // 每个线程每 N 次收发采样一次负载预览（写入独立的 .traffic.log），0=不采样
         bool childInjection = true;     // Phase 2: 是否自动注入子进程
         // 子进程注入模式：
         // - "filtered"（默认）：按 target_processes 过滤
@@ -640,45 +702,46 @@ namespace Core {
         std::vector<std::string> childInjectionExclude; // 进程排除列表（大小写不敏感，支持子串匹配）
         std::vector<std::string> targetProcesses; // 目标进程列表 (空=全部)
 
+        // 运行时策略快照：由 Load() 从上述字符串配置编译，Hook 热路径只读取该结构
+        RuntimePolicy policy;
+
         // 检查进程名是否在目标列表中 (大小写不敏感)
+        // 支持完全匹配或子串匹配（如 "language_server_windows" 匹配 "language_server_windows.exe"）
         bool ShouldInject(const std::string& processName) const {
-            // 如果列表为空，注入所有进程
-            if (targetProcesses.empty()) return true;
-            
-            // 将输入转为小写进行比较
-            std::string lowerName = ToLowerCopy(processName);
-            
-            for (const auto& target : targetProcesses) {
-                std::string lowerTarget = ToLowerCopy(target);
-                
-                // 支持完全匹配或不带扩展名匹配
-                if (lowerName == lowerTarget) return true;
-                // 支持类似 "language_server_windows" 匹配 "language_server_windows.exe"
-                if (lowerName.find(lowerTarget) != std::string::npos) return true;
-            }
-            return false;
+            return policy.ShouldInject(processName);
         }
 
         bool IsChildInjectionExcluded(const std::string& processName) const {
-            if (childInjectionExclude.empty()) return false;
-            const std::string lowerName = ToLowerCopy(processName);
-            for (const auto& item : childInjectionExclude) {
-                const std::string lowerItem = ToLowerCopy(item);
-                if (lowerItem.empty()) continue;
-                if (lowerName == lowerItem) return true;
-                if (lowerName.find(lowerItem) != std::string::npos) return true;
-            }
-            return false;
+            return policy.IsChildInjectionExcluded(processName);
         }
 
         bool ShouldInjectChildProcess(const std::string& processName) const {
-            if (IsChildInjectionExcluded(processName)) return false;
-            const std::string mode = ToLowerCopy(childInjectionMode);
-            if (mode == "inherit") return true;
             // 默认/兜底：按 target_processes 过滤（保持历史行为）
-            return ShouldInject(processName);
+            return policy.ShouldInjectChildProcess(processName);
+        }
+
+        // 将字符串配置编译为运行时策略（各模式取值已在 Load 的校验阶段回退为合法值，默认构造时即为默认值）
+        void CompilePolicy() {
+            RuntimePolicy p;
+            p.proxyEnabled = proxy.port != 0;
+            p.proxyPort = (uint16_t)proxy.port;
+            ParseProxyType(proxy.type, &p.proxyType);
+            ParseDnsMode(rules.dns_mode, &p.dns);
+            ParseIpv6Mode(rules.ipv6_mode, &p.ipv6);
+            ParseUdpMode(rules.udp_mode, &p.udp);
+            ParseUdpFallback(rules.udp_fallback, &p.udpFallback);
+            ParseUdpRelayMode(rules.udp_relay_mode, &p.udpRelay);
+            ParseBreakerOpenAction(circuitBreaker.open_action, &p.breakerOpenAction);
+            p.allowedPorts.Assign(rules.allowed_ports);
+            p.childInjection = childInjection;
+            ParseChildInjectionMode(childInjectionMode, &p.childInjectionMode);
+            p.targetProcesses.Assign(targetProcesses);
+            p.childInjectionExclude.Assign(childInjectionExclude);
+            policy = std::move(p);
         }
 
+        Config() { CompilePolicy(); }
+
         static Config& Instance() {
             static Config instance;
             return instance;
@@ -726,6 +789,85 @@ namespace Core {
                     Logger::SetLevel(LogLevel::Info);
                     Logger::Warn("配置: log_level 无效(" + logLevelStr + ")，已回退为 info (可选: debug/info/warn/error)");
                 }
+                // 结构化事件输出格式：默认 text；binary 时热路径事件写入 proxy-YYYYMMDD-<PID>-<HHMMSS>.blog，用 blog_decode 离线渲染
+                const std::string logFormatStr = j.value("log_format", "text");
+                if (!Logger::SetFormatFromString(logFormatStr)) {
+                    Logger::SetFormat(LogFormat::Text);
+                    Logger::Warn("配置: log_format 无效(" + logFormatStr + ")，已回退为 text (可选: text/binary)");
+                }
+                // 模块日志等级：如 {"fakeip": "debug"}，只打开正在排查的模块；未列出的模块沿用 log_level
+                Logger::ClearModuleLevels();
+                if (j.contains("log_modules")) {
+                    const auto& lm = j["log_modules"];
+                    if (!lm.is_object()) {
+                        Logger::Warn("配置: log_modules 应为对象（模块名 -> 等级），已忽略");
+                    } else {
+                        for (auto it = lm.begin(); it != lm.end(); ++it) {
+                            LogModule module;
+                            if (!TryParseLogModule(it.key(), &module)) {
+                                Logger::Warn("配置: log_modules 未知模块(" + it.key() +
+                                             ")，已忽略 (可选: general/fakeip/route/socks5/http/udp/iocp/inject)");
+                                continue;
+                            }
+                            const std::string levelStr = it.value().is_string() ? it.value().get<std::string>() : "";
+                            if (!Logger::SetModuleLevelFromString(module, levelStr)) {
+                                Logger::Warn("配置: log_modules." + it.key() + " 等级无效，已忽略 (可选: debug/info/warn/error)");
+                            }
+                        }
+                    }
+                }
+                // 飞行记录器：常开记录最近的紧凑事件（不写盘），出错或按需时转储到日志
+                {
+                    bool frEnabled = true;
+                    bool frDumpOnError = true;
+                    int frDumpEvents = 200;
+                    int frDumpIntervalMs = 10000;
+                    if (j.contains("flight_recorder") && j["flight_recorder"].is_object()) {
+                        auto& fr = j["flight_recorder"];
+                        frEnabled = fr.value("enabled", true);
+                        frDumpOnError = fr.value("dump_on_error", true);
+                        frDumpEvents = fr.value("dump_events", 200);
+                        frDumpIntervalMs = fr.value("dump_interval_ms", 10000);
+                    }
+                    if (frDumpEvents <= 0) {
+                        Logger::Warn("配置: flight_recorder.dump_events 非法(" + std::to_string(frDumpEvents) + ")，已回退为 200");
+                        frDumpEvents = 200;
+                    }
+                    if (frDumpIntervalMs < 0) {
+                        Logger::Warn("配置: flight_recorder.dump_interval_ms 非法(" + std::to_string(frDumpIntervalMs) + ")，已回退为 10000");
+                        frDumpIntervalMs = 10000;
+                    }
+                    Logger::ConfigureFlightRecorder(frEnabled, frDumpOnError, frDumpEvents, frDumpIntervalMs);
+                }
+                // 高频日志调用点的限流：每个调用点突发 burst 条，之后每分钟最多 per_minute 条，其余定期汇总为一行
+                {
+                    int rlBurst = 20;
+                    int rlPerMinute = 6;
+                    if (j.contains("log_rate_limit") && j["log_rate_limit"].is_object()) {
+                        auto& rl = j["log_rate_limit"];
+                        rlBurst = rl.value("burst", 20);
+                        rlPerMinute = rl.value("per_minute", 6);
+                    }
+                    if (rlBurst <= 0 || rlBurst > (int)LogRateLimiter::kMaxBurst) {
+                        Logger::Warn("配置: log_rate_limit.burst 非法(" + std::to_string(rlBurst) + ")，已回退为 20");
+                        rlBurst = 20;
+                    }
+                    if (rlPerMinute < 0 || rlPerMinute > 60000) {
+                        Logger::Warn("配置: log_rate_limit.per_minute 非法(" + std::to_string(rlPerMinute) + ")，已回退为 6");
+                        rlPerMinute = 6;
+                    }
+                    Logger::ConfigureRateLimit(rlBurst, rlPerMinute);
+                }
+#if AGP_LOG_MIN_LEVEL > 0
+                // 编译期已剔除调试日志：配置要求 debug 时提示，避免误以为配置未生效
+                bool wantsDebug = Logger::GetLevel() == LogLevel::Debug;
+                for (size_t i = 0; i < static_cast<size_t>(LogModule::Count); ++i) {
+                    wantsDebug = wantsDebug || Logger::GetModuleLevel(static_cast<LogModule>(i)) == LogLevel::Debug;
+                }
+                if (wantsDebug) {
+                    Logger::Warn("配置: 当前构建已移除调试日志 (LOG_STRIP_DEBUG)，debug 等级不会输出");
+                }
+#endif
                 if (!resolvedPath.empty()) {
                     Logger::Info("使用配置文件路径: " + resolvedPath);
                 }
@@ -784,6 +926,8 @@ namespace Core {
                     timeout.connect_ms = t.value("connect", 5000);
                     timeout.send_ms = t.value("send", 5000);
                     timeout.recv_ms = t.value("recv", 5000);
+                    timeout.adaptive = t.value("adaptive", false);
+                    timeout.adaptive_min_ms = t.value("adaptive_min", 200);
                 }
 
                 // 配置校验：超时必须为正数，避免 select/WaitConnect 异常行为
@@ -799,6 +943,38 @@ namespace Core {
                     Logger::Warn("配置: timeout.recv 非法(" + std::to_string(timeout.recv_ms) + ")，已回退为 5000");
                     timeout.recv_ms = 5000;
                 }
+                if (timeout.adaptive_min_ms <= 0 || timeout.adaptive_min_ms > 60000) {
+                    Logger::Warn("配置: timeout.adaptive_min 非法(" + std::to_string(timeout.adaptive_min_ms) + ")，已回退为 200");
+                    timeout.adaptive_min_ms = 200;
+                }
+
+                // ============= 上游代理熔断 =============
+                if (j.contains("circuit_breaker") && j["circuit_breaker"].is_object()) {
+                    auto& cb = j["circuit_breaker"];
+                    circuitBreaker.enabled = cb.value("enabled", true);
+                    circuitBreaker.failure_threshold = cb.value("failure_threshold", 5);
+                    circuitBreaker.cooldown_ms = cb.value("cooldown_ms", 10000);
+                    circuitBreaker.half_open_probes = cb.value("half_open_probes", 1);
+                    circuitBreaker.open_action = cb.value("open_action", "fail");
+                }
+                if (circuitBreaker.failure_threshold <= 0) {
+                    Logger::Warn("配置: circuit_breaker.failure_threshold 非法(" + std::to_string(circuitBreaker.failure_threshold) + ")，已回退为 5");
+                    circuitBreaker.failure_threshold = 5;
+                }
+                if (circuitBreaker.cooldown_ms <= 0) {
+                    Logger::Warn("配置: circuit_breaker.cooldown_ms 非法(" + std::to_string(circuitBreaker.cooldown_ms) + ")，已回退为 10000");
+                    circuitBreaker.cooldown_ms = 10000;
+                }
+                if (circuitBreaker.half_open_probes <= 0) {
+                    Logger::Warn("配置: circuit_breaker.half_open_probes 非法(" + std::to_string(circuitBreaker.half_open_probes) + ")，已回退为 1");
+                    circuitBreaker.half_open_probes = 1;
+                }
+                trimInPlace(circuitBreaker.open_action);
+                circuitBreaker.open_action = ToLowerCopy(circuitBreaker.open_action);
+                if (circuitBreaker.open_action != "fail" && circuitBreaker.open_action != "direct") {
+                    Logger::Warn("配置: circuit_breaker.open_action 无效(" + circuitBreaker.open_action + ")，已回退为 fail (可选: fail/direct)");
+                    circuitBreaker.open_action = "fail";
+                }
 
                 // ============= 代理路由规则解析 =============
                 bool hasProxyRules = false;
@@ -862,6 +1038,14 @@ namespace Core {
                                    [](unsigned char c) { return (char)std::tolower(c); });
                     if (rules.udp_fallback.empty()) rules.udp_fallback = "block";
 
+                    // 解析 UDP Associate 预热池
+                    rules.udp_pool_size = pr.value("udp_pool_size", 2);
+                    rules.udp_pool_max_idle_ms = pr.value("udp_pool_max_idle_ms", 30000);
+
+                    // 解析 UDP 中继模式
+                    rules.udp_relay_mode = ProxyRules::ToLower(pr.value("udp_relay_mode", std::string("per_socket")));
+                    if (rules.udp_relay_mode.empty()) rules.udp_relay_mode = "per_socket";
+
                     // 解析 routing 规则
                     if (pr.contains("routing") && pr["routing"].is_object()) {
                         auto& rt = pr["routing"];
@@ -869,6 +1053,12 @@ namespace Core {
                         rules.routing.priority_mode = rt.value("priority_mode", "order");
                         rules.routing.default_action = rt.value("default_action", "proxy");
                         rules.routing.use_default_private = rt.value("use_default_private", true);
+                        if (rt.contains("learn") && rt["learn"].is_object()) {
+                            auto& learn = rt["learn"];
+                            rules.routing.learn.half_life_hours = learn.value("half_life_hours", rules.routing.learn.half_life_hours);
+                            rules.routing.learn.max_entries = learn.value("max_entries", rules.routing.learn.max_entries);
+                            rules.routing.learn.persist = learn.value("persist", rules.routing.learn.persist);
+                        }
 
                         rules.routing.rules.clear();
                         if (rt.contains("rules") && rt["rules"].is_array()) {
@@ -926,21 +1116,45 @@ namespace Core {
                     Logger::Warn("配置: proxy_rules.udp_fallback 无效(" + rules.udp_fallback + ")，已回退为 block (可选: block/direct)");
                     rules.udp_fallback = "block";
                 }
+                if (rules.udp_pool_size < 0 || rules.udp_pool_size > 32) {
+                    Logger::Warn("配置: proxy_rules.udp_pool_size 超出范围(" + std::to_string(rules.udp_pool_size) + ")，已回退为 2 (可选: 0-32, 0=禁用)");
+                    rules.udp_pool_size = 2;
+                }
+                if (rules.udp_pool_max_idle_ms <= 0) {
+                    Logger::Warn("配置: proxy_rules.udp_pool_max_idle_ms 非法(" + std::to_string(rules.udp_pool_max_idle_ms) + ")，已回退为 30000");
+                    rules.udp_pool_max_idle_ms = 30000;
+                }
+                if (rules.udp_relay_mode != "per_socket" && rules.udp_relay_mode != "mux") {
+                    Logger::Warn("配置: proxy_rules.udp_relay_mode 无效(" + rules.udp_relay_mode + ")，已回退为 per_socket (可选: per_socket/mux)");
+                    rules.udp_relay_mode = "per_socket";
+                }
                 rules.routing.priority_mode = ProxyRules::ToLower(rules.routing.priority_mode);
                 if (rules.routing.priority_mode != "order" && rules.routing.priority_mode != "number") {
                     Logger::Warn("配置: proxy_rules.routing.priority_mode 无效(" + rules.routing.priority_mode + ")，已回退为 order (可选: order/number)");
                     rules.routing.priority_mode = "order";
                 }
                 rules.routing.default_action = ProxyRules::ToLower(rules.routing.default_action);
-                if (rules.routing.default_action != "proxy" && rules.routing.default_action != "direct") {
-                    Logger::Warn("配置: proxy_rules.routing.default_action 无效(" + rules.routing.default_action + ")，已回退为 proxy (可选: proxy/direct)");
+                if (rules.routing.default_action != "proxy" && rules.routing.default_action != "direct" &&
+                    rules.routing.default_action != "learn") {
+                    Logger::Warn("配置: proxy_rules.routing.default_action 无效(" + rules.routing.default_action + ")，已回退为 proxy (可选: proxy/direct/learn)");
                     rules.routing.default_action = "proxy";
                 }
+                if (rules.routing.learn.half_life_hours < 1 || rules.routing.learn.half_life_hours > 24 * 90) {
+                    Logger::Warn("配置: proxy_rules.routing.learn.half_life_hours 超出范围(" + std::to_string(rules.routing.learn.half_life_hours) + ")，已回退为 24 (可选: 1-2160)");
+                    rules.routing.learn.half_life_hours = 24;
+                }
+                if (rules.routing.learn.max_entries < 16 || rules.routing.learn.max_entries > 1000000) {
+                    Logger::Warn("配置: proxy_rules.routing.learn.max_entries 超出范围(" + std::to_string(rules.routing.learn.max_entries) + ")，已回退为 4096 (可选: 16-1000000)");
+                    rules.routing.learn.max_entries = 4096;
+                }
 
                 Logger::Info("路由规则: allowed_ports=" + std::to_string(rules.allowed_ports.size()) +
                              " 项, dns_mode=" + rules.dns_mode + ", ipv6_mode=" + rules.ipv6_mode +
                              ", udp_mode=" + rules.udp_mode + ", udp_fallback=" + rules.udp_fallback +
+                             ", udp_pool_size=" + std::to_string(rules.udp_pool_size) +
+                             ", udp_relay_mode=" + rules.udp_relay_mode +
                              ", routing=" + std::string(rules.routing.enabled ? "on" : "off") +
+                             ", default_action=" + rules.routing.default_action +
                              ", routing_rules=" + std::to_string(rules.routing.rules.size()) +
                              (hasProxyRules ? "" : " (默认)"));
 
@@ -949,6 +1163,62 @@ namespace Core {
 
                 // Phase 2/3 配置项
                 trafficLogging = j.value("traffic_logging", false);
+                trafficSampleEvery = j.value("traffic_sample_every", 1000);
+                if (trafficSampleEvery < 0) {
+                    Logger::Warn("配置: traffic_sample_every 非法(" + std::to_string(trafficSampleEvery) + ")，已回退为 1000");
+                    trafficSampleEvery = 1000;
+                }
+                capture = CaptureConfig{};
+                if (j.contains("capture") && j["capture"].is_object()) {
+                    auto& cap = j["capture"];
+                    capture.enabled = cap.value("enabled", false);
+                    capture.sample_every = cap.value("sample_every", 1);
+                    capture.snaplen = cap.value("snaplen", 256);
+                    capture.max_file_mb = cap.value("max_file_mb", 64);
+                }
+                if (capture.sample_every <= 0) {
+                    Logger::Warn("配置: capture.sample_every 非法(" + std::to_string(capture.sample_every) + ")，已回退为 1");
+                    capture.sample_every = 1;
+                }
+                if (capture.snaplen <= 0 || capture.snaplen > 65535) {
+                    Logger::Warn("配置: capture.snaplen 非法(" + std::to_string(capture.snaplen) + ")，已回退为 256");
+                    capture.snaplen = 256;
+                }
+                if (capture.max_file_mb <= 0 || capture.max_file_mb > 4096) {
+                    Logger::Warn("配置: capture.max_file_mb 非法(" + std::to_string(capture.max_file_mb) + ")，已回退为 64");
+                    capture.max_file_mb = 64;
+                }
+                metrics = MetricsConfig{};
+                if (j.contains("metrics") && j["metrics"].is_object()) {
+                    auto& m = j["metrics"];
+                    metrics.enabled = m.value("enabled", false);
+                    metrics.port = m.value("port", 9464);
+                    metrics.port_range = m.value("port_range", 16);
+                    metrics.shared_memory = m.value("shared_memory", false);
+                    metrics.publish_interval_ms = m.value("publish_interval_ms", 1000);
+                }
+                if (metrics.port < 0 || metrics.port > 65535) {
+                    Logger::Warn("配置: metrics.port 非法(" + std::to_string(metrics.port) + ")，已回退为 9464");
+                    metrics.port = 9464;
+                }
+                if (metrics.port_range <= 0 || metrics.port_range > 1024) {
+                    Logger::Warn("配置: metrics.port_range 非法(" + std::to_string(metrics.port_range) + ")，已回退为 16");
+                    metrics.port_range = 16;
+                }
+                if (metrics.publish_interval_ms < 100 || metrics.publish_interval_ms > 60000) {
+                    Logger::Warn("配置: metrics.publish_interval_ms 非法(" + std::to_string(metrics.publish_interval_ms) + ")，已回退为 1000");
+                    metrics.publish_interval_ms = 1000;
+                }
+                latencyTrace = LatencyTraceConfig{};
+                if (j.contains("latency_trace") && j["latency_trace"].is_object()) {
+                    auto& lt = j["latency_trace"];
+                    latencyTrace.enabled = lt.value("enabled", true);
+                    latencyTrace.sample_every = lt.value("sample_every", 0);
+                }
+                if (latencyTrace.sample_every < 0 || latencyTrace.sample_every > 1000000) {
+                    Logger::Warn("配置: latency_trace.sample_every 非法(" + std::to_string(latencyTrace.sample_every) + ")，已回退为 0");
+                    latencyTrace.sample_every = 0;
+                }
                 childInjection = j.value("child_injection", true);
                 // 子进程注入模式
                 childInjectionMode = j.value("child_injection_mode", childInjectionMode);
@@ -985,7 +1255,12 @@ namespace Core {
                              ", child_injection=" + std::string(childInjection ? "true" : "false") +
                              ", child_injection_mode=" + childInjectionMode +
                              ", child_injection_exclude=" + std::to_string(childInjectionExclude.size()) +
-                             ", traffic_logging=" + std::string(trafficLogging ? "true" : "false"));
+                             ", traffic_logging=" + std::string(trafficLogging ? "true" : "false") +
+                             ", circuit_breaker=" + (circuitBreaker.enabled
+                                 ? ("on(threshold=" + std::to_string(circuitBreaker.failure_threshold) +
+                                    ", cooldown=" + std::to_string(circuitBreaker.cooldown_ms) + "ms" +
+                                    ", open_action=" + circuitBreaker.open_action + ")")
+                                 : std::string("off")));
 
                 // CRIT-1/2/WARN-3: 仅在 Load() 成功返回前输出“有效 CIDR 统计 + 跳过数量”，避免失败时误导
                 Logger::Info("路由规则: 编译统计: 有效 IPv4 CIDR=" + std::to_string(rules.compiled_valid_cidr_v4) +
@@ -995,10 +1270,13 @@ namespace Core {
                              " (v4_cidr=" + std::to_string(rules.compiled_skipped_invalid_cidr_v4) +
                              ", v6_cidr=" + std::to_string(rules.compiled_skipped_invalid_cidr_v6) +
                              ", ports=" + std::to_string(rules.compiled_skipped_invalid_ports) + ")");
+                CompilePolicy();
                 Logger::Info("配置加载成功。");
                 return true;
             } catch (const std::exception& e) {
                 Logger::Error(std::string("配置解析失败: ") + e.what());
+                // 解析中途失败时部分字段可能已更新，重新编译以保持策略与字段一致
+                CompilePolicy();
                 return false;
             }
         }
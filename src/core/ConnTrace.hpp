@@ -0,0 +1,456 @@
+#pragma once
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <functional>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "AtomicText.hpp"
+#include "Metrics.hpp"
+
+namespace Core {
+
+    // 连接生命周期追踪：按 socket 记录 DNS → 连接代理 → 握手各步 → 首次发送 → 首字节的时间点，
+    // 结束时把相邻时间点之间的耗时计入各阶段的 HDR 直方图，并按 1/N 采样保留完整记录供导出为 Chrome trace JSON
+    // 设计意图：可在生产环境常开
+    // - 只追踪走代理的 TCP 连接，进行中的连接放在定长表里（按句柄哈希到相邻两个槽位之一），全部操作都是原子读写/CAS，无锁、无分配
+    // - send/recv 热路径对未追踪（或已结束）的 socket 只有一到两次原子读取；隧道就绪前的收发（握手本身）不计入
+    // - 连接在首字节到达、握手失败或 closesocket 时结束，槽位随即归还；表满时新连接不追踪（计入 dropped）
+    // - DNS 发生在 socket 之前：按线程记下最近一次解析，随后同线程上对同一域名（或刚解析出的 IP）的连接取用
+    // 说明：本文件不依赖 Winsock/Logger，可在非 Windows 平台独立测试。
+
+    // 时间点（微秒，steady clock；0 表示未发生）
+    enum class TraceStage : uint8_t {
+        DnsStart = 0,
+        DnsDone,
+        ConnectStart,   // connect/ConnectEx 入口
+        ProxyConnected, // 到代理的 TCP 连接完成
+        GreetingDone,   // SOCKS5 认证协商完成（HTTP CONNECT 无此步）
+        TunnelReady,    // CONNECT 应答成功，隧道就绪
+        FirstSend,      // 隧道就绪后应用的首次发送
+        FirstRecv,      // 隧道就绪后应用的首次接收（首字节）
+        Count
+    };
+
+    // 阶段耗时（两个时间点之间）
+    enum class TraceSpan : uint8_t {
+        Dns = 0,
+        ProxyConnect,
+        Greeting,
+        Connect,        // 发送 CONNECT 到收到应答
+        FirstSend,      // 隧道就绪到应用首次发送
+        FirstByte,      // 首次发送（或隧道就绪）到首字节
+        Total,          // DNS（或 connect 入口）到首字节
+        Count
+    };
+
+    inline const char* TraceSpanName(TraceSpan span) {
+        switch (span) {
+            case TraceSpan::Dns: return "dns";
+            case TraceSpan::ProxyConnect: return "proxy_connect";
+            case TraceSpan::Greeting: return "greeting";
+            case TraceSpan::Connect: return "connect";
+            case TraceSpan::FirstSend: return "first_send";
+            case TraceSpan::FirstByte: return "first_byte";
+            case TraceSpan::Total: return "total";
+            default: return "?";
+        }
+    }
+
+    struct ConnTraceRecord {
+        uint64_t socket = 0;
+        std::string host;
+        uint16_t port = 0;
+        bool failed = false;
+        std::array<uint64_t, (size_t)TraceStage::Count> ts{};
+
+        uint64_t At(TraceStage s) const { return ts[(size_t)s]; }
+
+        // 阶段的起止时间；任一端缺失或顺序颠倒时返回 false
+        bool Span(TraceSpan span, uint64_t* start, uint64_t* end) const {
+            uint64_t a = 0, b = 0;
+            switch (span) {
+                case TraceSpan::Dns: a = At(TraceStage::DnsStart); b = At(TraceStage::DnsDone); break;
+                case TraceSpan::ProxyConnect: a = At(TraceStage::ConnectStart); b = At(TraceStage::ProxyConnected); break;
+                case TraceSpan::Greeting: a = At(TraceStage::ProxyConnected); b = At(TraceStage::GreetingDone); break;
+                case TraceSpan::Connect:
+                    a = At(TraceStage::GreetingDone) ? At(TraceStage::GreetingDone) : At(TraceStage::ProxyConnected);
+                    b = At(TraceStage::TunnelReady);
+                    break;
+                case TraceSpan::FirstSend: a = At(TraceStage::TunnelReady); b = At(TraceStage::FirstSend); break;
+                case TraceSpan::FirstByte:
+                    // 服务端先发的协议（首字节早于首次发送）从隧道就绪算起
+                    b = At(TraceStage::FirstRecv);
+                    a = (At(TraceStage::FirstSend) && At(TraceStage::FirstSend) <= b) ? At(TraceStage::FirstSend)
+                                                                                      : At(TraceStage::TunnelReady);
+                    break;
+                case TraceSpan::Total:
+                    a = At(TraceStage::DnsStart) ? At(TraceStage::DnsStart) : At(TraceStage::ConnectStart);
+                    b = At(TraceStage::FirstRecv);
+                    break;
+                default: return false;
+            }
+            if (a == 0 || b == 0 || b < a) return false;
+            if (start) *start = a;
+            if (end) *end = b;
+            return true;
+        }
+    };
+
+    class ConnTrace {
+    public:
+        static constexpr size_t kStages = (size_t)TraceStage::Count;
+        static constexpr size_t kSpans = (size_t)TraceSpan::Count;
+        static constexpr size_t kSlots = 1024;                 // 同时处于“connect 到首字节”之间的连接上限
+        static constexpr size_t kSampleRing = 256;             // 保留最近的采样记录数
+        static constexpr uint64_t kDnsMatchWindowUs = 30000000; // 同一域名：解析后 30s 内的连接取用该次解析
+        static constexpr uint64_t kDnsIpWindowUs = 2000000;     // 目标为 IP 字面量（未启用 FakeIP）：解析后 2s 内取用
+
+        struct Stats {
+            uint64_t begun = 0;
+            uint64_t completed = 0; // 收到首字节
+            uint64_t failed = 0;    // 连接代理或握手失败
+            uint64_t abandoned = 0; // 首字节前关闭
+            uint64_t dropped = 0;   // 追踪表满，未追踪
+            uint64_t sampled = 0;
+        };
+
+        static ConnTrace& Instance() {
+            static ConnTrace instance;
+            return instance;
+        }
+
+        static uint64_t NowUs() {
+            return (uint64_t)std::chrono::duration_cast<std::chrono::microseconds>(
+                std::chrono::steady_clock::now().time_since_epoch()).count() + 1;
+        }
+
+        ConnTrace() {
+            for (auto& k : m_keys) k.store(0, std::memory_order_relaxed);
+        }
+        ConnTrace(const ConnTrace&) = delete;
+        ConnTrace& operator=(const ConnTrace&) = delete;
+
+        // sampleEvery=0 不保留采样记录（直方图照常统计）
+        void Configure(bool enabled, uint32_t sampleEvery) {
+            m_sampleEvery.store(sampleEvery, std::memory_order_relaxed);
+            m_enabled.store(enabled, std::memory_order_relaxed);
+        }
+
+        bool IsEnabled() const { return m_enabled.load(std::memory_order_relaxed); }
+        uint32_t SampleEvery() const { return m_sampleEvery.load(std::memory_order_relaxed); }
+
+        // getaddrinfo 返回时调用：记在当前线程上，等待随后的 Begin 取用
+        static void NoteDns(std::string_view host, uint64_t startUs, uint64_t endUs) {
+            DnsNote& note = LocalDns();
+            note.hostHash = HashHost(host);
+            note.startUs = startUs;
+            note.endUs = endUs;
+            note.pending = true;
+        }
+
+        // 决定走代理时调用（startUs 为 connect 入口时间）；表满或未启用时返回 false
+        bool Begin(uint64_t sock, std::string_view host, uint16_t port, uint64_t startUs) {
+            if (!IsEnabled() || sock == 0 || sock == kBusy) return false;
+            // 同一句柄上未结束的旧记录（重复 connect、句柄复用）按放弃处理
+            Finish(sock, false);
+            const size_t index = SlotIndex(sock);
+            for (size_t c : {index, index ^ 1}) {
+                uint64_t expected = 0;
+                if (!m_keys[c].compare_exchange_strong(expected, kBusy, std::memory_order_acquire)) continue;
+                Slot& slot = m_slots[c];
+                bool sampled = false;
+                const uint32_t every = SampleEvery();
+                if (every > 0 && m_sampleSeq.fetch_add(1, std::memory_order_relaxed) % every == 0) sampled = true;
+                slot.flags.store((sampled ? kFlagSampled : 0) | ((uint64_t)port << 16), std::memory_order_relaxed);
+                for (auto& t : slot.ts) t.store(0, std::memory_order_relaxed);
+                slot.ts[(size_t)TraceStage::ConnectStart].store(startUs, std::memory_order_relaxed);
+                uint64_t dnsStart = 0, dnsEnd = 0;
+                if (TakeDns(host, startUs, &dnsStart, &dnsEnd)) {
+                    slot.ts[(size_t)TraceStage::DnsStart].store(dnsStart, std::memory_order_relaxed);
+                    slot.ts[(size_t)TraceStage::DnsDone].store(dnsEnd, std::memory_order_relaxed);
+                }
+                slot.host.Store(host);
+                m_keys[c].store(sock, std::memory_order_release);
+                m_begun.fetch_add(1, std::memory_order_relaxed);
+                return true;
+            }
+            m_dropped.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+
+        // 记录某个时间点（同一时间点只取第一次）
+        // 说明：与 Finish 并发时，迟到的写入可能落到刚被新连接占用的槽位上（同一句柄被复用的极端情况），只影响该条统计
+        void Mark(uint64_t sock, TraceStage stage, uint64_t nowUs = 0) {
+            const size_t c = Find(sock);
+            if (c == kNotFound || stage >= TraceStage::Count) return;
+            uint64_t expected = 0;
+            m_slots[c].ts[(size_t)stage].compare_exchange_strong(expected, nowUs ? nowUs : NowUs(), std::memory_order_relaxed);
+        }
+
+        // 热路径：成功发送后调用；只记录隧道就绪后的第一次
+        void OnSend(uint64_t sock, uint64_t nowUs = 0) {
+            const size_t c = Find(sock);
+            if (c == kNotFound) return;
+            Slot& slot = m_slots[c];
+            if (slot.ts[(size_t)TraceStage::TunnelReady].load(std::memory_order_relaxed) == 0) return;
+            if (slot.ts[(size_t)TraceStage::FirstSend].load(std::memory_order_relaxed) != 0) return;
+            uint64_t expected = 0;
+            slot.ts[(size_t)TraceStage::FirstSend].compare_exchange_strong(expected, nowUs ? nowUs : NowUs(), std::memory_order_relaxed);
+        }
+
+        // 热路径：成功接收后调用；隧道就绪后的第一次接收即结束该连接的追踪
+        void OnRecv(uint64_t sock, uint64_t nowUs = 0) {
+            const size_t c = Find(sock);
+            if (c == kNotFound) return;
+            Slot& slot = m_slots[c];
+            if (slot.ts[(size_t)TraceStage::TunnelReady].load(std::memory_order_relaxed) == 0) return;
+            uint64_t expected = 0;
+            if (!slot.ts[(size_t)TraceStage::FirstRecv].compare_exchange_strong(expected, nowUs ? nowUs : NowUs(),
+                                                                                   std::memory_order_relaxed)) {
+                return;
+            }
+            Complete(c, sock, false);
+        }
+
+        // 握手失败（failed=true）或 closesocket 时调用；未追踪的 socket 直接返回
+        void Finish(uint64_t sock, bool failed) {
+            const size_t c = Find(sock);
+            if (c != kNotFound) Complete(c, sock, failed);
+        }
+
+        HdrHistogram::Snapshot ReadSpan(TraceSpan span) const {
+            return m_spans[(size_t)span < kSpans ? (size_t)span : 0].Read();
+        }
+
+        Stats GetStats() const {
+            Stats s;
+            s.begun = m_begun.load(std::memory_order_relaxed);
+            s.completed = m_completed.load(std::memory_order_relaxed);
+            s.failed = m_failed.load(std::memory_order_relaxed);
+            s.abandoned = m_abandoned.load(std::memory_order_relaxed);
+            s.dropped = m_dropped.load(std::memory_order_relaxed);
+            s.sampled = m_sampled.load(std::memory_order_relaxed);
+            return s;
+        }
+
+        // 最近的采样记录（按连接开始时间排序）；与写入并发时跳过正在改写的条目
+        std::vector<ConnTraceRecord> Samples() const {
+            std::vector<ConnTraceRecord> out;
+            for (const SampleSlot& slot : m_samples) {
+                const uint64_t s1 = slot.seq.load(std::memory_order_acquire);
+                if (s1 == 0 || (s1 & 1)) continue;
+                ConnTraceRecord rec;
+                rec.socket = slot.socket.load(std::memory_order_relaxed);
+                const uint64_t flags = slot.flags.load(std::memory_order_relaxed);
+                rec.failed = (flags & kFlagFailed) != 0;
+                rec.port = (uint16_t)(flags >> 16);
+                for (size_t i = 0; i < kStages; ++i) rec.ts[i] = slot.ts[i].load(std::memory_order_relaxed);
+                rec.host = slot.host.Load();
+                std::atomic_thread_fence(std::memory_order_acquire);
+                if (slot.seq.load(std::memory_order_relaxed) != s1) continue;
+                out.push_back(std::move(rec));
+            }
+            std::sort(out.begin(), out.end(), [](const ConnTraceRecord& a, const ConnTraceRecord& b) {
+                return StartOf(a) < StartOf(b);
+            });
+            return out;
+        }
+
+    private:
+        static constexpr uint64_t kBusy = ~0ull;  // 槽位正在初始化或正在结束
+        static constexpr size_t kNotFound = ~(size_t)0;
+        static constexpr uint64_t kFlagSampled = 1;
+        static constexpr uint64_t kFlagFailed = 2;
+
+        struct Slot {
+            std::atomic<uint64_t> flags{0}; // bit0 采样；16..31 位端口
+            std::atomic<uint64_t> ts[kStages] = {};
+            AtomicText<64> host{};
+        };
+
+        struct SampleSlot {
+            std::atomic<uint64_t> seq{0}; // 0=空；奇数=正在写
+            std::atomic<uint64_t> socket{0};
+            std::atomic<uint64_t> flags{0}; // bit1 失败；16..31 位端口
+            std::atomic<uint64_t> ts[kStages] = {};
+            AtomicText<64> host{};
+        };
+
+        struct DnsNote {
+            uint64_t hostHash = 0;
+            uint64_t startUs = 0;
+            uint64_t endUs = 0;
+            bool pending = false;
+        };
+
+        static DnsNote& LocalDns() {
+            thread_local DnsNote note;
+            return note;
+        }
+
+        static uint64_t HashHost(std::string_view host) {
+            uint64_t h = 1469598103934665603ull; // FNV-1a
+            for (char ch : host) {
+                h ^= (uint8_t)ch;
+                h *= 1099511628211ull;
+            }
+            return h;
+        }
+
+        static bool IsIpLiteral(std::string_view host) {
+            if (host.empty()) return false;
+            for (char ch : host) {
+                const bool hex = (ch >= '0' && ch <= '9') || (ch >= 'a' && ch <= 'f') || (ch >= 'A' && ch <= 'F');
+                if (!hex && ch != '.' && ch != ':') return false;
+            }
+            return host.find('.') != std::string_view::npos || host.find(':') != std::string_view::npos;
+        }
+
+        // 取用本线程最近一次解析（每次解析只取用一次）
+        static bool TakeDns(std::string_view host, uint64_t connectUs, uint64_t* start, uint64_t* end) {
+            DnsNote& note = LocalDns();
+            if (!note.pending || note.endUs > connectUs) return false;
+            const uint64_t age = connectUs - note.endUs;
+            const bool match = note.hostHash == HashHost(host) && age <= kDnsMatchWindowUs;
+            const bool resolvedIp = IsIpLiteral(host) && age <= kDnsIpWindowUs;
+            if (!match && !resolvedIp) return false;
+            note.pending = false;
+            *start = note.startUs;
+            *end = note.endUs;
+            return true;
+        }
+
+        static uint64_t StartOf(const ConnTraceRecord& r) {
+            return r.At(TraceStage::DnsStart) ? r.At(TraceStage::DnsStart) : r.At(TraceStage::ConnectStart);
+        }
+
+        static size_t SlotIndex(uint64_t sock) {
+            // 与 TrafficCounters 相同的乘法哈希
+            return (size_t)((sock * 0x9E3779B97F4A7C15ull) >> (64 - 10));
+        }
+        static_assert(kSlots == 1024, "SlotIndex 按 10 位哈希");
+
+        size_t Find(uint64_t sock) const {
+            if (sock == 0 || sock == kBusy) return kNotFound;
+            const size_t index = SlotIndex(sock);
+            if (m_keys[index].load(std::memory_order_acquire) == sock) return index;
+            if (m_keys[index ^ 1].load(std::memory_order_acquire) == sock) return index ^ 1;
+            return kNotFound;
+        }
+
+        // 结束追踪：以 key 的 CAS 决定由哪个线程结束（首字节与 closesocket 可能同时到达），读出后归还槽位再做统计
+        void Complete(size_t c, uint64_t sock, bool failed) {
+            uint64_t expected = sock;
+            if (!m_keys[c].compare_exchange_strong(expected, kBusy, std::memory_order_acquire)) return;
+            Slot& slot = m_slots[c];
+            ConnTraceRecord rec;
+            rec.socket = sock;
+            const uint64_t flags = slot.flags.load(std::memory_order_relaxed);
+            rec.port = (uint16_t)(flags >> 16);
+            for (size_t i = 0; i < kStages; ++i) rec.ts[i] = slot.ts[i].load(std::memory_order_relaxed);
+            const bool sampled = (flags & kFlagSampled) != 0;
+            if (sampled) rec.host = slot.host.Load();
+            m_keys[c].store(0, std::memory_order_release);
+
+            const bool complete = rec.At(TraceStage::FirstRecv) != 0;
+            rec.failed = failed && !complete;
+            if (complete) m_completed.fetch_add(1, std::memory_order_relaxed);
+            else if (rec.failed) m_failed.fetch_add(1, std::memory_order_relaxed);
+            else m_abandoned.fetch_add(1, std::memory_order_relaxed);
+            for (size_t i = 0; i < kSpans; ++i) {
+                uint64_t a = 0, b = 0;
+                if (rec.Span((TraceSpan)i, &a, &b)) m_spans[i].Record(b - a);
+            }
+            if (sampled) PushSample(rec);
+        }
+
+        // 环形缓冲的每个条目是一个 seqlock；多个线程各自领取序号写入不同条目，
+        // 只有相隔 kSampleRing 次的两次写入同时进行时才会落到同一条目（此时该条采样可能混杂，不影响统计）
+        void PushSample(const ConnTraceRecord& rec) {
+            const uint64_t n = m_sampleNext.fetch_add(1, std::memory_order_relaxed);
+            SampleSlot& slot = m_samples[n % kSampleRing];
+            slot.seq.store(2 * n + 1, std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_release);
+            slot.socket.store(rec.socket, std::memory_order_relaxed);
+            slot.flags.store((rec.failed ? kFlagFailed : 0) | ((uint64_t)rec.port << 16), std::memory_order_relaxed);
+            for (size_t i = 0; i < kStages; ++i) slot.ts[i].store(rec.ts[i], std::memory_order_relaxed);
+            slot.host.Store(rec.host);
+            slot.seq.store(2 * n + 2, std::memory_order_release);
+            m_sampled.fetch_add(1, std::memory_order_relaxed);
+        }
+
+        std::atomic<bool> m_enabled{false};
+        std::atomic<uint32_t> m_sampleEvery{0};
+        std::atomic<uint64_t> m_sampleSeq{0};
+        std::array<std::atomic<uint64_t>, kSlots> m_keys;
+        std::array<Slot, kSlots> m_slots;
+        std::array<HdrHistogram, kSpans> m_spans;
+        std::array<SampleSlot, kSampleRing> m_samples;
+        std::atomic<uint64_t> m_sampleNext{0};
+        std::atomic<uint64_t> m_begun{0};
+        std::atomic<uint64_t> m_completed{0};
+        std::atomic<uint64_t> m_failed{0};
+        std::atomic<uint64_t> m_abandoned{0};
+        std::atomic<uint64_t> m_dropped{0};
+        std::atomic<uint64_t> m_sampled{0};
+    };
+
+    // JSON 字符串转义（双引号、反斜杠、控制字符）
+    inline void AppendJsonString(std::string* out, std::string_view s) {
+        out->push_back('"');
+        for (char ch : s) {
+            if (ch == '"' || ch == '\\') {
+                out->push_back('\\');
+                out->push_back(ch);
+            } else if ((unsigned char)ch < 0x20) {
+                char buf[8];
+                snprintf(buf, sizeof(buf), "\\u%04x", (unsigned)(unsigned char)ch);
+                out->append(buf);
+            } else {
+                out->push_back(ch);
+            }
+        }
+        out->push_back('"');
+    }
+
+    // 导出为 Chrome trace event JSON（chrome://tracing / Perfetto 可直接打开）
+    // 每个连接占一行（tid），行名为目标地址；各阶段为完整事件（ph=X），失败的连接在最后一个时间点标记 handshake_failed
+    inline std::string RenderChromeTrace(const std::vector<ConnTraceRecord>& records, uint64_t pid) {
+        std::string out = "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+        const std::string pidStr = std::to_string(pid);
+        out += "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":" + pidStr +
+               ",\"tid\":0,\"args\":{\"name\":\"antigravity-proxy " + pidStr + "\"}}";
+        for (size_t i = 0; i < records.size(); ++i) {
+            const ConnTraceRecord& rec = records[i];
+            const std::string tid = std::to_string(i + 1);
+            out += ",{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":" + pidStr + ",\"tid\":" + tid + ",\"args\":{\"name\":";
+            AppendJsonString(&out, rec.host + ":" + std::to_string(rec.port) + " sock=" + std::to_string(rec.socket));
+            out += "}}";
+            uint64_t last = 0;
+            for (size_t s = 0; s < ConnTrace::kSpans; ++s) {
+                uint64_t a = 0, b = 0;
+                if (!rec.Span((TraceSpan)s, &a, &b)) continue;
+                last = std::max(last, b);
+                out += ",{\"name\":\"";
+                out += (TraceSpan)s == TraceSpan::Total ? "connection" : TraceSpanName((TraceSpan)s);
+                out += "\",\"cat\":\"conn\",\"ph\":\"X\",\"pid\":" + pidStr + ",\"tid\":" + tid +
+                       ",\"ts\":" + std::to_string(a) + ",\"dur\":" + std::to_string(b - a) + "}";
+            }
+            if (rec.failed) {
+                for (uint64_t t : rec.ts) last = std::max(last, t);
+                out += ",{\"name\":\"handshake_failed\",\"cat\":\"conn\",\"ph\":\"i\",\"s\":\"t\",\"pid\":" + pidStr +
+                       ",\"tid\":" + tid + ",\"ts\":" + std::to_string(last) + "}";
+            }
+        }
+        out += "]}\n";
+        return out;
+    }
+}
@@ -0,0 +1,362 @@
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <new>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "BinLog.hpp"
+#include "LogEvents.hpp"
+
+namespace Core {
+
+    // 飞行记录器：每个线程一个定长环，常开记录最近的紧凑事件（hook 入口、路由决策、握手步骤、错误码），从不写盘
+    // 平时以 Info 运行；出错或按需时才把最近的事件渲染进日志，以 Info 的开销拿到 Debug 级别的前因后果
+    // 设计要点：
+    // - 写入只发生在本线程自己的环上（单写者）：无 CAS、无锁、无分配；参数按类型紧凑打包进 128 字节槽位
+    // - 转储与写入并发：槽位带序号（seqlock），读到正在改写的槽位直接跳过，不阻塞写入方
+    // - 字符串参数内联拷贝（超长截断），不依赖调用方内存的生命周期
+    // - 线程退出后环归还给后续线程复用；内容保留到被覆盖为止（线程退出前的事件仍可转储）
+    // 约束：实例须比使用它的线程存活更久（进程内的全局实例从不析构）
+    // 说明：本文件不依赖 Windows/Logger，时间与线程 ID 由调用方注入，可在非 Windows 平台独立测试
+    class FlightRecorder {
+    public:
+        using NowFn = uint64_t (*)();      // 微秒，Unix 纪元
+        using ThreadIdFn = uint32_t (*)();
+
+        static constexpr size_t kSlotsPerThread = 256;
+        static constexpr size_t kMaxThreads = 512;
+
+        struct Entry {
+            uint64_t tsUs = 0;
+            uint32_t tid = 0;
+            LogEvent event = LogEvent::Count;
+            std::string text; // 按事件目录格式串渲染后的正文
+        };
+
+        FlightRecorder(NowFn now, ThreadIdFn threadId) : m_now(now), m_threadId(threadId) {
+            for (auto& r : m_rings) r.store(nullptr, std::memory_order_relaxed);
+        }
+
+        ~FlightRecorder() {
+            ThreadSlot& local = Local();
+            if (local.owner == this) {
+                local.owner = nullptr;
+                local.ring = nullptr;
+            }
+            for (auto& r : m_rings) delete r.load(std::memory_order_relaxed);
+        }
+
+        FlightRecorder(const FlightRecorder&) = delete;
+        FlightRecorder& operator=(const FlightRecorder&) = delete;
+
+        bool IsEnabled() const { return m_enabled.load(std::memory_order_relaxed); }
+        void SetEnabled(bool enabled) { m_enabled.store(enabled, std::memory_order_relaxed); }
+
+        // 记录一条事件（热路径）；未启用或线程数超限时直接返回
+        void Record(LogEvent ev, const LogArg* args, size_t count) {
+            if (!IsEnabled()) return;
+            Ring* ring = LocalRing();
+            if (!ring) return;
+
+            // 按整字组装（不经字节缓冲）：避免逐字节写入后再按字读出引起的存储转发停顿
+            uint64_t words[kDataWords];
+            words[0] = m_now ? m_now() : 0;
+            const size_t declared = std::min(count, kMaxArgs);
+            size_t encoded = 0;
+            size_t used = kFirstArgWord;
+            while (encoded < declared && EncodeArg(args[encoded], words, &used)) ++encoded;
+            words[1] = (uint64_t)static_cast<uint16_t>(ev) | ((uint64_t)declared << 16) | ((uint64_t)encoded << 24) |
+                       ((uint64_t)used << 32);
+
+            const uint64_t pos = ring->head.load(std::memory_order_relaxed);
+            Slot& slot = ring->slots[pos & (kSlotsPerThread - 1)];
+            const uint64_t seq = slot.seq.load(std::memory_order_relaxed);
+            slot.seq.store(seq + 1, std::memory_order_relaxed); // 奇数：改写中
+            std::atomic_thread_fence(std::memory_order_release);
+            for (size_t i = 0; i < used; ++i) slot.words[i].store(words[i], std::memory_order_relaxed);
+            slot.seq.store(seq + 2, std::memory_order_release);
+            ring->head.store(pos + 1, std::memory_order_release);
+        }
+
+        template <typename... Args>
+        void Record(LogEvent ev, const Args&... args) {
+            const auto packed = MakeLogArgs(args...);
+            Record(ev, packed.data(), packed.size());
+        }
+
+        // 收集所有线程中时间戳晚于 sinceUs 的事件，按时间升序返回最近的 maxEvents 条
+        // 与写入并发执行：正在改写或已被覆盖的槽位跳过
+        std::vector<Entry> Collect(uint64_t sinceUs, size_t maxEvents) const {
+            std::vector<Entry> out;
+            const size_t rings = std::min(m_ringCount.load(std::memory_order_acquire), kMaxThreads);
+            for (size_t r = 0; r < rings; ++r) {
+                const Ring* ring = m_rings[r].load(std::memory_order_acquire);
+                if (!ring) continue;
+                const uint32_t tid = ring->tid.load(std::memory_order_relaxed);
+                const uint64_t head = ring->head.load(std::memory_order_acquire);
+                const uint64_t n = std::min<uint64_t>(head, kSlotsPerThread);
+                for (uint64_t pos = head - n; pos < head; ++pos) {
+                    const Slot& slot = ring->slots[pos & (kSlotsPerThread - 1)];
+                    uint64_t words[kDataWords];
+                    const uint64_t s1 = slot.seq.load(std::memory_order_acquire);
+                    if (s1 == 0 || (s1 & 1)) continue;
+                    for (size_t i = 0; i < kDataWords; ++i) words[i] = slot.words[i].load(std::memory_order_relaxed);
+                    std::atomic_thread_fence(std::memory_order_acquire);
+                    if (slot.seq.load(std::memory_order_relaxed) != s1) continue;
+                    Entry e;
+                    if (!Decode(words, tid, &e) || e.tsUs <= sinceUs) continue;
+                    out.push_back(std::move(e));
+                }
+            }
+            std::stable_sort(out.begin(), out.end(), [](const Entry& a, const Entry& b) { return a.tsUs < b.tsUs; });
+            if (out.size() > maxEvents) out.erase(out.begin(), out.end() - (ptrdiff_t)maxEvents);
+            return out;
+        }
+
+        // 线程数超过 kMaxThreads 后新线程不再记录；返回未能分到环的线程数
+        uint64_t UnrecordedThreads() const { return m_unrecordedThreads.load(std::memory_order_relaxed); }
+
+        // 渲染为转储行："<indent>[HH:MM:SS.mmm] [TID:x] 正文\n"（本地时间）
+        static void AppendEntries(std::string& out, const std::vector<Entry>& entries, const char* indent) {
+            char buf[48];
+            for (const Entry& e : entries) {
+                const std::string stamp = BinLog::FormatTimestamp(e.tsUs); // "YYYY-MM-DD HH:MM:SS"
+                snprintf(buf, sizeof(buf), "[%s.%03u] [TID:%lu] ", stamp.size() > 11 ? stamp.c_str() + 11 : stamp.c_str(),
+                         (unsigned)((e.tsUs / 1000) % 1000), (unsigned long)e.tid);
+                out += indent;
+                out += buf;
+                out += e.text;
+                out.push_back('\n');
+            }
+        }
+
+    private:
+        // 槽位 = 序号 + 15 个字（共 128 字节）：字 0 时间戳；字 1 事件 ID(16) | 声明参数个数(8) | 已编码参数个数(8) | 已用字数(8)
+        static constexpr size_t kDataWords = 15;
+        static constexpr size_t kFirstArgWord = 2;
+        static constexpr size_t kMaxArgs = 15;
+        static constexpr size_t kMaxInlineStr = 64;          // 单个字符串参数最多保留的字节数
+        static constexpr uint64_t kInlineFlag = 0x40;        // 整数值内联在首字中
+        static constexpr uint64_t kTruncatedFlag = 0x80;     // 字符串被截断（渲染时追加 "..."）
+
+        struct alignas(64) Slot {
+            std::atomic<uint64_t> seq{0};
+            std::atomic<uint64_t> words[kDataWords];
+            Slot() {
+                for (auto& w : words) w.store(0, std::memory_order_relaxed);
+            }
+        };
+
+        struct Ring {
+            std::atomic<bool> inUse{true};
+            std::atomic<uint32_t> tid{0};
+            std::atomic<uint64_t> head{0}; // 仅持有线程写入
+            Slot slots[kSlotsPerThread];
+        };
+
+        // 线程本地缓存：记录所属实例，切换实例时归还旧环；线程退出时归还环（内容保留）
+        struct ThreadSlot {
+            FlightRecorder* owner = nullptr;
+            Ring* ring = nullptr;
+            ~ThreadSlot() {
+                if (ring) ring->inUse.store(false, std::memory_order_release);
+            }
+        };
+
+        static ThreadSlot& Local() {
+            thread_local ThreadSlot t_slot;
+            return t_slot;
+        }
+
+        Ring* LocalRing() {
+            ThreadSlot& local = Local();
+            if (local.owner == this) return local.ring;
+            if (local.ring) local.ring->inUse.store(false, std::memory_order_release);
+            local.owner = this;
+            local.ring = ClaimRing();
+            return local.ring;
+        }
+
+        // 慢路径（每线程一次）：优先复用已归还的环，否则分配新环
+        Ring* ClaimRing() {
+            const uint32_t tid = m_threadId ? m_threadId() : 0;
+            const size_t rings = std::min(m_ringCount.load(std::memory_order_acquire), kMaxThreads);
+            for (size_t r = 0; r < rings; ++r) {
+                Ring* ring = m_rings[r].load(std::memory_order_acquire);
+                bool expected = false;
+                if (ring && ring->inUse.compare_exchange_strong(expected, true, std::memory_order_acq_rel)) {
+                    ring->tid.store(tid, std::memory_order_relaxed);
+                    return ring;
+                }
+            }
+            size_t index = m_ringCount.load(std::memory_order_relaxed);
+            do {
+                if (index >= kMaxThreads) {
+                    m_unrecordedThreads.fetch_add(1, std::memory_order_relaxed);
+                    return nullptr;
+                }
+            } while (!m_ringCount.compare_exchange_weak(index, index + 1, std::memory_order_acq_rel));
+            Ring* ring = new (std::nothrow) Ring();
+            if (!ring) {
+                m_unrecordedThreads.fetch_add(1, std::memory_order_relaxed);
+                return nullptr; // 该下标保持为空，Collect 会跳过
+            }
+            ring->tid.store(tid, std::memory_order_relaxed);
+            m_rings[index].store(ring, std::memory_order_release);
+            return ring;
+        }
+
+        // 参数编码（每个参数占整数个字，首字低 8 位为类型）：
+        // - U64/I64：值（I64 为 zigzag）小于 2^56 时放在首字高 56 位并置 kInlineFlag，否则随后一个值字
+        // - Str：首字 bit8..15 为长度（超长截断并置 kTruncatedFlag），随后 ceil(长度/8) 个字为字节内容
+        // - Addr：首字 bit8..15 family、bit16..31 port、bit32..63 IPv4 地址；IPv6 随后 2 个字
+        // 放不下的参数及其后续参数不再编码（渲染时显示为 "..."）
+        static bool EncodeArg(const LogArg& a, uint64_t* words, size_t* used) {
+            const size_t room = kDataWords - *used;
+            uint64_t* w = words + *used;
+            switch (a.type) {
+                case LogArg::Type::U64:
+                case LogArg::Type::I64: {
+                    const uint64_t v = a.type == LogArg::Type::U64
+                                           ? a.u
+                                           : (((uint64_t)a.i << 1) ^ (uint64_t)(a.i >> 63));
+                    if ((v >> 56) == 0) {
+                        if (room < 1) return false;
+                        w[0] = (uint64_t)a.type | kInlineFlag | (v << 8);
+                        *used += 1;
+                        return true;
+                    }
+                    if (room < 2) return false;
+                    w[0] = (uint64_t)a.type;
+                    w[1] = v;
+                    *used += 2;
+                    return true;
+                }
+                case LogArg::Type::Str:
+                case LogArg::Type::StrRef: {
+                    if (room < 1) return false;
+                    size_t n = std::min(a.s.size(), std::min((room - 1) * 8, kMaxInlineStr));
+                    const bool truncated = n < a.s.size();
+                    // 截断时回退到 UTF-8 字符边界，避免渲染出半个汉字
+                    if (truncated) {
+                        while (n > 0 && ((unsigned char)a.s[n] & 0xC0) == 0x80) --n;
+                    }
+                    w[0] = (uint64_t)LogArg::Type::Str | (truncated ? kTruncatedFlag : 0) | ((uint64_t)n << 8);
+                    const char* src = a.s.data();
+                    size_t k = 0;
+                    for (; k + 8 <= n; k += 8) memcpy(&w[1 + k / 8], src + k, 8);
+                    if (k < n) {
+                        uint64_t tail = 0;
+                        for (size_t i = 0; k + i < n; ++i) tail |= (uint64_t)(unsigned char)src[k + i] << (8 * i);
+                        w[1 + k / 8] = tail;
+                    }
+                    *used += 1 + (n + 7) / 8;
+                    return true;
+                }
+                case LogArg::Type::Addr: {
+                    const bool v6 = a.addr.family == 6;
+                    if (room < (v6 ? 3u : 1u)) return false;
+                    uint32_t v4 = 0;
+                    if (a.addr.family == 4) memcpy(&v4, a.addr.bytes, 4);
+                    w[0] = (uint64_t)LogArg::Type::Addr | ((uint64_t)a.addr.family << 8) | ((uint64_t)a.addr.port << 16) |
+                           ((uint64_t)v4 << 32);
+                    if (v6) {
+                        memcpy(&w[1], a.addr.bytes, 8);
+                        memcpy(&w[2], a.addr.bytes + 8, 8);
+                    }
+                    *used += v6 ? 3 : 1;
+                    return true;
+                }
+                case LogArg::Type::None:
+                    if (room < 1) return false;
+                    w[0] = (uint64_t)LogArg::Type::None;
+                    *used += 1;
+                    return true;
+            }
+            return false;
+        }
+
+        static bool Decode(const uint64_t* words, uint32_t tid, Entry* e) {
+            const uint16_t id = (uint16_t)(words[1] & 0xFFFF);
+            if (id >= static_cast<uint16_t>(LogEvent::Count)) return false;
+            const size_t declared = std::min<size_t>((words[1] >> 16) & 0xFF, kMaxArgs);
+            const size_t encoded = std::min<size_t>((words[1] >> 24) & 0xFF, declared);
+            const size_t used = std::min<size_t>((words[1] >> 32) & 0xFF, kDataWords);
+
+            LogArg args[kMaxArgs];
+            std::string strings[kMaxArgs];
+            size_t pos = kFirstArgWord;
+            size_t count = 0;
+            for (; count < encoded && pos < used; ++count) {
+                LogArg& a = args[count];
+                const uint64_t head = words[pos++];
+                a.type = static_cast<LogArg::Type>(head & 0x3F);
+                switch (a.type) {
+                    case LogArg::Type::U64:
+                    case LogArg::Type::I64: {
+                        uint64_t v = head >> 8;
+                        if (!(head & kInlineFlag)) {
+                            if (pos >= used) return false;
+                            v = words[pos++];
+                        }
+                        if (a.type == LogArg::Type::U64) {
+                            a.u = v;
+                        } else {
+                            a.i = (int64_t)(v >> 1) ^ -(int64_t)(v & 1);
+                        }
+                        break;
+                    }
+                    case LogArg::Type::Str: {
+                        const size_t n = (size_t)((head >> 8) & 0xFF);
+                        const size_t nw = (n + 7) / 8;
+                        if (pos + nw > used) return false;
+                        strings[count].assign(reinterpret_cast<const char*>(words + pos), n);
+                        if (head & kTruncatedFlag) strings[count] += "..."; // 截断的字符串补 "..."
+                        a.s = strings[count];
+                        pos += nw;
+                        break;
+                    }
+                    case LogArg::Type::Addr: {
+                        a.addr.family = (uint8_t)((head >> 8) & 0xFF);
+                        a.addr.port = (uint16_t)((head >> 16) & 0xFFFF);
+                        if (a.addr.family == 4) {
+                            const uint32_t v4 = (uint32_t)(head >> 32);
+                            memcpy(a.addr.bytes, &v4, 4);
+                        } else if (a.addr.family == 6) {
+                            if (pos + 2 > used) return false;
+                            memcpy(a.addr.bytes, &words[pos], 8);
+                            memcpy(a.addr.bytes + 8, &words[pos + 1], 8);
+                            pos += 2;
+                        }
+                        break;
+                    }
+                    case LogArg::Type::None:
+                        break;
+                    default:
+                        return false;
+                }
+            }
+            for (; count < declared; ++count) args[count] = MakeLogArg("..."); // 未编码的参数
+
+            e->tsUs = words[0];
+            e->tid = tid;
+            e->event = static_cast<LogEvent>(id);
+            e->text.clear();
+            FormatLogEvent(e->text, GetLogEventInfo(e->event).format, args, count);
+            return true;
+        }
+
+        NowFn m_now;
+        ThreadIdFn m_threadId;
+        std::atomic<bool> m_enabled{true};
+        std::atomic<Ring*> m_rings[kMaxThreads];
+        std::atomic<size_t> m_ringCount{0};
+        std::atomic<uint64_t> m_unrecordedThreads{0};
+    };
+
+} // namespace Core
@@ -0,0 +1,235 @@
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <string>
+
+// 编译期最低日志等级（0=Debug 1=Info 2=Warn 3=Error）：低于该等级的 AGP_LOG_* 调用不生成任何代码
+// 由 CMake 选项 LOG_STRIP_DEBUG 在非 Debug 构建中设为 1
+#ifndef AGP_LOG_MIN_LEVEL
+#define AGP_LOG_MIN_LEVEL 0
+#endif
+
+namespace Core {
+    // 日志等级（用于控制输出粒度：默认 Info；需要更细粒度排障时可切到 Debug）
+    enum class LogLevel : int {
+        Debug = 0,
+        Info  = 1,
+        Warn  = 2,
+        Error = 3,
+    };
+
+    inline const char* LogLevelTag(LogLevel level) {
+        switch (level) {
+            case LogLevel::Debug: return "[调试]";
+            case LogLevel::Info:  return "[信息]";
+            case LogLevel::Warn:  return "[警告]";
+            case LogLevel::Error: return "[错误]";
+        }
+        return "[信息]";
+    }
+
+    constexpr bool IsLogLevelCompiledIn(LogLevel level) {
+        return static_cast<int>(level) >= AGP_LOG_MIN_LEVEL;
+    }
+
+    // ========== 日志模块 ==========
+    // 各模块可在 config.json 的 log_modules 中单独设置等级；未设置的模块沿用全局 log_level
+    // 例：只排查 FakeIP 时设 {"fakeip": "debug"}，不会连带打开每次 connect 的 SOCKS5/路由/UDP 调试日志
+    #define AGP_LOG_MODULES(X) \
+        X(General, "general") \
+        X(FakeIP,  "fakeip") \
+        X(Route,   "route") \
+        X(Socks5,  "socks5") \
+        X(Http,    "http") \
+        X(Udp,     "udp") \
+        X(Iocp,    "iocp") \
+        X(Inject,  "inject")
+
+    enum class LogModule : uint8_t {
+    #define AGP_LOG_MODULE_ENUM(name, key) name,
+        AGP_LOG_MODULES(AGP_LOG_MODULE_ENUM)
+    #undef AGP_LOG_MODULE_ENUM
+        Count
+    };
+
+    inline const char* LogModuleName(LogModule module) {
+        static const char* const s_names[] = {
+        #define AGP_LOG_MODULE_NAME(name, key) key,
+            AGP_LOG_MODULES(AGP_LOG_MODULE_NAME)
+        #undef AGP_LOG_MODULE_NAME
+        };
+        const size_t i = static_cast<size_t>(module);
+        return i < static_cast<size_t>(LogModule::Count) ? s_names[i] : "general";
+    }
+
+    // 按配置键名解析模块（不区分大小写）；不识别返回 false
+    inline bool TryParseLogModule(const std::string& input, LogModule* out) {
+        std::string s = input;
+        std::transform(s.begin(), s.end(), s.begin(), [](unsigned char c) { return (char)std::tolower(c); });
+        for (size_t i = 0; i < static_cast<size_t>(LogModule::Count); ++i) {
+            if (s == LogModuleName(static_cast<LogModule>(i))) {
+                if (out) *out = static_cast<LogModule>(i);
+                return true;
+            }
+        }
+        return false;
+    }
+
+    // 模块等级表：全局等级 + 各模块覆盖值，预先合成为每模块的生效阈值
+    // 热路径判断只有一次 relaxed 原子读；设置操作（配置加载时）加锁重算，不在热路径上
+    class LogLevelTable {
+    public:
+        explicit LogLevelTable(LogLevel global = LogLevel::Info) : m_global(global) {
+            for (auto& o : m_override) o = kNoOverride;
+            Recompute();
+        }
+
+        LogLevelTable(const LogLevelTable&) = delete;
+        LogLevelTable& operator=(const LogLevelTable&) = delete;
+
+        bool IsEnabled(LogModule module, LogLevel level) const {
+            return static_cast<int>(level) >= m_effective[Index(module)].load(std::memory_order_relaxed);
+        }
+
+        LogLevel Effective(LogModule module) const {
+            return static_cast<LogLevel>(m_effective[Index(module)].load(std::memory_order_relaxed));
+        }
+
+        LogLevel Global() const {
+            std::lock_guard<std::mutex> lock(m_mtx);
+            return m_global;
+        }
+
+        void SetGlobal(LogLevel level) {
+            std::lock_guard<std::mutex> lock(m_mtx);
+            m_global = level;
+            Recompute();
+        }
+
+        void SetModule(LogModule module, LogLevel level) {
+            std::lock_guard<std::mutex> lock(m_mtx);
+            m_override[Index(module)] = static_cast<int>(level);
+            Recompute();
+        }
+
+        void ClearModule(LogModule module) {
+            std::lock_guard<std::mutex> lock(m_mtx);
+            m_override[Index(module)] = kNoOverride;
+            Recompute();
+        }
+
+        void ClearAllModules() {
+            std::lock_guard<std::mutex> lock(m_mtx);
+            for (auto& o : m_override) o = kNoOverride;
+            Recompute();
+        }
+
+        bool HasOverride(LogModule module) const {
+            std::lock_guard<std::mutex> lock(m_mtx);
+            return m_override[Index(module)] != kNoOverride;
+        }
+
+    private:
+        static constexpr size_t kCount = static_cast<size_t>(LogModule::Count);
+        static constexpr int kNoOverride = -1;
+
+        static size_t Index(LogModule module) {
+            const size_t i = static_cast<size_t>(module);
+            return i < kCount ? i : 0;
+        }
+
+        void Recompute() {
+            for (size_t i = 0; i < kCount; ++i) {
+                const int level = m_override[i] != kNoOverride ? m_override[i] : static_cast<int>(m_global);
+                m_effective[i].store(level, std::memory_order_relaxed);
+            }
+        }
+
+        mutable std::mutex m_mtx;
+        LogLevel m_global;
+        int m_override[kCount];
+        std::atomic<int> m_effective[kCount];
+    };
+
+    // ========== 结构化日志事件目录 ==========
+    // 每个事件 = 模块 + 等级 + 静态格式串；调用点只记录事件 ID 与原始参数（socket/端口/错误码/主机名等）
+    // - 文本模式：调用方线程按格式串渲染，输出与原先的拼接结果一致
+    // - 二进制模式：只编码 ID + 参数，格式化推迟到离线解码（blog_decode）
+    // 约定：只在末尾追加新事件；二进制文件头会写入完整目录，解码不依赖与 DLL 同版本
+    // 格式串占位符为 {}，按参数顺序替换
+    // RouteMatch 之后的事件主要由 AGP_FLIGHT_RECORD 写入飞行记录器（只在转储时渲染，不单独输出日志）
+    #define AGP_LOG_EVENTS(X) \
+        X(LogDropped,               General, Warn,  "日志队列已满，已丢弃 {} 条日志") \
+        X(ConnectCall,              Route,   Debug, "{}: 调用, sock={}, dst={}, family={}, namelen={}") \
+        X(ConnectUdpDirect,         Udp,     Debug, "{}: UDP 直连, sock={}, target={}:{}") \
+        X(ConnectUdpRelay,          Udp,     Debug, "{}: UDP 已重定向到 SOCKS5 relay, sock={}, target={}:{}") \
+        X(BypassLoopback,           Route,   Debug, "BYPASS(loopback): sock={}, target={}:{}") \
+        X(BypassProxySelf,          Route,   Debug, "BYPASS(proxy-self): sock={}, target={}:{}, proxy={}:{}") \
+        X(HandshakeStart,           Route,   Debug, "代理握手: 开始, sock={}, type={}, 目标={}:{}, 预算={}ms") \
+        X(ShutdownFailed,           General, Debug, "shutdown: 失败, sock={}, WSA错误码={}") \
+        X(CloseSocketDone,          General, Debug, "closesocket: 完成, sock={}") \
+        X(ConnectExCall,            Route,   Debug, "ConnectEx: 调用, sock={}, dst={}, send_len={}, overlapped={}") \
+        X(ConnectExBypassLoopback,  Route,   Debug, "ConnectEx BYPASS(loopback): sock={}, target={}:{}") \
+        X(ConnectExBypassProxySelf, Route,   Debug, "ConnectEx BYPASS(proxy-self): sock={}, target={}:{}, proxy={}:{}") \
+        X(RouteMatch,               Route,   Debug, "路由: sock={}, target={}:{}, action={}, rule={}") \
+        X(RoutePort,                Route,   Debug, "路由: sock={}, 端口={}, 端口决策={}") \
+        X(ProxyConnectResult,       Route,   Debug, "{}: 连接代理, sock={}, rc={}, WSA错误码={}") \
+        X(Socks5Step,               Socks5,  Debug, "SOCKS5: {}, sock={}") \
+        X(Socks5Reply,              Socks5,  Debug, "SOCKS5: [3/3] 收到响应头, sock={}, VER={}, REP={}, ATYP={}") \
+        X(HttpConnectStatus,        Http,    Debug, "HTTP CONNECT: 收到响应, sock={}, 状态码={}") \
+        X(DnsQuery,                 FakeIP,  Debug, "{}: 查询, host={}") \
+        X(FakeIpAssign,             FakeIP,  Debug, "FakeIP: 分配 {} -> {}") \
+        X(FakeIpLookup,             FakeIP,  Debug, "FakeIP: 查询 {} -> {}")
+
+    enum class LogEvent : uint16_t {
+    #define AGP_LOG_EVENT_ENUM(name, module, level, fmt) name,
+        AGP_LOG_EVENTS(AGP_LOG_EVENT_ENUM)
+    #undef AGP_LOG_EVENT_ENUM
+        Count
+    };
+
+    struct LogEventInfo {
+        const char* name;
+        LogLevel level;
+        const char* format;
+        LogModule module;
+    };
+
+    inline const LogEventInfo* LogEventTable() {
+        static const LogEventInfo s_table[] = {
+        #define AGP_LOG_EVENT_INFO(name, module, level, fmt) {#name, LogLevel::level, fmt, LogModule::module},
+            AGP_LOG_EVENTS(AGP_LOG_EVENT_INFO)
+        #undef AGP_LOG_EVENT_INFO
+        };
+        return s_table;
+    }
+
+    inline const LogEventInfo& GetLogEventInfo(LogEvent ev) {
+        return LogEventTable()[static_cast<size_t>(ev)];
+    }
+
+    // 编译期可用的事件等级/模块（AGP_LOG_EVENT 据此在编译期剔除被禁用等级的事件）
+    constexpr LogLevel LogEventLevel(LogEvent ev) {
+        switch (ev) {
+        #define AGP_LOG_EVENT_LEVEL(name, module, level, fmt) case LogEvent::name: return LogLevel::level;
+            AGP_LOG_EVENTS(AGP_LOG_EVENT_LEVEL)
+        #undef AGP_LOG_EVENT_LEVEL
+            default: break;
+        }
+        return LogLevel::Info;
+    }
+
+    constexpr LogModule LogEventModule(LogEvent ev) {
+        switch (ev) {
+        #define AGP_LOG_EVENT_MODULE(name, module, level, fmt) case LogEvent::name: return LogModule::module;
+            AGP_LOG_EVENTS(AGP_LOG_EVENT_MODULE)
+        #undef AGP_LOG_EVENT_MODULE
+            default: break;
+        }
+        return LogModule::General;
+    }
+}
@@ -0,0 +1,117 @@
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+
+#include "LogEvents.hpp"
+
+namespace Core {
+
+    // 单个调用点的日志限流器（令牌桶）：突发最多 burst 条，之后按 perMinute 条/分钟补充令牌
+    // 与“只放行前 N 条，之后永久静默”不同：长时间运行的会话仍能持续看到低频的同类日志
+    // 被抑制的条数累计起来，至少间隔 kSummaryIntervalMs 才汇报一次（由调用方写成“过去 N 秒抑制了 M 条同类日志”）
+    // 设计要点：
+    // - 桶状态打包进一个 64 位原子量（高 40 位上次补充时刻 ms，低 24 位为千分之一令牌），CAS 更新，无锁
+    // - 限流器通常是调用点的函数内静态对象；构造时挂入全局链表，退出前可统一汇报尚未输出的抑制计数
+    // 约束：实例须为静态存储期（挂入全局链表后不再摘除），一般由 AGP_LOG_LIMITED* 宏在调用点定义
+    // 说明：不依赖 Windows，时间由调用方传入（单调毫秒），可在非 Windows 平台独立测试
+    class LogRateLimiter {
+    public:
+        static constexpr uint64_t kSummaryIntervalMs = 60000;
+        static constexpr uint32_t kMaxBurst = 10000; // 千分之一令牌需放进 24 位
+
+        struct Decision {
+            bool allowed = false;
+            uint64_t suppressed = 0; // >0：需要先输出一条抑制汇总
+            uint64_t windowMs = 0;   // 汇总覆盖的时长
+        };
+
+        // site：调用点标识（通常为 "文件:行号"），写进汇总行便于定位
+        LogRateLimiter(const char* site, LogModule module, LogLevel level) : m_site(site), m_module(module), m_level(level) {
+            // 无锁头插：各调用点的静态对象可能在不同线程首次构造
+            LogRateLimiter* head = Head().load(std::memory_order_relaxed);
+            do {
+                m_next = head;
+            } while (!Head().compare_exchange_weak(head, this, std::memory_order_release, std::memory_order_relaxed));
+        }
+
+        LogRateLimiter(const LogRateLimiter&) = delete;
+        LogRateLimiter& operator=(const LogRateLimiter&) = delete;
+
+        const char* Site() const { return m_site; }
+        LogModule Module() const { return m_module; }
+        LogLevel Level() const { return m_level; }
+
+        // 尝试取一个令牌；burst/perMinute 为当前生效的限流参数（运行期可调整）
+        Decision Acquire(uint64_t nowMs, uint32_t burst, uint32_t perMinute) {
+            Decision d;
+            const uint64_t capacity = (uint64_t)std::max<uint32_t>(1, std::min(burst, kMaxBurst)) * 1000;
+            uint64_t state = m_state.load(std::memory_order_relaxed);
+            for (;;) {
+                uint64_t last = state >> kTokenBits;
+                uint64_t tokens = state & kTokenMask;
+                if (state == kUninitialized) {
+                    last = nowMs;
+                    tokens = capacity;
+                }
+                // 每毫秒补充 perMinute/60 个千分之一令牌；时刻只推进到已折算成令牌的部分，避免高频调用时余数被反复丢弃
+                const uint64_t elapsed = nowMs > last ? nowMs - last : 0;
+                const uint64_t refill = elapsed * perMinute / 60;
+                if (refill > 0) last += refill * 60 / perMinute;
+                tokens = std::min(capacity, tokens + refill);
+                if (tokens >= capacity) last = nowMs; // 桶满：空闲时间不再累积
+                d.allowed = tokens >= 1000;
+                if (d.allowed) tokens -= 1000;
+                const uint64_t next = ((last & kTimeMask) << kTokenBits) | tokens;
+                if (m_state.compare_exchange_weak(state, next, std::memory_order_relaxed, std::memory_order_relaxed)) break;
+            }
+            if (!d.allowed) m_suppressed.fetch_add(1, std::memory_order_relaxed);
+            TakeSummary(nowMs, false, &d);
+            return d;
+        }
+
+        // 取出尚未汇报的抑制计数（force=false 时须距上次汇报满 kSummaryIntervalMs）
+        bool TakeSummary(uint64_t nowMs, bool force, Decision* out) {
+            uint64_t start = m_windowStartMs.load(std::memory_order_relaxed);
+            if (start == 0) {
+                // 首次调用：从此刻开始计算汇总窗口
+                if (m_windowStartMs.compare_exchange_strong(start, nowMs, std::memory_order_relaxed)) start = nowMs;
+            }
+            if (m_suppressed.load(std::memory_order_relaxed) == 0) return false;
+            if (!force && nowMs - start < kSummaryIntervalMs) return false;
+            // 只有一个线程能推进窗口，由它负责输出汇总
+            if (!m_windowStartMs.compare_exchange_strong(start, nowMs, std::memory_order_relaxed)) return false;
+            const uint64_t n = m_suppressed.exchange(0, std::memory_order_relaxed);
+            if (n == 0) return false;
+            out->suppressed = n;
+            out->windowMs = nowMs > start ? nowMs - start : 0;
+            return true;
+        }
+
+        // 遍历全部已构造的限流器（用于退出前汇报）
+        template <typename Fn>
+        static void ForEach(Fn&& fn) {
+            for (LogRateLimiter* p = Head().load(std::memory_order_acquire); p; p = p->m_next) fn(*p);
+        }
+
+    private:
+        static constexpr unsigned kTokenBits = 24;
+        static constexpr uint64_t kTokenMask = (1ull << kTokenBits) - 1;
+        static constexpr uint64_t kTimeMask = (1ull << (64 - kTokenBits)) - 1;
+        static constexpr uint64_t kUninitialized = ~0ull;
+
+        static std::atomic<LogRateLimiter*>& Head() {
+            static std::atomic<LogRateLimiter*> s_head{nullptr};
+            return s_head;
+        }
+
+        const char* m_site;
+        LogModule m_module;
+        LogLevel m_level;
+        LogRateLimiter* m_next = nullptr;
+        std::atomic<uint64_t> m_state{kUninitialized};
+        std::atomic<uint64_t> m_suppressed{0};
+        std::atomic<uint64_t> m_windowStartMs{0};
+    };
+
+}
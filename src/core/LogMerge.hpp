@@ -0,0 +1,157 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <ctime>
+#include <functional>
+#include <queue>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "BinLog.hpp"
+
+namespace Core {
+namespace LogMerge {
+
+    // 多进程日志离线合并：每个被注入进程写自己的文件（proxy-YYYYMMDD-<PID>-<HHMMSS>.log/.blog），
+    // 排障时再按时间戳交织成一条时间线
+    // 说明：本文件不依赖 Windows，可在非 Windows 平台独立测试；log_merge 工具基于此实现
+
+    struct Entry {
+        int64_t tsUs = 0;  // 自 1970 年的微秒（文本日志精度为秒）
+        uint32_t pid = 0;  // 行首无 PID 时为 0
+        std::string text;  // 一条日志（含续行，行间以 '\n' 分隔，末尾不带换行）
+    };
+
+    inline bool ParseDigits(const char* p, size_t n, int* out) {
+        int v = 0;
+        for (size_t i = 0; i < n; ++i) {
+            if (p[i] < '0' || p[i] > '9') return false;
+            v = v * 10 + (p[i] - '0');
+        }
+        *out = v;
+        return true;
+    }
+
+    // 文本日志行首时间戳解析，带同秒缓存（mktime 需要查时区，逐行调用开销较大）
+    class TextTimestampParser {
+    public:
+        // 解析 "[YYYY-MM-DD HH:MM:SS] [PID:x]..."；时间为写入进程的本地时间，按当前时区换算
+        bool Parse(const char* p, size_t n, int64_t* tsUs, uint32_t* pid) {
+            static const size_t kStampLen = 19; // "YYYY-MM-DD HH:MM:SS"
+            if (n < kStampLen + 2 || p[0] != '[' || p[kStampLen + 1] != ']') return false;
+            const char* s = p + 1;
+            if (m_hasCache && memcmp(s, m_cachedStamp, kStampLen) == 0) {
+                *tsUs = m_cachedUs;
+            } else {
+                struct tm tm {};
+                if (s[4] != '-' || s[7] != '-' || s[10] != ' ' || s[13] != ':' || s[16] != ':') return false;
+                if (!ParseDigits(s, 4, &tm.tm_year) || !ParseDigits(s + 5, 2, &tm.tm_mon) ||
+                    !ParseDigits(s + 8, 2, &tm.tm_mday) || !ParseDigits(s + 11, 2, &tm.tm_hour) ||
+                    !ParseDigits(s + 14, 2, &tm.tm_min) || !ParseDigits(s + 17, 2, &tm.tm_sec)) {
+                    return false;
+                }
+                tm.tm_year -= 1900;
+                tm.tm_mon -= 1;
+                tm.tm_isdst = -1;
+                const std::time_t t = std::mktime(&tm);
+                if (t == (std::time_t)-1) return false;
+                memcpy(m_cachedStamp, s, kStampLen);
+                m_cachedUs = (int64_t)t * 1000000;
+                m_hasCache = true;
+                *tsUs = m_cachedUs;
+            }
+
+            *pid = 0;
+            static const char kPidTag[] = " [PID:";
+            const size_t tagLen = sizeof(kPidTag) - 1;
+            const char* q = p + kStampLen + 2;
+            const char* end = p + n;
+            if ((size_t)(end - q) > tagLen && memcmp(q, kPidTag, tagLen) == 0) {
+                uint32_t v = 0;
+                for (q += tagLen; q < end && *q >= '0' && *q <= '9'; ++q) v = v * 10 + (uint32_t)(*q - '0');
+                if (q < end && *q == ']') *pid = v;
+            }
+            return true;
+        }
+
+    private:
+        char m_cachedStamp[19] = {};
+        int64_t m_cachedUs = 0;
+        bool m_hasCache = false;
+    };
+
+    // 文本日志：无法解析时间戳的行视为上一条的续行；文件开头的孤立行时间戳记为 0（合并时最先输出）
+    inline std::vector<Entry> ReadTextLog(const char* data, size_t size) {
+        std::vector<Entry> out;
+        TextTimestampParser parser;
+        size_t pos = 0;
+        while (pos < size) {
+            const char* nl = static_cast<const char*>(memchr(data + pos, '\n', size - pos));
+            size_t len = nl ? (size_t)(nl - (data + pos)) : size - pos;
+            const char* line = data + pos;
+            pos += len + (nl ? 1 : 0);
+            if (len > 0 && line[len - 1] == '\r') --len;
+            if (len == 0) continue;
+
+            int64_t ts = 0;
+            uint32_t pid = 0;
+            if (parser.Parse(line, len, &ts, &pid) || out.empty()) {
+                Entry e;
+                e.tsUs = ts;
+                e.pid = pid;
+                e.text.assign(line, len);
+                out.push_back(std::move(e));
+            } else {
+                out.back().text.push_back('\n');
+                out.back().text.append(line, len);
+            }
+        }
+        return out;
+    }
+
+    inline bool IsBinaryLog(const uint8_t* data, size_t size) {
+        return size >= sizeof(BinLog::kMagic) && memcmp(data, BinLog::kMagic, sizeof(BinLog::kMagic)) == 0;
+    }
+
+    // 二进制日志：按会话解码并渲染为与文本日志相同格式的行，保留微秒时间戳用于排序
+    inline std::vector<Entry> ReadBinaryLog(const uint8_t* data, size_t size, BinLog::DecodeStats* stats) {
+        std::vector<Entry> out;
+        BinLog::Reader reader;
+        const BinLog::DecodeStats st =
+            reader.Decode(data, size, [&out](const std::string& line, const BinLog::DecodedEvent& ev) {
+                Entry e;
+                e.tsUs = (int64_t)ev.tsUs;
+                e.pid = ev.pid;
+                e.text = line;
+                out.push_back(std::move(e));
+            });
+        if (stats) *stats = st;
+        return out;
+    }
+
+    // k 路归并：每个来源内部保持原有写入顺序（不重排，避免同进程内的先后关系被打乱）；
+    // 各来源当前条目按时间戳交织，时间相同时按来源序号输出（结果确定、可复现）
+    // onEntry(const Entry& e, size_t sourceIndex)；返回输出条目数
+    template <typename Fn>
+    inline size_t Merge(const std::vector<std::vector<Entry>>& sources, Fn&& onEntry) {
+        using Head = std::pair<int64_t, size_t>; // (时间戳, 来源序号)
+        std::priority_queue<Head, std::vector<Head>, std::greater<Head>> heads;
+        std::vector<size_t> cursor(sources.size(), 0);
+        for (size_t i = 0; i < sources.size(); ++i) {
+            if (!sources[i].empty()) heads.push(Head(sources[i][0].tsUs, i));
+        }
+        size_t emitted = 0;
+        while (!heads.empty()) {
+            const size_t src = heads.top().second;
+            heads.pop();
+            onEntry(sources[src][cursor[src]], src);
+            ++emitted;
+            if (++cursor[src] < sources[src].size()) heads.push(Head(sources[src][cursor[src]].tsUs, src));
+        }
+        return emitted;
+    }
+
+} // namespace LogMerge
+} // namespace Core
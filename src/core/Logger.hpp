@@ -1,10 +1,13 @@
 #pragma once
-#include <fstream>
 #include <atomic>
 #include <mutex>
 #include <string>
+#include <vector>
 #include <algorithm>
 #include <cctype>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
 #include <iostream>
 
 #ifndef WIN32_LEAN_AND_MEAN
@@ -16,22 +19,27 @@
 #include <iomanip>
 #include <sstream>
 
+#include "AsyncLog.hpp"
+#include "BinLog.hpp"
+#include "FlightRecorder.hpp"
+#include "LogEvents.hpp"
+#include "LogLimiter.hpp"
+
 namespace Core {
-    // 日志等级（用于控制输出粒度：默认 Info；需要更细粒度排障时可切到 Debug）
-    enum class LogLevel : int {
-        Debug = 0,
-        Info  = 1,
-        Warn  = 2,
-        Error = 3,
+    // 结构化事件的输出格式：text=调用方线程渲染为文本行（默认）；binary=只编码事件 ID + 原始参数，离线解码
+    enum class LogFormat : int {
+        Text   = 0,
+        Binary = 1,
     };
 
     class Logger {
     private:
         // ========== 日志等级控制 ==========
         // 设计意图：默认 Info（更克制），现场需要时可切到 Debug；同时提供可配置降级能力以降低性能开销。
-        static std::atomic<int>& LevelStorage() {
-            static std::atomic<int> s_level{static_cast<int>(LogLevel::Info)};
-            return s_level;
+        // 模块可单独覆盖全局等级（log_modules），只打开正在排查的模块，避免调试日志改变其他路径的时序
+        static LogLevelTable& Levels() {
+            static LogLevelTable s_levels(LogLevel::Info);
+            return s_levels;
         }
 
         static bool TryParseLevelFromString(const std::string& input, LogLevel* out) {
@@ -64,18 +72,6 @@ namespace Core {
             return false;
         }
 
-        // ========== 跨进程互斥（用于多进程注入场景下的日志一致性） ==========
-        // 设计意图：序列化“检查大小→必要时截断→写入”这一段，避免多进程互相截断或写入交错。
-        static HANDLE GetCrossProcessLogMutex() {
-            static HANDLE s_mutex = NULL;
-            static std::once_flag s_once;
-            std::call_once(s_once, []() {
-                // 使用 Local\ 命名空间：对普通桌面进程权限更稳
-                s_mutex = CreateMutexA(NULL, FALSE, "Local\\AntigravityProxy_LogFileMutex");
-            });
-            return s_mutex;
-        }
-
         // ========== 日志目录相关函数 ==========
         
         // 获取 DLL 所在目录（用于定位日志目录）
@@ -159,12 +155,14 @@ namespace Core {
         // ========== 原有辅助函数 ==========
         
         static std::string GetTimestamp() {
-            auto now = std::time(nullptr);
-            struct tm tm;
-            localtime_s(&tm, &now);
-            std::ostringstream oss;
-            oss << std::put_time(&tm, "%Y-%m-%d %H:%M:%S");
-            return oss.str();
+            // 在调用方线程执行：避免 ostringstream/put_time 的 locale 开销
+            SYSTEMTIME st;
+            GetLocalTime(&st);
+            char buf[32] = {0};
+            snprintf(buf, sizeof(buf), "%04u-%02u-%02u %02u:%02u:%02u",
+                     (unsigned)st.wYear, (unsigned)st.wMonth, (unsigned)st.wDay,
+                     (unsigned)st.wHour, (unsigned)st.wMinute, (unsigned)st.wSecond);
+            return std::string(buf);
         }
 
         static std::string GetPidTidPrefix() {
@@ -174,134 +172,548 @@ namespace Core {
             return "[PID:" + std::to_string(pid) + "][TID:" + std::to_string(tid) + "]";
         }
 
-        // 获取今日日志文件完整路径（如：C:\xxx\logs\proxy-20260111.log）
-        static std::string GetTodayLogName() {
-            auto now = std::time(nullptr);
-            struct tm tm;
-            localtime_s(&tm, &now);
-            std::ostringstream oss;
-            // 优先使用 DLL 目录下的 logs 子目录
-            std::string logDir = GetLogDirectory();
-            if (!logDir.empty()) {
-                oss << logDir << "\\";
-            }
-            oss << "proxy-" << std::put_time(&tm, "%Y%m%d") << ".log";
-            return oss.str();
+        // ========== 按进程独立的日志文件 ==========
+        // 设计意图：每个被注入进程只写自己的文件（proxy-YYYYMMDD-<PID>-<HHMMSS>.log/.blog），
+        // 写入路径无需跨进程互斥；多进程日志由离线工具 log_merge 按时间戳合并
+        // HHMMSS 为进程启动时间（本地时间）：PID 被系统复用时也不会与旧进程的文件混写
+
+        // 进程标识 "<PID>-<HHMMSS>"（进程内只计算一次）
+        static const std::string& GetProcessLogTag() {
+            static std::string s_tag;
+            static std::once_flag s_once;
+            std::call_once(s_once, []() {
+                SYSTEMTIME st{};
+                FILETIME creation{}, exitTime{}, kernel{}, user{}, local{};
+                if (!GetProcessTimes(GetCurrentProcess(), &creation, &exitTime, &kernel, &user) ||
+                    !FileTimeToLocalFileTime(&creation, &local) || !FileTimeToSystemTime(&local, &st)) {
+                    GetLocalTime(&st);
+                }
+                char buf[32] = {0};
+                snprintf(buf, sizeof(buf), "%lu-%02u%02u%02u", (unsigned long)GetCurrentProcessId(),
+                         (unsigned)st.wHour, (unsigned)st.wMinute, (unsigned)st.wSecond);
+                s_tag = buf;
+            });
+            return s_tag;
         }
 
-        static bool IsLogOverLimit(const std::string& path, ULONGLONG maxBytes) {
-            WIN32_FILE_ATTRIBUTE_DATA data{};
-            if (!GetFileAttributesExA(path.c_str(), GetFileExInfoStandard, &data)) {
-                return false;
-            }
-            ULONGLONG size = (static_cast<ULONGLONG>(data.nFileSizeHigh) << 32) | data.nFileSizeLow;
-            return size >= maxBytes;
+        // 今日日期前缀 "proxy-YYYYMMDD"
+        static std::string GetTodayLogPrefix() {
+            SYSTEMTIME st;
+            GetLocalTime(&st);
+            char buf[32] = {0};
+            snprintf(buf, sizeof(buf), "proxy-%04u%02u%02u",
+                     (unsigned)st.wYear, (unsigned)st.wMonth, (unsigned)st.wDay);
+            return std::string(buf);
         }
 
-        static ULONGLONG GetFileSizeBytes(const std::string& path) {
-            WIN32_FILE_ATTRIBUTE_DATA data{};
-            if (!GetFileAttributesExA(path.c_str(), GetFileExInfoStandard, &data)) {
-                return 0;
-            }
-            return (static_cast<ULONGLONG>(data.nFileSizeHigh) << 32) | data.nFileSizeLow;
+        static std::string GetLogPathInDir(const std::string& name) {
+            const std::string logDir = GetLogDirectory();
+            return logDir.empty() ? name : (logDir + "\\" + name);
+        }
+
+        // 本进程今日日志完整路径（如：C:\xxx\logs\proxy-20260111-1234-093015.log）
+        static std::string GetProcessLogPath(const char* ext) {
+            return GetLogPathInDir(GetTodayLogPrefix() + "-" + GetProcessLogTag() + ext);
         }
 
-        // 清理旧日志文件，只保留当天的日志
-        static void CleanupOldLogs(const std::string& todayLog) {
-            std::string logDir = GetLogDirectory();
-            // 构建搜索模式（支持有/无日志目录两种情况）
-            std::string searchPattern = logDir.empty() 
-                ? "proxy-*.log" 
-                : (logDir + "\\proxy-*.log");
-            
+        static bool EndsWith(const char* name, const char* suffix) {
+            const size_t n = strlen(name);
+            const size_t m = strlen(suffix);
+            return n >= m && _stricmp(name + n - m, suffix) == 0;
+        }
+
+        // 清理日志文件集合（文本 .log 与二进制 .blog 一并处理；抓包 .pcapng 与连接时间线 .trace.json 只按日期清理）：
+        // - 删除非今日的文件
+        // - 今日文件总大小超过 kMaxLogSetBytes 时，按最后写入时间从旧到新删除（本进程自己的文件除外）
+        // 其他进程正在写的文件未共享删除权限，DeleteFileA 会失败并跳过，不会删掉活跃进程的日志
+        static void CleanupLogSet() {
+            static const ULONGLONG kMaxLogSetBytes = 50ull * 1024 * 1024; // 50MB
+            struct Candidate {
+                std::string path;
+                ULONGLONG size;
+                ULONGLONG lastWrite;
+            };
+
+            const std::string todayPrefix = GetTodayLogPrefix();
+            const std::string ownText = GetProcessLogPath(".log");
+            const std::string ownBinary = GetProcessLogPath(".blog");
+            const std::string ownTraffic = GetProcessLogPath(".traffic.log");
+            std::vector<Candidate> today;
+            ULONGLONG total = 0;
+
             WIN32_FIND_DATAA findData{};
-            HANDLE hFind = FindFirstFileA(searchPattern.c_str(), &findData);
+            HANDLE hFind = FindFirstFileA(GetLogPathInDir("proxy-*").c_str(), &findData);
             if (hFind != INVALID_HANDLE_VALUE) {
                 do {
-                    if (findData.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) {
-                        continue;
-                    }
-                    // 构建找到文件的完整路径
-                    std::string fullPath = logDir.empty() 
-                        ? std::string(findData.cFileName) 
-                        : (logDir + "\\" + findData.cFileName);
-                    
-                    // 保留今天的日志，删除其他日期的
-                    if (todayLog != fullPath) {
+                    if (findData.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) continue;
+                    const bool isLog = EndsWith(findData.cFileName, ".log") || EndsWith(findData.cFileName, ".blog");
+                    const bool isCapture = EndsWith(findData.cFileName, ".pcapng") || EndsWith(findData.cFileName, ".trace.json");
+                    if (!isLog && !isCapture) continue;
+                    const std::string fullPath = GetLogPathInDir(findData.cFileName);
+                    if (strncmp(findData.cFileName, todayPrefix.c_str(), todayPrefix.size()) != 0) {
                         DeleteFileA(fullPath.c_str());
+                        continue;
                     }
+                    if (isCapture) continue; // 抓包/时间线文件有独立的大小上限，不计入日志集合
+                    const ULONGLONG size = (static_cast<ULONGLONG>(findData.nFileSizeHigh) << 32) | findData.nFileSizeLow;
+                    total += size;
+                    if (fullPath == ownText || fullPath == ownBinary || fullPath == ownTraffic) continue;
+                    const ULONGLONG lastWrite = (static_cast<ULONGLONG>(findData.ftLastWriteTime.dwHighDateTime) << 32) |
+                                                findData.ftLastWriteTime.dwLowDateTime;
+                    today.push_back(Candidate{fullPath, size, lastWrite});
                 } while (FindNextFileA(hFind, &findData));
                 FindClose(hFind);
             }
+
+            if (total > kMaxLogSetBytes) {
+                std::sort(today.begin(), today.end(), [](const Candidate& a, const Candidate& b) {
+                    return a.lastWrite < b.lastWrite;
+                });
+                for (const Candidate& c : today) {
+                    if (total <= kMaxLogSetBytes) break;
+                    if (DeleteFileA(c.path.c_str())) total -= c.size;
+                }
+            }
+
             // 清理旧版日志文件（无日期后缀的遗留文件）
-            std::string oldLog = logDir.empty() ? "proxy.log" : (logDir + "\\proxy.log");
-            std::string oldLog1 = logDir.empty() ? "proxy.log.1" : (logDir + "\\proxy.log.1");
-            if (todayLog != oldLog) {
-                DeleteFileA(oldLog.c_str());
+            DeleteFileA(GetLogPathInDir("proxy.log").c_str());
+            DeleteFileA(GetLogPathInDir("proxy.log.1").c_str());
+        }
+
+        // ========== 日志文件写入（sink） ==========
+        // 设计意图：文件句柄常驻打开，按批写入；文件为本进程独占写入，大小在进程内跟踪，无需每批查询
+
+        struct LogFileState {
+            HANDLE handle = INVALID_HANDLE_VALUE;
+            std::string path;
+            ULONGLONG size = 0;
+        };
+
+        static LogFileState& FileState() {
+            static LogFileState s_state;
+            return s_state;
+        }
+
+        // 保护 FileState：写线程与同步降级路径可能同时写入
+        // 使用限时锁：进程终止时写线程可能在持锁状态下被系统结束，同步路径不能因此永久阻塞
+        static std::timed_mutex& SinkMutex() {
+            static std::timed_mutex s_mtx;
+            return s_mtx;
+        }
+
+        static void CloseLogFile(LogFileState& state) {
+            if (state.handle != INVALID_HANDLE_VALUE) {
+                CloseHandle(state.handle);
+                state.handle = INVALID_HANDLE_VALUE;
             }
-            DeleteFileA(oldLog1.c_str());
         }
 
-        static void WriteToFile(const std::string& message) {
-            // 按日期写日志并清理旧文件，避免历史日志堆积
-            static std::string s_todayLog;
+        // 打开本进程的日志文件并定位到末尾；只共享读权限：其他进程可查看，但无法写入或删除
+        static HANDLE OpenProcessLogFile(const std::string& path, ULONGLONG* size) {
+            HANDLE handle = CreateFileA(path.c_str(), GENERIC_WRITE, FILE_SHARE_READ,
+                                        NULL, OPEN_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL);
+            if (handle == INVALID_HANDLE_VALUE) return handle;
+            LARGE_INTEGER current{};
+            LARGE_INTEGER zero{};
+            SetFilePointerEx(handle, zero, NULL, FILE_END);
+            *size = GetFileSizeEx(handle, &current) ? (ULONGLONG)current.QuadPart : 0;
+            return handle;
+        }
+
+        // 截断为空文件（单文件达到上限时覆盖写入）
+        static void TruncateLogFile(HANDLE handle) {
+            LARGE_INTEGER zero{};
+            SetFilePointerEx(handle, zero, NULL, FILE_BEGIN);
+            SetEndOfFile(handle);
+        }
+
+        // 写入一批日志（data 由若干以 '\n' 结尾的行组成）；调用方须持有 SinkMutex
+        static void WriteBatchToFileLocked(const std::string& data) {
+            if (data.empty()) return;
             // 需求：单文件 10MB 达到即覆盖写入（不轮转、不备份）
             static const ULONGLONG kMaxLogBytes = 10ull * 1024 * 1024; // 10MB
 
-            // 多进程注入场景：使用跨进程互斥量保证“检查+截断+写入”的原子性
-            HANDLE hMutex = GetCrossProcessLogMutex();
-            DWORD waitRc = WAIT_FAILED;
-            if (hMutex) {
-                waitRc = WaitForSingleObject(hMutex, INFINITE);
+            // 按日期写日志：跨天时关闭旧句柄并清理日志集合，避免历史日志堆积
+            LogFileState& state = FileState();
+            const std::string path = GetProcessLogPath(".log");
+            if (state.path != path) {
+                CloseLogFile(state);
+                state.path = path;
+                CleanupLogSet();
+            }
+            if (state.handle == INVALID_HANDLE_VALUE) {
+                state.handle = OpenProcessLogFile(state.path, &state.size);
+                if (state.handle == INVALID_HANDLE_VALUE) return;
+            }
+
+            // 判断本次写入是否会超过上限；超过则直接截断覆盖写入，并重新检查集合总大小
+            if (state.size > 0 && state.size + data.size() > kMaxLogBytes) {
+                TruncateLogFile(state.handle);
+                state.size = 0;
+                CleanupLogSet();
+            }
+            DWORD written = 0;
+            if (!WriteFile(state.handle, data.data(), (DWORD)data.size(), &written, NULL)) {
+                // 句柄失效：下一批重新打开
+                CloseLogFile(state);
+                return;
+            }
+            state.size += written;
+        }
+
+        // 同步写入（写线程未运行/已停止时的降级路径）
+        static void WriteToFileSync(const std::string& message) {
+            std::unique_lock<std::timed_mutex> lock(SinkMutex(), std::chrono::milliseconds(100));
+            if (!lock.owns_lock()) return;
+            WriteBatchToFileLocked(message + "\n");
+        }
+
+        // ========== 异步写线程 ==========
+        // 设计意图：日志调用只做格式化与入队；磁盘 I/O、跨天与截断都在专用写线程里按批完成
+
+        using AsyncWriter = AsyncLogWriter<4096>;
+
+        static void WriteBatchSink(const std::string& batch, uint64_t droppedSinceLast) {
+            std::unique_lock<std::timed_mutex> lock(SinkMutex(), std::chrono::milliseconds(100));
+            if (!lock.owns_lock()) return;
+            if (droppedSinceLast == 0) {
+                WriteBatchToFileLocked(batch);
+                return;
+            }
+            std::string data = batch;
+            data += "[" + GetTimestamp() + "] " + GetPidTidPrefix() + " [警告] 日志队列已满，已丢弃 " +
+                    std::to_string(droppedSinceLast) + " 条日志\n";
+            WriteBatchToFileLocked(data);
+        }
+
+        static AsyncWriter& Writer() {
+            static AsyncWriter s_writer(&Logger::WriteBatchSink);
+            return s_writer;
+        }
+
+        static DWORD WINAPI WriterThreadProc(LPVOID) {
+            RegisterFlightDumpTrigger(); // 在写线程中注册：DllMain 持有加载器锁期间不宜创建线程池等待
+            Writer().RunWriterLoop();
+            return 0;
+        }
+
+        static LPTOP_LEVEL_EXCEPTION_FILTER& PrevExceptionFilter() {
+            static LPTOP_LEVEL_EXCEPTION_FILTER s_prev = NULL;
+            return s_prev;
+        }
+
+        // 崩溃路径：先把队列中的日志同步冲刷到文件，再交给原有的异常过滤器
+        static LONG WINAPI CrashFlushFilter(EXCEPTION_POINTERS* info) {
+            DumpFlight("未处理异常", false);
+            Writer().Drain(200);
+            BinaryWriter().Drain(200);
+            if (info && info->ExceptionRecord) {
+                char code[16] = {0};
+                snprintf(code, sizeof(code), "0x%08lX", (unsigned long)info->ExceptionRecord->ExceptionCode);
+                WriteToFileSync("[" + GetTimestamp() + "] " + GetPidTidPrefix() + " [错误] 进程发生未处理异常: " + code);
+            }
+            LPTOP_LEVEL_EXCEPTION_FILTER prev = PrevExceptionFilter();
+            return prev ? prev(info) : EXCEPTION_CONTINUE_SEARCH;
+        }
+
+        static void EnsureWriterStarted() {
+            static std::once_flag s_once;
+            std::call_once(s_once, []() {
+                AsyncWriter& writer = Writer();
+                writer.BeginAccepting();
+                // 使用 CreateThread：可在 DllMain 中调用（线程在加载器锁释放后才开始运行，期间日志先入队）
+                HANDLE thread = CreateThread(NULL, 0, &Logger::WriterThreadProc, NULL, 0, NULL);
+                if (!thread) {
+                    writer.RequestStop(); // 创建失败：全部走同步写入
+                    return;
+                }
+                CloseHandle(thread);
+                PrevExceptionFilter() = SetUnhandledExceptionFilter(&Logger::CrashFlushFilter);
+            });
+        }
+
+        static void WriteLine(std::string&& line, LogLevel level) {
+            EnsureWriterStarted();
+            const bool important = static_cast<int>(level) >= static_cast<int>(LogLevel::Warn);
+            if (Writer().Submit(std::move(line), important) == AsyncWriter::SubmitResult::NotRunning) {
+                WriteToFileSync(line);
+            }
+        }
+
+        // ========== 二进制结构化日志 ==========
+        // 设计意图：热路径只编码“事件 ID + 原始参数”（无时间格式化、无数字转字符串），由 blog_decode 离线渲染
+        // 与文本日志同名不同后缀（proxy-YYYYMMDD-<PID>-<HHMMSS>.blog）：字符串驻留 ID 是进程内的
+        // 每次打开/截断文件都先写会话头（魔数 + 事件目录 + 已驻留字符串），保证单个文件可独立解码
+
+        static std::atomic<int>& FormatStorage() {
+            static std::atomic<int> s_format{static_cast<int>(LogFormat::Text)};
+            return s_format;
+        }
+
+        static StringInterner& Interner() {
+            static StringInterner s_interner;
+            return s_interner;
+        }
+
+        static LogFileState& BinaryFile() {
+            static LogFileState s_state;
+            return s_state;
+        }
+
+        static bool WriteBinaryBytes(LogFileState& state, const std::string& data) {
+            DWORD written = 0;
+            if (!WriteFile(state.handle, data.data(), (DWORD)data.size(), &written, NULL)) {
+                CloseHandle(state.handle);
+                state.handle = INVALID_HANDLE_VALUE;
+                return false;
+            }
+            state.size += written;
+            return true;
+        }
+
+        // 仅由二进制写线程（或同步冲刷路径，经消费锁串行化）调用
+        static void WriteBinaryBatchSink(const std::string& batch, uint64_t droppedSinceLast) {
+            static const ULONGLONG kMaxLogBytes = 10ull * 1024 * 1024; // 与文本日志一致：10MB 即覆盖写入
+            LogFileState& state = BinaryFile();
+            const std::string path = GetProcessLogPath(".blog");
+            if (state.path != path) {
+                if (state.handle != INVALID_HANDLE_VALUE) CloseHandle(state.handle);
+                state.handle = INVALID_HANDLE_VALUE;
+                state.path = path;
+                CleanupLogSet();
+            }
+            bool needHeader = false;
+            if (state.handle == INVALID_HANDLE_VALUE) {
+                state.handle = OpenProcessLogFile(state.path, &state.size);
+                if (state.handle == INVALID_HANDLE_VALUE) return;
+                needHeader = true; // 跨天或句柄失效后重新打开：追加新会话
             }
-            const bool locked = (hMutex != NULL) && (waitRc == WAIT_OBJECT_0 || waitRc == WAIT_ABANDONED);
 
-            // 如果跨进程互斥不可用，退化为进程内互斥，保证不崩溃（但多进程一致性会弱一些）
-            static std::mutex s_fallbackMtx;
-            std::unique_lock<std::mutex> fallbackLock;
-            if (!locked) {
-                fallbackLock = std::unique_lock<std::mutex>(s_fallbackMtx);
+            std::string data;
+            if (state.size > 0 && state.size + batch.size() > kMaxLogBytes) {
+                TruncateLogFile(state.handle);
+                state.size = 0;
+                needHeader = true;
+                CleanupLogSet();
             }
+            if (needHeader) BinLog::AppendSessionHeader(data, &Interner());
+            data += batch;
+            if (droppedSinceLast > 0) {
+                const auto arg = MakeLogArgs(droppedSinceLast);
+                BinLog::AppendEventRecord(data, &Interner(), LogEvent::LogDropped, LogLevel::Warn, NowUnixMicros(),
+                                          GetCurrentProcessId(), GetCurrentThreadId(), arg.data(), arg.size());
+            }
+            WriteBinaryBytes(state, data);
+        }
+
+        static AsyncWriter& BinaryWriter() {
+            static AsyncWriter s_writer(&Logger::WriteBinaryBatchSink, false);
+            return s_writer;
+        }
+
+        static DWORD WINAPI BinaryWriterThreadProc(LPVOID) {
+            BinaryWriter().RunWriterLoop();
+            return 0;
+        }
+
+        // 二进制写线程只在首次输出二进制事件时启动（默认文本模式不额外占用线程）
+        static void EnsureBinaryWriterStarted() {
+            static std::once_flag s_once;
+            std::call_once(s_once, []() {
+                AsyncWriter& writer = BinaryWriter();
+                writer.BeginAccepting();
+                HANDLE thread = CreateThread(NULL, 0, &Logger::BinaryWriterThreadProc, NULL, 0, NULL);
+                if (!thread) {
+                    writer.RequestStop(); // 创建失败：结构化事件回退为文本输出
+                    return;
+                }
+                CloseHandle(thread);
+            });
+        }
+
+        // ========== 流量采样（独立文件） ==========
+        // 采样的负载预览写入 proxy-YYYYMMDD-<PID>-<HHMMSS>.traffic.log，不混入主日志；写线程在首次采样时启动
+
+        static LogFileState& TrafficFile() {
+            static LogFileState s_state;
+            return s_state;
+        }
+
+        // 仅由采样写线程（或卸载时的 Drain，经消费锁串行化）调用
+        static void WriteTrafficBatchSink(const std::string& batch, uint64_t droppedSinceLast) {
+            static const ULONGLONG kMaxLogBytes = 10ull * 1024 * 1024; // 与文本日志一致：10MB 即覆盖写入
+            LogFileState& state = TrafficFile();
+            const std::string path = GetProcessLogPath(".traffic.log");
+            if (state.path != path) {
+                CloseLogFile(state);
+                state.path = path;
+            }
+            if (state.handle == INVALID_HANDLE_VALUE) {
+                state.handle = OpenProcessLogFile(state.path, &state.size);
+                if (state.handle == INVALID_HANDLE_VALUE) return;
+            }
+            std::string data = batch;
+            if (droppedSinceLast > 0) {
+                data += "[" + GetTimestamp() + "] " + GetPidTidPrefix() + " [警告] 采样队列已满，已丢弃 " +
+                        std::to_string(droppedSinceLast) + " 条采样\n";
+            }
+            if (state.size > 0 && state.size + data.size() > kMaxLogBytes) {
+                TruncateLogFile(state.handle);
+                state.size = 0;
+            }
+            WriteBinaryBytes(state, data);
+        }
+
+        static AsyncWriter& TrafficWriter() {
+            static AsyncWriter s_writer(&Logger::WriteTrafficBatchSink);
+            return s_writer;
+        }
 
-            std::string todayLog = GetTodayLogName();
-            if (s_todayLog != todayLog) {
-                s_todayLog = todayLog;
-                CleanupOldLogs(s_todayLog);
+        static DWORD WINAPI TrafficWriterThreadProc(LPVOID) {
+            TrafficWriter().RunWriterLoop();
+            return 0;
+        }
+
+        static void EnsureTrafficWriterStarted() {
+            static std::once_flag s_once;
+            std::call_once(s_once, []() {
+                AsyncWriter& writer = TrafficWriter();
+                writer.BeginAccepting();
+                HANDLE thread = CreateThread(NULL, 0, &Logger::TrafficWriterThreadProc, NULL, 0, NULL);
+                if (!thread) {
+                    writer.RequestStop(); // 创建失败：之后的采样直接丢弃
+                    return;
+                }
+                CloseHandle(thread);
+            });
+        }
+
+        static uint64_t NowUnixMicros() {
+            FILETIME ft;
+            GetSystemTimeAsFileTime(&ft);
+            const uint64_t ticks = ((uint64_t)ft.dwHighDateTime << 32) | ft.dwLowDateTime; // 100ns，自 1601 年
+            return (ticks - 116444736000000000ull) / 10;
+        }
+
+        static void EmitEvent(LogEvent ev, const LogEventInfo& info, const LogArg* args, size_t count) {
+            if (GetFormat() == LogFormat::Binary) {
+                EnsureBinaryWriterStarted();
+                std::string record;
+                record.reserve(96);
+                const bool defined = BinLog::AppendEventRecord(record, &Interner(), ev, info.level, NowUnixMicros(),
+                                                               GetCurrentProcessId(), GetCurrentThreadId(), args, count);
+                // 含字符串定义的记录按重要行入队：定义一旦丢失，后续引用只能显示为 <str#?>
+                const bool important = defined || static_cast<int>(info.level) >= static_cast<int>(LogLevel::Warn);
+                if (BinaryWriter().Submit(std::move(record), important) != AsyncWriter::SubmitResult::NotRunning) {
+                    return;
+                }
             }
+            std::string line = "[" + GetTimestamp() + "] " + GetPidTidPrefix() + " " + LogLevelTag(info.level) + " ";
+            FormatLogEvent(line, info.format, args, count);
+            WriteLine(std::move(line), info.level);
+        }
+
+        // ========== 飞行记录器 ==========
+        // 设计意图：常开记录最近的紧凑事件（只写本线程的内存环，不格式化、不写盘），
+        // 出错（[错误] 日志、FakeIP 查询未命中等）或按需时才把这段上下文渲染进日志
 
-            // 判断本次写入是否会超过上限；超过则直接截断覆盖写入
-            const ULONGLONG currentSize = GetFileSizeBytes(s_todayLog);
-            const ULONGLONG appendBytes = static_cast<ULONGLONG>(message.size() + 1); // + '\n'
-            const bool needTruncate = (currentSize > 0 && (currentSize + appendBytes) > kMaxLogBytes);
+        static uint32_t CurrentThreadId() {
+            return static_cast<uint32_t>(GetCurrentThreadId());
+        }
 
-            std::ofstream logFile;
-            if (needTruncate) {
-                logFile.open(s_todayLog, std::ios::out | std::ios::trunc);
-            } else {
-                logFile.open(s_todayLog, std::ios::out | std::ios::app);
+        // 进程生命周期内不析构：线程退出时仍可能归还环
+        static FlightRecorder& Recorder() {
+            static FlightRecorder* s_recorder = new FlightRecorder(&Logger::NowUnixMicros, &Logger::CurrentThreadId);
+            return *s_recorder;
+        }
+
+        struct FlightDumpState {
+            std::atomic<bool> dumpOnError{true};
+            std::atomic<int> maxEvents{200};
+            std::atomic<int> intervalMs{10000};
+            HANDLE triggerEvent = NULL;
+            HANDLE triggerWait = NULL;
+
+            std::mutex mtx;           // 保护以下字段；转储互斥（并发触发时只有一个线程转储）
+            uint64_t lastDumpUs = 0;  // 上次转储时间（限频）
+            uint64_t dumpedUpToUs = 0; // 已转储事件的最大时间戳（下次只转储更新的事件）
+            uint64_t suppressed = 0;  // 限频期间跳过的触发次数
+        };
+
+        static FlightDumpState& FlightDump() {
+            static FlightDumpState s_state;
+            return s_state;
+        }
+
+        // 转储为一条多行日志：首行带时间戳，事件行缩进（log_merge 合并时视为续行，整段保持在一起）
+        // rateLimited：错误触发的转储按 intervalMs 限频；按需/崩溃转储不限频
+        static void DumpFlight(const std::string& reason, bool rateLimited) {
+            FlightRecorder& recorder = Recorder();
+            if (!recorder.IsEnabled()) return;
+            FlightDumpState& st = FlightDump();
+            std::unique_lock<std::mutex> lock(st.mtx, std::try_to_lock);
+            if (!lock.owns_lock()) return; // 其他线程正在转储，本次触发的上下文已包含在内
+
+            const uint64_t now = NowUnixMicros();
+            const uint64_t intervalUs = (uint64_t)st.intervalMs.load(std::memory_order_relaxed) * 1000;
+            if (rateLimited && st.lastDumpUs != 0 && now - st.lastDumpUs < intervalUs) {
+                ++st.suppressed;
+                return;
             }
-            if (logFile.is_open()) {
-                logFile << message << "\n";
+            const size_t maxEvents = (size_t)st.maxEvents.load(std::memory_order_relaxed);
+            const std::vector<FlightRecorder::Entry> entries = recorder.Collect(st.dumpedUpToUs, maxEvents);
+            std::string text = "[" + GetTimestamp() + "] " + GetPidTidPrefix() + " [警告] 飞行记录: 原因=" + reason +
+                               ", 事件=" + std::to_string(entries.size());
+            if (st.suppressed > 0) text += ", 限频跳过=" + std::to_string(st.suppressed);
+            if (recorder.UnrecordedThreads() > 0) text += ", 未记录线程=" + std::to_string(recorder.UnrecordedThreads());
+            if (entries.empty()) text += " (自上次转储以来无新事件)";
+            st.lastDumpUs = now;
+            st.suppressed = 0;
+            if (!entries.empty()) {
+                st.dumpedUpToUs = entries.back().tsUs;
+                text.push_back('\n');
+                FlightRecorder::AppendEntries(text, entries, "    ");
+                text.pop_back();
             }
+            WriteLine(std::move(text), LogLevel::Warn);
+        }
+
+        // 外部按需触发：命名事件 Local\AntigravityProxy_FlightDump_<PID>，置位后由线程池回调转储
+        static VOID CALLBACK FlightDumpCallback(PVOID, BOOLEAN) {
+            DumpFlight("按需", false);
+        }
 
-            if (locked) {
-                ReleaseMutex(hMutex);
+        static void RegisterFlightDumpTrigger() {
+            FlightDumpState& st = FlightDump();
+            const std::string name = "Local\\AntigravityProxy_FlightDump_" + std::to_string(GetCurrentProcessId());
+            st.triggerEvent = CreateEventA(NULL, FALSE, FALSE, name.c_str());
+            if (!st.triggerEvent) return;
+            if (!RegisterWaitForSingleObject(&st.triggerWait, st.triggerEvent, &Logger::FlightDumpCallback, NULL,
+                                             INFINITE, WT_EXECUTEDEFAULT)) {
+                st.triggerWait = NULL;
+                CloseHandle(st.triggerEvent);
+                st.triggerEvent = NULL;
             }
         }
 
     public:
         // 判断某个等级的日志是否会输出（用于调用方做“懒构造字符串”，减少性能开销）
+        // 不带模块的调用按 General 模块判断（即全局 log_level，除非显式配置了 general）
+        // 编译期已剔除的等级（AGP_LOG_MIN_LEVEL）恒为 false
         static bool IsEnabled(LogLevel level) {
-            const int threshold = LevelStorage().load(std::memory_order_relaxed);
-            return static_cast<int>(level) >= threshold;
+            return IsEnabled(LogModule::General, level);
+        }
+
+        static bool IsEnabled(LogModule module, LogLevel level) {
+            return IsLogLevelCompiledIn(level) && Levels().IsEnabled(module, level);
         }
 
         static LogLevel GetLevel() {
-            return static_cast<LogLevel>(LevelStorage().load(std::memory_order_relaxed));
+            return Levels().Global();
         }
 
         static void SetLevel(LogLevel level) {
-            LevelStorage().store(static_cast<int>(level), std::memory_order_relaxed);
+            Levels().SetGlobal(level);
         }
 
         // 从字符串设置日志等级；返回是否识别成功（不识别则不修改当前等级）
@@ -314,30 +726,321 @@ namespace Core {
             return true;
         }
 
+        // 模块生效等级（未单独设置时等于全局等级）
+        static LogLevel GetModuleLevel(LogModule module) {
+            return Levels().Effective(module);
+        }
+
+        static void SetModuleLevel(LogModule module, LogLevel level) {
+            Levels().SetModule(module, level);
+        }
+
+        // 从字符串设置模块等级；返回是否识别成功（不识别则不修改）
+        static bool SetModuleLevelFromString(LogModule module, const std::string& levelStr) {
+            LogLevel parsed;
+            if (!TryParseLevelFromString(levelStr, &parsed)) {
+                return false;
+            }
+            SetModuleLevel(module, parsed);
+            return true;
+        }
+
+        // 清除全部模块覆盖（配置重新加载时先清空，再按新配置设置）
+        static void ClearModuleLevels() {
+            Levels().ClearAllModules();
+        }
+
+        static LogFormat GetFormat() {
+            return static_cast<LogFormat>(FormatStorage().load(std::memory_order_relaxed));
+        }
+
+        static void SetFormat(LogFormat format) {
+            FormatStorage().store(static_cast<int>(format), std::memory_order_relaxed);
+        }
+
+        // 从字符串设置结构化事件输出格式（text/binary）；返回是否识别成功（不识别则不修改）
+        static bool SetFormatFromString(const std::string& formatStr) {
+            std::string s = formatStr;
+            std::transform(s.begin(), s.end(), s.begin(), [](unsigned char c) { return (char)std::tolower(c); });
+            if (s == "text") {
+                SetFormat(LogFormat::Text);
+                return true;
+            }
+            if (s == "binary") {
+                SetFormat(LogFormat::Binary);
+                return true;
+            }
+            return false;
+        }
+
+        // 结构化事件：格式串、模块与等级来自 LogEvents.hpp 的事件目录，参数按原始类型记录
+        // 示例：Logger::Event(LogEvent::CloseSocketDone, s);
+        // 热路径优先用 AGP_LOG_EVENT：未启用时连参数都不求值，且可在编译期剔除
+        template <typename... Args>
+        static void Event(LogEvent ev, const Args&... args) {
+            const LogEventInfo& info = GetLogEventInfo(ev);
+            if (!IsEnabled(info.module, info.level)) return;
+            const auto packed = MakeLogArgs(args...);
+            EmitEvent(ev, info, packed.data(), packed.size());
+        }
+
+        // 无条件输出已打包参数的结构化事件（等级判断由调用方完成，供 AGP_LOG_EVENT 使用）
+        static void WriteEvent(LogEvent ev, const LogArg* args, size_t count) {
+            EmitEvent(ev, GetLogEventInfo(ev), args, count);
+        }
+
+        // ========== 飞行记录器 ==========
+        static bool IsFlightRecorderEnabled() {
+            return Recorder().IsEnabled();
+        }
+
+        // 只写入飞行记录器，不输出日志；热路径优先用 AGP_FLIGHT_RECORD（未启用时不求值参数）
+        static void FlightRecord(LogEvent ev, const LogArg* args, size_t count) {
+            Recorder().Record(ev, args, count);
+        }
+
+        template <typename... Args>
+        static void FlightRecord(LogEvent ev, const Args&... args) {
+            Recorder().Record(ev, args...);
+        }
+
+        // enabled=false 时不再记录（已记录的内容仍可转储）；dumpEvents > 0、dumpIntervalMs >= 0 由调用方保证（0 表示不限频）
+        static void ConfigureFlightRecorder(bool enabled, bool dumpOnError, int dumpEvents, int dumpIntervalMs) {
+            Recorder().SetEnabled(enabled);
+            FlightDumpState& st = FlightDump();
+            st.dumpOnError.store(dumpOnError, std::memory_order_relaxed);
+            st.maxEvents.store(dumpEvents, std::memory_order_relaxed);
+            st.intervalMs.store(dumpIntervalMs, std::memory_order_relaxed);
+        }
+
+        // 按需转储（不限频）：输出自上次转储以来的最近事件
+        static void DumpFlightRecorder(const std::string& reason) {
+            DumpFlight(reason, false);
+        }
+
+        // 故障点触发转储（按 dump_interval_ms 限频，受 dump_on_error 控制）
+        // [错误] 日志会自动触发；警告级别的关键故障（如 FakeIP 查询未命中）由调用点显式触发
+        static void TriggerFlightDump(const std::string& reason) {
+            if (!FlightDump().dumpOnError.load(std::memory_order_relaxed)) return;
+            DumpFlight(reason, true);
+        }
+
+        // ========== 调用点限流 ==========
+        // 每个 AGP_LOG_LIMITED* 调用点一个令牌桶：突发 burst 条后按 perMinute 条/分钟放行，被抑制的条数定期汇总输出
+        // 模块已打开 Debug 时不限流（排障时需要完整输出）
+
+        struct RateLimitParams {
+            std::atomic<uint32_t> burst{20};
+            std::atomic<uint32_t> perMinute{6};
+        };
+
+        static RateLimitParams& RateLimit() {
+            static RateLimitParams s_params;
+            return s_params;
+        }
+
+        // burst > 0、perMinute >= 0 由调用方保证
+        static void ConfigureRateLimit(int burst, int perMinute) {
+            RateLimit().burst.store((uint32_t)burst, std::memory_order_relaxed);
+            RateLimit().perMinute.store((uint32_t)perMinute, std::memory_order_relaxed);
+        }
+
+        static std::string FormatSuppressed(const LogRateLimiter& limiter, uint64_t suppressed, uint64_t windowMs) {
+            const char* site = limiter.Site(); // __FILE__ 可能是完整路径：只保留文件名
+            for (const char* p = site; *p; ++p) {
+                if (*p == '\\' || *p == '/') site = p + 1;
+            }
+            return "[限流] 过去 " + std::to_string((windowMs + 500) / 1000) + " 秒内抑制了 " + std::to_string(suppressed) +
+                   " 条同类日志 (" + site + ")";
+        }
+
+        // 该调用点本次是否输出；到期时先写出抑制汇总
+        static bool AllowLimited(LogRateLimiter& limiter) {
+            const LogModule module = limiter.Module();
+            const LogLevel level = limiter.Level();
+            if (!IsEnabled(module, level)) return false;
+            if (IsEnabled(module, LogLevel::Debug)) return true;
+            const RateLimitParams& params = RateLimit();
+            const LogRateLimiter::Decision d = limiter.Acquire(GetTickCount64(), params.burst.load(std::memory_order_relaxed),
+                                                              params.perMinute.load(std::memory_order_relaxed));
+            if (d.suppressed > 0) Write(level, FormatSuppressed(limiter, d.suppressed, d.windowMs));
+            return d.allowed;
+        }
+
+        // 输出全部调用点尚未汇报的抑制计数（退出前调用，不等汇总周期）
+        static void FlushSuppressed() {
+            const uint64_t now = GetTickCount64();
+            LogRateLimiter::ForEach([now](LogRateLimiter& limiter) {
+                LogRateLimiter::Decision d;
+                if (limiter.TakeSummary(now, true, &d) && IsEnabled(limiter.Module(), limiter.Level())) {
+                    Write(limiter.Level(), FormatSuppressed(limiter, d.suppressed, d.windowMs));
+                }
+            });
+        }
+
+        // 写入一条流量采样（独立文件，不经主日志）；队列满或写线程未运行时直接丢弃
+        static void WriteTrafficSample(const std::string& message) {
+            EnsureTrafficWriterStarted();
+            TrafficWriter().Submit("[" + GetTimestamp() + "] " + GetPidTidPrefix() + " " + message, false);
+        }
+
+        // 本进程的其他输出文件（与日志同目录、同命名规则，如 ".pcapng"）
+        static std::string GetProcessOutputPath(const char* ext) {
+            return GetProcessLogPath(ext);
+        }
+
+        // 日志目录下各进程共用的文件（不带日期与进程标识，不参与日志清理，如 "route-prefs.txt"）
+        static std::string GetSharedOutputPath(const std::string& name) {
+            return GetLogPathInDir(name);
+        }
+
+        // 各异步队列因写满而丢弃的条数（累计值，供指标端点读取）
+        struct DropCounts {
+            uint64_t text = 0;
+            uint64_t binary = 0;
+            uint64_t traffic = 0;
+        };
+
+        static DropCounts GetDropCounts() {
+            DropCounts d;
+            d.text = Writer().Dropped();
+            d.binary = BinaryWriter().Dropped();
+            d.traffic = TrafficWriter().Dropped();
+            return d;
+        }
+
+        // 同步冲刷队列中已有的日志（不停止写线程）
+        static void Flush() {
+            Writer().Drain(200);
+            BinaryWriter().Drain(200);
+        }
+
+        // DLL 卸载时调用：停止接收异步日志（之后的日志走同步写入）并冲刷队列
+        // processTerminating：进程正在退出（DllMain 的 lpvReserved != NULL），此时写线程已被系统终止，不再等待
+        static void Shutdown(bool processTerminating) {
+            FlushSuppressed();
+            FlightDumpState& st = FlightDump();
+            if (st.triggerWait && !processTerminating) {
+                // 等待进行中的回调结束，避免 DLL 卸载后线程池仍执行本模块代码
+                UnregisterWaitEx(st.triggerWait, INVALID_HANDLE_VALUE);
+                st.triggerWait = NULL;
+                CloseHandle(st.triggerEvent);
+                st.triggerEvent = NULL;
+            }
+            for (AsyncWriter* writer : {&Writer(), &BinaryWriter(), &TrafficWriter()}) {
+                if (!writer->IsAccepting()) continue;
+                writer->RequestStop();
+                if (!processTerminating) {
+                    writer->WaitStopped(500);
+                }
+                writer->Drain(200);
+            }
+        }
+
         static void Log(const std::string& message) {
             // 将无等级的 Log 视为 Info 级别，确保可被 log_level 控制
             if (!IsEnabled(LogLevel::Info)) return;
-            WriteToFile("[" + GetTimestamp() + "] " + GetPidTidPrefix() + " " + message);
+            WriteLine("[" + GetTimestamp() + "] " + GetPidTidPrefix() + " " + message, LogLevel::Info);
         }
 
         static void Error(const std::string& message) {
             if (!IsEnabled(LogLevel::Error)) return;
-            WriteToFile("[" + GetTimestamp() + "] " + GetPidTidPrefix() + " [错误] " + message);
+            Write(LogLevel::Error, message);
         }
 
         static void Info(const std::string& message) {
             if (!IsEnabled(LogLevel::Info)) return;
-            WriteToFile("[" + GetTimestamp() + "] " + GetPidTidPrefix() + " [信息] " + message);
+            Write(LogLevel::Info, message);
         }
 
         static void Warn(const std::string& message) {
             if (!IsEnabled(LogLevel::Warn)) return;
-            WriteToFile("[" + GetTimestamp() + "] " + GetPidTidPrefix() + " [警告] " + message);
+            Write(LogLevel::Warn, message);
         }
 
         static void Debug(const std::string& message) {
             if (!IsEnabled(LogLevel::Debug)) return;
-            WriteToFile("[" + GetTimestamp() + "] " + GetPidTidPrefix() + " [调试] " + message);
+            Write(LogLevel::Debug, message);
+        }
+
+        // 无条件写出一行（等级判断由调用方完成，供 AGP_LOG_* 宏使用）
+        // [错误] 日志随后附上飞行记录（限频），提供出错前的调试级上下文
+        static void Write(LogLevel level, const std::string& message) {
+            WriteLine("[" + GetTimestamp() + "] " + GetPidTidPrefix() + " " + LogLevelTag(level) + " " + message, level);
+            if (level == LogLevel::Error) TriggerFlightDump("错误日志");
         }
     };
 }
+
+// ========== 按模块输出的日志宏 ==========
+// 用法：AGP_LOG_DEBUG(FakeIP, "FakeIP: 分配 " + ip + " -> " + domain);
+// - 模块等级未启用时不求值消息表达式（字符串拼接、to_string 等都不会执行）
+// - 低于 AGP_LOG_MIN_LEVEL 的等级在编译期剔除（LOG_STRIP_DEBUG 构建中 AGP_LOG_DEBUG 不生成任何代码）
+// - 需要先计算局部变量再输出时，用 if (AGP_LOG_ENABLED(Module, Debug)) { ... } 包裹，同样可被编译期剔除
+#define AGP_LOG_ENABLED(module, level) \
+    (::Core::IsLogLevelCompiledIn(::Core::LogLevel::level) && \
+     ::Core::Logger::IsEnabled(::Core::LogModule::module, ::Core::LogLevel::level))
+
+#define AGP_LOG_AT(level, module, ...) \
+    do { \
+        if constexpr (::Core::IsLogLevelCompiledIn(::Core::LogLevel::level)) { \
+            if (::Core::Logger::IsEnabled(::Core::LogModule::module, ::Core::LogLevel::level)) { \
+                ::Core::Logger::Write(::Core::LogLevel::level, __VA_ARGS__); \
+            } \
+        } \
+    } while (0)
+
+#define AGP_LOG_DEBUG(module, ...) AGP_LOG_AT(Debug, module, __VA_ARGS__)
+#define AGP_LOG_INFO(module, ...)  AGP_LOG_AT(Info, module, __VA_ARGS__)
+#define AGP_LOG_WARN(module, ...)  AGP_LOG_AT(Warn, module, __VA_ARGS__)
+#define AGP_LOG_ERROR(module, ...) AGP_LOG_AT(Error, module, __VA_ARGS__)
+
+// 按调用点限流的日志（令牌桶 + 定期汇总“过去 N 秒内抑制了 M 条同类日志”）：用于可能被高频触发的警告/信息
+// 每个宏展开处各有一个静态限流器，互不占用配额；需要多条语句时用 if (AGP_LOG_ENABLED_LIMITED(Module, Level)) { ... }
+#define AGP_LOG_ENABLED_LIMITED(module, level) \
+    (::Core::IsLogLevelCompiledIn(::Core::LogLevel::level) && \
+     ::Core::Logger::AllowLimited([]() -> ::Core::LogRateLimiter& { \
+         static ::Core::LogRateLimiter s_limiter(__FILE__ ":" AGP_LOG_STRINGIZE(__LINE__), \
+                                                 ::Core::LogModule::module, ::Core::LogLevel::level); \
+         return s_limiter; \
+     }()))
+
+#define AGP_LOG_STRINGIZE_IMPL(x) #x
+#define AGP_LOG_STRINGIZE(x) AGP_LOG_STRINGIZE_IMPL(x)
+
+#define AGP_LOG_LIMITED(level, module, ...) \
+    do { \
+        if (AGP_LOG_ENABLED_LIMITED(module, level)) { \
+            ::Core::Logger::Write(::Core::LogLevel::level, __VA_ARGS__); \
+        } \
+    } while (0)
+
+#define AGP_LOG_LIMITED_INFO(module, ...) AGP_LOG_LIMITED(Info, module, __VA_ARGS__)
+#define AGP_LOG_LIMITED_WARN(module, ...) AGP_LOG_LIMITED(Warn, module, __VA_ARGS__)
+
+// 结构化事件：模块与等级取自事件目录（编译期常量）
+// 同时写入飞行记录器：即使该等级未启用（或在编译期剔除了日志输出），出错时仍可在转储中看到该事件
+// 参数只求值一次；日志与飞行记录器都未启用时不求值
+#define AGP_LOG_EVENT(ev, ...) \
+    do { \
+        constexpr ::Core::LogEvent agpEv = ::Core::LogEvent::ev; \
+        constexpr bool agpCompiledIn = ::Core::IsLogLevelCompiledIn(::Core::LogEventLevel(agpEv)); \
+        const bool agpLog = agpCompiledIn && \
+                            ::Core::Logger::IsEnabled(::Core::LogEventModule(agpEv), ::Core::LogEventLevel(agpEv)); \
+        const bool agpRecord = ::Core::Logger::IsFlightRecorderEnabled(); \
+        if (agpLog || agpRecord) { \
+            const auto agpArgs = ::Core::MakeLogArgs(__VA_ARGS__); \
+            if (agpRecord) ::Core::Logger::FlightRecord(agpEv, agpArgs.data(), agpArgs.size()); \
+            if constexpr (agpCompiledIn) { \
+                if (agpLog) ::Core::Logger::WriteEvent(agpEv, agpArgs.data(), agpArgs.size()); \
+            } \
+        } \
+    } while (0)
+
+// 只写入飞行记录器（不输出日志）：用于握手步骤、路由决策等平时不值得写盘的上下文
+#define AGP_FLIGHT_RECORD(ev, ...) \
+    do { \
+        if (::Core::Logger::IsFlightRecorderEnabled()) { \
+            ::Core::Logger::FlightRecord(::Core::LogEvent::ev, __VA_ARGS__); \
+        } \
+    } while (0)
@@ -0,0 +1,334 @@
+#pragma once
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace Core {
+
+    // 指标原语 + Prometheus 文本格式输出（text/plain; version=0.0.4）
+    // 设计意图：Hook 热路径只做一次 relaxed 原子加（按线程分片，不同线程不争用同一缓存行）；
+    // 聚合、格式化都在抓取线程里完成，抓取频率再高也不会拖慢 Hook。
+    // 说明：本文件不依赖 Winsock/Logger，可在非 Windows 平台独立测试。
+
+    // 分片计数器：每个线程固定落在一个分片（轮转分配，线程数超过分片数时共享，relaxed fetch_add 不丢计数）
+    template <size_t Shards = 16>
+    class ShardedCounter {
+        static_assert(Shards > 0 && (Shards & (Shards - 1)) == 0, "分片数必须为 2 的幂");
+
+    public:
+        ShardedCounter() = default;
+        ShardedCounter(const ShardedCounter&) = delete;
+        ShardedCounter& operator=(const ShardedCounter&) = delete;
+
+        void Add(uint64_t n = 1) {
+            m_shards[LocalShardIndex()].value.fetch_add(n, std::memory_order_relaxed);
+        }
+
+        uint64_t Value() const {
+            uint64_t total = 0;
+            for (const Shard& shard : m_shards) total += shard.value.load(std::memory_order_relaxed);
+            return total;
+        }
+
+    private:
+        struct alignas(64) Shard {
+            std::atomic<uint64_t> value{0};
+        };
+
+        static size_t LocalShardIndex() {
+            static std::atomic<uint32_t> s_next{0};
+            thread_local const size_t t_index = s_next.fetch_add(1, std::memory_order_relaxed) & (Shards - 1);
+            return t_index;
+        }
+
+        std::array<Shard, Shards> m_shards;
+    };
+
+    // 固定桶延迟直方图（单位：微秒记录，秒输出）
+    // 桶边界覆盖本地代理（亚毫秒）到跨洋代理 + 慢握手（数秒）；超出最后一个边界的只计入 +Inf
+    class LatencyHistogram {
+    public:
+        static constexpr size_t kBuckets = 12;
+        static constexpr std::array<uint64_t, kBuckets> kBoundsUs = {
+            1000, 5000, 10000, 25000, 50000, 100000, 250000, 500000, 1000000, 2500000, 5000000, 10000000,
+        };
+
+        struct Snapshot {
+            std::array<uint64_t, kBuckets> cumulative{}; // 累计计数：第 i 项为 <= kBoundsUs[i] 的观测数
+            uint64_t count = 0;
+            uint64_t sumUs = 0;
+        };
+
+        LatencyHistogram() = default;
+        LatencyHistogram(const LatencyHistogram&) = delete;
+        LatencyHistogram& operator=(const LatencyHistogram&) = delete;
+
+        void Observe(uint64_t us) {
+            size_t i = 0;
+            while (i < kBuckets && us > kBoundsUs[i]) ++i;
+            if (i < kBuckets) m_buckets[i].fetch_add(1, std::memory_order_relaxed);
+            m_sumUs.fetch_add(us, std::memory_order_relaxed);
+            m_count.fetch_add(1, std::memory_order_relaxed);
+        }
+
+        // 读取各项时不加锁：并发写入下各项之间可能相差几次观测，但累计值单调、count 不小于任何桶
+        Snapshot Read() const {
+            Snapshot s;
+            s.count = m_count.load(std::memory_order_relaxed);
+            s.sumUs = m_sumUs.load(std::memory_order_relaxed);
+            uint64_t running = 0;
+            for (size_t i = 0; i < kBuckets; ++i) {
+                running += m_buckets[i].load(std::memory_order_relaxed);
+                s.cumulative[i] = running;
+            }
+            if (s.count < running) s.count = running;
+            return s;
+        }
+
+    private:
+        std::array<std::atomic<uint64_t>, kBuckets> m_buckets{};
+        std::atomic<uint64_t> m_sumUs{0};
+        std::atomic<uint64_t> m_count{0};
+    };
+
+    // HDR 风格对数线性直方图（单位由调用方约定，连接阶段耗时用微秒）：
+    // 小于 32 的值逐一计数；更大的值按 2 的幂分段，每段再线性分 16 档，任意量级的相对误差都不超过 1/16。
+    // 与 LatencyHistogram 的固定桶不同，可在读取时求任意分位数（p50/p99/p999），不需要预先猜测取值范围
+    class HdrHistogram {
+    public:
+        static constexpr unsigned kSubBits = 4;
+        static constexpr size_t kLinear = 32;
+        static constexpr unsigned kMaxExp = 40; // 超过 2^40 的值计入最后一档
+        static constexpr size_t kBuckets = kLinear + (kMaxExp - 5) * (1u << kSubBits);
+
+        struct Snapshot {
+            std::vector<uint64_t> counts;
+            uint64_t count = 0;
+            uint64_t sum = 0;
+            uint64_t max = 0;
+
+            // 分位数（q ∈ [0,1]）：返回所在档的上界（不超过记录到的最大值）；无数据时为 0
+            uint64_t Percentile(double q) const {
+                if (count == 0) return 0;
+                uint64_t target = (uint64_t)(q * (double)count + 0.999999);
+                if (target == 0) target = 1;
+                uint64_t running = 0;
+                for (size_t i = 0; i < counts.size(); ++i) {
+                    running += counts[i];
+                    if (running >= target) return std::min(UpperBound(i), max);
+                }
+                return max;
+            }
+        };
+
+        HdrHistogram() = default;
+        HdrHistogram(const HdrHistogram&) = delete;
+        HdrHistogram& operator=(const HdrHistogram&) = delete;
+
+        void Record(uint64_t v) {
+            m_counts[BucketOf(v)].fetch_add(1, std::memory_order_relaxed);
+            m_sum.fetch_add(v, std::memory_order_relaxed);
+            m_count.fetch_add(1, std::memory_order_relaxed);
+            uint64_t cur = m_max.load(std::memory_order_relaxed);
+            while (v > cur && !m_max.compare_exchange_weak(cur, v, std::memory_order_relaxed)) {
+            }
+        }
+
+        // 与 LatencyHistogram 相同：读取不加锁，并发写入下各项之间可能相差几次记录
+        Snapshot Read() const {
+            Snapshot s;
+            s.counts.resize(kBuckets);
+            uint64_t total = 0;
+            for (size_t i = 0; i < kBuckets; ++i) {
+                s.counts[i] = m_counts[i].load(std::memory_order_relaxed);
+                total += s.counts[i];
+            }
+            s.count = total;
+            s.sum = m_sum.load(std::memory_order_relaxed);
+            s.max = m_max.load(std::memory_order_relaxed);
+            return s;
+        }
+
+        static size_t BucketOf(uint64_t v) {
+            if (v < kLinear) return (size_t)v;
+            unsigned msb = 5;
+            while (msb + 1 < 64 && (v >> (msb + 1)) != 0) ++msb;
+            if (msb >= kMaxExp) return kBuckets - 1;
+            const uint64_t mantissa = (v >> (msb - kSubBits)) & ((1u << kSubBits) - 1);
+            return kLinear + (size_t)(msb - 5) * (1u << kSubBits) + (size_t)mantissa;
+        }
+
+        // 该档能容纳的最大值
+        static uint64_t UpperBound(size_t index) {
+            if (index < kLinear) return index;
+            const unsigned msb = 5 + (unsigned)((index - kLinear) >> kSubBits);
+            const uint64_t mantissa = (index - kLinear) & ((1u << kSubBits) - 1);
+            const uint64_t lower = ((1ull << kSubBits) + mantissa) << (msb - kSubBits);
+            return lower + (1ull << (msb - kSubBits)) - 1;
+        }
+
+    private:
+        std::array<std::atomic<uint64_t>, kBuckets> m_counts{};
+        std::atomic<uint64_t> m_sum{0};
+        std::atomic<uint64_t> m_count{0};
+        std::atomic<uint64_t> m_max{0};
+    };
+
+    // 按标签值分组的直方图（例如按上游代理）：首次出现的标签值加锁创建，之后返回稳定指针
+    // 标签值数量有上限，超出后并入 kOtherLabel，避免标签基数失控
+    class LabeledHistograms {
+    public:
+        static constexpr size_t kMaxSeries = 32;
+        static constexpr const char* kOtherLabel = "other";
+
+        LatencyHistogram& Get(const std::string& label) {
+            std::lock_guard<std::mutex> lock(m_mtx);
+            auto it = m_series.find(label);
+            if (it != m_series.end()) return *it->second;
+            const std::string& key = m_series.size() < kMaxSeries ? label : std::string(kOtherLabel);
+            auto& slot = m_series[key];
+            if (!slot) slot.reset(new LatencyHistogram());
+            return *slot;
+        }
+
+        std::vector<std::pair<std::string, LatencyHistogram::Snapshot>> Read() const {
+            std::vector<std::pair<std::string, LatencyHistogram::Snapshot>> out;
+            std::lock_guard<std::mutex> lock(m_mtx);
+            out.reserve(m_series.size());
+            for (const auto& kv : m_series) out.emplace_back(kv.first, kv.second->Read());
+            return out;
+        }
+
+    private:
+        mutable std::mutex m_mtx;
+        std::map<std::string, std::unique_ptr<LatencyHistogram>> m_series;
+    };
+
+    // Prometheus 文本格式构造器：先 Family 声明 HELP/TYPE，再追加该指标的样本
+    // 标签以 {{"k","v"}, ...} 传入，值按规范转义（\\ \" \n）
+    class PrometheusText {
+    public:
+        using Labels = std::vector<std::pair<const char*, std::string>>;
+
+        void Family(const char* name, const char* type, const char* help) {
+            m_out += "# HELP ";
+            m_out += name;
+            m_out += ' ';
+            AppendEscaped(help, false);
+            m_out += "\n# TYPE ";
+            m_out += name;
+            m_out += ' ';
+            m_out += type;
+            m_out += '\n';
+        }
+
+        void Sample(const char* name, const Labels& labels, uint64_t value) {
+            AppendSeries(name, nullptr, labels, nullptr, nullptr);
+            m_out += std::to_string(value);
+            m_out += '\n';
+        }
+
+        void Sample(const char* name, const Labels& labels, double value) {
+            AppendSeries(name, nullptr, labels, nullptr, nullptr);
+            AppendDouble(value);
+            m_out += '\n';
+        }
+
+        // 直方图：输出 _bucket（含 +Inf）、_sum（秒）、_count
+        void Histogram(const char* name, const Labels& labels, const LatencyHistogram::Snapshot& s) {
+            for (size_t i = 0; i < LatencyHistogram::kBuckets; ++i) {
+                char le[32];
+                snprintf(le, sizeof(le), "%g", (double)LatencyHistogram::kBoundsUs[i] / 1e6);
+                AppendSeries(name, "_bucket", labels, "le", le);
+                m_out += std::to_string(s.cumulative[i]);
+                m_out += '\n';
+            }
+            AppendSeries(name, "_bucket", labels, "le", "+Inf");
+            m_out += std::to_string(s.count);
+            m_out += '\n';
+            AppendSeries(name, "_sum", labels, nullptr, nullptr);
+            AppendDouble((double)s.sumUs / 1e6);
+            m_out += '\n';
+            AppendSeries(name, "_count", labels, nullptr, nullptr);
+            m_out += std::to_string(s.count);
+            m_out += '\n';
+        }
+
+        // 摘要：输出各分位数（quantile 标签）、_sum、_count；分位值与总和按调用方给出的单位原样输出
+        void Summary(const char* name, const Labels& labels, const std::vector<std::pair<double, double>>& quantiles,
+                     double sum, uint64_t count) {
+            for (const auto& q : quantiles) {
+                char label[32];
+                snprintf(label, sizeof(label), "%g", q.first);
+                AppendSeries(name, nullptr, labels, "quantile", label);
+                AppendDouble(q.second);
+                m_out += '\n';
+            }
+            AppendSeries(name, "_sum", labels, nullptr, nullptr);
+            AppendDouble(sum);
+            m_out += '\n';
+            AppendSeries(name, "_count", labels, nullptr, nullptr);
+            m_out += std::to_string(count);
+            m_out += '\n';
+        }
+
+        const std::string& Text() const { return m_out; }
+        std::string Take() { return std::move(m_out); }
+
+    private:
+        // extraKey/extraValue：直方图的 le、摘要的 quantile（值无需转义）
+        void AppendSeries(const char* name, const char* suffix, const Labels& labels, const char* extraKey,
+                          const char* extraValue) {
+            m_out += name;
+            if (suffix) m_out += suffix;
+            if (labels.empty() && !extraKey) {
+                m_out += ' ';
+                return;
+            }
+            m_out += '{';
+            bool first = true;
+            for (const auto& kv : labels) {
+                if (!first) m_out += ',';
+                first = false;
+                m_out += kv.first;
+                m_out += "=\"";
+                AppendEscaped(kv.second.c_str(), true);
+                m_out += '"';
+            }
+            if (extraKey) {
+                if (!first) m_out += ',';
+                m_out += extraKey;
+                m_out += "=\"";
+                m_out += extraValue;
+                m_out += '"';
+            }
+            m_out += "} ";
+        }
+
+        // HELP 只转义 \\ 与换行；标签值额外转义双引号
+        void AppendEscaped(const char* s, bool quote) {
+            for (; *s; ++s) {
+                if (*s == '\\') m_out += "\\\\";
+                else if (*s == '\n') m_out += "\\n";
+                else if (quote && *s == '"') m_out += "\\\"";
+                else m_out += *s;
+            }
+        }
+
+        void AppendDouble(double v) {
+            char buf[32];
+            snprintf(buf, sizeof(buf), "%.6f", v);
+            m_out += buf;
+        }
+
+        std::string m_out;
+    };
+}
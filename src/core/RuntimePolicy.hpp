@@ -0,0 +1,261 @@
+#pragma once
+#include <algorithm>
+#include <array>
+#include <cctype>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace Core {
+
+    // ============= 运行时策略快照 =============
+    // Config::Load 结束时把字符串配置编译为枚举 / 位图 / 预处理列表，Hook 热路径只读取本结构：
+    // - 模式字段：枚举比较代替 std::string 比较
+    // - 端口白名单：65536 位位图，一次位运算代替 binary_search
+    // - 进程名列表：加载时统一转小写并建立精确匹配索引，匹配时不再逐项 ToLower
+    // 说明：本文件不依赖 Winsock/Logger，可在非 Windows 平台独立测试与基准。
+
+    enum class ProxyType : uint8_t { Socks5, Http };
+    enum class DnsMode : uint8_t { Direct, Proxy };
+    enum class Ipv6Mode : uint8_t { Proxy, Direct, Block };
+    enum class UdpMode : uint8_t { Block, Direct, Proxy };
+    enum class UdpFallback : uint8_t { Block, Direct };
+    enum class UdpRelayMode : uint8_t { PerSocket, Mux };
+    enum class ChildInjectionMode : uint8_t { Filtered, Inherit };
+    enum class BreakerOpenAction : uint8_t { Fail, Direct };
+
+    // 解析函数：输入需已 trim + 小写（Config::Load 的校验阶段已完成），无法识别时返回 false 且不修改 out
+    inline bool ParseProxyType(std::string_view s, ProxyType* out) {
+        if (s == "socks5") { *out = ProxyType::Socks5; return true; }
+        if (s == "http") { *out = ProxyType::Http; return true; }
+        return false;
+    }
+
+    inline bool ParseDnsMode(std::string_view s, DnsMode* out) {
+        if (s == "direct" || s.empty()) { *out = DnsMode::Direct; return true; }
+        if (s == "proxy") { *out = DnsMode::Proxy; return true; }
+        return false;
+    }
+
+    inline bool ParseIpv6Mode(std::string_view s, Ipv6Mode* out) {
+        if (s == "proxy") { *out = Ipv6Mode::Proxy; return true; }
+        if (s == "direct") { *out = Ipv6Mode::Direct; return true; }
+        if (s == "block") { *out = Ipv6Mode::Block; return true; }
+        return false;
+    }
+
+    inline bool ParseUdpMode(std::string_view s, UdpMode* out) {
+        if (s == "block") { *out = UdpMode::Block; return true; }
+        if (s == "direct") { *out = UdpMode::Direct; return true; }
+        if (s == "proxy") { *out = UdpMode::Proxy; return true; }
+        return false;
+    }
+
+    inline bool ParseUdpFallback(std::string_view s, UdpFallback* out) {
+        if (s == "block") { *out = UdpFallback::Block; return true; }
+        if (s == "direct") { *out = UdpFallback::Direct; return true; }
+        return false;
+    }
+
+    inline bool ParseUdpRelayMode(std::string_view s, UdpRelayMode* out) {
+        if (s == "per_socket") { *out = UdpRelayMode::PerSocket; return true; }
+        if (s == "mux") { *out = UdpRelayMode::Mux; return true; }
+        return false;
+    }
+
+    inline bool ParseChildInjectionMode(std::string_view s, ChildInjectionMode* out) {
+        if (s == "filtered") { *out = ChildInjectionMode::Filtered; return true; }
+        if (s == "inherit") { *out = ChildInjectionMode::Inherit; return true; }
+        return false;
+    }
+
+    inline bool ParseBreakerOpenAction(std::string_view s, BreakerOpenAction* out) {
+        if (s == "fail") { *out = BreakerOpenAction::Fail; return true; }
+        if (s == "direct") { *out = BreakerOpenAction::Direct; return true; }
+        return false;
+    }
+
+    // 端口白名单位图：空白名单 = 允许所有端口（与 ProxyRules::IsPortAllowed 语义一致）
+    class PortBitmap {
+    public:
+        void Assign(const std::vector<uint16_t>& ports) {
+            m_bits.fill(0);
+            m_allowAll = ports.empty();
+            for (uint16_t p : ports) m_bits[p >> 6] |= (1ull << (p & 63));
+        }
+
+        bool Test(uint16_t port) const {
+            return m_allowAll || ((m_bits[port >> 6] >> (port & 63)) & 1ull) != 0;
+        }
+
+        bool AllowAll() const { return m_allowAll; }
+
+    private:
+        std::array<uint64_t, 1024> m_bits{};
+        bool m_allowAll = true;
+    };
+
+    // 进程名列表（大小写不敏感，支持完全匹配与子串匹配）
+    // 加载时统一转小写；精确匹配走有序索引二分查找，子串匹配按长度升序扫描，遇到比进程名更长的项即停止
+    class ProcessNameList {
+    public:
+        static std::string ToLower(std::string_view s) {
+            std::string out(s);
+            std::transform(out.begin(), out.end(), out.begin(),
+                           [](unsigned char c) { return (char)std::tolower(c); });
+            return out;
+        }
+
+        void Assign(const std::vector<std::string>& items) {
+            m_byLength.clear();
+            for (const auto& item : items) {
+                std::string lower = ToLower(item);
+                if (!lower.empty()) m_byLength.push_back(std::move(lower));
+            }
+            std::sort(m_byLength.begin(), m_byLength.end(), [](const std::string& a, const std::string& b) {
+                return a.size() != b.size() ? a.size() < b.size() : a < b;
+            });
+            m_byLength.erase(std::unique(m_byLength.begin(), m_byLength.end()), m_byLength.end());
+            m_exact = m_byLength;
+            std::sort(m_exact.begin(), m_exact.end());
+        }
+
+        bool Empty() const { return m_byLength.empty(); }
+        size_t Size() const { return m_byLength.size(); }
+
+        // lowerName 需已转为小写
+        bool MatchesLower(std::string_view lowerName) const {
+            if (std::binary_search(m_exact.begin(), m_exact.end(), lowerName,
+                                   [](std::string_view a, std::string_view b) { return a < b; })) {
+                return true;
+            }
+            for (const auto& item : m_byLength) {
+                if (item.size() > lowerName.size()) break;
+                if (lowerName.find(item) != std::string_view::npos) return true;
+            }
+            return false;
+        }
+
+        bool Matches(std::string_view name) const {
+            if (Empty()) return false;
+            return MatchesLower(ToLower(name));
+        }
+
+    private:
+        std::vector<std::string> m_byLength; // 按长度升序，用于子串匹配剪枝
+        std::vector<std::string> m_exact;    // 字典序，用于精确匹配
+    };
+
+    struct RuntimePolicy {
+        bool proxyEnabled = true;          // proxy.port != 0
+        uint16_t proxyPort = 7890;
+        ProxyType proxyType = ProxyType::Socks5;
+
+        DnsMode dns = DnsMode::Direct;
+        Ipv6Mode ipv6 = Ipv6Mode::Proxy;
+        UdpMode udp = UdpMode::Block;
+        UdpFallback udpFallback = UdpFallback::Block;
+        UdpRelayMode udpRelay = UdpRelayMode::PerSocket;
+        BreakerOpenAction breakerOpenAction = BreakerOpenAction::Fail;
+
+        PortBitmap allowedPorts;
+
+        bool childInjection = true;
+        ChildInjectionMode childInjectionMode = ChildInjectionMode::Filtered;
+        ProcessNameList targetProcesses;        // 空 = 全部进程
+        ProcessNameList childInjectionExclude;
+
+        bool UdpProxyEnabled() const { return proxyEnabled && udp == UdpMode::Proxy; }
+
+        // 检查进程名是否在目标列表中（大小写不敏感，子串匹配）
+        bool ShouldInject(std::string_view processName) const {
+            if (targetProcesses.Empty()) return true;
+            return targetProcesses.Matches(processName);
+        }
+
+        bool IsChildInjectionExcluded(std::string_view processName) const {
+            return childInjectionExclude.Matches(processName);
+        }
+
+        bool ShouldInjectChildProcess(std::string_view processName) const {
+            if (childInjectionExclude.Empty() && targetProcesses.Empty()) return true;
+            const std::string lower = ProcessNameList::ToLower(processName);
+            if (childInjectionExclude.MatchesLower(lower)) return false;
+            if (childInjectionMode == ChildInjectionMode::Inherit) return true;
+            return targetProcesses.Empty() || targetProcesses.MatchesLower(lower);
+        }
+    };
+
+    // ============= connect 决策前导（可移植） =============
+    // PerformProxyConnect / ConnectEx 在解析原始目标之前的判定：socket 类型、地址族、UDP/IPv6 策略
+
+    enum class SocketKind : uint8_t { Stream, Datagram, Other };
+    enum class AddrKind : uint8_t { IPv4, IPv6, IPv4MappedIPv6, Other };
+
+    struct ConnectFacts {
+        SocketKind socket = SocketKind::Stream;
+        AddrKind addr = AddrKind::IPv4;
+        uint16_t port = 0;        // 目标端口（主机字节序，未知为 0）
+        bool loopback = false;    // 目标是否为回环地址
+    };
+
+    enum class ConnectPrologue : uint8_t {
+        Continue,           // 继续解析原始目标、路由与端口策略
+        NonStreamDirect,    // 非 SOCK_STREAM / SOCK_DGRAM：直连
+        UdpDirect,          // udp_mode=direct
+        UdpBlocked,         // udp_mode=block
+        UdpBlockException,  // udp_mode=block 下放行 DNS(53) / 回环
+        UdpProxy,           // udp_mode=proxy
+        Ipv6Direct,         // ipv6_mode=direct
+        Ipv6Blocked,        // ipv6_mode=block
+        Ipv6NoProxy,        // 未配置代理：IPv6 直连
+        FamilyBlocked,      // 非 IPv4/IPv6 地址族（已配置代理）
+        FamilyNoProxy,      // 非 IPv4/IPv6 地址族（未配置代理）
+    };
+
+    inline ConnectPrologue DecideConnectPrologue(const RuntimePolicy& policy, const ConnectFacts& facts) {
+        if (policy.proxyEnabled && facts.socket != SocketKind::Stream) {
+            if (facts.socket != SocketKind::Datagram) return ConnectPrologue::NonStreamDirect;
+            switch (policy.udp) {
+                case UdpMode::Block:
+                    return (facts.loopback || facts.port == 53) ? ConnectPrologue::UdpBlockException
+                                                                : ConnectPrologue::UdpBlocked;
+                case UdpMode::Proxy:
+                    return ConnectPrologue::UdpProxy;
+                default:
+                    return ConnectPrologue::UdpDirect;
+            }
+        }
+        if (facts.addr == AddrKind::IPv6) {
+            // v4-mapped IPv6 本质是 IPv4 连接，不受 ipv6_mode 影响
+            if (!policy.proxyEnabled) return ConnectPrologue::Ipv6NoProxy;
+            if (policy.ipv6 == Ipv6Mode::Direct) return ConnectPrologue::Ipv6Direct;
+            if (policy.ipv6 == Ipv6Mode::Block) return ConnectPrologue::Ipv6Blocked;
+            return ConnectPrologue::Continue;
+        }
+        if (facts.addr == AddrKind::Other) {
+            return policy.proxyEnabled ? ConnectPrologue::FamilyBlocked : ConnectPrologue::FamilyNoProxy;
+        }
+        return ConnectPrologue::Continue;
+    }
+
+    // 端口策略（路由规则之后）：DNS 53 按 dns_mode，其他端口按白名单
+    enum class PortDecision : uint8_t { Proxy, DnsDirect, NotAllowed };
+
+    inline PortDecision DecideConnectPort(const RuntimePolicy& policy, uint16_t port) {
+        if (port == 53 && policy.dns == DnsMode::Direct) return PortDecision::DnsDirect;
+        if (!policy.allowedPorts.Test(port)) return PortDecision::NotAllowed;
+        return PortDecision::Proxy;
+    }
+
+    inline const char* PortDecisionName(PortDecision d) {
+        switch (d) {
+            case PortDecision::Proxy:      return "proxy";
+            case PortDecision::DnsDirect:  return "dns-direct";
+            case PortDecision::NotAllowed: return "not-allowed";
+        }
+        return "proxy";
+    }
+
+} // namespace Core
@@ -0,0 +1,488 @@
+#pragma once
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include "AtomicText.hpp"
+
+namespace Core {
+namespace SharedStats {
+
+    // 跨进程共享内存统计段：每个被注入进程占一个槽位，发布自身计数与活跃连接表，agtop 等查看器只读映射后汇总显示
+    // 设计意图：
+    // - 槽位单写者：只有占有该槽位的进程写入，写入用序号锁（seqlock：写前序号变奇数、写完变偶数），写方不加锁、不等待读方；
+    //   读方在序号为奇数或前后不一致时重读，读到的总是某一次完整发布的内容
+    // - 段内全部字段都是 64 位无锁原子量（字符串按 8 字节打包），不同进程的映射地址不同也可直接使用
+    // - 槽位按心跳回收：进程退出时释放；崩溃未释放的槽位在心跳超过 kStaleMs 后可被新进程接管
+    // - 映射按平台分别实现（Windows 命名文件映射 / POSIX shm_open），段布局与读写逻辑与平台无关
+    // 说明：本文件不依赖 Winsock/Logger，可在非 Windows 平台独立测试。
+
+#ifdef _WIN32
+    inline constexpr const char* kDefaultSegmentName = "Local\\AntigravityProxyStats";
+#else
+    inline constexpr const char* kDefaultSegmentName = "/antigravity_proxy_stats";
+#endif
+
+    constexpr uint64_t kMagic = 0x5354415453504741ull; // "AGPSTATS"：段头已写完
+    constexpr uint64_t kInitializing = 0x1ull;        // 创建方正在写段头
+    constexpr uint64_t kVersion = 1;
+    constexpr size_t kMaxProcesses = 64;
+    constexpr size_t kMaxFlows = 64;                  // 每个进程发布的活跃连接上限（按字节数取前 N 个）
+    constexpr uint64_t kStaleMs = 10000;              // 心跳超过该时长视为失联
+    constexpr int kReadRetries = 16;
+
+    // 连接去向（写入共享段，取值不可改动）
+    enum class FlowRoute : uint8_t {
+        Untracked = 0, // 未记录目标（回环/绕过/未经 connect）
+        Direct = 1,
+        ProxyTcp = 2,
+        ProxyUdp = 3,
+    };
+
+    inline const char* FlowRouteName(FlowRoute r) {
+        switch (r) {
+            case FlowRoute::Direct: return "direct";
+            case FlowRoute::ProxyTcp: return "proxy";
+            case FlowRoute::ProxyUdp: return "proxy-udp";
+            default: return "-";
+        }
+    }
+
+    // 进程级计数下标（写入共享段，只能在末尾追加）
+    enum Counter : size_t {
+        kBytesSent = 0,
+        kBytesRecv,
+        kConnectsProxy,
+        kConnectsDirect,       // 规则/DNS/端口白名单/熔断回退/未配置代理/地址族策略/学习偏好 的直连
+        kConnectsBypass,       // 回环、代理自身
+        kConnectsRejected,     // 熔断拒绝
+        kHandshakeFailures,
+        kUdpAssociates,
+        kCounterCount,
+    };
+
+    inline const char* CounterName(size_t i) {
+        static const char* const kNames[kCounterCount] = {
+            "bytes_sent", "bytes_recv", "connects_proxy", "connects_direct",
+            "connects_bypass", "connects_rejected", "handshake_failures", "udp_associates",
+        };
+        return i < kCounterCount ? kNames[i] : "?";
+    }
+
+    struct FlowEntry {
+        std::atomic<uint64_t> socket;
+        std::atomic<uint64_t> routePort;  // 低 8 位 FlowRoute，8..23 位目标端口
+        std::atomic<uint64_t> bytesSent;
+        std::atomic<uint64_t> bytesRecv;
+        std::atomic<uint64_t> ageMs;      // 发布时刻的连接时长（0=未知）
+        AtomicText<64> host;
+        AtomicText<48> upstream;
+    };
+
+    struct alignas(64) ProcessSlot {
+        std::atomic<uint64_t> owner;        // 占有者 PID，0=空闲
+        std::atomic<uint64_t> heartbeatMs;  // 最近一次发布的墙钟时间（ms）；兼作占用令牌，见 SlotWriter::Attach
+        std::atomic<uint64_t> seq;          // 序号锁：奇数表示正在写
+        std::atomic<uint64_t> startMs;
+        AtomicText<64> name;
+        std::atomic<uint64_t> counters[kCounterCount];
+        std::atomic<uint64_t> activeFlows;  // 有流量的未关闭 socket 总数（可能大于 flowCount）
+        std::atomic<uint64_t> flowCount;
+        FlowEntry flows[kMaxFlows];
+    };
+
+    struct Segment {
+        std::atomic<uint64_t> magic;
+        std::atomic<uint64_t> version;
+        std::atomic<uint64_t> slotCount;
+        std::atomic<uint64_t> slotBytes;
+        ProcessSlot slots[kMaxProcesses];
+    };
+
+    static_assert(std::atomic<uint64_t>::is_always_lock_free, "共享段要求 64 位原子量无锁");
+    static_assert(std::is_standard_layout<Segment>::value, "共享段必须为标准布局");
+
+    // 一次发布的内容（普通结构体，写方填充、读方取回）
+    struct FlowSample {
+        uint64_t socket = 0;
+        FlowRoute route = FlowRoute::Untracked;
+        uint16_t port = 0;
+        std::string host;
+        std::string upstream;
+        uint64_t bytesSent = 0;
+        uint64_t bytesRecv = 0;
+        uint64_t ageMs = 0;
+    };
+
+    struct ProcessSample {
+        std::array<uint64_t, kCounterCount> counters{};
+        uint64_t activeFlows = 0;
+        std::vector<FlowSample> flows;  // 超过 kMaxFlows 的部分不发布
+    };
+
+    struct ProcessView {
+        size_t slot = 0;
+        uint64_t pid = 0;
+        std::string name;
+        uint64_t startMs = 0;
+        uint64_t heartbeatMs = 0;
+        bool stale = false;
+        ProcessSample sample;
+    };
+
+    inline uint64_t WallClockMs() {
+        return (uint64_t)std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::system_clock::now().time_since_epoch()).count();
+    }
+
+    // 段头已由创建方写完且布局与本进程一致
+    inline bool IsValid(const Segment* seg) {
+        return seg && seg->magic.load(std::memory_order_acquire) == kMagic &&
+               seg->version.load(std::memory_order_relaxed) == kVersion &&
+               seg->slotCount.load(std::memory_order_relaxed) == kMaxProcesses &&
+               seg->slotBytes.load(std::memory_order_relaxed) == sizeof(ProcessSlot);
+    }
+
+    // 初始化全零的新段；段已存在时等待创建方写完段头。布局不一致（不同版本的 DLL）返回 false
+    inline bool InitSegment(Segment* seg) {
+        if (!seg) return false;
+        uint64_t expected = 0;
+        if (seg->magic.compare_exchange_strong(expected, kInitializing, std::memory_order_acq_rel)) {
+            seg->version.store(kVersion, std::memory_order_relaxed);
+            seg->slotCount.store(kMaxProcesses, std::memory_order_relaxed);
+            seg->slotBytes.store(sizeof(ProcessSlot), std::memory_order_relaxed);
+            seg->magic.store(kMagic, std::memory_order_release);
+            return true;
+        }
+        for (int i = 0; i < 1000 && seg->magic.load(std::memory_order_acquire) == kInitializing; ++i) {
+            std::this_thread::yield();
+        }
+        return IsValid(seg);
+    }
+
+    // 槽位写者：每个进程一个，只在发布线程中使用
+    class SlotWriter {
+    public:
+        // 占用一个槽位：空闲槽位或心跳超过 staleMs 的槽位均可接管
+        // 占用以心跳字的 CAS 为准（把旧心跳换成当前时间），赢家再写 owner；两个进程不会同时占到同一槽位
+        bool Attach(Segment* seg, uint64_t pid, std::string_view name, uint64_t nowMs, uint64_t staleMs = kStaleMs) {
+            Detach();
+            if (!IsValid(seg) || pid == 0) return false;
+            for (size_t i = 0; i < kMaxProcesses; ++i) {
+                ProcessSlot& slot = seg->slots[i];
+                uint64_t hb = slot.heartbeatMs.load(std::memory_order_acquire);
+                const bool free = slot.owner.load(std::memory_order_acquire) == 0;
+                const bool stale = hb + staleMs < nowMs;
+                if (!free && !stale) continue;
+                if (!slot.heartbeatMs.compare_exchange_strong(hb, nowMs, std::memory_order_acq_rel)) continue;
+                slot.owner.store(pid, std::memory_order_release);
+                const uint64_t s0 = slot.seq.load(std::memory_order_relaxed) | 1;
+                slot.seq.store(s0, std::memory_order_relaxed);
+                std::atomic_thread_fence(std::memory_order_release);
+                slot.startMs.store(nowMs, std::memory_order_relaxed);
+                slot.name.Store(name);
+                for (auto& c : slot.counters) c.store(0, std::memory_order_relaxed);
+                slot.activeFlows.store(0, std::memory_order_relaxed);
+                slot.flowCount.store(0, std::memory_order_relaxed);
+                slot.seq.store(s0 + 1, std::memory_order_release);
+                m_slot = &slot;
+                m_pid = pid;
+                m_index = i;
+                return true;
+            }
+            return false;
+        }
+
+        bool Attached() const { return m_slot != nullptr; }
+        size_t SlotIndex() const { return m_index; }
+
+        // 槽位仍归本进程所有（长时间未发布时可能已被其他进程按失联接管）
+        bool StillOwned() const {
+            return m_slot && m_slot->owner.load(std::memory_order_acquire) == m_pid;
+        }
+
+        // 发布一次快照；槽位已被接管时返回 false（调用方可重新 Attach）
+        bool Publish(const ProcessSample& sample, uint64_t nowMs) {
+            if (!StillOwned()) {
+                m_slot = nullptr;
+                return false;
+            }
+            ProcessSlot& slot = *m_slot;
+            const uint64_t s0 = slot.seq.load(std::memory_order_relaxed);
+            slot.seq.store(s0 + 1, std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_release);
+            for (size_t i = 0; i < kCounterCount; ++i) slot.counters[i].store(sample.counters[i], std::memory_order_relaxed);
+            slot.activeFlows.store(sample.activeFlows, std::memory_order_relaxed);
+            const size_t n = std::min(sample.flows.size(), kMaxFlows);
+            for (size_t i = 0; i < n; ++i) {
+                const FlowSample& f = sample.flows[i];
+                FlowEntry& e = slot.flows[i];
+                e.socket.store(f.socket, std::memory_order_relaxed);
+                e.routePort.store((uint64_t)f.route | ((uint64_t)f.port << 8), std::memory_order_relaxed);
+                e.bytesSent.store(f.bytesSent, std::memory_order_relaxed);
+                e.bytesRecv.store(f.bytesRecv, std::memory_order_relaxed);
+                e.ageMs.store(f.ageMs, std::memory_order_relaxed);
+                e.host.Store(f.host);
+                e.upstream.Store(f.upstream);
+            }
+            slot.flowCount.store(n, std::memory_order_relaxed);
+            slot.seq.store(s0 + 2, std::memory_order_release);
+            slot.heartbeatMs.store(nowMs, std::memory_order_release);
+            return true;
+        }
+
+        // 释放槽位（进程退出/卸载时）；槽位已被接管时不动
+        // 先清心跳再清 owner：其间被其他进程占用时 owner 的 CAS 失败，不会覆盖新占有者的心跳
+        void Detach() {
+            if (StillOwned()) {
+                m_slot->heartbeatMs.store(0, std::memory_order_release);
+                uint64_t pid = m_pid;
+                m_slot->owner.compare_exchange_strong(pid, 0, std::memory_order_acq_rel);
+            }
+            m_slot = nullptr;
+            m_pid = 0;
+        }
+
+    private:
+        ProcessSlot* m_slot = nullptr;
+        uint64_t m_pid = 0;
+        size_t m_index = 0;
+    };
+
+    // 读取一个槽位的一致快照；空闲或多次重读仍被写入打断时返回 false
+    inline bool ReadSlot(const Segment& seg, size_t index, uint64_t nowMs, ProcessView* out, uint64_t staleMs = kStaleMs) {
+        if (index >= kMaxProcesses || !out) return false;
+        const ProcessSlot& slot = seg.slots[index];
+        for (int attempt = 0; attempt < kReadRetries; ++attempt) {
+            const uint64_t pid = slot.owner.load(std::memory_order_acquire);
+            if (pid == 0) return false;
+            const uint64_t s1 = slot.seq.load(std::memory_order_acquire);
+            if (s1 & 1) {
+                std::this_thread::yield();
+                continue;
+            }
+            ProcessView v;
+            v.slot = index;
+            v.pid = pid;
+            v.startMs = slot.startMs.load(std::memory_order_relaxed);
+            v.name = slot.name.Load();
+            for (size_t i = 0; i < kCounterCount; ++i) v.sample.counters[i] = slot.counters[i].load(std::memory_order_relaxed);
+            v.sample.activeFlows = slot.activeFlows.load(std::memory_order_relaxed);
+            const size_t n = std::min((size_t)slot.flowCount.load(std::memory_order_relaxed), kMaxFlows);
+            v.sample.flows.resize(n);
+            for (size_t i = 0; i < n; ++i) {
+                const FlowEntry& e = slot.flows[i];
+                FlowSample& f = v.sample.flows[i];
+                f.socket = e.socket.load(std::memory_order_relaxed);
+                const uint64_t rp = e.routePort.load(std::memory_order_relaxed);
+                f.route = (FlowRoute)(rp & 0xff);
+                f.port = (uint16_t)(rp >> 8);
+                f.bytesSent = e.bytesSent.load(std::memory_order_relaxed);
+                f.bytesRecv = e.bytesRecv.load(std::memory_order_relaxed);
+                f.ageMs = e.ageMs.load(std::memory_order_relaxed);
+                f.host = e.host.Load();
+                f.upstream = e.upstream.Load();
+            }
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (slot.seq.load(std::memory_order_relaxed) != s1) continue;
+            if (slot.owner.load(std::memory_order_relaxed) != pid) continue;
+            v.heartbeatMs = slot.heartbeatMs.load(std::memory_order_acquire);
+            v.stale = v.heartbeatMs + staleMs < nowMs;
+            *out = std::move(v);
+            return true;
+        }
+        return false;
+    }
+
+    // 读取全部已占用的槽位
+    inline std::vector<ProcessView> ReadAll(const Segment& seg, uint64_t nowMs, uint64_t staleMs = kStaleMs) {
+        std::vector<ProcessView> out;
+        if (!IsValid(&seg)) return out;
+        for (size_t i = 0; i < kMaxProcesses; ++i) {
+            ProcessView v;
+            if (ReadSlot(seg, i, nowMs, &v, staleMs)) out.push_back(std::move(v));
+        }
+        return out;
+    }
+
+    // 共享段映射（平台相关部分）：写方以读写方式创建/打开，查看器以只读方式打开已有段
+    class Mapping {
+    public:
+        Mapping() = default;
+        Mapping(const Mapping&) = delete;
+        Mapping& operator=(const Mapping&) = delete;
+        ~Mapping() { Close(); }
+
+        bool Open(const char* name, bool writable) {
+            Close();
+            if (!name || !*name) return false;
+#ifdef _WIN32
+            if (writable) {
+                m_handle = CreateFileMappingA(INVALID_HANDLE_VALUE, NULL, PAGE_READWRITE, 0, (DWORD)sizeof(Segment), name);
+            } else {
+                m_handle = OpenFileMappingA(FILE_MAP_READ, FALSE, name);
+            }
+            if (!m_handle) return false;
+            m_view = MapViewOfFile(m_handle, writable ? FILE_MAP_ALL_ACCESS : FILE_MAP_READ, 0, 0, sizeof(Segment));
+            if (!m_view) {
+                Close();
+                return false;
+            }
+#else
+            const int fd = shm_open(name, writable ? (O_CREAT | O_RDWR) : O_RDONLY, 0600);
+            if (fd < 0) return false;
+            struct stat st {};
+            if (fstat(fd, &st) != 0 ||
+                ((size_t)st.st_size < sizeof(Segment) && (!writable || ftruncate(fd, (off_t)sizeof(Segment)) != 0))) {
+                close(fd);
+                return false;
+            }
+            void* p = mmap(nullptr, sizeof(Segment), writable ? (PROT_READ | PROT_WRITE) : PROT_READ, MAP_SHARED, fd, 0);
+            close(fd);
+            if (p == MAP_FAILED) return false;
+            m_view = p;
+#endif
+            if (writable && !InitSegment(Get())) {
+                Close();
+                return false;
+            }
+            return true;
+        }
+
+        Segment* Get() const { return static_cast<Segment*>(m_view); }
+
+        void Close() {
+#ifdef _WIN32
+            if (m_view) UnmapViewOfFile(m_view);
+            if (m_handle) CloseHandle(m_handle);
+            m_handle = NULL;
+#else
+            if (m_view) munmap(m_view, sizeof(Segment));
+#endif
+            m_view = nullptr;
+        }
+
+        // 删除命名段（仅 POSIX 需要；Windows 文件映射随最后一个句柄关闭自动销毁）
+        static void Remove(const char* name) {
+#ifdef _WIN32
+            (void)name;
+#else
+            if (name && *name) shm_unlink(name);
+#endif
+        }
+
+    private:
+#ifdef _WIN32
+        HANDLE m_handle = NULL;
+#endif
+        void* m_view = nullptr;
+    };
+
+    // 发布线程：定期调用 collector 采集本进程统计并写入槽位
+    // 与 MetricsServer 相同：线程持有自身引用并立即 detach；Stop 同步释放槽位，可在 Loader Lock 中调用
+    class Publisher : public std::enable_shared_from_this<Publisher> {
+    public:
+        using Collector = std::function<void(ProcessSample*)>;
+
+        // 打开共享段并占用槽位；失败（段无法创建、布局不一致、槽位已满）返回 false
+        bool Start(const char* segmentName, uint64_t pid, const std::string& processName, int intervalMs, Collector collector) {
+            if (!collector || m_started.exchange(true)) return false;
+            std::lock_guard<std::mutex> lock(m_mtx);
+            if (!m_mapping.Open(segmentName, true) ||
+                !m_writer.Attach(m_mapping.Get(), pid, processName, WallClockMs())) {
+                m_mapping.Close();
+                m_started = false;
+                return false;
+            }
+            m_pid = pid;
+            m_name = processName;
+            m_intervalMs = intervalMs > 0 ? intervalMs : 1000;
+            m_collector = std::move(collector);
+            auto self = shared_from_this();
+            std::thread([self]() { self->Loop(); }).detach();
+            return true;
+        }
+
+        // 发出停止信号并立即释放槽位；waitMs>0 时最多等待线程退出（DLL 卸载路径应传 0）
+        void Stop(int waitMs = 0) {
+            {
+                std::lock_guard<std::mutex> lock(m_mtx);
+                m_stop = true;
+                m_writer.Detach();
+            }
+            m_wakeCv.notify_all();
+            if (waitMs <= 0) return;
+            std::unique_lock<std::mutex> lock(m_mtx);
+            m_exitCv.wait_for(lock, std::chrono::milliseconds(waitMs), [this]() { return m_exited; });
+        }
+
+        size_t SlotIndex() const {
+            std::lock_guard<std::mutex> lock(m_mtx);
+            return m_writer.SlotIndex();
+        }
+
+        uint64_t Publishes() const { return m_publishes.load(std::memory_order_relaxed); }
+
+    private:
+        void Loop() {
+            std::unique_lock<std::mutex> lock(m_mtx);
+            while (!m_stop) {
+                // 采集在锁外进行：collector 可能较慢，Stop 不应等待它
+                lock.unlock();
+                ProcessSample sample;
+                m_collector(&sample);
+                lock.lock();
+                if (m_stop) break;
+                const uint64_t now = WallClockMs();
+                // 被其他进程按失联接管后重新占一个槽位
+                if (!m_writer.Publish(sample, now) && m_writer.Attach(m_mapping.Get(), m_pid, m_name, now)) {
+                    m_writer.Publish(sample, now);
+                }
+                m_publishes.fetch_add(1, std::memory_order_relaxed);
+                m_wakeCv.wait_for(lock, std::chrono::milliseconds(m_intervalMs), [this]() { return m_stop; });
+            }
+            m_writer.Detach();
+            m_mapping.Close();
+            m_exited = true;
+            lock.unlock();
+            m_exitCv.notify_all();
+        }
+
+        mutable std::mutex m_mtx;
+        std::condition_variable m_wakeCv;
+        std::condition_variable m_exitCv;
+        Mapping m_mapping;
+        SlotWriter m_writer;
+        Collector m_collector;
+        std::string m_name;
+        uint64_t m_pid = 0;
+        int m_intervalMs = 1000;
+        std::atomic<bool> m_started{false};
+        std::atomic<uint64_t> m_publishes{0};
+        bool m_stop = false;
+        bool m_exited = false;
+    };
+}
+}
@@ -15,6 +15,8 @@
 #include <mutex>
 #include <atomic>
 #include <memory>
+#include <sstream>
+#include <iomanip>
 #include "../core/Config.hpp"
 #include "../core/Logger.hpp"
 #include "../network/SocketWrapper.hpp"
@@ -24,6 +26,23 @@
 #include "../network/HttpConnect.hpp"
 #include "../network/SocketIo.hpp"
 #include "../network/TrafficMonitor.hpp"
+#include "../network/PacketCapture.hpp"
+#include "../network/MetricsServer.hpp"
+#include "../core/Metrics.hpp"
+#include "../core/SharedStats.hpp"
+#include "../core/ConnTrace.hpp"
+#include "../network/CircuitBreaker.hpp"
+#include "../network/AdaptiveTimeout.hpp"
+#include "../network/RoutePreference.hpp"
+#include "../network/HappyEyeballs.hpp"
+#include "../network/UdpAssociatePool.hpp"
+#include "../network/UdpRelayMux.hpp"
+#include "../network/SlabPool.hpp"
+#include "../network/UdpRecvInPlace.hpp"
+#include "../network/SocketContextTable.hpp"
+#include "../network/SocketClassCache.hpp"
+#include "../network/ExpiringSlab.hpp"
+#include "../network/PointerFilter.hpp"
 #include "../injection/ProcessInjector.hpp"
 
 // ============= 函数指针类型定义 =============
@@ -102,30 +121,9 @@ struct SocketTargetInfo {
     std::string host;
     uint16_t port = 0;
     ULONGLONG establishedTick = 0;
+    Core::SharedStats::FlowRoute route = Core::SharedStats::FlowRoute::ProxyTcp;
+    bool learnedDirect = false; // 按学习到的域名偏好直连（default_action=learn），关闭时据收发字节反馈
 };
-static std::unordered_map<SOCKET, SocketTargetInfo> g_socketTargets;
-static std::mutex g_socketTargetsMtx;
-
-static void RememberSocketTarget(SOCKET s, const std::string& host, uint16_t port) {
-    if (s == INVALID_SOCKET || host.empty() || port == 0) return;
-    std::lock_guard<std::mutex> lock(g_socketTargetsMtx);
-    g_socketTargets[s] = SocketTargetInfo{host, port, GetTickCount64()};
-}
-
-static bool TryGetSocketTarget(SOCKET s, SocketTargetInfo* out) {
-    if (!out || s == INVALID_SOCKET) return false;
-    std::lock_guard<std::mutex> lock(g_socketTargetsMtx);
-    auto it = g_socketTargets.find(s);
-    if (it == g_socketTargets.end()) return false;
-    *out = it->second;
-    return true;
-}
-
-static void ForgetSocketTarget(SOCKET s) {
-    if (s == INVALID_SOCKET) return;
-    std::lock_guard<std::mutex> lock(g_socketTargetsMtx);
-    g_socketTargets.erase(s);
-}
 
 // ConnectEx 异步上下文
 struct ConnectExContext {
@@ -136,17 +134,17 @@ struct ConnectExContext {
     DWORD sendLen;
     LPDWORD bytesSent;
     bool isUdp = false;      // 是否为 UDP ConnectEx（用于 QUIC/HTTP3 的透明代理）
-    ULONGLONG createdTick; // 记录创建时间，便于清理超时上下文
+    LPOVERLAPPED ovl = nullptr; // 所属 OVERLAPPED，过期清理时据此摘除 overlapped 登记
 };
 
-static std::unordered_map<LPOVERLAPPED, ConnectExContext> g_connectExPending;
-static std::mutex g_connectExMtx;
 static std::mutex g_connectExHookMtx;
 // ConnectEx 在不同 Provider 下可能返回不同函数指针，这里按 CatalogEntryId 记录各自的 trampoline
 static std::unordered_map<DWORD, LPFN_CONNECTEX> g_connectExOriginalByCatalog;
 // ConnectEx 目标函数指针可能被多个 Provider 复用，这里按“目标函数地址”记录 trampoline，便于复用与补全 Catalog 映射
 static std::unordered_map<void*, LPFN_CONNECTEX> g_connectExTrampolineByTarget;
 static const ULONGLONG kConnectExPendingTtlMs = 60000; // 超过 60 秒的上下文视为过期
+// 未完成的 ConnectEx 上下文：slab + 代数句柄 + 时间轮（100ms 粒度，跨度约 102 秒 > TTL），过期处理均摊 O(1)
+static Network::ExpiringSlab<ConnectExContext> g_connectExPending;
 
 // ============= UDP/QUIC 代理支持（SOCKS5 UDP Associate） =============
 
@@ -164,10 +162,12 @@ struct UdpProxyContext {
     uint16_t defaultTargetPort = 0;
     bool hasDefaultTarget = false;
 
+    // 默认目标对应的 SOCKS5 UDP 头：设置 default target 时编码一次，send/WSASend 直接复用
+    uint8_t defaultHeader[Network::Socks5Udp::kMaxUdpHeaderBytes] = {};
+    size_t defaultHeaderLen = 0;
+
     ULONGLONG createdTick = 0;
 };
-static std::unordered_map<SOCKET, UdpProxyContext> g_udpProxy;
-static std::mutex g_udpProxyMtx;
 
 // UDP Overlapped 上下文（用于 IOCP/CompletionRoutine 场景下解封装/调整 bytesTransferred）
 struct UdpOverlappedSendCtx {
@@ -179,9 +179,19 @@ struct UdpOverlappedSendCtx {
     LPWSAOVERLAPPED_COMPLETION_ROUTINE userCompletion = nullptr;
 };
 
+// SOCKS5 UDP 回包就地接收布局：[scratch(预测头长)] + 用户缓冲区 + [tail]
+// segs 与 bufs 一一对应：bufs 用于投递 WSARecv/WSARecvFrom，segs 用于完成后修正
+struct UdpInPlaceLayout {
+    DWORD count = 0;
+    WSABUF bufs[Network::UdpRecvInPlace::kMaxUserSegments + 2];
+    Network::UdpRecvInPlace::Segment segs[Network::UdpRecvInPlace::kMaxUserSegments + 2];
+    uint8_t scratch[Network::UdpRecvInPlace::kMaxHeaderBytes];
+    uint8_t tail[Network::UdpRecvInPlace::kMaxHeaderBytes];
+};
+
+// 接收上下文来自 UdpRecvCtxPool()，复用时不重新构造：每次投递前调用 Reset
 struct UdpOverlappedRecvCtx {
     SOCKET sock = INVALID_SOCKET;
-    std::vector<uint8_t> recvBuf;        // 实际接收缓冲区（包含 SOCKS5 UDP 头 + payload）
     LPWSABUF userBufs = nullptr;
     DWORD userBufCount = 0;
     LPDWORD userBytesPtr = nullptr;
@@ -193,11 +203,181 @@ struct UdpOverlappedRecvCtx {
     int fromTmpLen = (int)sizeof(fromTmp);
 
     LPWSAOVERLAPPED_COMPLETION_ROUTINE userCompletion = nullptr;
+
+    bool inPlace = false;
+    UdpInPlaceLayout layout;
+    std::vector<uint8_t> fixup;          // 预测失败时的平移暂存区（复用容量）
+
+    // 整包复制（用户缓冲区过多时的回退路径）：包含 SOCKS5 UDP 头 + payload，复用容量
+    std::vector<uint8_t> recvBuf;
+    uint32_t postAllocs = 0;             // 本次投递产生的堆分配次数（统计用）
+
+    void Reset() {
+        sock = INVALID_SOCKET;
+        userBufs = nullptr;
+        userBufCount = 0;
+        userBytesPtr = nullptr;
+        userFlagsPtr = nullptr;
+        userFrom = nullptr;
+        userFromLen = nullptr;
+        fromTmpLen = (int)sizeof(fromTmp);
+        userCompletion = nullptr;
+        inPlace = false;
+        layout.count = 0;
+        recvBuf.clear();
+        postAllocs = 0;
+    }
+};
+
+// 接收上下文池：避免每次 overlapped 接收 make_shared + 整包 vector
+static Network::SlabPool<UdpOverlappedRecvCtx, 512>& UdpRecvCtxPool() {
+    static Network::SlabPool<UdpOverlappedRecvCtx, 512> pool;
+    return pool;
+}
+static Network::UdpRecvInPlace::Counters g_udpRecvCounters;
+
+// ============= 统一 socket 上下文表 =============
+// 每个被接管 socket 一条记录：原始目标、UDP 代理状态、尚未完成的 overlapped 操作
+// 设计意图：
+// - 取代原先 socket 目标 / UDP 代理 / overlapped 各自一张全局 map + 全局锁的做法，
+//   收发路径只需一次分片查表（分片读锁）+ 记录自身的锁
+// - 记录为侵入式引用计数：closesocket 摘除后，仍在使用该记录的线程可安全用完
+// - closesocket 在 TeardownSocketContext 一处完成全部清理
+struct SocketContext : Network::RefCounted<SocketContext> {
+    explicit SocketContext(SOCKET s) : sock(s) {}
+
+    const SOCKET sock;
+    std::mutex mtx;                                // 保护以下字段
+
+    bool hasTarget = false;                        // 用于 closesocket/shutdown 时输出更可复盘的断开日志
+    SocketTargetInfo target;
+
+    bool hasUdpProxy = false;
+    UdpProxyContext udp;
+
+    std::vector<LPOVERLAPPED> pendingOverlapped;   // 本 socket 上登记在 g_overlapped 中的操作
+};
+static Network::RefTable<SOCKET, SocketContext> g_sockets;
+
+static Network::RefPtr<SocketContext> FindSocketContext(SOCKET s) {
+    if (s == INVALID_SOCKET) return Network::RefPtr<SocketContext>();
+    return g_sockets.Find(s);
+}
+
+static Network::RefPtr<SocketContext> GetOrCreateSocketContext(SOCKET s) {
+    return g_sockets.FindOrCreate(s, [s]() { return new SocketContext(s); });
+}
+
+// overlapped 操作索引：完成通知（IOCP/CompletionRoutine/WSAGetOverlappedResult）只带 OVERLAPPED 指针，
+// 因此按 OVERLAPPED 建索引；所属 socket 记录同时登记该指针，便于 closesocket 一并清理
+enum class OverlappedKind : uint8_t {
+    None,
+    UdpSend,
+    UdpRecv,
+    ConnectEx,
+};
+
+struct OverlappedEntry {
+    OverlappedKind kind = OverlappedKind::None;
+    SOCKET sock = INVALID_SOCKET;
+    UdpOverlappedSendCtx* send = nullptr;     // new 分配
+    UdpOverlappedRecvCtx* recv = nullptr;     // 来自 UdpRecvCtxPool()
+    uint64_t connectEx = 0;                   // g_connectExPending 句柄
 };
+static Network::ShardedTable<LPOVERLAPPED, OverlappedEntry> g_overlapped;
+// g_overlapped 的无锁成员预过滤：IOCP 出队的绝大多数 OVERLAPPED 未登记，一次原子读取即可跳过分片表
+// 约定：插入 g_overlapped 前 Add，从 g_overlapped 删除后 Remove（同一 OVERLAPPED 被替换登记时计数不变）
+static Network::PointerFilter<> g_overlappedFilter;
+
+static bool MayBeTrackedOverlapped(LPOVERLAPPED ovl) {
+    return g_overlappedFilter.MayContain(ovl);
+}
 
-static std::unordered_map<LPWSAOVERLAPPED, std::shared_ptr<UdpOverlappedSendCtx>> g_udpOvlSend;
-static std::unordered_map<LPWSAOVERLAPPED, std::shared_ptr<UdpOverlappedRecvCtx>> g_udpOvlRecv;
-static std::mutex g_udpOvlMtx;
+static void FreeOverlappedEntry(OverlappedEntry* e) {
+    delete e->send;
+    e->send = nullptr;
+    UdpRecvCtxPool().Release(e->recv);
+    e->recv = nullptr;
+    if (e->connectEx) g_connectExPending.Erase(e->connectEx);
+    e->connectEx = 0;
+}
+
+static void UntrackSocketOverlapped(SOCKET s, LPOVERLAPPED ovl) {
+    auto ctx = FindSocketContext(s);
+    if (!ctx) return;
+    std::lock_guard<std::mutex> lock(ctx->mtx);
+    auto& pending = ctx->pendingOverlapped;
+    for (size_t i = 0; i < pending.size(); ++i) {
+        if (pending[i] == ovl) {
+            pending[i] = pending.back();
+            pending.pop_back();
+            break;
+        }
+    }
+}
+
+// 登记 overlapped 操作（接管 entry 中的上下文所有权）；同一 OVERLAPPED 的残留旧登记会被释放
+static void TrackOverlapped(LPOVERLAPPED ovl, OverlappedEntry entry) {
+    if (!ovl) {
+        FreeOverlappedEntry(&entry);
+        return;
+    }
+    const SOCKET s = entry.sock;
+    OverlappedEntry stale{};
+    bool replaced = false;
+    g_overlappedFilter.Add(ovl);
+    g_overlapped.InsertIfAbsent(ovl, entry, [&](OverlappedEntry& existing) {
+        stale = existing;
+        existing = entry;
+        replaced = true;
+    });
+    if (replaced) g_overlappedFilter.Remove(ovl);
+    if (stale.kind != OverlappedKind::None) {
+        if (stale.sock != s) UntrackSocketOverlapped(stale.sock, ovl);
+        FreeOverlappedEntry(&stale);
+    }
+    auto ctx = GetOrCreateSocketContext(s);
+    std::lock_guard<std::mutex> lock(ctx->mtx);
+    for (LPOVERLAPPED p : ctx->pendingOverlapped) {
+        if (p == ovl) return;
+    }
+    ctx->pendingOverlapped.push_back(ovl);
+}
+
+// 取出满足 pred(const OverlappedEntry&) 的 overlapped 登记（调用方负责 FreeOverlappedEntry）
+template <typename Pred>
+static bool TakeOverlapped(LPOVERLAPPED ovl, Pred&& pred, OverlappedEntry* out) {
+    if (!ovl || !out) return false;
+    if (!MayBeTrackedOverlapped(ovl)) return false;
+    if (!g_overlapped.EraseWhere(ovl, pred, out)) return false;
+    g_overlappedFilter.Remove(ovl);
+    UntrackSocketOverlapped(out->sock, ovl);
+    return true;
+}
+
+static bool IsUdpOverlappedEntry(const OverlappedEntry& e) {
+    return e.kind == OverlappedKind::UdpSend || e.kind == OverlappedKind::UdpRecv;
+}
+
+static void RememberSocketTarget(SOCKET s, const std::string& host, uint16_t port,
+                                 Core::SharedStats::FlowRoute route = Core::SharedStats::FlowRoute::ProxyTcp,
+                                 bool learnedDirect = false) {
+    if (s == INVALID_SOCKET || host.empty() || port == 0) return;
+    auto ctx = GetOrCreateSocketContext(s);
+    std::lock_guard<std::mutex> lock(ctx->mtx);
+    ctx->hasTarget = true;
+    ctx->target = SocketTargetInfo{host, port, GetTickCount64(), route, learnedDirect};
+}
+
+static bool TryGetSocketTarget(SOCKET s, SocketTargetInfo* out) {
+    if (!out) return false;
+    auto ctx = FindSocketContext(s);
+    if (!ctx) return false;
+    std::lock_guard<std::mutex> lock(ctx->mtx);
+    if (!ctx->hasTarget) return false;
+    *out = ctx->target;
+    return true;
+}
 
 // 为了避免日志被大量非目标进程淹没，这里仅首次记录“跳过注入”的进程名
 static std::unordered_map<std::string, bool> g_loggedSkipProcesses;
@@ -267,12 +447,110 @@ static bool TryGetSocketType(SOCKET s, int* outType) {
     return true;
 }
 
+// socket 分类缓存：send/recv 等热路径据此跳过 getsockopt(SO_TYPE)，closesocket 时失效
+static Network::SocketClassCache<> g_socketClass;
+
+// ============= 指标计数（供回环指标端点读取） =============
+// 热路径只做分片计数器的一次 relaxed 原子加；聚合与格式化在指标线程中完成
+
+// 连接的路由去向（action + reason 两个标签）
+enum class ConnectRoute : uint8_t {
+    Proxy = 0,
+    RuleDirect,      // 路由规则 direct
+    DnsDirect,       // 53 端口按 dns_mode=direct 直连
+    PortDirect,      // 端口不在白名单
+    CircuitDirect,   // 熔断打开，open_action=direct
+    CircuitReject,   // 熔断打开，open_action=fail
+    ProxyDisabled,   // 未配置代理
+    BypassLoopback,  // 回环目标
+    BypassProxySelf, // 目标即代理本身
+    FamilyDirect,    // 非 IPv4/IPv6 地址族
+    LearnedDirect,   // default_action=learn 学习到的直连偏好
+    Count
+};
+
+struct HookMetrics {
+    Core::ShardedCounter<> connects[(size_t)ConnectRoute::Count];
+    Core::LabeledHistograms handshakeOk;   // 按上游代理的握手耗时（成功）
+    Core::LabeledHistograms handshakeFail; // 按上游代理的握手耗时（失败）
+    Core::ShardedCounter<> socketClassHits;
+    Core::ShardedCounter<> socketClassMisses;
+    Core::ShardedCounter<> proxyEndpointHits;
+    Core::ShardedCounter<> proxyEndpointMisses;
+    Core::ShardedCounter<> iocpCompletions[2]; // [0]=GetQueuedCompletionStatus, [1]=GetQueuedCompletionStatusEx
+    Core::ShardedCounter<> iocpConnectEx;      // 出队时完成代理握手的 ConnectEx
+    Core::ShardedCounter<> udpAssociates[3];   // [0]=共享中继, [1]=预热池, [2]=现场建立
+    Core::ShardedCounter<> udpAssociateFailures;
+    Core::ShardedCounter<> routeProbes;        // default_action=learn 发起的直连探测
+};
+static HookMetrics g_metrics;
+
+static Network::SocketClass SocketClassFromType(int soType) {
+    return soType == SOCK_DGRAM ? Network::SocketClass::Udp : Network::SocketClass::DirectTcp;
+}
+
+// 取得 socket 分类：缓存命中仅一次原子读取；未命中时读取一次 SO_TYPE 并写入缓存
+// 读取失败时返回 Unknown 且不缓存（与原先“读取失败不进入 UDP 分支”的行为一致）
+static Network::SocketClass ClassifySocket(SOCKET s) {
+    const Network::SocketClass cached = g_socketClass.Get((uintptr_t)s);
+    if (cached != Network::SocketClass::Unknown) {
+        g_metrics.socketClassHits.Add();
+        return cached;
+    }
+    g_metrics.socketClassMisses.Add();
+    int soType = 0;
+    if (!TryGetSocketType(s, &soType)) return Network::SocketClass::Unknown;
+    return g_socketClass.Publish((uintptr_t)s, SocketClassFromType(soType));
+}
+
+static bool IsDatagramSocket(SOCKET s) {
+    return Network::IsDatagramSocketClass(ClassifySocket(s));
+}
+
+// send/recv 热路径快判：已分类为 TCP（直连或已建隧道）的 socket 只需一次原子读取即可直接透传
+static bool IsStreamSocketCached(SOCKET s) {
+    return Network::IsStreamSocketClass(g_socketClass.Get((uintptr_t)s));
+}
+
+// 流量计数：收发热路径只更新分片计数器（数据报 socket 同时计数据报个数），不做任何格式化
+// buf/bufLen 为首个用户缓冲区，仅在 traffic_logging 采样时用于负载预览
+// 同时交给抓包（未启用或该流未被采样时只有一次原子读取）与连接阶段追踪（未追踪的 socket 只有一到两次原子读取）
+static void CountSend(SOCKET s, const char* buf, size_t bufLen, uint64_t bytes) {
+    const uint64_t packets = Network::IsDatagramSocketClass(g_socketClass.Get((uintptr_t)s)) ? 1 : 0;
+    Network::TrafficMonitor::Instance().RecordSend(s, buf, bufLen, bytes, packets);
+    Network::PacketCapture::Instance().Record(s, Network::CaptureDirection::Send, buf, bufLen, bytes);
+    if (bytes) Core::ConnTrace::Instance().OnSend((uint64_t)s);
+}
+
+static void CountRecv(SOCKET s, const char* buf, size_t bufLen, uint64_t bytes) {
+    const uint64_t packets = Network::IsDatagramSocketClass(g_socketClass.Get((uintptr_t)s)) ? 1 : 0;
+    Network::TrafficMonitor::Instance().RecordRecv(s, buf, bufLen, bytes, packets);
+    Network::PacketCapture::Instance().Record(s, Network::CaptureDirection::Recv, buf, bufLen, bytes);
+    if (bytes) Core::ConnTrace::Instance().OnRecv((uint64_t)s);
+}
+
+// 分散缓冲区版本（WSASend/WSARecv 等）：计数同上，抓包时拷贝 snaplen 覆盖到的各个缓冲区
+static void CountSendBufs(SOCKET s, const WSABUF* bufs, DWORD count, uint64_t bytes) {
+    const uint64_t packets = Network::IsDatagramSocketClass(g_socketClass.Get((uintptr_t)s)) ? 1 : 0;
+    Network::TrafficMonitor::Instance().RecordSend(s, count ? bufs[0].buf : nullptr, count ? bufs[0].len : 0, bytes, packets);
+    Network::PacketCapture::Instance().Record(s, Network::CaptureDirection::Send, bufs, count, bytes);
+    if (bytes) Core::ConnTrace::Instance().OnSend((uint64_t)s);
+}
+
+static void CountRecvBufs(SOCKET s, const WSABUF* bufs, DWORD count, uint64_t bytes) {
+    const uint64_t packets = Network::IsDatagramSocketClass(g_socketClass.Get((uintptr_t)s)) ? 1 : 0;
+    Network::TrafficMonitor::Instance().RecordRecv(s, count ? bufs[0].buf : nullptr, count ? bufs[0].len : 0, bytes, packets);
+    Network::PacketCapture::Instance().Record(s, Network::CaptureDirection::Recv, bufs, count, bytes);
+    if (bytes) Core::ConnTrace::Instance().OnRecv((uint64_t)s);
+}
+
 // 统一 socket 类型判定入口：只读取一次 SO_TYPE，避免热路径重复 getsockopt
 // 兼容性策略：读取失败时仍按 SOCK_STREAM 处理（保持历史行为，降低误判风险）
 static int GetSocketTypeForProxyDecision(SOCKET s, bool* outKnown = nullptr) {
     int soType = 0;
     const bool known = TryGetSocketType(s, &soType);
     if (outKnown) *outKnown = known;
+    if (known) g_socketClass.Publish((uintptr_t)s, SocketClassFromType(soType));
     return known ? soType : SOCK_STREAM;
 }
 
@@ -373,9 +651,7 @@ static bool ResolveOriginalTarget(const sockaddr* name, std::string* host, uint1
                     if (domain.empty()) {
                         std::string ipStr = Network::FakeIP::IpToString(addr->sin_addr.s_addr);
                         // FakeIP::GetDomain 已在未命中时输出告警；这里降级为调试，避免重复刷屏
-                        if (Core::Logger::IsEnabled(Core::LogLevel::Debug)) {
-                            Core::Logger::Debug("FakeIP: 命中但映射缺失, ip=" + ipStr);
-                        }
+                        AGP_LOG_DEBUG(FakeIP, "FakeIP: 命中但映射缺失, ip=" + ipStr);
                         *host = ipStr;
                     } else {
                         *host = domain;
@@ -400,9 +676,7 @@ static bool ResolveOriginalTarget(const sockaddr* name, std::string* host, uint1
                     if (domain.empty()) {
                         std::string ipStr = Network::FakeIP::IpToString(addr4.s_addr);
                         // FakeIP::GetDomain 已在未命中时输出告警；这里降级为调试，避免重复刷屏
-                        if (Core::Logger::IsEnabled(Core::LogLevel::Debug)) {
-                            Core::Logger::Debug("FakeIP(v4-mapped): 命中但映射缺失, ip=" + ipStr);
-                        }
+                        AGP_LOG_DEBUG(FakeIP, "FakeIP(v4-mapped): 命中但映射缺失, ip=" + ipStr);
                         *host = ipStr;
                     } else {
                         *host = domain;
@@ -456,6 +730,24 @@ static std::string SockaddrToString(const sockaddr* addr) {
     return "";
 }
 
+// sockaddr -> 结构化日志地址参数（只拷贝字节，渲染推迟到输出时）
+static Core::LogAddr ToLogAddr(const sockaddr* addr) {
+    Core::LogAddr out;
+    if (!addr) return out;
+    if (addr->sa_family == AF_INET) {
+        const auto* addr4 = (const sockaddr_in*)addr;
+        out.family = 4;
+        out.port = ntohs(addr4->sin_port);
+        memcpy(out.bytes, &addr4->sin_addr, 4);
+    } else if (addr->sa_family == AF_INET6) {
+        const auto* addr6 = (const sockaddr_in6*)addr;
+        out.family = 6;
+        out.port = ntohs(addr6->sin6_port);
+        memcpy(out.bytes, &addr6->sin6_addr, 16);
+    }
+    return out;
+}
+
 // 从 sockaddr 提取纯 IP（不含端口）
 static bool SockaddrToIp(const sockaddr* addr, std::string* outIp, bool* outIsV6) {
     if (!addr || !outIp) return false;
@@ -528,37 +820,32 @@ static bool IsSockaddrLoopback(const sockaddr* addr) {
     return false;
 }
 
-// UDP 强阻断策略会触发大量重试（尤其是 QUIC），这里做简单限流，避免日志/IO 影响性能
-static bool ShouldLogUdpBlock() {
-    static std::atomic<int> s_logCount{0};
-    const int n = s_logCount.fetch_add(1, std::memory_order_relaxed);
-    if (n < 20) return true; // 仅前 20 次输出详细阻断日志
-    if (n == 20) {
-        Core::Logger::Warn("UDP 阻断日志过多，后续将仅在 [调试] 级别输出（避免 QUIC 重试导致日志/性能问题；注意：WSA错误码为策略阻断返回，并非真实网络故障）");
-    }
-    return Core::Logger::IsEnabled(Core::LogLevel::Debug);
-}
+// connect 决策前导的输入：socket 类型仅在已配置代理时查询，目标端口/回环仅 UDP 分支需要
+struct ConnectPrologueInput {
+    Core::ConnectFacts facts;
+    int soType = SOCK_STREAM;
+    bool hasPort = false;
+};
 
-// UDP 代理失败可能会触发 QUIC 的高频重试，这里同样做简单限流，避免日志/IO 影响性能
-static bool ShouldLogUdpProxyFail() {
-    static std::atomic<int> s_failCount{0};
-    const int n = s_failCount.fetch_add(1, std::memory_order_relaxed);
-    if (n < 20) return true;
-    if (n == 20) {
-        Core::Logger::Warn("UDP 代理失败日志过多，后续将仅在 [调试] 级别输出（避免 QUIC 重试导致日志/性能问题）");
+static ConnectPrologueInput CollectConnectFacts(SOCKET s, const sockaddr* name, const Core::RuntimePolicy& policy) {
+    ConnectPrologueInput in;
+    if (policy.proxyEnabled) {
+        in.soType = GetSocketTypeForProxyDecision(s);
+        if (in.soType == SOCK_DGRAM) {
+            in.facts.socket = Core::SocketKind::Datagram;
+            in.hasPort = TryGetSockaddrPort(name, &in.facts.port);
+            in.facts.loopback = IsSockaddrLoopback(name);
+        } else if (in.soType != SOCK_STREAM) {
+            in.facts.socket = Core::SocketKind::Other;
+        }
     }
-    return Core::Logger::IsEnabled(Core::LogLevel::Debug);
-}
-
-// connect/ConnectEx 属于高频热路径，路由日志默认做限流，避免 Info 级别大量刷盘
-static bool ShouldLogRouteDecisionInfo() {
-    static std::atomic<int> s_routeCount{0};
-    const int n = s_routeCount.fetch_add(1, std::memory_order_relaxed);
-    if (n < 200) return true;
-    if (n == 200) {
-        Core::Logger::Info("路由决策日志过多，后续将仅在 [调试] 级别输出（避免高并发场景日志 I/O 影响性能）");
+    if (name->sa_family == AF_INET6) {
+        const auto* addr6 = (const sockaddr_in6*)name;
+        in.facts.addr = IN6_IS_ADDR_V4MAPPED(&addr6->sin6_addr) ? Core::AddrKind::IPv4MappedIPv6 : Core::AddrKind::IPv6;
+    } else if (name->sa_family != AF_INET) {
+        in.facts.addr = Core::AddrKind::Other;
     }
-    return Core::Logger::IsEnabled(Core::LogLevel::Debug);
+    return in;
 }
 
 // 从 socket 读取当前端点信息（仅用于日志；失败时返回空字符串）
@@ -590,6 +877,260 @@ static bool IsProxySelfTarget(const std::string& host, uint16_t port, const Core
     return port == proxy.port && (host == proxy.host || host == "127.0.0.1");
 }
 
+// ============= 代理地址解析缓存 + 胜出地址记忆 =============
+// 设计意图：代理 host 为域名且解析出多个地址时，按 socket 地址族记住可达地址，后续连接直接走该地址（快路径）。
+// - 本模块自行创建的 socket（UDP 控制连接）用 Happy Eyeballs 竞速，胜出 socket 直接交给调用方使用；
+// - 应用 socket 只能 connect 一次，不额外竞速：直接连接当前候选，连通后记住该地址；
+//   连接代理失败时清除该地址族的记忆并轮换到下一个候选（按族交替），应用重试即换用另一地址族。
+// 说明：host 为 IP 字面量（常见的 127.0.0.1/::1）时只有一个候选，不引入任何额外开销。
+struct ProxyEndpointCache {
+    std::string host;
+    int port = 0;
+    std::vector<Network::HappyEyeballs::Candidate> candidates; // 原生地址族，端口已填充
+    ULONGLONG resolvedTick = 0;
+    bool hasWinnerV4 = false; // AF_INET socket 的胜出地址
+    Network::HappyEyeballs::Candidate winnerV4;
+    bool hasWinnerV6 = false; // AF_INET6（双栈）socket / 内部控制连接的胜出地址，可能为 IPv4
+    Network::HappyEyeballs::Candidate winnerV6;
+    size_t cursorV4 = 0; // 无记忆时应用 socket 使用的候选下标（按族交替排序后），连接失败时前移
+    size_t cursorV6 = 0;
+};
+static ProxyEndpointCache g_proxyEndpoints;
+static std::mutex g_proxyEndpointsMtx;
+static const ULONGLONG kProxyEndpointCacheTtlMs = 300000; // 解析结果缓存 5 分钟
+
+// 解析代理地址的全部候选（A + AAAA）；使用原始 getaddrinfo，避免被 FakeIP 接管
+static bool ResolveProxyCandidates(const Core::ProxyConfig& proxy, std::vector<Network::HappyEyeballs::Candidate>* out) {
+    if (!out) return false;
+    out->clear();
+    Network::HappyEyeballs::Candidate literal;
+    auto* v4 = (sockaddr_in*)&literal.addr;
+    auto* v6 = (sockaddr_in6*)&literal.addr;
+    if (inet_pton(AF_INET, proxy.host.c_str(), &v4->sin_addr) == 1) {
+        v4->sin_family = AF_INET;
+        v4->sin_port = htons((u_short)proxy.port);
+        literal.addrLen = (int)sizeof(sockaddr_in);
+        out->push_back(literal);
+        return true;
+    }
+    if (inet_pton(AF_INET6, proxy.host.c_str(), &v6->sin6_addr) == 1) {
+        v6->sin6_family = AF_INET6;
+        v6->sin6_port = htons((u_short)proxy.port);
+        literal.addrLen = (int)sizeof(sockaddr_in6);
+        out->push_back(literal);
+        return true;
+    }
+
+    const ULONGLONG now = GetTickCount64();
+    {
+        std::lock_guard<std::mutex> lock(g_proxyEndpointsMtx);
+        if (g_proxyEndpoints.host == proxy.host && g_proxyEndpoints.port == proxy.port &&
+            !g_proxyEndpoints.candidates.empty() && now - g_proxyEndpoints.resolvedTick < kProxyEndpointCacheTtlMs) {
+            *out = g_proxyEndpoints.candidates;
+            g_metrics.proxyEndpointHits.Add();
+            return true;
+        }
+    }
+    g_metrics.proxyEndpointMisses.Add();
+
+    addrinfo hints{};
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    hints.ai_protocol = IPPROTO_TCP;
+    addrinfo* res = nullptr;
+    int rc = fpGetAddrInfo ? fpGetAddrInfo(proxy.host.c_str(), nullptr, &hints, &res)
+                           : getaddrinfo(proxy.host.c_str(), nullptr, &hints, &res);
+    if (rc != 0 || !res) {
+        if (res) freeaddrinfo(res);
+        AGP_LOG_ERROR(Route, "代理地址解析失败: " + proxy.host + ", 错误码=" + std::to_string(rc));
+        return false;
+    }
+    for (addrinfo* ai = res; ai; ai = ai->ai_next) {
+        if (!ai->ai_addr) continue;
+        Network::HappyEyeballs::Candidate c;
+        if (ai->ai_family == AF_INET && ai->ai_addrlen >= sizeof(sockaddr_in)) {
+            memcpy(&c.addr, ai->ai_addr, sizeof(sockaddr_in));
+            ((sockaddr_in*)&c.addr)->sin_port = htons((u_short)proxy.port);
+            c.addrLen = (int)sizeof(sockaddr_in);
+        } else if (ai->ai_family == AF_INET6 && ai->ai_addrlen >= sizeof(sockaddr_in6)) {
+            memcpy(&c.addr, ai->ai_addr, sizeof(sockaddr_in6));
+            ((sockaddr_in6*)&c.addr)->sin6_port = htons((u_short)proxy.port);
+            c.addrLen = (int)sizeof(sockaddr_in6);
+        } else {
+            continue;
+        }
+        out->push_back(c);
+    }
+    freeaddrinfo(res);
+    if (out->empty()) {
+        AGP_LOG_ERROR(Route, "代理地址解析失败: " + proxy.host + ", 无可用地址");
+        return false;
+    }
+
+    std::lock_guard<std::mutex> lock(g_proxyEndpointsMtx);
+    g_proxyEndpoints = ProxyEndpointCache{};
+    g_proxyEndpoints.host = proxy.host;
+    g_proxyEndpoints.port = proxy.port;
+    g_proxyEndpoints.candidates = *out;
+    g_proxyEndpoints.resolvedTick = now;
+    return true;
+}
+
+static bool TryGetProxyWinner(int socketFamily, Network::HappyEyeballs::Candidate* out) {
+    std::lock_guard<std::mutex> lock(g_proxyEndpointsMtx);
+    if (socketFamily == AF_INET && g_proxyEndpoints.hasWinnerV4) {
+        if (out) *out = g_proxyEndpoints.winnerV4;
+        return true;
+    }
+    if (socketFamily != AF_INET && g_proxyEndpoints.hasWinnerV6) {
+        if (out) *out = g_proxyEndpoints.winnerV6;
+        return true;
+    }
+    return false;
+}
+
+static void RememberProxyWinner(int socketFamily, const Network::HappyEyeballs::Candidate& winner) {
+    std::lock_guard<std::mutex> lock(g_proxyEndpointsMtx);
+    if (socketFamily == AF_INET) {
+        g_proxyEndpoints.winnerV4 = winner;
+        g_proxyEndpoints.hasWinnerV4 = true;
+    } else {
+        g_proxyEndpoints.winnerV6 = winner;
+        g_proxyEndpoints.hasWinnerV6 = true;
+    }
+}
+
+// 两个地址是否相同（端口除外）；AF_INET6 socket 上的 IPv4 地址以 v4-mapped 形式出现
+static bool SameProxyAddress(const sockaddr* a, const Network::HappyEyeballs::Candidate& c) {
+    if (!a) return false;
+    if (a->sa_family == AF_INET && c.addr.ss_family == AF_INET) {
+        return ((const sockaddr_in*)a)->sin_addr.s_addr == ((const sockaddr_in*)&c.addr)->sin_addr.s_addr;
+    }
+    if (a->sa_family != AF_INET6) return false;
+    const in6_addr& a6 = ((const sockaddr_in6*)a)->sin6_addr;
+    if (c.addr.ss_family == AF_INET6) {
+        return memcmp(&a6, &((const sockaddr_in6*)&c.addr)->sin6_addr, sizeof(in6_addr)) == 0;
+    }
+    static const unsigned char kMappedPrefix[12] = {0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0xff, 0xff};
+    const unsigned char* bytes = (const unsigned char*)&a6;
+    return memcmp(bytes, kMappedPrefix, sizeof(kMappedPrefix)) == 0 &&
+           memcmp(bytes + 12, &((const sockaddr_in*)&c.addr)->sin_addr, 4) == 0;
+}
+
+// 应用 socket 已连通代理（peer 为实际连接的代理地址）：该地址族尚无记忆时记住它
+static void NoteProxyEndpointConnected(const sockaddr* peer) {
+    if (!peer) return;
+    std::lock_guard<std::mutex> lock(g_proxyEndpointsMtx);
+    if (g_proxyEndpoints.candidates.size() < 2) return;
+    const bool v4 = peer->sa_family == AF_INET;
+    if (v4 ? g_proxyEndpoints.hasWinnerV4 : g_proxyEndpoints.hasWinnerV6) return;
+    for (const auto& c : g_proxyEndpoints.candidates) {
+        if (!SameProxyAddress(peer, c)) continue;
+        if (v4) {
+            g_proxyEndpoints.winnerV4 = c;
+            g_proxyEndpoints.hasWinnerV4 = true;
+        } else {
+            g_proxyEndpoints.winnerV6 = c;
+            g_proxyEndpoints.hasWinnerV6 = true;
+        }
+        return;
+    }
+}
+
+// 连接代理失败（TCP 层）时调用：清除该地址族的记忆并轮换候选；AF_UNSPEC 表示地址族未知，两者都清除
+// 说明：握手失败不代表地址不可达，不在此处理
+static void NoteProxyEndpointFailed(int socketFamily) {
+    std::lock_guard<std::mutex> lock(g_proxyEndpointsMtx);
+    if (socketFamily != AF_INET6) {
+        g_proxyEndpoints.hasWinnerV4 = false;
+        g_proxyEndpoints.cursorV4++;
+    }
+    if (socketFamily != AF_INET) {
+        g_proxyEndpoints.hasWinnerV6 = false;
+        g_proxyEndpoints.cursorV6++;
+    }
+}
+
+// 竞速并返回胜出 socket（非阻塞）；candidates 为空或全部失败时返回 INVALID_SOCKET
+static SOCKET RaceProxyCandidates(const Core::ProxyConfig& proxy, int socketFamily,
+                                  std::vector<Network::HappyEyeballs::Candidate> candidates,
+                                  Network::HappyEyeballs::Candidate* outWinner) {
+    // 首选族：已有胜出记忆则以其地址族优先，否则按 RFC 8305 优先 IPv6
+    int preferredFamily = AF_INET6;
+    Network::HappyEyeballs::Candidate remembered;
+    if (TryGetProxyWinner(socketFamily, &remembered)) {
+        preferredFamily = remembered.addr.ss_family;
+    }
+    auto ordered = Network::HappyEyeballs::Interleave(candidates, preferredFamily);
+
+    auto& config = Core::Config::Instance();
+    Network::HappyEyeballs::RaceResult race;
+    if (!Network::HappyEyeballs::Race(ordered, Network::HappyEyeballs::kDefaultStaggerMs, config.timeout.connect_ms,
+                                      fpConnect ? fpConnect : connect, fpCloseSocket ? fpCloseSocket : closesocket, &race)) {
+        AGP_LOG_WARN(Route, "代理地址竞速: 全部失败, proxy=" + proxy.host + ":" + std::to_string(proxy.port) +
+                            ", 候选=" + std::to_string(ordered.size()) +
+                            ", 尝试=" + std::to_string(race.attempts) +
+                            ", 用时=" + std::to_string(race.elapsedMs) + "ms" +
+                            ", WSA错误码=" + std::to_string(race.lastError));
+        WSASetLastError(race.lastError);
+        return INVALID_SOCKET;
+    }
+    const auto& winner = ordered[race.winnerIndex];
+    RememberProxyWinner(socketFamily, winner);
+    if (socketFamily == AF_UNSPEC && winner.addr.ss_family == AF_INET && !TryGetProxyWinner(AF_INET, nullptr)) {
+        RememberProxyWinner(AF_INET, winner); // IPv4 胜出地址同样适用于 AF_INET 应用 socket
+    }
+    if (outWinner) *outWinner = winner;
+    if (ordered.size() > 1) {
+        AGP_LOG_INFO(Route, "代理地址竞速: 胜出 addr=" + SockaddrToString((const sockaddr*)&winner.addr) +
+                            ", 候选=" + std::to_string(ordered.size()) +
+                            ", 尝试=" + std::to_string(race.attempts) +
+                            ", 用时=" + std::to_string(race.elapsedMs) + "ms");
+    }
+    return race.sock;
+}
+
+// 为应用 socket 选择代理地址：单候选直接返回；多候选优先用胜出记忆，否则取轮换游标处的候选
+// 说明：不在 connect/ConnectEx 调用路径上竞速（竞速需要额外连接一次，且会阻塞重叠 I/O 调用方）
+static bool PickProxyEndpoint(const Core::ProxyConfig& proxy, int socketFamily, Network::HappyEyeballs::Candidate* out) {
+    std::vector<Network::HappyEyeballs::Candidate> all;
+    if (!ResolveProxyCandidates(proxy, &all)) return false;
+    std::vector<Network::HappyEyeballs::Candidate> usable;
+    for (const auto& c : all) {
+        // AF_INET socket 只能使用 IPv4 地址；AF_INET6 socket 可使用 IPv6 或映射后的 IPv4
+        if (socketFamily == AF_INET && c.addr.ss_family != AF_INET) continue;
+        usable.push_back(c);
+    }
+    if (usable.empty()) {
+        AGP_LOG_ERROR(Route, "代理地址解析失败: " + proxy.host + ", 无可用于地址族 " + std::to_string(socketFamily) + " 的地址");
+        return false;
+    }
+    if (usable.size() == 1) {
+        *out = usable[0];
+        return true;
+    }
+    if (TryGetProxyWinner(socketFamily, out)) {
+        return true;
+    }
+    // 按 RFC 8305 优先 IPv6，交替排序；连接失败时游标前移，下一次连接换用另一地址族
+    const auto ordered = Network::HappyEyeballs::Interleave(usable, AF_INET6);
+    size_t cursor = 0;
+    {
+        std::lock_guard<std::mutex> lock(g_proxyEndpointsMtx);
+        cursor = socketFamily == AF_INET ? g_proxyEndpoints.cursorV4 : g_proxyEndpoints.cursorV6;
+    }
+    *out = ordered[cursor % ordered.size()];
+    return true;
+}
+
+static void MapV4ToV6(const in_addr& addr4, in6_addr* out6) {
+    unsigned char* bytes = reinterpret_cast<unsigned char*>(out6);
+    memset(bytes, 0, 16);
+    bytes[10] = 0xff;
+    bytes[11] = 0xff;
+    memcpy(bytes + 12, &addr4, sizeof(addr4));
+}
+
 static bool BuildProxyAddr(const Core::ProxyConfig& proxy, sockaddr_in* proxyAddr, const sockaddr_in* baseAddr) {
     if (!proxyAddr) return false;
     if (baseAddr) {
@@ -599,21 +1140,12 @@ static bool BuildProxyAddr(const Core::ProxyConfig& proxy, sockaddr_in* proxyAdd
         proxyAddr->sin_family = AF_INET;
     }
     if (inet_pton(AF_INET, proxy.host.c_str(), &proxyAddr->sin_addr) != 1) {
-        // 尝试使用 DNS 解析代理主机名（仅 IPv4）
-        addrinfo hints{};
-        hints.ai_family = AF_INET;
-        hints.ai_socktype = SOCK_STREAM;
-        hints.ai_protocol = IPPROTO_TCP;
-        addrinfo* res = nullptr;
-        int rc = fpGetAddrInfo ? fpGetAddrInfo(proxy.host.c_str(), nullptr, &hints, &res)
-                               : getaddrinfo(proxy.host.c_str(), nullptr, &hints, &res);
-        if (rc != 0 || !res) {
-            Core::Logger::Error("代理地址解析失败: " + proxy.host + ", 错误码=" + std::to_string(rc));
+        // 代理主机名：解析全部 IPv4 地址，多地址时按记忆/轮换选择（仅 IPv4）
+        Network::HappyEyeballs::Candidate picked;
+        if (!PickProxyEndpoint(proxy, AF_INET, &picked)) {
             return false;
         }
-        auto* addr = (sockaddr_in*)res->ai_addr;
-        proxyAddr->sin_addr = addr->sin_addr;
-        freeaddrinfo(res);
+        proxyAddr->sin_addr = ((sockaddr_in*)&picked.addr)->sin_addr;
     }
     proxyAddr->sin_port = htons(proxy.port);
     return true;
@@ -635,42 +1167,17 @@ static bool BuildProxyAddrV6(const Core::ProxyConfig& proxy, sockaddr_in6* proxy
         in_addr addr4{};
         if (inet_pton(AF_INET, proxy.host.c_str(), &addr4) == 1) {
             // IPv4 代理地址映射为 IPv6，兼容双栈 socket
-            unsigned char* bytes = reinterpret_cast<unsigned char*>(&proxyAddr->sin6_addr);
-            memset(bytes, 0, 16);
-            bytes[10] = 0xff;
-            bytes[11] = 0xff;
-            memcpy(bytes + 12, &addr4, sizeof(addr4));
+            MapV4ToV6(addr4, &proxyAddr->sin6_addr);
         } else {
-            // 优先解析 IPv6，失败则回退 IPv4 并映射
-            addrinfo hints{};
-            hints.ai_family = AF_INET6;
-            hints.ai_socktype = SOCK_STREAM;
-            hints.ai_protocol = IPPROTO_TCP;
-            addrinfo* res = nullptr;
-            int rc = fpGetAddrInfo ? fpGetAddrInfo(proxy.host.c_str(), nullptr, &hints, &res)
-                                   : getaddrinfo(proxy.host.c_str(), nullptr, &hints, &res);
-            if (rc == 0 && res) {
-                proxyAddr->sin6_addr = ((sockaddr_in6*)res->ai_addr)->sin6_addr;
-                freeaddrinfo(res);
+            // 代理主机名：A/AAAA 均为候选（IPv4 映射为 v4-mapped），可达地址按地址族记忆
+            Network::HappyEyeballs::Candidate picked;
+            if (!PickProxyEndpoint(proxy, AF_INET6, &picked)) {
+                return false;
+            }
+            if (picked.addr.ss_family == AF_INET6) {
+                proxyAddr->sin6_addr = ((sockaddr_in6*)&picked.addr)->sin6_addr;
             } else {
-                if (res) freeaddrinfo(res);
-                addrinfo hints4{};
-                hints4.ai_family = AF_INET;
-                hints4.ai_socktype = SOCK_STREAM;
-                hints4.ai_protocol = IPPROTO_TCP;
-                rc = fpGetAddrInfo ? fpGetAddrInfo(proxy.host.c_str(), nullptr, &hints4, &res)
-                                   : getaddrinfo(proxy.host.c_str(), nullptr, &hints4, &res);
-                if (rc != 0 || !res) {
-                    Core::Logger::Error("代理地址解析失败: " + proxy.host + ", 错误码=" + std::to_string(rc));
-                    return false;
-                }
-                in_addr resolved4 = ((sockaddr_in*)res->ai_addr)->sin_addr;
-                freeaddrinfo(res);
-                unsigned char* bytes = reinterpret_cast<unsigned char*>(&proxyAddr->sin6_addr);
-                memset(bytes, 0, 16);
-                bytes[10] = 0xff;
-                bytes[11] = 0xff;
-                memcpy(bytes + 12, &resolved4, sizeof(resolved4));
+                MapV4ToV6(((sockaddr_in*)&picked.addr)->sin_addr, &proxyAddr->sin6_addr);
             }
         }
     }
@@ -703,18 +1210,17 @@ static size_t CopyBytesToWsabufs(const uint8_t* src, size_t srcLen, WSABUF* dstB
     return copied;
 }
 
-static bool SendUdpPacketWithRetry(SOCKET s, const uint8_t* data, int len, int flags, int timeoutMs) {
-    if (!data || len <= 0) return true;
-    if (!fpSend) {
-        WSASetLastError(WSAEINVAL);
-        return false;
-    }
+// 聚合发送 SOCKS5 UDP 头 + 用户 payload（WSABUF 描述符拼接，不复制 payload）
+// 说明：使用非 overlapped 的原始 WSASend；非阻塞 socket 上遇到 WSAEWOULDBLOCK 时等待可写后重试
+static bool SendUdpGatherWithRetry(SOCKET s, WSABUF* bufs, DWORD count, DWORD flags, int timeoutMs) {
+    if (!bufs || count == 0) return true;
+    const size_t expected = SumWsabufBytes(bufs, count);
     for (;;) {
-        int sent = fpSend(s, (const char*)data, len, flags);
-        if (sent == len) {
-            return true;
-        }
-        if (sent > 0) {
+        DWORD sent = 0;
+        const int rc = fpWSASend ? fpWSASend(s, bufs, count, &sent, flags, NULL, NULL)
+                                 : WSASend(s, bufs, count, &sent, flags, NULL, NULL);
+        if (rc == 0) {
+            if ((size_t)sent == expected) return true;
             // UDP 理论上不应 partial send；这里按失败处理，避免上层误判
             WSASetLastError(WSAEMSGSIZE);
             return false;
@@ -729,6 +1235,17 @@ static bool SendUdpPacketWithRetry(SOCKET s, const uint8_t* data, int len, int f
     }
 }
 
+// 发送路径使用的 SOCKS5 UDP 头（栈上缓冲，避免每个数据报堆分配）
+struct UdpSendHeader {
+    uint8_t bytes[Network::Socks5Udp::kMaxUdpHeaderBytes];
+    size_t len = 0;
+};
+
+static bool EncodeUdpSendHeader(const std::string& host, uint16_t port, UdpSendHeader* out) {
+    out->len = Network::Socks5::EncodeUdpHeader(host, port, out->bytes, sizeof(out->bytes));
+    return out->len > 0;
+}
+
 static bool FillUserSockaddr(sockaddr* userFrom, LPINT userFromLen, const sockaddr_storage& src, int srcLen) {
     if (!userFromLen) return false;
     if (!userFrom) {
@@ -792,108 +1309,356 @@ static bool BuildUdpRelayAddrForSocketFamily(int socketFamily, const sockaddr_st
     return false;
 }
 
-static SOCKET ConnectTcpToProxyServer(const Core::ProxyConfig& proxy) {
-    // 说明：UDP Associate 需要一个到代理的 TCP 控制连接
-    // 这里使用最小实现：仅支持 IP 直连或常规 DNS 解析（建议 proxy.host 填 127.0.0.1/::1）
-    int family = AF_INET;
-    in6_addr tmp6{};
-    if (!proxy.host.empty() && inet_pton(AF_INET6, proxy.host.c_str(), &tmp6) == 1) {
-        family = AF_INET6;
-    }
+// ============= 上游代理熔断 =============
+// 设计意图：代理宕机时避免每个连接都耗满 connect 超时；状态迁移始终输出日志，便于复盘。
+static std::string ProxyUpstreamKey(const Core::ProxyConfig& proxy) {
+    return proxy.host + ":" + std::to_string(proxy.port);
+}
 
-    SOCKET tcpSock = socket(family, SOCK_STREAM, IPPROTO_TCP);
-    if (tcpSock == INVALID_SOCKET) {
-        int err = WSAGetLastError();
-        Core::Logger::Error("SOCKS5 UDP: 创建 TCP 控制连接失败, WSA错误码=" + std::to_string(err));
-        return INVALID_SOCKET;
+static std::shared_ptr<Network::CircuitBreaker> GetProxyCircuitBreaker(const Core::ProxyConfig& proxy) {
+    auto& config = Core::Config::Instance();
+    if (!config.circuitBreaker.enabled) return nullptr;
+    Network::CircuitBreakerOptions options;
+    options.failureThreshold = (uint32_t)config.circuitBreaker.failure_threshold;
+    options.cooldownMs = (uint64_t)config.circuitBreaker.cooldown_ms;
+    options.halfOpenProbes = (uint32_t)config.circuitBreaker.half_open_probes;
+    return Network::CircuitBreakerRegistry::Instance().Get(ProxyUpstreamKey(proxy), options);
+}
+
+static void LogCircuitTransition(const Core::ProxyConfig& proxy, const Network::CircuitBreaker& breaker,
+                                 const Network::CircuitTransition& t) {
+    if (!t.changed) return;
+    const auto stats = breaker.GetStats();
+    const std::string msg = "[熔断] 上游 " + ProxyUpstreamKey(proxy) + " 状态: " +
+                            Network::CircuitStateToText(t.from) + " -> " + Network::CircuitStateToText(t.to) +
+                            ", 连续失败=" + std::to_string(t.consecutiveFailures) +
+                            ", 累计: opened=" + std::to_string(stats.opened) +
+                            " half_opened=" + std::to_string(stats.halfOpened) +
+                            " closed=" + std::to_string(stats.closed) +
+                            " rejected=" + std::to_string(stats.rejected) +
+                            " failures=" + std::to_string(stats.failures);
+    if (t.to == Network::CircuitState::Open) {
+        AGP_LOG_WARN(Route, msg + ", 冷却=" + std::to_string(breaker.Options().cooldownMs) + "ms");
+    } else {
+        AGP_LOG_INFO(Route, msg);
     }
+}
 
-    // 非阻塞 connect + WaitConnect，避免卡死目标进程
-    u_long nb = 1;
-    ioctlsocket(tcpSock, FIONBIO, &nb);
+// 连接代理前调用：返回 false 表示熔断中；*outFallbackDirect 指示是否按 open_action=direct 回退直连
+// 此时已设置 WSAECONNREFUSED，调用方可直接返回失败
+static bool AllowProxyUpstream(const Core::ProxyConfig& proxy, const std::string& target, bool* outFallbackDirect) {
+    if (outFallbackDirect) *outFallbackDirect = false;
+    auto breaker = GetProxyCircuitBreaker(proxy);
+    if (!breaker) return true;
+    const ULONGLONG now = GetTickCount64();
+    Network::CircuitTransition t;
+    const bool allowed = breaker->Allow(now, &t);
+    LogCircuitTransition(proxy, *breaker, t);
+    if (allowed) return true;
+
+    const bool fallbackDirect = Core::Config::Instance().policy.breakerOpenAction == Core::BreakerOpenAction::Direct;
+    if (outFallbackDirect) *outFallbackDirect = fallbackDirect;
+    if (AGP_LOG_ENABLED_LIMITED(Route, Warn)) {
+        AGP_LOG_WARN(Route, "[熔断] 上游 " + ProxyUpstreamKey(proxy) + " 不可用, " +
+                            (fallbackDirect ? "回退直连" : "快速失败") +
+                            ", 目标=" + target +
+                            ", 剩余冷却=" + std::to_string(breaker->RemainingCooldownMs(now)) + "ms");
+    }
+    WSASetLastError(WSAECONNREFUSED);
+    return false;
+}
 
-    sockaddr_storage proxyAddrSs{};
-    int proxyAddrLen = 0;
-    if (family == AF_INET6) {
-        sockaddr_in6 proxyAddr6{};
-        if (!BuildProxyAddrV6(proxy, &proxyAddr6, nullptr)) {
-            if (fpCloseSocket) fpCloseSocket(tcpSock);
-            return INVALID_SOCKET;
-        }
-        memcpy(&proxyAddrSs, &proxyAddr6, sizeof(proxyAddr6));
-        proxyAddrLen = (int)sizeof(proxyAddr6);
+// 上报连接代理/握手结果（仅统计与上游可用性相关的失败）
+static void ReportProxyUpstreamResult(const Core::ProxyConfig& proxy, bool ok) {
+    auto breaker = GetProxyCircuitBreaker(proxy);
+    if (!breaker) return;
+    const int savedErr = WSAGetLastError(); // 日志路径不应覆盖调用方的错误码
+    Network::CircuitTransition t;
+    if (ok) {
+        breaker->RecordSuccess(GetTickCount64(), &t);
     } else {
-        sockaddr_in proxyAddr{};
-        if (!BuildProxyAddr(proxy, &proxyAddr, nullptr)) {
-            if (fpCloseSocket) fpCloseSocket(tcpSock);
-            return INVALID_SOCKET;
-        }
-        memcpy(&proxyAddrSs, &proxyAddr, sizeof(proxyAddr));
-        proxyAddrLen = (int)sizeof(proxyAddr);
+        breaker->RecordFailure(GetTickCount64(), &t);
     }
+    LogCircuitTransition(proxy, *breaker, t);
+    WSASetLastError(savedErr);
+}
 
-    int rc = fpConnect ? fpConnect(tcpSock, (sockaddr*)&proxyAddrSs, proxyAddrLen)
-                       : connect(tcpSock, (sockaddr*)&proxyAddrSs, proxyAddrLen);
-    if (rc != 0) {
+// 连接代理失败（TCP 层）的统一出口：轮换代理地址、计入熔断、结束连接追踪；保留调用方的错误码
+static void ReportProxyConnectFailure(SOCKET s, const Core::ProxyConfig& proxy, int socketFamily) {
+    const int savedErr = WSAGetLastError();
+    NoteProxyEndpointFailed(socketFamily);
+    ReportProxyUpstreamResult(proxy, false);
+    Core::ConnTrace::Instance().Finish((uint64_t)s, true);
+    WSASetLastError(savedErr);
+}
+
+// ============= 上游往返时间与自适应超时 =============
+// 设计意图：连接代理（WaitConnect）与握手预算按该上游的实测耗时收紧，路径失效时数百毫秒内即可失败并交给熔断/重试；
+// 配置的固定超时作为上限，样本不足或连续超时退避后回到固定值。
+static std::shared_ptr<Network::UpstreamRtt> GetProxyRtt(const Core::ProxyConfig& proxy) {
+    const auto& cfg = Core::Config::Instance().timeout;
+    if (!cfg.adaptive) return nullptr;
+    Network::AdaptiveTimeoutOptions options;
+    options.minMs = (uint32_t)cfg.adaptive_min_ms;
+    return Network::UpstreamRttRegistry::Instance().Get(ProxyUpstreamKey(proxy), options);
+}
+
+static int AdaptiveTimeoutMs(const Network::RttEstimator* estimator, int maxMs) {
+    return estimator ? (int)estimator->TimeoutMs((uint32_t)maxMs) : maxMs;
+}
+
+// 上报一次尝试的结果：成功时计入样本；失败且用时已达到（小于固定上限的）自适应超时则退避
+static void ReportAdaptiveAttempt(const Core::ProxyConfig& proxy, Network::RttEstimator* estimator, const char* phase,
+                                  uint64_t elapsedUs, int timeoutMs, int maxMs, bool ok) {
+    if (!estimator) return;
+    if (ok) {
+        estimator->AddSample(elapsedUs);
+        return;
+    }
+    // 提前失败（拒绝/重置）不是超时，不影响估计
+    if (timeoutMs >= maxMs || elapsedUs + 10000 < (uint64_t)timeoutMs * 1000) return;
+    estimator->OnTimeout();
+    if (AGP_LOG_ENABLED_LIMITED(Route, Warn)) {
+        const auto st = estimator->GetStats();
+        AGP_LOG_WARN(Route, std::string("[自适应超时] 上游 ") + ProxyUpstreamKey(proxy) + " " + phase +
+                            " 超时=" + std::to_string(timeoutMs) + "ms (上限 " + std::to_string(maxMs) + "ms)" +
+                            ", SRTT=" + std::to_string(st.srttUs / 1000) + "ms" +
+                            ", RTTVAR=" + std::to_string(st.rttvarUs / 1000) + "ms" +
+                            ", 下次=" + std::to_string(estimator->TimeoutMs((uint32_t)maxMs)) + "ms");
+    }
+}
+
+static void ReportAdaptiveAttempt(const Core::ProxyConfig& proxy, Network::RttEstimator* estimator, const char* phase,
+                                  const std::chrono::steady_clock::time_point& start, int timeoutMs, int maxMs, bool ok) {
+    const auto us = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count();
+    ReportAdaptiveAttempt(proxy, estimator, phase, us > 0 ? (uint64_t)us : 0, timeoutMs, maxMs, ok);
+}
+
+static SOCKET ConnectTcpToProxyServer(const Core::ProxyConfig& proxy) {
+    // 说明：UDP Associate 需要一个到代理的 TCP 控制连接
+    // 控制连接由本模块自行创建，可直接在全部候选地址上竞速（Happy Eyeballs），胜出 socket 即为控制连接
+    if (!AllowProxyUpstream(proxy, "(UDP 控制连接)", nullptr)) {
+        return INVALID_SOCKET;
+    }
+    std::vector<Network::HappyEyeballs::Candidate> candidates;
+    if (!ResolveProxyCandidates(proxy, &candidates)) {
+        ReportProxyUpstreamResult(proxy, false);
+        WSASetLastError(WSAEHOSTUNREACH);
+        return INVALID_SOCKET;
+    }
+
+    // 非阻塞 connect + 竞速等待，避免卡死目标进程
+    SOCKET tcpSock = RaceProxyCandidates(proxy, AF_UNSPEC, candidates, nullptr);
+    if (tcpSock == INVALID_SOCKET) {
         int err = WSAGetLastError();
-        if (err == WSAEWOULDBLOCK || err == WSAEINPROGRESS) {
-            auto& config = Core::Config::Instance();
-            if (!Network::SocketIo::WaitConnect(tcpSock, config.timeout.connect_ms)) {
-                int werr = WSAGetLastError();
-                Core::Logger::Error("SOCKS5 UDP: 连接代理服务器失败, proxy=" + proxy.host + ":" + std::to_string(proxy.port) +
-                                    ", WSA错误码=" + std::to_string(werr));
-                if (fpCloseSocket) fpCloseSocket(tcpSock);
-                return INVALID_SOCKET;
-            }
-        } else {
-            Core::Logger::Error("SOCKS5 UDP: 连接代理服务器失败, proxy=" + proxy.host + ":" + std::to_string(proxy.port) +
-                                ", WSA错误码=" + std::to_string(err));
-            if (fpCloseSocket) fpCloseSocket(tcpSock);
-            return INVALID_SOCKET;
-        }
+        AGP_LOG_ERROR(Udp, "SOCKS5 UDP: 连接代理服务器失败, proxy=" + proxy.host + ":" + std::to_string(proxy.port) +
+                           ", WSA错误码=" + std::to_string(err));
+        NoteProxyEndpointFailed(AF_UNSPEC);
+        ReportProxyUpstreamResult(proxy, false);
+        WSASetLastError(err);
+        return INVALID_SOCKET;
     }
 
+    // 说明：仅以 TCP 连通性作为上游可用性依据；UDP Associate 被拒多为代理不支持 UDP，不应触发 TCP 熔断
+    ReportProxyUpstreamResult(proxy, true);
+
     // 连接完成后切回阻塞：后续握手使用 SocketIo::SendAll/RecvExact（内部兼容 EWOULDBLOCK）
-    nb = 0;
+    u_long nb = 0;
     ioctlsocket(tcpSock, FIONBIO, &nb);
     return tcpSock;
 }
 
 static void DropUdpOverlappedContext(LPWSAOVERLAPPED ovl) {
-    if (!ovl) return;
-    std::lock_guard<std::mutex> lock(g_udpOvlMtx);
-    g_udpOvlSend.erase(ovl);
-    g_udpOvlRecv.erase(ovl);
+    OverlappedEntry entry{};
+    if (TakeOverlapped(ovl, IsUdpOverlappedEntry, &entry)) FreeOverlappedEntry(&entry);
+}
+
+// 更新 default target 并重新编码 SOCKS5 UDP 头（目标未变化时跳过）；调用方需持有所属 SocketContext::mtx
+static void SetUdpProxyDefaultTargetLocked(UdpProxyContext* ctx, const std::string& host, uint16_t port) {
+    if (ctx->hasDefaultTarget && ctx->defaultTargetPort == port && ctx->defaultTargetHost == host) return;
+    ctx->defaultTargetHost = host;
+    ctx->defaultTargetPort = port;
+    ctx->hasDefaultTarget = true;
+    ctx->defaultHeaderLen = Network::Socks5::EncodeUdpHeader(host, port, ctx->defaultHeader, sizeof(ctx->defaultHeader));
+}
+
+// connected UDP socket 发送快路径：relay 已连接且 default target 已就绪时直接取出预编码的头
+// 返回 false 表示需要走完整的 EnsureUdpProxyReady 流程
+static bool TryGetUdpProxySendHeader(SOCKET s, UdpSendHeader* out) {
+    auto sc = FindSocketContext(s);
+    if (!sc) return false;
+    std::lock_guard<std::mutex> lock(sc->mtx);
+    if (!sc->hasUdpProxy) return false;
+    const UdpProxyContext& ctx = sc->udp;
+    if (!ctx.relayConnected || !ctx.hasDefaultTarget || ctx.defaultHeaderLen == 0) return false;
+    memcpy(out->bytes, ctx.defaultHeader, ctx.defaultHeaderLen);
+    out->len = ctx.defaultHeaderLen;
+    return true;
 }
 
-static void CleanupUdpOverlappedBySocket(SOCKET s) {
-    std::lock_guard<std::mutex> lock(g_udpOvlMtx);
-    for (auto it = g_udpOvlSend.begin(); it != g_udpOvlSend.end(); ) {
-        if (it->second && it->second->sock == s) it = g_udpOvlSend.erase(it);
-        else ++it;
+static void CloseUdpControlSocket(SOCKET control) {
+    if (control == INVALID_SOCKET) return;
+    // 关闭控制连接：使用原始 closesocket，避免递归进入 DetourCloseSocket
+    if (fpCloseSocket) fpCloseSocket(control);
+    else closesocket(control);
+}
+
+// UDP 代理失败回退 direct：仅撤销本 socket 的 UDP 代理状态（保留目标记录），并释放其 UDP overlapped 登记
+static void CleanupUdpProxyContext(SOCKET s) {
+    auto sc = FindSocketContext(s);
+    if (!sc) return;
+    SOCKET control = INVALID_SOCKET;
+    std::vector<LPOVERLAPPED> pending;
+    {
+        std::lock_guard<std::mutex> lock(sc->mtx);
+        if (sc->hasUdpProxy) {
+            control = sc->udp.controlSock;
+            sc->udp = UdpProxyContext{};
+            sc->hasUdpProxy = false;
+            g_socketClass.Set((uintptr_t)s, Network::SocketClass::Udp);
+        }
+        pending = sc->pendingOverlapped;
     }
-    for (auto it = g_udpOvlRecv.begin(); it != g_udpOvlRecv.end(); ) {
-        if (it->second && it->second->sock == s) it = g_udpOvlRecv.erase(it);
-        else ++it;
+    CloseUdpControlSocket(control);
+    for (LPOVERLAPPED ovl : pending) {
+        OverlappedEntry entry{};
+        auto pred = [s](const OverlappedEntry& e) { return e.sock == s && IsUdpOverlappedEntry(e); };
+        if (TakeOverlapped(ovl, pred, &entry)) FreeOverlappedEntry(&entry);
     }
 }
 
-static void CleanupUdpProxyContext(SOCKET s) {
+// closesocket 时统一清理：摘除 socket 记录，关闭 UDP 控制连接，释放尚未完成的 overlapped 登记
+// 说明：其他线程可能仍持有记录引用，记录本身在最后一个引用释放时销毁
+static void TeardownSocketContext(SOCKET s) {
+    g_socketClass.Invalidate((uintptr_t)s);
+    auto sc = g_sockets.Remove(s);
+    if (!sc) return;
     SOCKET control = INVALID_SOCKET;
+    std::vector<LPOVERLAPPED> pending;
     {
-        std::lock_guard<std::mutex> lock(g_udpProxyMtx);
-        auto it = g_udpProxy.find(s);
-        if (it != g_udpProxy.end()) {
-            control = it->second.controlSock;
-            g_udpProxy.erase(it);
+        std::lock_guard<std::mutex> lock(sc->mtx);
+        if (sc->hasUdpProxy) {
+            control = sc->udp.controlSock;
+            sc->udp.controlSock = INVALID_SOCKET;
+            sc->hasUdpProxy = false;
         }
+        sc->hasTarget = false;
+        pending.swap(sc->pendingOverlapped);
+    }
+    CloseUdpControlSocket(control);
+    for (LPOVERLAPPED ovl : pending) {
+        OverlappedEntry entry{};
+        // OVERLAPPED 可能已被同一进程内其他 socket 复用：只摘除仍属于本 socket 的登记
+        if (g_overlapped.EraseWhere(ovl, [s](const OverlappedEntry& e) { return e.sock == s; }, &entry)) {
+            g_overlappedFilter.Remove(ovl);
+            FreeOverlappedEntry(&entry);
+        }
+    }
+}
+
+// 卸载时等待预热池补充线程退出的上限：代理可达时一次建立尝试为数个 RTT；代理不可达时受 connect 超时约束，超过上限只记录告警
+static constexpr int kUdpPoolStopWaitMs = 2000;
+
+// 从预热池领取 UDP Associate 会话；首次调用时启动后台补充线程（不在 DllMain 中创建线程）
+static bool ClaimPooledUdpAssociate(SOCKET* outControl, Network::Socks5Udp::UdpAssociateResult* outAssoc) {
+    auto& config = Core::Config::Instance();
+    if (config.rules.udp_pool_size <= 0) return false;
+    auto& pool = Network::UdpAssociatePool::Instance();
+    static std::once_flag s_startOnce;
+    std::call_once(s_startOnce, [&pool, &config]() {
+        pool.Start((size_t)config.rules.udp_pool_size, (uint64_t)config.rules.udp_pool_max_idle_ms,
+                   [](Network::PooledUdpAssociate* out) -> bool {
+                       auto& cfg = Core::Config::Instance();
+                       SOCKET tcp = ConnectTcpToProxyServer(cfg.proxy);
+                       if (tcp == INVALID_SOCKET) return false;
+                       Network::Socks5Udp::UdpAssociateResult assoc{};
+                       // 卸载中：不再发起 Associate，尽快让后台线程退出
+                       if (Network::UdpAssociatePool::Instance().Stopping() ||
+                           !Network::Socks5Udp::UdpAssociate(tcp, nullptr, 0, &assoc)) {
+                           if (fpCloseSocket) fpCloseSocket(tcp);
+                           else closesocket(tcp);
+                           return false;
+                       }
+                       out->controlSock = tcp;
+                       out->relayAddr = assoc.relayAddr;
+                       out->relayAddrLen = assoc.relayAddrLen;
+                       return true;
+                   },
+                   [](SOCKET s) {
+                       if (fpCloseSocket) fpCloseSocket(s);
+                       else closesocket(s);
+                   });
+        AGP_LOG_INFO(Udp, "UDP Associate 预热池已启动, size=" + std::to_string(config.rules.udp_pool_size) +
+                          ", max_idle=" + std::to_string(config.rules.udp_pool_max_idle_ms) + "ms");
+    });
+
+    Network::PooledUdpAssociate item;
+    if (!pool.TryClaim(&item)) return false;
+    *outControl = item.controlSock;
+    outAssoc->controlSock = item.controlSock;
+    outAssoc->relayAddr = item.relayAddr;
+    outAssoc->relayAddrLen = item.relayAddrLen;
+    if (AGP_LOG_ENABLED(Udp, Debug)) {
+        const auto stats = pool.GetStats();
+        AGP_LOG_DEBUG(Udp, "UDP Associate 预热池: 命中, control=" + std::to_string((unsigned long long)item.controlSock) +
+                           ", 剩余=" + std::to_string(stats.idle) +
+                           ", claimed=" + std::to_string(stats.claimed) +
+                           ", missed=" + std::to_string(stats.missed));
+    }
+    return true;
+}
+
+// 多路复用 UDP 中继（udp_relay_mode=mux）：所有 UDP socket 共享一个 Associate
+static std::shared_ptr<Network::UdpRelayMux> g_udpRelayMux;
+static std::mutex g_udpRelayMuxMtx;
+
+// 获取共享中继的本地端点；中继尚未建立或控制连接已断开时现场（重新）建立
+static bool AcquireUdpRelayMuxEndpoint(sockaddr_storage* outEndpoint, int* outEndpointLen) {
+    std::lock_guard<std::mutex> lock(g_udpRelayMuxMtx);
+    if (g_udpRelayMux && g_udpRelayMux->IsAlive()) {
+        return g_udpRelayMux->GetLocalEndpoint(outEndpoint, outEndpointLen);
     }
-    if (control != INVALID_SOCKET) {
-        // 关闭控制连接：使用原始 closesocket，避免递归进入 DetourCloseSocket
-        if (fpCloseSocket) fpCloseSocket(control);
-        else closesocket(control);
+    if (g_udpRelayMux) {
+        const auto stats = g_udpRelayMux->GetStats();
+        AGP_LOG_WARN(Udp, "UDP 多路复用中继: 控制连接已断开，正在重建, up=" + std::to_string(stats.upPackets) +
+                          ", down=" + std::to_string(stats.downPackets) +
+                          ", unrouted=" + std::to_string(stats.unrouted) +
+                          ", flows=" + std::to_string(stats.flows));
+        g_udpRelayMux.reset();
     }
-    CleanupUdpOverlappedBySocket(s);
+
+    auto& config = Core::Config::Instance();
+    SOCKET tcp = ConnectTcpToProxyServer(config.proxy);
+    if (tcp == INVALID_SOCKET) return false;
+    Network::Socks5Udp::UdpAssociateResult assoc{};
+    if (!Network::Socks5Udp::UdpAssociate(tcp, nullptr, 0, &assoc)) {
+        if (fpCloseSocket) fpCloseSocket(tcp);
+        else closesocket(tcp);
+        return false;
+    }
+
+    // 中继内部收发使用原始函数，避免自身流量进入 UDP 代理 Hook
+    Network::UdpRelaySocketApi api;
+    api.connectFn = fpConnect;
+    api.sendFn = fpSend;
+    api.recvFn = fpRecv;
+    api.sendToFn = fpSendTo;
+    api.recvFromFn = fpRecvFrom;
+    api.closeFn = fpCloseSocket;
+    auto mux = std::make_shared<Network::UdpRelayMux>();
+    if (!mux->Start(tcp, (sockaddr*)&assoc.relayAddr, assoc.relayAddrLen, api)) {
+        const int err = WSAGetLastError();
+        AGP_LOG_ERROR(Udp, "UDP 多路复用中继: 启动失败, WSA错误码=" + std::to_string(err));
+        if (fpCloseSocket) fpCloseSocket(tcp);
+        else closesocket(tcp);
+        return false;
+    }
+    g_udpRelayMux = mux;
+    if (!mux->GetLocalEndpoint(outEndpoint, outEndpointLen)) return false;
+    AGP_LOG_INFO(Udp, "UDP 多路复用中继已启动, control=" + std::to_string((unsigned long long)tcp) +
+                      ", relay=" + SockaddrToString((sockaddr*)&assoc.relayAddr) +
+                      ", local=" + SockaddrToString((sockaddr*)outEndpoint));
+    return true;
 }
 
 static bool EnsureUdpProxyReady(
@@ -909,53 +1674,69 @@ static bool EnsureUdpProxyReady(
         return false;
     }
 
-    if (config.proxy.port == 0) {
+    if (!config.policy.proxyEnabled) {
         WSASetLastError(WSAEINVAL);
         return false;
     }
 
     // UDP 代理仅支持 SOCKS5（HTTP 代理没有标准的 UDP 转发能力）
-    if (config.proxy.type != "socks5") {
-        if (ShouldLogUdpProxyFail()) {
-            Core::Logger::Warn("UDP 代理仅支持 SOCKS5 (UDP Associate)。当前 proxy.type=" + config.proxy.type +
-                               "；若需 QUIC/HTTP3 请改用 socks5。将按 udp_fallback=" + config.rules.udp_fallback + " 处理。");
+    if (config.policy.proxyType != Core::ProxyType::Socks5) {
+        if (AGP_LOG_ENABLED_LIMITED(Udp, Warn)) {
+            AGP_LOG_WARN(Udp, "UDP 代理仅支持 SOCKS5 (UDP Associate)。当前 proxy.type=" + config.proxy.type +
+                              "；若需 QUIC/HTTP3 请改用 socks5。将按 udp_fallback=" + config.rules.udp_fallback + " 处理。");
         }
         WSASetLastError(WSAEACCES);
         return false;
     }
 
     // 1) 确保存在 UDP Associate 控制连接 + relay 地址
-    // 性能优化：阻塞 I/O（connect/UdpAssociate）放到锁外执行，降低 g_udpProxyMtx 竞争
+    // 性能优化：阻塞 I/O（connect/UdpAssociate）放到锁外执行，不持有 socket 记录锁
+    auto sc = GetOrCreateSocketContext(udpSock);
     bool needCreateContext = false;
     {
-        std::lock_guard<std::mutex> lock(g_udpProxyMtx);
-        auto it = g_udpProxy.find(udpSock);
-        if (it == g_udpProxy.end()) {
+        std::lock_guard<std::mutex> lock(sc->mtx);
+        if (!sc->hasUdpProxy) {
             needCreateContext = true;
         } else if (!defaultTargetHost.empty() && defaultTargetPort != 0) {
-            it->second.defaultTargetHost = defaultTargetHost;
-            it->second.defaultTargetPort = defaultTargetPort;
-            it->second.hasDefaultTarget = true;
+            SetUdpProxyDefaultTargetLocked(&sc->udp, defaultTargetHost, defaultTargetPort);
         }
     }
 
+    bool flowOpened = false;
     if (needCreateContext) {
         UdpProxyContext created{};
         created.udpSock = udpSock;
         created.createdTick = GetTickCount64();
 
-        SOCKET tcp = ConnectTcpToProxyServer(config.proxy);
-        if (tcp == INVALID_SOCKET) {
-            WSASetLastError(WSAECONNREFUSED);
-            return false;
-        }
-
+        // mux 模式：连接共享中继的本地端点，不持有独立控制连接（controlSock 保持 INVALID_SOCKET）
+        // per_socket 模式：优先领取预热会话；池为空时回退为现场建立
+        SOCKET tcp = INVALID_SOCKET;
         Network::Socks5Udp::UdpAssociateResult assoc{};
-        if (!Network::Socks5Udp::UdpAssociate(tcp, nullptr, 0, &assoc)) {
-            if (fpCloseSocket) fpCloseSocket(tcp);
-            else closesocket(tcp);
-            WSASetLastError(WSAECONNREFUSED);
-            return false;
+        size_t assocSource = 0; // 指标：0=共享中继, 1=预热池, 2=现场建立
+        if (config.policy.udpRelay == Core::UdpRelayMode::Mux) {
+            if (!AcquireUdpRelayMuxEndpoint(&assoc.relayAddr, &assoc.relayAddrLen)) {
+                g_metrics.udpAssociateFailures.Add();
+                WSASetLastError(WSAECONNREFUSED);
+                return false;
+            }
+        } else if (ClaimPooledUdpAssociate(&tcp, &assoc)) {
+            assocSource = 1;
+        } else {
+            assocSource = 2;
+            tcp = ConnectTcpToProxyServer(config.proxy);
+            if (tcp == INVALID_SOCKET) {
+                g_metrics.udpAssociateFailures.Add();
+                WSASetLastError(WSAECONNREFUSED);
+                return false;
+            }
+
+            if (!Network::Socks5Udp::UdpAssociate(tcp, nullptr, 0, &assoc)) {
+                if (fpCloseSocket) fpCloseSocket(tcp);
+                else closesocket(tcp);
+                g_metrics.udpAssociateFailures.Add();
+                WSASetLastError(WSAECONNREFUSED);
+                return false;
+            }
         }
 
         created.controlSock = tcp;
@@ -963,31 +1744,30 @@ static bool EnsureUdpProxyReady(
         created.relayAddrLen = assoc.relayAddrLen;
         created.relayConnected = false;
         if (!defaultTargetHost.empty() && defaultTargetPort != 0) {
-            created.defaultTargetHost = defaultTargetHost;
-            created.defaultTargetPort = defaultTargetPort;
-            created.hasDefaultTarget = true;
+            SetUdpProxyDefaultTargetLocked(&created, defaultTargetHost, defaultTargetPort);
         }
 
         SOCKET orphanControl = INVALID_SOCKET;
         {
-            std::lock_guard<std::mutex> lock(g_udpProxyMtx);
-            auto it = g_udpProxy.find(udpSock);
-            if (it == g_udpProxy.end()) {
-                g_udpProxy[udpSock] = std::move(created);
+            std::lock_guard<std::mutex> lock(sc->mtx);
+            if (!sc->hasUdpProxy) {
+                sc->udp = std::move(created);
+                sc->hasUdpProxy = true;
+                flowOpened = true;
+                g_metrics.udpAssociates[assocSource].Add();
             } else {
                 // 并发场景下若已被其他线程初始化，复用已有上下文并关闭当前临时控制连接
                 orphanControl = created.controlSock;
                 if (!defaultTargetHost.empty() && defaultTargetPort != 0) {
-                    it->second.defaultTargetHost = defaultTargetHost;
-                    it->second.defaultTargetPort = defaultTargetPort;
-                    it->second.hasDefaultTarget = true;
+                    SetUdpProxyDefaultTargetLocked(&sc->udp, defaultTargetHost, defaultTargetPort);
                 }
             }
         }
-        if (orphanControl != INVALID_SOCKET) {
-            if (fpCloseSocket) fpCloseSocket(orphanControl);
-            else closesocket(orphanControl);
-        }
+        CloseUdpControlSocket(orphanControl);
+    }
+    g_socketClass.Set((uintptr_t)udpSock, Network::SocketClass::ProxiedUdp);
+    if (flowOpened) {
+        Network::PacketCapture::Instance().OnFlowOpen(udpSock, IPPROTO_UDP, defaultTargetHost, defaultTargetPort);
     }
 
     // 2) 确保 UDP socket 已 connect 到 relay（让 select/IOCP/readiness 与原 socket 绑定，满足 QUIC 等高性能实现）
@@ -998,19 +1778,18 @@ static bool EnsureUdpProxyReady(
     sockaddr_storage relayForSock{};
     int relayForSockLen = 0;
     {
-        std::lock_guard<std::mutex> lock(g_udpProxyMtx);
-        auto it = g_udpProxy.find(udpSock);
-        if (it == g_udpProxy.end()) {
+        std::lock_guard<std::mutex> lock(sc->mtx);
+        if (!sc->hasUdpProxy) {
             WSASetLastError(WSAECONNREFUSED);
             return false;
         }
-        if (it->second.relayConnected) {
+        if (sc->udp.relayConnected) {
             return true;
         }
-        if (!BuildUdpRelayAddrForSocketFamily(socketFamily, it->second.relayAddr, it->second.relayAddrLen, &relayForSock, &relayForSockLen)) {
-            Core::Logger::Error("UDP 代理: relay 地址族不兼容, sock=" + std::to_string((unsigned long long)udpSock) +
-                                ", socketFamily=" + std::to_string(socketFamily) +
-                                ", relayFamily=" + std::to_string((int)it->second.relayAddr.ss_family));
+        if (!BuildUdpRelayAddrForSocketFamily(socketFamily, sc->udp.relayAddr, sc->udp.relayAddrLen, &relayForSock, &relayForSockLen)) {
+            AGP_LOG_ERROR(Udp, "UDP 代理: relay 地址族不兼容, sock=" + std::to_string((unsigned long long)udpSock) +
+                               ", socketFamily=" + std::to_string(socketFamily) +
+                               ", relayFamily=" + std::to_string((int)sc->udp.relayAddr.ss_family));
             WSASetLastError(WSAEAFNOSUPPORT);
             return false;
         }
@@ -1022,8 +1801,8 @@ static bool EnsureUdpProxyReady(
         const int err = WSAGetLastError();
         // 并发场景下可能已被其它线程先 connect，WSAEISCONN 视为成功
         if (err != WSAEISCONN) {
-            Core::Logger::Error("UDP 代理: connect relay 失败, sock=" + std::to_string((unsigned long long)udpSock) +
-                                ", WSA错误码=" + std::to_string(err));
+            AGP_LOG_ERROR(Udp, "UDP 代理: connect relay 失败, sock=" + std::to_string((unsigned long long)udpSock) +
+                               ", WSA错误码=" + std::to_string(err));
             WSASetLastError(err);
             return false;
         }
@@ -1031,21 +1810,20 @@ static bool EnsureUdpProxyReady(
 
     bool newlyConnected = false;
     {
-        std::lock_guard<std::mutex> lock(g_udpProxyMtx);
-        auto it = g_udpProxy.find(udpSock);
-        if (it == g_udpProxy.end()) {
+        std::lock_guard<std::mutex> lock(sc->mtx);
+        if (!sc->hasUdpProxy) {
             WSASetLastError(WSAECONNREFUSED);
             return false;
         }
-        newlyConnected = !it->second.relayConnected;
-        it->second.relayConnected = true;
+        newlyConnected = !sc->udp.relayConnected;
+        sc->udp.relayConnected = true;
     }
 
     // 仅在首次 connect relay 时输出，避免刷屏
     if (newlyConnected) {
         const std::string relayStr = SockaddrToString((sockaddr*)&relayForSock);
-        Core::Logger::Info("UDP 代理 relay 已连接, sock=" + std::to_string((unsigned long long)udpSock) +
-                           (relayStr.empty() ? "" : (", relay=" + relayStr)));
+        AGP_LOG_INFO(Udp, "UDP 代理 relay 已连接, sock=" + std::to_string((unsigned long long)udpSock) +
+                          (relayStr.empty() ? "" : (", relay=" + relayStr)));
     }
     return true;
 }
@@ -1053,57 +1831,283 @@ static bool EnsureUdpProxyReady(
 static bool TryGetUdpProxyDefaultTarget(SOCKET s, std::string* outHost, uint16_t* outPort) {
     if (outHost) outHost->clear();
     if (outPort) *outPort = 0;
-    std::lock_guard<std::mutex> lock(g_udpProxyMtx);
-    auto it = g_udpProxy.find(s);
-    if (it == g_udpProxy.end()) return false;
-    if (!it->second.hasDefaultTarget) return false;
-    if (outHost) *outHost = it->second.defaultTargetHost;
-    if (outPort) *outPort = it->second.defaultTargetPort;
+    auto sc = FindSocketContext(s);
+    if (!sc) return false;
+    std::lock_guard<std::mutex> lock(sc->mtx);
+    if (!sc->hasUdpProxy || !sc->udp.hasDefaultTarget) return false;
+    if (outHost) *outHost = sc->udp.defaultTargetHost;
+    if (outPort) *outPort = sc->udp.defaultTargetPort;
     return true;
 }
 
+enum class UdpSendPrep {
+    NotProxied, // 该 socket 不在 UDP 代理模式（无 default target），调用方走原始路径
+    Ready,      // 已取得 SOCKS5 UDP 头，可直接聚合发送
+    Failed,     // 建立 relay 失败（WSA 错误码已设置）
+};
+
+// connected UDP socket 的 send/WSASend：取出 default target 的预编码头
+// 快路径只做一次查表 + 头部拷贝；首次发送或 relay 尚未就绪时走完整的 EnsureUdpProxyReady
+static UdpSendPrep PrepareUdpProxySendHeader(SOCKET s, UdpSendHeader* out) {
+    if (TryGetUdpProxySendHeader(s, out)) return UdpSendPrep::Ready;
+
+    std::string host;
+    uint16_t port = 0;
+    if (!TryGetUdpProxyDefaultTarget(s, &host, &port) || host.empty() || port == 0) {
+        return UdpSendPrep::NotProxied;
+    }
+    sockaddr_storage local{};
+    int localLen = (int)sizeof(local);
+    const int family = (getsockname(s, (sockaddr*)&local, &localLen) == 0) ? (int)local.ss_family : AF_INET;
+    if (!EnsureUdpProxyReady(s, family, host, port, true)) {
+        return UdpSendPrep::Failed;
+    }
+    if (TryGetUdpProxySendHeader(s, out)) return UdpSendPrep::Ready;
+    if (!EncodeUdpSendHeader(host, port, out)) {
+        WSASetLastError(WSAECONNREFUSED);
+        return UdpSendPrep::Failed;
+    }
+    return UdpSendPrep::Ready;
+}
+
+// 同步 WSASend/WSASendTo：头部 + 用户 WSABUF 聚合发送；缓冲数不多时描述符数组放在栈上
+static int SendUdpGatherSync(SOCKET s, const UdpSendHeader& header, LPWSABUF userBufs, DWORD userCount,
+                             LPDWORD lpNumberOfBytesSent, DWORD dwFlags, DWORD userBytes) {
+    WSABUF stackBufs[8];
+    std::vector<WSABUF> heapBufs;
+    WSABUF* bufs = stackBufs;
+    const DWORD total = userCount + 1;
+    if (total > (DWORD)(sizeof(stackBufs) / sizeof(stackBufs[0]))) {
+        heapBufs.resize(total);
+        bufs = heapBufs.data();
+    }
+    bufs[0].buf = (CHAR*)header.bytes;
+    bufs[0].len = (ULONG)header.len;
+    for (DWORD i = 0; i < userCount; ++i) {
+        bufs[i + 1] = userBufs[i];
+    }
+    DWORD sent = 0;
+    int rc = fpWSASend ? fpWSASend(s, bufs, total, &sent, dwFlags, NULL, NULL)
+                       : WSASend(s, bufs, total, &sent, dwFlags, NULL, NULL);
+    if (rc == 0 && lpNumberOfBytesSent) {
+        *lpNumberOfBytesSent = userBytes;
+    }
+    return rc;
+}
+
 static void UpdateUdpProxyDefaultTarget(SOCKET s, const std::string& host, uint16_t port) {
     if (s == INVALID_SOCKET || host.empty() || port == 0) return;
-    std::lock_guard<std::mutex> lock(g_udpProxyMtx);
-    auto it = g_udpProxy.find(s);
-    if (it == g_udpProxy.end()) return;
-    it->second.defaultTargetHost = host;
-    it->second.defaultTargetPort = port;
-    it->second.hasDefaultTarget = true;
+    auto sc = FindSocketContext(s);
+    if (!sc) return;
+    std::lock_guard<std::mutex> lock(sc->mtx);
+    if (!sc->hasUdpProxy) return;
+    SetUdpProxyDefaultTargetLocked(&sc->udp, host, port);
 }
 
 static bool TryGetUdpRelayAddr(SOCKET s, sockaddr_storage* out, int* outLen) {
     if (!out || !outLen) return false;
-    std::lock_guard<std::mutex> lock(g_udpProxyMtx);
-    auto it = g_udpProxy.find(s);
-    if (it == g_udpProxy.end()) return false;
-    if (it->second.relayAddrLen <= 0) return false;
-    *out = it->second.relayAddr;
-    *outLen = it->second.relayAddrLen;
+    auto sc = FindSocketContext(s);
+    if (!sc) return false;
+    std::lock_guard<std::mutex> lock(sc->mtx);
+    if (!sc->hasUdpProxy || sc->udp.relayAddrLen <= 0) return false;
+    *out = sc->udp.relayAddr;
+    *outLen = sc->udp.relayAddrLen;
     return true;
 }
 
 static void MarkUdpRelayConnected(SOCKET s) {
-    std::lock_guard<std::mutex> lock(g_udpProxyMtx);
-    auto it = g_udpProxy.find(s);
-    if (it == g_udpProxy.end()) return;
-    it->second.relayConnected = true;
+    auto sc = FindSocketContext(s);
+    if (!sc) return;
+    std::lock_guard<std::mutex> lock(sc->mtx);
+    if (!sc->hasUdpProxy) return;
+    sc->udp.relayConnected = true;
+}
+
+// 接收侧需要的 SOCKS5 UDP 信息：仅在 relay 已就绪时返回 true，并给出回包头长度预测
+static bool TryGetUdpRecvHeaderHint(SOCKET s, size_t* outHint) {
+    auto sc = FindSocketContext(s);
+    if (!sc) return false;
+    std::lock_guard<std::mutex> lock(sc->mtx);
+    if (!sc->hasUdpProxy || sc->udp.relayAddrLen <= 0) return false;
+    if (outHint) {
+        *outHint = Network::UdpRecvInPlace::PredictHeaderLen(sc->udp.defaultHeader, sc->udp.defaultHeaderLen);
+    }
+    return true;
+}
+
+// 构造就地接收布局；用户缓冲区为空或过多时返回 false（调用方退回整包复制）
+static bool BuildUdpInPlaceLayout(UdpInPlaceLayout* layout, LPWSABUF userBufs, DWORD userCount, size_t headerHint) {
+    if (!layout || !userBufs || userCount == 0 || userCount > Network::UdpRecvInPlace::kMaxUserSegments) return false;
+    if (headerHint == 0 || headerHint > sizeof(layout->scratch)) headerHint = Network::UdpRecvInPlace::kDefaultHeaderHint;
+    DWORD n = 0;
+    layout->bufs[n].buf = (CHAR*)layout->scratch;
+    layout->bufs[n].len = (ULONG)headerHint;
+    ++n;
+    for (DWORD i = 0; i < userCount; ++i) {
+        layout->bufs[n] = userBufs[i];
+        ++n;
+    }
+    layout->bufs[n].buf = (CHAR*)layout->tail;
+    layout->bufs[n].len = (ULONG)sizeof(layout->tail);
+    ++n;
+    for (DWORD i = 0; i < n; ++i) {
+        layout->segs[i].data = (uint8_t*)layout->bufs[i].buf;
+        layout->segs[i].len = (size_t)layout->bufs[i].len;
+    }
+    layout->count = n;
+    return true;
+}
+
+enum class UdpRecvPath { InPlace, Shifted, Copied };
+
+static void LogUdpRecvCounters(const char* reason) {
+    auto& c = g_udpRecvCounters;
+    const uint64_t datagrams = c.datagrams.load(std::memory_order_relaxed);
+    if (datagrams == 0) return;
+    const auto pool = UdpRecvCtxPool().GetStats();
+    std::ostringstream perDatagram;
+    perDatagram << std::fixed << std::setprecision(3)
+                << "分配/报文=" << (double)c.allocs.load(std::memory_order_relaxed) / (double)datagrams
+                << ", 复制字节/报文=" << (double)c.copyBytes.load(std::memory_order_relaxed) / (double)datagrams;
+    AGP_LOG_INFO(Udp, std::string("UDP 接收统计(") + reason + "): 数据报=" + std::to_string(datagrams) +
+                      ", 零复制=" + std::to_string(c.inPlace.load(std::memory_order_relaxed)) +
+                      ", 平移=" + std::to_string(c.shifted.load(std::memory_order_relaxed)) +
+                      ", 整包复制=" + std::to_string(c.copied.load(std::memory_order_relaxed)) +
+                      ", " + perDatagram.str() +
+                      ", 上下文池借出=" + std::to_string(pool.inUse) +
+                      ", 池耗尽回退=" + std::to_string(pool.heapFallbacks));
+}
+
+static void RecordUdpRecv(UdpRecvPath path, size_t copyBytes, uint32_t allocs) {
+    auto& c = g_udpRecvCounters;
+    if (path == UdpRecvPath::InPlace) c.inPlace.fetch_add(1, std::memory_order_relaxed);
+    else if (path == UdpRecvPath::Shifted) c.shifted.fetch_add(1, std::memory_order_relaxed);
+    else c.copied.fetch_add(1, std::memory_order_relaxed);
+    if (copyBytes) c.copyBytes.fetch_add(copyBytes, std::memory_order_relaxed);
+    if (allocs) c.allocs.fetch_add(allocs, std::memory_order_relaxed);
+    const uint64_t n = c.datagrams.fetch_add(1, std::memory_order_relaxed) + 1;
+    if ((n & 0xFFFF) == 0 && AGP_LOG_ENABLED(Udp, Debug)) {
+        LogUdpRecvCounters("周期");
+    }
+}
+
+// 就地接收完成：修正 payload 位置并解析源地址；非 SOCKS5 UDP 回包返回 false
+// baseAllocs 为投递阶段已产生的堆分配次数，一并计入统计
+static bool FinishUdpInPlaceRecv(UdpInPlaceLayout* layout, size_t received, std::vector<uint8_t>* fixup,
+                                 uint32_t baseAllocs, Network::UdpRecvInPlace::Result* out) {
+    const size_t capBefore = fixup ? fixup->capacity() : 0;
+    if (!Network::UdpRecvInPlace::Finalize(layout->segs, layout->count, received, fixup, out)) return false;
+    uint32_t allocs = baseAllocs;
+    if (out->copiedBytes > 0 && (!fixup || fixup->capacity() > capBefore)) ++allocs;
+    RecordUdpRecv(out->copiedBytes == 0 ? UdpRecvPath::InPlace : UdpRecvPath::Shifted, out->copiedBytes, allocs);
+    return true;
+}
+
+struct UdpRecvCtxReleaser {
+    void operator()(UdpOverlappedRecvCtx* ctx) const { UdpRecvCtxPool().Release(ctx); }
+};
+
+// 从池中取出接收上下文并重置；记录来源是否为堆分配
+static UdpOverlappedRecvCtx* AcquireUdpRecvCtx() {
+    auto& pool = UdpRecvCtxPool();
+    UdpOverlappedRecvCtx* ctx = pool.Acquire();
+    ctx->Reset();
+    if (!pool.Owns(ctx)) ctx->postAllocs = 1;
+    return ctx;
+}
+
+// 为接收选择投递缓冲：优先就地接收，否则使用上下文内复用的整包缓冲
+// 注意：ctx 的用户缓冲字段需已填写；copyBuf 仅在整包复制时使用，需在投递调用返回前保持有效
+static void PrepareUdpRecvBuffers(UdpOverlappedRecvCtx* ctx, size_t headerHint, size_t copyCap,
+                                            WSABUF* copyBuf, LPWSABUF* outBufs, DWORD* outCount) {
+    if (BuildUdpInPlaceLayout(&ctx->layout, ctx->userBufs, ctx->userBufCount, headerHint)) {
+        ctx->inPlace = true;
+        *outBufs = ctx->layout.bufs;
+        *outCount = ctx->layout.count;
+        return;
+    }
+    if (ctx->recvBuf.capacity() < copyCap) ctx->postAllocs += 1;
+    ctx->recvBuf.resize(copyCap);
+    copyBuf->buf = (CHAR*)ctx->recvBuf.data();
+    copyBuf->len = (ULONG)ctx->recvBuf.size();
+    *outBufs = copyBuf;
+    *outCount = 1;
+}
+
+struct UdpSyncRecvResult {
+    bool unwrapped = false; // 已解封装（含截断）：delivered/src 有效
+    size_t delivered = 0;
+    sockaddr_storage src{};
+    int srcLen = 0;
+};
+
+// 同步接收 SOCKS5 UDP 回包并解封装到用户缓冲区（recv/recvfrom/WSARecv/WSARecvFrom 共用）
+// 与 overlapped 路径一样借用池中的接收上下文：就地布局、平移暂存区、整包缓冲都复用容量，稳定后每个数据报不再分配
+// 返回 0 成功；截断时返回 SOCKET_ERROR + WSAEMSGSIZE（out 仍有效）；非 SOCKS5 UDP 回包返回 WSAECONNRESET
+static int RecvUdpProxySync(SOCKET s, LPWSABUF userBufs, DWORD userCount, LPDWORD lpFlags, size_t headerHint,
+                            bool withFrom, UdpSyncRecvResult* out) {
+    std::unique_ptr<UdpOverlappedRecvCtx, UdpRecvCtxReleaser> ctx(AcquireUdpRecvCtx());
+    ctx->sock = s;
+    ctx->userBufs = userBufs;
+    ctx->userBufCount = userCount;
+
+    LPWSABUF postBufs = nullptr;
+    DWORD postCount = 0;
+    WSABUF ib{};
+    const size_t cap = SumWsabufBytes(userBufs, userCount) + Network::Socks5Udp::kMaxUdpHeaderBytes;
+    PrepareUdpRecvBuffers(ctx.get(), headerHint, cap, &ib, &postBufs, &postCount);
+
+    DWORD bytes = 0;
+    const int rc = withFrom
+        ? (fpWSARecvFrom ? fpWSARecvFrom : WSARecvFrom)(s, postBufs, postCount, &bytes, lpFlags,
+                                                        (sockaddr*)&ctx->fromTmp, &ctx->fromTmpLen, NULL, NULL)
+        : (fpWSARecv ? fpWSARecv : WSARecv)(s, postBufs, postCount, &bytes, lpFlags, NULL, NULL);
+    if (rc != 0) return rc;
+    out->unwrapped = true;
+    if (bytes == 0) return 0;
+
+    size_t payloadLen = 0;
+    if (ctx->inPlace) {
+        Network::UdpRecvInPlace::Result r{};
+        if (!FinishUdpInPlaceRecv(&ctx->layout, (size_t)bytes, &ctx->fixup, ctx->postAllocs, &r)) {
+            out->unwrapped = false;
+            WSASetLastError(WSAECONNRESET);
+            return SOCKET_ERROR;
+        }
+        out->delivered = r.delivered;
+        out->src = r.src;
+        out->srcLen = r.srcLen;
+        payloadLen = r.payloadLen;
+    } else {
+        Network::Socks5Udp::UnwrapResult unwrap{};
+        if (!Network::Socks5Udp::Unwrap(ctx->recvBuf.data(), (size_t)bytes, &unwrap)) {
+            out->unwrapped = false;
+            WSASetLastError(WSAECONNRESET);
+            return SOCKET_ERROR;
+        }
+        out->delivered = CopyBytesToWsabufs(unwrap.payload, unwrap.payloadLen, userBufs, userCount);
+        out->src = unwrap.src;
+        out->srcLen = unwrap.srcLen;
+        payloadLen = unwrap.payloadLen;
+        RecordUdpRecv(UdpRecvPath::Copied, out->delivered, ctx->postAllocs);
+    }
+    if (out->delivered < payloadLen) {
+        WSASetLastError(WSAEMSGSIZE);
+        return SOCKET_ERROR;
+    }
+    return 0;
 }
 
 static bool HandleUdpOverlappedCompletion(LPWSAOVERLAPPED ovl, DWORD internalBytes, DWORD* outUserBytes) {
     if (!ovl) return false;
 
+    OverlappedEntry entry{};
+    if (!TakeOverlapped(ovl, IsUdpOverlappedEntry, &entry)) return false;
+
     // 1) 发送：仅需要把 bytesTransferred 修正为 payload 长度
-    std::shared_ptr<UdpOverlappedSendCtx> sendCtx;
-    {
-        std::lock_guard<std::mutex> lock(g_udpOvlMtx);
-        auto it = g_udpOvlSend.find(ovl);
-        if (it != g_udpOvlSend.end()) {
-            sendCtx = it->second;
-            g_udpOvlSend.erase(it);
-        }
-    }
-    if (sendCtx) {
+    if (entry.kind == OverlappedKind::UdpSend) {
+        std::unique_ptr<UdpOverlappedSendCtx> sendCtx(entry.send);
+        if (!sendCtx) return false;
         const DWORD userBytes = sendCtx->userBytes;
         if (sendCtx->userBytesPtr) {
             *sendCtx->userBytesPtr = userBytes;
@@ -1113,58 +2117,69 @@ static bool HandleUdpOverlappedCompletion(LPWSAOVERLAPPED ovl, DWORD internalByt
     }
 
     // 2) 接收：需要解封装并回填用户 buffers / from
-    std::shared_ptr<UdpOverlappedRecvCtx> recvCtx;
-    {
-        std::lock_guard<std::mutex> lock(g_udpOvlMtx);
-        auto it = g_udpOvlRecv.find(ovl);
-        if (it != g_udpOvlRecv.end()) {
-            recvCtx = it->second;
-            g_udpOvlRecv.erase(it);
-        }
-    }
+    std::unique_ptr<UdpOverlappedRecvCtx, UdpRecvCtxReleaser> recvCtx(entry.recv);
     if (!recvCtx) return false;
 
-    if (internalBytes == 0 || recvCtx->recvBuf.empty()) {
+    auto finishEmpty = [&]() {
         if (recvCtx->userBytesPtr) *recvCtx->userBytesPtr = 0;
         if (outUserBytes) *outUserBytes = 0;
         return true;
-    }
+    };
+    auto logUnwrapFail = [&](size_t n) {
+        // 解封装失败：清空返回，避免上层解析到“代理协议头”
+        if (AGP_LOG_ENABLED_LIMITED(Udp, Warn)) {
+            AGP_LOG_WARN(Udp, "UDP 解封装失败, sock=" + std::to_string((unsigned long long)recvCtx->sock) +
+                              ", bytes=" + std::to_string((unsigned long long)n) +
+                              " (可能原因: 代理不支持 UDP Associate / 收到非 SOCKS5 UDP 包 / 中间链路异常)");
+        }
+    };
 
-    const size_t n = (size_t)internalBytes;
-    if (n > recvCtx->recvBuf.size()) {
-        if (recvCtx->userBytesPtr) *recvCtx->userBytesPtr = 0;
-        if (outUserBytes) *outUserBytes = 0;
-        return true;
+    if (internalBytes == 0 || (!recvCtx->inPlace && recvCtx->recvBuf.empty())) {
+        return finishEmpty();
     }
 
-    Network::Socks5Udp::UnwrapResult unwrap{};
-    if (!Network::Socks5Udp::Unwrap(recvCtx->recvBuf.data(), n, &unwrap)) {
-        // 解封装失败：清空返回，避免上层解析到“代理协议头”
-        if (ShouldLogUdpProxyFail()) {
-            Core::Logger::Warn("UDP 解封装失败, sock=" + std::to_string((unsigned long long)recvCtx->sock) +
-                               ", bytes=" + std::to_string((unsigned long long)n) +
-                               " (可能原因: 代理不支持 UDP Associate / 收到非 SOCKS5 UDP 包 / 中间链路异常)");
+    const size_t n = (size_t)internalBytes;
+    size_t delivered = 0;
+    sockaddr_storage src{};
+    int srcLen = 0;
+    if (recvCtx->inPlace) {
+        // 就地接收：payload 已在用户缓冲区（预测失败时在此平移）
+        Network::UdpRecvInPlace::Result r{};
+        if (!FinishUdpInPlaceRecv(&recvCtx->layout, n, &recvCtx->fixup, recvCtx->postAllocs, &r)) {
+            logUnwrapFail(n);
+            return finishEmpty();
+        }
+        delivered = r.delivered;
+        src = r.src;
+        srcLen = r.srcLen;
+    } else {
+        if (n > recvCtx->recvBuf.size()) {
+            return finishEmpty();
         }
-        if (recvCtx->userBytesPtr) *recvCtx->userBytesPtr = 0;
-        if (outUserBytes) *outUserBytes = 0;
-        return true;
+        Network::Socks5Udp::UnwrapResult unwrap{};
+        if (!Network::Socks5Udp::Unwrap(recvCtx->recvBuf.data(), n, &unwrap)) {
+            logUnwrapFail(n);
+            return finishEmpty();
+        }
+        // 回填 payload -> 用户缓冲区
+        delivered = CopyBytesToWsabufs(unwrap.payload, unwrap.payloadLen, recvCtx->userBufs, recvCtx->userBufCount);
+        src = unwrap.src;
+        srcLen = unwrap.srcLen;
+        RecordUdpRecv(UdpRecvPath::Copied, delivered, recvCtx->postAllocs);
     }
 
-    // 回填 payload -> 用户缓冲区
-    const size_t copied = CopyBytesToWsabufs(unwrap.payload, unwrap.payloadLen, recvCtx->userBufs, recvCtx->userBufCount);
-
     // 回填 from（若能解析出 sockaddr）
     if (recvCtx->userFromLen) {
-        if (unwrap.srcLen > 0) {
-            FillUserSockaddr(recvCtx->userFrom, recvCtx->userFromLen, unwrap.src, unwrap.srcLen);
+        if (srcLen > 0) {
+            FillUserSockaddr(recvCtx->userFrom, recvCtx->userFromLen, src, srcLen);
         } else {
             // domain 无法回填 sockaddr：保守回填 0，避免误导
             *recvCtx->userFromLen = 0;
         }
     }
 
-    if (recvCtx->userBytesPtr) *recvCtx->userBytesPtr = (DWORD)copied;
-    if (outUserBytes) *outUserBytes = (DWORD)copied;
+    if (recvCtx->userBytesPtr) *recvCtx->userBytesPtr = (DWORD)delivered;
+    if (outUserBytes) *outUserBytes = (DWORD)delivered;
     return true;
 }
 
@@ -1180,18 +2195,10 @@ static void CALLBACK UdpProxyCompletionRoutine(
 
     if (lpOverlapped) {
         // 先取出 user callback（因为 HandleUdpOverlappedCompletion 会 erase 上下文）
-        {
-            std::lock_guard<std::mutex> lock(g_udpOvlMtx);
-            auto itS = g_udpOvlSend.find(lpOverlapped);
-            if (itS != g_udpOvlSend.end() && itS->second) {
-                userCb = itS->second->userCompletion;
-            } else {
-                auto itR = g_udpOvlRecv.find(lpOverlapped);
-                if (itR != g_udpOvlRecv.end() && itR->second) {
-                    userCb = itR->second->userCompletion;
-                }
-            }
-        }
+        g_overlapped.Visit(lpOverlapped, [&userCb](const OverlappedEntry& e) {
+            if (e.kind == OverlappedKind::UdpSend && e.send) userCb = e.send->userCompletion;
+            else if (e.kind == OverlappedKind::UdpRecv && e.recv) userCb = e.recv->userCompletion;
+        });
 
         if (dwError == 0) {
             HandleUdpOverlappedCompletion(lpOverlapped, cbTransferred, &userBytes);
@@ -1236,11 +2243,11 @@ static bool ResolveNameToAddrWithFamily(const std::string& node, const std::stri
 }
 
 // 解析目标域名为地址，供 WSAConnectByName 走代理（IPv6 允许时优先 IPv6）
-static bool ResolveNameToAddr(const std::string& node, const std::string& service, const std::string& ipv6Mode,
+static bool ResolveNameToAddr(const std::string& node, const std::string& service, Core::Ipv6Mode ipv6Mode,
                               sockaddr_storage* out, int* outLen) {
     if (!out || !outLen || node.empty()) return false;
     int lastErr = 0;
-    const bool allowIpv6 = (ipv6Mode == "proxy" || ipv6Mode == "direct");
+    const bool allowIpv6 = (ipv6Mode != Core::Ipv6Mode::Block);
     if (allowIpv6) {
         if (ResolveNameToAddrWithFamily(node, service, AF_INET6, out, outLen, &lastErr)) {
             return true;
@@ -1249,7 +2256,7 @@ static bool ResolveNameToAddr(const std::string& node, const std::string& servic
     if (ResolveNameToAddrWithFamily(node, service, AF_INET, out, outLen, &lastErr)) {
         return true;
     }
-    Core::Logger::Error("目标地址解析失败: " + node + ", 错误码=" + std::to_string(lastErr));
+    AGP_LOG_ERROR(FakeIP, "目标地址解析失败: " + node + ", 错误码=" + std::to_string(lastErr));
     return false;
 }
 
@@ -1325,109 +2332,790 @@ static bool TryResolveDirectTargetFromFakeIp(const sockaddr* name, const std::st
     return false;
 }
 
+// default_action=learn：指标端点与选路共用
+static bool IsLearnRoute(const std::string& routeAction) {
+    return routeAction == "learn";
+}
+
+// ============= 回环指标端点 =============
+// 设计意图：Prometheus 文本格式的只读端点，抓取时在指标线程中读取各模块的原子计数/统计快照；
+// Hook 线程只更新 g_metrics 中的分片计数器，不感知端点是否开启或是否正在被抓取。
+// 端点在首次路由决策时启动（不在 DllMain 的 Loader Lock 中创建 socket/线程），只绑定 127.0.0.1。
+static std::shared_ptr<Network::MetricsServer> g_metricsServer;
+static std::mutex g_metricsServerMtx;
+
+static std::string ProxyMetricLabel(const Core::ProxyConfig& proxy) {
+    return proxy.type + "://" + proxy.host + ":" + std::to_string(proxy.port);
+}
+
+static void RecordHandshakeLatency(const Core::ProxyConfig& proxy, const std::chrono::steady_clock::time_point& start, bool ok) {
+    const auto us = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count();
+    Core::LabeledHistograms& series = ok ? g_metrics.handshakeOk : g_metrics.handshakeFail;
+    series.Get(ProxyMetricLabel(proxy)).Observe(us > 0 ? (uint64_t)us : 0);
+}
+
+static std::string CurrentProcessName() {
+    wchar_t path[MAX_PATH] = {0};
+    const DWORD len = GetModuleFileNameW(NULL, path, MAX_PATH);
+    if (len == 0 || len >= MAX_PATH) return "";
+    const wchar_t* base = path;
+    for (const wchar_t* p = path; *p; ++p) {
+        if (*p == L'\\' || *p == L'/') base = p + 1;
+    }
+    return WideToUtf8(base);
+}
+
+static std::string RenderMetrics() {
+    using Labels = Core::PrometheusText::Labels;
+    Core::PrometheusText text;
+
+    static const std::string s_pid = std::to_string((unsigned long)GetCurrentProcessId());
+    static const std::string s_process = CurrentProcessName();
+    text.Family("agp_process_info", "gauge", "被注入进程（恒为 1）");
+    text.Sample("agp_process_info", Labels{{"pid", s_pid}, {"process", s_process}}, (uint64_t)1);
+
+    static const char* const kRouteLabels[(size_t)ConnectRoute::Count][2] = {
+        {"proxy", "proxy"}, {"direct", "rule"}, {"direct", "dns"}, {"direct", "port"},
+        {"direct", "circuit_open"}, {"reject", "circuit_open"}, {"direct", "proxy_disabled"},
+        {"bypass", "loopback"}, {"bypass", "proxy_self"}, {"direct", "address_family"},
+        {"direct", "learned"},
+    };
+    text.Family("agp_connects_total", "counter", "按路由去向统计的 TCP 连接（connect/WSAConnect/ConnectEx）");
+    for (size_t i = 0; i < (size_t)ConnectRoute::Count; ++i) {
+        text.Sample("agp_connects_total", Labels{{"action", kRouteLabels[i][0]}, {"reason", kRouteLabels[i][1]}},
+                    g_metrics.connects[i].Value());
+    }
+
+    text.Family("agp_proxy_handshake_seconds", "histogram", "代理握手耗时（SOCKS5/HTTP CONNECT，按上游代理与结果）");
+    for (const auto& kv : g_metrics.handshakeOk.Read()) {
+        text.Histogram("agp_proxy_handshake_seconds", Labels{{"proxy", kv.first}, {"result", "ok"}}, kv.second);
+    }
+    for (const auto& kv : g_metrics.handshakeFail.Read()) {
+        text.Histogram("agp_proxy_handshake_seconds", Labels{{"proxy", kv.first}, {"result", "fail"}}, kv.second);
+    }
+
+    const auto& proxyCfg = Core::Config::Instance().proxy;
+    if (auto rtt = GetProxyRtt(proxyCfg)) {
+        const std::string label = ProxyMetricLabel(proxyCfg);
+        const auto& timeouts = Core::Config::Instance().timeout;
+        const int handshakeMaxMs = timeouts.connect_ms + timeouts.send_ms + timeouts.recv_ms;
+        struct Phase { const char* name; const Network::RttEstimator* est; int maxMs; };
+        const Phase phases[] = {{"connect", &rtt->connect, timeouts.connect_ms}, {"greeting", &rtt->greeting, handshakeMaxMs}};
+        text.Family("agp_proxy_srtt_seconds", "gauge", "上游代理平滑往返时间（按阶段；无样本时为 0）");
+        for (const auto& p : phases) {
+            text.Sample("agp_proxy_srtt_seconds", Labels{{"proxy", label}, {"phase", p.name}}, (double)p.est->GetStats().srttUs / 1e6);
+        }
+        text.Family("agp_proxy_rttvar_seconds", "gauge", "上游代理往返时间偏差（按阶段）");
+        for (const auto& p : phases) {
+            text.Sample("agp_proxy_rttvar_seconds", Labels{{"proxy", label}, {"phase", p.name}}, (double)p.est->GetStats().rttvarUs / 1e6);
+        }
+        text.Family("agp_proxy_timeout_seconds", "gauge", "当前生效的自适应超时（按阶段，以配置的固定超时为上限）");
+        for (const auto& p : phases) {
+            text.Sample("agp_proxy_timeout_seconds", Labels{{"proxy", label}, {"phase", p.name}},
+                        (double)p.est->TimeoutMs((uint32_t)p.maxMs) / 1e3);
+        }
+        text.Family("agp_proxy_adaptive_timeouts_total", "counter", "在自适应超时内失败并触发退避的次数");
+        for (const auto& p : phases) {
+            text.Sample("agp_proxy_adaptive_timeouts_total", Labels{{"proxy", label}, {"phase", p.name}}, p.est->GetStats().timeouts);
+        }
+    }
+
+    if (IsLearnRoute(Core::Config::Instance().rules.routing.default_action)) {
+        const auto prefs = Network::RoutePreferenceTable::Instance().GetStats();
+        text.Family("agp_route_probes_total", "counter", "default_action=learn 发起的直连探测次数");
+        text.Sample("agp_route_probes_total", Labels{}, g_metrics.routeProbes.Value());
+        text.Family("agp_route_preference_entries", "gauge", "域名直连/代理偏好表条目数");
+        text.Sample("agp_route_preference_entries", Labels{}, (uint64_t)prefs.entries);
+        text.Family("agp_route_preference_updates_total", "counter", "偏好表更新（探测结果或直连失效反馈）");
+        text.Sample("agp_route_preference_updates_total", Labels{{"winner", "direct"}}, prefs.directUpdates);
+        text.Sample("agp_route_preference_updates_total", Labels{{"winner", "proxy"}}, prefs.proxyUpdates);
+    }
+
+    const auto fake = Network::FakeIP::Instance().GetStats();
+    text.Family("agp_fakeip_capacity", "gauge", "FakeIP 地址池容量");
+    text.Sample("agp_fakeip_capacity", Labels{}, fake.capacity);
+    text.Family("agp_fakeip_mapped", "gauge", "FakeIP 当前映射条目数（本进程）");
+    text.Sample("agp_fakeip_mapped", Labels{}, fake.mapped);
+    text.Family("agp_fakeip_allocations_total", "counter", "FakeIP 新分配次数");
+    text.Sample("agp_fakeip_allocations_total", Labels{}, fake.allocations);
+    text.Family("agp_fakeip_evictions_total", "counter", "FakeIP 地址池回绕后覆盖旧映射的次数");
+    text.Sample("agp_fakeip_evictions_total", Labels{}, fake.evictions);
+
+    text.Family("agp_cache_lookups_total", "counter", "缓存查询（按缓存与结果）");
+    text.Sample("agp_cache_lookups_total", Labels{{"cache", "socket_class"}, {"result", "hit"}}, g_metrics.socketClassHits.Value());
+    text.Sample("agp_cache_lookups_total", Labels{{"cache", "socket_class"}, {"result", "miss"}}, g_metrics.socketClassMisses.Value());
+    text.Sample("agp_cache_lookups_total", Labels{{"cache", "proxy_endpoint"}, {"result", "hit"}}, g_metrics.proxyEndpointHits.Value());
+    text.Sample("agp_cache_lookups_total", Labels{{"cache", "proxy_endpoint"}, {"result", "miss"}}, g_metrics.proxyEndpointMisses.Value());
+    text.Sample("agp_cache_lookups_total", Labels{{"cache", "fakeip_alloc"}, {"result", "hit"}}, fake.allocHits);
+    text.Sample("agp_cache_lookups_total", Labels{{"cache", "fakeip_alloc"}, {"result", "miss"}}, fake.allocations);
+    text.Sample("agp_cache_lookups_total", Labels{{"cache", "fakeip_lookup"}, {"result", "hit"}}, fake.lookupHits);
+    text.Sample("agp_cache_lookups_total", Labels{{"cache", "fakeip_lookup"}, {"result", "shared_hit"}}, fake.sharedHits);
+    text.Sample("agp_cache_lookups_total", Labels{{"cache", "fakeip_lookup"}, {"result", "miss"}}, fake.lookupMisses);
+
+    text.Family("agp_udp_associates_total", "counter", "UDP socket 就绪代理的次数（按 Associate 来源）");
+    text.Sample("agp_udp_associates_total", Labels{{"source", "mux"}}, g_metrics.udpAssociates[0].Value());
+    text.Sample("agp_udp_associates_total", Labels{{"source", "pool"}}, g_metrics.udpAssociates[1].Value());
+    text.Sample("agp_udp_associates_total", Labels{{"source", "fresh"}}, g_metrics.udpAssociates[2].Value());
+    text.Family("agp_udp_associate_failures_total", "counter", "UDP Associate 建立失败次数");
+    text.Sample("agp_udp_associate_failures_total", Labels{}, g_metrics.udpAssociateFailures.Value());
+    const auto pool = Network::UdpAssociatePool::Instance().GetStats();
+    text.Family("agp_udp_associate_pool_idle", "gauge", "UDP Associate 预热池中可用会话数");
+    text.Sample("agp_udp_associate_pool_idle", Labels{}, (uint64_t)pool.idle);
+    text.Family("agp_udp_associate_pool_events_total", "counter", "UDP Associate 预热池事件");
+    text.Sample("agp_udp_associate_pool_events_total", Labels{{"event", "created"}}, pool.created);
+    text.Sample("agp_udp_associate_pool_events_total", Labels{{"event", "claimed"}}, pool.claimed);
+    text.Sample("agp_udp_associate_pool_events_total", Labels{{"event", "missed"}}, pool.missed);
+    text.Sample("agp_udp_associate_pool_events_total", Labels{{"event", "discarded"}}, pool.discarded);
+
+    // 中继重建期间锁可能被长时间持有（连接代理），抓取不等待，本次跳过中继统计
+    std::shared_ptr<Network::UdpRelayMux> mux;
+    if (g_udpRelayMuxMtx.try_lock()) {
+        mux = g_udpRelayMux;
+        g_udpRelayMuxMtx.unlock();
+    }
+    if (mux) {
+        const auto m = mux->GetStats();
+        text.Family("agp_udp_relay_mux_flows", "gauge", "UDP 多路复用中继当前流数（每个应用 socket 一个上游端口）");
+        text.Sample("agp_udp_relay_mux_flows", Labels{}, m.flows);
+        text.Family("agp_udp_relay_mux_flow_evictions_total", "counter", "UDP 多路复用中继因闲置/流表已满淘汰的流");
+        text.Sample("agp_udp_relay_mux_flow_evictions_total", Labels{}, m.flowEvictions);
+        text.Family("agp_udp_relay_mux_datagrams_total", "counter", "UDP 多路复用中继转发/丢弃的数据报");
+        text.Sample("agp_udp_relay_mux_datagrams_total", Labels{{"event", "up"}}, m.upPackets);
+        text.Sample("agp_udp_relay_mux_datagrams_total", Labels{{"event", "down"}}, m.downPackets);
+        text.Sample("agp_udp_relay_mux_datagrams_total", Labels{{"event", "dropped"}}, m.dropped);
+        text.Sample("agp_udp_relay_mux_datagrams_total", Labels{{"event", "unrouted"}}, m.unrouted);
+    }
+
+    const auto& udpRecv = g_udpRecvCounters;
+    text.Family("agp_udp_recv_datagrams_total", "counter", "经代理接收的 UDP 数据报（按解封装路径）");
+    text.Sample("agp_udp_recv_datagrams_total", Labels{{"path", "in_place"}}, udpRecv.inPlace.load(std::memory_order_relaxed));
+    text.Sample("agp_udp_recv_datagrams_total", Labels{{"path", "shifted"}}, udpRecv.shifted.load(std::memory_order_relaxed));
+    text.Sample("agp_udp_recv_datagrams_total", Labels{{"path", "copied"}}, udpRecv.copied.load(std::memory_order_relaxed));
+
+    text.Family("agp_iocp_completions_total", "counter", "经 Hook 出队的 IOCP 完成事件（按 API）");
+    text.Sample("agp_iocp_completions_total", Labels{{"api", "GetQueuedCompletionStatus"}}, g_metrics.iocpCompletions[0].Value());
+    text.Sample("agp_iocp_completions_total", Labels{{"api", "GetQueuedCompletionStatusEx"}}, g_metrics.iocpCompletions[1].Value());
+    text.Family("agp_iocp_connectex_handshakes_total", "counter", "IOCP 出队时完成代理握手的 ConnectEx");
+    text.Sample("agp_iocp_connectex_handshakes_total", Labels{}, g_metrics.iocpConnectEx.Value());
+
+    const auto drops = Core::Logger::GetDropCounts();
+    text.Family("agp_log_dropped_total", "counter", "异步日志队列写满而丢弃的条数");
+    text.Sample("agp_log_dropped_total", Labels{{"stream", "text"}}, drops.text);
+    text.Sample("agp_log_dropped_total", Labels{{"stream", "binary"}}, drops.binary);
+    text.Sample("agp_log_dropped_total", Labels{{"stream", "traffic"}}, drops.traffic);
+
+    auto& trace = Core::ConnTrace::Instance();
+    if (trace.IsEnabled()) {
+        text.Family("agp_conn_stage_seconds", "summary", "代理 TCP 连接各阶段耗时（dns/proxy_connect/greeting/connect/first_send/first_byte/total）");
+        for (size_t i = 0; i < Core::ConnTrace::kSpans; ++i) {
+            const auto span = (Core::TraceSpan)i;
+            const auto h = trace.ReadSpan(span);
+            std::vector<std::pair<double, double>> quantiles;
+            for (double q : {0.5, 0.9, 0.99, 0.999}) quantiles.emplace_back(q, (double)h.Percentile(q) / 1e6);
+            text.Summary("agp_conn_stage_seconds", Labels{{"stage", Core::TraceSpanName(span)}}, quantiles,
+                         (double)h.sum / 1e6, h.count);
+        }
+        const auto ts = trace.GetStats();
+        text.Family("agp_conn_traces_total", "counter", "连接阶段追踪（按结束方式；dropped 为追踪表满未追踪）");
+        text.Sample("agp_conn_traces_total", Labels{{"result", "completed"}}, ts.completed);
+        text.Sample("agp_conn_traces_total", Labels{{"result", "failed"}}, ts.failed);
+        text.Sample("agp_conn_traces_total", Labels{{"result", "abandoned"}}, ts.abandoned);
+        text.Sample("agp_conn_traces_total", Labels{{"result", "dropped"}}, ts.dropped);
+    }
+    return text.Take();
+}
+
+// ============= 连接阶段耗时追踪 =============
+// 阶段直方图随指标端点输出；采样的完整时间线可从 /trace 获取，卸载时写入 .trace.json 并在日志中输出一行分位数汇总
+static std::string RenderConnTraceJson() {
+    return Core::RenderChromeTrace(Core::ConnTrace::Instance().Samples(), (uint64_t)GetCurrentProcessId());
+}
+
+static void LogConnTraceSummary() {
+    auto& trace = Core::ConnTrace::Instance();
+    const auto stats = trace.GetStats();
+    if (!trace.IsEnabled() || stats.begun == 0) return;
+    std::string line = "连接阶段耗时(ms, p50/p90/p99): 追踪=" + std::to_string(stats.begun) +
+                       ", 首字节=" + std::to_string(stats.completed) + ", 失败=" + std::to_string(stats.failed) +
+                       ", 放弃=" + std::to_string(stats.abandoned) + ", 未追踪=" + std::to_string(stats.dropped);
+    for (size_t i = 0; i < Core::ConnTrace::kSpans; ++i) {
+        const auto h = trace.ReadSpan((Core::TraceSpan)i);
+        if (h.count == 0) continue;
+        char buf[96];
+        snprintf(buf, sizeof(buf), ", %s=%.1f/%.1f/%.1f", Core::TraceSpanName((Core::TraceSpan)i),
+                 h.Percentile(0.5) / 1000.0, h.Percentile(0.9) / 1000.0, h.Percentile(0.99) / 1000.0);
+        line += buf;
+    }
+    Core::Logger::Info(line);
+}
+
+static void ExportConnTraceFile() {
+    auto& trace = Core::ConnTrace::Instance();
+    if (!trace.IsEnabled() || trace.SampleEvery() == 0 || trace.GetStats().sampled == 0) return;
+    const std::string path = Core::Logger::GetProcessOutputPath(".trace.json");
+    HANDLE file = CreateFileA(path.c_str(), GENERIC_WRITE, FILE_SHARE_READ, NULL, CREATE_ALWAYS,
+                              FILE_ATTRIBUTE_NORMAL, NULL);
+    if (file == INVALID_HANDLE_VALUE) {
+        Core::Logger::Warn("连接时间线写入失败: " + path + ", 错误码=" + std::to_string(GetLastError()));
+        return;
+    }
+    const std::string json = RenderConnTraceJson();
+    DWORD written = 0;
+    const bool ok = WriteFile(file, json.data(), (DWORD)json.size(), &written, NULL) && written == json.size();
+    CloseHandle(file);
+    if (!ok) {
+        Core::Logger::Warn("连接时间线写入不完整: " + path);
+        return;
+    }
+    Core::Logger::Info("连接时间线已写入: " + path + "（chrome://tracing 或 Perfetto 打开）");
+}
+
+// 域名偏好持久化：日志目录下的 route-prefs.txt，所有被注入进程共用
+// 写回时先读回文件合并（同一域名以更新时间较新者为准）再整体覆盖，多个进程交替写回不会互相丢失结果
+// 读写都在后台线程进行（见 RoutePreferencePersister），不在 DllMain（Loader Lock）中做文件 I/O
+static std::string RoutePreferencePath() {
+    return Core::Logger::GetSharedOutputPath("route-prefs.txt");
+}
+
+static bool ReadRoutePreferenceFile(std::string* out) {
+    HANDLE file = CreateFileA(RoutePreferencePath().c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE, NULL,
+                              OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (file == INVALID_HANDLE_VALUE) return false;
+    static const DWORD kMaxBytes = 16 * 1024 * 1024;
+    char buf[64 * 1024];
+    DWORD read = 0;
+    while (ReadFile(file, buf, sizeof(buf), &read, NULL) && read > 0 && out->size() < kMaxBytes) {
+        out->append(buf, read);
+    }
+    CloseHandle(file);
+    return true;
+}
+
+static void ConfigureRoutePreferences() {
+    const auto& learn = Core::Config::Instance().rules.routing.learn;
+    Network::RoutePreferenceOptions options;
+    options.halfLifeMs = (uint64_t)learn.half_life_hours * 3600 * 1000;
+    options.maxEntries = (size_t)learn.max_entries;
+    Network::RoutePreferenceTable::Instance().Configure(options);
+}
+
+static void LoadRoutePreferences() {
+    std::string text;
+    if (!ReadRoutePreferenceFile(&text)) return;
+    const size_t adopted = Network::RoutePreferenceTable::Instance().Load(text, Core::SharedStats::WallClockMs());
+    Core::Logger::Info("域名路由偏好已加载: " + std::to_string(adopted) + " 条, " + RoutePreferencePath());
+}
+
+static void SaveRoutePreferences() {
+    auto& table = Network::RoutePreferenceTable::Instance();
+    const uint64_t now = Core::SharedStats::WallClockMs();
+    std::string existing;
+    if (ReadRoutePreferenceFile(&existing)) table.Load(existing, now);
+    const std::string text = table.Serialize(now);
+    const std::string path = RoutePreferencePath();
+    HANDLE file = CreateFileA(path.c_str(), GENERIC_WRITE, FILE_SHARE_READ, NULL, CREATE_ALWAYS,
+                              FILE_ATTRIBUTE_NORMAL, NULL);
+    if (file == INVALID_HANDLE_VALUE) {
+        Core::Logger::Warn("域名路由偏好写入失败: " + path + ", 错误码=" + std::to_string(GetLastError()));
+        return;
+    }
+    DWORD written = 0;
+    const bool ok = WriteFile(file, text.data(), (DWORD)text.size(), &written, NULL) && written == text.size();
+    CloseHandle(file);
+    if (!ok) Core::Logger::Warn("域名路由偏好写入不完整: " + path);
+}
+
+// 偏好表版本：每次 Record 递增，用于判断自上次写回后是否有新结果
+static uint64_t RoutePreferenceVersion() {
+    const auto stats = Network::RoutePreferenceTable::Instance().GetStats();
+    return stats.directUpdates + stats.proxyUpdates;
+}
+
+// 域名偏好后台持久化：启动时读回文件，之后每隔 kSaveIntervalMs 有新结果才合并写回
+// 与 UdpAssociatePool 相同：线程 detach，Stop(waitMs) 最多等待“已退出”通知，返回后线程不再执行文件 I/O；
+// 卸载时不做最后一次写回（Loader Lock 中不做文件 I/O），最多损失一个写回间隔内学到的结果
+class RoutePreferencePersister : public std::enable_shared_from_this<RoutePreferencePersister> {
+public:
+    static constexpr int kSaveIntervalMs = 60000;
+
+    void Start() {
+        auto self = shared_from_this();
+        std::thread([self]() { self->Loop(); }).detach();
+    }
+
+    // 发出停止信号；waitMs>0 时最多等待线程退出，返回线程是否已退出
+    bool Stop(int waitMs) {
+        std::unique_lock<std::mutex> lock(m_mtx);
+        m_stop = true;
+        m_cv.notify_all();
+        if (waitMs > 0) {
+            m_cv.wait_for(lock, std::chrono::milliseconds(waitMs), [this]() { return m_exited; });
+        }
+        return m_exited;
+    }
+
+private:
+    void Loop() {
+        if (!Stopping()) LoadRoutePreferences();
+        uint64_t savedVersion = RoutePreferenceVersion();
+        std::unique_lock<std::mutex> lock(m_mtx);
+        while (!m_stop) {
+            m_cv.wait_for(lock, std::chrono::milliseconds(kSaveIntervalMs), [this]() { return m_stop; });
+            if (m_stop) break;
+            const uint64_t version = RoutePreferenceVersion();
+            if (version == savedVersion) continue;
+            lock.unlock();
+            SaveRoutePreferences();
+            savedVersion = version;
+            lock.lock();
+        }
+        m_exited = true;
+        m_cv.notify_all();
+    }
+
+    bool Stopping() {
+        std::lock_guard<std::mutex> lock(m_mtx);
+        return m_stop;
+    }
+
+    std::mutex m_mtx;
+    std::condition_variable m_cv;
+    bool m_stop = false;
+    bool m_exited = false;
+};
+
+static std::shared_ptr<RoutePreferencePersister> g_routePreferencePersister;
+static std::mutex g_routePreferencePersisterMtx;
+static constexpr int kRoutePreferenceStopWaitMs = 2000;
+
+// 首次按偏好选路时启动（而非在 Install/DllMain 中）
+static void EnsureRoutePreferencePersisterStarted() {
+    static std::once_flag s_once;
+    if (!Core::Config::Instance().rules.routing.learn.persist) return;
+    std::call_once(s_once, []() {
+        auto persister = std::make_shared<RoutePreferencePersister>();
+        std::lock_guard<std::mutex> lock(g_routePreferencePersisterMtx);
+        g_routePreferencePersister = persister;
+        persister->Start();
+    });
+}
+
+static void EnsureMetricsServerStarted() {
+    static std::once_flag s_once;
+    if (!Core::Config::Instance().metrics.enabled) return;
+    std::call_once(s_once, []() {
+        const auto& cfg = Core::Config::Instance().metrics;
+        // 端点自身的收发/关闭使用原始函数，不计入流量统计与抓包
+        Network::MetricsSocketApi api;
+        api.sendFn = fpSend;
+        api.recvFn = fpRecv;
+        api.closeFn = fpCloseSocket;
+        auto server = std::make_shared<Network::MetricsServer>();
+        if (Core::ConnTrace::Instance().SampleEvery() > 0) {
+            server->AddPage("/trace", "application/json; charset=utf-8", &RenderConnTraceJson);
+        }
+        if (!server->Start((uint16_t)cfg.port, cfg.port_range, &RenderMetrics, api)) {
+            AGP_LOG_WARN(General, "指标端点启动失败: 127.0.0.1:" + std::to_string(cfg.port) +
+                                  " 起 " + std::to_string(cfg.port_range) + " 个端口均不可用, WSA错误码=" +
+                                  std::to_string(WSAGetLastError()));
+            return;
+        }
+        AGP_LOG_INFO(General, "指标端点已启动: http://127.0.0.1:" + std::to_string(server->Port()) + "/metrics");
+        std::lock_guard<std::mutex> lock(g_metricsServerMtx);
+        g_metricsServer = server;
+    });
+}
+
+// ============= 共享内存统计段 =============
+// 设计意图：供 agtop 跨进程查看各被注入进程的吞吐与活跃连接。发布线程每 publish_interval_ms 采集一次
+// （与指标端点读取同一批计数），Hook 线程不参与写入；同样在首次路由决策时启动，卸载时释放槽位。
+static std::shared_ptr<Core::SharedStats::Publisher> g_statsPublisher;
+static std::mutex g_statsPublisherMtx;
+
+static void CollectSharedStats(Core::SharedStats::ProcessSample* out) {
+    namespace SS = Core::SharedStats;
+    const auto& traffic = Network::TrafficMonitor::Instance().Counters();
+    const Network::TrafficTotals total = traffic.Total();
+    out->counters[SS::kBytesSent] = total.bytesSent;
+    out->counters[SS::kBytesRecv] = total.bytesRecv;
+
+    const auto connects = [](ConnectRoute r) { return g_metrics.connects[(size_t)r].Value(); };
+    out->counters[SS::kConnectsProxy] = connects(ConnectRoute::Proxy);
+    out->counters[SS::kConnectsDirect] = connects(ConnectRoute::RuleDirect) + connects(ConnectRoute::DnsDirect) +
+                                         connects(ConnectRoute::PortDirect) + connects(ConnectRoute::CircuitDirect) +
+                                         connects(ConnectRoute::ProxyDisabled) + connects(ConnectRoute::FamilyDirect) +
+                                         connects(ConnectRoute::LearnedDirect);
+    out->counters[SS::kConnectsBypass] = connects(ConnectRoute::BypassLoopback) + connects(ConnectRoute::BypassProxySelf);
+    out->counters[SS::kConnectsRejected] = connects(ConnectRoute::CircuitReject);
+    uint64_t handshakeFailures = 0;
+    for (const auto& kv : g_metrics.handshakeFail.Read()) handshakeFailures += kv.second.count;
+    out->counters[SS::kHandshakeFailures] = handshakeFailures;
+    for (const auto& c : g_metrics.udpAssociates) out->counters[SS::kUdpAssociates] += c.Value();
+
+    // 活跃连接表：按累计字节取前 kMaxFlows 个
+    auto sockets = traffic.Sockets();
+    out->activeFlows = sockets.size();
+    const size_t n = std::min(sockets.size(), SS::kMaxFlows);
+    std::partial_sort(sockets.begin(), sockets.begin() + n, sockets.end(), [](const auto& a, const auto& b) {
+        return a.second.bytesSent + a.second.bytesRecv > b.second.bytesSent + b.second.bytesRecv;
+    });
+    const std::string proxyLabel = ProxyMetricLabel(Core::Config::Instance().proxy);
+    const ULONGLONG nowTick = GetTickCount64();
+    out->flows.reserve(n);
+    for (size_t i = 0; i < n; ++i) {
+        SS::FlowSample f;
+        f.socket = (uint64_t)sockets[i].first;
+        f.bytesSent = sockets[i].second.bytesSent;
+        f.bytesRecv = sockets[i].second.bytesRecv;
+        SocketTargetInfo target;
+        if (TryGetSocketTarget((SOCKET)sockets[i].first, &target)) {
+            f.route = target.route;
+            f.host = target.host;
+            f.port = target.port;
+            f.upstream = target.route == SS::FlowRoute::Direct ? std::string("direct") : proxyLabel;
+            f.ageMs = nowTick > target.establishedTick ? nowTick - target.establishedTick : 0;
+        }
+        out->flows.push_back(std::move(f));
+    }
+}
+
+static void EnsureSharedStatsStarted() {
+    static std::once_flag s_once;
+    if (!Core::Config::Instance().metrics.shared_memory) return;
+    std::call_once(s_once, []() {
+        const auto& cfg = Core::Config::Instance().metrics;
+        auto publisher = std::make_shared<Core::SharedStats::Publisher>();
+        if (!publisher->Start(Core::SharedStats::kDefaultSegmentName, GetCurrentProcessId(), CurrentProcessName(),
+                              cfg.publish_interval_ms, &CollectSharedStats)) {
+            AGP_LOG_WARN(General, std::string("共享统计段发布失败: ") + Core::SharedStats::kDefaultSegmentName +
+                                  " 无法映射、版本不一致或 " + std::to_string(Core::SharedStats::kMaxProcesses) +
+                                  " 个槽位已满, 错误码=" + std::to_string(GetLastError()));
+            return;
+        }
+        AGP_LOG_INFO(General, std::string("共享统计段已发布: ") + Core::SharedStats::kDefaultSegmentName +
+                              ", slot=" + std::to_string(publisher->SlotIndex()));
+        std::lock_guard<std::mutex> lock(g_statsPublisherMtx);
+        g_statsPublisher = publisher;
+    });
+}
+
+static void RecordConnectRoute(ConnectRoute route) {
+    g_metrics.connects[(size_t)route].Add();
+    EnsureMetricsServerStarted();
+    EnsureSharedStatsStarted();
+}
+
+// 直连决策：开启共享统计段时同时记录目标，使直连连接也出现在 agtop 的连接表中
+static void RecordDirectRoute(SOCKET s, ConnectRoute route, const std::string& host, uint16_t port) {
+    RecordConnectRoute(route);
+    if (Core::Config::Instance().metrics.shared_memory) {
+        RememberSocketTarget(s, host, port, Core::SharedStats::FlowRoute::Direct);
+    }
+}
+
+// ============= 选路学习（default_action=learn） =============
+
+static Network::RouteChoice DecideLearnedRoute(const std::string& host) {
+    EnsureRoutePreferencePersisterStarted();
+    return Network::RoutePreferenceTable::Instance().Decide(host, Core::SharedStats::WallClockMs());
+}
+
+// 按学习结果直连：总是记录目标，关闭时据收发字节判断直连是否仍然可用
+static void RecordLearnedDirectRoute(SOCKET s, const std::string& host, uint16_t port) {
+    RecordConnectRoute(ConnectRoute::LearnedDirect);
+    RememberSocketTarget(s, host, port, Core::SharedStats::FlowRoute::Direct, true);
+    if (AGP_LOG_ENABLED_LIMITED(Route, Info)) {
+        AGP_LOG_INFO(Route, "[Route] direct (learned), sock=" + std::to_string((unsigned long long)s) +
+                            ", target=" + host + ":" + std::to_string(port));
+    }
+}
+
+// 学习为直连的域名直连失败：分数向代理拉回一半，随后的连接重新探测（或直接走代理）
+static void ReportLearnedDirectFailure(const std::string& host, const std::string& reason) {
+    Network::RoutePreferenceTable::Instance().Record(host, Network::RouteChoice::Proxy, Core::SharedStats::WallClockMs());
+    AGP_LOG_LIMITED_WARN(Route, "[Route] 学习到的直连偏好失效(" + reason + ")，后续连接重新探测, host=" + host);
+}
+
+// 学习为直连的连接关闭：已发送数据却没收到任何数据视为被重置/丢弃（如按 SNI 阻断）
+static void ReportLearnedDirectClose(const SocketTargetInfo& target, const Network::TrafficTotals& totals) {
+    if (!target.learnedDirect || totals.bytesSent == 0 || totals.bytesRecv != 0) return;
+    ReportLearnedDirectFailure(target.host, "已发送 " + std::to_string(totals.bytesSent) + "B 未收到数据");
+}
+
+// 按学习结果直连（connect/WSAConnect）：FakeIP 重解析同 rule direct
+// 返回 false 表示未处理，调用方改走代理：FakeIP 无法重解析，或同步 connect 以可重试的错误失败
+// （connect 文档约定 WSAECONNREFUSED/WSAENETUNREACH/WSAETIMEDOUT 后可在同一 socket 上再次 connect）
+static bool TryLearnedDirectConnect(SOCKET s, const sockaddr* name, int namelen, bool isWsa,
+                                    const std::string& host, uint16_t port, int* outResult) {
+    sockaddr_storage realAddr{};
+    int realLen = 0;
+    bool wasFake = false;
+    const bool resolved = TryResolveDirectTargetFromFakeIp(name, host, port, &realAddr, &realLen, &wasFake);
+    if (!resolved && wasFake) {
+        ReportLearnedDirectFailure(host, "FakeIP 重解析失败");
+        return false;
+    }
+    const sockaddr* target = resolved ? (const sockaddr*)&realAddr : name;
+    const int targetLen = resolved ? realLen : namelen;
+    const int result = isWsa ? fpWSAConnect(s, target, targetLen, NULL, NULL, NULL, NULL) : fpConnect(s, target, targetLen);
+    if (result != 0) {
+        const int err = WSAGetLastError();
+        if (err == WSAECONNREFUSED || err == WSAENETUNREACH || err == WSAETIMEDOUT) {
+            ReportLearnedDirectFailure(host, "WSA错误码=" + std::to_string(err));
+            return false;
+        }
+        WSASetLastError(err);
+    }
+    RecordLearnedDirectRoute(s, host, port);
+    *outResult = result;
+    return true;
+}
+
+// 选路学习探测（default_action=learn）：只为之后的连接学习偏好，不参与本次连接
+// - 在应用 socket 连接代理之前，用内部 socket 向真实目标发起非阻塞直连，之后两条路径同时进行；
+// - 代理连接 + 握手结束时探测已连通记为直连胜，否则代理胜；
+// - 已建立的 TCP 连接无法移交到应用的 socket 句柄，本次连接总是使用代理。
+// 未调用 Settle 的提前返回（代理失败）在析构时结算。
+class DirectRouteProbe {
+public:
+    explicit DirectRouteProbe(const std::string& host) : m_host(host) {}
+    ~DirectRouteProbe() { Settle(false); }
+    DirectRouteProbe(const DirectRouteProbe&) = delete;
+    DirectRouteProbe& operator=(const DirectRouteProbe&) = delete;
+
+    // 发起探测；FakeIP 无法重解析或 connect 立即失败时不探测
+    bool Start(const sockaddr* name, int namelen, uint16_t port) {
+        sockaddr_storage target{};
+        int targetLen = 0;
+        bool wasFake = false;
+        if (!TryResolveDirectTargetFromFakeIp(name, m_host, port, &target, &targetLen, &wasFake)) {
+            if (wasFake || namelen <= 0 || namelen > (int)sizeof(target)) return false;
+            memcpy(&target, name, (size_t)namelen);
+            targetLen = namelen;
+        }
+        // v4-mapped IPv6 改用 IPv4 socket：Windows 的 IPv6 socket 默认 IPV6_V6ONLY，无法连接 v4-mapped 地址
+        if (target.ss_family == AF_INET6 && IN6_IS_ADDR_V4MAPPED(&((sockaddr_in6*)&target)->sin6_addr)) {
+            const sockaddr_in6 mapped = *(const sockaddr_in6*)&target;
+            sockaddr_in v4{};
+            v4.sin_family = AF_INET;
+            v4.sin_port = mapped.sin6_port;
+            memcpy(&v4.sin_addr, reinterpret_cast<const unsigned char*>(&mapped.sin6_addr) + 12, sizeof(v4.sin_addr));
+            memset(&target, 0, sizeof(target));
+            memcpy(&target, &v4, sizeof(v4));
+            targetLen = (int)sizeof(v4);
+        }
+        m_sock = socket(target.ss_family, SOCK_STREAM, IPPROTO_TCP);
+        if (m_sock == INVALID_SOCKET) return false;
+        u_long nonBlocking = 1;
+        if (ioctlsocket(m_sock, FIONBIO, &nonBlocking) != 0) {
+            Close();
+            return false;
+        }
+        // 使用原始 connect：探测不经过路由与统计
+        if (fpConnect(m_sock, (const sockaddr*)&target, targetLen) != 0) {
+            const int err = WSAGetLastError();
+            if (err != WSAEWOULDBLOCK && err != WSAEINPROGRESS) {
+                Close();
+                return false;
+            }
+        }
+        g_metrics.routeProbes.Add();
+        return true;
+    }
+
+    // 代理路径结束时结算；proxyOk=false 时只在直连已连通时记为直连胜
+    void Settle(bool proxyOk) {
+        if (m_sock == INVALID_SOCKET) return;
+        // 提前返回路径上在析构中结算：保留代理路径留给调用方的错误码
+        const int savedErr = WSAGetLastError();
+        const bool directReady = ProbeConnected();
+        Close();
+        if (directReady || proxyOk) {
+            const Network::RouteChoice winner = directReady ? Network::RouteChoice::Direct : Network::RouteChoice::Proxy;
+            Network::RoutePreferenceTable::Instance().Record(m_host, winner, Core::SharedStats::WallClockMs());
+            if (AGP_LOG_ENABLED_LIMITED(Route, Info)) {
+                AGP_LOG_INFO(Route, std::string("[Route] probe winner=") + Network::RouteChoiceName(winner) +
+                                    ", host=" + m_host);
+            }
+        }
+        WSASetLastError(savedErr);
+    }
+
+private:
+    // 不等待：此刻直连是否已建立
+    bool ProbeConnected() const {
+        Network::SocketCompat::PollFd pfd{};
+        pfd.fd = m_sock;
+        pfd.events = POLLOUT;
+        if (Network::SocketCompat::Poll(&pfd, 1, 0) <= 0) return false;
+        int soError = 0;
+        int optLen = sizeof(soError);
+        return getsockopt(m_sock, SOL_SOCKET, SO_ERROR, (char*)&soError, &optLen) == 0 && soError == 0;
+    }
+
+    // 以 RST 中止，不在本机留下 TIME_WAIT
+    void Close() {
+        if (m_sock == INVALID_SOCKET) return;
+        linger abortive{};
+        abortive.l_onoff = 1;
+        abortive.l_linger = 0;
+        setsockopt(m_sock, SOL_SOCKET, SO_LINGER, (const char*)&abortive, sizeof(abortive));
+        if (fpCloseSocket) {
+            fpCloseSocket(m_sock);
+        } else {
+            closesocket(m_sock);
+        }
+        m_sock = INVALID_SOCKET;
+    }
+
+    std::string m_host;
+    SOCKET m_sock = INVALID_SOCKET;
+};
+
 static bool DoProxyHandshake(SOCKET s, const std::string& host, uint16_t port) {
+    const auto handshakeStart = std::chrono::steady_clock::now();
     // FIX-2: 预检确保 socket 已成功连接到代理服务器，避免在未连接的 socket 上发送数据
     sockaddr_storage peerAddr{};
     int peerLen = sizeof(peerAddr);
     if (getpeername(s, (sockaddr*)&peerAddr, &peerLen) != 0) {
         int err = WSAGetLastError();
-        Core::Logger::Error("代理握手: socket 未连接, sock=" + std::to_string((unsigned long long)s) +
-                            ", 目标=" + host + ":" + std::to_string(port) +
-                            ", WSA错误码=" + std::to_string(err));
+        AGP_LOG_ERROR(Route, "代理握手: socket 未连接, sock=" + std::to_string((unsigned long long)s) +
+                             ", 目标=" + host + ":" + std::to_string(port) +
+                             ", WSA错误码=" + std::to_string(err));
+        RecordHandshakeLatency(Core::Config::Instance().proxy, handshakeStart, false);
+        ReportProxyConnectFailure(s, Core::Config::Instance().proxy, AF_UNSPEC);
         WSASetLastError(WSAENOTCONN);
         return false;
     }
+    Core::ConnTrace::Instance().Mark((uint64_t)s, Core::TraceStage::ProxyConnected);
+    NoteProxyEndpointConnected((const sockaddr*)&peerAddr);
 
     auto& config = Core::Config::Instance();
-    // 握手预算采用 connect/send/recv 的总和，避免多阶段各自完整超时导致整体阻塞过长
+    // 握手预算采用 connect/send/recv 的总和，避免多阶段各自完整超时导致整体阻塞过长；
+    // 开启 timeout.adaptive 时只按实测耗时收紧 SOCKS5 认证协商（仅涉及代理本身）。
+    // CONNECT 应答包含代理连接目标的时间，随目标远近变化，始终使用固定预算；HTTP CONNECT 只有这一步，不收紧
     int handshakeBudgetMs = config.timeout.connect_ms + config.timeout.send_ms + config.timeout.recv_ms;
     if (handshakeBudgetMs <= 0) {
         handshakeBudgetMs = 5000;
     }
-    if (Core::Logger::IsEnabled(Core::LogLevel::Debug)) {
-        Core::Logger::Debug("代理握手: 开始, sock=" + std::to_string((unsigned long long)s) +
-                            ", type=" + config.proxy.type +
-                            ", 目标=" + host + ":" + std::to_string(port) +
-                            ", 预算=" + std::to_string(handshakeBudgetMs) + "ms");
-    }
-    if (config.proxy.type == "socks5") {
-        if (!Network::Socks5Client::Handshake(s, host, port, handshakeBudgetMs)) {
-            Core::Logger::Error("SOCKS5 握手失败, sock=" + std::to_string((unsigned long long)s) +
-                                ", 目标=" + host + ":" + std::to_string(port));
-            WSASetLastError(WSAECONNREFUSED);
-            return false;
-        }
-    } else if (config.proxy.type == "http") {
-        if (!Network::HttpConnectClient::Handshake(s, host, port, handshakeBudgetMs)) {
-            Core::Logger::Error("HTTP CONNECT 握手失败, sock=" + std::to_string((unsigned long long)s) +
-                                ", 目标=" + host + ":" + std::to_string(port));
-            WSASetLastError(WSAECONNREFUSED);
-            return false;
-        }
-    } else {
-        Core::Logger::Error("未知代理类型: " + config.proxy.type +
-                            ", sock=" + std::to_string((unsigned long long)s) +
-                            ", 目标=" + host + ":" + std::to_string(port));
+    auto proxyRtt = config.policy.proxyType == Core::ProxyType::Socks5 ? GetProxyRtt(config.proxy) : nullptr;
+    Network::RttEstimator* greetingRtt = proxyRtt ? &proxyRtt->greeting : nullptr;
+    const int greetingBudgetMs = AdaptiveTimeoutMs(greetingRtt, handshakeBudgetMs);
+    Network::HandshakeTiming timing;
+    AGP_LOG_EVENT(HandshakeStart, s, config.proxy.type, Core::LogHost(host), port, handshakeBudgetMs);
+    // proxy.type 已在 Config::Load 中校验为 socks5/http，这里按编译后的枚举分派
+    Network::HandshakeResult result = Network::HandshakeResult::ProxyError;
+    switch (config.policy.proxyType) {
+        case Core::ProxyType::Socks5:
+            result = Network::Socks5Client::Handshake(s, host, port, handshakeBudgetMs, greetingBudgetMs, &timing);
+            break;
+        case Core::ProxyType::Http:
+            result = Network::HttpConnectClient::Handshake(s, host, port, handshakeBudgetMs);
+            break;
+    }
+    if (timing.greetingDone) {
+        ReportAdaptiveAttempt(config.proxy, greetingRtt, "认证协商", timing.greetingUs, greetingBudgetMs, handshakeBudgetMs, true);
+    } else if (result == Network::HandshakeResult::ProxyError) {
+        ReportAdaptiveAttempt(config.proxy, greetingRtt, "认证协商", handshakeStart, greetingBudgetMs, handshakeBudgetMs, false);
+    }
+    if (result != Network::HandshakeResult::Ok) {
+        const bool targetError = result == Network::HandshakeResult::TargetError;
+        AGP_LOG_ERROR(Route, std::string(config.policy.proxyType == Core::ProxyType::Http ? "HTTP CONNECT" : "SOCKS5") +
+                             " 握手失败, sock=" + std::to_string((unsigned long long)s) +
+                             ", 目标=" + host + ":" + std::to_string(port) +
+                             ", 分类=" + Network::HandshakeResultName(result));
+        // 代理已按协议应答目标失败：代理路径可用，不计入熔断
+        ReportProxyUpstreamResult(config.proxy, targetError);
+        RecordHandshakeLatency(config.proxy, handshakeStart, false);
+        Core::ConnTrace::Instance().Finish((uint64_t)s, true);
         WSASetLastError(WSAECONNREFUSED);
         return false;
     }
 
+    ReportProxyUpstreamResult(config.proxy, true);
+    RecordHandshakeLatency(config.proxy, handshakeStart, true);
+    Core::ConnTrace::Instance().Mark((uint64_t)s, Core::TraceStage::TunnelReady);
+
     // 记录 socket -> 原始目标映射，便于在断开时输出可复盘日志
     RememberSocketTarget(s, host, port);
+    g_socketClass.Set((uintptr_t)s, Network::SocketClass::ProxiedTcp);
+    Network::PacketCapture::Instance().OnFlowOpen(s, IPPROTO_TCP, host, port);
     
     // 隧道就绪日志：始终打印，便于排查问题（如"隧道建立成功但后续不通"）
-    Core::Logger::Info("代理隧道就绪: sock=" + std::to_string((unsigned long long)s) +
-                       ", type=" + config.proxy.type +
-                       ", 代理=" + config.proxy.host + ":" + std::to_string(config.proxy.port) +
-                       ", 目标=" + host + ":" + std::to_string(port));
+    AGP_LOG_INFO(Route, "代理隧道就绪: sock=" + std::to_string((unsigned long long)s) +
+                        ", type=" + config.proxy.type +
+                        ", 代理=" + config.proxy.host + ":" + std::to_string(config.proxy.port) +
+                        ", 目标=" + host + ":" + std::to_string(port));
     return true;
 }
 
+static bool IsConnectExEntry(const OverlappedEntry& e) {
+    return e.kind == OverlappedKind::ConnectEx;
+}
+
 static void PurgeStaleConnectExContexts(ULONGLONG now) {
     // 清理长时间未完成的 ConnectEx 上下文，避免内存堆积
-    for (auto it = g_connectExPending.begin(); it != g_connectExPending.end(); ) {
-        if (now - it->second.createdTick > kConnectExPendingTtlMs) {
-            it = g_connectExPending.erase(it);
-        } else {
-            ++it;
+    // 性能优化：时间轮只推进经过的刻度并取出到期条目，不再扫描全部 overlapped 登记
+    g_connectExPending.Expire(now, [](uint64_t handle, ConnectExContext&& ctx) {
+        // 仅摘除仍指向该句柄的登记：同一 OVERLAPPED 可能已被完成并复用于新的 ConnectEx
+        OverlappedEntry entry{};
+        if (TakeOverlapped(ctx.ovl, [handle](const OverlappedEntry& e) {
+                return e.kind == OverlappedKind::ConnectEx && e.connectEx == handle;
+            }, &entry)) {
+            entry.connectEx = 0; // 上下文已由时间轮取出
+            FreeOverlappedEntry(&entry);
         }
-    }
+    });
 }
 
 static void SaveConnectExContext(LPOVERLAPPED ovl, const ConnectExContext& ctx) {
-    std::lock_guard<std::mutex> lock(g_connectExMtx);
     ULONGLONG now = GetTickCount64();
     PurgeStaleConnectExContexts(now);
-    ConnectExContext copy = ctx;
-    copy.createdTick = now;
-    g_connectExPending[ovl] = copy;
+    ConnectExContext pending = ctx;
+    pending.ovl = ovl;
+    OverlappedEntry entry{};
+    entry.kind = OverlappedKind::ConnectEx;
+    entry.sock = ctx.sock;
+    entry.connectEx = g_connectExPending.Insert(std::move(pending), now, kConnectExPendingTtlMs);
+    TrackOverlapped(ovl, entry);
 }
 
 static bool PopConnectExContext(LPOVERLAPPED ovl, ConnectExContext* out) {
-    std::lock_guard<std::mutex> lock(g_connectExMtx);
-    auto it = g_connectExPending.find(ovl);
-    if (it == g_connectExPending.end()) return false;
-    if (out) *out = it->second;
-    g_connectExPending.erase(it);
-    return true;
+    OverlappedEntry entry{};
+    if (!TakeOverlapped(ovl, IsConnectExEntry, &entry)) return false;
+    // 句柄失效说明上下文已被时间轮判定过期，按未登记处理
+    const bool found = g_connectExPending.Take(entry.connectEx, out);
+    entry.connectEx = 0;
+    FreeOverlappedEntry(&entry);
+    return found;
 }
 
 static void DropConnectExContext(LPOVERLAPPED ovl) {
-    std::lock_guard<std::mutex> lock(g_connectExMtx);
-    g_connectExPending.erase(ovl);
+    OverlappedEntry entry{};
+    if (TakeOverlapped(ovl, IsConnectExEntry, &entry)) FreeOverlappedEntry(&entry);
+}
+
+// IOCP/WSAGetOverlappedResult 报告失败时清理上下文；TCP ConnectEx 连接代理失败计入熔断
+// 说明：应用主动取消（closesocket/CancelIoEx）不代表上游不可用，不计入
+static void DropConnectExContextOnFailure(LPOVERLAPPED ovl, bool cancelled) {
+    ConnectExContext ctx{};
+    if (!PopConnectExContext(ovl, &ctx)) return;
+    if (!ctx.isUdp && !cancelled) {
+        ReportProxyConnectFailure(ctx.sock, Core::Config::Instance().proxy, AF_UNSPEC);
+    }
 }
 
 // ConnectEx 连接完成后更新上下文，避免 send 报 WSAENOTCONN
 static bool UpdateConnectExContext(SOCKET s) {
     if (setsockopt(s, SOL_SOCKET, SO_UPDATE_CONNECT_CONTEXT, NULL, 0) != 0) {
         int err = WSAGetLastError();
-        Core::Logger::Warn("ConnectEx: 更新连接上下文失败, sock=" + std::to_string((unsigned long long)s) +
+        AGP_LOG_WARN(Iocp, "ConnectEx: 更新连接上下文失败, sock=" + std::to_string((unsigned long long)s) +
                            ", WSA错误码=" + std::to_string(err));
     }
     int soErr = 0;
     int soErrLen = sizeof(soErr);
     if (getsockopt(s, SOL_SOCKET, SO_ERROR, (char*)&soErr, &soErrLen) == 0 && soErr != 0) {
-        Core::Logger::Error("ConnectEx: 连接状态异常, sock=" + std::to_string((unsigned long long)s) +
+        AGP_LOG_ERROR(Iocp, "ConnectEx: 连接状态异常, sock=" + std::to_string((unsigned long long)s) +
                             ", SO_ERROR=" + std::to_string(soErr));
         WSASetLastError(soErr);
         return false;
@@ -1439,7 +3127,9 @@ static bool HandleConnectExCompletion(LPOVERLAPPED ovl, DWORD* outSentBytes) {
     if (outSentBytes) *outSentBytes = 0;
     ConnectExContext ctx{};
     if (!PopConnectExContext(ovl, &ctx)) return true;
+    g_metrics.iocpConnectEx.Add();
     if (!UpdateConnectExContext(ctx.sock)) {
+        if (!ctx.isUdp) ReportProxyConnectFailure(ctx.sock, Core::Config::Instance().proxy, AF_UNSPEC);
         return false;
     }
 
@@ -1447,18 +3137,23 @@ static bool HandleConnectExCompletion(LPOVERLAPPED ovl, DWORD* outSentBytes) {
     if (ctx.isUdp) {
         MarkUdpRelayConnected(ctx.sock);
         UpdateUdpProxyDefaultTarget(ctx.sock, ctx.host, ctx.port);
-        RememberSocketTarget(ctx.sock, ctx.host, ctx.port);
+        RememberSocketTarget(ctx.sock, ctx.host, ctx.port, Core::SharedStats::FlowRoute::ProxyUdp);
 
         if (ctx.sendBuf && ctx.sendLen > 0) {
-            std::vector<uint8_t> packet;
-            if (!Network::Socks5Udp::Wrap(ctx.host, ctx.port, (const uint8_t*)ctx.sendBuf, (size_t)ctx.sendLen, &packet)) {
+            UdpSendHeader header;
+            if (!EncodeUdpSendHeader(ctx.host, ctx.port, &header)) {
                 WSASetLastError(WSAECONNREFUSED);
                 return false;
             }
+            WSABUF bufs[2];
+            bufs[0].buf = (CHAR*)header.bytes;
+            bufs[0].len = (ULONG)header.len;
+            bufs[1].buf = (CHAR*)ctx.sendBuf;
+            bufs[1].len = (ULONG)ctx.sendLen;
             auto& config = Core::Config::Instance();
-            if (!SendUdpPacketWithRetry(ctx.sock, packet.data(), (int)packet.size(), 0, config.timeout.send_ms)) {
+            if (!SendUdpGatherWithRetry(ctx.sock, bufs, 2, 0, config.timeout.send_ms)) {
                 int err = WSAGetLastError();
-                Core::Logger::Error("ConnectEx(UDP) 发送首包失败, sock=" + std::to_string((unsigned long long)ctx.sock) +
+                AGP_LOG_ERROR(Iocp, "ConnectEx(UDP) 发送首包失败, sock=" + std::to_string((unsigned long long)ctx.sock) +
                                     ", bytes=" + std::to_string((unsigned long long)ctx.sendLen) +
                                     ", WSA错误码=" + std::to_string(err));
                 WSASetLastError(err);
@@ -1483,7 +3178,7 @@ static bool HandleConnectExCompletion(LPOVERLAPPED ovl, DWORD* outSentBytes) {
         auto& config = Core::Config::Instance();
         if (!Network::SocketIo::SendAll(ctx.sock, ctx.sendBuf, (int)ctx.sendLen, config.timeout.send_ms)) {
             int err = WSAGetLastError();
-            Core::Logger::Error("ConnectEx 发送首包失败, sock=" + std::to_string((unsigned long long)ctx.sock) +
+            AGP_LOG_ERROR(Iocp, "ConnectEx 发送首包失败, sock=" + std::to_string((unsigned long long)ctx.sock) +
                                 ", bytes=" + std::to_string((unsigned long long)ctx.sendLen) +
                                 ", WSA错误码=" + std::to_string(err));
             WSASetLastError(err);
@@ -1513,27 +3208,27 @@ BOOL PASCAL DetourConnectEx(
 
 static bool ShouldProxyUdpByRule(const sockaddr* name, const std::string& originalHost, uint16_t originalPort) {
     auto& config = Core::Config::Instance();
-    if (config.proxy.port == 0) return false;
-    if (config.rules.udp_mode != "proxy") return false;
+    if (!config.policy.proxyEnabled) return false;
+    if (config.policy.udp != Core::UdpMode::Proxy) return false;
 
     // loopback 永远直连（避免递归与本地调试端口被误伤）
     if (IsSockaddrLoopback(name) || IsLoopbackHost(originalHost)) return false;
 
     // DNS 特殊处理：dns_mode=direct 时不代理 UDP 53
-    if (originalPort == 53 && (config.rules.dns_mode == "direct" || config.rules.dns_mode.empty())) {
+    if (originalPort == 53 && config.policy.dns == Core::DnsMode::Direct) {
         return false;
     }
 
     // 端口白名单：不在白名单则不代理
-    if (!config.rules.IsPortAllowed(originalPort)) return false;
+    if (!config.policy.allowedPorts.Test(originalPort)) return false;
 
     // IPv6 策略：纯 IPv6 连接先按 ipv6_mode 处理（与 TCP 路径保持一致）
     if (name && name->sa_family == AF_INET6) {
         const auto* a6 = (const sockaddr_in6*)name;
         const bool isV4Mapped = IN6_IS_ADDR_V4MAPPED(&a6->sin6_addr);
         if (!isV4Mapped) {
-            if (config.rules.ipv6_mode == "direct") return false;
-            if (config.rules.ipv6_mode == "block") return false;
+            if (config.policy.ipv6 == Core::Ipv6Mode::Direct) return false;
+            if (config.policy.ipv6 == Core::Ipv6Mode::Block) return false;
         }
     }
 
@@ -1546,10 +3241,8 @@ static bool ShouldProxyUdpByRule(const sockaddr* name, const std::string& origin
     config.rules.MatchRouting(originalHost, addrIp, addrIsV6, originalPort, "udp", &routeAction, &routeRule);
     routeAction = Core::ProxyRules::ToLower(std::move(routeAction));
     if (routeAction == "direct") {
-        if (Core::Logger::IsEnabled(Core::LogLevel::Debug)) {
-            Core::Logger::Debug("[Route] UDP direct, rule=" + (routeRule.empty() ? std::string("(default)") : routeRule) +
-                                ", target=" + originalHost + ":" + std::to_string(originalPort));
-        }
+        AGP_LOG_DEBUG(Udp, "[Route] UDP direct, rule=" + (routeRule.empty() ? std::string("(default)") : routeRule) +
+                           ", target=" + originalHost + ":" + std::to_string(originalPort));
         return false;
     }
 
@@ -1571,11 +3264,8 @@ static int PerformProxyUdpConnect(SOCKET s, const sockaddr* name, int namelen, b
 
     // direct 路径（含路由/策略）
     if (!ShouldProxyUdpByRule(name, originalHost, originalPort)) {
-        if (Core::Logger::IsEnabled(Core::LogLevel::Debug)) {
-            Core::Logger::Debug(std::string(isWsa ? "WSAConnect" : "connect") +
-                                ": UDP 直连, sock=" + std::to_string((unsigned long long)s) +
-                                ", target=" + originalHost + ":" + std::to_string(originalPort));
-        }
+        AGP_LOG_EVENT(ConnectUdpDirect, isWsa ? "WSAConnect" : "connect", s,
+      Core::LogHost(originalHost), originalPort);
         return isWsa ? fpWSAConnect(s, name, namelen, NULL, NULL, NULL, NULL) : fpConnect(s, name, namelen);
     }
 
@@ -1583,11 +3273,11 @@ static int PerformProxyUdpConnect(SOCKET s, const sockaddr* name, int namelen, b
     if (name && name->sa_family == AF_INET6) {
         const auto* a6 = (const sockaddr_in6*)name;
         const bool isV4Mapped = IN6_IS_ADDR_V4MAPPED(&a6->sin6_addr);
-        if (!isV4Mapped && config.rules.ipv6_mode == "block") {
+        if (!isV4Mapped && config.policy.ipv6 == Core::Ipv6Mode::Block) {
             const int err = WSAEACCES;
-            Core::Logger::Warn("UDP IPv6 已阻止(策略: ipv6_mode=block), sock=" + std::to_string((unsigned long long)s) +
-                               ", target=" + originalHost + ":" + std::to_string(originalPort) +
-                               ", WSA错误码=" + std::to_string(err));
+            AGP_LOG_WARN(Udp, "UDP IPv6 已阻止(策略: ipv6_mode=block), sock=" + std::to_string((unsigned long long)s) +
+                              ", target=" + originalHost + ":" + std::to_string(originalPort) +
+                              ", WSA错误码=" + std::to_string(err));
             WSASetLastError(err);
             return SOCKET_ERROR;
         }
@@ -1596,12 +3286,12 @@ static int PerformProxyUdpConnect(SOCKET s, const sockaddr* name, int namelen, b
     // 确保 UDP Associate 就绪，并将本 socket connect 到 relay
     if (!EnsureUdpProxyReady(s, name->sa_family, originalHost, originalPort, true)) {
         // 失败降级：按配置回退 direct 或维持失败(block)
-        if (config.rules.udp_fallback == "direct") {
-            if (ShouldLogUdpProxyFail()) {
+        if (config.policy.udpFallback == Core::UdpFallback::Direct) {
+            if (AGP_LOG_ENABLED_LIMITED(Udp, Warn)) {
                 const int err = WSAGetLastError();
-                Core::Logger::Warn("UDP 代理失败，回退为 direct, sock=" + std::to_string((unsigned long long)s) +
-                                   ", target=" + originalHost + ":" + std::to_string(originalPort) +
-                                   ", WSA错误码=" + std::to_string(err));
+                AGP_LOG_WARN(Udp, "UDP 代理失败，回退为 direct, sock=" + std::to_string((unsigned long long)s) +
+                                  ", target=" + originalHost + ":" + std::to_string(originalPort) +
+                                  ", WSA错误码=" + std::to_string(err));
             }
             CleanupUdpProxyContext(s);
             return isWsa ? fpWSAConnect(s, name, namelen, NULL, NULL, NULL, NULL) : fpConnect(s, name, namelen);
@@ -1609,12 +3299,9 @@ static int PerformProxyUdpConnect(SOCKET s, const sockaddr* name, int namelen, b
         return SOCKET_ERROR;
     }
 
-    RememberSocketTarget(s, originalHost, originalPort);
-    if (Core::Logger::IsEnabled(Core::LogLevel::Debug)) {
-        Core::Logger::Debug(std::string(isWsa ? "WSAConnect" : "connect") +
-                            ": UDP 已重定向到 SOCKS5 relay, sock=" + std::to_string((unsigned long long)s) +
-                            ", target=" + originalHost + ":" + std::to_string(originalPort));
-    }
+    RememberSocketTarget(s, originalHost, originalPort, Core::SharedStats::FlowRoute::ProxyUdp);
+    AGP_LOG_EVENT(ConnectUdpRelay, isWsa ? "WSAConnect" : "connect", s,
+  Core::LogHost(originalHost), originalPort);
     return 0;
 }
 
@@ -1652,11 +3339,11 @@ static BOOL PerformProxyUdpConnectEx(
     if (name && name->sa_family == AF_INET6) {
         const auto* a6 = (const sockaddr_in6*)name;
         const bool isV4Mapped = IN6_IS_ADDR_V4MAPPED(&a6->sin6_addr);
-        if (!isV4Mapped && config.rules.ipv6_mode == "block") {
+        if (!isV4Mapped && config.policy.ipv6 == Core::Ipv6Mode::Block) {
             const int err = WSAEACCES;
-            Core::Logger::Warn("ConnectEx(UDP) IPv6 已阻止(策略: ipv6_mode=block), sock=" + std::to_string((unsigned long long)s) +
-                               ", target=" + originalHost + ":" + std::to_string(originalPort) +
-                               ", WSA错误码=" + std::to_string(err));
+            AGP_LOG_WARN(Udp, "ConnectEx(UDP) IPv6 已阻止(策略: ipv6_mode=block), sock=" + std::to_string((unsigned long long)s) +
+                              ", target=" + originalHost + ":" + std::to_string(originalPort) +
+                              ", WSA错误码=" + std::to_string(err));
             WSASetLastError(err);
             return FALSE;
         }
@@ -1664,12 +3351,12 @@ static BOOL PerformProxyUdpConnectEx(
 
     // 确保已获取 relay（但 connect 由 originalConnectEx 完成，以保持 Overlapped 语义）
     if (!EnsureUdpProxyReady(s, name->sa_family, originalHost, originalPort, false)) {
-        if (config.rules.udp_fallback == "direct") {
-            if (ShouldLogUdpProxyFail()) {
+        if (config.policy.udpFallback == Core::UdpFallback::Direct) {
+            if (AGP_LOG_ENABLED_LIMITED(Udp, Warn)) {
                 const int err = WSAGetLastError();
-                Core::Logger::Warn("ConnectEx(UDP) 代理准备失败，回退为 direct, sock=" + std::to_string((unsigned long long)s) +
-                                   ", target=" + originalHost + ":" + std::to_string(originalPort) +
-                                   ", WSA错误码=" + std::to_string(err));
+                AGP_LOG_WARN(Udp, "ConnectEx(UDP) 代理准备失败，回退为 direct, sock=" + std::to_string((unsigned long long)s) +
+                                  ", target=" + originalHost + ":" + std::to_string(originalPort) +
+                                  ", WSA错误码=" + std::to_string(err));
             }
             CleanupUdpProxyContext(s);
             return originalConnectEx(s, name, namelen, lpSendBuffer, dwSendDataLength, lpdwBytesSent, lpOverlapped);
@@ -1681,10 +3368,10 @@ static BOOL PerformProxyUdpConnectEx(
     int relayLen = 0;
     if (!TryGetUdpRelayAddr(s, &relay, &relayLen)) {
         WSASetLastError(WSAECONNREFUSED);
-        if (config.rules.udp_fallback == "direct") {
-            if (ShouldLogUdpProxyFail()) {
-                Core::Logger::Warn("ConnectEx(UDP) 获取 relay 失败，回退为 direct, sock=" + std::to_string((unsigned long long)s) +
-                                   ", target=" + originalHost + ":" + std::to_string(originalPort));
+        if (config.policy.udpFallback == Core::UdpFallback::Direct) {
+            if (AGP_LOG_ENABLED_LIMITED(Udp, Warn)) {
+                AGP_LOG_WARN(Udp, "ConnectEx(UDP) 获取 relay 失败，回退为 direct, sock=" + std::to_string((unsigned long long)s) +
+                                  ", target=" + originalHost + ":" + std::to_string(originalPort));
             }
             CleanupUdpProxyContext(s);
             return originalConnectEx(s, name, namelen, lpSendBuffer, dwSendDataLength, lpdwBytesSent, lpOverlapped);
@@ -1696,10 +3383,10 @@ static BOOL PerformProxyUdpConnectEx(
     int relayForSockLen = 0;
     if (!BuildUdpRelayAddrForSocketFamily(name->sa_family, relay, relayLen, &relayForSock, &relayForSockLen)) {
         WSASetLastError(WSAEAFNOSUPPORT);
-        if (config.rules.udp_fallback == "direct") {
-            if (ShouldLogUdpProxyFail()) {
-                Core::Logger::Warn("ConnectEx(UDP) relay 地址族不兼容，回退为 direct, sock=" + std::to_string((unsigned long long)s) +
-                                   ", target=" + originalHost + ":" + std::to_string(originalPort));
+        if (config.policy.udpFallback == Core::UdpFallback::Direct) {
+            if (AGP_LOG_ENABLED_LIMITED(Udp, Warn)) {
+                AGP_LOG_WARN(Udp, "ConnectEx(UDP) relay 地址族不兼容，回退为 direct, sock=" + std::to_string((unsigned long long)s) +
+                                  ", target=" + originalHost + ":" + std::to_string(originalPort));
             }
             CleanupUdpProxyContext(s);
             return originalConnectEx(s, name, namelen, lpSendBuffer, dwSendDataLength, lpdwBytesSent, lpOverlapped);
@@ -1729,20 +3416,20 @@ static BOOL PerformProxyUdpConnectEx(
                 ctx.bytesSent = lpdwBytesSent;
                 ctx.isUdp = true;
                 SaveConnectExContext(lpOverlapped, ctx);
-            } else if (Core::Logger::IsEnabled(Core::LogLevel::Debug)) {
-                Core::Logger::Debug("ConnectEx(UDP) 返回 WSA_IO_PENDING 但未提供 Overlapped, sock=" + std::to_string((unsigned long long)s) +
-                                    ", 目标=" + originalHost + ":" + std::to_string(originalPort));
+            } else if (AGP_LOG_ENABLED(Udp, Debug)) {
+                AGP_LOG_DEBUG(Udp, "ConnectEx(UDP) 返回 WSA_IO_PENDING 但未提供 Overlapped, sock=" + std::to_string((unsigned long long)s) +
+                                   ", 目标=" + originalHost + ":" + std::to_string(originalPort));
             }
             return FALSE;
         }
-        Core::Logger::Error("ConnectEx(UDP) 连接 relay 失败, sock=" + std::to_string((unsigned long long)s) +
-                            ", WSA错误码=" + std::to_string(err));
+        AGP_LOG_ERROR(Udp, "ConnectEx(UDP) 连接 relay 失败, sock=" + std::to_string((unsigned long long)s) +
+                           ", WSA错误码=" + std::to_string(err));
         WSASetLastError(err);
-        if (config.rules.udp_fallback == "direct") {
-            if (ShouldLogUdpProxyFail()) {
-                Core::Logger::Warn("ConnectEx(UDP) 连接 relay 失败，回退为 direct, sock=" + std::to_string((unsigned long long)s) +
-                                   ", target=" + originalHost + ":" + std::to_string(originalPort) +
-                                   ", WSA错误码=" + std::to_string(err));
+        if (config.policy.udpFallback == Core::UdpFallback::Direct) {
+            if (AGP_LOG_ENABLED_LIMITED(Udp, Warn)) {
+                AGP_LOG_WARN(Udp, "ConnectEx(UDP) 连接 relay 失败，回退为 direct, sock=" + std::to_string((unsigned long long)s) +
+                                  ", target=" + originalHost + ":" + std::to_string(originalPort) +
+                                  ", WSA错误码=" + std::to_string(err));
             }
             CleanupUdpProxyContext(s);
             return originalConnectEx(s, name, namelen, lpSendBuffer, dwSendDataLength, lpdwBytesSent, lpOverlapped);
@@ -1754,18 +3441,23 @@ static BOOL PerformProxyUdpConnectEx(
     UpdateConnectExContext(s);
     MarkUdpRelayConnected(s);
     UpdateUdpProxyDefaultTarget(s, originalHost, originalPort);
-    RememberSocketTarget(s, originalHost, originalPort);
+    RememberSocketTarget(s, originalHost, originalPort, Core::SharedStats::FlowRoute::ProxyUdp);
 
     if (lpSendBuffer && dwSendDataLength > 0) {
-        std::vector<uint8_t> packet;
-        if (!Network::Socks5Udp::Wrap(originalHost, originalPort, (const uint8_t*)lpSendBuffer, (size_t)dwSendDataLength, &packet)) {
+        UdpSendHeader header;
+        if (!EncodeUdpSendHeader(originalHost, originalPort, &header)) {
             WSASetLastError(WSAECONNREFUSED);
             return FALSE;
         }
-        if (!SendUdpPacketWithRetry(s, packet.data(), (int)packet.size(), 0, config.timeout.send_ms)) {
+        WSABUF bufs[2];
+        bufs[0].buf = (CHAR*)header.bytes;
+        bufs[0].len = (ULONG)header.len;
+        bufs[1].buf = (CHAR*)lpSendBuffer;
+        bufs[1].len = (ULONG)dwSendDataLength;
+        if (!SendUdpGatherWithRetry(s, bufs, 2, 0, config.timeout.send_ms)) {
             int serr = WSAGetLastError();
-            Core::Logger::Error("ConnectEx(UDP) 发送首包失败, sock=" + std::to_string((unsigned long long)s) +
-                                ", WSA错误码=" + std::to_string(serr));
+            AGP_LOG_ERROR(Udp, "ConnectEx(UDP) 发送首包失败, sock=" + std::to_string((unsigned long long)s) +
+                               ", WSA错误码=" + std::to_string(serr));
             WSASetLastError(serr);
             return FALSE;
         }
@@ -1779,6 +3471,7 @@ static BOOL PerformProxyUdpConnectEx(
 
 // 执行代理连接逻辑
 int PerformProxyConnect(SOCKET s, const struct sockaddr* name, int namelen, bool isWsa) {
+    const uint64_t traceStartUs = Core::ConnTrace::NowUs();
     auto& config = Core::Config::Instance();
     LogRuntimeConfigSummaryOnce();
     
@@ -1805,116 +3498,97 @@ int PerformProxyConnect(SOCKET s, const struct sockaddr* name, int namelen, bool
     }
 
     // Hook 调用日志：仅在 Debug 下记录参数，避免热路径字符串拼接开销
-    if (Core::Logger::IsEnabled(Core::LogLevel::Debug)) {
-        const std::string dst = SockaddrToString(name);
-        Core::Logger::Debug(std::string(isWsa ? "WSAConnect" : "connect") +
-                            ": 调用, sock=" + std::to_string((unsigned long long)s) +
-                            ", dst=" + (dst.empty() ? "(未知)" : dst) +
-                            ", family=" + std::to_string((int)name->sa_family) +
-                            ", namelen=" + std::to_string(namelen));
-    }
+    AGP_LOG_EVENT(ConnectCall, isWsa ? "WSAConnect" : "connect", s, ToLogAddr(name),
+  (int)name->sa_family, namelen);
     
-    // 仅对 TCP (SOCK_STREAM) 做代理，避免误伤 UDP/QUIC 等
-    if (config.proxy.port != 0) {
-        const int soType = GetSocketTypeForProxyDecision(s);
-        if (soType != SOCK_STREAM) {
-
-            if (soType == SOCK_DGRAM) {
-                // UDP 强阻断：默认阻断 UDP（除 DNS/loopback 例外），强制应用回退到 TCP 再走代理
-                // 设计意图：解决国内环境 QUIC/HTTP3(UDP) 绕过代理导致“看似已建隧道但仍不可用”的问题。
-                if (config.rules.udp_mode == "block") {
-                    uint16_t dstPort = 0;
-                    const bool hasPort = TryGetSockaddrPort(name, &dstPort);
-                    const bool allowUdp = IsSockaddrLoopback(name) || (hasPort && dstPort == 53);
-                    if (!allowUdp) {
-                        const int err = WSAEACCES;
-                        if (ShouldLogUdpBlock()) {
-                            const std::string api = isWsa ? "WSAConnect" : "connect";
-                            const std::string dst = SockaddrToString(name);
-                            Core::Logger::Warn(api + ": 已阻止 UDP 连接(策略: udp_mode=block, 说明: 禁用 QUIC/HTTP3), sock=" + std::to_string((unsigned long long)s) +
-                                               (dst.empty() ? "" : ", dst=" + dst) +
-                                               (hasPort ? (", port=" + std::to_string(dstPort)) : std::string("")) +
-                                               ", WSA错误码=" + std::to_string(err));
-                        }
-                        WSASetLastError(err);
-                        return SOCKET_ERROR;
-                    }
-                    if (Core::Logger::IsEnabled(Core::LogLevel::Debug)) {
-                        const std::string dst = SockaddrToString(name);
-                        Core::Logger::Debug(std::string(isWsa ? "WSAConnect" : "connect") +
-                                            ": UDP 直连已放行(例外), sock=" + std::to_string((unsigned long long)s) +
-                                            (dst.empty() ? "" : ", dst=" + dst));
-                    }
-                    return isWsa ? fpWSAConnect(s, name, namelen, NULL, NULL, NULL, NULL) : fpConnect(s, name, namelen);
-                }
-
-                // UDP 走代理：用于 QUIC/HTTP3（通过 SOCKS5 UDP Associate）
-                if (config.rules.udp_mode == "proxy") {
-                    return PerformProxyUdpConnect(s, name, namelen, isWsa);
-                }
-
-                // udp_mode=direct：保持直连
-                return isWsa ? fpWSAConnect(s, name, namelen, NULL, NULL, NULL, NULL) : fpConnect(s, name, namelen);
+    // 决策前导：仅对 TCP (SOCK_STREAM) 做代理，避免误伤 UDP/QUIC 等；纯 IPv6 / 非 IP 地址族按策略处理
+    const ConnectPrologueInput prologue = CollectConnectFacts(s, name, config.policy);
+    switch (Core::DecideConnectPrologue(config.policy, prologue.facts)) {
+        case Core::ConnectPrologue::UdpBlocked: {
+            // UDP 强阻断：默认阻断 UDP（除 DNS/loopback 例外），强制应用回退到 TCP 再走代理
+            // 设计意图：解决国内环境 QUIC/HTTP3(UDP) 绕过代理导致“看似已建隧道但仍不可用”的问题。
+            const int err = WSAEACCES;
+            if (AGP_LOG_ENABLED_LIMITED(Udp, Warn)) {
+                const std::string api = isWsa ? "WSAConnect" : "connect";
+                const std::string dst = SockaddrToString(name);
+                AGP_LOG_WARN(Udp, api + ": 已阻止 UDP 连接(策略: udp_mode=block, 说明: 禁用 QUIC/HTTP3), sock=" + std::to_string((unsigned long long)s) +
+                                  (dst.empty() ? "" : ", dst=" + dst) +
+                                  (prologue.hasPort ? (", port=" + std::to_string(prologue.facts.port)) : std::string("")) +
+                                  ", WSA错误码=" + std::to_string(err));
             }
-
+            g_socketClass.Set((uintptr_t)s, Network::SocketClass::BlockedUdp);
+            WSASetLastError(err);
+            return SOCKET_ERROR;
+        }
+        case Core::ConnectPrologue::UdpBlockException:
+            if (AGP_LOG_ENABLED(Route, Debug)) {
+                const std::string dst = SockaddrToString(name);
+                AGP_LOG_DEBUG(Route, std::string(isWsa ? "WSAConnect" : "connect") +
+                                     ": UDP 直连已放行(例外), sock=" + std::to_string((unsigned long long)s) +
+                                     (dst.empty() ? "" : ", dst=" + dst));
+            }
+            return isWsa ? fpWSAConnect(s, name, namelen, NULL, NULL, NULL, NULL) : fpConnect(s, name, namelen);
+        case Core::ConnectPrologue::UdpProxy:
+            // UDP 走代理：用于 QUIC/HTTP3（通过 SOCKS5 UDP Associate）
+            return PerformProxyUdpConnect(s, name, namelen, isWsa);
+        case Core::ConnectPrologue::UdpDirect:
+            // udp_mode=direct：保持直连
+            return isWsa ? fpWSAConnect(s, name, namelen, NULL, NULL, NULL, NULL) : fpConnect(s, name, namelen);
+        case Core::ConnectPrologue::NonStreamDirect:
             // 其他非 SOCK_STREAM 类型保持直连；仅在 Debug 下记录，避免刷屏影响性能
-            if (Core::Logger::IsEnabled(Core::LogLevel::Debug)) {
+            if (AGP_LOG_ENABLED(Route, Debug)) {
                 const std::string dst = SockaddrToString(name);
-                Core::Logger::Debug(std::string(isWsa ? "WSAConnect" : "connect") +
-                                    ": 非 SOCK_STREAM 直连, sock=" + std::to_string((unsigned long long)s) +
-                                    ", soType=" + std::to_string(soType) +
-                                    (dst.empty() ? "" : ", dst=" + dst));
+                AGP_LOG_DEBUG(Route, std::string(isWsa ? "WSAConnect" : "connect") +
+                                     ": 非 SOCK_STREAM 直连, sock=" + std::to_string((unsigned long long)s) +
+                                     ", soType=" + std::to_string(prologue.soType) +
+                                     (dst.empty() ? "" : ", dst=" + dst));
             }
             return isWsa ? fpWSAConnect(s, name, namelen, NULL, NULL, NULL, NULL) : fpConnect(s, name, namelen);
+        // WARN-5: 优先级说明：纯 IPv6 连接会先按 ipv6_mode 决策（direct/block/proxy），
+        // 仅当 ipv6_mode=proxy 时才会继续进入下方的 routing 规则匹配。
+        // v4-mapped IPv6 本质是 IPv4 连接：不受 ipv6_mode 影响（否则会影响 FakeIP v4-mapped 回填）
+        case Core::ConnectPrologue::Ipv6Direct: {
+            const std::string addrStr = SockaddrToString(name);
+            AGP_LOG_INFO(Route, "IPv6 连接已直连(策略: direct), sock=" + std::to_string((unsigned long long)s) +
+                                ", family=" + std::to_string((int)name->sa_family) +
+                                (addrStr.empty() ? "" : ", addr=" + addrStr));
+            return isWsa ? fpWSAConnect(s, name, namelen, NULL, NULL, NULL, NULL) : fpConnect(s, name, namelen);
         }
-    }
-
-    if (name->sa_family == AF_INET6) {
-        const auto* addr6 = (const sockaddr_in6*)name;
-        const bool isV4Mapped = IN6_IS_ADDR_V4MAPPED(&addr6->sin6_addr);
-
-        // v4-mapped IPv6 本质是 IPv4 连接：不应被 ipv6_mode 误伤（否则会影响 FakeIP v4-mapped 回填）
-        if (!isV4Mapped) {
-            // WARN-5: 优先级说明：纯 IPv6 连接会先按 ipv6_mode 决策（direct/block/proxy），
-            // 仅当 ipv6_mode=proxy 时才会继续进入下方的 routing 规则匹配。
-            std::string addrStr = SockaddrToString(name);
-            if (config.proxy.port != 0) {
-                const std::string& ipv6Mode = config.rules.ipv6_mode;
-                if (ipv6Mode == "direct") {
-                    Core::Logger::Info("IPv6 连接已直连(策略: direct), sock=" + std::to_string((unsigned long long)s) +
-                                       ", family=" + std::to_string((int)name->sa_family) +
-                                       (addrStr.empty() ? "" : ", addr=" + addrStr));
-                    return isWsa ? fpWSAConnect(s, name, namelen, NULL, NULL, NULL, NULL) : fpConnect(s, name, namelen);
-                }
-                if (ipv6Mode != "proxy") {
-                    // 强制阻止 IPv6，避免绕过代理
-                    Core::Logger::Warn("已阻止 IPv6 连接(策略: block), sock=" + std::to_string((unsigned long long)s) +
-                                       ", family=" + std::to_string((int)name->sa_family) +
-                                       (addrStr.empty() ? "" : ", addr=" + addrStr));
-                    WSASetLastError(WSAEAFNOSUPPORT);
-                    return SOCKET_ERROR;
-                }
-            } else {
-                Core::Logger::Info("IPv6 连接已直连, sock=" + std::to_string((unsigned long long)s) +
-                                   ", family=" + std::to_string((int)name->sa_family) +
-                                   (addrStr.empty() ? "" : ", addr=" + addrStr));
-                return isWsa ? fpWSAConnect(s, name, namelen, NULL, NULL, NULL, NULL) : fpConnect(s, name, namelen);
-            }
+        case Core::ConnectPrologue::Ipv6Blocked: {
+            // 强制阻止 IPv6，避免绕过代理
+            const std::string addrStr = SockaddrToString(name);
+            AGP_LOG_WARN(Route, "已阻止 IPv6 连接(策略: block), sock=" + std::to_string((unsigned long long)s) +
+                                ", family=" + std::to_string((int)name->sa_family) +
+                                (addrStr.empty() ? "" : ", addr=" + addrStr));
+            WSASetLastError(WSAEAFNOSUPPORT);
+            return SOCKET_ERROR;
         }
-    } else if (name->sa_family != AF_INET) {
-        std::string addrStr = SockaddrToString(name);
-        if (config.proxy.port != 0) {
+        case Core::ConnectPrologue::Ipv6NoProxy: {
+            const std::string addrStr = SockaddrToString(name);
+            AGP_LOG_INFO(Route, "IPv6 连接已直连, sock=" + std::to_string((unsigned long long)s) +
+                                ", family=" + std::to_string((int)name->sa_family) +
+                                (addrStr.empty() ? "" : ", addr=" + addrStr));
+            return isWsa ? fpWSAConnect(s, name, namelen, NULL, NULL, NULL, NULL) : fpConnect(s, name, namelen);
+        }
+        case Core::ConnectPrologue::FamilyBlocked: {
             // 非 IPv4/IPv6 连接一律阻止，避免绕过代理
-            Core::Logger::Warn("已阻止非 IPv4/IPv6 连接, sock=" + std::to_string((unsigned long long)s) +
-                               ", family=" + std::to_string((int)name->sa_family) +
-                               (addrStr.empty() ? "" : ", addr=" + addrStr));
+            const std::string addrStr = SockaddrToString(name);
+            AGP_LOG_WARN(Route, "已阻止非 IPv4/IPv6 连接, sock=" + std::to_string((unsigned long long)s) +
+                                ", family=" + std::to_string((int)name->sa_family) +
+                                (addrStr.empty() ? "" : ", addr=" + addrStr));
             WSASetLastError(WSAEAFNOSUPPORT);
             return SOCKET_ERROR;
         }
-        Core::Logger::Info("非 IPv4/IPv6 连接已直连, sock=" + std::to_string((unsigned long long)s) +
-                           ", family=" + std::to_string((int)name->sa_family) +
-                           (addrStr.empty() ? "" : ", addr=" + addrStr));
-        return isWsa ? fpWSAConnect(s, name, namelen, NULL, NULL, NULL, NULL) : fpConnect(s, name, namelen);
+        case Core::ConnectPrologue::FamilyNoProxy: {
+            const std::string addrStr = SockaddrToString(name);
+            AGP_LOG_INFO(Route, "非 IPv4/IPv6 连接已直连, sock=" + std::to_string((unsigned long long)s) +
+                                ", family=" + std::to_string((int)name->sa_family) +
+                                (addrStr.empty() ? "" : ", addr=" + addrStr));
+            RecordConnectRoute(ConnectRoute::FamilyDirect);
+            return isWsa ? fpWSAConnect(s, name, namelen, NULL, NULL, NULL, NULL) : fpConnect(s, name, namelen);
+        }
+        case Core::ConnectPrologue::Continue:
+            break;
     }
     
     std::string originalHost;
@@ -1929,20 +3603,16 @@ int PerformProxyConnect(SOCKET s, const struct sockaddr* name, int namelen, bool
     
     // BYPASS: 跳过本地回环地址，避免代理死循环
     if (IsLoopbackHost(originalHost)) {
-        if (Core::Logger::IsEnabled(Core::LogLevel::Debug)) {
-            Core::Logger::Debug("BYPASS(loopback): sock=" + std::to_string((unsigned long long)s) +
-                                ", target=" + originalHost + ":" + std::to_string(originalPort));
-        }
+        AGP_LOG_EVENT(BypassLoopback, s, Core::LogHost(originalHost), originalPort);
+        RecordConnectRoute(ConnectRoute::BypassLoopback);
         return isWsa ? fpWSAConnect(s, name, namelen, NULL, NULL, NULL, NULL) : fpConnect(s, name, namelen);
     }
     
     // BYPASS: 如果目标端口就是代理端口，直连（防止代理自连接）
     if (IsProxySelfTarget(originalHost, originalPort, config.proxy)) {
-        if (Core::Logger::IsEnabled(Core::LogLevel::Debug)) {
-            Core::Logger::Debug("BYPASS(proxy-self): sock=" + std::to_string((unsigned long long)s) +
-                                ", target=" + originalHost + ":" + std::to_string(originalPort) +
-                                ", proxy=" + config.proxy.host + ":" + std::to_string(config.proxy.port));
-        }
+        AGP_LOG_EVENT(BypassProxySelf, s, Core::LogHost(originalHost), originalPort,
+      Core::LogHost(config.proxy.host), config.proxy.port);
+        RecordConnectRoute(ConnectRoute::BypassProxySelf);
         return isWsa ? fpWSAConnect(s, name, namelen, NULL, NULL, NULL, NULL) : fpConnect(s, name, namelen);
     }
 
@@ -1954,11 +3624,25 @@ int PerformProxyConnect(SOCKET s, const struct sockaddr* name, int namelen, bool
     std::string routeRule;
     const bool routeMatched = config.rules.MatchRouting(originalHost, addrIp, addrIsV6, originalPort, "tcp",
                                                         &routeAction, &routeRule);
+    AGP_FLIGHT_RECORD(RouteMatch, s, Core::LogHost(originalHost), originalPort,
+                      routeAction.empty() ? std::string_view("(default)") : std::string_view(routeAction),
+                      routeMatched ? std::string_view(routeRule) : std::string_view("(default)"));
+    // ROUTE-0b: default_action=learn 且未命中规则：按学习到的域名偏好选路，无偏好时走代理并探测直连
+    bool probeDirect = false;
+    if (IsLearnRoute(routeAction)) {
+        const Network::RouteChoice learned = DecideLearnedRoute(originalHost);
+        if (learned == Network::RouteChoice::Direct) {
+            int result = 0;
+            if (TryLearnedDirectConnect(s, name, namelen, isWsa, originalHost, originalPort, &result)) return result;
+        }
+        probeDirect = learned == Network::RouteChoice::Probe;
+    }
     if (!routeAction.empty() && routeAction == "direct") {
-        if (ShouldLogRouteDecisionInfo()) {
-            Core::Logger::Info("[Route] direct" +
-                               std::string(routeMatched ? (" rule=" + routeRule) : " rule=(default)") +
-                               ", target=" + originalHost + ":" + std::to_string(originalPort));
+        RecordDirectRoute(s, ConnectRoute::RuleDirect, originalHost, originalPort);
+        if (AGP_LOG_ENABLED_LIMITED(Route, Info)) {
+            AGP_LOG_INFO(Route, "[Route] direct" +
+                                std::string(routeMatched ? (" rule=" + routeRule) : " rule=(default)") +
+                                ", target=" + originalHost + ":" + std::to_string(originalPort));
         }
         // CRIT-3: 若底层 sockaddr 仍为 FakeIP，则 direct 直连必失败；这里做兜底重解析
         sockaddr_storage realAddr{};
@@ -1966,68 +3650,100 @@ int PerformProxyConnect(SOCKET s, const struct sockaddr* name, int namelen, bool
         bool wasFake = false;
         if (TryResolveDirectTargetFromFakeIp(name, originalHost, originalPort, &realAddr, &realLen, &wasFake)) {
             const std::string dst = SockaddrToString((sockaddr*)&realAddr);
-            if (ShouldLogRouteDecisionInfo()) {
-                Core::Logger::Info("[Route] direct: FakeIP 已重解析直连" +
-                                   (dst.empty() ? std::string("") : (", addr=" + dst)) +
-                                   ", target=" + originalHost + ":" + std::to_string(originalPort));
+            if (AGP_LOG_ENABLED_LIMITED(Route, Info)) {
+                AGP_LOG_INFO(Route, "[Route] direct: FakeIP 已重解析直连" +
+                                    (dst.empty() ? std::string("") : (", addr=" + dst)) +
+                                    ", target=" + originalHost + ":" + std::to_string(originalPort));
             }
             return isWsa ? fpWSAConnect(s, (sockaddr*)&realAddr, realLen, NULL, NULL, NULL, NULL)
                          : fpConnect(s, (sockaddr*)&realAddr, realLen);
         }
         if (wasFake) {
-            Core::Logger::Warn("[Route] direct: 目标为 FakeIP 但重解析失败，回退原始直连(可能失败), target=" +
-                               originalHost + ":" + std::to_string(originalPort));
+            AGP_LOG_WARN(Route, "[Route] direct: 目标为 FakeIP 但重解析失败，回退原始直连(可能失败), target=" +
+                                originalHost + ":" + std::to_string(originalPort));
         }
         return isWsa ? fpWSAConnect(s, name, namelen, NULL, NULL, NULL, NULL)
                      : fpConnect(s, name, namelen);
     } else if (routeMatched) {
-        if (ShouldLogRouteDecisionInfo()) {
-            Core::Logger::Info("[Route] proxy rule=" + routeRule +
-                               ", target=" + originalHost + ":" + std::to_string(originalPort));
+        if (AGP_LOG_ENABLED_LIMITED(Route, Info)) {
+            AGP_LOG_INFO(Route, "[Route] proxy rule=" + routeRule +
+                                ", target=" + originalHost + ":" + std::to_string(originalPort));
         }
     }
     
     // ============= 智能路由决策 =============
-    // ROUTE-1: DNS 端口特殊处理 (解决 DNS 超时问题)
-    if (originalPort == 53) {
-        if (config.rules.dns_mode == "direct" || config.rules.dns_mode.empty()) {
-            if (ShouldLogRouteDecisionInfo()) {
-                Core::Logger::Info("DNS 请求直连 (策略: direct), sock=" + std::to_string((unsigned long long)s) +
-                                   ", 目标: " + originalHost + ":53");
-            }
-            return isWsa ? fpWSAConnect(s, name, namelen, NULL, NULL, NULL, NULL) 
-                         : fpConnect(s, name, namelen);
+    // ROUTE-1: DNS 端口特殊处理 (解决 DNS 超时问题)；ROUTE-2: 端口白名单过滤
+    const Core::PortDecision portDecision = Core::DecideConnectPort(config.policy, originalPort);
+    AGP_FLIGHT_RECORD(RoutePort, s, originalPort, Core::PortDecisionName(portDecision));
+    if (portDecision == Core::PortDecision::DnsDirect) {
+        RecordDirectRoute(s, ConnectRoute::DnsDirect, originalHost, originalPort);
+        if (AGP_LOG_ENABLED_LIMITED(Route, Info)) {
+            AGP_LOG_INFO(Route, "DNS 请求直连 (策略: direct), sock=" + std::to_string((unsigned long long)s) +
+                                ", 目标: " + originalHost + ":53");
         }
-        // dns_mode == "proxy" 则继续走后面的代理逻辑
-        if (ShouldLogRouteDecisionInfo()) {
-            Core::Logger::Info("DNS 请求走代理 (策略: proxy), sock=" + std::to_string((unsigned long long)s) +
-                               ", 目标: " + originalHost + ":53");
+        return isWsa ? fpWSAConnect(s, name, namelen, NULL, NULL, NULL, NULL) 
+                     : fpConnect(s, name, namelen);
+    }
+    if (originalPort == 53) {
+        // dns_mode == "proxy" 则继续走后面的代理逻辑（仍受端口白名单约束）
+        if (AGP_LOG_ENABLED_LIMITED(Route, Info)) {
+            AGP_LOG_INFO(Route, "DNS 请求走代理 (策略: proxy), sock=" + std::to_string((unsigned long long)s) +
+                                ", 目标: " + originalHost + ":53");
         }
     }
-    
-    // ROUTE-2: 端口白名单过滤
-    if (!config.rules.IsPortAllowed(originalPort)) {
-        if (ShouldLogRouteDecisionInfo()) {
-            Core::Logger::Info("端口 " + std::to_string(originalPort) + " 不在白名单, sock=" + std::to_string((unsigned long long)s) +
-                               ", 直连: " + originalHost);
+
+    if (portDecision == Core::PortDecision::NotAllowed) {
+        RecordDirectRoute(s, ConnectRoute::PortDirect, originalHost, originalPort);
+        if (AGP_LOG_ENABLED_LIMITED(Route, Info)) {
+            AGP_LOG_INFO(Route, "端口 " + std::to_string(originalPort) + " 不在白名单, sock=" + std::to_string((unsigned long long)s) +
+                                ", 直连: " + originalHost);
         }
         return isWsa ? fpWSAConnect(s, name, namelen, NULL, NULL, NULL, NULL) 
                      : fpConnect(s, name, namelen);
     }
     
     // 如果配置了代理
-    if (config.proxy.port != 0) {
-        if (ShouldLogRouteDecisionInfo()) {
-            Core::Logger::Info("正重定向 " + originalHost + ":" + std::to_string(originalPort) +
-                               " 到代理, sock=" + std::to_string((unsigned long long)s));
+    if (config.policy.proxyEnabled) {
+        // 熔断：上游连续失败时快速失败，或按 open_action=direct 回退直连
+        bool circuitFallbackDirect = false;
+        if (!AllowProxyUpstream(config.proxy, originalHost + ":" + std::to_string(originalPort), &circuitFallbackDirect)) {
+            if (!circuitFallbackDirect) {
+                RecordConnectRoute(ConnectRoute::CircuitReject);
+                return SOCKET_ERROR;
+            }
+            RecordDirectRoute(s, ConnectRoute::CircuitDirect, originalHost, originalPort);
+            sockaddr_storage realAddr{};
+            int realLen = 0;
+            bool wasFake = false;
+            if (TryResolveDirectTargetFromFakeIp(name, originalHost, originalPort, &realAddr, &realLen, &wasFake)) {
+                return isWsa ? fpWSAConnect(s, (sockaddr*)&realAddr, realLen, NULL, NULL, NULL, NULL)
+                             : fpConnect(s, (sockaddr*)&realAddr, realLen);
+            }
+            return isWsa ? fpWSAConnect(s, name, namelen, NULL, NULL, NULL, NULL)
+                         : fpConnect(s, name, namelen);
+        }
+
+        RecordConnectRoute(ConnectRoute::Proxy);
+        Core::ConnTrace::Instance().Begin((uint64_t)s, originalHost, originalPort, traceStartUs);
+        if (AGP_LOG_ENABLED_LIMITED(Route, Info)) {
+            AGP_LOG_INFO(Route, "正重定向 " + originalHost + ":" + std::to_string(originalPort) +
+                                " 到代理, sock=" + std::to_string((unsigned long long)s));
         }
         
         // 修改目标地址为代理服务器（按地址族构造）
+        auto proxyRtt = GetProxyRtt(config.proxy);
+        Network::RttEstimator* connectRtt = proxyRtt ? &proxyRtt->connect : nullptr;
+        const int connectTimeoutMs = AdaptiveTimeoutMs(connectRtt, config.timeout.connect_ms);
+        // 直连探测先于代理 connect 发出：两条路径从同一时刻开始，阻塞 socket 上代理 connect/握手期间探测同时进行
+        DirectRouteProbe routeProbe(originalHost);
+        if (probeDirect) routeProbe.Start(name, namelen, originalPort);
+        const auto connectStart = std::chrono::steady_clock::now();
         int result = 0;
         if (name->sa_family == AF_INET6) {
             sockaddr_in6 proxyAddr6{};
             if (!BuildProxyAddrV6(config.proxy, &proxyAddr6, (sockaddr_in6*)name)) {
                 WSASetLastError(WSAEINVAL);
+                ReportProxyConnectFailure(s, config.proxy, AF_INET6);
                 return SOCKET_ERROR;
             }
             result = isWsa ?
@@ -2037,38 +3753,49 @@ int PerformProxyConnect(SOCKET s, const struct sockaddr* name, int namelen, bool
             sockaddr_in proxyAddr{};
             if (!BuildProxyAddr(config.proxy, &proxyAddr, (sockaddr_in*)name)) {
                 WSASetLastError(WSAEINVAL);
+                ReportProxyConnectFailure(s, config.proxy, AF_INET);
                 return SOCKET_ERROR;
             }
             result = isWsa ? 
                 fpWSAConnect(s, (sockaddr*)&proxyAddr, sizeof(proxyAddr), NULL, NULL, NULL, NULL) :
                 fpConnect(s, (sockaddr*)&proxyAddr, sizeof(proxyAddr));
         }
-        
         if (result != 0) {
             int err = WSAGetLastError();
+            AGP_FLIGHT_RECORD(ProxyConnectResult, isWsa ? "WSAConnect" : "connect", s, result, err);
             if (err == WSAEWOULDBLOCK || err == WSAEINPROGRESS) {
                 // 非阻塞 connect 需要等待连接完成
-                if (!Network::SocketIo::WaitConnect(s, config.timeout.connect_ms)) {
+                if (!Network::SocketIo::WaitConnect(s, connectTimeoutMs)) {
                     int waitErr = WSAGetLastError();
-                    Core::Logger::Error("连接代理服务器失败, sock=" + std::to_string((unsigned long long)s) +
-                                        ", WSA错误码=" + std::to_string(waitErr));
+                    AGP_LOG_ERROR(Route, "连接代理服务器失败, sock=" + std::to_string((unsigned long long)s) +
+                                         ", 超时=" + std::to_string(connectTimeoutMs) + "ms" +
+                                         ", WSA错误码=" + std::to_string(waitErr));
+                    ReportAdaptiveAttempt(config.proxy, connectRtt, "连接代理", connectStart, connectTimeoutMs,
+                                          config.timeout.connect_ms, false);
+                    WSASetLastError(waitErr);
+                    ReportProxyConnectFailure(s, config.proxy, name->sa_family);
                     return SOCKET_ERROR;
                 }
             } else {
-                Core::Logger::Error("连接代理服务器失败, sock=" + std::to_string((unsigned long long)s) +
-                                    ", WSA错误码=" + std::to_string(err));
+                AGP_LOG_ERROR(Route, "连接代理服务器失败, sock=" + std::to_string((unsigned long long)s) +
+                                     ", WSA错误码=" + std::to_string(err));
+                ReportProxyConnectFailure(s, config.proxy, name->sa_family);
                 return result;
             }
         }
+        ReportAdaptiveAttempt(config.proxy, connectRtt, "连接代理", connectStart, connectTimeoutMs,
+                              config.timeout.connect_ms, true);
         
         if (!DoProxyHandshake(s, originalHost, originalPort)) {
             return SOCKET_ERROR;
         }
+        routeProbe.Settle(true);
         
         return 0; // 成功
     }
     
     // 无代理配置，直接连接
+    RecordDirectRoute(s, ConnectRoute::ProxyDisabled, originalHost, originalPort);
     return isWsa ? fpWSAConnect(s, name, namelen, NULL, NULL, NULL, NULL) : fpConnect(s, name, namelen);
 }
 
@@ -2094,26 +3821,23 @@ int WSAAPI DetourShutdown(SOCKET s, int how) {
     SocketTargetInfo target{};
     const bool hasTarget = TryGetSocketTarget(s, &target);
 
-    if (Core::Logger::IsEnabled(Core::LogLevel::Debug)) {
+    if (AGP_LOG_ENABLED(General, Debug)) {
         const std::string local = GetLocalEndpoint(s);
         const std::string peer = GetPeerEndpoint(s);
         const std::string targetStr = hasTarget
             ? (target.host + ":" + std::to_string(target.port))
             : std::string("(未知)");
-        Core::Logger::Debug("shutdown: sock=" + std::to_string((unsigned long long)s) +
-                            ", how=" + std::to_string(how) +
-                            ", target=" + targetStr +
-                            (local.empty() ? "" : ", local=" + local) +
-                            (peer.empty() ? "" : ", peer=" + peer));
+        AGP_LOG_DEBUG(General, "shutdown: sock=" + std::to_string((unsigned long long)s) +
+                               ", how=" + std::to_string(how) +
+                               ", target=" + targetStr +
+                               (local.empty() ? "" : ", local=" + local) +
+                               (peer.empty() ? "" : ", peer=" + peer));
     }
 
     int rc = fpShutdown(s, how);
     if (rc == SOCKET_ERROR) {
         int err = WSAGetLastError();
-        if (Core::Logger::IsEnabled(Core::LogLevel::Debug)) {
-            Core::Logger::Debug("shutdown: 失败, sock=" + std::to_string((unsigned long long)s) +
-                                ", WSA错误码=" + std::to_string(err));
-        }
+        Core::Logger::Event(Core::LogEvent::ShutdownFailed, s, err);
         WSASetLastError(err);
     }
     return rc;
@@ -2130,66 +3854,83 @@ int WSAAPI DetourCloseSocket(SOCKET s) {
 
     std::string local;
     std::string peer;
-    if (Core::Logger::IsEnabled(Core::LogLevel::Debug)) {
+    if (AGP_LOG_ENABLED(General, Debug)) {
         local = GetLocalEndpoint(s);
         peer = GetPeerEndpoint(s);
         const std::string targetStr = hasTarget
             ? (target.host + ":" + std::to_string(target.port))
             : std::string("(未知)");
-        Core::Logger::Debug("closesocket: sock=" + std::to_string((unsigned long long)s) +
-                            ", target=" + targetStr +
-                            (local.empty() ? "" : ", local=" + local) +
-                            (peer.empty() ? "" : ", peer=" + peer));
+        AGP_LOG_DEBUG(General, "closesocket: sock=" + std::to_string((unsigned long long)s) +
+                               ", target=" + targetStr +
+                               (local.empty() ? "" : ", local=" + local) +
+                               (peer.empty() ? "" : ", peer=" + peer));
     }
 
     int rc = fpCloseSocket(s);
     if (rc == SOCKET_ERROR) {
         int err = WSAGetLastError();
-        Core::Logger::Warn("closesocket: 失败, sock=" + std::to_string((unsigned long long)s) +
-                           ", WSA错误码=" + std::to_string(err));
+        AGP_LOG_LIMITED_WARN(General, "closesocket: 失败, sock=" + std::to_string((unsigned long long)s) +
+                                      ", WSA错误码=" + std::to_string(err));
         WSASetLastError(err);
         return rc;
     }
 
-    // UDP 代理：关闭对应的 UDP Associate 控制连接并清理 Overlapped 上下文
-    CleanupUdpProxyContext(s);
-
-    // 关闭成功后清理映射，避免句柄复用导致的误关联
-    ForgetSocketTarget(s);
+    // 关闭成功后统一清理 socket 记录（目标、UDP Associate 控制连接、Overlapped 上下文），避免句柄复用导致的误关联
+    TeardownSocketContext(s);
+    const Network::TrafficTotals totals =
+        Network::TrafficMonitor::Instance().OnClose(s, hasTarget ? (target.host + ":" + std::to_string(target.port)) : std::string());
+    if (hasTarget) ReportLearnedDirectClose(target, totals);
+    Network::PacketCapture::Instance().OnClose(s);
+    Core::ConnTrace::Instance().Finish((uint64_t)s, false);
 
-    if (Core::Logger::IsEnabled(Core::LogLevel::Debug)) {
-        Core::Logger::Debug("closesocket: 完成, sock=" + std::to_string((unsigned long long)s));
-    }
+    Core::Logger::Event(Core::LogEvent::CloseSocketDone, s);
     return rc;
 }
 
+// 连接阶段追踪：记下一次域名解析的起止时间（析构时写入本线程），供随后同线程对该目标的代理连接取用
+class DnsTraceScope {
+public:
+    DnsTraceScope() : m_startUs(Core::ConnTrace::Instance().IsEnabled() ? Core::ConnTrace::NowUs() : 0) {}
+    ~DnsTraceScope() {
+        if (m_startUs && !m_host.empty()) Core::ConnTrace::NoteDns(m_host, m_startUs, Core::ConnTrace::NowUs());
+    }
+    DnsTraceScope(const DnsTraceScope&) = delete;
+    DnsTraceScope& operator=(const DnsTraceScope&) = delete;
+
+    bool Active() const { return m_startUs != 0; }
+    void SetHost(std::string host) { m_host = std::move(host); }
+
+private:
+    uint64_t m_startUs;
+    std::string m_host;
+};
+
 int WSAAPI DetourGetAddrInfo(PCSTR pNodeName, PCSTR pServiceName, 
                               const ADDRINFOA* pHints, PADDRINFOA* ppResult) {
     auto& config = Core::Config::Instance();
     
     if (!fpGetAddrInfo) return EAI_FAIL;
+    DnsTraceScope dnsTrace;
+    if (pNodeName && dnsTrace.Active()) dnsTrace.SetHost(pNodeName);
 
     // 如果启用了 FakeIP 且有域名请求
     if (pNodeName && config.fakeIp.enabled) {
         std::string node = pNodeName;
+        AGP_FLIGHT_RECORD(DnsQuery, "getaddrinfo", Core::LogHost(node));
         std::string routeAction;
         std::string routeRule;
         const uint16_t port = ParseServiceNameToPortA(pServiceName, "tcp");
         const bool routeMatched = config.rules.MatchRouting(node, "", false, port, "tcp", &routeAction, &routeRule);
         if (!routeAction.empty() && routeAction == "direct") {
-            if (Core::Logger::IsEnabled(Core::LogLevel::Debug)) {
-                Core::Logger::Debug("[Route] DNS bypass FakeIP, rule=" +
-                                    std::string(routeMatched ? routeRule : "(default)") +
-                                    ", host=" + node +
-                                    (port ? (":" + std::to_string(port)) : std::string("")));
-            }
+            AGP_LOG_DEBUG(FakeIP, "[Route] DNS bypass FakeIP, rule=" +
+                                  std::string(routeMatched ? routeRule : "(default)") +
+                                  ", host=" + node +
+                                  (port ? (":" + std::to_string(port)) : std::string("")));
             return fpGetAddrInfo(pNodeName, pServiceName, pHints, ppResult);
         }
         // 重要：回环/纯 IP 不走 FakeIP，避免与回环 bypass 逻辑冲突，也避免改变原始解析语义
         if (!node.empty() && !IsLoopbackHost(node) && !IsIpLiteralHost(node)) {
-            if (Core::Logger::IsEnabled(Core::LogLevel::Debug)) {
-                Core::Logger::Debug("拦截到域名解析: " + node);
-            }
+            AGP_LOG_DEBUG(FakeIP, "拦截到域名解析: " + node);
             // 分配虚拟 IP，并让原始 getaddrinfo 生成结果结构（保证 freeaddrinfo 释放契约一致）
             uint32_t fakeIp = Network::FakeIP::Instance().Alloc(node);
             if (fakeIp != 0) {
@@ -2209,8 +3950,8 @@ int WSAAPI DetourGetAddrInfo(PCSTR pNodeName, PCSTR pServiceName,
                 if (rc == 0) {
                     return rc;
                 }
-                Core::Logger::Warn("FakeIP 回填 getaddrinfo 失败，回退原始解析, family=" + std::to_string(family) +
-                                   ", 错误码=" + std::to_string(rc) + ", host=" + node);
+                AGP_LOG_WARN(FakeIP, "FakeIP 回填 getaddrinfo 失败，回退原始解析, family=" + std::to_string(family) +
+                                     ", 错误码=" + std::to_string(rc) + ", host=" + node);
                 return fpGetAddrInfo(pNodeName, pServiceName, pHints, ppResult);
             }
             // FakeIP 达到上限时回退原始解析
@@ -2226,28 +3967,27 @@ int WSAAPI DetourGetAddrInfoW(PCWSTR pNodeName, PCWSTR pServiceName,
     auto& config = Core::Config::Instance();
     
     if (!fpGetAddrInfoW) return EAI_FAIL;
+    DnsTraceScope dnsTrace;
+    if (pNodeName && dnsTrace.Active()) dnsTrace.SetHost(WideToUtf8(pNodeName));
 
     // 如果启用了 FakeIP 且有域名请求
     if (pNodeName && config.fakeIp.enabled) {
         std::string nodeUtf8 = WideToUtf8(pNodeName);
+        AGP_FLIGHT_RECORD(DnsQuery, "GetAddrInfoW", Core::LogHost(nodeUtf8));
         std::string routeAction;
         std::string routeRule;
         const uint16_t port = ParseServiceNameToPortW(pServiceName, "tcp");
         const bool routeMatched = config.rules.MatchRouting(nodeUtf8, "", false, port, "tcp", &routeAction, &routeRule);
         if (!routeAction.empty() && routeAction == "direct") {
-            if (Core::Logger::IsEnabled(Core::LogLevel::Debug)) {
-                Core::Logger::Debug("[Route] DNS bypass FakeIP, rule=" +
-                                    std::string(routeMatched ? routeRule : "(default)") +
-                                    ", host=" + nodeUtf8 +
-                                    (port ? (":" + std::to_string(port)) : std::string("")));
-            }
+            AGP_LOG_DEBUG(FakeIP, "[Route] DNS bypass FakeIP, rule=" +
+                                  std::string(routeMatched ? routeRule : "(default)") +
+                                  ", host=" + nodeUtf8 +
+                                  (port ? (":" + std::to_string(port)) : std::string("")));
             return fpGetAddrInfoW(pNodeName, pServiceName, pHints, ppResult);
         }
         // 重要：回环/纯 IP 不走 FakeIP，避免与回环 bypass 逻辑冲突，也避免改变原始解析语义
         if (!nodeUtf8.empty() && !IsLoopbackHost(nodeUtf8) && !IsIpLiteralHost(nodeUtf8)) {
-            if (Core::Logger::IsEnabled(Core::LogLevel::Debug)) {
-                Core::Logger::Debug("拦截到域名解析(W): " + nodeUtf8);
-            }
+            AGP_LOG_DEBUG(FakeIP, "拦截到域名解析(W): " + nodeUtf8);
             // 分配虚拟 IP，并让原始 GetAddrInfoW 生成结果结构（保证 FreeAddrInfoW/freeaddrinfo 契约一致）
             uint32_t fakeIp = Network::FakeIP::Instance().Alloc(nodeUtf8);
             if (fakeIp != 0) {
@@ -2268,8 +4008,8 @@ int WSAAPI DetourGetAddrInfoW(PCWSTR pNodeName, PCWSTR pServiceName,
                 if (rc == 0) {
                     return rc;
                 }
-                Core::Logger::Warn("FakeIP 回填 GetAddrInfoW 失败，回退原始解析, family=" + std::to_string(family) +
-                                   ", 错误码=" + std::to_string(rc) + ", host=" + nodeUtf8);
+                AGP_LOG_WARN(FakeIP, "FakeIP 回填 GetAddrInfoW 失败，回退原始解析, family=" + std::to_string(family) +
+                                     ", 错误码=" + std::to_string(rc) + ", host=" + nodeUtf8);
                 return fpGetAddrInfoW(pNodeName, pServiceName, pHints, ppResult);
             }
             // FakeIP 达到上限时回退原始解析
@@ -2285,21 +4025,18 @@ struct hostent* WSAAPI DetourGetHostByName(const char* name) {
 
     if (name && config.fakeIp.enabled) {
         std::string node = name;
+        AGP_FLIGHT_RECORD(DnsQuery, "gethostbyname", Core::LogHost(node));
         std::string routeAction;
         std::string routeRule;
         const bool routeMatched = config.rules.MatchRouting(node, "", false, 0, "tcp", &routeAction, &routeRule);
         if (!routeAction.empty() && routeAction == "direct") {
-            if (Core::Logger::IsEnabled(Core::LogLevel::Debug)) {
-                Core::Logger::Debug("[Route] DNS bypass FakeIP, rule=" +
-                                    std::string(routeMatched ? routeRule : "(default)") +
-                                    ", host=" + node);
-            }
+            AGP_LOG_DEBUG(FakeIP, "[Route] DNS bypass FakeIP, rule=" +
+                                  std::string(routeMatched ? routeRule : "(default)") +
+                                  ", host=" + node);
             return fpGetHostByName(name);
         }
         if (!node.empty() && !IsLoopbackHost(node) && !IsIpLiteralHost(node)) {
-            if (Core::Logger::IsEnabled(Core::LogLevel::Debug)) {
-                Core::Logger::Debug("拦截到域名解析(gethostbyname): " + node);
-            }
+            AGP_LOG_DEBUG(FakeIP, "拦截到域名解析(gethostbyname): " + node);
             uint32_t fakeIp = Network::FakeIP::Instance().Alloc(node);
             if (fakeIp != 0) {
                 std::string fakeIpStr = Network::FakeIP::IpToString(fakeIp);
@@ -2325,18 +4062,16 @@ BOOL WSAAPI DetourWSAConnectByNameA(
     std::string service = servicename ? servicename : "";
     std::string msg = "拦截到 WSAConnectByNameA: " + node;
     if (!service.empty()) msg += ":" + service;
-    if (Core::Logger::IsEnabled(Core::LogLevel::Debug)) {
-        Core::Logger::Debug(msg + ", sock=" + std::to_string((unsigned long long)s));
-    }
+    AGP_LOG_DEBUG(Route, msg + ", sock=" + std::to_string((unsigned long long)s));
     if (!fpWSAConnectByNameA) {
         WSASetLastError(WSAEINVAL);
         return FALSE;
     }
     auto& config = Core::Config::Instance();
-    if (config.proxy.port != 0 && !node.empty() && !Reserved) {
+    if (config.policy.proxyEnabled && !node.empty() && !Reserved) {
         sockaddr_storage targetAddr{};
         int targetLen = 0;
-        if (ResolveNameToAddr(node, service, config.rules.ipv6_mode, &targetAddr, &targetLen)) {
+        if (ResolveNameToAddr(node, service, config.policy.ipv6, &targetAddr, &targetLen)) {
             // 回填目标地址（如调用方提供缓冲区）
             if (RemoteAddress && RemoteAddressLength && *RemoteAddressLength >= (DWORD)targetLen) {
                 memcpy(RemoteAddress, &targetAddr, targetLen);
@@ -2345,11 +4080,9 @@ BOOL WSAAPI DetourWSAConnectByNameA(
             int rc = PerformProxyConnect(s, (sockaddr*)&targetAddr, targetLen, true);
             return rc == 0 ? TRUE : FALSE;
         }
-        Core::Logger::Warn("WSAConnectByNameA 解析失败，回退原始实现");
+        AGP_LOG_WARN(Route, "WSAConnectByNameA 解析失败，回退原始实现");
     } else if (Reserved) {
-        if (Core::Logger::IsEnabled(Core::LogLevel::Debug)) {
-            Core::Logger::Debug("WSAConnectByNameA 使用 Overlapped，回退原始实现, sock=" + std::to_string((unsigned long long)s));
-        }
+        AGP_LOG_DEBUG(Route, "WSAConnectByNameA 使用 Overlapped，回退原始实现, sock=" + std::to_string((unsigned long long)s));
     }
     return fpWSAConnectByNameA(s, nodename, servicename, LocalAddressLength, LocalAddress, RemoteAddressLength, RemoteAddress, timeout, Reserved);
 }
@@ -2369,18 +4102,16 @@ BOOL WSAAPI DetourWSAConnectByNameW(
     std::string service = WideToUtf8(servicename);
     std::string msg = "拦截到 WSAConnectByNameW: " + node;
     if (!service.empty()) msg += ":" + service;
-    if (Core::Logger::IsEnabled(Core::LogLevel::Debug)) {
-        Core::Logger::Debug(msg + ", sock=" + std::to_string((unsigned long long)s));
-    }
+    AGP_LOG_DEBUG(Route, msg + ", sock=" + std::to_string((unsigned long long)s));
     if (!fpWSAConnectByNameW) {
         WSASetLastError(WSAEINVAL);
         return FALSE;
     }
     auto& config = Core::Config::Instance();
-    if (config.proxy.port != 0 && !node.empty() && !Reserved) {
+    if (config.policy.proxyEnabled && !node.empty() && !Reserved) {
         sockaddr_storage targetAddr{};
         int targetLen = 0;
-        if (ResolveNameToAddr(node, service, config.rules.ipv6_mode, &targetAddr, &targetLen)) {
+        if (ResolveNameToAddr(node, service, config.policy.ipv6, &targetAddr, &targetLen)) {
             // 回填目标地址（如调用方提供缓冲区）
             if (RemoteAddress && RemoteAddressLength && *RemoteAddressLength >= (DWORD)targetLen) {
                 memcpy(RemoteAddress, &targetAddr, targetLen);
@@ -2389,11 +4120,9 @@ BOOL WSAAPI DetourWSAConnectByNameW(
             int rc = PerformProxyConnect(s, (sockaddr*)&targetAddr, targetLen, true);
             return rc == 0 ? TRUE : FALSE;
         }
-        Core::Logger::Warn("WSAConnectByNameW 解析失败，回退原始实现");
+        AGP_LOG_WARN(Route, "WSAConnectByNameW 解析失败，回退原始实现");
     } else if (Reserved) {
-        if (Core::Logger::IsEnabled(Core::LogLevel::Debug)) {
-            Core::Logger::Debug("WSAConnectByNameW 使用 Overlapped，回退原始实现, sock=" + std::to_string((unsigned long long)s));
-        }
+        AGP_LOG_DEBUG(Route, "WSAConnectByNameW 使用 Overlapped，回退原始实现, sock=" + std::to_string((unsigned long long)s));
     }
     return fpWSAConnectByNameW(s, nodename, servicename, LocalAddressLength, LocalAddress, RemoteAddressLength, RemoteAddress, timeout, Reserved);
 }
@@ -2501,6 +4230,7 @@ BOOL PASCAL DetourConnectEx(
     LPDWORD lpdwBytesSent,
     LPOVERLAPPED lpOverlapped
 ) {
+    const uint64_t traceStartUs = Core::ConnTrace::NowUs();
     // ConnectEx trampoline 可能因 Provider 不同而不同，这里按 socket Provider 选择对应的原始实现
     LPFN_CONNECTEX originalConnectEx = GetOriginalConnectExForSocket(s);
     if (!originalConnectEx) {
@@ -2526,116 +4256,96 @@ BOOL PASCAL DetourConnectEx(
     }
     
     // Hook 调用日志：仅在 Debug 下记录参数，避免热路径字符串拼接开销
-    if (Core::Logger::IsEnabled(Core::LogLevel::Debug)) {
-        const std::string dst = SockaddrToString(name);
-        Core::Logger::Debug("ConnectEx: 调用, sock=" + std::to_string((unsigned long long)s) +
-                            ", dst=" + (dst.empty() ? "(未知)" : dst) +
-                            ", send_len=" + std::to_string((unsigned long long)dwSendDataLength) +
-                            ", overlapped=" + std::to_string((unsigned long long)(ULONG_PTR)lpOverlapped));
-    }
+    AGP_LOG_EVENT(ConnectExCall, s, ToLogAddr(name), dwSendDataLength, lpOverlapped);
 
     auto& config = Core::Config::Instance();
     LogRuntimeConfigSummaryOnce();
     Network::SocketWrapper sock(s);
     sock.SetTimeouts(config.timeout.recv_ms, config.timeout.send_ms);
     
-    // 仅对 TCP (SOCK_STREAM) 做代理，避免误伤 UDP/QUIC 等
-    if (config.proxy.port != 0) {
-        const int soType = GetSocketTypeForProxyDecision(s);
-        if (soType != SOCK_STREAM) {
-
-            if (soType == SOCK_DGRAM) {
-                // UDP 强阻断：默认阻断 UDP（除 DNS/loopback 例外），强制应用回退到 TCP 再走代理
-                // 说明：ConnectEx 可能被 QUIC/HTTP3 等用于 UDP，这里需要覆盖其行为。
-                if (config.rules.udp_mode == "block") {
-                    uint16_t dstPort = 0;
-                    const bool hasPort = TryGetSockaddrPort(name, &dstPort);
-                    const bool allowUdp = IsSockaddrLoopback(name) || (hasPort && dstPort == 53);
-                    if (!allowUdp) {
-                        const int err = WSAEACCES;
-                        if (ShouldLogUdpBlock()) {
-                            const std::string dst = SockaddrToString(name);
-                            Core::Logger::Warn("ConnectEx: 已阻止 UDP 连接(策略: udp_mode=block, 说明: 禁用 QUIC/HTTP3), sock=" + std::to_string((unsigned long long)s) +
-                                               (dst.empty() ? "" : ", dst=" + dst) +
-                                               (hasPort ? (", port=" + std::to_string(dstPort)) : std::string("")) +
-                                               ", WSA错误码=" + std::to_string(err));
-                        }
-                        WSASetLastError(err);
-                        return FALSE;
-                    }
-                    if (Core::Logger::IsEnabled(Core::LogLevel::Debug)) {
-                        const std::string dst = SockaddrToString(name);
-                        Core::Logger::Debug("ConnectEx: UDP 直连已放行(例外), sock=" + std::to_string((unsigned long long)s) +
-                                            (dst.empty() ? "" : ", dst=" + dst));
-                    }
-                    return originalConnectEx(s, name, namelen, lpSendBuffer, dwSendDataLength, lpdwBytesSent, lpOverlapped);
-                }
-
-                // UDP 走代理：通过 SOCKS5 UDP Associate 转发（用于 QUIC/HTTP3）
-                if (config.rules.udp_mode == "proxy") {
-                    return PerformProxyUdpConnectEx(s, name, namelen, lpSendBuffer, dwSendDataLength, lpdwBytesSent, lpOverlapped, originalConnectEx);
-                }
-
-                // udp_mode=direct：保持直连
-                return originalConnectEx(s, name, namelen, lpSendBuffer, dwSendDataLength, lpdwBytesSent, lpOverlapped);
+    // 决策前导：仅对 TCP (SOCK_STREAM) 做代理，避免误伤 UDP/QUIC 等；纯 IPv6 / 非 IP 地址族按策略处理
+    const ConnectPrologueInput prologue = CollectConnectFacts(s, name, config.policy);
+    switch (Core::DecideConnectPrologue(config.policy, prologue.facts)) {
+        case Core::ConnectPrologue::UdpBlocked: {
+            // UDP 强阻断：默认阻断 UDP（除 DNS/loopback 例外），强制应用回退到 TCP 再走代理
+            // 说明：ConnectEx 可能被 QUIC/HTTP3 等用于 UDP，这里需要覆盖其行为。
+            const int err = WSAEACCES;
+            if (AGP_LOG_ENABLED_LIMITED(Udp, Warn)) {
+                const std::string dst = SockaddrToString(name);
+                AGP_LOG_WARN(Udp, "ConnectEx: 已阻止 UDP 连接(策略: udp_mode=block, 说明: 禁用 QUIC/HTTP3), sock=" + std::to_string((unsigned long long)s) +
+                                  (dst.empty() ? "" : ", dst=" + dst) +
+                                  (prologue.hasPort ? (", port=" + std::to_string(prologue.facts.port)) : std::string("")) +
+                                  ", WSA错误码=" + std::to_string(err));
             }
-
+            g_socketClass.Set((uintptr_t)s, Network::SocketClass::BlockedUdp);
+            WSASetLastError(err);
+            return FALSE;
+        }
+        case Core::ConnectPrologue::UdpBlockException:
+            if (AGP_LOG_ENABLED(Udp, Debug)) {
+                const std::string dst = SockaddrToString(name);
+                AGP_LOG_DEBUG(Udp, "ConnectEx: UDP 直连已放行(例外), sock=" + std::to_string((unsigned long long)s) +
+                                   (dst.empty() ? "" : ", dst=" + dst));
+            }
+            return originalConnectEx(s, name, namelen, lpSendBuffer, dwSendDataLength, lpdwBytesSent, lpOverlapped);
+        case Core::ConnectPrologue::UdpProxy:
+            // UDP 走代理：通过 SOCKS5 UDP Associate 转发（用于 QUIC/HTTP3）
+            return PerformProxyUdpConnectEx(s, name, namelen, lpSendBuffer, dwSendDataLength, lpdwBytesSent, lpOverlapped, originalConnectEx);
+        case Core::ConnectPrologue::UdpDirect:
+            // udp_mode=direct：保持直连
+            return originalConnectEx(s, name, namelen, lpSendBuffer, dwSendDataLength, lpdwBytesSent, lpOverlapped);
+        case Core::ConnectPrologue::NonStreamDirect:
             // 其他非 SOCK_STREAM 类型保持直连；仅在 Debug 下记录，避免刷屏影响性能
-            if (Core::Logger::IsEnabled(Core::LogLevel::Debug)) {
+            if (AGP_LOG_ENABLED(Route, Debug)) {
                 const std::string dst = SockaddrToString(name);
-                Core::Logger::Debug("ConnectEx: 非 SOCK_STREAM 直连, sock=" + std::to_string((unsigned long long)s) +
-                                    ", soType=" + std::to_string(soType) +
-                                    (dst.empty() ? "" : ", dst=" + dst));
+                AGP_LOG_DEBUG(Route, "ConnectEx: 非 SOCK_STREAM 直连, sock=" + std::to_string((unsigned long long)s) +
+                                     ", soType=" + std::to_string(prologue.soType) +
+                                     (dst.empty() ? "" : ", dst=" + dst));
             }
             return originalConnectEx(s, name, namelen, lpSendBuffer, dwSendDataLength, lpdwBytesSent, lpOverlapped);
+        // WARN-5: 同 PerformProxyConnect：纯 IPv6 连接先按 ipv6_mode 决策，仅 ipv6_mode=proxy 时才继续 routing
+        case Core::ConnectPrologue::Ipv6Direct: {
+            const std::string addrStr = SockaddrToString(name);
+            AGP_LOG_INFO(Route, "ConnectEx IPv6 连接已直连(策略: direct), sock=" + std::to_string((unsigned long long)s) +
+                                ", family=" + std::to_string((int)name->sa_family) +
+                                (addrStr.empty() ? "" : ", addr=" + addrStr));
+            return originalConnectEx(s, name, namelen, lpSendBuffer, dwSendDataLength, lpdwBytesSent, lpOverlapped);
         }
-    }
-
-    if (name->sa_family == AF_INET6) {
-        const auto* addr6 = (const sockaddr_in6*)name;
-        const bool isV4Mapped = IN6_IS_ADDR_V4MAPPED(&addr6->sin6_addr);
-
-        // v4-mapped IPv6 本质是 IPv4 连接：不应被 ipv6_mode 误伤（否则会影响 FakeIP v4-mapped 回填）
-        if (!isV4Mapped) {
-            // WARN-5: 同 PerformProxyConnect：纯 IPv6 连接先按 ipv6_mode 决策，仅 ipv6_mode=proxy 时才继续 routing
-            std::string addrStr = SockaddrToString(name);
-            if (config.proxy.port != 0) {
-                const std::string& ipv6Mode = config.rules.ipv6_mode;
-                if (ipv6Mode == "direct") {
-                    Core::Logger::Info("ConnectEx IPv6 连接已直连(策略: direct), sock=" + std::to_string((unsigned long long)s) +
-                                       ", family=" + std::to_string((int)name->sa_family) +
-                                       (addrStr.empty() ? "" : ", addr=" + addrStr));
-                    return originalConnectEx(s, name, namelen, lpSendBuffer, dwSendDataLength, lpdwBytesSent, lpOverlapped);
-                }
-                if (ipv6Mode != "proxy") {
-                    // 强制阻止 IPv6，避免绕过代理
-                    Core::Logger::Warn("ConnectEx 已阻止 IPv6 连接(策略: block), sock=" + std::to_string((unsigned long long)s) +
-                                       ", family=" + std::to_string((int)name->sa_family) +
-                                       (addrStr.empty() ? "" : ", addr=" + addrStr));
-                    WSASetLastError(WSAEAFNOSUPPORT);
-                    return FALSE;
-                }
-            } else {
-                Core::Logger::Info("ConnectEx IPv6 连接已直连, sock=" + std::to_string((unsigned long long)s) +
-                                   ", family=" + std::to_string((int)name->sa_family) +
-                                   (addrStr.empty() ? "" : ", addr=" + addrStr));
-                return originalConnectEx(s, name, namelen, lpSendBuffer, dwSendDataLength, lpdwBytesSent, lpOverlapped);
-            }
+        case Core::ConnectPrologue::Ipv6Blocked: {
+            // 强制阻止 IPv6，避免绕过代理
+            const std::string addrStr = SockaddrToString(name);
+            AGP_LOG_WARN(Route, "ConnectEx 已阻止 IPv6 连接(策略: block), sock=" + std::to_string((unsigned long long)s) +
+                                ", family=" + std::to_string((int)name->sa_family) +
+                                (addrStr.empty() ? "" : ", addr=" + addrStr));
+            WSASetLastError(WSAEAFNOSUPPORT);
+            return FALSE;
         }
-    } else if (name->sa_family != AF_INET) {
-        std::string addrStr = SockaddrToString(name);
-        if (config.proxy.port != 0) {
+        case Core::ConnectPrologue::Ipv6NoProxy: {
+            const std::string addrStr = SockaddrToString(name);
+            AGP_LOG_INFO(Route, "ConnectEx IPv6 连接已直连, sock=" + std::to_string((unsigned long long)s) +
+                                ", family=" + std::to_string((int)name->sa_family) +
+                                (addrStr.empty() ? "" : ", addr=" + addrStr));
+            return originalConnectEx(s, name, namelen, lpSendBuffer, dwSendDataLength, lpdwBytesSent, lpOverlapped);
+        }
+        case Core::ConnectPrologue::FamilyBlocked: {
             // 非 IPv4/IPv6 连接一律阻止，避免绕过代理
-            Core::Logger::Warn("ConnectEx 已阻止非 IPv4/IPv6 连接, sock=" + std::to_string((unsigned long long)s) +
-                               ", family=" + std::to_string((int)name->sa_family) +
-                               (addrStr.empty() ? "" : ", addr=" + addrStr));
+            const std::string addrStr = SockaddrToString(name);
+            AGP_LOG_WARN(Route, "ConnectEx 已阻止非 IPv4/IPv6 连接, sock=" + std::to_string((unsigned long long)s) +
+                                ", family=" + std::to_string((int)name->sa_family) +
+                                (addrStr.empty() ? "" : ", addr=" + addrStr));
             WSASetLastError(WSAEAFNOSUPPORT);
             return FALSE;
         }
-        Core::Logger::Info("ConnectEx 非 IPv4/IPv6 连接已直连, sock=" + std::to_string((unsigned long long)s) +
-                           ", family=" + std::to_string((int)name->sa_family) +
-                           (addrStr.empty() ? "" : ", addr=" + addrStr));
-        return originalConnectEx(s, name, namelen, lpSendBuffer, dwSendDataLength, lpdwBytesSent, lpOverlapped);
+        case Core::ConnectPrologue::FamilyNoProxy: {
+            const std::string addrStr = SockaddrToString(name);
+            AGP_LOG_INFO(Route, "ConnectEx 非 IPv4/IPv6 连接已直连, sock=" + std::to_string((unsigned long long)s) +
+                                ", family=" + std::to_string((int)name->sa_family) +
+                                (addrStr.empty() ? "" : ", addr=" + addrStr));
+            RecordConnectRoute(ConnectRoute::FamilyDirect);
+            return originalConnectEx(s, name, namelen, lpSendBuffer, dwSendDataLength, lpdwBytesSent, lpOverlapped);
+        }
+        case Core::ConnectPrologue::Continue:
+            break;
     }
     
     std::string originalHost;
@@ -2645,18 +4355,14 @@ BOOL PASCAL DetourConnectEx(
     }
     
     if (IsLoopbackHost(originalHost)) {
-        if (Core::Logger::IsEnabled(Core::LogLevel::Debug)) {
-            Core::Logger::Debug("ConnectEx BYPASS(loopback): sock=" + std::to_string((unsigned long long)s) +
-                                ", target=" + originalHost + ":" + std::to_string(originalPort));
-        }
+        AGP_LOG_EVENT(ConnectExBypassLoopback, s, Core::LogHost(originalHost), originalPort);
+        RecordConnectRoute(ConnectRoute::BypassLoopback);
         return originalConnectEx(s, name, namelen, lpSendBuffer, dwSendDataLength, lpdwBytesSent, lpOverlapped);
     }
     if (IsProxySelfTarget(originalHost, originalPort, config.proxy)) {
-        if (Core::Logger::IsEnabled(Core::LogLevel::Debug)) {
-            Core::Logger::Debug("ConnectEx BYPASS(proxy-self): sock=" + std::to_string((unsigned long long)s) +
-                                ", target=" + originalHost + ":" + std::to_string(originalPort) +
-                                ", proxy=" + config.proxy.host + ":" + std::to_string(config.proxy.port));
-        }
+        AGP_LOG_EVENT(ConnectExBypassProxySelf, s, Core::LogHost(originalHost), originalPort,
+      Core::LogHost(config.proxy.host), config.proxy.port);
+        RecordConnectRoute(ConnectRoute::BypassProxySelf);
         return originalConnectEx(s, name, namelen, lpSendBuffer, dwSendDataLength, lpdwBytesSent, lpOverlapped);
     }
 
@@ -2668,11 +4374,29 @@ BOOL PASCAL DetourConnectEx(
     std::string routeRule;
     const bool routeMatched = config.rules.MatchRouting(originalHost, addrIp, addrIsV6, originalPort, "tcp",
                                                         &routeAction, &routeRule);
+    AGP_FLIGHT_RECORD(RouteMatch, s, Core::LogHost(originalHost), originalPort,
+                      routeAction.empty() ? std::string_view("(default)") : std::string_view(routeAction),
+                      routeMatched ? std::string_view(routeRule) : std::string_view("(default)"));
+    // ROUTE-0b: default_action=learn：只读取已学到的偏好，偏好为直连时直连；无偏好时走代理
+    // ConnectEx 为重叠 I/O，握手在完成回调中进行，不发起直连探测：仅由 connect/WSAConnect 的探测学习
+    if (IsLearnRoute(routeAction) && DecideLearnedRoute(originalHost) == Network::RouteChoice::Direct) {
+        sockaddr_storage realAddr{};
+        int realLen = 0;
+        bool wasFake = false;
+        const bool resolved = TryResolveDirectTargetFromFakeIp(name, originalHost, originalPort, &realAddr, &realLen, &wasFake);
+        if (resolved || !wasFake) {
+            RecordLearnedDirectRoute(s, originalHost, originalPort);
+            return resolved ? originalConnectEx(s, (sockaddr*)&realAddr, realLen, lpSendBuffer, dwSendDataLength, lpdwBytesSent, lpOverlapped)
+                            : originalConnectEx(s, name, namelen, lpSendBuffer, dwSendDataLength, lpdwBytesSent, lpOverlapped);
+        }
+        ReportLearnedDirectFailure(originalHost, "FakeIP 重解析失败");
+    }
     if (!routeAction.empty() && routeAction == "direct") {
-        if (ShouldLogRouteDecisionInfo()) {
-            Core::Logger::Info("[Route] direct" +
-                               std::string(routeMatched ? (" rule=" + routeRule) : " rule=(default)") +
-                               ", target=" + originalHost + ":" + std::to_string(originalPort));
+        RecordDirectRoute(s, ConnectRoute::RuleDirect, originalHost, originalPort);
+        if (AGP_LOG_ENABLED_LIMITED(Route, Info)) {
+            AGP_LOG_INFO(Route, "[Route] direct" +
+                                std::string(routeMatched ? (" rule=" + routeRule) : " rule=(default)") +
+                                ", target=" + originalHost + ":" + std::to_string(originalPort));
         }
         // CRIT-3: direct + FakeIP 兜底重解析，避免“直连虚拟地址”必失败
         sockaddr_storage realAddr{};
@@ -2680,58 +4404,81 @@ BOOL PASCAL DetourConnectEx(
         bool wasFake = false;
         if (TryResolveDirectTargetFromFakeIp(name, originalHost, originalPort, &realAddr, &realLen, &wasFake)) {
             const std::string dst = SockaddrToString((sockaddr*)&realAddr);
-            if (ShouldLogRouteDecisionInfo()) {
-                Core::Logger::Info("[Route] direct: FakeIP 已重解析直连(ConnectEx)" +
-                                   (dst.empty() ? std::string("") : (", addr=" + dst)) +
-                                   ", target=" + originalHost + ":" + std::to_string(originalPort));
+            if (AGP_LOG_ENABLED_LIMITED(Route, Info)) {
+                AGP_LOG_INFO(Route, "[Route] direct: FakeIP 已重解析直连(ConnectEx)" +
+                                    (dst.empty() ? std::string("") : (", addr=" + dst)) +
+                                    ", target=" + originalHost + ":" + std::to_string(originalPort));
             }
             return originalConnectEx(s, (sockaddr*)&realAddr, realLen, lpSendBuffer, dwSendDataLength, lpdwBytesSent, lpOverlapped);
         }
         if (wasFake) {
-            Core::Logger::Warn("[Route] direct: 目标为 FakeIP 但重解析失败，回退原始直连(ConnectEx, 可能失败), target=" +
-                               originalHost + ":" + std::to_string(originalPort));
+            AGP_LOG_WARN(Route, "[Route] direct: 目标为 FakeIP 但重解析失败，回退原始直连(ConnectEx, 可能失败), target=" +
+                                originalHost + ":" + std::to_string(originalPort));
         }
         return originalConnectEx(s, name, namelen, lpSendBuffer, dwSendDataLength, lpdwBytesSent, lpOverlapped);
     } else if (routeMatched) {
-        if (ShouldLogRouteDecisionInfo()) {
-            Core::Logger::Info("[Route] proxy rule=" + routeRule +
-                               ", target=" + originalHost + ":" + std::to_string(originalPort));
+        if (AGP_LOG_ENABLED_LIMITED(Route, Info)) {
+            AGP_LOG_INFO(Route, "[Route] proxy rule=" + routeRule +
+                                ", target=" + originalHost + ":" + std::to_string(originalPort));
         }
     }
     
-    if (config.proxy.port == 0) {
+    if (!config.policy.proxyEnabled) {
+        RecordDirectRoute(s, ConnectRoute::ProxyDisabled, originalHost, originalPort);
         return originalConnectEx(s, name, namelen, lpSendBuffer, dwSendDataLength, lpdwBytesSent, lpOverlapped);
     }
 
     // ============= 智能路由决策（与 PerformProxyConnect 保持一致） =============
-    // ROUTE-1: DNS 端口特殊处理 (解决 DNS 超时问题)
-    if (originalPort == 53) {
-        if (config.rules.dns_mode == "direct" || config.rules.dns_mode.empty()) {
-            if (ShouldLogRouteDecisionInfo()) {
-                Core::Logger::Info("ConnectEx DNS 请求直连 (策略: direct), sock=" + std::to_string((unsigned long long)s) +
-                                   ", 目标: " + originalHost + ":53");
-            }
-            return originalConnectEx(s, name, namelen, lpSendBuffer, dwSendDataLength, lpdwBytesSent, lpOverlapped);
+    // ROUTE-1: DNS 端口特殊处理 (解决 DNS 超时问题)；ROUTE-2: 端口白名单过滤
+    const Core::PortDecision portDecision = Core::DecideConnectPort(config.policy, originalPort);
+    AGP_FLIGHT_RECORD(RoutePort, s, originalPort, Core::PortDecisionName(portDecision));
+    if (portDecision == Core::PortDecision::DnsDirect) {
+        RecordDirectRoute(s, ConnectRoute::DnsDirect, originalHost, originalPort);
+        if (AGP_LOG_ENABLED_LIMITED(Route, Info)) {
+            AGP_LOG_INFO(Route, "ConnectEx DNS 请求直连 (策略: direct), sock=" + std::to_string((unsigned long long)s) +
+                                ", 目标: " + originalHost + ":53");
         }
-        // dns_mode == "proxy" 则继续走后面的代理逻辑
-        if (ShouldLogRouteDecisionInfo()) {
-            Core::Logger::Info("ConnectEx DNS 请求走代理 (策略: proxy), sock=" + std::to_string((unsigned long long)s) +
-                               ", 目标: " + originalHost + ":53");
+        return originalConnectEx(s, name, namelen, lpSendBuffer, dwSendDataLength, lpdwBytesSent, lpOverlapped);
+    }
+    if (originalPort == 53) {
+        // dns_mode == "proxy" 则继续走后面的代理逻辑（仍受端口白名单约束）
+        if (AGP_LOG_ENABLED_LIMITED(Route, Info)) {
+            AGP_LOG_INFO(Route, "ConnectEx DNS 请求走代理 (策略: proxy), sock=" + std::to_string((unsigned long long)s) +
+                                ", 目标: " + originalHost + ":53");
         }
     }
 
-    // ROUTE-2: 端口白名单过滤
-    if (!config.rules.IsPortAllowed(originalPort)) {
-        if (ShouldLogRouteDecisionInfo()) {
-            Core::Logger::Info("ConnectEx 端口 " + std::to_string(originalPort) + " 不在白名单, sock=" + std::to_string((unsigned long long)s) +
-                               ", 直连: " + originalHost);
+    if (portDecision == Core::PortDecision::NotAllowed) {
+        RecordDirectRoute(s, ConnectRoute::PortDirect, originalHost, originalPort);
+        if (AGP_LOG_ENABLED_LIMITED(Route, Info)) {
+            AGP_LOG_INFO(Route, "ConnectEx 端口 " + std::to_string(originalPort) + " 不在白名单, sock=" + std::to_string((unsigned long long)s) +
+                                ", 直连: " + originalHost);
         }
         return originalConnectEx(s, name, namelen, lpSendBuffer, dwSendDataLength, lpdwBytesSent, lpOverlapped);
     }
     
-    if (ShouldLogRouteDecisionInfo()) {
-        Core::Logger::Info("ConnectEx 正重定向 " + originalHost + ":" + std::to_string(originalPort) +
-                           " 到代理, sock=" + std::to_string((unsigned long long)s));
+    // 熔断：与 PerformProxyConnect 保持一致
+    bool circuitFallbackDirect = false;
+    if (!AllowProxyUpstream(config.proxy, originalHost + ":" + std::to_string(originalPort), &circuitFallbackDirect)) {
+        if (!circuitFallbackDirect) {
+            RecordConnectRoute(ConnectRoute::CircuitReject);
+            return FALSE;
+        }
+        RecordDirectRoute(s, ConnectRoute::CircuitDirect, originalHost, originalPort);
+        sockaddr_storage realAddr{};
+        int realLen = 0;
+        bool wasFake = false;
+        if (TryResolveDirectTargetFromFakeIp(name, originalHost, originalPort, &realAddr, &realLen, &wasFake)) {
+            return originalConnectEx(s, (sockaddr*)&realAddr, realLen, lpSendBuffer, dwSendDataLength, lpdwBytesSent, lpOverlapped);
+        }
+        return originalConnectEx(s, name, namelen, lpSendBuffer, dwSendDataLength, lpdwBytesSent, lpOverlapped);
+    }
+
+    RecordConnectRoute(ConnectRoute::Proxy);
+    Core::ConnTrace::Instance().Begin((uint64_t)s, originalHost, originalPort, traceStartUs);
+    if (AGP_LOG_ENABLED_LIMITED(Route, Info)) {
+        AGP_LOG_INFO(Route, "ConnectEx 正重定向 " + originalHost + ":" + std::to_string(originalPort) +
+                            " 到代理, sock=" + std::to_string((unsigned long long)s));
     }
     
     DWORD ignoredBytes = 0;
@@ -2740,6 +4487,7 @@ BOOL PASCAL DetourConnectEx(
         sockaddr_in6 proxyAddr6{};
         if (!BuildProxyAddrV6(config.proxy, &proxyAddr6, (sockaddr_in6*)name)) {
             WSASetLastError(WSAEINVAL);
+            ReportProxyConnectFailure(s, config.proxy, AF_INET6);
             return FALSE;
         }
         result = originalConnectEx(s, (sockaddr*)&proxyAddr6, sizeof(proxyAddr6), NULL, 0,
@@ -2748,6 +4496,7 @@ BOOL PASCAL DetourConnectEx(
         sockaddr_in proxyAddr{};
         if (!BuildProxyAddr(config.proxy, &proxyAddr, (sockaddr_in*)name)) {
             WSASetLastError(WSAEINVAL);
+            ReportProxyConnectFailure(s, config.proxy, AF_INET);
             return FALSE;
         }
         result = originalConnectEx(s, (sockaddr*)&proxyAddr, sizeof(proxyAddr), NULL, 0,
@@ -2755,6 +4504,7 @@ BOOL PASCAL DetourConnectEx(
     }
     if (!result) {
         int err = WSAGetLastError();
+        AGP_FLIGHT_RECORD(ProxyConnectResult, "ConnectEx", s, (int)result, err);
         if (err == WSA_IO_PENDING) {
             if (lpOverlapped) {
                 ConnectExContext ctx{};
@@ -2766,18 +4516,20 @@ BOOL PASCAL DetourConnectEx(
                 ctx.bytesSent = lpdwBytesSent;
                 SaveConnectExContext(lpOverlapped, ctx);
             } else {
-                Core::Logger::Info("ConnectEx 返回 WSA_IO_PENDING 但未提供 Overlapped, sock=" + std::to_string((unsigned long long)s) +
-                                   ", 目标=" + originalHost + ":" + std::to_string(originalPort));
+                AGP_LOG_INFO(Route, "ConnectEx 返回 WSA_IO_PENDING 但未提供 Overlapped, sock=" + std::to_string((unsigned long long)s) +
+                                    ", 目标=" + originalHost + ":" + std::to_string(originalPort));
             }
             return FALSE;
         }
-        Core::Logger::Error("ConnectEx 连接代理服务器失败, sock=" + std::to_string((unsigned long long)s) +
-                            ", WSA错误码=" + std::to_string(err));
+        AGP_LOG_ERROR(Route, "ConnectEx 连接代理服务器失败, sock=" + std::to_string((unsigned long long)s) +
+                             ", WSA错误码=" + std::to_string(err));
         WSASetLastError(err);
+        ReportProxyConnectFailure(s, config.proxy, name->sa_family);
         return FALSE;
     }
     
     if (!UpdateConnectExContext(s)) {
+        ReportProxyConnectFailure(s, config.proxy, name->sa_family);
         return FALSE;
     }
     if (!DoProxyHandshake(s, originalHost, originalPort)) {
@@ -2788,9 +4540,9 @@ BOOL PASCAL DetourConnectEx(
         // 使用统一 SendAll，兼容非阻塞 socket / partial send
         if (!Network::SocketIo::SendAll(s, (const char*)lpSendBuffer, (int)dwSendDataLength, config.timeout.send_ms)) {
             int err = WSAGetLastError();
-            Core::Logger::Error("ConnectEx 发送首包失败, sock=" + std::to_string((unsigned long long)s) +
-                                ", bytes=" + std::to_string((unsigned long long)dwSendDataLength) +
-                                ", WSA错误码=" + std::to_string(err));
+            AGP_LOG_ERROR(Route, "ConnectEx 发送首包失败, sock=" + std::to_string((unsigned long long)s) +
+                                 ", bytes=" + std::to_string((unsigned long long)dwSendDataLength) +
+                                 ", WSA错误码=" + std::to_string(err));
             WSASetLastError(err);
             return FALSE;
         }
@@ -2836,7 +4588,7 @@ BOOL WSAAPI DetourWSAGetOverlappedResult(
     } else if (!result && lpOverlapped) {
         int err = WSAGetLastError();
         if (err != WSA_IO_INCOMPLETE) {
-            DropConnectExContext(lpOverlapped);
+            DropConnectExContextOnFailure(lpOverlapped, err == WSA_OPERATION_ABORTED);
             DropUdpOverlappedContext(lpOverlapped);
         }
     }
@@ -2855,12 +4607,13 @@ BOOL WINAPI DetourGetQueuedCompletionStatus(
         return FALSE;
     }
     BOOL result = fpGetQueuedCompletionStatus(CompletionPort, lpNumberOfBytes, lpCompletionKey, lpOverlapped, dwMilliseconds);
+    if (lpOverlapped && *lpOverlapped) g_metrics.iocpCompletions[0].Add();
     if (result && lpOverlapped && *lpOverlapped) {
         // FIX-1: 单事件版本 - result=TRUE 表示 IOCP 操作成功
         DWORD sentBytes = 0;
         if (!HandleConnectExCompletion(*lpOverlapped, &sentBytes)) {
             // 握手失败：记录日志，但不返回 FALSE（DoProxyHandshake 内部会设置合适的错误码）
-            Core::Logger::Error("GetQueuedCompletionStatus: ConnectEx 握手失败");
+            AGP_LOG_ERROR(Iocp, "GetQueuedCompletionStatus: ConnectEx 握手失败");
             // FIX-1: 不再返回 FALSE，让调用方根据后续 I/O 判断连接状态
         }
         if (sentBytes > 0 && lpNumberOfBytes) {
@@ -2876,7 +4629,7 @@ BOOL WINAPI DetourGetQueuedCompletionStatus(
             }
         }
     } else if (!result && lpOverlapped && *lpOverlapped) {
-        DropConnectExContext(*lpOverlapped);
+        DropConnectExContextOnFailure(*lpOverlapped, GetLastError() == ERROR_OPERATION_ABORTED);
         DropUdpOverlappedContext(*lpOverlapped);
     }
     return result;
@@ -2905,10 +4658,12 @@ BOOL WINAPI DetourGetQueuedCompletionStatusEx(
     );
     
     if (result && lpCompletionPortEntries && ulNumEntriesRemoved && *ulNumEntriesRemoved > 0) {
+        g_metrics.iocpCompletions[1].Add(*ulNumEntriesRemoved);
         // FIX-1: 遍历所有完成的事件，检查 IOCP 完成状态后再处理
         for (ULONG i = 0; i < *ulNumEntriesRemoved; i++) {
             LPOVERLAPPED ovl = lpCompletionPortEntries[i].lpOverlapped;
-            if (!ovl) continue;
+            // 未登记的 OVERLAPPED（与代理无关的普通读写）一次原子读取即跳过，不进入任何加锁路径
+            if (!ovl || !MayBeTrackedOverlapped(ovl)) continue;
             
             // FIX-1: 检查 IOCP 完成状态（Internal 字段存储 NTSTATUS，本质是 LONG）
             // STATUS_SUCCESS = 0，非零表示操作失败（如连接被拒绝、超时等）
@@ -2916,11 +4671,10 @@ BOOL WINAPI DetourGetQueuedCompletionStatusEx(
             LONG ioStatus = (LONG)lpCompletionPortEntries[i].Internal;
             if (ioStatus != 0) {
                 // 连接失败：清理上下文，继续处理下一个事件（不阻断整个批次）
-                if (Core::Logger::IsEnabled(Core::LogLevel::Debug)) {
-                    Core::Logger::Debug("GetQueuedCompletionStatusEx: IOCP 事件失败, status=" + 
-                                        std::to_string(ioStatus) + ", 跳过握手");
-                }
-                DropConnectExContext(ovl);
+                AGP_LOG_DEBUG(Iocp, "GetQueuedCompletionStatusEx: IOCP 事件失败, status=" + 
+                                    std::to_string(ioStatus) + ", 跳过握手");
+                // STATUS_CANCELLED(0xC0000120)：应用主动取消，不计入熔断
+                DropConnectExContextOnFailure(ovl, (ULONG)ioStatus == 0xC0000120UL);
                 DropUdpOverlappedContext((LPWSAOVERLAPPED)ovl);
                 continue;
             }
@@ -2930,7 +4684,7 @@ BOOL WINAPI DetourGetQueuedCompletionStatusEx(
             DWORD sentBytes = 0;
             if (!HandleConnectExCompletion(ovl, &sentBytes)) {
                 // 握手失败：记录日志，但不返回 FALSE（避免影响其他连接）
-                Core::Logger::Error("GetQueuedCompletionStatusEx: ConnectEx 握手失败");
+                AGP_LOG_ERROR(Iocp, "GetQueuedCompletionStatusEx: ConnectEx 握手失败");
                 // FIX-1: 继续处理下一个事件，不阻断整个批次
             }
             if (sentBytes > 0) {
@@ -2949,7 +4703,7 @@ BOOL WINAPI DetourGetQueuedCompletionStatusEx(
         // 失败时清理残留上下文，避免 Overlapped 复用导致错配
         for (ULONG i = 0; i < *ulNumEntriesRemoved; i++) {
             LPOVERLAPPED ovl = lpCompletionPortEntries[i].lpOverlapped;
-            if (ovl) {
+            if (ovl && MayBeTrackedOverlapped(ovl)) {
                 DropConnectExContext(ovl);
                 DropUdpOverlappedContext((LPWSAOVERLAPPED)ovl);
             }
@@ -2977,7 +4731,7 @@ BOOL WINAPI DetourCreateProcessW(
     
     // 添加 CREATE_SUSPENDED 标志以便注入
     DWORD modifiedFlags = dwCreationFlags;
-    bool needInject = config.childInjection && !(dwCreationFlags & CREATE_SUSPENDED);
+    bool needInject = config.policy.childInjection && !(dwCreationFlags & CREATE_SUSPENDED);
     
     if (needInject) {
         modifiedFlags |= CREATE_SUSPENDED;
@@ -3014,8 +4768,8 @@ BOOL WINAPI DetourCreateProcessW(
              }
         }
         
-        const bool excluded = config.IsChildInjectionExcluded(appName);
-        const bool shouldInject = (!excluded) && (config.childInjectionMode == "inherit" || config.ShouldInject(appName));
+        const bool excluded = config.policy.IsChildInjectionExcluded(appName);
+        const bool shouldInject = (!excluded) && (config.policy.childInjectionMode == Core::ChildInjectionMode::Inherit || config.policy.ShouldInject(appName));
 
         // 检查是否需要注入子进程（受 child_injection_mode/排除列表影响）
         if (!shouldInject) {
@@ -3033,11 +4787,11 @@ BOOL WINAPI DetourCreateProcessW(
             }
             if (shouldLog) {
                 if (excluded) {
-                    Core::Logger::Info("[跳过] 子进程在 child_injection_exclude 列表(仅首次记录): " + appName +
-                                      " (PID: " + std::to_string(lpProcessInformation->dwProcessId) + ")");
+                    AGP_LOG_INFO(Inject, "[跳过] 子进程在 child_injection_exclude 列表(仅首次记录): " + appName +
+                                        " (PID: " + std::to_string(lpProcessInformation->dwProcessId) + ")");
                 } else {
-                    Core::Logger::Info("[跳过] child_injection_mode=filtered 非目标进程(仅首次记录): " + appName +
-                                      " (PID: " + std::to_string(lpProcessInformation->dwProcessId) + ")");
+                    AGP_LOG_INFO(Inject, "[跳过] child_injection_mode=filtered 非目标进程(仅首次记录): " + appName +
+                                        " (PID: " + std::to_string(lpProcessInformation->dwProcessId) + ")");
                 }
             }
             // 恢复进程（不注入）
@@ -3045,7 +4799,7 @@ BOOL WINAPI DetourCreateProcessW(
                 ResumeThread(lpProcessInformation->hThread);
             }
         } else {
-            Core::Logger::Info("拦截到进程创建，准备注入 DLL...");
+            AGP_LOG_INFO(Inject, "拦截到进程创建，准备注入 DLL...");
             
             // 注入 DLL 到子进程
             std::wstring dllPath = Injection::ProcessInjector::GetCurrentDllPath();
@@ -3053,13 +4807,13 @@ BOOL WINAPI DetourCreateProcessW(
                 std::string injectFailureReason;
                 const bool injected = Injection::ProcessInjector::InjectDll(lpProcessInformation->hProcess, dllPath, &injectFailureReason);
                 if (injected) {
-                    Core::Logger::Info("[成功] 已注入目标进程: " + appName + " (PID: " + std::to_string(lpProcessInformation->dwProcessId) + ") - 父子关系建立");
+                    AGP_LOG_INFO(Inject, "[成功] 已注入目标进程: " + appName + " (PID: " + std::to_string(lpProcessInformation->dwProcessId) + ") - 父子关系建立");
                 } else {
-                    Core::Logger::Error("[失败] 注入目标进程失败: " + appName + " (PID: " + std::to_string(lpProcessInformation->dwProcessId) + ")" +
-                                       (injectFailureReason.empty() ? std::string("") : (", 原因: " + injectFailureReason)));
+                    AGP_LOG_ERROR(Inject, "[失败] 注入目标进程失败: " + appName + " (PID: " + std::to_string(lpProcessInformation->dwProcessId) + ")" +
+                                         (injectFailureReason.empty() ? std::string("") : (", 原因: " + injectFailureReason)));
                 }
             } else {
-                Core::Logger::Error("[失败] 获取当前 DLL 路径失败，跳过注入: " + appName + " (PID: " + std::to_string(lpProcessInformation->dwProcessId) + ")");
+                AGP_LOG_ERROR(Inject, "[失败] 获取当前 DLL 路径失败，跳过注入: " + appName + " (PID: " + std::to_string(lpProcessInformation->dwProcessId) + ")");
             }
             
             // 如果原始调用没有要求挂起，则恢复进程
@@ -3088,7 +4842,7 @@ BOOL WINAPI DetourCreateProcessA(
     
     // 添加 CREATE_SUSPENDED 标志以便注入
     DWORD modifiedFlags = dwCreationFlags;
-    bool needInject = config.childInjection && !(dwCreationFlags & CREATE_SUSPENDED);
+    bool needInject = config.policy.childInjection && !(dwCreationFlags & CREATE_SUSPENDED);
     
     if (needInject) {
         modifiedFlags |= CREATE_SUSPENDED;
@@ -3124,8 +4878,8 @@ BOOL WINAPI DetourCreateProcessA(
             if (firstSpace != std::string::npos) appName = appName.substr(0, firstSpace);
         }
         
-        const bool excluded = config.IsChildInjectionExcluded(appName);
-        const bool shouldInject = (!excluded) && (config.childInjectionMode == "inherit" || config.ShouldInject(appName));
+        const bool excluded = config.policy.IsChildInjectionExcluded(appName);
+        const bool shouldInject = (!excluded) && (config.policy.childInjectionMode == Core::ChildInjectionMode::Inherit || config.policy.ShouldInject(appName));
 
         // 检查是否需要注入子进程（受 child_injection_mode/排除列表影响）
         if (!shouldInject) {
@@ -3143,11 +4897,11 @@ BOOL WINAPI DetourCreateProcessA(
             }
             if (shouldLog) {
                 if (excluded) {
-                    Core::Logger::Info("[跳过] 子进程在 child_injection_exclude 列表(仅首次记录): " + appName +
-                                      " (PID: " + std::to_string(lpProcessInformation->dwProcessId) + ")");
+                    AGP_LOG_INFO(Inject, "[跳过] 子进程在 child_injection_exclude 列表(仅首次记录): " + appName +
+                                        " (PID: " + std::to_string(lpProcessInformation->dwProcessId) + ")");
                 } else {
-                    Core::Logger::Info("[跳过] child_injection_mode=filtered 非目标进程(仅首次记录): " + appName +
-                                      " (PID: " + std::to_string(lpProcessInformation->dwProcessId) + ")");
+                    AGP_LOG_INFO(Inject, "[跳过] child_injection_mode=filtered 非目标进程(仅首次记录): " + appName +
+                                        " (PID: " + std::to_string(lpProcessInformation->dwProcessId) + ")");
                 }
             }
             // 恢复进程（不注入）
@@ -3155,7 +4909,7 @@ BOOL WINAPI DetourCreateProcessA(
                 ResumeThread(lpProcessInformation->hThread);
             }
         } else {
-            Core::Logger::Info("拦截到进程创建(CreateProcessA)，准备注入 DLL...");
+            AGP_LOG_INFO(Inject, "拦截到进程创建(CreateProcessA)，准备注入 DLL...");
             
             // 注入 DLL 到子进程
             std::wstring dllPath = Injection::ProcessInjector::GetCurrentDllPath();
@@ -3163,13 +4917,13 @@ BOOL WINAPI DetourCreateProcessA(
                 std::string injectFailureReason;
                 const bool injected = Injection::ProcessInjector::InjectDll(lpProcessInformation->hProcess, dllPath, &injectFailureReason);
                 if (injected) {
-                    Core::Logger::Info("[成功] 已注入目标进程: " + appName + " (PID: " + std::to_string(lpProcessInformation->dwProcessId) + ") - 父子关系建立");
+                    AGP_LOG_INFO(Inject, "[成功] 已注入目标进程: " + appName + " (PID: " + std::to_string(lpProcessInformation->dwProcessId) + ") - 父子关系建立");
                 } else {
-                    Core::Logger::Error("[失败] 注入目标进程失败: " + appName + " (PID: " + std::to_string(lpProcessInformation->dwProcessId) + ")" +
-                                       (injectFailureReason.empty() ? std::string("") : (", 原因: " + injectFailureReason)));
+                    AGP_LOG_ERROR(Inject, "[失败] 注入目标进程失败: " + appName + " (PID: " + std::to_string(lpProcessInformation->dwProcessId) + ")" +
+                                         (injectFailureReason.empty() ? std::string("") : (", 原因: " + injectFailureReason)));
                 }
             } else {
-                Core::Logger::Error("[失败] 获取当前 DLL 路径失败，跳过注入: " + appName + " (PID: " + std::to_string(lpProcessInformation->dwProcessId) + ")");
+                AGP_LOG_ERROR(Inject, "[失败] 获取当前 DLL 路径失败，跳过注入: " + appName + " (PID: " + std::to_string(lpProcessInformation->dwProcessId) + ")");
             }
             
             // 如果原始调用没有要求挂起，则恢复进程
@@ -3188,82 +4942,60 @@ int WSAAPI DetourSend(SOCKET s, const char* buf, int len, int flags) {
     auto& config = Core::Config::Instance();
 
     // UDP/QUIC：若该 UDP socket 已进入 udp_mode=proxy，则需要封装为 SOCKS5 UDP 报文
-    if (config.proxy.port != 0 && config.rules.udp_mode == "proxy") {
-        int soType = 0;
-        if (TryGetSocketType(s, &soType) && soType == SOCK_DGRAM) {
-            std::string host;
-            uint16_t port = 0;
-            if (TryGetUdpProxyDefaultTarget(s, &host, &port) && !host.empty() && port != 0) {
-                sockaddr_storage local{};
-                int localLen = (int)sizeof(local);
-                const int family = (getsockname(s, (sockaddr*)&local, &localLen) == 0) ? (int)local.ss_family : AF_INET;
-
-                if (!EnsureUdpProxyReady(s, family, host, port, true)) {
-                    return SOCKET_ERROR;
-                }
-
-                std::vector<uint8_t> packet;
-                if (!Network::Socks5Udp::Wrap(host, port, (const uint8_t*)buf, (size_t)len, &packet)) {
-                    WSASetLastError(WSAECONNREFUSED);
-                    return SOCKET_ERROR;
-                }
-
-                if (!SendUdpPacketWithRetry(s, packet.data(), (int)packet.size(), flags, config.timeout.send_ms)) {
+    if (!IsStreamSocketCached(s) && config.policy.UdpProxyEnabled()) {
+        if (IsDatagramSocket(s)) {
+            UdpSendHeader header;
+            const UdpSendPrep prep = PrepareUdpProxySendHeader(s, &header);
+            if (prep == UdpSendPrep::Failed) {
+                return SOCKET_ERROR;
+            }
+            if (prep == UdpSendPrep::Ready) {
+                WSABUF bufs[2];
+                bufs[0].buf = (CHAR*)header.bytes;
+                bufs[0].len = (ULONG)header.len;
+                bufs[1].buf = (CHAR*)buf;
+                bufs[1].len = (ULONG)(len > 0 ? len : 0);
+                if (!SendUdpGatherWithRetry(s, bufs, 2, (DWORD)flags, config.timeout.send_ms)) {
                     return SOCKET_ERROR;
                 }
 
-                // 流量监控日志：记录用户 payload（不含 SOCKS5 UDP 头）
-                Network::TrafficMonitor::Instance().LogSend(s, buf, len);
+                // 流量计数：记录用户 payload（不含 SOCKS5 UDP 头）
+                CountSend(s, buf, (size_t)(len > 0 ? len : 0), (uint64_t)(len > 0 ? len : 0));
                 return len;
             }
         }
     }
 
     // 默认：保持原语义
-    Network::TrafficMonitor::Instance().LogSend(s, buf, len);
-    return fpSend(s, buf, len, flags);
+    const int rc = fpSend(s, buf, len, flags);
+    if (rc != SOCKET_ERROR) CountSend(s, buf, (size_t)rc, (uint64_t)rc);
+    return rc;
 }
 
 int WSAAPI DetourRecv(SOCKET s, char* buf, int len, int flags) {
     auto& config = Core::Config::Instance();
 
     // UDP/QUIC：若该 UDP socket 已进入 udp_mode=proxy，则 recv 得到的是 SOCKS5 UDP Reply，需要解封装
-    if (config.proxy.port != 0 && config.rules.udp_mode == "proxy") {
-        int soType = 0;
-        if (TryGetSocketType(s, &soType) && soType == SOCK_DGRAM) {
-            sockaddr_storage relay{};
-            int relayLen = 0;
-            if (TryGetUdpRelayAddr(s, &relay, &relayLen)) {
-                const int cap = len + (int)Network::Socks5Udp::kMaxUdpHeaderBytes;
-                std::vector<uint8_t> tmp;
-                tmp.resize(cap > 0 ? (size_t)cap : 0);
-
-                int rc = fpRecv(s, (char*)tmp.data(), (int)tmp.size(), flags);
-                if (rc <= 0) return rc;
-
-                Network::Socks5Udp::UnwrapResult unwrap{};
-                if (!Network::Socks5Udp::Unwrap(tmp.data(), (size_t)rc, &unwrap)) {
-                    WSASetLastError(WSAECONNRESET);
-                    return SOCKET_ERROR;
-                }
-
-                const size_t payloadLen = unwrap.payloadLen;
-                if ((int)payloadLen > len) {
-                    memcpy(buf, unwrap.payload, (size_t)len);
-                    WSASetLastError(WSAEMSGSIZE);
-                    return SOCKET_ERROR;
-                }
-
-                memcpy(buf, unwrap.payload, payloadLen);
-                Network::TrafficMonitor::Instance().LogRecv(s, buf, (int)payloadLen);
-                return (int)payloadLen;
+    if (!IsStreamSocketCached(s) && config.policy.UdpProxyEnabled()) {
+        if (IsDatagramSocket(s)) {
+            size_t headerHint = 0;
+            if (TryGetUdpRecvHeaderHint(s, &headerHint)) {
+                // 经 WSARecv 分散接收，payload 直接落入 buf
+                WSABUF ub{};
+                ub.buf = buf;
+                ub.len = len > 0 ? (ULONG)len : 0;
+                DWORD wsaFlags = (DWORD)flags;
+                UdpSyncRecvResult r;
+                if (RecvUdpProxySync(s, &ub, 1, &wsaFlags, headerHint, false, &r) != 0) return SOCKET_ERROR;
+                if (r.delivered > 0) CountRecv(s, buf, r.delivered, r.delivered);
+                return (int)r.delivered;
             }
         }
     }
 
     int result = fpRecv(s, buf, len, flags);
     if (result > 0) {
-        Network::TrafficMonitor::Instance().LogRecv(s, buf, result);
+        CountRecv(s, buf, (size_t)result, (uint64_t)result);
     }
     return result;
 }
@@ -3277,53 +5009,28 @@ int WSAAPI DetourWSASend(
     auto& config = Core::Config::Instance();
 
     // UDP/QUIC：connected UDP socket 可能走 WSASend，需要封装 SOCKS5 UDP 头
-    if (config.proxy.port != 0 && config.rules.udp_mode == "proxy") {
-        int soType = 0;
-        if (TryGetSocketType(s, &soType) && soType == SOCK_DGRAM) {
-            std::string host;
-            uint16_t port = 0;
-            if (TryGetUdpProxyDefaultTarget(s, &host, &port) && !host.empty() && port != 0) {
-                sockaddr_storage local{};
-                int localLen = (int)sizeof(local);
-                const int family = (getsockname(s, (sockaddr*)&local, &localLen) == 0) ? (int)local.ss_family : AF_INET;
-
-                if (!EnsureUdpProxyReady(s, family, host, port, true)) {
-                    return SOCKET_ERROR;
-                }
-
-                std::vector<uint8_t> header;
-                if (!Network::Socks5Udp::Wrap(host, port, nullptr, 0, &header)) {
-                    WSASetLastError(WSAECONNREFUSED);
-                    return SOCKET_ERROR;
-                }
-
+    if (!IsStreamSocketCached(s) && config.policy.UdpProxyEnabled()) {
+        if (IsDatagramSocket(s)) {
+            UdpSendHeader header;
+            const UdpSendPrep prep = PrepareUdpProxySendHeader(s, &header);
+            if (prep == UdpSendPrep::Failed) {
+                return SOCKET_ERROR;
+            }
+            if (prep == UdpSendPrep::Ready) {
                 const DWORD userBytes = (DWORD)SumWsabufBytes(lpBuffers, dwBufferCount);
 
-                // 流量监控日志：记录用户 payload（不含 SOCKS5 UDP 头）
-                if (lpBuffers && dwBufferCount > 0) {
-                    Network::TrafficMonitor::Instance().LogSend(s, lpBuffers[0].buf, lpBuffers[0].len);
-                }
+                // 流量计数：记录用户 payload（不含 SOCKS5 UDP 头）；异步发送在投递成功时计入
+                const DWORD userBufCount = lpBuffers ? dwBufferCount : 0;
 
                 if (!lpOverlapped) {
-                    std::vector<WSABUF> bufs;
-                    bufs.reserve((size_t)dwBufferCount + 1);
-                    WSABUF h{};
-                    h.buf = (CHAR*)header.data();
-                    h.len = (ULONG)header.size();
-                    bufs.push_back(h);
-                    for (DWORD i = 0; i < dwBufferCount; ++i) {
-                        bufs.push_back(lpBuffers[i]);
-                    }
-                    int rc = fpWSASend(s, bufs.data(), (DWORD)bufs.size(), lpNumberOfBytesSent, dwFlags, NULL, NULL);
-                    if (rc == 0 && lpNumberOfBytesSent) {
-                        *lpNumberOfBytesSent = userBytes;
-                    }
+                    const int rc = SendUdpGatherSync(s, header, lpBuffers, dwBufferCount, lpNumberOfBytesSent, dwFlags, userBytes);
+                    if (rc == 0) CountSendBufs(s, lpBuffers, userBufCount, userBytes);
                     return rc;
                 }
 
-                auto ctx = std::make_shared<UdpOverlappedSendCtx>();
+                auto* ctx = new UdpOverlappedSendCtx();
                 ctx->sock = s;
-                ctx->header = std::move(header);
+                ctx->header.assign(header.bytes, header.bytes + header.len);
                 ctx->userBytes = userBytes;
                 ctx->userBytesPtr = lpNumberOfBytesSent;
                 ctx->userCompletion = lpCompletionRoutine;
@@ -3338,8 +5045,11 @@ int WSAAPI DetourWSASend(
                 }
 
                 {
-                    std::lock_guard<std::mutex> lock(g_udpOvlMtx);
-                    g_udpOvlSend[lpOverlapped] = ctx;
+                    OverlappedEntry entry{};
+                    entry.kind = OverlappedKind::UdpSend;
+                    entry.sock = s;
+                    entry.send = ctx;
+                    TrackOverlapped(lpOverlapped, entry);
                 }
 
                 const auto cb = lpCompletionRoutine ? UdpProxyCompletionRoutine : nullptr;
@@ -3350,21 +5060,28 @@ int WSAAPI DetourWSASend(
                         DropUdpOverlappedContext(lpOverlapped);
                     } else {
                         if (lpNumberOfBytesSent) *lpNumberOfBytesSent = 0;
+                        CountSendBufs(s, lpBuffers, userBufCount, userBytes);
                     }
                     WSASetLastError(err);
                     return SOCKET_ERROR;
                 }
                 if (lpNumberOfBytesSent) *lpNumberOfBytesSent = userBytes;
+                CountSendBufs(s, lpBuffers, userBufCount, userBytes);
                 return rc;
             }
         }
     }
 
-    // 流量监控日志 (记录第一个缓冲区)
-    if (lpBuffers && dwBufferCount > 0) {
-        Network::TrafficMonitor::Instance().LogSend(s, lpBuffers[0].buf, lpBuffers[0].len);
+    const int rc = fpWSASend(s, lpBuffers, dwBufferCount, lpNumberOfBytesSent, dwFlags, lpOverlapped, lpCompletionRoutine);
+    // 流量计数：同步完成按实际字节；异步投递成功按提交的字节（发送完成时几乎总是全部发出）
+    const bool pending = rc == SOCKET_ERROR && lpOverlapped && WSAGetLastError() == WSA_IO_PENDING;
+    if ((rc == 0 || pending) && lpBuffers && dwBufferCount > 0) {
+        const uint64_t bytes = (rc == 0 && lpNumberOfBytesSent) ? *lpNumberOfBytesSent
+                                                                 : SumWsabufBytes(lpBuffers, dwBufferCount);
+        CountSendBufs(s, lpBuffers, dwBufferCount, bytes);
+        if (pending) WSASetLastError(WSA_IO_PENDING);
     }
-    return fpWSASend(s, lpBuffers, dwBufferCount, lpNumberOfBytesSent, dwFlags, lpOverlapped, lpCompletionRoutine);
+    return rc;
 }
 
 int WSAAPI DetourWSARecv(
@@ -3376,64 +5093,46 @@ int WSAAPI DetourWSARecv(
     auto& config = Core::Config::Instance();
 
     // UDP/QUIC：connected UDP socket 可能走 WSARecv，需要解封装 SOCKS5 UDP Reply
-    if (config.proxy.port != 0 && config.rules.udp_mode == "proxy") {
-        int soType = 0;
-        if (TryGetSocketType(s, &soType) && soType == SOCK_DGRAM) {
-            sockaddr_storage relay{};
-            int relayLen = 0;
-            if (TryGetUdpRelayAddr(s, &relay, &relayLen)) {
+    if (!IsStreamSocketCached(s) && config.policy.UdpProxyEnabled()) {
+        if (IsDatagramSocket(s)) {
+            size_t headerHint = 0;
+            if (TryGetUdpRecvHeaderHint(s, &headerHint)) {
                 const size_t userCap = SumWsabufBytes(lpBuffers, dwBufferCount);
                 const size_t cap = userCap + Network::Socks5Udp::kMaxUdpHeaderBytes;
 
                 if (!lpOverlapped) {
-                    std::vector<uint8_t> tmp;
-                    tmp.resize(cap);
-                    WSABUF ib{};
-                    ib.buf = (CHAR*)tmp.data();
-                    ib.len = (ULONG)tmp.size();
-
-                    DWORD bytes = 0;
-                    int rc = fpWSARecv(s, &ib, 1, &bytes, lpFlags, NULL, NULL);
-                    if (rc != 0) return rc;
-
-                    Network::Socks5Udp::UnwrapResult unwrap{};
-                    if (!Network::Socks5Udp::Unwrap(tmp.data(), (size_t)bytes, &unwrap)) {
-                        WSASetLastError(WSAECONNRESET);
-                        return SOCKET_ERROR;
-                    }
-
-                    const size_t copied = CopyBytesToWsabufs(unwrap.payload, unwrap.payloadLen, lpBuffers, dwBufferCount);
-                    if (lpNumberOfBytesRecvd) *lpNumberOfBytesRecvd = (DWORD)copied;
-                    if (copied < unwrap.payloadLen) {
-                        WSASetLastError(WSAEMSGSIZE);
-                        return SOCKET_ERROR;
+                    UdpSyncRecvResult r;
+                    const int rc = RecvUdpProxySync(s, lpBuffers, dwBufferCount, lpFlags, headerHint, false, &r);
+                    if (r.unwrapped) {
+                        if (lpNumberOfBytesRecvd) *lpNumberOfBytesRecvd = (DWORD)r.delivered;
+                        if (rc == 0 && r.delivered > 0) CountRecvBufs(s, lpBuffers, dwBufferCount, r.delivered);
                     }
-                    if (lpBuffers && dwBufferCount > 0 && copied > 0) {
-                        Network::TrafficMonitor::Instance().LogRecv(s, lpBuffers[0].buf, (int)copied);
-                    }
-                    return 0;
+                    return rc;
                 }
 
-                auto ctx = std::make_shared<UdpOverlappedRecvCtx>();
+                UdpOverlappedRecvCtx* ctx = AcquireUdpRecvCtx();
                 ctx->sock = s;
-                ctx->recvBuf.resize(cap);
                 ctx->userBufs = lpBuffers;
                 ctx->userBufCount = dwBufferCount;
                 ctx->userBytesPtr = lpNumberOfBytesRecvd;
                 ctx->userFlagsPtr = lpFlags;
                 ctx->userCompletion = lpCompletionRoutine;
 
+                LPWSABUF postBufs = nullptr;
+                DWORD postCount = 0;
                 WSABUF ib{};
-                ib.buf = (CHAR*)ctx->recvBuf.data();
-                ib.len = (ULONG)ctx->recvBuf.size();
+                PrepareUdpRecvBuffers(ctx, headerHint, cap, &ib, &postBufs, &postCount);
 
                 {
-                    std::lock_guard<std::mutex> lock(g_udpOvlMtx);
-                    g_udpOvlRecv[lpOverlapped] = ctx;
+                    OverlappedEntry entry{};
+                    entry.kind = OverlappedKind::UdpRecv;
+                    entry.sock = s;
+                    entry.recv = ctx;
+                    TrackOverlapped(lpOverlapped, entry);
                 }
 
                 const auto cb = lpCompletionRoutine ? UdpProxyCompletionRoutine : nullptr;
-                int rc = fpWSARecv(s, &ib, 1, lpNumberOfBytesRecvd, lpFlags, lpOverlapped, cb);
+                int rc = fpWSARecv(s, postBufs, postCount, lpNumberOfBytesRecvd, lpFlags, lpOverlapped, cb);
                 if (rc == SOCKET_ERROR) {
                     int err = WSAGetLastError();
                     if (err != WSA_IO_PENDING) {
@@ -3462,9 +5161,9 @@ int WSAAPI DetourWSARecv(
     }
 
     int result = fpWSARecv(s, lpBuffers, dwBufferCount, lpNumberOfBytesRecvd, lpFlags, lpOverlapped, lpCompletionRoutine);
-    // 注意：异步操作无法立即获取数据，仅记录同步接收
+    // 注意：异步操作无法立即获取数据，仅计入同步接收
     if (result == 0 && lpNumberOfBytesRecvd && *lpNumberOfBytesRecvd > 0 && lpBuffers && dwBufferCount > 0) {
-        Network::TrafficMonitor::Instance().LogRecv(s, lpBuffers[0].buf, *lpNumberOfBytesRecvd);
+        CountRecvBufs(s, lpBuffers, dwBufferCount, *lpNumberOfBytesRecvd);
     }
     return result;
 }
@@ -3478,44 +5177,28 @@ int WSAAPI DetourRecvFrom(SOCKET s, char* buf, int len, int flags, struct sockad
     }
 
     auto& config = Core::Config::Instance();
-    if (config.proxy.port != 0 && config.rules.udp_mode == "proxy") {
-        int soType = 0;
-        if (TryGetSocketType(s, &soType) && soType == SOCK_DGRAM) {
-            sockaddr_storage relay{};
-            int relayLen = 0;
-            if (TryGetUdpRelayAddr(s, &relay, &relayLen)) {
-                const int cap = len + (int)Network::Socks5Udp::kMaxUdpHeaderBytes;
-                std::vector<uint8_t> tmp;
-                tmp.resize(cap > 0 ? (size_t)cap : 0);
-
-                sockaddr_storage fromTmp{};
-                int fromTmpLen = (int)sizeof(fromTmp);
-                int rc = fpRecvFrom(s, (char*)tmp.data(), (int)tmp.size(), flags, (sockaddr*)&fromTmp, &fromTmpLen);
-                if (rc <= 0) return rc;
-
-                Network::Socks5Udp::UnwrapResult unwrap{};
-                if (!Network::Socks5Udp::Unwrap(tmp.data(), (size_t)rc, &unwrap)) {
-                    WSASetLastError(WSAECONNRESET);
-                    return SOCKET_ERROR;
-                }
-
+    if (!IsStreamSocketCached(s) && config.policy.UdpProxyEnabled()) {
+        if (IsDatagramSocket(s)) {
+            size_t headerHint = 0;
+            if (TryGetUdpRecvHeaderHint(s, &headerHint)) {
+                // 与 WSARecvFrom 相同的就地接收：经 WSARecvFrom 分散接收，payload 直接落入 buf
+                WSABUF ub{};
+                ub.buf = buf;
+                ub.len = len > 0 ? (ULONG)len : 0;
+                DWORD wsaFlags = (DWORD)flags;
+                UdpSyncRecvResult r;
+                const int rc = RecvUdpProxySync(s, &ub, 1, &wsaFlags, headerHint, true, &r);
+                if (!r.unwrapped) return rc;
                 if (fromlen) {
-                    if (unwrap.srcLen > 0) {
-                        FillUserSockaddr(from, fromlen, unwrap.src, unwrap.srcLen);
+                    if (r.srcLen > 0) {
+                        FillUserSockaddr(from, fromlen, r.src, r.srcLen);
                     } else {
                         *fromlen = 0;
                     }
                 }
-
-                if ((int)unwrap.payloadLen > len) {
-                    memcpy(buf, unwrap.payload, (size_t)len);
-                    WSASetLastError(WSAEMSGSIZE);
-                    return SOCKET_ERROR;
-                }
-
-                memcpy(buf, unwrap.payload, unwrap.payloadLen);
-                Network::TrafficMonitor::Instance().LogRecv(s, buf, (int)unwrap.payloadLen);
-                return (int)unwrap.payloadLen;
+                if (rc != 0) return SOCKET_ERROR;
+                if (r.delivered > 0) CountRecv(s, buf, r.delivered, r.delivered);
+                return (int)r.delivered;
             }
         }
     }
@@ -3536,56 +5219,32 @@ int WSAAPI DetourWSARecvFrom(
     }
 
     auto& config = Core::Config::Instance();
-    if (config.proxy.port != 0 && config.rules.udp_mode == "proxy") {
-        int soType = 0;
-        if (TryGetSocketType(s, &soType) && soType == SOCK_DGRAM) {
-            sockaddr_storage relay{};
-            int relayLen = 0;
-            if (TryGetUdpRelayAddr(s, &relay, &relayLen)) {
+    if (!IsStreamSocketCached(s) && config.policy.UdpProxyEnabled()) {
+        if (IsDatagramSocket(s)) {
+            size_t headerHint = 0;
+            if (TryGetUdpRecvHeaderHint(s, &headerHint)) {
                 const size_t userCap = SumWsabufBytes(lpBuffers, dwBufferCount);
                 const size_t cap = userCap + Network::Socks5Udp::kMaxUdpHeaderBytes;
 
                 if (!lpOverlapped) {
-                    std::vector<uint8_t> tmp;
-                    tmp.resize(cap);
-                    WSABUF ib{};
-                    ib.buf = (CHAR*)tmp.data();
-                    ib.len = (ULONG)tmp.size();
-
-                    sockaddr_storage fromTmp{};
-                    int fromTmpLen = (int)sizeof(fromTmp);
-                    DWORD bytes = 0;
-                    int rc = fpWSARecvFrom(s, &ib, 1, &bytes, lpFlags, (sockaddr*)&fromTmp, &fromTmpLen, NULL, NULL);
-                    if (rc != 0) return rc;
-
-                    Network::Socks5Udp::UnwrapResult unwrap{};
-                    if (!Network::Socks5Udp::Unwrap(tmp.data(), (size_t)bytes, &unwrap)) {
-                        WSASetLastError(WSAECONNRESET);
-                        return SOCKET_ERROR;
-                    }
-
-                    const size_t copied = CopyBytesToWsabufs(unwrap.payload, unwrap.payloadLen, lpBuffers, dwBufferCount);
-                    if (lpNumberOfBytesRecvd) *lpNumberOfBytesRecvd = (DWORD)copied;
-                    if (lpFromlen) {
-                        if (unwrap.srcLen > 0) {
-                            FillUserSockaddr(lpFrom, lpFromlen, unwrap.src, unwrap.srcLen);
-                        } else {
-                            *lpFromlen = 0;
+                    UdpSyncRecvResult r;
+                    const int rc = RecvUdpProxySync(s, lpBuffers, dwBufferCount, lpFlags, headerHint, true, &r);
+                    if (r.unwrapped) {
+                        if (lpNumberOfBytesRecvd) *lpNumberOfBytesRecvd = (DWORD)r.delivered;
+                        if (lpFromlen) {
+                            if (r.srcLen > 0) {
+                                FillUserSockaddr(lpFrom, lpFromlen, r.src, r.srcLen);
+                            } else {
+                                *lpFromlen = 0;
+                            }
                         }
+                        if (rc == 0 && r.delivered > 0) CountRecvBufs(s, lpBuffers, dwBufferCount, r.delivered);
                     }
-                    if (copied < unwrap.payloadLen) {
-                        WSASetLastError(WSAEMSGSIZE);
-                        return SOCKET_ERROR;
-                    }
-                    if (lpBuffers && dwBufferCount > 0 && copied > 0) {
-                        Network::TrafficMonitor::Instance().LogRecv(s, lpBuffers[0].buf, (int)copied);
-                    }
-                    return 0;
+                    return rc;
                 }
 
-                auto ctx = std::make_shared<UdpOverlappedRecvCtx>();
+                UdpOverlappedRecvCtx* ctx = AcquireUdpRecvCtx();
                 ctx->sock = s;
-                ctx->recvBuf.resize(cap);
                 ctx->userBufs = lpBuffers;
                 ctx->userBufCount = dwBufferCount;
                 ctx->userBytesPtr = lpNumberOfBytesRecvd;
@@ -3594,17 +5253,21 @@ int WSAAPI DetourWSARecvFrom(
                 ctx->userFromLen = lpFromlen;
                 ctx->userCompletion = lpCompletionRoutine;
 
+                LPWSABUF postBufs = nullptr;
+                DWORD postCount = 0;
                 WSABUF ib{};
-                ib.buf = (CHAR*)ctx->recvBuf.data();
-                ib.len = (ULONG)ctx->recvBuf.size();
+                PrepareUdpRecvBuffers(ctx, headerHint, cap, &ib, &postBufs, &postCount);
 
                 {
-                    std::lock_guard<std::mutex> lock(g_udpOvlMtx);
-                    g_udpOvlRecv[lpOverlapped] = ctx;
+                    OverlappedEntry entry{};
+                    entry.kind = OverlappedKind::UdpRecv;
+                    entry.sock = s;
+                    entry.recv = ctx;
+                    TrackOverlapped(lpOverlapped, entry);
                 }
 
                 const auto cb = lpCompletionRoutine ? UdpProxyCompletionRoutine : nullptr;
-                int rc = fpWSARecvFrom(s, &ib, 1, lpNumberOfBytesRecvd, lpFlags,
+                int rc = fpWSARecvFrom(s, postBufs, postCount, lpNumberOfBytesRecvd, lpFlags,
                                        (sockaddr*)&ctx->fromTmp, &ctx->fromTmpLen,
                                        lpOverlapped, cb);
                 if (rc == SOCKET_ERROR) {
@@ -3646,9 +5309,8 @@ int WSAAPI DetourSendTo(SOCKET s, const char* buf, int len, int flags, const str
     }
 
     auto& config = Core::Config::Instance();
-    if (config.proxy.port != 0) {
-        int soType = 0;
-        if (TryGetSocketType(s, &soType) && soType == SOCK_DGRAM) {
+    if (config.policy.proxyEnabled) {
+        if (IsDatagramSocket(s)) {
             sockaddr_storage peer{};
             int peerLen = (int)sizeof(peer);
             const sockaddr* dst = to;
@@ -3659,18 +5321,18 @@ int WSAAPI DetourSendTo(SOCKET s, const char* buf, int len, int flags, const str
             }
 
             // udp_mode=block：保持旧行为
-            if (config.rules.udp_mode == "block") {
+            if (config.policy.udp == Core::UdpMode::Block) {
                 uint16_t dstPort = 0;
                 const bool hasPort = TryGetSockaddrPort(dst, &dstPort);
                 const bool allowUdp = dst && (IsSockaddrLoopback(dst) || (hasPort && dstPort == 53));
                 if (!allowUdp) {
                     const int err = WSAEACCES;
-                    if (ShouldLogUdpBlock()) {
+                    if (AGP_LOG_ENABLED_LIMITED(Udp, Warn)) {
                         const std::string dstStr = dst ? SockaddrToString(dst) : std::string("(未知)");
-                        Core::Logger::Warn("sendto: 已阻止 UDP 发送(策略: udp_mode=block, 说明: 禁用 QUIC/HTTP3), sock=" + std::to_string((unsigned long long)s) +
-                                           ", dst=" + dstStr +
-                                           (hasPort ? (", port=" + std::to_string(dstPort)) : std::string("")) +
-                                           ", WSA错误码=" + std::to_string(err));
+                        AGP_LOG_WARN(Udp, "sendto: 已阻止 UDP 发送(策略: udp_mode=block, 说明: 禁用 QUIC/HTTP3), sock=" + std::to_string((unsigned long long)s) +
+                                          ", dst=" + dstStr +
+                                          (hasPort ? (", port=" + std::to_string(dstPort)) : std::string("")) +
+                                          ", WSA错误码=" + std::to_string(err));
                     }
                     WSASetLastError(err);
                     return SOCKET_ERROR;
@@ -3679,7 +5341,7 @@ int WSAAPI DetourSendTo(SOCKET s, const char* buf, int len, int flags, const str
             }
 
             // udp_mode=proxy：封装为 SOCKS5 UDP 报文并发给 relay
-            if (config.rules.udp_mode == "proxy") {
+            if (config.policy.udp == Core::UdpMode::Proxy) {
                 std::string host;
                 uint16_t port = 0;
                 int family = AF_INET;
@@ -3706,12 +5368,12 @@ int WSAAPI DetourSendTo(SOCKET s, const char* buf, int len, int flags, const str
                 }
 
                 if (!EnsureUdpProxyReady(s, family, host, port, true)) {
-                    if (config.rules.udp_fallback == "direct" && dst) {
-                        if (ShouldLogUdpProxyFail()) {
+                    if (config.policy.udpFallback == Core::UdpFallback::Direct && dst) {
+                        if (AGP_LOG_ENABLED_LIMITED(Udp, Warn)) {
                             const int err = WSAGetLastError();
-                            Core::Logger::Warn("sendto: UDP 代理失败，回退为 direct, sock=" + std::to_string((unsigned long long)s) +
-                                               ", target=" + host + ":" + std::to_string(port) +
-                                               ", WSA错误码=" + std::to_string(err));
+                            AGP_LOG_WARN(Udp, "sendto: UDP 代理失败，回退为 direct, sock=" + std::to_string((unsigned long long)s) +
+                                              ", target=" + host + ":" + std::to_string(port) +
+                                              ", WSA错误码=" + std::to_string(err));
                         }
                         CleanupUdpProxyContext(s);
                         return fpSendTo(s, buf, len, flags, to, tolen);
@@ -3719,14 +5381,14 @@ int WSAAPI DetourSendTo(SOCKET s, const char* buf, int len, int flags, const str
                     return SOCKET_ERROR;
                 }
                 UpdateUdpProxyDefaultTarget(s, host, port);
-                RememberSocketTarget(s, host, port);
-
-                std::vector<uint8_t> packet;
-                if (!Network::Socks5Udp::Wrap(host, port, (const uint8_t*)buf, (size_t)len, &packet)) {
-                    if (config.rules.udp_fallback == "direct" && dst) {
-                        if (ShouldLogUdpProxyFail()) {
-                            Core::Logger::Warn("sendto: UDP 封装失败，回退为 direct, sock=" + std::to_string((unsigned long long)s) +
-                                               ", target=" + host + ":" + std::to_string(port));
+                RememberSocketTarget(s, host, port, Core::SharedStats::FlowRoute::ProxyUdp);
+
+                UdpSendHeader header;
+                if (!EncodeUdpSendHeader(host, port, &header)) {
+                    if (config.policy.udpFallback == Core::UdpFallback::Direct && dst) {
+                        if (AGP_LOG_ENABLED_LIMITED(Udp, Warn)) {
+                            AGP_LOG_WARN(Udp, "sendto: UDP 封装失败，回退为 direct, sock=" + std::to_string((unsigned long long)s) +
+                                              ", target=" + host + ":" + std::to_string(port));
                         }
                         CleanupUdpProxyContext(s);
                         return fpSendTo(s, buf, len, flags, to, tolen);
@@ -3735,9 +5397,15 @@ int WSAAPI DetourSendTo(SOCKET s, const char* buf, int len, int flags, const str
                     return SOCKET_ERROR;
                 }
 
-                int sent = fpSend ? fpSend(s, (const char*)packet.data(), (int)packet.size(), flags)
-                                  : send(s, (const char*)packet.data(), (int)packet.size(), flags);
-                if (sent == SOCKET_ERROR) {
+                WSABUF bufs[2];
+                bufs[0].buf = (CHAR*)header.bytes;
+                bufs[0].len = (ULONG)header.len;
+                bufs[1].buf = (CHAR*)buf;
+                bufs[1].len = (ULONG)(len > 0 ? len : 0);
+                DWORD sent = 0;
+                int rc = fpWSASend ? fpWSASend(s, bufs, 2, &sent, (DWORD)flags, NULL, NULL)
+                                   : WSASend(s, bufs, 2, &sent, (DWORD)flags, NULL, NULL);
+                if (rc == SOCKET_ERROR) {
                     return SOCKET_ERROR;
                 }
                 return len; // 用户视角：仅 payload 长度
@@ -3761,9 +5429,8 @@ int WSAAPI DetourWSASendTo(
     }
 
     auto& config = Core::Config::Instance();
-    if (config.proxy.port != 0) {
-        int soType = 0;
-        if (TryGetSocketType(s, &soType) && soType == SOCK_DGRAM) {
+    if (config.policy.proxyEnabled) {
+        if (IsDatagramSocket(s)) {
             sockaddr_storage peer{};
             int peerLen = (int)sizeof(peer);
             const sockaddr* dst = lpTo;
@@ -3774,7 +5441,7 @@ int WSAAPI DetourWSASendTo(
             }
 
             // udp_mode=block：保持旧行为
-            if (config.rules.udp_mode == "block") {
+            if (config.policy.udp == Core::UdpMode::Block) {
                 uint16_t dstPort = 0;
                 const bool hasPort = TryGetSockaddrPort(dst, &dstPort);
                 const bool allowUdp = dst && (IsSockaddrLoopback(dst) || (hasPort && dstPort == 53));
@@ -3783,12 +5450,12 @@ int WSAAPI DetourWSASendTo(
                     if (lpNumberOfBytesSent) {
                         *lpNumberOfBytesSent = 0;
                     }
-                    if (ShouldLogUdpBlock()) {
+                    if (AGP_LOG_ENABLED_LIMITED(Udp, Warn)) {
                         const std::string dstStr = dst ? SockaddrToString(dst) : std::string("(未知)");
-                        Core::Logger::Warn("WSASendTo: 已阻止 UDP 发送(策略: udp_mode=block, 说明: 禁用 QUIC/HTTP3), sock=" + std::to_string((unsigned long long)s) +
-                                           ", dst=" + dstStr +
-                                           (hasPort ? (", port=" + std::to_string(dstPort)) : std::string("")) +
-                                           ", WSA错误码=" + std::to_string(err));
+                        AGP_LOG_WARN(Udp, "WSASendTo: 已阻止 UDP 发送(策略: udp_mode=block, 说明: 禁用 QUIC/HTTP3), sock=" + std::to_string((unsigned long long)s) +
+                                          ", dst=" + dstStr +
+                                          (hasPort ? (", port=" + std::to_string(dstPort)) : std::string("")) +
+                                          ", WSA错误码=" + std::to_string(err));
                     }
                     WSASetLastError(err);
                     return SOCKET_ERROR;
@@ -3797,7 +5464,7 @@ int WSAAPI DetourWSASendTo(
             }
 
             // udp_mode=proxy：封装为 SOCKS5 UDP 报文并发给 relay
-            if (config.rules.udp_mode == "proxy") {
+            if (config.policy.udp == Core::UdpMode::Proxy) {
                 std::string host;
                 uint16_t port = 0;
                 int family = AF_INET;
@@ -3823,12 +5490,12 @@ int WSAAPI DetourWSASendTo(
                 }
 
                 if (!EnsureUdpProxyReady(s, family, host, port, true)) {
-                    if (config.rules.udp_fallback == "direct" && dst) {
-                        if (ShouldLogUdpProxyFail()) {
+                    if (config.policy.udpFallback == Core::UdpFallback::Direct && dst) {
+                        if (AGP_LOG_ENABLED_LIMITED(Udp, Warn)) {
                             const int err = WSAGetLastError();
-                            Core::Logger::Warn("WSASendTo: UDP 代理失败，回退为 direct, sock=" + std::to_string((unsigned long long)s) +
-                                               ", target=" + host + ":" + std::to_string(port) +
-                                               ", WSA错误码=" + std::to_string(err));
+                            AGP_LOG_WARN(Udp, "WSASendTo: UDP 代理失败，回退为 direct, sock=" + std::to_string((unsigned long long)s) +
+                                              ", target=" + host + ":" + std::to_string(port) +
+                                              ", WSA错误码=" + std::to_string(err));
                         }
                         CleanupUdpProxyContext(s);
                         return fpWSASendTo(s, lpBuffers, dwBufferCount, lpNumberOfBytesSent, dwFlags, lpTo, iToLen, lpOverlapped, lpCompletionRoutine);
@@ -3836,14 +5503,14 @@ int WSAAPI DetourWSASendTo(
                     return SOCKET_ERROR;
                 }
                 UpdateUdpProxyDefaultTarget(s, host, port);
-                RememberSocketTarget(s, host, port);
-
-                std::vector<uint8_t> header;
-                if (!Network::Socks5Udp::Wrap(host, port, nullptr, 0, &header)) {
-                    if (config.rules.udp_fallback == "direct" && dst) {
-                        if (ShouldLogUdpProxyFail()) {
-                            Core::Logger::Warn("WSASendTo: UDP 封装失败，回退为 direct, sock=" + std::to_string((unsigned long long)s) +
-                                               ", target=" + host + ":" + std::to_string(port));
+                RememberSocketTarget(s, host, port, Core::SharedStats::FlowRoute::ProxyUdp);
+
+                UdpSendHeader header;
+                if (!EncodeUdpSendHeader(host, port, &header)) {
+                    if (config.policy.udpFallback == Core::UdpFallback::Direct && dst) {
+                        if (AGP_LOG_ENABLED_LIMITED(Udp, Warn)) {
+                            AGP_LOG_WARN(Udp, "WSASendTo: UDP 封装失败，回退为 direct, sock=" + std::to_string((unsigned long long)s) +
+                                              ", target=" + host + ":" + std::to_string(port));
                         }
                         CleanupUdpProxyContext(s);
                         return fpWSASendTo(s, lpBuffers, dwBufferCount, lpNumberOfBytesSent, dwFlags, lpTo, iToLen, lpOverlapped, lpCompletionRoutine);
@@ -3856,27 +5523,13 @@ int WSAAPI DetourWSASendTo(
 
                 if (!lpOverlapped) {
                     // 同步：拼接 WSABUF 头 + 用户 payload
-                    std::vector<WSABUF> bufs;
-                    bufs.reserve((size_t)dwBufferCount + 1);
-                    WSABUF h{};
-                    h.buf = (CHAR*)header.data();
-                    h.len = (ULONG)header.size();
-                    bufs.push_back(h);
-                    for (DWORD i = 0; i < dwBufferCount; ++i) {
-                        bufs.push_back(lpBuffers[i]);
-                    }
-                    int rc = fpWSASend ? fpWSASend(s, bufs.data(), (DWORD)bufs.size(), lpNumberOfBytesSent, dwFlags, NULL, NULL)
-                                       : fpWSASendTo(s, bufs.data(), (DWORD)bufs.size(), lpNumberOfBytesSent, dwFlags, NULL, 0, NULL, NULL);
-                    if (rc == 0 && lpNumberOfBytesSent) {
-                        *lpNumberOfBytesSent = userBytes;
-                    }
-                    return rc;
+                    return SendUdpGatherSync(s, header, lpBuffers, dwBufferCount, lpNumberOfBytesSent, dwFlags, userBytes);
                 }
 
                 // Overlapped：保存上下文，等待完成时修正 bytesTransferred
-                auto ctx = std::make_shared<UdpOverlappedSendCtx>();
+                auto* ctx = new UdpOverlappedSendCtx();
                 ctx->sock = s;
-                ctx->header = std::move(header);
+                ctx->header.assign(header.bytes, header.bytes + header.len);
                 ctx->userBytes = userBytes;
                 ctx->userBytesPtr = lpNumberOfBytesSent;
                 ctx->userCompletion = lpCompletionRoutine;
@@ -3891,8 +5544,11 @@ int WSAAPI DetourWSASendTo(
                 }
 
                 {
-                    std::lock_guard<std::mutex> lock(g_udpOvlMtx);
-                    g_udpOvlSend[lpOverlapped] = ctx;
+                    OverlappedEntry entry{};
+                    entry.kind = OverlappedKind::UdpSend;
+                    entry.sock = s;
+                    entry.send = ctx;
+                    TrackOverlapped(lpOverlapped, entry);
                 }
 
                 // 走 WSASend（socket 已 connect 到 relay）
@@ -3932,6 +5588,12 @@ namespace Hooks {
             Core::Logger::Error("MinHook 初始化失败");
             return;
         }
+
+        // 抓包在 Hook 生效前配置：之后建立的隧道才会被采样
+        Network::PacketCapture::Instance().Configure(Core::Config::Instance().capture);
+        const auto& latencyTrace = Core::Config::Instance().latencyTrace;
+        Core::ConnTrace::Instance().Configure(latencyTrace.enabled, (uint32_t)latencyTrace.sample_every);
+        if (IsLearnRoute(Core::Config::Instance().rules.routing.default_action)) ConfigureRoutePreferences();
         
         // ===== Phase 1: 网络 Hooks =====
         
@@ -4076,37 +5738,30 @@ namespace Hooks {
         }
     }
     
-    void Uninstall() {
-        {
-            // 清理未完成的 ConnectEx 上下文，避免卸载后残留
-            std::lock_guard<std::mutex> lock(g_connectExMtx);
-            g_connectExPending.clear();
-        }
-        {
-            // 清理 UDP 代理上下文：关闭 SOCKS5 UDP Associate 控制连接
-            std::unordered_map<SOCKET, UdpProxyContext> tmp;
-            {
-                std::lock_guard<std::mutex> lock(g_udpProxyMtx);
-                tmp.swap(g_udpProxy);
-            }
-            for (auto& kv : tmp) {
-                if (kv.second.controlSock != INVALID_SOCKET) {
-                    if (fpCloseSocket) fpCloseSocket(kv.second.controlSock);
-                    else closesocket(kv.second.controlSock);
-                }
-            }
-        }
+    // processTerminating：进程退出（DLL_PROCESS_DETACH 且 lpvReserved != NULL），后台线程已被系统终止
+    void Uninstall(bool processTerminating) {
         {
-            // 清理 UDP Overlapped 上下文，避免卸载后泄漏
-            std::lock_guard<std::mutex> lock(g_udpOvlMtx);
-            g_udpOvlSend.clear();
-            g_udpOvlRecv.clear();
+            // 清理 socket 记录：关闭 SOCKS5 UDP Associate 控制连接（在分片锁外关闭）
+            std::vector<SOCKET> controls;
+            g_sockets.Drain([&controls](SOCKET, Network::RefPtr<SocketContext> sc) {
+                if (!sc) return;
+                std::lock_guard<std::mutex> lock(sc->mtx);
+                if (sc->hasUdpProxy && sc->udp.controlSock != INVALID_SOCKET) controls.push_back(sc->udp.controlSock);
+                sc->hasUdpProxy = false;
+                sc->pendingOverlapped.clear();
+            });
+            for (SOCKET control : controls) CloseUdpControlSocket(control);
         }
         {
-            // 清理 socket -> 原始目标映射，避免卸载后残留
-            std::lock_guard<std::mutex> lock(g_socketTargetsMtx);
-            g_socketTargets.clear();
+            // 清理未完成的 ConnectEx / UDP Overlapped 上下文，避免卸载后残留
+            g_overlapped.Drain([](LPOVERLAPPED ovl, OverlappedEntry&& e) {
+                g_overlappedFilter.Remove(ovl);
+                FreeOverlappedEntry(&e);
+            });
+            g_connectExPending.Clear();
         }
+        g_socketClass.Clear();
+        LogUdpRecvCounters("卸载");
         {
             // 清理 ConnectEx Provider trampoline 映射，避免卸载后残留
             std::lock_guard<std::mutex> lock(g_connectExHookMtx);
@@ -4114,6 +5769,48 @@ namespace Hooks {
             g_connectExTrampolineByTarget.clear();
             fpConnectEx = NULL;
         }
+        // 停止 UDP Associate 预热池并关闭池中控制连接
+        // 动态卸载（FreeLibrary）时补充线程可能正在建立会话（调用本模块的 trampoline 与 Config）：
+        // 有界等待其退出通知，避免模块解除映射后线程仍在执行本模块代码。
+        // 进程退出时补充线程已被终止（可能持有池的锁），socket 由系统回收，跳过
+        if (!processTerminating && !Network::UdpAssociatePool::Instance().Stop(kUdpPoolStopWaitMs)) {
+            AGP_LOG_WARN(Udp, "UDP Associate 预热池: 补充线程未在 " + std::to_string(kUdpPoolStopWaitMs) + "ms 内退出");
+        }
+        {
+            // 停止多路复用中继（转发线程已 detach，自行关闭其 socket 后退出）
+            std::lock_guard<std::mutex> lock(g_udpRelayMuxMtx);
+            if (g_udpRelayMux) g_udpRelayMux->Stop();
+            g_udpRelayMux.reset();
+        }
+        {
+            // 停止指标端点（线程已 detach，自行关闭监听 socket 后退出）
+            std::lock_guard<std::mutex> lock(g_metricsServerMtx);
+            if (g_metricsServer) g_metricsServer->Stop();
+            g_metricsServer.reset();
+        }
+        {
+            // 释放共享统计段槽位（发布线程已 detach，自行解除映射后退出）
+            std::lock_guard<std::mutex> lock(g_statsPublisherMtx);
+            if (g_statsPublisher) g_statsPublisher->Stop();
+            g_statsPublisher.reset();
+        }
+        // 清理上游熔断状态与往返时间估计
+        Network::CircuitBreakerRegistry::Instance().Clear();
+        Network::UpstreamRttRegistry::Instance().Clear();
+        // 停止域名路由偏好的后台写回；进程退出时线程已被终止，不等待
+        {
+            std::lock_guard<std::mutex> lock(g_routePreferencePersisterMtx);
+            if (g_routePreferencePersister && !processTerminating &&
+                !g_routePreferencePersister->Stop(kRoutePreferenceStopWaitMs)) {
+                AGP_LOG_WARN(Route, "域名路由偏好: 写回线程未在 " + std::to_string(kRoutePreferenceStopWaitMs) + "ms 内退出");
+            }
+            g_routePreferencePersister.reset();
+        }
+        // 冲刷抓包环并写入统计块
+        Network::PacketCapture::Instance().Shutdown();
+        // 输出连接阶段耗时汇总，并导出采样的时间线
+        LogConnTraceSummary();
+        ExportConnTraceFile();
         MH_DisableHook(MH_ALL_HOOKS);
         MH_Uninitialize();
     }
@@ -39,7 +39,7 @@ namespace Injection {
             
             if (!remoteDllPath) {
                 const DWORD err = GetLastError();
-                Core::Logger::Error("ProcessInjector: 虚拟内存分配失败 (VirtualAllocEx failed), err=" + std::to_string(err));
+                AGP_LOG_ERROR(Inject, "ProcessInjector: 虚拟内存分配失败 (VirtualAllocEx failed), err=" + std::to_string(err));
                 setFailureReason("VirtualAllocEx failed, err=" + std::to_string(err));
                 return false;
             }
@@ -47,7 +47,7 @@ namespace Injection {
             // 步骤 2: 将 DLL 路径写入目标进程
             if (!WriteProcessMemory(hProcess, remoteDllPath, dllPath.c_str(), dllPathSize, NULL)) {
                 const DWORD err = GetLastError();
-                Core::Logger::Error("ProcessInjector: 写入进程内存失败 (WriteProcessMemory failed), err=" + std::to_string(err));
+                AGP_LOG_ERROR(Inject, "ProcessInjector: 写入进程内存失败 (WriteProcessMemory failed), err=" + std::to_string(err));
                 setFailureReason("WriteProcessMemory failed, err=" + std::to_string(err));
                 VirtualFreeEx(hProcess, remoteDllPath, 0, MEM_RELEASE);
                 return false;
@@ -57,7 +57,7 @@ namespace Injection {
             HMODULE hKernel32 = GetModuleHandleW(L"kernel32.dll");
             if (!hKernel32) {
                 const DWORD err = GetLastError();
-                Core::Logger::Error("ProcessInjector: 获取 Kernel32 句柄失败, err=" + std::to_string(err));
+                AGP_LOG_ERROR(Inject, "ProcessInjector: 获取 Kernel32 句柄失败, err=" + std::to_string(err));
                 setFailureReason("GetModuleHandleW(kernel32.dll) failed, err=" + std::to_string(err));
                 VirtualFreeEx(hProcess, remoteDllPath, 0, MEM_RELEASE);
                 return false;
@@ -67,7 +67,7 @@ namespace Injection {
                 (LPTHREAD_START_ROUTINE)GetProcAddress(hKernel32, "LoadLibraryW");
             if (!loadLibraryAddr) {
                 const DWORD err = GetLastError();
-                Core::Logger::Error("ProcessInjector: 获取 LoadLibraryW 地址失败, err=" + std::to_string(err));
+                AGP_LOG_ERROR(Inject, "ProcessInjector: 获取 LoadLibraryW 地址失败, err=" + std::to_string(err));
                 setFailureReason("GetProcAddress(LoadLibraryW) failed, err=" + std::to_string(err));
                 VirtualFreeEx(hProcess, remoteDllPath, 0, MEM_RELEASE);
                 return false;
@@ -86,7 +86,7 @@ namespace Injection {
             
             if (!hThread) {
                 const DWORD err = GetLastError();
-                Core::Logger::Error("ProcessInjector: 创建远程线程失败 (CreateRemoteThread failed), err=" + std::to_string(err));
+                AGP_LOG_ERROR(Inject, "ProcessInjector: 创建远程线程失败 (CreateRemoteThread failed), err=" + std::to_string(err));
                 setFailureReason("CreateRemoteThread failed, err=" + std::to_string(err));
                 VirtualFreeEx(hProcess, remoteDllPath, 0, MEM_RELEASE);
                 return false;
@@ -108,17 +108,17 @@ namespace Injection {
                 } else {
                     DWORD err = GetLastError();
                     setFailureReason("GetExitCodeThread failed, err=" + std::to_string(err));
-                    Core::Logger::Warn("ProcessInjector: 获取远程线程退出码失败 (GetExitCodeThread failed), err=" + std::to_string(err));
+                    AGP_LOG_WARN(Inject, "ProcessInjector: 获取远程线程退出码失败 (GetExitCodeThread failed), err=" + std::to_string(err));
                 }
             } else if (waitRc == WAIT_TIMEOUT) {
                 // 超时意味着远程线程可能仍在读取 remoteDllPath；此时释放远程内存可能导致 UAF
                 setFailureReason("WaitForSingleObject timeout(5000ms)");
-                Core::Logger::Warn("ProcessInjector: 等待远程线程超时(5000ms)，注入结果未知；为避免 UAF 将不释放远程路径内存");
+                AGP_LOG_WARN(Inject, "ProcessInjector: 等待远程线程超时(5000ms)，注入结果未知；为避免 UAF 将不释放远程路径内存");
             } else {
                 DWORD err = GetLastError();
                 setFailureReason("WaitForSingleObject failed, rc=" + std::to_string(waitRc) + ", err=" + std::to_string(err));
-                Core::Logger::Error("ProcessInjector: 等待远程线程失败 (WaitForSingleObject failed), rc=" + std::to_string(waitRc) +
-                                    ", err=" + std::to_string(err));
+                AGP_LOG_ERROR(Inject, "ProcessInjector: 等待远程线程失败 (WaitForSingleObject failed), rc=" + std::to_string(waitRc) +
+                                      ", err=" + std::to_string(err));
             }
 
             // 清理：句柄必须关闭；远程路径内存仅在远程线程结束后释放，避免 UAF
@@ -129,11 +129,11 @@ namespace Injection {
 
             if (ok) {
                 setFailureReason("");
-                Core::Logger::Info("ProcessInjector: 注入成功 (LoadLibraryW 返回非空)");
+                AGP_LOG_INFO(Inject, "ProcessInjector: 注入成功 (LoadLibraryW 返回非空)");
                 return true;
             }
             if (waitRc == WAIT_OBJECT_0) {
-                Core::Logger::Error("ProcessInjector: 注入失败 (LoadLibraryW 返回 0)");
+                AGP_LOG_ERROR(Inject, "ProcessInjector: 注入失败 (LoadLibraryW 返回 0)");
             }
             if (failureReason && failureReason->empty()) {
                 *failureReason = "unknown injector failure";
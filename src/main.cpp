@@ -10,7 +10,7 @@
 // 前向声明
 namespace Hooks {
     void Install();
-    void Uninstall();
+    void Uninstall(bool processTerminating);
 }
 
 namespace VersionProxy {
@@ -48,8 +48,11 @@ BOOL WINAPI DllMain(HINSTANCE hinstDLL, DWORD fdwReason, LPVOID lpvReserved) {
     }
         
     case DLL_PROCESS_DETACH: {
-        Hooks::Uninstall();
+        // 进程退出时其他线程已被系统终止（lpvReserved != NULL），不等待后台线程
+        Hooks::Uninstall(lpvReserved != NULL);
         VersionProxy::Uninitialize();
+        // 冲刷异步日志队列；进程退出时写线程已被系统终止，不再等待它（lpvReserved != NULL）
+        Core::Logger::Shutdown(lpvReserved != NULL);
         Core::Logger::Info("Antigravity-Proxy DLL 已卸载");
         break;
     }
@@ -0,0 +1,120 @@
+#pragma once
+#include <algorithm>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+namespace Network {
+
+    // 上游代理自适应超时（per-upstream）
+    // 设计意图：固定超时（默认 connect 5s、握手 15s）远大于代理的实际往返时间，路径失效时调用方要等满固定超时才失败；
+    // 这里按 RFC 6298（TCP RTO）由成功样本估计 SRTT/RTTVAR，超时取 SRTT + K*RTTVAR，并限制在 [minMs, 配置的固定超时] 内。
+    // - 样本不足 minSamples 前使用固定超时（冷启动不冒误判的风险）
+    // - 失败的尝试不产生样本（Karn 算法），避免把超时时间本身计入估计
+    // - 在自适应超时内失败后退避：之后的超时逐次翻倍（最多到固定超时），下一个成功样本到来时复位；
+    //   代理整体变慢时几次失败即可回到固定超时，不会持续误判
+    // 说明：本模块不依赖 Logger/Winsock，时间由调用方测量后传入（微秒），可在任意平台独立测试。
+    struct AdaptiveTimeoutOptions {
+        uint32_t minMs = 200;      // 自适应超时下限
+        uint32_t minSamples = 3;   // 开始采用估计值所需的成功样本数
+        uint32_t k = 4;            // RTTVAR 倍数
+        uint32_t maxBackoff = 6;   // 最多翻倍次数
+    };
+
+    struct RttEstimatorStats {
+        uint64_t srttUs = 0;
+        uint64_t rttvarUs = 0;
+        uint64_t samples = 0;
+        uint64_t timeouts = 0;  // 在自适应超时内失败的次数
+        uint32_t backoff = 0;   // 当前翻倍次数
+    };
+
+    class RttEstimator {
+    public:
+        explicit RttEstimator(const AdaptiveTimeoutOptions& options = AdaptiveTimeoutOptions())
+            : m_options(options) {
+            if (m_options.minMs == 0) m_options.minMs = 1;
+            if (m_options.minSamples == 0) m_options.minSamples = 1;
+        }
+
+        // 成功样本：第一个样本 SRTT=R、RTTVAR=R/2；之后 RTTVAR=3/4*RTTVAR+1/4*|SRTT-R|、SRTT=7/8*SRTT+1/8*R
+        void AddSample(uint64_t rttUs) {
+            std::lock_guard<std::mutex> lock(m_mtx);
+            if (m_stats.samples == 0) {
+                m_stats.srttUs = rttUs;
+                m_stats.rttvarUs = rttUs / 2;
+            } else {
+                const uint64_t delta = m_stats.srttUs > rttUs ? m_stats.srttUs - rttUs : rttUs - m_stats.srttUs;
+                m_stats.rttvarUs = (3 * m_stats.rttvarUs + delta) / 4;
+                m_stats.srttUs = (7 * m_stats.srttUs + rttUs) / 8;
+            }
+            m_stats.samples++;
+            m_stats.backoff = 0;
+        }
+
+        // 本次尝试的超时（毫秒）：maxMs 为配置的固定超时，同时是上限
+        uint32_t TimeoutMs(uint32_t maxMs) const {
+            std::lock_guard<std::mutex> lock(m_mtx);
+            if (m_stats.samples < m_options.minSamples) return maxMs;
+            const uint64_t rtoUs = m_stats.srttUs + (uint64_t)m_options.k * m_stats.rttvarUs;
+            uint64_t ms = std::max<uint64_t>((rtoUs + 999) / 1000, m_options.minMs);
+            ms <<= m_stats.backoff;
+            return (uint32_t)std::min<uint64_t>(ms, maxMs);
+        }
+
+        // 尝试在自适应超时（小于固定超时）内失败时调用：下一次超时翻倍
+        void OnTimeout() {
+            std::lock_guard<std::mutex> lock(m_mtx);
+            m_stats.timeouts++;
+            if (m_stats.backoff < m_options.maxBackoff) m_stats.backoff++;
+        }
+
+        RttEstimatorStats GetStats() const {
+            std::lock_guard<std::mutex> lock(m_mtx);
+            return m_stats;
+        }
+
+    private:
+        AdaptiveTimeoutOptions m_options;
+        mutable std::mutex m_mtx;
+        RttEstimatorStats m_stats;
+    };
+
+    // 一个上游的两组估计：connect 为到代理的 TCP 建连，greeting 为 SOCKS5 认证协商；两者都只涉及代理本身。
+    // CONNECT 应答包含代理连接目标的时间，随目标远近变化，不参与估计（否则近处目标会把预算压到下限，远处目标被误判超时）
+    struct UpstreamRtt {
+        explicit UpstreamRtt(const AdaptiveTimeoutOptions& options) : connect(options), greeting(options) {}
+        RttEstimator connect;
+        RttEstimator greeting;
+    };
+
+    class UpstreamRttRegistry {
+    public:
+        static UpstreamRttRegistry& Instance() {
+            static UpstreamRttRegistry instance;
+            return instance;
+        }
+
+        // 首次获取时按 options 创建；之后返回同一实例（options 以首次为准）
+        std::shared_ptr<UpstreamRtt> Get(const std::string& upstream, const AdaptiveTimeoutOptions& options) {
+            std::lock_guard<std::mutex> lock(m_mtx);
+            auto it = m_upstreams.find(upstream);
+            if (it != m_upstreams.end()) return it->second;
+            auto rtt = std::make_shared<UpstreamRtt>(options);
+            m_upstreams.emplace(upstream, rtt);
+            return rtt;
+        }
+
+        void Clear() {
+            std::lock_guard<std::mutex> lock(m_mtx);
+            m_upstreams.clear();
+        }
+
+    private:
+        UpstreamRttRegistry() = default;
+        std::mutex m_mtx;
+        std::unordered_map<std::string, std::shared_ptr<UpstreamRtt>> m_upstreams;
+    };
+}
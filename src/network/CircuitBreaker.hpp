@@ -0,0 +1,206 @@
+#pragma once
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+namespace Network {
+
+    // 上游代理熔断器（per-upstream）
+    // 设计意图：代理宕机时，每个连接都会在 WaitConnect 中耗满 connect 超时；
+    // 连续失败达到阈值后进入 open 状态快速失败（或按策略回退），冷却期结束后以 half-open 放行少量探测连接。
+    // 说明：本模块不依赖 Logger/Winsock，时间由调用方传入（毫秒），状态迁移通过 CircuitTransition 返回，
+    //       由 Hooks 层决定日志输出；这样可以在任意平台独立测试。
+    enum class CircuitState : int {
+        Closed = 0,   // 正常放行
+        Open = 1,     // 熔断中：直接拒绝
+        HalfOpen = 2, // 冷却结束：仅放行探测连接
+    };
+
+    inline const char* CircuitStateToText(CircuitState state) {
+        switch (state) {
+            case CircuitState::Closed: return "closed";
+            case CircuitState::Open: return "open";
+            case CircuitState::HalfOpen: return "half-open";
+            default: return "unknown";
+        }
+    }
+
+    struct CircuitBreakerOptions {
+        uint32_t failureThreshold = 5; // 连续失败多少次后熔断
+        uint64_t cooldownMs = 10000;   // open 状态持续时间；同时作为 half-open 探测的超时回收时间
+        uint32_t halfOpenProbes = 1;   // half-open 状态下允许同时在途的探测连接数
+    };
+
+    // 单次调用引发的状态迁移（changed=false 表示未迁移）
+    struct CircuitTransition {
+        bool changed = false;
+        CircuitState from = CircuitState::Closed;
+        CircuitState to = CircuitState::Closed;
+        uint32_t consecutiveFailures = 0;
+    };
+
+    // 计数器快照：用于日志/指标输出
+    struct CircuitBreakerStats {
+        CircuitState state = CircuitState::Closed;
+        uint32_t consecutiveFailures = 0;
+        uint64_t successes = 0;
+        uint64_t failures = 0;
+        uint64_t rejected = 0;   // open/half-open 期间被快速拒绝的次数
+        uint64_t opened = 0;     // 进入 open 的次数
+        uint64_t halfOpened = 0; // 进入 half-open 的次数
+        uint64_t closed = 0;     // 从 half-open 恢复为 closed 的次数
+    };
+
+    class CircuitBreaker {
+    public:
+        explicit CircuitBreaker(const CircuitBreakerOptions& options = CircuitBreakerOptions())
+            : m_options(options) {
+            if (m_options.failureThreshold == 0) m_options.failureThreshold = 1;
+            if (m_options.halfOpenProbes == 0) m_options.halfOpenProbes = 1;
+        }
+
+        // 发起连接前调用：返回 false 表示熔断中，应快速失败（或按策略回退）
+        // 注意：返回 true 后必须调用 RecordSuccess/RecordFailure 之一上报结果；
+        //       未上报的 half-open 探测会在 cooldownMs 后被回收，避免永久卡在 half-open。
+        bool Allow(uint64_t nowMs, CircuitTransition* transition = nullptr) {
+            std::lock_guard<std::mutex> lock(m_mtx);
+            if (transition) *transition = CircuitTransition{};
+            switch (m_stats.state) {
+                case CircuitState::Closed:
+                    return true;
+                case CircuitState::Open:
+                    if (nowMs - m_openedAtMs < m_options.cooldownMs) {
+                        m_stats.rejected++;
+                        return false;
+                    }
+                    SetState(CircuitState::HalfOpen, transition);
+                    m_stats.halfOpened++;
+                    m_probesInFlight = 1;
+                    m_probeStartedAtMs = nowMs;
+                    return true;
+                case CircuitState::HalfOpen:
+                    if (m_probesInFlight < m_options.halfOpenProbes) {
+                        m_probesInFlight++;
+                        m_probeStartedAtMs = nowMs;
+                        return true;
+                    }
+                    if (nowMs - m_probeStartedAtMs >= m_options.cooldownMs) {
+                        // 探测结果迟迟未上报（如 ConnectEx 上下文被回收），重新放行一次探测
+                        m_probesInFlight = 1;
+                        m_probeStartedAtMs = nowMs;
+                        return true;
+                    }
+                    m_stats.rejected++;
+                    return false;
+            }
+            return true;
+        }
+
+        void RecordSuccess(uint64_t nowMs, CircuitTransition* transition = nullptr) {
+            (void)nowMs;
+            std::lock_guard<std::mutex> lock(m_mtx);
+            if (transition) *transition = CircuitTransition{};
+            m_stats.successes++;
+            m_stats.consecutiveFailures = 0;
+            if (m_stats.state != CircuitState::Closed) {
+                // half-open 探测成功，或 open 之前发出的连接迟到成功：都说明上游已恢复
+                SetState(CircuitState::Closed, transition);
+                m_stats.closed++;
+                m_probesInFlight = 0;
+            }
+        }
+
+        void RecordFailure(uint64_t nowMs, CircuitTransition* transition = nullptr) {
+            std::lock_guard<std::mutex> lock(m_mtx);
+            if (transition) *transition = CircuitTransition{};
+            m_stats.failures++;
+            m_stats.consecutiveFailures++;
+            if (transition) transition->consecutiveFailures = m_stats.consecutiveFailures;
+            switch (m_stats.state) {
+                case CircuitState::Closed:
+                    if (m_stats.consecutiveFailures >= m_options.failureThreshold) {
+                        Trip(nowMs, transition);
+                    }
+                    break;
+                case CircuitState::HalfOpen:
+                    // 探测失败：重新熔断并开始新的冷却期
+                    Trip(nowMs, transition);
+                    break;
+                case CircuitState::Open:
+                    // open 之前发出的连接迟到失败：不延长冷却期
+                    break;
+            }
+        }
+
+        CircuitBreakerStats GetStats() const {
+            std::lock_guard<std::mutex> lock(m_mtx);
+            return m_stats;
+        }
+
+        // open 状态剩余冷却时间（其他状态返回 0），用于日志提示
+        uint64_t RemainingCooldownMs(uint64_t nowMs) const {
+            std::lock_guard<std::mutex> lock(m_mtx);
+            if (m_stats.state != CircuitState::Open) return 0;
+            const uint64_t elapsed = nowMs - m_openedAtMs;
+            return elapsed >= m_options.cooldownMs ? 0 : (m_options.cooldownMs - elapsed);
+        }
+
+        const CircuitBreakerOptions& Options() const { return m_options; }
+
+    private:
+        void SetState(CircuitState to, CircuitTransition* transition) {
+            if (transition) {
+                transition->changed = true;
+                transition->from = m_stats.state;
+                transition->to = to;
+                transition->consecutiveFailures = m_stats.consecutiveFailures;
+            }
+            m_stats.state = to;
+        }
+
+        void Trip(uint64_t nowMs, CircuitTransition* transition) {
+            SetState(CircuitState::Open, transition);
+            m_stats.opened++;
+            m_openedAtMs = nowMs;
+            m_probesInFlight = 0;
+        }
+
+        CircuitBreakerOptions m_options;
+        mutable std::mutex m_mtx;
+        CircuitBreakerStats m_stats;
+        uint64_t m_openedAtMs = 0;
+        uint64_t m_probeStartedAtMs = 0;
+        uint32_t m_probesInFlight = 0;
+    };
+
+    // 熔断器注册表：按上游标识（如 "127.0.0.1:7890"）维护独立熔断器
+    class CircuitBreakerRegistry {
+    public:
+        static CircuitBreakerRegistry& Instance() {
+            static CircuitBreakerRegistry instance;
+            return instance;
+        }
+
+        // 首次获取时按 options 创建；之后返回同一实例（options 以首次为准）
+        std::shared_ptr<CircuitBreaker> Get(const std::string& upstream, const CircuitBreakerOptions& options) {
+            std::lock_guard<std::mutex> lock(m_mtx);
+            auto it = m_breakers.find(upstream);
+            if (it != m_breakers.end()) return it->second;
+            auto breaker = std::make_shared<CircuitBreaker>(options);
+            m_breakers.emplace(upstream, breaker);
+            return breaker;
+        }
+
+        void Clear() {
+            std::lock_guard<std::mutex> lock(m_mtx);
+            m_breakers.clear();
+        }
+
+    private:
+        CircuitBreakerRegistry() = default;
+        std::mutex m_mtx;
+        std::unordered_map<std::string, std::shared_ptr<CircuitBreaker>> m_breakers;
+    };
+}
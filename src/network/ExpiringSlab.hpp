@@ -0,0 +1,178 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+namespace Network {
+
+    // 带过期时间的对象槽表：slab 存储 + 代数句柄 + 单层哈希时间轮
+    // 设计要点：
+    // - 句柄 = (代数 << 32) | (下标 + 1)，0 为无效句柄；槽位释放时代数自增，过期/已取走的旧句柄不会误命中复用后的槽位
+    // - 时间轮按到期时间落槽（粒度 GranularityMs），跨度 WheelSlots * GranularityMs 需大于最大 TTL，
+    //   这样推进时每个槽位中的条目都已到期，过期处理均摊 O(1)（到期后最多延后一个粒度取出）；
+    //   Take/Erase 通过槽位记录的轮内位置 O(1) 摘除
+    // - 所有操作持有同一把锁，但都是 O(1)（Expire 为 O(经过的槽位数 + 到期条目数)）；
+    //   Expire 的回调在释放锁后执行，回调中可安全访问其他加锁结构
+    // 说明：本文件不依赖 Winsock/Logger，可在非 Windows 平台独立测试。
+    template <typename T, size_t WheelSlots = 1024, uint64_t GranularityMs = 100>
+    class ExpiringSlab {
+        static_assert(WheelSlots > 0 && (WheelSlots & (WheelSlots - 1)) == 0, "时间轮槽位数必须为 2 的幂");
+        static_assert(GranularityMs > 0, "时间轮粒度必须大于 0");
+
+    public:
+        using Handle = uint64_t;
+        static constexpr Handle kInvalidHandle = 0;
+        static constexpr uint64_t kSpanMs = WheelSlots * GranularityMs;
+
+        ExpiringSlab() = default;
+        ExpiringSlab(const ExpiringSlab&) = delete;
+        ExpiringSlab& operator=(const ExpiringSlab&) = delete;
+
+        // 插入对象并在 now + ttlMs 到期；ttlMs 超过时间轮跨度时按跨度截断
+        Handle Insert(T value, uint64_t now, uint64_t ttlMs) {
+            if (ttlMs >= kSpanMs) ttlMs = kSpanMs - GranularityMs;
+            std::lock_guard<std::mutex> lock(m_mtx);
+            if (!m_started || m_size == 0) {
+                m_cursor = now / GranularityMs;
+                m_started = true;
+            }
+            uint32_t index;
+            if (!m_free.empty()) {
+                index = m_free.back();
+                m_free.pop_back();
+            } else {
+                index = (uint32_t)m_slots.size();
+                m_slots.emplace_back();
+            }
+            Slot& slot = m_slots[index];
+            slot.value = std::move(value);
+            slot.live = true;
+            slot.deadline = now + ttlMs;
+            // 刻度向上取整：推进到该刻度时 now 必然已过到期时间；落在已推进过的刻度时放入下一刻度
+            uint64_t tick = (slot.deadline + GranularityMs - 1) / GranularityMs;
+            if (tick <= m_cursor) tick = m_cursor + 1;
+            auto& bucket = m_wheel[tick & (WheelSlots - 1)];
+            slot.bucket = (uint32_t)(tick & (WheelSlots - 1));
+            slot.pos = (uint32_t)bucket.size();
+            bucket.push_back(index);
+            ++m_size;
+            return MakeHandle(slot.gen, index);
+        }
+
+        // 取走对象（完成通知时调用）；句柄已过期/已取走时返回 false
+        bool Take(Handle h, T* out) {
+            std::lock_guard<std::mutex> lock(m_mtx);
+            Slot* slot = Resolve(h);
+            if (!slot) return false;
+            if (out) *out = std::move(slot->value);
+            Release((uint32_t)(h & 0xFFFFFFFFu) - 1);
+            return true;
+        }
+
+        bool Erase(Handle h) { return Take(h, nullptr); }
+
+        bool Contains(Handle h) const {
+            std::lock_guard<std::mutex> lock(m_mtx);
+            return ResolveConst(h) != nullptr;
+        }
+
+        // 推进时间轮到 now，取出全部到期对象并在释放锁后逐个回调 fn(Handle, T&&)；返回到期数量
+        template <typename Fn>
+        size_t Expire(uint64_t now, Fn&& fn) {
+            std::vector<std::pair<Handle, T>> expired;
+            {
+                std::lock_guard<std::mutex> lock(m_mtx);
+                if (!m_started || m_size == 0) {
+                    m_cursor = now / GranularityMs;
+                    m_started = true;
+                    return 0;
+                }
+                const uint64_t target = now / GranularityMs;
+                if (target <= m_cursor) return 0;
+                // 长时间未推进（超过一整圈）时每个槽位只需检查一次
+                const uint64_t steps = (target - m_cursor) < WheelSlots ? (target - m_cursor) : WheelSlots;
+                for (uint64_t i = 1; i <= steps; ++i) {
+                    auto& bucket = m_wheel[(m_cursor + i) & (WheelSlots - 1)];
+                    for (size_t k = 0; k < bucket.size();) {
+                        const uint32_t index = bucket[k];
+                        Slot& slot = m_slots[index];
+                        if (slot.deadline > now) {
+                            ++k; // 未到期（仅在截断 TTL 或跨圈推进时出现），保留在原槽位
+                            continue;
+                        }
+                        expired.emplace_back(MakeHandle(slot.gen, index), std::move(slot.value));
+                        Release(index); // 尾部条目换入位置 k，继续检查同一位置
+                    }
+                }
+                m_cursor = target;
+            }
+            for (auto& item : expired) fn(item.first, std::move(item.second));
+            return expired.size();
+        }
+
+        // 清空（卸载时使用），已发放的句柄全部失效
+        void Clear() {
+            std::lock_guard<std::mutex> lock(m_mtx);
+            for (uint32_t i = 0; i < (uint32_t)m_slots.size(); ++i) {
+                if (m_slots[i].live) Release(i);
+            }
+        }
+
+        size_t Size() const {
+            std::lock_guard<std::mutex> lock(m_mtx);
+            return m_size;
+        }
+
+    private:
+        struct Slot {
+            T value{};
+            uint64_t deadline = 0;
+            uint32_t gen = 1;
+            uint32_t bucket = 0;
+            uint32_t pos = 0;
+            bool live = false;
+        };
+
+        static Handle MakeHandle(uint32_t gen, uint32_t index) {
+            return ((uint64_t)gen << 32) | (uint64_t)(index + 1);
+        }
+
+        Slot* Resolve(Handle h) {
+            return const_cast<Slot*>(ResolveConst(h));
+        }
+
+        const Slot* ResolveConst(Handle h) const {
+            const uint32_t low = (uint32_t)(h & 0xFFFFFFFFu);
+            if (low == 0 || low > m_slots.size()) return nullptr;
+            const Slot& slot = m_slots[low - 1];
+            if (!slot.live || slot.gen != (uint32_t)(h >> 32)) return nullptr;
+            return &slot;
+        }
+
+        // 从时间轮摘除并归还槽位（需持锁）
+        void Release(uint32_t index) {
+            Slot& slot = m_slots[index];
+            auto& bucket = m_wheel[slot.bucket];
+            const uint32_t last = bucket.back();
+            bucket[slot.pos] = last;
+            m_slots[last].pos = slot.pos;
+            bucket.pop_back();
+            slot.value = T{};
+            slot.live = false;
+            ++slot.gen;
+            m_free.push_back(index);
+            --m_size;
+        }
+
+        mutable std::mutex m_mtx;
+        std::vector<Slot> m_slots;
+        std::vector<uint32_t> m_free;
+        std::vector<uint32_t> m_wheel[WheelSlots];
+        uint64_t m_cursor = 0;   // 已推进到的刻度（now / GranularityMs）
+        bool m_started = false;
+        size_t m_size = 0;
+    };
+
+} // namespace Network
@@ -16,6 +16,17 @@
 #include "../core/Logger.hpp"
 
 namespace Network {
+
+    struct FakeIPStats {
+        uint64_t capacity = 0;      // 可分配地址数
+        uint64_t mapped = 0;        // 当前本进程映射条目数
+        uint64_t allocations = 0;   // 新分配次数
+        uint64_t allocHits = 0;     // 域名已有映射、直接复用的次数
+        uint64_t evictions = 0;     // 游标回绕后覆盖旧映射的次数
+        uint64_t lookupHits = 0;    // 反查命中本进程映射
+        uint64_t sharedHits = 0;    // 反查由跨进程共享映射回填
+        uint64_t lookupMisses = 0;  // 反查 FakeIP 网段地址未命中
+    };
     
     // FakeIP 管理器 (Ring Buffer 策略)
     // 默认使用 198.18.0.0/15 (保留用于基准测试的网络，不容易冲突)
@@ -29,6 +40,7 @@ namespace Network {
         uint32_t m_mask;        // 子网掩码 (host order)
         uint32_t m_networkSize; // 可用 IP 数量
         uint32_t m_cursor;      // 当前分配游标 (0 ~ networkSize-1)
+        FakeIPStats m_stats;    // 受 m_mtx 保护
 
         // ============= 跨进程共享映射（最佳努力） =============
         static constexpr uint32_t kSharedMagic = 0x4650494D; // "FIPM"
@@ -153,15 +165,15 @@ namespace Network {
                     m_networkSize = ~m_mask + 1; // e.g. /24 -> 256
                     // FIX-4: 边界检查 - 网段过小会导致分配失败或频繁回绕
                     if (m_networkSize <= 2) {
-                        Core::Logger::Warn("FakeIP: CIDR 网段过小 (容量=" + std::to_string(m_networkSize) + 
-                                           ")，建议使用 /24 或更大网段");
+                        AGP_LOG_WARN(FakeIP, "FakeIP: CIDR 网段过小 (容量=" + std::to_string(m_networkSize) + 
+                                             ")，建议使用 /24 或更大网段");
                     }
                     // 保留 .0 和最后一个地址（广播）? FakeIP 场景下通常都可以用，
                     // 但为了规避某些系统行为，跳过第0个和最后一个是个好习惯。
-                    Core::Logger::Info("FakeIP: 初始化成功, CIDR=" + cidr +
-                                       ", 容量=" + std::to_string(m_networkSize));
+                    AGP_LOG_INFO(FakeIP, "FakeIP: 初始化成功, CIDR=" + cidr +
+                                         ", 容量=" + std::to_string(m_networkSize));
                 } else {
-                    Core::Logger::Error("FakeIP: CIDR 解析失败 (" + cidr + ")，回退到 198.18.0.0/15");
+                    AGP_LOG_ERROR(FakeIP, "FakeIP: CIDR 解析失败 (" + cidr + ")，回退到 198.18.0.0/15");
                     ParseCidr("198.18.0.0/15", m_baseIp, m_mask);
                     m_networkSize = ~m_mask + 1;
                 }
@@ -236,16 +248,15 @@ namespace Network {
             auto it = m_domainToIp.find(domain);
             if (it != m_domainToIp.end()) {
                 // 可选：更新 LRU？Ring Buffer 不需要 LRU，由于空间只要够大，复用率低
-                if (Core::Logger::IsEnabled(Core::LogLevel::Debug)) {
-                    Core::Logger::Debug("FakeIP: 命中 " + domain + " -> " + IpToString(htonl(it->second)));
-                }
+                ++m_stats.allocHits;
+                AGP_LOG_DEBUG(FakeIP, "FakeIP: 命中 " + domain + " -> " + IpToString(htonl(it->second)));
                 return htonl(it->second);
             }
             
             // 2. 分配新 IP
             if (m_networkSize <= 2) {
                 // 防御性检查：网段过小会导致无法分配（此处记录告警便于排障）
-                Core::Logger::Warn("FakeIP: 地址池过小，无法分配 (networkSize=" + std::to_string(m_networkSize) + ")");
+                AGP_LOG_WARN(FakeIP, "FakeIP: 地址池过小，无法分配 (networkSize=" + std::to_string(m_networkSize) + ")");
                 return 0;
             }
 
@@ -254,7 +265,7 @@ namespace Network {
             // 简单的 Ring Buffer: 超过范围回到 1
             if (m_cursor >= m_networkSize - 1) { 
                 m_cursor = 1; 
-                Core::Logger::Debug("FakeIP: 地址池循环回绕");
+                AGP_LOG_DEBUG(FakeIP, "FakeIP: 地址池循环回绕");
             }
 
             uint32_t newIp = m_baseIp | offset;
@@ -264,21 +275,20 @@ namespace Network {
             if (oldIt != m_ipToDomain.end()) {
                 // 把旧域名从反向表中移除
                 m_domainToIp.erase(oldIt->second);
-                if (Core::Logger::IsEnabled(Core::LogLevel::Debug)) {
-                    Core::Logger::Debug("FakeIP: 回收 " + IpToString(htonl(newIp)) + " (原域名: " + oldIt->second + ")");
-                }
+                ++m_stats.evictions;
+                AGP_LOG_DEBUG(FakeIP, "FakeIP: 回收 " + IpToString(htonl(newIp)) + " (原域名: " + oldIt->second + ")");
             }
 
             // 4. 建立新映射
             m_ipToDomain[newIp] = domain;
             m_domainToIp[domain] = newIp;
+            ++m_stats.allocations;
 
             // 同步写入跨进程共享映射，降低多进程 miss 概率
             SharedPut(newIp, domain);
             
-            if (Core::Logger::IsEnabled(Core::LogLevel::Debug)) {
-                Core::Logger::Debug("FakeIP: 分配 " + IpToString(htonl(newIp)) + " -> " + domain);
-            }
+            AGP_LOG_DEBUG(FakeIP, "FakeIP: 分配 " + IpToString(htonl(newIp)) + " -> " + domain);
+            AGP_FLIGHT_RECORD(FakeIpAssign, IpToString(htonl(newIp)), Core::LogHost(domain));
             return htonl(newIp);
         }
         
@@ -290,9 +300,9 @@ namespace Network {
             
             auto it = m_ipToDomain.find(ip);
             if (it != m_ipToDomain.end()) {
-                if (Core::Logger::IsEnabled(Core::LogLevel::Debug)) {
-                    Core::Logger::Debug("FakeIP: 查询命中 " + IpToString(ipNetworkOrder) + " -> " + it->second);
-                }
+                ++m_stats.lookupHits;
+                AGP_LOG_DEBUG(FakeIP, "FakeIP: 查询命中 " + IpToString(ipNetworkOrder) + " -> " + it->second);
+                AGP_FLIGHT_RECORD(FakeIpLookup, IpToString(ipNetworkOrder), Core::LogHost(it->second));
                 return it->second;
             }
 
@@ -301,22 +311,36 @@ namespace Network {
             if (!sharedDomain.empty()) {
                 m_ipToDomain[ip] = sharedDomain;
                 m_domainToIp[sharedDomain] = ip;
-                if (Core::Logger::IsEnabled(Core::LogLevel::Debug)) {
-                    Core::Logger::Debug("FakeIP: 共享映射命中 " + IpToString(ipNetworkOrder) + " -> " + sharedDomain);
-                }
+                ++m_stats.sharedHits;
+                AGP_LOG_DEBUG(FakeIP, "FakeIP: 共享映射命中 " + IpToString(ipNetworkOrder) + " -> " + sharedDomain);
+                AGP_FLIGHT_RECORD(FakeIpLookup, IpToString(ipNetworkOrder), Core::LogHost(sharedDomain));
                 return sharedDomain;
             }
 
             // 如果是 FakeIP 网段内地址但查不到，通常意味着已回收/未分配或上下文不一致
             const bool isFake = ((ip & m_mask) == m_baseIp);
             if (isFake) {
-                Core::Logger::Warn("FakeIP: 查询未命中 " + IpToString(ipNetworkOrder) + "，可能已回收或未分配");
-            } else if (Core::Logger::IsEnabled(Core::LogLevel::Debug)) {
-                Core::Logger::Debug("FakeIP: 查询非 FakeIP 地址 " + IpToString(ipNetworkOrder) + "，忽略");
+                ++m_stats.lookupMisses;
+                AGP_LOG_LIMITED_WARN(FakeIP, "FakeIP: 查询未命中 " + IpToString(ipNetworkOrder) + "，可能已回收或未分配");
+                AGP_FLIGHT_RECORD(FakeIpLookup, IpToString(ipNetworkOrder), "(未命中)");
+                // 未命中通常是更早的分配/回收或跨进程时序导致：附上最近的上下文便于复盘
+                Core::Logger::TriggerFlightDump("FakeIP 查询未命中");
+            } else if (AGP_LOG_ENABLED(FakeIP, Debug)) {
+                AGP_LOG_DEBUG(FakeIP, "FakeIP: 查询非 FakeIP 地址 " + IpToString(ipNetworkOrder) + "，忽略");
             }
             return "";
         }
         
+        // 统计快照（供指标端点读取）
+        FakeIPStats GetStats() {
+            EnsureInitialized();
+            std::lock_guard<std::mutex> lock(m_mtx);
+            FakeIPStats s = m_stats;
+            s.capacity = m_networkSize > 2 ? m_networkSize - 2 : 0;
+            s.mapped = m_ipToDomain.size();
+            return s;
+        }
+        
         // 辅助函数：IP 转字符串
         static std::string IpToString(uint32_t ipNetworkOrder) {
             char buf[INET_ADDRSTRLEN];
@@ -0,0 +1,44 @@
+#pragma once
+#include <cstdint>
+
+namespace Network {
+
+    // 代理握手结果分类
+    // 设计意图：熔断器只应统计“代理本身不可用”的失败；代理正常应答但目标拒绝/不可达时，
+    // 代理路径是健康的，若计为上游失败，应用反复重试单个失效目标就会打开熔断、拖垮所有目标。
+    // 说明：本模块不依赖 Logger/Winsock，可在任意平台独立测试。
+    enum class HandshakeResult : uint8_t {
+        Ok = 0,
+        ProxyError,  // 传输失败/超时/协议违例/代理不支持：计入上游失败
+        TargetError, // 代理按协议应答了目标失败（或请求本身无效）：代理可用
+    };
+
+    // 握手分阶段计时：认证协商只涉及代理本身，可用于估计代理往返时间；
+    // CONNECT 应答包含代理连接目标的时间，不参与估计
+    struct HandshakeTiming {
+        bool greetingDone = false; // false：在认证协商阶段失败（或未开始）
+        uint64_t greetingUs = 0;
+    };
+
+    inline const char* HandshakeResultName(HandshakeResult r) {
+        switch (r) {
+            case HandshakeResult::Ok: return "ok";
+            case HandshakeResult::TargetError: return "target";
+            default: return "proxy";
+        }
+    }
+
+    // SOCKS5 CONNECT 应答（REP != 0）分类：
+    // 0x07（不支持 CONNECT）说明代理本身不可用；其余均为代理对该目标的结论（含 0x01 通用失败，多数实现用它表示拨号失败）
+    inline HandshakeResult ClassifySocks5Reply(uint8_t rep) {
+        if (rep == 0x00) return HandshakeResult::Ok;
+        return rep == 0x07 ? HandshakeResult::ProxyError : HandshakeResult::TargetError;
+    }
+
+    // HTTP CONNECT 状态码分类：407（需要代理认证）是代理配置问题；其余非 200 为代理对该目标的结论（403/502/503/504 等）
+    inline HandshakeResult ClassifyHttpConnectStatus(int status) {
+        if (status == 200) return HandshakeResult::Ok;
+        if (status < 100 || status > 599 || status == 407) return HandshakeResult::ProxyError;
+        return HandshakeResult::TargetError;
+    }
+}
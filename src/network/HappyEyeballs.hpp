@@ -0,0 +1,172 @@
+#pragma once
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+#include "SocketIo.hpp"
+
+namespace Network {
+
+    // 代理地址竞速连接（RFC 8305 Happy Eyeballs 的最小实现）
+    // 设计意图：代理主机名解析出多个地址（A/AAAA）时，若首选地址族被黑洞，单地址连接会耗满 connect 超时；
+    // 这里按族交替排序后错峰（默认 250ms）发起非阻塞 connect，谁先连通用谁，其余立即关闭。
+    // 说明：沿用 SocketIo 的 “非阻塞 connect + poll 等待 + SO_ERROR 判定” 模式；
+    //       connect/closesocket 由调用方传入（Hooks 层传原始函数，避免重入自身 Hook）。
+    // 说明：本文件经 SocketCompat 适配，可在非 Windows 平台独立测试。
+    namespace HappyEyeballs {
+
+        constexpr int kDefaultStaggerMs = 250;
+
+        struct Candidate {
+            sockaddr_storage addr{};
+            int addrLen = 0;
+        };
+
+        struct RaceResult {
+            SOCKET sock = INVALID_SOCKET; // 胜出的已连接 socket（非阻塞模式，由调用方决定是否切回阻塞）
+            size_t winnerIndex = 0;       // 胜出候选在排序后列表中的下标
+            int attempts = 0;             // 实际发起的 connect 次数
+            int lastError = 0;            // 全部失败时的最后一个错误码
+            long long elapsedMs = 0;
+        };
+
+        typedef int (WSAAPI *ConnectFn)(SOCKET, const struct sockaddr*, int);
+        typedef int (WSAAPI *CloseFn)(SOCKET);
+
+        // 按地址族交替排序（首选族在前），同族内保持解析器给出的相对顺序
+        inline std::vector<Candidate> Interleave(const std::vector<Candidate>& in, int preferredFamily) {
+            std::vector<Candidate> first;
+            std::vector<Candidate> second;
+            for (const auto& c : in) {
+                if (c.addr.ss_family == preferredFamily) first.push_back(c);
+                else second.push_back(c);
+            }
+            std::vector<Candidate> out;
+            out.reserve(in.size());
+            size_t i = 0, j = 0;
+            while (i < first.size() || j < second.size()) {
+                if (i < first.size()) out.push_back(first[i++]);
+                if (j < second.size()) out.push_back(second[j++]);
+            }
+            return out;
+        }
+
+        // 竞速连接：candidates 需已按期望顺序排列；timeoutMs 为整体预算
+        // 成功返回 true 并填充 result->sock；失败时 WSAGetLastError 为最后一个错误码（全部超时为 WSAETIMEDOUT）
+        inline bool Race(const std::vector<Candidate>& candidates, int staggerMs, int timeoutMs,
+                         ConnectFn connectFn, CloseFn closeFn, RaceResult* result) {
+            RaceResult local;
+            RaceResult& r = result ? *result : local;
+            r = RaceResult{};
+            if (candidates.empty() || !connectFn) {
+                WSASetLastError(WSAEINVAL);
+                return false;
+            }
+            if (staggerMs <= 0) staggerMs = kDefaultStaggerMs;
+            auto closeSock = [closeFn](SOCKET s) {
+                if (closeFn) closeFn(s);
+                else closesocket(s);
+            };
+
+            struct Attempt {
+                SOCKET sock;
+                size_t index;
+            };
+            std::vector<Attempt> inflight;
+            const auto start = std::chrono::steady_clock::now();
+            const auto deadline = SocketIo::BuildDeadline(timeoutMs);
+            auto nextStartAt = start;
+            size_t next = 0;
+            r.lastError = WSAETIMEDOUT;
+
+            auto finish = [&](SOCKET winner, size_t index) {
+                for (const auto& a : inflight) {
+                    if (a.sock != winner) closeSock(a.sock);
+                }
+                inflight.clear();
+                r.sock = winner;
+                r.winnerIndex = index;
+                r.elapsedMs = std::chrono::duration_cast<std::chrono::milliseconds>(
+                    std::chrono::steady_clock::now() - start).count();
+            };
+
+            while (true) {
+                auto now = std::chrono::steady_clock::now();
+                // 到达错峰时间，或当前没有在途尝试（上一个已快速失败）时，立即发起下一个候选
+                if (next < candidates.size() && (now >= nextStartAt || inflight.empty())) {
+                    const Candidate& c = candidates[next];
+                    const size_t index = next++;
+                    nextStartAt = now + std::chrono::milliseconds(staggerMs);
+                    SOCKET s = socket(c.addr.ss_family, SOCK_STREAM, IPPROTO_TCP);
+                    if (s == INVALID_SOCKET) {
+                        r.lastError = WSAGetLastError();
+                        continue;
+                    }
+                    r.attempts++;
+                    unsigned long nb = 1;
+                    ioctlsocket(s, FIONBIO, &nb);
+                    if (connectFn(s, (const sockaddr*)&c.addr, c.addrLen) == 0) {
+                        finish(s, index);
+                        return true;
+                    }
+                    const int err = WSAGetLastError();
+                    if (err != WSAEWOULDBLOCK && err != WSAEINPROGRESS) {
+                        r.lastError = err;
+                        closeSock(s);
+                        continue;
+                    }
+                    inflight.push_back(Attempt{s, index});
+                }
+
+                if (inflight.empty()) {
+                    if (next >= candidates.size()) break;
+                    continue;
+                }
+
+                int waitMs = SocketIo::RemainingTimeoutMs(deadline);
+                if (waitMs <= 0) break;
+                if (next < candidates.size()) {
+                    const auto untilNext = std::chrono::duration_cast<std::chrono::milliseconds>(
+                        nextStartAt - std::chrono::steady_clock::now()).count();
+                    if (untilNext < waitMs) waitMs = untilNext > 0 ? (int)untilNext : 0;
+                }
+
+                std::vector<SocketCompat::PollFd> fds(inflight.size());
+                for (size_t i = 0; i < inflight.size(); ++i) {
+                    fds[i].fd = inflight[i].sock;
+                    fds[i].events = POLLOUT; // 连接失败通过 POLLERR/POLLHUP 通知
+                }
+                const int rc = SocketCompat::Poll(fds.data(), (unsigned long)fds.size(), waitMs);
+                if (rc < 0) {
+                    r.lastError = WSAGetLastError();
+                    break;
+                }
+                if (rc == 0) continue;
+
+                // 从后向前处理，删除在途尝试不影响尚未检查的下标
+                for (size_t i = inflight.size(); i-- > 0; ) {
+                    const short revents = fds[i].revents;
+                    if (revents == 0) continue;
+                    const Attempt a = inflight[i];
+                    int soError = 0;
+                    SocketCompat::SockLen optLen = sizeof(soError);
+                    if (getsockopt(a.sock, SOL_SOCKET, SO_ERROR, (char*)&soError, &optLen) == 0 && soError == 0 &&
+                        (revents & POLLOUT) && !(revents & (POLLERR | POLLHUP | POLLNVAL))) {
+                        finish(a.sock, a.index);
+                        return true;
+                    }
+                    r.lastError = soError != 0 ? soError : WSAECONNREFUSED;
+                    closeSock(a.sock);
+                    inflight.erase(inflight.begin() + (std::ptrdiff_t)i);
+                }
+            }
+
+            for (const auto& a : inflight) closeSock(a.sock);
+            r.elapsedMs = std::chrono::duration_cast<std::chrono::milliseconds>(
+                std::chrono::steady_clock::now() - start).count();
+            WSASetLastError(r.lastError);
+            return false;
+        }
+
+    } // namespace HappyEyeballs
+} // namespace Network
@@ -8,6 +8,7 @@
 #include <iomanip>
 #include "../core/Config.hpp"
 #include "../core/Logger.hpp"
+#include "HandshakeResult.hpp"
 #include "SocketIo.hpp"
 
 namespace Network {
@@ -27,13 +28,11 @@ namespace Network {
          * @param sock 已连接到代理服务器的 socket
          * @param targetHost 目标主机 (域名或IP)
          * @param targetPort 目标端口
-         * @return true 表示隧道建立成功
+         * @return Ok 表示隧道建立成功；代理返回非 200 状态码时按状态码区分 ProxyError/TargetError
          */
-        static bool Handshake(SOCKET sock, const std::string& targetHost, uint16_t targetPort, int handshakeBudgetMs = -1) {
-            if (Core::Logger::IsEnabled(Core::LogLevel::Debug)) {
-                Core::Logger::Debug("HTTP CONNECT: 开始握手, sock=" + std::to_string((unsigned long long)sock) +
-                                    ", 目标=" + targetHost + ":" + std::to_string(targetPort));
-            }
+        static HandshakeResult Handshake(SOCKET sock, const std::string& targetHost, uint16_t targetPort, int handshakeBudgetMs = -1) {
+            AGP_LOG_DEBUG(Http, "HTTP CONNECT: 开始握手, sock=" + std::to_string((unsigned long long)sock) +
+                                ", 目标=" + targetHost + ":" + std::to_string(targetPort));
 
             // 构造 CONNECT 请求
             // 格式: CONNECT host:port HTTP/1.1\r\nHost: host:port\r\n\r\n
@@ -63,78 +62,73 @@ namespace Network {
             auto stepTimeout = [&](int fallbackMs, const char* stage) -> int {
                 const int timeoutMs = RemainingTimeoutMs(deadline, fallbackMs);
                 if (timeoutMs <= 0) {
-                    Core::Logger::Error(std::string("HTTP CONNECT: ") + stage + " 握手预算耗尽, sock=" +
+                    AGP_LOG_ERROR(Http, std::string("HTTP CONNECT: ") + stage + " 握手预算耗尽, sock=" +
                                         std::to_string((unsigned long long)sock));
                 }
                 return timeoutMs;
             };
 
-            if (Core::Logger::IsEnabled(Core::LogLevel::Debug)) {
-                Core::Logger::Debug("HTTP CONNECT: 发送请求, sock=" + std::to_string((unsigned long long)sock) +
-                                    ", line=\"" + FirstLine(requestStr) + "\"" +
-                                    ", 预算=" + std::to_string(handshakeBudgetMs) + "ms");
-            }
+            AGP_LOG_DEBUG(Http, "HTTP CONNECT: 发送请求, sock=" + std::to_string((unsigned long long)sock) +
+                                ", line=\"" + FirstLine(requestStr) + "\"" +
+                                ", 预算=" + std::to_string(handshakeBudgetMs) + "ms");
             
             // 发送 CONNECT 请求
             // 使用统一 IO 封装，兼容非阻塞套接字
             const int sendStepTimeout = stepTimeout(sendTimeout, "发送请求");
-            if (sendStepTimeout <= 0) return false;
+            if (sendStepTimeout <= 0) return HandshakeResult::ProxyError;
             if (!SocketIo::SendAll(sock, requestStr.c_str(), (int)requestStr.length(), sendStepTimeout)) {
                 int err = WSAGetLastError();
-                Core::Logger::Error("HTTP CONNECT: 发送请求失败, sock=" + std::to_string((unsigned long long)sock) +
+                AGP_LOG_ERROR(Http, "HTTP CONNECT: 发送请求失败, sock=" + std::to_string((unsigned long long)sock) +
                                     ", WSA错误码=" + std::to_string(err) +
                                     ", line=\"" + FirstLine(requestStr) + "\"");
-                return false;
-            }
-            if (Core::Logger::IsEnabled(Core::LogLevel::Debug)) {
-                Core::Logger::Debug("HTTP CONNECT: 请求已发送, sock=" + std::to_string((unsigned long long)sock) +
-                                    ", bytes=" + std::to_string(requestStr.size()));
+                return HandshakeResult::ProxyError;
             }
+            AGP_LOG_DEBUG(Http, "HTTP CONNECT: 请求已发送, sock=" + std::to_string((unsigned long long)sock) +
+                                ", bytes=" + std::to_string(requestStr.size()));
             
             // 接收响应
             // HTTP 响应头格式: HTTP/1.x 200 ...\r\n...\r\n\r\n
             std::string response;
             const int recvStepTimeout = stepTimeout(recvTimeout, "接收响应");
-            if (recvStepTimeout <= 0) return false;
+            if (recvStepTimeout <= 0) return HandshakeResult::ProxyError;
             if (!SocketIo::RecvUntil(sock, &response, "\r\n\r\n", recvStepTimeout, 1024)) {
                 int err = WSAGetLastError();
                 if (err == WSAEMSGSIZE) {
-                    Core::Logger::Error("HTTP CONNECT: 响应头过长或不完整, sock=" + std::to_string((unsigned long long)sock));
+                    AGP_LOG_ERROR(Http, "HTTP CONNECT: 响应头过长或不完整, sock=" + std::to_string((unsigned long long)sock));
                 }
-                Core::Logger::Error("HTTP CONNECT: 接收响应失败, sock=" + std::to_string((unsigned long long)sock) +
+                AGP_LOG_ERROR(Http, "HTTP CONNECT: 接收响应失败, sock=" + std::to_string((unsigned long long)sock) +
                                     ", WSA错误码=" + std::to_string(err));
-                return false;
-            }
-            if (Core::Logger::IsEnabled(Core::LogLevel::Debug)) {
-                Core::Logger::Debug("HTTP CONNECT: 收到响应头, sock=" + std::to_string((unsigned long long)sock) +
-                                    ", line=\"" + FirstLine(response) + "\", bytes=" + std::to_string(response.size()));
+                return HandshakeResult::ProxyError;
             }
+            AGP_LOG_DEBUG(Http, "HTTP CONNECT: 收到响应头, sock=" + std::to_string((unsigned long long)sock) +
+                                ", line=\"" + FirstLine(response) + "\", bytes=" + std::to_string(response.size()));
             
             // 解析状态码
             // 期望格式: HTTP/1.x 200 ...
             int statusCode = ParseStatusCode(response);
+            AGP_FLIGHT_RECORD(HttpConnectStatus, sock, statusCode);
             if (statusCode == -1) {
-                Core::Logger::Error("HTTP CONNECT: 解析响应状态码失败, sock=" + std::to_string((unsigned long long)sock) +
+                AGP_LOG_ERROR(Http, "HTTP CONNECT: 解析响应状态码失败, sock=" + std::to_string((unsigned long long)sock) +
                                     ", line=\"" + FirstLine(response) + "\"");
-                Core::Logger::Error("HTTP CONNECT: 响应内容(前256B): " + response.substr(0, 256));
-                Core::Logger::Error("HTTP CONNECT: 响应摘要(hex前64B): " +
+                AGP_LOG_ERROR(Http, "HTTP CONNECT: 响应内容(前256B): " + response.substr(0, 256));
+                AGP_LOG_ERROR(Http, "HTTP CONNECT: 响应摘要(hex前64B): " +
                                     HexDump((const uint8_t*)response.data(), response.size(), 64));
-                return false;
+                return HandshakeResult::ProxyError;
             }
             
             if (statusCode != 200) {
-                Core::Logger::Error("HTTP CONNECT: 代理返回状态码 " + std::to_string(statusCode) +
+                AGP_LOG_ERROR(Http, "HTTP CONNECT: 代理返回状态码 " + std::to_string(statusCode) +
                                     ", sock=" + std::to_string((unsigned long long)sock) +
                                     ", line=\"" + FirstLine(response) + "\"");
-                Core::Logger::Error("HTTP CONNECT: 响应内容(前256B): " + response.substr(0, 256));
-                Core::Logger::Error("HTTP CONNECT: 响应摘要(hex前64B): " +
+                AGP_LOG_ERROR(Http, "HTTP CONNECT: 响应内容(前256B): " + response.substr(0, 256));
+                AGP_LOG_ERROR(Http, "HTTP CONNECT: 响应摘要(hex前64B): " +
                                     HexDump((const uint8_t*)response.data(), response.size(), 64));
-                return false;
+                return ClassifyHttpConnectStatus(statusCode);
             }
             
-            Core::Logger::Info("HTTP CONNECT: 隧道建立成功, sock=" + std::to_string((unsigned long long)sock) +
+            AGP_LOG_INFO(Http, "HTTP CONNECT: 隧道建立成功, sock=" + std::to_string((unsigned long long)sock) +
                                ", 目标=" + targetHost + ":" + std::to_string(targetPort));
-            return true;
+            return HandshakeResult::Ok;
         }
         
     private:
@@ -0,0 +1,296 @@
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "SocketCompat.hpp"
+#include "SocketIo.hpp"
+
+namespace Network {
+
+    // 指标端点内部 socket 使用的函数表；Hooks 层传入原始函数，避免抓取连接自身的收发/关闭被 Hook 统计
+    // 留空的项使用系统默认实现
+    struct MetricsSocketApi {
+        int (WSAAPI *sendFn)(SOCKET, const char*, int, int) = nullptr;
+        int (WSAAPI *recvFn)(SOCKET, char*, int, int) = nullptr;
+        int (WSAAPI *closeFn)(SOCKET) = nullptr;
+    };
+
+    struct MetricsServerStats {
+        uint64_t requests = 0;  // 已应答的请求数（含 404/405）
+        uint64_t scrapes = 0;   // 成功返回指标的请求数
+        uint64_t rejected = 0;  // 请求行无效、超时或过长而直接关闭的连接数
+    };
+
+    struct HttpRequestLine {
+        std::string method;
+        std::string path;  // 已去掉查询串
+    };
+
+    // 解析请求头的第一行（"GET /metrics HTTP/1.1"）；只接受 HTTP/1.x
+    inline bool ParseHttpRequestLine(const std::string& head, HttpRequestLine* out) {
+        if (!out) return false;
+        const size_t eol = head.find("\r\n");
+        const std::string line = head.substr(0, eol);
+        const size_t sp1 = line.find(' ');
+        if (sp1 == std::string::npos || sp1 == 0) return false;
+        const size_t sp2 = line.find(' ', sp1 + 1);
+        if (sp2 == std::string::npos || sp2 == sp1 + 1) return false;
+        if (line.compare(sp2 + 1, 7, "HTTP/1.") != 0) return false;
+        out->method = line.substr(0, sp1);
+        out->path = line.substr(sp1 + 1, sp2 - sp1 - 1);
+        const size_t query = out->path.find('?');
+        if (query != std::string::npos) out->path.resize(query);
+        return !out->path.empty() && out->path[0] == '/';
+    }
+
+    inline std::string BuildHttpResponse(int status, const char* reason, const char* contentType,
+                                         const std::string& body, bool includeBody) {
+        std::string out = "HTTP/1.1 " + std::to_string(status) + " " + reason + "\r\n";
+        out += "Content-Type: ";
+        out += contentType;
+        out += "\r\nContent-Length: " + std::to_string(body.size()) + "\r\n";
+        if (status == 405) out += "Allow: GET, HEAD\r\n";
+        out += "Connection: close\r\n\r\n";
+        if (includeBody) out += body;
+        return out;
+    }
+
+    // 回环指标端点：在 127.0.0.1 上提供 GET /metrics（Prometheus 文本格式）
+    // 设计意图：抓取完全在独立线程中完成，Hook 线程只负责更新原子计数；端点只绑定回环地址，不对外暴露。
+    // 工作方式：
+    // - 从 basePort 起依次尝试 portRange 个端口（同一台机器上多个被注入进程各占一个），basePort=0 时由系统分配；
+    // - 单线程 select 循环：逐个接受连接、读取请求头、返回响应并关闭（Connection: close），
+    //   单个连接的读写各有超时，慢客户端不会长期占住线程；
+    // - 指标正文由调用方注入的回调在抓取线程中生成；AddPage 可追加其他只读页面（同样在抓取线程中生成）。
+    // 说明：不依赖 Logger/Config；本文件经 SocketCompat 适配，可在非 Windows 平台独立测试。
+    class MetricsServer : public std::enable_shared_from_this<MetricsServer> {
+    public:
+        using Renderer = std::function<std::string()>;
+
+        static constexpr size_t kMaxRequestBytes = 8192;
+        static constexpr int kClientTimeoutMs = 2000;
+
+        // 绑定并开始监听；成功后启动后台线程。失败时返回 false 并保留 WSA 错误码
+        bool Start(uint16_t basePort, int portRange, Renderer renderer, const MetricsSocketApi& api = MetricsSocketApi()) {
+            if (!renderer || m_started.exchange(true)) {
+                WSASetLastError(WSAEINVAL);
+                return false;
+            }
+            m_api = api;
+            m_renderer = std::move(renderer);
+            if (portRange <= 0 || basePort == 0) portRange = 1;
+
+            int lastErr = WSAEINVAL;
+            for (int i = 0; i < portRange && (int)basePort + i <= 65535; ++i) {
+                SOCKET s = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+                if (s == INVALID_SOCKET) {
+                    lastErr = WSAGetLastError();
+                    break;
+                }
+                sockaddr_in addr{};
+                addr.sin_family = AF_INET;
+                addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+                addr.sin_port = htons((uint16_t)(basePort == 0 ? 0 : basePort + i));
+#ifdef _WIN32
+                // 防止其他进程以 SO_REUSEADDR 抢占同一端口
+                const BOOL exclusive = TRUE;
+                setsockopt(s, SOL_SOCKET, SO_EXCLUSIVEADDRUSE, (const char*)&exclusive, sizeof(exclusive));
+#endif
+                if (bind(s, (const sockaddr*)&addr, sizeof(addr)) == 0 && listen(s, 16) == 0) {
+                    socklen_t len = sizeof(addr);
+                    if (getsockname(s, (sockaddr*)&addr, &len) == 0) {
+                        m_listen = s;
+                        m_port = ntohs(addr.sin_port);
+                        break;
+                    }
+                }
+                lastErr = WSAGetLastError();
+                CloseSock(s);
+            }
+            if (m_listen == INVALID_SOCKET) {
+                m_started = false;
+                WSASetLastError(lastErr);
+                return false;
+            }
+            unsigned long nb = 1;
+            ioctlsocket(m_listen, FIONBIO, &nb);
+
+            // 线程持有自身引用并立即 detach：Stop 可在 Loader Lock 中调用而无需 join
+            auto self = shared_from_this();
+            std::thread([self]() { self->Loop(); }).detach();
+            return true;
+        }
+
+        uint16_t Port() const { return m_port; }
+
+        // 追加一个只读页面（GET/HEAD）；须在 Start 之前调用
+        void AddPage(const std::string& path, const char* contentType, Renderer renderer) {
+            if (m_started.load() || !renderer || path.empty() || path[0] != '/') return;
+            m_pages.push_back(Page{path, contentType, std::move(renderer)});
+        }
+
+        // 发出停止信号；waitMs>0 时最多等待线程退出（DLL 卸载路径应传 0）
+        void Stop(int waitMs = 0) {
+            m_stop = true;
+            if (waitMs <= 0) return;
+            std::unique_lock<std::mutex> lock(m_exitMtx);
+            m_exitCv.wait_for(lock, std::chrono::milliseconds(waitMs), [this]() { return m_exited; });
+        }
+
+        MetricsServerStats GetStats() const {
+            MetricsServerStats s;
+            s.requests = m_requests.load(std::memory_order_relaxed);
+            s.scrapes = m_scrapes.load(std::memory_order_relaxed);
+            s.rejected = m_rejected.load(std::memory_order_relaxed);
+            return s;
+        }
+
+    private:
+        void CloseSock(SOCKET s) {
+            if (s == INVALID_SOCKET) return;
+            if (m_api.closeFn) m_api.closeFn(s);
+            else closesocket(s);
+        }
+
+        int ApiSend(SOCKET s, const char* data, int len) {
+#ifdef MSG_NOSIGNAL
+            const int flags = MSG_NOSIGNAL; // 客户端提前断开时不触发 SIGPIPE
+#else
+            const int flags = 0;
+#endif
+            return m_api.sendFn ? m_api.sendFn(s, data, len, flags) : (int)send(s, data, len, flags);
+        }
+
+        int ApiRecv(SOCKET s, char* buf, int cap) {
+            return m_api.recvFn ? m_api.recvFn(s, buf, cap, 0) : (int)recv(s, buf, cap, 0);
+        }
+
+        // 等待 socket 可读/可写，最多到 deadline；超时或出错返回 false
+        static bool WaitReady(SOCKET s, bool write, const std::chrono::steady_clock::time_point& deadline) {
+            const int remainMs = SocketIo::RemainingTimeoutMs(deadline);
+            if (remainMs <= 0) return false;
+            return SocketIo::WaitReady(s, write ? POLLOUT : POLLIN, remainMs);
+        }
+
+        // 读取到请求头结束（空行）为止；请求体（如有）忽略
+        bool ReadRequestHead(SOCKET c, std::string* head) {
+            const auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(kClientTimeoutMs);
+            char buf[1024];
+            while (head->find("\r\n\r\n") == std::string::npos) {
+                if (head->size() >= kMaxRequestBytes) return false;
+                if (!WaitReady(c, false, deadline)) return false;
+                const int n = ApiRecv(c, buf, (int)sizeof(buf));
+                if (n > 0) {
+                    head->append(buf, (size_t)n);
+                    continue;
+                }
+                if (n == 0) return false;
+                const int err = WSAGetLastError();
+                if (err != WSAEWOULDBLOCK && err != WSAEINPROGRESS) return false;
+            }
+            return true;
+        }
+
+        bool SendAll(SOCKET c, const std::string& data) {
+            const auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(kClientTimeoutMs);
+            size_t off = 0;
+            while (off < data.size()) {
+                const size_t chunk = data.size() - off < 65536 ? data.size() - off : 65536;
+                const int n = ApiSend(c, data.data() + off, (int)chunk);
+                if (n > 0) {
+                    off += (size_t)n;
+                    continue;
+                }
+                const int err = WSAGetLastError();
+                if (n == 0 || (err != WSAEWOULDBLOCK && err != WSAEINPROGRESS)) return false;
+                if (!WaitReady(c, true, deadline)) return false;
+            }
+            return true;
+        }
+
+        void Serve(SOCKET c) {
+            unsigned long nb = 1;
+            ioctlsocket(c, FIONBIO, &nb);
+            std::string head;
+            HttpRequestLine req;
+            if (!ReadRequestHead(c, &head) || !ParseHttpRequestLine(head, &req)) {
+                m_rejected.fetch_add(1, std::memory_order_relaxed);
+                return;
+            }
+            const bool isHead = req.method == "HEAD";
+            std::string response;
+            if (req.method != "GET" && !isHead) {
+                response = BuildHttpResponse(405, "Method Not Allowed", "text/plain; charset=utf-8", "method not allowed\n", true);
+            } else if (req.path == "/metrics") {
+                response = BuildHttpResponse(200, "OK", "text/plain; version=0.0.4; charset=utf-8", m_renderer(), !isHead);
+                m_scrapes.fetch_add(1, std::memory_order_relaxed);
+            } else if (const Page* page = FindPage(req.path)) {
+                response = BuildHttpResponse(200, "OK", page->contentType, page->renderer(), !isHead);
+            } else {
+                response = BuildHttpResponse(404, "Not Found", "text/plain; charset=utf-8", "try /metrics\n", !isHead);
+            }
+            m_requests.fetch_add(1, std::memory_order_relaxed);
+            SendAll(c, response);
+        }
+
+        struct Page {
+            std::string path;
+            const char* contentType;
+            Renderer renderer;
+        };
+
+        const Page* FindPage(const std::string& path) const {
+            for (const Page& page : m_pages) {
+                if (page.path == path) return &page;
+            }
+            return nullptr;
+        }
+
+        void Loop() {
+            while (!m_stop.load()) {
+                SocketCompat::PollFd pfd{};
+                pfd.fd = m_listen;
+                pfd.events = POLLIN;
+                const int rc = SocketCompat::Poll(&pfd, 1, 200); // 定期醒来检查停止信号
+                if (rc < 0) break;
+                if (rc == 0) continue;
+                for (int i = 0; i < 16 && !m_stop.load(); ++i) {
+                    SOCKET c = accept(m_listen, nullptr, nullptr);
+                    if (c == INVALID_SOCKET) break;
+                    Serve(c);
+                    CloseSock(c);
+                }
+            }
+
+            CloseSock(m_listen);
+            m_listen = INVALID_SOCKET;
+            {
+                std::lock_guard<std::mutex> lock(m_exitMtx);
+                m_exited = true;
+            }
+            m_exitCv.notify_all();
+        }
+
+        MetricsSocketApi m_api;
+        Renderer m_renderer;
+        std::vector<Page> m_pages;
+        SOCKET m_listen = INVALID_SOCKET;
+        uint16_t m_port = 0;
+        std::atomic<bool> m_started{false};
+        std::atomic<bool> m_stop{false};
+        std::atomic<uint64_t> m_requests{0};
+        std::atomic<uint64_t> m_scrapes{0};
+        std::atomic<uint64_t> m_rejected{0};
+        std::mutex m_exitMtx;
+        std::condition_variable m_exitCv;
+        bool m_exited = false;
+    };
+}
@@ -0,0 +1,282 @@
+#pragma once
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#include <windows.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include "../core/Logger.hpp"
+#include "../core/Config.hpp"
+#include "Pcapng.hpp"
+
+namespace Network {
+
+    // 抓包：按流采样隧道内的收发负载，写入日志目录下的 proxy-YYYYMMDD-<PID>-<HHMMSS>.pcapng
+    // - 流在代理隧道就绪（TCP）或 UDP Associate 就绪（UDP）时决定是否采样：每 sample_every 个流采样 1 个
+    // - 热路径（send/recv/WSASend/WSARecv 等 detour）只判断 socket 是否被采样（一次原子读取），
+    //   命中时把前 snaplen 字节 memcpy 进环；环满计入丢弃，不阻塞调用方
+    // - 写线程把环中记录编码为 pcapng（合成 IP/TCP/UDP 头，见 Pcapng.hpp）并批量追加到文件
+    // - 文件超过 max_file_mb 时截断并重新写节头（与日志的覆盖写入一致），任何时刻都是可直接打开的完整文件
+    class PacketCapture {
+    public:
+        using Ring = CaptureRing<1024, 2048>;
+        static constexpr uint32_t kIdleWaitMs = 20;
+        static constexpr size_t kBatchBytes = 256 * 1024; // 单次写入的编码字节上限（也是截断判断的余量）
+        static constexpr size_t kMaxSegments = 8;         // snaplen 内最多拷贝的 WSABUF 个数
+
+        static PacketCapture& Instance() {
+            static PacketCapture instance;
+            return instance;
+        }
+
+        // Hooks::Install 时调用；未启用时不分配环，热路径只有一次原子读取
+        void Configure(const Core::CaptureConfig& config) {
+            if (!config.enabled || m_ring.load(std::memory_order_acquire)) return;
+            m_sampleEvery = (uint32_t)config.sample_every;
+            m_snapLen = (uint32_t)std::min<size_t>((size_t)config.snaplen, Ring::kSlotPayload);
+            m_maxFileBytes = (ULONGLONG)config.max_file_mb * 1024 * 1024;
+            m_encoder.reset(new PcapngWriter(m_snapLen));
+            // 环常驻到进程退出：卸载后仍可能有 detour 在途读取
+            m_ring.store(new Ring(), std::memory_order_release);
+            Core::Logger::Info("抓包: 已启用, 每 " + std::to_string(m_sampleEvery) + " 个流采样 1 个, snaplen=" +
+                               std::to_string(m_snapLen) + ", 文件上限=" + std::to_string(config.max_file_mb) + "MB" +
+                               ((size_t)config.snaplen > Ring::kSlotPayload ? " (snaplen 超出环槽位，已截为 " +
+                                    std::to_string(Ring::kSlotPayload) + ")" : std::string()));
+        }
+
+        // 隧道就绪时调用（冷路径）：按流采样，命中则记录端点并开始抓取该 socket
+        // proto 为 IPPROTO_TCP / IPPROTO_UDP；host/port 为原始目标（host 为 IP 字面量时直接使用，否则用占位地址）
+        void OnFlowOpen(SOCKET s, int proto, const std::string& host, uint16_t port) {
+            Ring* ring = m_ring.load(std::memory_order_acquire);
+            if (!ring || s == INVALID_SOCKET) return;
+            if (m_flowSeq.fetch_add(1, std::memory_order_relaxed) % m_sampleEvery != 0) return;
+
+            CaptureFlowInfo info;
+            info.proto = proto == IPPROTO_UDP ? 17 : 6;
+            sockaddr_storage local{};
+            int localLen = (int)sizeof(local);
+            if (getsockname(s, (sockaddr*)&local, &localLen) == 0) FillEndpoint((const sockaddr*)&local, &info.local);
+            info.remote.port = port;
+            if (inet_pton(AF_INET, host.c_str(), info.remote.addr) == 1) {
+                info.remote.family = 4;
+            } else if (inet_pton(AF_INET6, host.c_str(), info.remote.addr) == 1) {
+                info.remote.family = 6;
+            }
+            info.host = host;
+
+            uint8_t buf[kCaptureFlowInfoMaxBytes];
+            CaptureRecord rec;
+            rec.type = CaptureRecordType::FlowOpen;
+            rec.flow = (uint64_t)s;
+            rec.tsUs = NowUnixMicros();
+            rec.capLen = (uint32_t)SerializeCaptureFlowInfo(info, buf);
+            const CaptureSegment seg{buf, rec.capLen};
+            if (!ring->TryPush(rec, &seg, 1)) {
+                m_dropped.fetch_add(1, std::memory_order_relaxed);
+                return;
+            }
+            // 先入环再加入集合：其他线程随后的收发记录一定排在 FlowOpen 之后
+            m_flows.Insert((uintptr_t)s);
+            EnsureWriterStarted();
+        }
+
+        // 热路径：单个缓冲区（send/recv 等）
+        void Record(SOCKET s, CaptureDirection dir, const char* buf, size_t bufLen, uint64_t bytes) {
+            Ring* ring = m_ring.load(std::memory_order_acquire);
+            if (!ring || bytes == 0 || !m_flows.Contains((uintptr_t)s)) return;
+            const CaptureSegment seg{buf, (size_t)std::min<uint64_t>(bufLen, bytes)};
+            Push(ring, s, dir, &seg, 1, bytes);
+        }
+
+        // 热路径：分散缓冲区（WSASend/WSARecv 等）；只拷贝 snaplen 覆盖到的前几个缓冲区
+        void Record(SOCKET s, CaptureDirection dir, const WSABUF* bufs, DWORD count, uint64_t bytes) {
+            Ring* ring = m_ring.load(std::memory_order_acquire);
+            if (!ring || bytes == 0 || !bufs || !m_flows.Contains((uintptr_t)s)) return;
+            CaptureSegment segs[kMaxSegments];
+            size_t n = 0;
+            uint64_t covered = 0;
+            for (DWORD i = 0; i < count && n < kMaxSegments && covered < m_snapLen && covered < bytes; ++i) {
+                segs[n++] = CaptureSegment{bufs[i].buf, (size_t)std::min<uint64_t>(bufs[i].len, bytes - covered)};
+                covered += bufs[i].len;
+            }
+            Push(ring, s, dir, segs, n, bytes);
+        }
+
+        // closesocket 成功后调用：结束该流（TCP 合成 FIN）
+        void OnClose(SOCKET s) {
+            Ring* ring = m_ring.load(std::memory_order_acquire);
+            if (!ring || !m_flows.Erase((uintptr_t)s)) return;
+            CaptureRecord rec;
+            rec.type = CaptureRecordType::FlowClose;
+            rec.flow = (uint64_t)s;
+            rec.tsUs = NowUnixMicros();
+            if (!ring->TryPush(rec, nullptr, 0)) m_dropped.fetch_add(1, std::memory_order_relaxed);
+        }
+
+        // DLL 卸载时调用：停止写线程并在当前线程冲刷剩余记录，最后写入统计块并关闭文件
+        // 注意：处于 Loader Lock 中，不 join 写线程；消费锁限时获取（写线程可能已被系统终止）
+        void Shutdown() {
+            Ring* ring = m_ring.load(std::memory_order_acquire);
+            if (!ring) return;
+            m_stop.store(true, std::memory_order_release);
+            if (m_worker.joinable()) m_worker.detach();
+            std::unique_lock<std::timed_mutex> lock(m_consumeMtx, std::defer_lock);
+            if (!lock.try_lock_for(std::chrono::milliseconds(200))) return;
+            if (m_closed) return;
+            while (DrainLocked(ring)) {
+            }
+            if (m_file != INVALID_HANDLE_VALUE) {
+                std::string tail;
+                m_encoder->AppendStatistics(NowUnixMicros(), m_records, m_dropped.load(std::memory_order_relaxed), &tail);
+                WriteLocked(tail);
+                CloseHandle(m_file);
+                m_file = INVALID_HANDLE_VALUE;
+            }
+            m_closed = true;
+        }
+
+    private:
+        PacketCapture() = default;
+
+        static uint64_t NowUnixMicros() {
+            FILETIME ft;
+            GetSystemTimePreciseAsFileTime(&ft);
+            const uint64_t ticks = ((uint64_t)ft.dwHighDateTime << 32) | ft.dwLowDateTime; // 100ns，自 1601 年
+            return (ticks - 116444736000000000ull) / 10;
+        }
+
+        static void FillEndpoint(const sockaddr* addr, CaptureEndpoint* out) {
+            if (addr->sa_family == AF_INET) {
+                const sockaddr_in* v4 = (const sockaddr_in*)addr;
+                out->family = 4;
+                memcpy(out->addr, &v4->sin_addr, 4);
+                out->port = ntohs(v4->sin_port);
+            } else if (addr->sa_family == AF_INET6) {
+                const sockaddr_in6* v6 = (const sockaddr_in6*)addr;
+                out->family = 6;
+                memcpy(out->addr, &v6->sin6_addr, 16);
+                out->port = ntohs(v6->sin6_port);
+            }
+        }
+
+        void Push(Ring* ring, SOCKET s, CaptureDirection dir, const CaptureSegment* segs, size_t count, uint64_t bytes) {
+            CaptureRecord rec;
+            rec.type = CaptureRecordType::Data;
+            rec.dir = dir;
+            rec.flow = (uint64_t)s;
+            rec.tsUs = NowUnixMicros();
+            rec.origLen = (uint32_t)std::min<uint64_t>(bytes, 0xFFFFFFFFull);
+            rec.capLen = (uint32_t)std::min<uint64_t>(bytes, m_snapLen);
+            if (!ring->TryPush(rec, segs, count)) m_dropped.fetch_add(1, std::memory_order_relaxed);
+        }
+
+        // 写线程在首个被采样的流出现时启动（不在 DllMain 中创建线程）
+        void EnsureWriterStarted() {
+            std::call_once(m_startOnce, [this]() {
+                m_worker = std::thread([this]() { WriterLoop(); });
+            });
+        }
+
+        void WriterLoop() {
+            Ring* ring = m_ring.load(std::memory_order_acquire);
+            while (!m_stop.load(std::memory_order_acquire)) {
+                bool wrote = false;
+                {
+                    std::lock_guard<std::timed_mutex> lock(m_consumeMtx);
+                    if (m_closed) return;
+                    wrote = DrainLocked(ring);
+                }
+                if (!wrote) Sleep(kIdleWaitMs);
+            }
+        }
+
+        // 取出一批记录编码并写入；调用方须持有消费锁。返回是否取到记录
+        bool DrainLocked(Ring* ring) {
+            if (!OpenLocked()) {
+                // 文件不可用：仍需取空环，避免热路径一直丢弃
+                bool any = false;
+                while (ring->Consume([](const CaptureRecord&, const uint8_t*) {})) any = true;
+                return any;
+            }
+            // 截断判断放在编码之前：新节会重新写出 NRB，本批引用的名称都在截断之后
+            if (m_fileSize > 0 && m_fileSize + kBatchBytes > m_maxFileBytes) {
+                LARGE_INTEGER zero{};
+                SetFilePointerEx(m_file, zero, NULL, FILE_BEGIN);
+                SetEndOfFile(m_file);
+                m_fileSize = 0;
+                std::string header;
+                m_encoder->BeginSection(&header);
+                WriteLocked(header);
+            }
+            m_batch.clear();
+            bool any = false;
+            while (m_batch.size() < kBatchBytes && ring->Consume([this](const CaptureRecord& rec, const uint8_t* payload) {
+                       if (rec.type == CaptureRecordType::Data) ++m_records;
+                       m_encoder->Append(rec, payload, &m_batch);
+                   })) {
+                any = true;
+            }
+            if (!m_batch.empty()) WriteLocked(m_batch);
+            return any;
+        }
+
+        bool OpenLocked() {
+            if (m_file != INVALID_HANDLE_VALUE) return true;
+            if (m_openFailed) return false;
+            const std::string path = Core::Logger::GetProcessOutputPath(".pcapng");
+            // 只共享读权限：运行中即可用 Wireshark 打开查看
+            m_file = CreateFileA(path.c_str(), GENERIC_WRITE, FILE_SHARE_READ, NULL, CREATE_ALWAYS,
+                                 FILE_ATTRIBUTE_NORMAL, NULL);
+            if (m_file == INVALID_HANDLE_VALUE) {
+                m_openFailed = true;
+                Core::Logger::Warn("抓包: 无法创建文件 " + path + ", 错误码=" + std::to_string(GetLastError()) + "，已停止写入");
+                return false;
+            }
+            m_fileSize = 0;
+            std::string header;
+            m_encoder->BeginSection(&header);
+            WriteLocked(header);
+            Core::Logger::Info("抓包: 写入 " + path);
+            return true;
+        }
+
+        void WriteLocked(const std::string& data) {
+            if (data.empty() || m_file == INVALID_HANDLE_VALUE) return;
+            DWORD written = 0;
+            if (!WriteFile(m_file, data.data(), (DWORD)data.size(), &written, NULL)) {
+                CloseHandle(m_file);
+                m_file = INVALID_HANDLE_VALUE;
+                m_openFailed = true;
+                Core::Logger::Warn("抓包: 写入失败, 错误码=" + std::to_string(GetLastError()) + "，已停止写入");
+                return;
+            }
+            m_fileSize += written;
+        }
+
+        std::atomic<Ring*> m_ring{nullptr};
+        CaptureFlowSet<> m_flows;
+        std::atomic<uint64_t> m_flowSeq{0};
+        std::atomic<uint64_t> m_dropped{0};
+        uint32_t m_sampleEvery = 1;
+        uint32_t m_snapLen = 256;
+        ULONGLONG m_maxFileBytes = 64ull * 1024 * 1024;
+
+        // 以下仅在持有消费锁时访问
+        std::timed_mutex m_consumeMtx;
+        std::unique_ptr<PcapngWriter> m_encoder;
+        std::string m_batch;
+        HANDLE m_file = INVALID_HANDLE_VALUE;
+        ULONGLONG m_fileSize = 0;
+        uint64_t m_records = 0;
+        bool m_openFailed = false;
+        bool m_closed = false;
+
+        std::once_flag m_startOnce;
+        std::thread m_worker;
+        std::atomic<bool> m_stop{false};
+    };
+}
@@ -0,0 +1,538 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+
+namespace Network {
+
+    // ============= 抓包（pcapng）：记录格式、热路径环与离线编码 =============
+    // 隧道内的负载没有真实的 IP/TCP/UDP 头（对端是代理），这里为每个被采样的流合成头部：
+    // - 链路类型 LINKTYPE_RAW（首字节即 IPv4/IPv6 头），标准工具（Wireshark/tshark/tcpdump）可直接打开
+    // - TCP 流在开始时合成三次握手、关闭时合成 FIN，序号按实际收发字节推进（抓包长度截断不影响序号）
+    // - 目标为域名时分配 240.0.0.0/4 中的占位地址，并写入名称解析块（NRB），工具中显示为原域名
+    // 说明：本文件不依赖 Winsock/Logger，可在非 Windows 平台独立测试。
+
+    enum class CaptureRecordType : uint8_t {
+        Data = 0,      // 一次收发的负载（前 capLen 字节）
+        FlowOpen = 1,  // 流开始：负载为序列化的 CaptureFlowInfo
+        FlowClose = 2, // 流结束（closesocket）
+    };
+
+    enum class CaptureDirection : uint8_t {
+        Send = 0, // 本地 -> 目标
+        Recv = 1, // 目标 -> 本地
+    };
+
+    struct CaptureEndpoint {
+        uint8_t family = 0; // 4/6；0 表示未知（目标为域名，或取不到本地地址）
+        uint8_t addr[16] = {};
+        uint16_t port = 0;  // 主机字节序
+    };
+
+    struct CaptureFlowInfo {
+        uint8_t proto = 6; // IPPROTO_TCP / IPPROTO_UDP
+        CaptureEndpoint local;
+        CaptureEndpoint remote;
+        std::string host; // 原始目标主机名（remote.family == 0 时用于占位地址与 NRB）
+    };
+
+    // 环中一条记录的定长头
+    struct CaptureRecord {
+        uint64_t tsUs = 0;    // Unix 微秒
+        uint64_t flow = 0;    // 流标识（socket 句柄）
+        uint32_t origLen = 0; // 实际收发字节数（Data）
+        uint32_t capLen = 0;  // 环中保存的字节数
+        CaptureRecordType type = CaptureRecordType::Data;
+        CaptureDirection dir = CaptureDirection::Send;
+    };
+
+    // 一段待拷贝的用户缓冲区（WSABUF 的可移植替身）
+    struct CaptureSegment {
+        const void* data;
+        size_t len;
+    };
+
+    // ---------- 流信息序列化（FlowOpen 记录的负载） ----------
+
+    constexpr size_t kCaptureFlowInfoMaxBytes = 1 + 2 * 19 + 1 + 255;
+
+    // out 至少 kCaptureFlowInfoMaxBytes 字节；主机名超过 255 字节时截断
+    inline size_t SerializeCaptureFlowInfo(const CaptureFlowInfo& info, uint8_t* out) {
+        size_t n = 0;
+        out[n++] = info.proto;
+        for (const CaptureEndpoint* ep : {&info.local, &info.remote}) {
+            out[n++] = ep->family;
+            memcpy(out + n, ep->addr, 16);
+            n += 16;
+            out[n++] = (uint8_t)(ep->port >> 8);
+            out[n++] = (uint8_t)(ep->port & 0xFF);
+        }
+        const size_t hostLen = info.host.size() > 255 ? 255 : info.host.size();
+        out[n++] = (uint8_t)hostLen;
+        memcpy(out + n, info.host.data(), hostLen);
+        return n + hostLen;
+    }
+
+    inline bool ParseCaptureFlowInfo(const uint8_t* data, size_t len, CaptureFlowInfo* out) {
+        if (!data || !out || len < 1 + 2 * 19 + 1) return false;
+        size_t n = 0;
+        out->proto = data[n++];
+        for (CaptureEndpoint* ep : {&out->local, &out->remote}) {
+            ep->family = data[n++];
+            memcpy(ep->addr, data + n, 16);
+            n += 16;
+            ep->port = (uint16_t)((data[n] << 8) | data[n + 1]);
+            n += 2;
+        }
+        const size_t hostLen = data[n++];
+        if (n + hostLen > len) return false;
+        out->host.assign((const char*)data + n, hostLen);
+        return true;
+    }
+
+    // ---------- 热路径环 ----------
+
+    // 定长槽位的多生产者单消费者环（与 Core::LogRing 相同的 Vyukov 序号环）
+    // - 生产者抢占槽位后只做 memcpy（记录头 + 至多 SlotPayload 字节），不分配内存、不做 I/O
+    // - 满时 TryPush 立即返回 false，由调用方计入丢弃数
+    // - 消费者（写线程）在槽位内原地编码，完成后才释放槽位
+    template <size_t Slots = 1024, size_t SlotPayload = 2048>
+    class CaptureRing {
+        static_assert(Slots >= 2 && (Slots & (Slots - 1)) == 0, "槽位数必须为 2 的幂");
+        static_assert(SlotPayload >= kCaptureFlowInfoMaxBytes, "槽位须能容纳 FlowOpen 记录");
+
+    public:
+        static constexpr size_t kSlotPayload = SlotPayload;
+
+        CaptureRing() {
+            for (size_t i = 0; i < Slots; ++i) m_cells[i].seq.store(i, std::memory_order_relaxed);
+        }
+
+        CaptureRing(const CaptureRing&) = delete;
+        CaptureRing& operator=(const CaptureRing&) = delete;
+
+        // 拷贝 segs 的前 rec.capLen 字节（capLen 超出槽位或各段总长时按实际截断）
+        bool TryPush(const CaptureRecord& rec, const CaptureSegment* segs, size_t count) {
+            size_t pos = m_tail.load(std::memory_order_relaxed);
+            for (;;) {
+                Cell& cell = m_cells[pos & (Slots - 1)];
+                const size_t seq = cell.seq.load(std::memory_order_acquire);
+                const intptr_t diff = (intptr_t)seq - (intptr_t)pos;
+                if (diff == 0) {
+                    if (m_tail.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                        cell.rec = rec;
+                        size_t want = rec.capLen < SlotPayload ? rec.capLen : SlotPayload;
+                        size_t copied = 0;
+                        for (size_t i = 0; i < count && copied < want; ++i) {
+                            if (!segs[i].data || segs[i].len == 0) continue;
+                            const size_t n = segs[i].len < want - copied ? segs[i].len : want - copied;
+                            memcpy(cell.data + copied, segs[i].data, n);
+                            copied += n;
+                        }
+                        cell.rec.capLen = (uint32_t)copied;
+                        cell.seq.store(pos + 1, std::memory_order_release);
+                        return true;
+                    }
+                } else if (diff < 0) {
+                    return false; // 已满
+                } else {
+                    pos = m_tail.load(std::memory_order_relaxed);
+                }
+            }
+        }
+
+        // 仅限单消费者调用：fn(const CaptureRecord&, const uint8_t* payload) 返回后释放槽位
+        template <typename Fn>
+        bool Consume(Fn&& fn) {
+            const size_t pos = m_head.load(std::memory_order_relaxed);
+            Cell& cell = m_cells[pos & (Slots - 1)];
+            if (cell.seq.load(std::memory_order_acquire) != pos + 1) return false;
+            fn(static_cast<const CaptureRecord&>(cell.rec), static_cast<const uint8_t*>(cell.data));
+            m_head.store(pos + 1, std::memory_order_relaxed);
+            cell.seq.store(pos + Slots, std::memory_order_release);
+            return true;
+        }
+
+    private:
+        struct Cell {
+            std::atomic<size_t> seq{0};
+            CaptureRecord rec;
+            uint8_t data[SlotPayload];
+        };
+
+        alignas(64) std::atomic<size_t> m_tail{0};
+        alignas(64) std::atomic<size_t> m_head{0};
+        Cell m_cells[Slots];
+    };
+
+    // 被采样流的集合：按句柄直接映射（与 SocketClassCache 相同的哈希），查询只需一次原子读取
+    // 槽位冲突时后加入者覆盖：被挤出的流不再抓包（缓存语义，不影响收发）
+    template <size_t Slots = 4096>
+    class CaptureFlowSet {
+        static_assert(Slots >= 2 && (Slots & (Slots - 1)) == 0, "槽位数必须为 2 的幂");
+
+    public:
+        CaptureFlowSet() {
+            for (auto& slot : m_slots) slot.store(0, std::memory_order_relaxed);
+        }
+
+        bool Contains(uintptr_t s) const {
+            return s != 0 && m_slots[SlotIndex(s)].load(std::memory_order_acquire) == (uint64_t)s;
+        }
+
+        void Insert(uintptr_t s) {
+            if (s != 0) m_slots[SlotIndex(s)].store((uint64_t)s, std::memory_order_release);
+        }
+
+        // 仅当槽位仍属于该句柄时清除；返回是否清除
+        bool Erase(uintptr_t s) {
+            uint64_t cur = (uint64_t)s;
+            return s != 0 && m_slots[SlotIndex(s)].compare_exchange_strong(cur, 0, std::memory_order_acq_rel);
+        }
+
+    private:
+        static constexpr unsigned SlotBits() {
+            unsigned bits = 0;
+            while (((size_t)1 << bits) < Slots) ++bits;
+            return bits;
+        }
+
+        static size_t SlotIndex(uintptr_t s) {
+            return (size_t)(((uint64_t)s * 0x9E3779B97F4A7C15ull) >> (64 - SlotBits()));
+        }
+
+        std::atomic<uint64_t> m_slots[Slots];
+    };
+
+    // ---------- pcapng 编码（写线程） ----------
+
+    // 把环中的记录编码为 pcapng 块；按流维护合成头部所需的状态（端点、TCP 序号）
+    // 非线程安全：只由写线程（或卸载时持消费锁的同步冲刷）调用
+    class PcapngWriter {
+    public:
+        static constexpr uint16_t kLinkTypeRaw = 101;         // LINKTYPE_RAW
+        static constexpr size_t kMaxSegmentPayload = 65535 - 60; // 单个合成报文的最大负载（IPv6 头 40 + TCP 头 20）
+        static constexpr size_t kMaxFlows = 65536;             // 超出后丢弃新流（通常意味着 FlowClose 丢失）
+        static constexpr size_t kMaxNames = 65536;             // 占位地址表上限，超出后清空重新分配
+
+        explicit PcapngWriter(uint32_t snapLen) : m_snapLen(snapLen) {}
+
+        // 新文件（或截断后）的开头：节头块 + 接口描述块；之后的 NRB 会重新写出
+        void BeginSection(std::string* out) {
+            // Section Header Block
+            const size_t shb = BeginBlock(out, 0x0A0D0D0A);
+            Put32(out, 0x1A2B3C4D);
+            Put16(out, 1);
+            Put16(out, 0);
+            Put64(out, ~0ull); // 节长度未知
+            PutOption(out, 4, "antigravity-proxy", 17); // shb_userappl
+            PutOption(out, 0, nullptr, 0);
+            EndBlock(out, shb);
+
+            // Interface Description Block
+            const size_t idb = BeginBlock(out, 1);
+            Put16(out, kLinkTypeRaw);
+            Put16(out, 0);
+            Put32(out, 0); // 不限制；每个报文的截断长度见 EPB 的 caplen
+            PutOption(out, 2, "proxy-tunnel", 12); // if_name
+            const uint8_t tsresol = 6;            // 微秒
+            PutOption(out, 9, &tsresol, 1);
+            PutOption(out, 0, nullptr, 0);
+            EndBlock(out, idb);
+
+            m_namesWritten.clear();
+        }
+
+        // 编码一条环记录；payload 为 rec.capLen 字节
+        void Append(const CaptureRecord& rec, const uint8_t* payload, std::string* out) {
+            switch (rec.type) {
+                case CaptureRecordType::FlowOpen: {
+                    CaptureFlowInfo info;
+                    if (!ParseCaptureFlowInfo(payload, rec.capLen, &info)) return;
+                    if (m_flows.size() >= kMaxFlows && m_flows.find(rec.flow) == m_flows.end()) return;
+                    Flow& flow = m_flows[rec.flow];
+                    flow = Flow{};
+                    flow.proto = info.proto;
+                    flow.remote = info.remote;
+                    if (flow.remote.family == 0) flow.remote = PlaceholderFor(info.host, info.remote.port, out);
+                    flow.local = info.local;
+                    if (flow.local.family != flow.remote.family) flow.local = LoopbackFor(flow.remote.family, info.local.port);
+                    if (flow.proto == 6) {
+                        // 合成三次握手：双方 ISN 为 0，数据从相对序号 1 开始
+                        EmitPacket(flow, CaptureDirection::Send, kSyn, rec.tsUs, nullptr, 0, 0, out);
+                        flow.next[0] = 1;
+                        EmitPacket(flow, CaptureDirection::Recv, kSyn | kAck, rec.tsUs, nullptr, 0, 0, out);
+                        flow.next[1] = 1;
+                        EmitPacket(flow, CaptureDirection::Send, kAck, rec.tsUs, nullptr, 0, 0, out);
+                    }
+                    return;
+                }
+                case CaptureRecordType::FlowClose: {
+                    auto it = m_flows.find(rec.flow);
+                    if (it == m_flows.end()) return;
+                    if (it->second.proto == 6) {
+                        EmitPacket(it->second, CaptureDirection::Send, kFin | kAck, rec.tsUs, nullptr, 0, 0, out);
+                        it->second.next[0] += 1;
+                        EmitPacket(it->second, CaptureDirection::Recv, kAck, rec.tsUs, nullptr, 0, 0, out);
+                    }
+                    m_flows.erase(it);
+                    return;
+                }
+                case CaptureRecordType::Data: {
+                    auto it = m_flows.find(rec.flow);
+                    if (it == m_flows.end() || rec.origLen == 0) return; // FlowOpen 未入环（环满）：无法合成端点，跳过
+                    Flow& flow = it->second;
+                    // 超出单个 IP 报文上限的收发拆成多个合成报文；仅首个携带抓到的字节
+                    uint64_t remaining = rec.origLen;
+                    size_t captured = rec.capLen;
+                    const uint8_t* data = payload;
+                    do {
+                        const size_t segLen = (size_t)(remaining < kMaxSegmentPayload ? remaining : kMaxSegmentPayload);
+                        const size_t segCap = captured < segLen ? captured : segLen;
+                        EmitPacket(flow, rec.dir, kPsh | kAck, rec.tsUs, data, segCap, segLen, out);
+                        if (flow.proto == 6) flow.next[(size_t)rec.dir] += (uint32_t)segLen;
+                        remaining -= segLen;
+                        captured -= segCap;
+                        data += segCap;
+                    } while (remaining > 0);
+                    return;
+                }
+            }
+        }
+
+        // 接口统计块：写入累计的抓取/丢弃报文数（关闭文件或截断前调用）
+        void AppendStatistics(uint64_t tsUs, uint64_t received, uint64_t dropped, std::string* out) {
+            const size_t isb = BeginBlock(out, 5);
+            Put32(out, 0);
+            Put32(out, (uint32_t)(tsUs >> 32));
+            Put32(out, (uint32_t)tsUs);
+            uint8_t value[8];
+            PutLe64(value, received);
+            PutOption(out, 4, value, 8); // isb_ifrecv
+            PutLe64(value, dropped);
+            PutOption(out, 5, value, 8); // isb_ifdrop
+            PutOption(out, 0, nullptr, 0);
+            EndBlock(out, isb);
+        }
+
+        size_t FlowCount() const { return m_flows.size(); }
+        uint64_t PacketsWritten() const { return m_packets; }
+
+    private:
+        static constexpr uint8_t kFin = 0x01;
+        static constexpr uint8_t kSyn = 0x02;
+        static constexpr uint8_t kPsh = 0x08;
+        static constexpr uint8_t kAck = 0x10;
+
+        struct Flow {
+            uint8_t proto = 6;
+            CaptureEndpoint local;
+            CaptureEndpoint remote;
+            uint32_t next[2] = {0, 0}; // 下一个序号：[0] 本地发送方向，[1] 目标发送方向
+        };
+
+        // 域名目标：按主机名分配 240.0.0.0/4 的占位地址，首次使用时写出 NRB
+        CaptureEndpoint PlaceholderFor(const std::string& host, uint16_t port, std::string* out) {
+            const std::string name = host.empty() ? std::string("unknown.invalid") : host;
+            if (m_names.size() >= kMaxNames && m_names.find(name) == m_names.end()) {
+                m_names.clear();
+                m_namesWritten.clear();
+            }
+            auto it = m_names.find(name);
+            if (it == m_names.end()) {
+                const uint32_t index = (uint32_t)m_names.size() + 1;
+                it = m_names.emplace(name, 0xF0000000u | (index & 0x0FFFFFFFu)).first;
+            }
+            CaptureEndpoint ep;
+            ep.family = 4;
+            PutBe32(ep.addr, it->second);
+            ep.port = port;
+            if (m_namesWritten.insert(name).second) AppendNameRecord(ep.addr, name, out);
+            return ep;
+        }
+
+        static CaptureEndpoint LoopbackFor(uint8_t family, uint16_t port) {
+            CaptureEndpoint ep;
+            ep.family = family == 6 ? 6 : 4;
+            if (ep.family == 4) {
+                PutBe32(ep.addr, 0x7F000001u);
+            } else {
+                ep.addr[15] = 1;
+            }
+            ep.port = port ? port : 49152;
+            return ep;
+        }
+
+        void AppendNameRecord(const uint8_t* ipv4, const std::string& name, std::string* out) {
+            const size_t nrb = BeginBlock(out, 4);
+            const size_t valueLen = 4 + name.size() + 1;
+            Put16(out, 1); // nrb_record_ipv4
+            Put16(out, (uint16_t)valueLen);
+            out->append((const char*)ipv4, 4);
+            out->append(name);
+            out->push_back('\0');
+            Pad4(out, valueLen);
+            Put16(out, 0); // nrb_record_end
+            Put16(out, 0);
+            EndBlock(out, nrb);
+        }
+
+        // 写出一个 EPB：合成 IP + TCP/UDP 头，附上 capLen 字节负载；payloadLen 为该报文的完整负载长度
+        void EmitPacket(const Flow& flow, CaptureDirection dir, uint8_t tcpFlags, uint64_t tsUs,
+                        const uint8_t* payload, size_t capLen, size_t payloadLen, std::string* out) {
+            const bool v6 = flow.remote.family == 6;
+            const bool tcp = flow.proto == 6;
+            const CaptureEndpoint& src = dir == CaptureDirection::Send ? flow.local : flow.remote;
+            const CaptureEndpoint& dst = dir == CaptureDirection::Send ? flow.remote : flow.local;
+            const size_t ipLen = v6 ? 40 : 20;
+            const size_t l4Len = tcp ? 20 : 8;
+            if (capLen > m_snapLen) capLen = m_snapLen;
+
+            uint8_t hdr[60] = {};
+            uint8_t* l4 = hdr + ipLen;
+            const size_t l4Total = l4Len + payloadLen;
+            if (v6) {
+                hdr[0] = 0x60;
+                PutBe16(hdr + 4, (uint16_t)l4Total);
+                hdr[6] = flow.proto;
+                hdr[7] = 64;
+                memcpy(hdr + 8, src.addr, 16);
+                memcpy(hdr + 24, dst.addr, 16);
+            } else {
+                hdr[0] = 0x45;
+                PutBe16(hdr + 2, (uint16_t)(ipLen + l4Total));
+                PutBe16(hdr + 4, (uint16_t)(++m_ipId));
+                hdr[6] = 0x40; // DF
+                hdr[8] = 64;
+                hdr[9] = flow.proto;
+                memcpy(hdr + 12, src.addr, 4);
+                memcpy(hdr + 16, dst.addr, 4);
+                PutBe16(hdr + 10, Fold(Sum(hdr, 20, 0)));
+            }
+            PutBe16(l4, src.port);
+            PutBe16(l4 + 2, dst.port);
+            if (tcp) {
+                const size_t d = (size_t)dir;
+                PutBe32(l4 + 4, flow.next[d]);
+                PutBe32(l4 + 8, (tcpFlags & kAck) ? flow.next[d ^ 1] : 0);
+                l4[12] = 0x50;
+                l4[13] = tcpFlags;
+                PutBe16(l4 + 14, 0xFFFF);
+            } else {
+                PutBe16(l4 + 4, (uint16_t)l4Total);
+            }
+            // 校验和只能在负载完整时计算；截断的报文置 0（Wireshark 默认不校验）
+            if (capLen == payloadLen) {
+                uint32_t sum = 0;
+                if (v6) {
+                    sum = Sum(hdr + 8, 32, sum);
+                    sum += (uint32_t)(l4Total >> 16) + (uint32_t)(l4Total & 0xFFFF) + flow.proto;
+                } else {
+                    sum = Sum(hdr + 12, 8, sum);
+                    sum += (uint32_t)l4Total + flow.proto;
+                }
+                sum = Sum(l4, l4Len, sum);
+                sum = Sum(payload, capLen, sum);
+                uint16_t csum = Fold(sum);
+                if (!tcp && csum == 0) csum = 0xFFFF; // UDP：0 表示未计算
+                PutBe16(l4 + (tcp ? 16 : 6), csum);
+            }
+
+            // Enhanced Packet Block
+            const uint32_t caplen = (uint32_t)(ipLen + l4Len + capLen);
+            const size_t epb = BeginBlock(out, 6);
+            Put32(out, 0);
+            Put32(out, (uint32_t)(tsUs >> 32));
+            Put32(out, (uint32_t)tsUs);
+            Put32(out, caplen);
+            Put32(out, (uint32_t)(ipLen + l4Total));
+            out->append((const char*)hdr, ipLen + l4Len);
+            if (capLen) out->append((const char*)payload, capLen);
+            Pad4(out, caplen);
+            EndBlock(out, epb);
+            ++m_packets;
+        }
+
+        // 反码求和（按大端 16 位字累加；奇数长度末尾补 0）
+        // 仅用于单个报文内的连续片段：除最后一段外各段长度均为偶数
+        static uint32_t Sum(const uint8_t* p, size_t len, uint32_t sum) {
+            size_t i = 0;
+            for (; i + 1 < len; i += 2) sum += (uint32_t)((p[i] << 8) | p[i + 1]);
+            if (i < len) sum += (uint32_t)(p[i] << 8);
+            while (sum >> 16) sum = (sum & 0xFFFF) + (sum >> 16);
+            return sum;
+        }
+
+        static uint16_t Fold(uint32_t sum) {
+            while (sum >> 16) sum = (sum & 0xFFFF) + (sum >> 16);
+            return (uint16_t)~sum;
+        }
+
+        static void PutBe16(uint8_t* p, uint16_t v) {
+            p[0] = (uint8_t)(v >> 8);
+            p[1] = (uint8_t)v;
+        }
+
+        static void PutBe32(uint8_t* p, uint32_t v) {
+            p[0] = (uint8_t)(v >> 24);
+            p[1] = (uint8_t)(v >> 16);
+            p[2] = (uint8_t)(v >> 8);
+            p[3] = (uint8_t)v;
+        }
+
+        static void PutLe64(uint8_t* p, uint64_t v) {
+            for (int i = 0; i < 8; ++i) p[i] = (uint8_t)(v >> (8 * i));
+        }
+
+        // 块内字段统一按小端写出（节头中的字节序标记 0x1A2B3C4D 同为小端）
+        static void Put16(std::string* out, uint16_t v) {
+            out->push_back((char)(v & 0xFF));
+            out->push_back((char)(v >> 8));
+        }
+
+        static void Put32(std::string* out, uint32_t v) {
+            for (int i = 0; i < 4; ++i) out->push_back((char)((v >> (8 * i)) & 0xFF));
+        }
+
+        static void Put64(std::string* out, uint64_t v) {
+            for (int i = 0; i < 8; ++i) out->push_back((char)((v >> (8 * i)) & 0xFF));
+        }
+
+        static void Pad4(std::string* out, size_t len) {
+            out->append((4 - (len & 3)) & 3, '\0');
+        }
+
+        static void PutOption(std::string* out, uint16_t code, const void* value, size_t len) {
+            Put16(out, code);
+            Put16(out, (uint16_t)len);
+            if (len) out->append((const char*)value, len);
+            Pad4(out, len);
+        }
+
+        // 块头：类型 + 总长度占位；EndBlock 回填总长度并追加尾部长度
+        static size_t BeginBlock(std::string* out, uint32_t type) {
+            const size_t start = out->size();
+            Put32(out, type);
+            Put32(out, 0);
+            return start;
+        }
+
+        static void EndBlock(std::string* out, size_t start) {
+            const uint32_t total = (uint32_t)(out->size() - start + 4);
+            for (int i = 0; i < 4; ++i) (*out)[start + 4 + i] = (char)((total >> (8 * i)) & 0xFF);
+            Put32(out, total);
+        }
+
+        uint32_t m_snapLen;
+        uint16_t m_ipId = 0;
+        uint64_t m_packets = 0;
+        std::unordered_map<uint64_t, Flow> m_flows;
+        std::unordered_map<std::string, uint32_t> m_names;       // 主机名 -> 占位 IPv4
+        std::unordered_set<std::string> m_namesWritten;          // 当前节已写出 NRB 的主机名
+    };
+
+} // namespace Network
@@ -0,0 +1,62 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+namespace Network {
+
+    // 指针成员预过滤器（计数型、单哈希）：回答“该指针是否可能已登记”
+    // 用途：IOCP 出队的绝大多数 OVERLAPPED 与代理无关，先查过滤器即可跳过分片表的加锁与探测
+    // 设计要点：
+    // - 每个槽位一个原子计数，Add/Remove 各一次 fetch_add/fetch_sub，MayContain 一次原子读取（无锁）
+    // - 计数为 0 表示一定未登记；非 0 可能是哈希冲突（假阳性），调用方需再查权威表
+    // - 调用方须保证 Add 先于权威表插入、Remove 晚于权威表删除，且两者严格配对
+    // 说明：本文件不依赖 Winsock/Logger，可在非 Windows 平台独立测试。
+    template <size_t Slots = 16384>
+    class PointerFilter {
+        static_assert(Slots > 0 && (Slots & (Slots - 1)) == 0, "槽位数必须为 2 的幂");
+
+    public:
+        PointerFilter() {
+            for (auto& c : m_counts) c.store(0, std::memory_order_relaxed);
+        }
+
+        PointerFilter(const PointerFilter&) = delete;
+        PointerFilter& operator=(const PointerFilter&) = delete;
+
+        void Add(const void* p) {
+            if (!p) return;
+            m_counts[SlotIndex(p)].fetch_add(1, std::memory_order_acq_rel);
+        }
+
+        void Remove(const void* p) {
+            if (!p) return;
+            m_counts[SlotIndex(p)].fetch_sub(1, std::memory_order_acq_rel);
+        }
+
+        bool MayContain(const void* p) const {
+            if (!p) return false;
+            return m_counts[SlotIndex(p)].load(std::memory_order_acquire) != 0;
+        }
+
+        void Clear() {
+            for (auto& c : m_counts) c.store(0, std::memory_order_release);
+        }
+
+    private:
+        static constexpr unsigned SlotBits() {
+            unsigned bits = 0;
+            while (((size_t)1 << bits) < Slots) ++bits;
+            return bits;
+        }
+
+        static size_t SlotIndex(const void* p) {
+            // 乘法哈希取高位：OVERLAPPED 多为 8/16 字节对齐的堆/栈地址，低位几乎恒定
+            // 分两次移位：Slots == 1 时避免移位 64 位（未定义行为）
+            return (size_t)((((uint64_t)(uintptr_t)p * 0x9E3779B97F4A7C15ull) >> (63 - SlotBits())) >> 1);
+        }
+
+        std::atomic<uint32_t> m_counts[Slots];
+    };
+
+} // namespace Network
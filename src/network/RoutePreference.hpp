@@ -0,0 +1,285 @@
+#pragma once
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace Network {
+
+    // 域名级直连/代理偏好（default_action=learn）
+    // 设计意图：未命中任何路由规则的域名，首次连接走代理并同时探测直连，记录先完成的一方；
+    // 之后的连接按学习到的偏好直接选路，不必手写直连名单。
+    // - 分数范围 [-1000, 1000]（千分比）：正值偏向直连，负值偏向代理；每次结果把分数向 ±1000 拉近一半
+    // - 分数按半衰期随时间衰减，|分数| 低于阈值（默认 500）时回到“探测”，过期的结论会被重新验证
+    // - 首次探测结果即可越过阈值；一次反向结果（如学习到直连后直连失败）即退回探测
+    // - 条目数有上限，满时淘汰最久未更新的条目
+    // - 可序列化为文本（每行 host\tscore\tupdatedMs\tdirect\tproxy）跨进程/重启保留；合并时以更新时间较新者为准
+    // 说明：本模块不依赖 Logger/Winsock，时间由调用方传入（墙钟毫秒），可在任意平台独立测试。
+    enum class RouteChoice : uint8_t {
+        Probe = 0, // 无有效偏好：走代理并探测直连
+        Direct,
+        Proxy,
+    };
+
+    inline const char* RouteChoiceName(RouteChoice c) {
+        switch (c) {
+            case RouteChoice::Direct: return "direct";
+            case RouteChoice::Proxy: return "proxy";
+            default: return "probe";
+        }
+    }
+
+    struct RoutePreferenceOptions {
+        uint64_t halfLifeMs = 24ull * 3600 * 1000; // 分数半衰期
+        int32_t threshold = 500;                    // |分数| 达到该值才采用学习结果
+        size_t maxEntries = 4096;                   // 条目上限
+    };
+
+    struct RoutePreferenceEntry {
+        std::string host;
+        int32_t score = 0;       // 更新时刻的分数（未衰减）
+        uint64_t updatedMs = 0;
+        uint32_t directWins = 0; // 累计直连胜出次数
+        uint32_t proxyWins = 0;  // 累计代理胜出（含直连失败反馈）次数
+    };
+
+    struct RoutePreferenceStats {
+        size_t entries = 0;
+        uint64_t directUpdates = 0;
+        uint64_t proxyUpdates = 0;
+        uint64_t evictions = 0;
+    };
+
+    class RoutePreferenceTable {
+    public:
+        static constexpr int32_t kMaxScore = 1000;
+        static constexpr int32_t kDropScore = 50; // 衰减到该值以下的条目不再保存
+
+        static RoutePreferenceTable& Instance() {
+            static RoutePreferenceTable instance;
+            return instance;
+        }
+
+        explicit RoutePreferenceTable(const RoutePreferenceOptions& options = RoutePreferenceOptions()) {
+            Configure(options);
+        }
+
+        void Configure(const RoutePreferenceOptions& options) {
+            std::lock_guard<std::mutex> lock(m_mtx);
+            m_options = options;
+            if (m_options.halfLifeMs == 0) m_options.halfLifeMs = 1;
+            m_options.threshold = std::max<int32_t>(1, std::min<int32_t>(m_options.threshold, kMaxScore));
+            if (m_options.maxEntries == 0) m_options.maxEntries = 1;
+        }
+
+        // 小写、去掉结尾的点；空串表示不可学习
+        static std::string NormalizeHost(const std::string& host) {
+            std::string out = host;
+            while (!out.empty() && out.back() == '.') out.pop_back();
+            for (char& c : out) {
+                if (c >= 'A' && c <= 'Z') c = (char)(c - 'A' + 'a');
+            }
+            return out;
+        }
+
+        // 按 now 时刻衰减后的分数选路
+        RouteChoice Decide(const std::string& host, uint64_t nowMs) const {
+            const std::string key = NormalizeHost(host);
+            if (key.empty()) return RouteChoice::Probe;
+            std::lock_guard<std::mutex> lock(m_mtx);
+            auto it = m_entries.find(key);
+            if (it == m_entries.end()) return RouteChoice::Probe;
+            const int32_t score = Decay(it->second.score, it->second.updatedMs, nowMs);
+            if (score >= m_options.threshold) return RouteChoice::Direct;
+            if (score <= -m_options.threshold) return RouteChoice::Proxy;
+            return RouteChoice::Probe;
+        }
+
+        // 记录一次结果（探测胜者，或已学习路径的成败反馈）
+        void Record(const std::string& host, RouteChoice winner, uint64_t nowMs) {
+            if (winner == RouteChoice::Probe) return;
+            const std::string key = NormalizeHost(host);
+            if (key.empty()) return;
+            std::lock_guard<std::mutex> lock(m_mtx);
+            auto it = m_entries.find(key);
+            if (it == m_entries.end()) {
+                EvictIfFullLocked();
+                RoutePreferenceEntry e;
+                e.host = key;
+                it = m_entries.emplace(key, e).first;
+            }
+            RoutePreferenceEntry& e = it->second;
+            const int32_t target = winner == RouteChoice::Direct ? kMaxScore : -kMaxScore;
+            e.score = (Decay(e.score, e.updatedMs, nowMs) + target) / 2;
+            e.updatedMs = std::max(e.updatedMs, nowMs);
+            if (winner == RouteChoice::Direct) {
+                e.directWins++;
+                m_directUpdates++;
+            } else {
+                e.proxyWins++;
+                m_proxyUpdates++;
+            }
+        }
+
+        // 当前分数（已衰减）；无条目返回 false
+        bool Score(const std::string& host, uint64_t nowMs, int32_t* out) const {
+            std::lock_guard<std::mutex> lock(m_mtx);
+            auto it = m_entries.find(NormalizeHost(host));
+            if (it == m_entries.end()) return false;
+            if (out) *out = Decay(it->second.score, it->second.updatedMs, nowMs);
+            return true;
+        }
+
+        RoutePreferenceStats GetStats() const {
+            std::lock_guard<std::mutex> lock(m_mtx);
+            RoutePreferenceStats s;
+            s.entries = m_entries.size();
+            s.directUpdates = m_directUpdates;
+            s.proxyUpdates = m_proxyUpdates;
+            s.evictions = m_evictions;
+            return s;
+        }
+
+        void Clear() {
+            std::lock_guard<std::mutex> lock(m_mtx);
+            m_entries.clear();
+            m_directUpdates = 0;
+            m_proxyUpdates = 0;
+            m_evictions = 0;
+        }
+
+        // 序列化仍有意义的条目（衰减后 |分数| >= kDropScore），按主机名排序便于比对
+        std::string Serialize(uint64_t nowMs) const {
+            std::vector<RoutePreferenceEntry> rows;
+            {
+                std::lock_guard<std::mutex> lock(m_mtx);
+                rows.reserve(m_entries.size());
+                for (const auto& kv : m_entries) {
+                    if (std::abs(Decay(kv.second.score, kv.second.updatedMs, nowMs)) < kDropScore) continue;
+                    rows.push_back(kv.second);
+                }
+            }
+            std::sort(rows.begin(), rows.end(),
+                      [](const RoutePreferenceEntry& a, const RoutePreferenceEntry& b) { return a.host < b.host; });
+            std::string out = "# antigravity-proxy route preferences v1\n";
+            for (const auto& e : rows) {
+                out += e.host;
+                out += '\t';
+                out += std::to_string(e.score);
+                out += '\t';
+                out += std::to_string(e.updatedMs);
+                out += '\t';
+                out += std::to_string(e.directWins);
+                out += '\t';
+                out += std::to_string(e.proxyWins);
+                out += '\n';
+            }
+            return out;
+        }
+
+        // 合并 Serialize 的输出：同一主机以更新时间较新者为准；无效行与已衰减到阈值以下的条目跳过
+        // 返回采纳的条目数
+        size_t Load(const std::string& text, uint64_t nowMs) {
+            size_t adopted = 0;
+            size_t pos = 0;
+            std::lock_guard<std::mutex> lock(m_mtx);
+            while (pos < text.size()) {
+                size_t end = text.find('\n', pos);
+                if (end == std::string::npos) end = text.size();
+                std::string line = text.substr(pos, end - pos);
+                pos = end + 1;
+                if (!line.empty() && line.back() == '\r') line.pop_back();
+                RoutePreferenceEntry e;
+                if (!ParseLine(line, &e)) continue;
+                if (std::abs(Decay(e.score, e.updatedMs, nowMs)) < kDropScore) continue;
+                auto it = m_entries.find(e.host);
+                if (it != m_entries.end()) {
+                    if (it->second.updatedMs >= e.updatedMs) continue;
+                    it->second = e;
+                } else {
+                    EvictIfFullLocked();
+                    m_entries.emplace(e.host, e);
+                }
+                adopted++;
+            }
+            return adopted;
+        }
+
+    private:
+        // score * 2^(-(now - updated) / halfLife)；时钟回拨时不衰减
+        int32_t Decay(int32_t score, uint64_t updatedMs, uint64_t nowMs) const {
+            if (score == 0 || nowMs <= updatedMs) return score;
+            const double halfLives = (double)(nowMs - updatedMs) / (double)m_options.halfLifeMs;
+            if (halfLives >= 16) return 0;
+            return (int32_t)((double)score * std::exp2(-halfLives));
+        }
+
+        void EvictIfFullLocked() {
+            if (m_entries.size() < m_options.maxEntries) return;
+            auto oldest = m_entries.begin();
+            for (auto it = m_entries.begin(); it != m_entries.end(); ++it) {
+                if (it->second.updatedMs < oldest->second.updatedMs) oldest = it;
+            }
+            if (oldest != m_entries.end()) {
+                m_entries.erase(oldest);
+                m_evictions++;
+            }
+        }
+
+        static bool ParseUnsigned(const std::string& s, uint64_t maxValue, uint64_t* out) {
+            if (s.empty() || s.size() > 20) return false;
+            uint64_t v = 0;
+            for (char c : s) {
+                if (c < '0' || c > '9') return false;
+                const uint64_t digit = (uint64_t)(c - '0');
+                if (v > (maxValue - digit) / 10) return false;
+                v = v * 10 + digit;
+            }
+            *out = v;
+            return true;
+        }
+
+        static bool ParseLine(const std::string& line, RoutePreferenceEntry* out) {
+            if (line.empty() || line[0] == '#') return false;
+            std::vector<std::string> fields;
+            size_t start = 0;
+            for (;;) {
+                const size_t tab = line.find('\t', start);
+                fields.push_back(line.substr(start, tab == std::string::npos ? std::string::npos : tab - start));
+                if (tab == std::string::npos) break;
+                start = tab + 1;
+            }
+            if (fields.size() != 5) return false;
+            const std::string host = NormalizeHost(fields[0]);
+            if (host.empty() || host.size() > 253) return false;
+            for (char c : host) {
+                if ((unsigned char)c <= ' ') return false;
+            }
+            std::string scoreText = fields[1];
+            const bool negative = !scoreText.empty() && scoreText[0] == '-';
+            if (negative) scoreText.erase(0, 1);
+            uint64_t magnitude = 0, updated = 0, direct = 0, proxy = 0;
+            if (!ParseUnsigned(scoreText, (uint64_t)kMaxScore, &magnitude)) return false;
+            if (!ParseUnsigned(fields[2], UINT64_MAX, &updated)) return false;
+            if (!ParseUnsigned(fields[3], UINT32_MAX, &direct)) return false;
+            if (!ParseUnsigned(fields[4], UINT32_MAX, &proxy)) return false;
+            out->host = host;
+            out->score = negative ? -(int32_t)magnitude : (int32_t)magnitude;
+            out->updatedMs = updated;
+            out->directWins = (uint32_t)direct;
+            out->proxyWins = (uint32_t)proxy;
+            return true;
+        }
+
+        RoutePreferenceOptions m_options;
+        mutable std::mutex m_mtx;
+        std::unordered_map<std::string, RoutePreferenceEntry> m_entries;
+        uint64_t m_directUpdates = 0;
+        uint64_t m_proxyUpdates = 0;
+        uint64_t m_evictions = 0;
+    };
+}
@@ -0,0 +1,96 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+namespace Network {
+
+    // SlabPool 统计（均为累计值，inUse 为当前借出数）
+    struct SlabPoolStats {
+        uint64_t acquired = 0;       // Acquire 总次数
+        uint64_t heapFallbacks = 0;  // 槽位耗尽时退化为堆分配的次数
+        uint64_t inUse = 0;
+    };
+
+    // 固定容量对象池：首次构造时一次性分配 Capacity 个 T，之后经无锁空闲链表反复复用
+    // 设计要点：
+    // - 空闲链表为 Treiber 栈，头指针 = (tag << 32) | (index + 1)，每次修改 tag 自增，避免 ABA
+    // - 槽位内存在池生命周期内从不释放，因此并发 Pop 读取已被他人取走的槽位 next 也是安全的
+    // - 槽位耗尽时退化为 new T()，Release 按地址区分并 delete，调用方无需关心来源
+    // - 对象在池中复用不会重新构造，调用方需在 Acquire 后自行重置字段
+    template <typename T, size_t Capacity>
+    class SlabPool {
+        static_assert(Capacity > 0 && Capacity < 0xFFFFFFFFu, "SlabPool 容量超出范围");
+
+    public:
+        SlabPool() : m_items(new T[Capacity]), m_next(new std::atomic<uint32_t>[Capacity]) {
+            // 初始空闲链：0 -> 1 -> ... -> Capacity-1 -> 空
+            for (size_t i = 0; i < Capacity; ++i) {
+                m_next[i].store(i + 1 < Capacity ? (uint32_t)(i + 2) : 0u, std::memory_order_relaxed);
+            }
+            m_head.store(1, std::memory_order_release);
+        }
+
+        SlabPool(const SlabPool&) = delete;
+        SlabPool& operator=(const SlabPool&) = delete;
+
+        T* Acquire() {
+            m_acquired.fetch_add(1, std::memory_order_relaxed);
+            m_inUse.fetch_add(1, std::memory_order_relaxed);
+            uint64_t head = m_head.load(std::memory_order_acquire);
+            for (;;) {
+                const uint32_t slot = (uint32_t)(head & 0xFFFFFFFFu);
+                if (slot == 0) {
+                    m_heapFallbacks.fetch_add(1, std::memory_order_relaxed);
+                    return new T();
+                }
+                const uint32_t next = m_next[slot - 1].load(std::memory_order_relaxed);
+                const uint64_t desired = (((head >> 32) + 1) << 32) | next;
+                if (m_head.compare_exchange_weak(head, desired, std::memory_order_acq_rel, std::memory_order_acquire)) {
+                    return &m_items[slot - 1];
+                }
+            }
+        }
+
+        void Release(T* item) {
+            if (!item) return;
+            m_inUse.fetch_sub(1, std::memory_order_relaxed);
+            if (!Owns(item)) {
+                delete item;
+                return;
+            }
+            const uint32_t slot = (uint32_t)(item - m_items.get()) + 1;
+            uint64_t head = m_head.load(std::memory_order_relaxed);
+            for (;;) {
+                m_next[slot - 1].store((uint32_t)(head & 0xFFFFFFFFu), std::memory_order_relaxed);
+                const uint64_t desired = (((head >> 32) + 1) << 32) | slot;
+                if (m_head.compare_exchange_weak(head, desired, std::memory_order_release, std::memory_order_relaxed)) {
+                    return;
+                }
+            }
+        }
+
+        bool Owns(const T* item) const {
+            const T* begin = m_items.get();
+            return item >= begin && item < begin + Capacity;
+        }
+
+        SlabPoolStats GetStats() const {
+            SlabPoolStats s;
+            s.acquired = m_acquired.load(std::memory_order_relaxed);
+            s.heapFallbacks = m_heapFallbacks.load(std::memory_order_relaxed);
+            s.inUse = m_inUse.load(std::memory_order_relaxed);
+            return s;
+        }
+
+    private:
+        std::unique_ptr<T[]> m_items;
+        std::unique_ptr<std::atomic<uint32_t>[]> m_next;
+        std::atomic<uint64_t> m_head{0};
+        std::atomic<uint64_t> m_acquired{0};
+        std::atomic<uint64_t> m_heapFallbacks{0};
+        std::atomic<uint64_t> m_inUse{0};
+    };
+
+} // namespace Network
@@ -0,0 +1,124 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+namespace Network {
+
+    // socket 分类：决定 send/recv 等热路径是否需要进入代理分支
+    enum class SocketClass : uint8_t {
+        Unknown = 0,   // 未分类（需 getsockopt(SO_TYPE) 判定）
+        DirectTcp,     // 未接管的流式 socket（含其他非 SOCK_DGRAM 类型），热路径直接透传
+        ProxiedTcp,    // 已建立代理隧道的 TCP socket（隧道建立后收发同样透传）
+        Udp,           // UDP socket，尚未决定是否走代理
+        ProxiedUdp,    // 已就绪 SOCKS5 UDP Associate 的 UDP socket
+        BlockedUdp,    // udp_mode=block 下 connect 被阻止的 UDP socket
+    };
+
+    inline bool IsStreamSocketClass(SocketClass c) {
+        return c == SocketClass::DirectTcp || c == SocketClass::ProxiedTcp;
+    }
+
+    inline bool IsDatagramSocketClass(SocketClass c) {
+        return c == SocketClass::Udp || c == SocketClass::ProxiedUdp || c == SocketClass::BlockedUdp;
+    }
+
+    inline const char* SocketClassName(SocketClass c) {
+        switch (c) {
+            case SocketClass::DirectTcp: return "direct-tcp";
+            case SocketClass::ProxiedTcp: return "proxied-tcp";
+            case SocketClass::Udp: return "udp";
+            case SocketClass::ProxiedUdp: return "proxied-udp";
+            case SocketClass::BlockedUdp: return "blocked-udp";
+            default: return "unknown";
+        }
+    }
+
+    // socket 分类缓存：按句柄直接映射的定长槽位数组，查询只需一次原子读取（无锁、无哈希探测）
+    // 设计说明：
+    // - 每个槽位保存 (句柄 << 8) | 分类；句柄不匹配即视为未命中，槽位冲突时后写入者覆盖（缓存语义，未命中只会多一次 getsockopt）
+    // - 槽位下标取句柄的乘法哈希高位：Windows 句柄为 4 的倍数、POSIX fd 为连续小整数，两者都能均匀分布
+    // - 句柄复用依赖 closesocket 时 Invalidate；仅清除仍属于该句柄的槽位
+    // 说明：本文件不依赖 Winsock/Logger，可在非 Windows 平台独立测试。
+    template <size_t Slots = 16384>
+    class SocketClassCache {
+        static_assert(Slots > 0 && (Slots & (Slots - 1)) == 0, "槽位数必须为 2 的幂");
+
+    public:
+        SocketClassCache() {
+            for (auto& slot : m_slots) slot.store(0, std::memory_order_relaxed);
+        }
+
+        SocketClassCache(const SocketClassCache&) = delete;
+        SocketClassCache& operator=(const SocketClassCache&) = delete;
+
+        SocketClass Get(uintptr_t s) const {
+            if (!Cacheable(s)) return SocketClass::Unknown;
+            const uint64_t v = SlotFor(s).load(std::memory_order_acquire);
+            if ((v >> 8) != (uint64_t)s) return SocketClass::Unknown;
+            return (SocketClass)(v & 0xFF);
+        }
+
+        // 无条件写入（socket 状态变化时使用：建立代理隧道、UDP Associate 就绪、被阻止等）
+        void Set(uintptr_t s, SocketClass c) {
+            if (!Cacheable(s)) return;
+            SlotFor(s).store(Pack(s, c), std::memory_order_release);
+        }
+
+        // 首次分类写入：若槽位已记录该句柄的分类（可能是并发写入的更具体状态）则保留
+        SocketClass Publish(uintptr_t s, SocketClass c) {
+            if (!Cacheable(s)) return c;
+            std::atomic<uint64_t>& slot = SlotFor(s);
+            uint64_t cur = slot.load(std::memory_order_acquire);
+            for (;;) {
+                if ((cur >> 8) == (uint64_t)s && (SocketClass)(cur & 0xFF) != SocketClass::Unknown) {
+                    return (SocketClass)(cur & 0xFF);
+                }
+                if (slot.compare_exchange_weak(cur, Pack(s, c), std::memory_order_acq_rel, std::memory_order_acquire)) {
+                    return c;
+                }
+            }
+        }
+
+        // closesocket 时调用：仅当槽位仍属于该句柄时清除
+        void Invalidate(uintptr_t s) {
+            if (!Cacheable(s)) return;
+            std::atomic<uint64_t>& slot = SlotFor(s);
+            uint64_t cur = slot.load(std::memory_order_acquire);
+            while ((cur >> 8) == (uint64_t)s) {
+                if (slot.compare_exchange_weak(cur, 0, std::memory_order_acq_rel, std::memory_order_acquire)) return;
+            }
+        }
+
+        void Clear() {
+            for (auto& slot : m_slots) slot.store(0, std::memory_order_release);
+        }
+
+    private:
+        static bool Cacheable(uintptr_t s) {
+            // 0 用作空槽位标记；超出 56 位的句柄无法与分类打包（实际不会出现），直接不缓存
+            return s != 0 && ((uint64_t)s >> 56) == 0 && s != (uintptr_t)~(uintptr_t)0;
+        }
+
+        static uint64_t Pack(uintptr_t s, SocketClass c) {
+            return ((uint64_t)s << 8) | (uint64_t)c;
+        }
+
+        static constexpr unsigned SlotBits() {
+            unsigned bits = 0;
+            while (((size_t)1 << bits) < Slots) ++bits;
+            return bits;
+        }
+
+        static size_t SlotIndex(uintptr_t s) {
+            // 分两次移位：Slots == 1 时避免移位 64 位（未定义行为）
+            return (size_t)((((uint64_t)s * 0x9E3779B97F4A7C15ull) >> (63 - SlotBits())) >> 1);
+        }
+
+        std::atomic<uint64_t>& SlotFor(uintptr_t s) { return m_slots[SlotIndex(s)]; }
+        const std::atomic<uint64_t>& SlotFor(uintptr_t s) const { return m_slots[SlotIndex(s)]; }
+
+        std::atomic<uint64_t> m_slots[Slots];
+    };
+
+} // namespace Network
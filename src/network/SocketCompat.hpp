@@ -0,0 +1,103 @@
+#pragma once
+// Socket 平台适配层
+// Windows 下直接使用 Winsock；其他平台将常用 Winsock 名称映射到 BSD socket，
+// 使不依赖 Hook/Logger 的纯网络模块（UDP 中继、协议编解码等）可以在 Linux 上独立测试与基准。
+#ifdef _WIN32
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#else
+#include <arpa/inet.h>
+#include <cerrno>
+#include <fcntl.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <sys/ioctl.h>
+#include <sys/select.h>
+#include <sys/socket.h>
+#include <sys/types.h>
+#include <unistd.h>
+
+typedef int SOCKET;
+#ifndef INVALID_SOCKET
+#define INVALID_SOCKET (-1)
+#endif
+#ifndef SOCKET_ERROR
+#define SOCKET_ERROR (-1)
+#endif
+#ifndef WSAAPI
+#define WSAAPI
+#endif
+
+#define WSAEWOULDBLOCK EWOULDBLOCK
+#define WSAEINPROGRESS EINPROGRESS
+#define WSAETIMEDOUT ETIMEDOUT
+#define WSAECONNRESET ECONNRESET
+#define WSAECONNREFUSED ECONNREFUSED
+#define WSAECONNABORTED ECONNABORTED
+#define WSAENOTCONN ENOTCONN
+#define WSAENOTSOCK ENOTSOCK
+#define WSAEINVAL EINVAL
+#define WSAEFAULT EFAULT
+#define WSAEMSGSIZE EMSGSIZE
+#define WSAENOBUFS ENOBUFS
+#define WSAEAFNOSUPPORT EAFNOSUPPORT
+#define WSAEHOSTUNREACH EHOSTUNREACH
+#define WSAENETUNREACH ENETUNREACH
+
+inline int WSAGetLastError() { return errno; }
+inline void WSASetLastError(int err) { errno = err; }
+inline int closesocket(SOCKET s) { return close(s); }
+
+// 仅支持 FIONBIO（本项目唯一用到的 ioctlsocket 命令）
+inline int ioctlsocket(SOCKET s, unsigned long cmd, unsigned long* arg) {
+    if (cmd != (unsigned long)FIONBIO || !arg) {
+        errno = EINVAL;
+        return SOCKET_ERROR;
+    }
+    const int flags = fcntl(s, F_GETFL, 0);
+    if (flags < 0) return SOCKET_ERROR;
+    const int next = *arg ? (flags | O_NONBLOCK) : (flags & ~O_NONBLOCK);
+    return fcntl(s, F_SETFL, next) == 0 ? 0 : SOCKET_ERROR;
+}
+#endif
+
+namespace Network {
+namespace SocketCompat {
+
+#ifdef _WIN32
+typedef int SockLen;
+typedef WSAPOLLFD PollFd;
+constexpr int kSendNoSignal = 0;
+#else
+typedef socklen_t SockLen;
+typedef pollfd PollFd;
+constexpr int kSendNoSignal = MSG_NOSIGNAL; // 对端已关闭时返回 EPIPE 而不是触发 SIGPIPE
+#endif
+
+// 就绪等待：Windows 为 WSAPoll，其他平台为 poll；返回值与 poll 一致（>0 就绪数，0 超时，<0 出错）
+inline int Poll(PollFd* fds, unsigned long count, int timeoutMs) {
+#ifdef _WIN32
+    return WSAPoll(fds, count, timeoutMs);
+#else
+    for (;;) {
+        const int rc = poll(fds, (nfds_t)count, timeoutMs);
+        // 被信号打断时按原超时重试（信号罕见，不为此在每次等待前读取时钟）
+        if (rc >= 0 || errno != EINTR) return rc;
+    }
+#endif
+}
+
+// select 的 nfds：Winsock 忽略该参数，BSD socket 需要 max(fd)+1
+inline int SelectNfds(SOCKET maxSock) {
+#ifdef _WIN32
+    (void)maxSock;
+    return 0;
+#else
+    return maxSock + 1;
+#endif
+}
+
+} // namespace SocketCompat
+} // namespace Network
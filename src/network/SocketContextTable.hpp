@@ -0,0 +1,357 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <shared_mutex>
+#include <utility>
+#include <vector>
+
+namespace Network {
+
+    // 侵入式引用计数基类：计数归零时 delete 派生对象
+    // 说明：新建对象初始计数为 1（归创建者所有），交给 RefPtr::Adopt 接管
+    template <typename T>
+    class RefCounted {
+    public:
+        void AddRef() const { m_refs.fetch_add(1, std::memory_order_relaxed); }
+        void Release() const {
+            if (m_refs.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+                delete static_cast<const T*>(this);
+            }
+        }
+        uint32_t RefCount() const { return m_refs.load(std::memory_order_relaxed); }
+
+    protected:
+        RefCounted() = default;
+        ~RefCounted() = default;
+
+    private:
+        mutable std::atomic<uint32_t> m_refs{1};
+    };
+
+    // 侵入式智能指针
+    template <typename T>
+    class RefPtr {
+    public:
+        RefPtr() = default;
+        RefPtr(const RefPtr& other) : m_ptr(other.m_ptr) { if (m_ptr) m_ptr->AddRef(); }
+        RefPtr(RefPtr&& other) noexcept : m_ptr(other.m_ptr) { other.m_ptr = nullptr; }
+        ~RefPtr() { if (m_ptr) m_ptr->Release(); }
+
+        RefPtr& operator=(RefPtr other) noexcept {
+            std::swap(m_ptr, other.m_ptr);
+            return *this;
+        }
+
+        // 接管一个已持有的引用（不增加计数）
+        static RefPtr Adopt(T* ptr) {
+            RefPtr r;
+            r.m_ptr = ptr;
+            return r;
+        }
+        // 新增一个引用
+        static RefPtr Retain(T* ptr) {
+            if (ptr) ptr->AddRef();
+            return Adopt(ptr);
+        }
+        // 交出引用（调用方负责之后 Release）
+        T* Detach() {
+            T* p = m_ptr;
+            m_ptr = nullptr;
+            return p;
+        }
+
+        T* get() const { return m_ptr; }
+        T* operator->() const { return m_ptr; }
+        T& operator*() const { return *m_ptr; }
+        explicit operator bool() const { return m_ptr != nullptr; }
+
+    private:
+        T* m_ptr = nullptr;
+    };
+
+    // 分片开放寻址哈希表（键为 SOCKET / 指针等整型句柄）
+    // 设计要点：
+    // - 按键哈希的高位选分片，每个分片独立读写锁，查询只锁一个分片（读锁），不存在全局锁
+    // - 分片内线性探测 + 墓碑删除，插入不做逐节点堆分配，仅在扩容时整体重建
+    // - 回调在分片锁内执行：回调中不得再访问同一张表，也不应执行阻塞 I/O
+    template <typename Key, typename Value, size_t ShardCount = 64>
+    class ShardedTable {
+        static_assert(ShardCount > 0 && (ShardCount & (ShardCount - 1)) == 0, "分片数必须为 2 的幂");
+
+    public:
+        ShardedTable() = default;
+        ShardedTable(const ShardedTable&) = delete;
+        ShardedTable& operator=(const ShardedTable&) = delete;
+
+        // 只读访问：fn(const Value&)，返回是否找到
+        template <typename Fn>
+        bool Visit(Key key, Fn&& fn) const {
+            const uint64_t h = Hash(key);
+            const Shard& shard = ShardFor(h);
+            std::shared_lock<std::shared_mutex> lock(shard.mtx);
+            const Slot* slot = shard.Lookup(key, h);
+            if (!slot) return false;
+            fn(slot->value);
+            return true;
+        }
+
+        bool Find(Key key, Value* out) const {
+            return Visit(key, [out](const Value& v) { if (out) *out = v; });
+        }
+
+        bool Contains(Key key) const {
+            return Visit(key, [](const Value&) {});
+        }
+
+        // 读写访问：fn(Value&)，返回是否找到
+        template <typename Fn>
+        bool Update(Key key, Fn&& fn) {
+            const uint64_t h = Hash(key);
+            Shard& shard = ShardFor(h);
+            std::unique_lock<std::shared_mutex> lock(shard.mtx);
+            Slot* slot = shard.Lookup(key, h);
+            if (!slot) return false;
+            fn(slot->value);
+            return true;
+        }
+
+        // 不存在时插入 value 并返回 true；已存在时调用 onExisting(Value&) 并返回 false
+        template <typename Fn>
+        bool InsertIfAbsent(Key key, Value value, Fn&& onExisting) {
+            const uint64_t h = Hash(key);
+            Shard& shard = ShardFor(h);
+            std::unique_lock<std::shared_mutex> lock(shard.mtx);
+            if (Slot* slot = shard.Lookup(key, h)) {
+                onExisting(slot->value);
+                return false;
+            }
+            shard.Insert(key, h, std::move(value));
+            m_size.fetch_add(1, std::memory_order_relaxed);
+            return true;
+        }
+
+        bool InsertIfAbsent(Key key, Value value) {
+            return InsertIfAbsent(key, std::move(value), [](Value&) {});
+        }
+
+        // 插入或覆盖；返回 true 表示新插入
+        bool InsertOrAssign(Key key, Value value) {
+            const uint64_t h = Hash(key);
+            Shard& shard = ShardFor(h);
+            std::unique_lock<std::shared_mutex> lock(shard.mtx);
+            if (Slot* slot = shard.Lookup(key, h)) {
+                slot->value = std::move(value);
+                return false;
+            }
+            shard.Insert(key, h, std::move(value));
+            m_size.fetch_add(1, std::memory_order_relaxed);
+            return true;
+        }
+
+        // 删除并取出旧值
+        bool Erase(Key key, Value* out = nullptr) {
+            const uint64_t h = Hash(key);
+            Shard& shard = ShardFor(h);
+            std::unique_lock<std::shared_mutex> lock(shard.mtx);
+            Slot* slot = shard.Lookup(key, h);
+            if (!slot) return false;
+            if (out) *out = std::move(slot->value);
+            shard.Remove(slot);
+            m_size.fetch_sub(1, std::memory_order_relaxed);
+            return true;
+        }
+
+        // 仅当 pred(const Value&) 成立时删除并取出旧值
+        template <typename Pred>
+        bool EraseWhere(Key key, Pred&& pred, Value* out = nullptr) {
+            const uint64_t h = Hash(key);
+            Shard& shard = ShardFor(h);
+            std::unique_lock<std::shared_mutex> lock(shard.mtx);
+            Slot* slot = shard.Lookup(key, h);
+            if (!slot || !pred(static_cast<const Value&>(slot->value))) return false;
+            if (out) *out = std::move(slot->value);
+            shard.Remove(slot);
+            m_size.fetch_sub(1, std::memory_order_relaxed);
+            return true;
+        }
+
+        // 条件删除：pred(Key, Value&) 返回 true 时删除（可在 pred 中移走 Value）
+        template <typename Fn>
+        size_t EraseIf(Fn&& pred) {
+            size_t removed = 0;
+            for (size_t i = 0; i < ShardCount; ++i) {
+                Shard& shard = m_shards[i];
+                std::unique_lock<std::shared_mutex> lock(shard.mtx);
+                for (auto& slot : shard.slots) {
+                    if (slot.state != kUsed) continue;
+                    if (pred(slot.key, slot.value)) {
+                        shard.Remove(&slot);
+                        ++removed;
+                    }
+                }
+            }
+            m_size.fetch_sub(removed, std::memory_order_relaxed);
+            return removed;
+        }
+
+        // 清空并逐个交出所有值：fn(Key, Value&&)
+        template <typename Fn>
+        void Drain(Fn&& fn) {
+            EraseIf([&fn](Key key, Value& value) {
+                fn(key, std::move(value));
+                return true;
+            });
+        }
+
+        size_t Size() const { return m_size.load(std::memory_order_relaxed); }
+
+    private:
+        static constexpr uint8_t kEmpty = 0;
+        static constexpr uint8_t kUsed = 1;
+        static constexpr uint8_t kTombstone = 2;
+
+        struct Slot {
+            Key key{};
+            Value value{};
+            uint8_t state = kEmpty;
+        };
+
+        // 分片独占缓存行，避免相邻分片的锁互相伪共享
+        struct alignas(64) Shard {
+            mutable std::shared_mutex mtx;
+            std::vector<Slot> slots;
+            size_t used = 0;
+            size_t tombstones = 0;
+
+            const Slot* Lookup(Key key, uint64_t h) const {
+                if (slots.empty()) return nullptr;
+                const size_t mask = slots.size() - 1;
+                for (size_t i = (size_t)h & mask, n = 0; n < slots.size(); i = (i + 1) & mask, ++n) {
+                    const Slot& s = slots[i];
+                    if (s.state == kEmpty) return nullptr;
+                    if (s.state == kUsed && s.key == key) return &s;
+                }
+                return nullptr;
+            }
+            Slot* Lookup(Key key, uint64_t h) {
+                return const_cast<Slot*>(static_cast<const Shard*>(this)->Lookup(key, h));
+            }
+
+            void Insert(Key key, uint64_t h, Value&& value) {
+                // 负载（含墓碑）超过 1/2 时重建：存量多则扩容，否则仅清理墓碑
+                if (slots.empty() || (used + tombstones + 1) * 2 > slots.size()) {
+                    Rehash((used + 1) * 4 > slots.size() ? (slots.empty() ? 16 : slots.size() * 2) : slots.size());
+                }
+                const size_t mask = slots.size() - 1;
+                size_t i = (size_t)h & mask;
+                while (slots[i].state == kUsed) i = (i + 1) & mask;
+                if (slots[i].state == kTombstone) --tombstones;
+                slots[i].key = key;
+                slots[i].value = std::move(value);
+                slots[i].state = kUsed;
+                ++used;
+            }
+
+            void Remove(Slot* slot) {
+                slot->value = Value{};
+                slot->state = kTombstone;
+                --used;
+                ++tombstones;
+            }
+
+            void Rehash(size_t capacity) {
+                std::vector<Slot> old;
+                old.swap(slots);
+                slots.resize(capacity);
+                used = 0;
+                tombstones = 0;
+                const size_t mask = capacity - 1;
+                for (auto& s : old) {
+                    if (s.state != kUsed) continue;
+                    size_t i = (size_t)Hash(s.key) & mask;
+                    while (slots[i].state == kUsed) i = (i + 1) & mask;
+                    slots[i].key = s.key;
+                    slots[i].value = std::move(s.value);
+                    slots[i].state = kUsed;
+                    ++used;
+                }
+            }
+        };
+
+        static uint64_t Hash(Key key) {
+            // SOCKET/指针低位常为 0（对齐），乘法散列后取高位分片、低位定位槽
+            uint64_t x = (uint64_t)(uintptr_t)key;
+            x ^= x >> 33;
+            x *= 0xFF51AFD7ED558CCDull;
+            x ^= x >> 33;
+            return x;
+        }
+
+        static constexpr size_t ShardBits() {
+            size_t bits = 0;
+            while (((size_t)1 << bits) < ShardCount) ++bits;
+            return bits;
+        }
+
+        Shard& ShardFor(uint64_t h) { return m_shards[ShardBits() == 0 ? 0 : (size_t)(h >> (64 - ShardBits()))]; }
+        const Shard& ShardFor(uint64_t h) const { return m_shards[ShardBits() == 0 ? 0 : (size_t)(h >> (64 - ShardBits()))]; }
+
+        Shard m_shards[ShardCount];
+        std::atomic<size_t> m_size{0};
+    };
+
+    // 以 RefPtr 持有记录的分片表：表本身持有每条记录一个引用
+    template <typename Key, typename Record, size_t ShardCount = 64>
+    class RefTable {
+    public:
+        RefPtr<Record> Find(Key key) const {
+            Record* found = nullptr;
+            m_table.Visit(key, [&found](Record* const& r) {
+                r->AddRef(); // 在分片锁内加引用，保证与 Remove 不冲突
+                found = r;
+            });
+            return RefPtr<Record>::Adopt(found);
+        }
+
+        // 取得或创建记录：make() 返回新记录（计数为 1，由表接管）
+        template <typename Make>
+        RefPtr<Record> FindOrCreate(Key key, Make&& make) {
+            if (auto existing = Find(key)) return existing;
+            Record* created = make();
+            // 插入前先备好“表一份 + 返回值一份”：插入后其他线程可能立刻 Remove 掉表的那一份
+            created->AddRef();
+            Record* result = created;
+            const bool inserted = m_table.InsertIfAbsent(key, created, [&result](Record*& r) {
+                r->AddRef();
+                result = r;
+            });
+            if (!inserted) {
+                // 并发下他人先插入：丢弃本次创建
+                created->Release();
+                created->Release();
+            }
+            return RefPtr<Record>::Adopt(result);
+        }
+
+        // 从表中摘除并交出表持有的引用
+        RefPtr<Record> Remove(Key key) {
+            Record* removed = nullptr;
+            if (!m_table.Erase(key, &removed)) return RefPtr<Record>();
+            return RefPtr<Record>::Adopt(removed);
+        }
+
+        // 清空：fn(Key, RefPtr<Record>)
+        template <typename Fn>
+        void Drain(Fn&& fn) {
+            m_table.Drain([&fn](Key key, Record*&& r) { fn(key, RefPtr<Record>::Adopt(r)); });
+        }
+
+        size_t Size() const { return m_table.Size(); }
+
+    private:
+        ShardedTable<Key, Record*, ShardCount> m_table;
+    };
+
+} // namespace Network
@@ -1,11 +1,14 @@
 #pragma once
-#include <winsock2.h>
-#include <ws2tcpip.h>
 #include <cstdint>
 #include <chrono>
 #include <limits>
 #include <string>
+#include "SocketCompat.hpp"
 
+// 阻塞式收发辅助（握手、UDP Associate 控制连接等）：兼容被应用设为非阻塞的 socket
+// - 就绪等待使用 poll（Windows 为 WSAPoll），不受 FD_SETSIZE 限制，也不必每次构造 fd_set
+// - 每个操作只有一个截止时间，且只在第一次需要等待时才读取时钟；数据一次收发完成时不读时钟
+// 说明：经 SocketCompat 适配，可在非 Windows 平台独立测试与基准。
 namespace Network {
 namespace SocketIo {
 
@@ -34,49 +37,63 @@ inline int RemainingTimeoutMs(const std::chrono::steady_clock::time_point& deadl
     return static_cast<int>(remainMs);
 }
 
-// 使用 select 等待可读/可写，避免非阻塞套接字直接失败
-inline bool WaitReadable(SOCKET sock, int timeoutMs) {
+// 一次操作的截止时间：首次需要等待时才开始计时，之后各次等待共用同一截止时间
+class Deadline {
+public:
+    explicit Deadline(int timeoutMs) : m_timeoutMs(NormalizeTimeoutMs(timeoutMs)) {}
+
+    // 剩余毫秒；已到期返回 0 并设置 WSAETIMEDOUT
+    int RemainingMs() {
+        if (!m_started) {
+            m_started = true;
+            m_end = BuildDeadline(m_timeoutMs);
+            return m_timeoutMs;
+        }
+        return RemainingTimeoutMs(m_end);
+    }
+
+private:
+    int m_timeoutMs;
+    bool m_started = false;
+    std::chrono::steady_clock::time_point m_end;
+};
+
+// 等待 socket 就绪（events 为 POLLIN/POLLOUT）；超时返回 false 并设置 WSAETIMEDOUT
+// 与 select 语义一致：出错/对端关闭（POLLERR/POLLHUP）也视为就绪，由随后的收发或 SO_ERROR 给出具体错误
+inline bool WaitReady(SOCKET sock, short events, int timeoutMs) {
     if (sock == INVALID_SOCKET) {
         WSASetLastError(WSAEINVAL);
         return false;
     }
-    timeoutMs = NormalizeTimeoutMs(timeoutMs);
-    fd_set readSet;
-    FD_ZERO(&readSet);
-    FD_SET(sock, &readSet);
-    timeval tv{};
-    tv.tv_sec = timeoutMs / 1000;
-    tv.tv_usec = (timeoutMs % 1000) * 1000;
-    int rc = select(0, &readSet, nullptr, nullptr, &tv);
-    if (rc > 0) return true;
-    if (rc == 0) WSASetLastError(WSAETIMEDOUT);
-    return false;
+    SocketCompat::PollFd pfd{};
+    pfd.fd = sock;
+    pfd.events = events;
+    const int rc = SocketCompat::Poll(&pfd, 1, NormalizeTimeoutMs(timeoutMs));
+    if (rc == 0) {
+        WSASetLastError(WSAETIMEDOUT);
+        return false;
+    }
+    if (rc < 0) return false;
+    if (pfd.revents & POLLNVAL) {
+        WSASetLastError(WSAENOTSOCK);
+        return false;
+    }
+    return true;
+}
+
+inline bool WaitReadable(SOCKET sock, int timeoutMs) {
+    return WaitReady(sock, POLLIN, timeoutMs);
 }
 
-// 使用 select 等待可写，避免非阻塞套接字直接失败
 inline bool WaitWritable(SOCKET sock, int timeoutMs) {
-    if (sock == INVALID_SOCKET) {
-        WSASetLastError(WSAEINVAL);
-        return false;
-    }
-    timeoutMs = NormalizeTimeoutMs(timeoutMs);
-    fd_set writeSet;
-    FD_ZERO(&writeSet);
-    FD_SET(sock, &writeSet);
-    timeval tv{};
-    tv.tv_sec = timeoutMs / 1000;
-    tv.tv_usec = (timeoutMs % 1000) * 1000;
-    int rc = select(0, nullptr, &writeSet, nullptr, &tv);
-    if (rc > 0) return true;
-    if (rc == 0) WSASetLastError(WSAETIMEDOUT);
-    return false;
+    return WaitReady(sock, POLLOUT, timeoutMs);
 }
 
 // 等待连接完成并检查 SO_ERROR，适配非阻塞 connect
 inline bool WaitConnect(SOCKET sock, int timeoutMs) {
     if (!WaitWritable(sock, timeoutMs)) return false;
     int soError = 0;
-    int optLen = sizeof(soError);
+    SocketCompat::SockLen optLen = sizeof(soError);
     if (getsockopt(sock, SOL_SOCKET, SO_ERROR, (char*)&soError, &optLen) != 0) {
         return false;
     }
@@ -87,12 +104,21 @@ inline bool WaitConnect(SOCKET sock, int timeoutMs) {
     return true;
 }
 
+// 收发返回“暂无数据/缓冲区满”时等待就绪；其他错误或截止时间已到返回 false
+inline bool WaitAfterWouldBlock(SOCKET sock, short events, Deadline& deadline) {
+    const int err = WSAGetLastError();
+    if (err != WSAEWOULDBLOCK && err != WSAEINPROGRESS) return false;
+    const int waitMs = deadline.RemainingMs();
+    if (waitMs <= 0) return false;
+    return WaitReady(sock, events, waitMs);
+}
+
 // 确保完整发送，兼容非阻塞套接字
 inline bool SendAll(SOCKET sock, const char* data, int len, int timeoutMs) {
-    const auto deadline = BuildDeadline(timeoutMs);
+    Deadline deadline(timeoutMs);
     int totalSent = 0;
     while (totalSent < len) {
-        int sent = send(sock, data + totalSent, len - totalSent, 0);
+        const int sent = (int)send(sock, data + totalSent, len - totalSent, SocketCompat::kSendNoSignal);
         if (sent > 0) {
             totalSent += sent;
             continue;
@@ -101,24 +127,17 @@ inline bool SendAll(SOCKET sock, const char* data, int len, int timeoutMs) {
             WSASetLastError(WSAECONNRESET);
             return false;
         }
-        int err = WSAGetLastError();
-        if (err == WSAEWOULDBLOCK || err == WSAEINPROGRESS) {
-            const int waitMs = RemainingTimeoutMs(deadline);
-            if (waitMs <= 0) return false;
-            if (!WaitWritable(sock, waitMs)) return false;
-            continue;
-        }
-        return false;
+        if (!WaitAfterWouldBlock(sock, POLLOUT, deadline)) return false;
     }
     return true;
 }
 
 // 精确接收指定字节数，兼容非阻塞套接字
 inline bool RecvExact(SOCKET sock, uint8_t* buf, int len, int timeoutMs) {
-    const auto deadline = BuildDeadline(timeoutMs);
+    Deadline deadline(timeoutMs);
     int totalRead = 0;
     while (totalRead < len) {
-        int read = recv(sock, (char*)buf + totalRead, len - totalRead, 0);
+        const int read = (int)recv(sock, (char*)buf + totalRead, len - totalRead, 0);
         if (read > 0) {
             totalRead += read;
             continue;
@@ -127,14 +146,7 @@ inline bool RecvExact(SOCKET sock, uint8_t* buf, int len, int timeoutMs) {
             WSASetLastError(WSAECONNRESET);
             return false;
         }
-        int err = WSAGetLastError();
-        if (err == WSAEWOULDBLOCK || err == WSAEINPROGRESS) {
-            const int waitMs = RemainingTimeoutMs(deadline);
-            if (waitMs <= 0) return false;
-            if (!WaitReadable(sock, waitMs)) return false;
-            continue;
-        }
-        return false;
+        if (!WaitAfterWouldBlock(sock, POLLIN, deadline)) return false;
     }
     return true;
 }
@@ -146,16 +158,17 @@ inline bool RecvUntil(SOCKET sock, std::string* out, const std::string& delimite
         return false;
     }
     if (maxBytes <= 0) maxBytes = 1024;
-    const auto deadline = BuildDeadline(timeoutMs);
+    Deadline deadline(timeoutMs);
     out->clear();
     out->reserve((size_t)maxBytes);
     while ((int)out->size() < maxBytes) {
         char ch = '\0';
-        int read = recv(sock, &ch, 1, 0);
+        const int read = (int)recv(sock, &ch, 1, 0);
         if (read > 0) {
             out->push_back(ch);
+            // 只需检查结尾：分隔符一旦出现即返回，不会出现在更早的位置
             if (out->size() >= delimiter.size() &&
-                out->find(delimiter) != std::string::npos) {
+                out->compare(out->size() - delimiter.size(), delimiter.size(), delimiter) == 0) {
                 return true;
             }
             continue;
@@ -164,14 +177,7 @@ inline bool RecvUntil(SOCKET sock, std::string* out, const std::string& delimite
             WSASetLastError(WSAECONNRESET);
             return false;
         }
-        int err = WSAGetLastError();
-        if (err == WSAEWOULDBLOCK || err == WSAEINPROGRESS) {
-            const int waitMs = RemainingTimeoutMs(deadline);
-            if (waitMs <= 0) return false;
-            if (!WaitReadable(sock, waitMs)) return false;
-            continue;
-        }
-        return false;
+        if (!WaitAfterWouldBlock(sock, POLLIN, deadline)) return false;
     }
     WSASetLastError(WSAEMSGSIZE);
     return false;
@@ -8,23 +8,14 @@
 #include <sstream>
 #include <iomanip>
 #include "../core/Config.hpp"
+#include "../core/ConnTrace.hpp"
 #include "../core/Logger.hpp"
+#include "HandshakeResult.hpp"
 #include "SocketIo.hpp"
+#include "Socks5Protocol.hpp"
 
 namespace Network {
     
-    // SOCKS5 Protocol Constants
-    namespace Socks5 {
-        constexpr uint8_t VERSION = 0x05;
-        constexpr uint8_t AUTH_NONE = 0x00;
-        constexpr uint8_t CMD_CONNECT = 0x01;
-        constexpr uint8_t CMD_UDP_ASSOCIATE = 0x03;
-        constexpr uint8_t ATYP_IPV4 = 0x01;
-        constexpr uint8_t ATYP_DOMAIN = 0x03;
-        constexpr uint8_t ATYP_IPV6 = 0x04;
-        constexpr uint8_t REPLY_SUCCESS = 0x00;
-    }
-    
     class Socks5Client {
     private:
         using SteadyClock = std::chrono::steady_clock;
@@ -93,8 +84,11 @@ namespace Network {
 
     public:
         // Execute SOCKS5 Handshake (No Auth)
-        // Returns true if tunnel is established
-        static bool Handshake(SOCKET sock, const std::string& targetHost, uint16_t targetPort, int handshakeBudgetMs = -1) {
+        // 返回 Ok 表示隧道已建立；失败区分代理侧错误（ProxyError）与代理应答的目标错误（TargetError）
+        // greetingBudgetMs > 0 时认证协商阶段另受该预算约束（自适应超时只收紧仅涉及代理本身的阶段）；
+        // timing 非空时输出认证协商耗时
+        static HandshakeResult Handshake(SOCKET sock, const std::string& targetHost, uint16_t targetPort, int handshakeBudgetMs = -1,
+                                         int greetingBudgetMs = -1, HandshakeTiming* timing = nullptr) {
             auto& config = Core::Config::Instance();
             const int recvTimeout = NormalizeTimeoutMs(config.timeout.recv_ms);
             const int sendTimeout = NormalizeTimeoutMs(config.timeout.send_ms);
@@ -104,28 +98,30 @@ namespace Network {
             if (handshakeBudgetMs <= 0) {
                 handshakeBudgetMs = sendTimeout + recvTimeout;
             }
+            const auto start = SteadyClock::now();
             const auto deadline = BuildDeadline(handshakeBudgetMs);
+            const auto greetingDeadline = (greetingBudgetMs > 0 && greetingBudgetMs < handshakeBudgetMs) ?
+                BuildDeadline(greetingBudgetMs) : deadline;
+            const SteadyClock::time_point* stepDeadline = &greetingDeadline;
 
             auto stepTimeout = [&](int fallbackMs, const char* stage) -> int {
-                const int timeoutMs = RemainingTimeoutMs(deadline, fallbackMs);
+                const int timeoutMs = RemainingTimeoutMs(*stepDeadline, fallbackMs);
                 if (timeoutMs <= 0) {
-                    Core::Logger::Error(std::string("SOCKS5: ") + stage + " 握手预算耗尽, sock=" +
-                                        std::to_string((unsigned long long)sock));
+                    AGP_LOG_ERROR(Socks5, std::string("SOCKS5: ") + stage + " 握手预算耗尽, sock=" +
+                                          std::to_string((unsigned long long)sock));
                 }
                 return timeoutMs;
             };
 
             if (targetHost.empty()) {
-                Core::Logger::Error("SOCKS5: 目标主机为空, sock=" + std::to_string((unsigned long long)sock));
+                AGP_LOG_ERROR(Socks5, "SOCKS5: 目标主机为空, sock=" + std::to_string((unsigned long long)sock));
                 WSASetLastError(WSAEINVAL);
-                return false;
+                return HandshakeResult::TargetError;
             }
 
-            if (Core::Logger::IsEnabled(Core::LogLevel::Debug)) {
-                Core::Logger::Debug("SOCKS5: 开始握手, sock=" + std::to_string((unsigned long long)sock) +
-                                    ", 目标=" + targetHost + ":" + std::to_string(targetPort) +
-                                    ", 预算=" + std::to_string(handshakeBudgetMs) + "ms");
-            }
+            AGP_LOG_DEBUG(Socks5, "SOCKS5: 开始握手, sock=" + std::to_string((unsigned long long)sock) +
+                                  ", 目标=" + targetHost + ":" + std::to_string(targetPort) +
+                                  ", 预算=" + std::to_string(handshakeBudgetMs) + "ms");
 
             // 1. Auth Method Negotiation
             // +----+----------+----------+
@@ -134,41 +130,47 @@ namespace Network {
             // | 1  |    1     | 1 to 255 |
             // +----+----------+----------+
             uint8_t authRequest[3] = { Socks5::VERSION, 0x01, Socks5::AUTH_NONE };
-            if (Core::Logger::IsEnabled(Core::LogLevel::Debug)) {
-                Core::Logger::Debug("SOCKS5: [1/3] 发送认证协商, sock=" + std::to_string((unsigned long long)sock) +
-                                    ", bytes=" + HexDump(authRequest, 3, 16));
-            }
+            AGP_LOG_DEBUG(Socks5, "SOCKS5: [1/3] 发送认证协商, sock=" + std::to_string((unsigned long long)sock) +
+                                  ", bytes=" + HexDump(authRequest, 3, 16));
+            AGP_FLIGHT_RECORD(Socks5Step, "[1/3] 发送认证协商", sock);
             const int authReqTimeout = stepTimeout(sendTimeout, "[1/3] 发送认证协商");
-            if (authReqTimeout <= 0) return false;
+            if (authReqTimeout <= 0) return HandshakeResult::ProxyError;
             if (!SocketIo::SendAll(sock, (const char*)authRequest, 3, authReqTimeout)) {
                 int err = WSAGetLastError();
-                Core::Logger::Error("SOCKS5: [1/3] 发送认证协商失败, sock=" + std::to_string((unsigned long long)sock) +
-                                    ", WSA错误码=" + std::to_string(err));
-                return false;
+                AGP_LOG_ERROR(Socks5, "SOCKS5: [1/3] 发送认证协商失败, sock=" + std::to_string((unsigned long long)sock) +
+                                      ", WSA错误码=" + std::to_string(err));
+                return HandshakeResult::ProxyError;
             }
             
             // Receive Auth Method Response
             uint8_t authResponse[2];
             const int authRespTimeout = stepTimeout(recvTimeout, "[1/3] 读取认证响应");
-            if (authRespTimeout <= 0) return false;
+            if (authRespTimeout <= 0) return HandshakeResult::ProxyError;
             if (!ReadExact(sock, authResponse, 2, authRespTimeout)) {
                 int err = WSAGetLastError();
-                Core::Logger::Error("SOCKS5: [1/3] 读取认证响应失败, sock=" + std::to_string((unsigned long long)sock) +
-                                    ", WSA错误码=" + std::to_string(err));
-                return false;
-            }
-            if (Core::Logger::IsEnabled(Core::LogLevel::Debug)) {
-                Core::Logger::Debug("SOCKS5: [1/3] 收到认证响应, sock=" + std::to_string((unsigned long long)sock) +
-                                    ", VER=" + std::to_string(authResponse[0]) + ", METHOD=" + std::to_string(authResponse[1]) +
-                                    ", bytes=" + HexDump(authResponse, 2, 16));
+                AGP_LOG_ERROR(Socks5, "SOCKS5: [1/3] 读取认证响应失败, sock=" + std::to_string((unsigned long long)sock) +
+                                      ", WSA错误码=" + std::to_string(err));
+                return HandshakeResult::ProxyError;
             }
+            AGP_LOG_DEBUG(Socks5, "SOCKS5: [1/3] 收到认证响应, sock=" + std::to_string((unsigned long long)sock) +
+                                  ", VER=" + std::to_string(authResponse[0]) + ", METHOD=" + std::to_string(authResponse[1]) +
+                                  ", bytes=" + HexDump(authResponse, 2, 16));
             
+            AGP_FLIGHT_RECORD(Socks5Step, "[1/3] 收到认证响应", sock);
             if (authResponse[0] != Socks5::VERSION || authResponse[1] != Socks5::AUTH_NONE) {
-                Core::Logger::Error("SOCKS5: [1/3] 不支持的认证方式, sock=" + std::to_string((unsigned long long)sock) +
-                                    ", 版本=" + std::to_string(authResponse[0]) + ", 方法=" + std::to_string(authResponse[1]) +
-                                    ", bytes=" + HexDump(authResponse, 2, 16));
-                return false;
+                AGP_LOG_ERROR(Socks5, "SOCKS5: [1/3] 不支持的认证方式, sock=" + std::to_string((unsigned long long)sock) +
+                                      ", 版本=" + std::to_string(authResponse[0]) + ", 方法=" + std::to_string(authResponse[1]) +
+                                      ", bytes=" + HexDump(authResponse, 2, 16));
+                return HandshakeResult::ProxyError;
             }
+            Core::ConnTrace::Instance().Mark((uint64_t)sock, Core::TraceStage::GreetingDone);
+            if (timing) {
+                const auto us = std::chrono::duration_cast<std::chrono::microseconds>(SteadyClock::now() - start).count();
+                timing->greetingDone = true;
+                timing->greetingUs = us > 0 ? (uint64_t)us : 0;
+            }
+            // CONNECT 应答包含代理连接目标的时间：之后只受整体预算约束
+            stepDeadline = &deadline;
             
             // 2. Send Connect Request
             // +----+-----+-------+------+----------+----------+
@@ -200,10 +202,10 @@ namespace Network {
                 } else {
                     // 域名
                     if (targetHost.size() > 255) {
-                        Core::Logger::Error("SOCKS5: [2/3] 目标域名过长, sock=" + std::to_string((unsigned long long)sock) +
-                                            ", len=" + std::to_string(targetHost.size()));
+                        AGP_LOG_ERROR(Socks5, "SOCKS5: [2/3] 目标域名过长, sock=" + std::to_string((unsigned long long)sock) +
+                                              ", len=" + std::to_string(targetHost.size()));
                         WSASetLastError(WSAEINVAL);
-                        return false;
+                        return HandshakeResult::TargetError;
                     }
                     atypForLog = Socks5::ATYP_DOMAIN;
                     request.push_back(atypForLog);
@@ -217,18 +219,17 @@ namespace Network {
             request.push_back((targetPort >> 8) & 0xFF);
             request.push_back(targetPort & 0xFF);
             
-            if (Core::Logger::IsEnabled(Core::LogLevel::Debug)) {
-                Core::Logger::Debug("SOCKS5: [2/3] 发送 CONNECT 请求, sock=" + std::to_string((unsigned long long)sock) +
-                                    ", ATYP=" + std::to_string(atypForLog) +
-                                    ", payload_len=" + std::to_string(request.size()));
-            }
+            AGP_LOG_DEBUG(Socks5, "SOCKS5: [2/3] 发送 CONNECT 请求, sock=" + std::to_string((unsigned long long)sock) +
+                                  ", ATYP=" + std::to_string(atypForLog) +
+                                  ", payload_len=" + std::to_string(request.size()));
+            AGP_FLIGHT_RECORD(Socks5Step, "[2/3] 发送 CONNECT 请求", sock);
             const int connectReqTimeout = stepTimeout(sendTimeout, "[2/3] 发送 CONNECT 请求");
-            if (connectReqTimeout <= 0) return false;
+            if (connectReqTimeout <= 0) return HandshakeResult::ProxyError;
             if (!SocketIo::SendAll(sock, (const char*)request.data(), (int)request.size(), connectReqTimeout)) {
                 int err = WSAGetLastError();
-                Core::Logger::Error("SOCKS5: [2/3] 发送 CONNECT 请求失败, sock=" + std::to_string((unsigned long long)sock) +
-                                    ", WSA错误码=" + std::to_string(err));
-                return false;
+                AGP_LOG_ERROR(Socks5, "SOCKS5: [2/3] 发送 CONNECT 请求失败, sock=" + std::to_string((unsigned long long)sock) +
+                                      ", WSA错误码=" + std::to_string(err));
+                return HandshakeResult::ProxyError;
             }
             
             // 3. Receive Connect Response
@@ -237,31 +238,30 @@ namespace Network {
             // Read Header: VER, REP, RSV, ATYP
             uint8_t header[4];
             const int respHeaderTimeout = stepTimeout(recvTimeout, "[3/3] 读取响应头");
-            if (respHeaderTimeout <= 0) return false;
+            if (respHeaderTimeout <= 0) return HandshakeResult::ProxyError;
             if (!ReadExact(sock, header, 4, respHeaderTimeout)) {
                 int err = WSAGetLastError();
-                Core::Logger::Error("SOCKS5: [3/3] 读取响应头失败, sock=" + std::to_string((unsigned long long)sock) +
-                                    ", WSA错误码=" + std::to_string(err));
-                return false;
-            }
-            if (Core::Logger::IsEnabled(Core::LogLevel::Debug)) {
-                Core::Logger::Debug("SOCKS5: [3/3] 收到响应头, sock=" + std::to_string((unsigned long long)sock) +
-                                    ", VER=" + std::to_string(header[0]) + ", REP=" + std::to_string(header[1]) +
-                                    ", ATYP=" + std::to_string(header[3]) + ", bytes=" + HexDump(header, 4, 16));
+                AGP_LOG_ERROR(Socks5, "SOCKS5: [3/3] 读取响应头失败, sock=" + std::to_string((unsigned long long)sock) +
+                                      ", WSA错误码=" + std::to_string(err));
+                return HandshakeResult::ProxyError;
             }
+            AGP_LOG_DEBUG(Socks5, "SOCKS5: [3/3] 收到响应头, sock=" + std::to_string((unsigned long long)sock) +
+                                  ", VER=" + std::to_string(header[0]) + ", REP=" + std::to_string(header[1]) +
+                                  ", ATYP=" + std::to_string(header[3]) + ", bytes=" + HexDump(header, 4, 16));
             
+            AGP_FLIGHT_RECORD(Socks5Reply, sock, header[0], header[1], header[3]);
             if (header[0] != Socks5::VERSION) {
-                Core::Logger::Error("SOCKS5: [3/3] 响应版本无效, sock=" + std::to_string((unsigned long long)sock) +
-                                    ", VER=" + std::to_string(header[0]) + ", bytes=" + HexDump(header, 4, 16));
-                return false;
+                AGP_LOG_ERROR(Socks5, "SOCKS5: [3/3] 响应版本无效, sock=" + std::to_string((unsigned long long)sock) +
+                                      ", VER=" + std::to_string(header[0]) + ", bytes=" + HexDump(header, 4, 16));
+                return HandshakeResult::ProxyError;
             }
             
             if (header[1] != Socks5::REPLY_SUCCESS) {
-                Core::Logger::Error("SOCKS5: [3/3] 代理服务器拒绝 CONNECT, sock=" + std::to_string((unsigned long long)sock) +
-                                    ", REP=" + std::to_string(header[1]) + "(" + ReplyToText(header[1]) + ")" +
-                                    ", 目标=" + targetHost + ":" + std::to_string(targetPort) +
-                                    ", bytes=" + HexDump(header, 4, 16));
-                return false;
+                AGP_LOG_ERROR(Socks5, "SOCKS5: [3/3] 代理服务器拒绝 CONNECT, sock=" + std::to_string((unsigned long long)sock) +
+                                      ", REP=" + std::to_string(header[1]) + "(" + ReplyToText(header[1]) + ")" +
+                                      ", 目标=" + targetHost + ":" + std::to_string(targetPort) +
+                                      ", bytes=" + HexDump(header, 4, 16));
+                return ClassifySocks5Reply(header[1]);
             }
             
             // Determine Address Length based on ATYP
@@ -277,51 +277,51 @@ namespace Network {
                 case Socks5::ATYP_DOMAIN: {
                     uint8_t lenByte;
                     const int domainLenTimeout = stepTimeout(recvTimeout, "[3/3] 读取 BND.DOMAIN 长度");
-                    if (domainLenTimeout <= 0) return false;
+                    if (domainLenTimeout <= 0) return HandshakeResult::ProxyError;
                     if (!ReadExact(sock, &lenByte, 1, domainLenTimeout)) {
                         int err = WSAGetLastError();
-                        Core::Logger::Error("SOCKS5: [3/3] 读取 BND.DOMAIN 长度失败, sock=" + std::to_string((unsigned long long)sock) +
-                                            ", WSA错误码=" + std::to_string(err));
-                        return false;
+                        AGP_LOG_ERROR(Socks5, "SOCKS5: [3/3] 读取 BND.DOMAIN 长度失败, sock=" + std::to_string((unsigned long long)sock) +
+                                              ", WSA错误码=" + std::to_string(err));
+                        return HandshakeResult::ProxyError;
                     }
                     addrLen = lenByte;
                     break;
                 }
                 default:
-                    Core::Logger::Error("SOCKS5: [3/3] 未知的 ATYP, sock=" + std::to_string((unsigned long long)sock) +
-                                        ", ATYP=" + std::to_string(atyp) + ", bytes=" + HexDump(header, 4, 16));
-                    return false;
+                    AGP_LOG_ERROR(Socks5, "SOCKS5: [3/3] 未知的 ATYP, sock=" + std::to_string((unsigned long long)sock) +
+                                          ", ATYP=" + std::to_string(atyp) + ", bytes=" + HexDump(header, 4, 16));
+                    return HandshakeResult::ProxyError;
             }
             
             // Consume Address Bytes (Ignore actual value as we don't need the bind addr)
             if (addrLen > 0) {
                 std::vector<uint8_t> trash(addrLen);
                 const int bndAddrTimeout = stepTimeout(recvTimeout, "[3/3] 读取 BND.ADDR");
-                if (bndAddrTimeout <= 0) return false;
+                if (bndAddrTimeout <= 0) return HandshakeResult::ProxyError;
                 if (!ReadExact(sock, trash.data(), addrLen, bndAddrTimeout)) {
                     int err = WSAGetLastError();
-                    Core::Logger::Error("SOCKS5: [3/3] 读取 BND.ADDR 失败, sock=" + std::to_string((unsigned long long)sock) +
-                                        ", WSA错误码=" + std::to_string(err));
-                    return false;
+                    AGP_LOG_ERROR(Socks5, "SOCKS5: [3/3] 读取 BND.ADDR 失败, sock=" + std::to_string((unsigned long long)sock) +
+                                          ", WSA错误码=" + std::to_string(err));
+                    return HandshakeResult::ProxyError;
                 }
             }
             
             // Consume Port (2 bytes)
             uint8_t portBuf[2];
             const int bndPortTimeout = stepTimeout(recvTimeout, "[3/3] 读取 BND.PORT");
-            if (bndPortTimeout <= 0) return false;
+            if (bndPortTimeout <= 0) return HandshakeResult::ProxyError;
             if (!ReadExact(sock, portBuf, 2, bndPortTimeout)) {
                 int err = WSAGetLastError();
-                Core::Logger::Error("SOCKS5: [3/3] 读取 BND.PORT 失败, sock=" + std::to_string((unsigned long long)sock) +
-                                    ", WSA错误码=" + std::to_string(err));
-                return false;
+                AGP_LOG_ERROR(Socks5, "SOCKS5: [3/3] 读取 BND.PORT 失败, sock=" + std::to_string((unsigned long long)sock) +
+                                      ", WSA错误码=" + std::to_string(err));
+                return HandshakeResult::ProxyError;
             }
             
-            Core::Logger::Info("SOCKS5: 隧道建立成功, sock=" + std::to_string((unsigned long long)sock) +
-                               ", 目标=" + targetHost + ":" + std::to_string(targetPort) +
-                               ", BND.ATYP=" + std::to_string(atyp) +
-                               ", BND.PORT=" + std::to_string((static_cast<uint16_t>(portBuf[0]) << 8) | portBuf[1]));
-            return true;
+            AGP_LOG_INFO(Socks5, "SOCKS5: 隧道建立成功, sock=" + std::to_string((unsigned long long)sock) +
+                                 ", 目标=" + targetHost + ":" + std::to_string(targetPort) +
+                                 ", BND.ATYP=" + std::to_string(atyp) +
+                                 ", BND.PORT=" + std::to_string((static_cast<uint16_t>(portBuf[0]) << 8) | portBuf[1]));
+            return HandshakeResult::Ok;
         }
     };
 }
@@ -0,0 +1,130 @@
+#pragma once
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include "SocketCompat.hpp"
+
+namespace Network {
+
+    // SOCKS5 协议常量与 UDP 头编解码
+    // 说明：本文件不依赖 Config/Logger，供 Hooks 层与 UDP 中继等模块共用，也可在非 Windows 平台独立测试。
+    namespace Socks5 {
+        constexpr uint8_t VERSION = 0x05;
+        constexpr uint8_t AUTH_NONE = 0x00;
+        constexpr uint8_t CMD_CONNECT = 0x01;
+        constexpr uint8_t CMD_UDP_ASSOCIATE = 0x03;
+        constexpr uint8_t ATYP_IPV4 = 0x01;
+        constexpr uint8_t ATYP_DOMAIN = 0x03;
+        constexpr uint8_t ATYP_IPV6 = 0x04;
+        constexpr uint8_t REPLY_SUCCESS = 0x00;
+
+        // UDP 头解析结果：addr 指向报文内部（不拷贝），生命周期与报文一致
+        struct UdpHeaderView {
+            uint8_t atyp = 0;
+            const uint8_t* addr = nullptr; // IPv4: 4 字节；IPv6: 16 字节；域名: 不含长度前缀
+            size_t addrLen = 0;
+            uint16_t port = 0;
+            size_t headerLen = 0;          // payload 起始偏移
+        };
+
+        // 将 host:port 编码为 SOCKS5 UDP 头（RSV + FRAG=0 + ATYP + ADDR + PORT）
+        // 返回头长度；host 过长或缓冲不足时返回 0
+        inline size_t EncodeUdpHeader(const std::string& host, uint16_t port, uint8_t* out, size_t cap) {
+            if (!out) return 0;
+            uint8_t addr[16];
+            size_t addrLen = 0;
+            uint8_t atyp = ATYP_DOMAIN;
+            if (!host.empty() && inet_pton(AF_INET, host.c_str(), addr) == 1) {
+                atyp = ATYP_IPV4;
+                addrLen = 4;
+            } else if (!host.empty() && inet_pton(AF_INET6, host.c_str(), addr) == 1) {
+                atyp = ATYP_IPV6;
+                addrLen = 16;
+            } else if (host.size() > 255) {
+                return 0;
+            }
+
+            const size_t headerLen = 4 + (atyp == ATYP_DOMAIN ? 1 + host.size() : addrLen) + 2;
+            if (cap < headerLen) return 0;
+            size_t pos = 0;
+            out[pos++] = 0x00;
+            out[pos++] = 0x00;
+            out[pos++] = 0x00; // FRAG=0（不支持分片）
+            out[pos++] = atyp;
+            if (atyp == ATYP_DOMAIN) {
+                out[pos++] = (uint8_t)host.size();
+                if (!host.empty()) memcpy(out + pos, host.data(), host.size());
+                pos += host.size();
+            } else {
+                memcpy(out + pos, addr, addrLen);
+                pos += addrLen;
+            }
+            out[pos++] = (uint8_t)((port >> 8) & 0xFF);
+            out[pos++] = (uint8_t)(port & 0xFF);
+            return pos;
+        }
+
+        // 解析 SOCKS5 UDP 头；RSV 非 0、FRAG 非 0（不支持分片）或长度不足时返回 false
+        inline bool DecodeUdpHeader(const uint8_t* packet, size_t packetLen, UdpHeaderView* out) {
+            if (!packet || !out || packetLen < 4) return false;
+            if (packet[0] != 0x00 || packet[1] != 0x00 || packet[2] != 0x00) return false;
+            UdpHeaderView view;
+            view.atyp = packet[3];
+            size_t pos = 4;
+            if (view.atyp == ATYP_IPV4) {
+                view.addrLen = 4;
+            } else if (view.atyp == ATYP_IPV6) {
+                view.addrLen = 16;
+            } else if (view.atyp == ATYP_DOMAIN) {
+                if (packetLen < pos + 1) return false;
+                view.addrLen = packet[pos++];
+            } else {
+                return false;
+            }
+            if (packetLen < pos + view.addrLen + 2) return false;
+            view.addr = packet + pos;
+            pos += view.addrLen;
+            view.port = (uint16_t)((packet[pos] << 8) | packet[pos + 1]);
+            pos += 2;
+            view.headerLen = pos;
+            *out = view;
+            return true;
+        }
+
+        // 将 UDP 头中的地址格式化为文本（IPv4/IPv6 使用 inet_ntop 规范形式，域名原样返回）
+        inline std::string FormatUdpHeaderHost(const UdpHeaderView& view) {
+            if (!view.addr) return "";
+            if (view.atyp == ATYP_DOMAIN) {
+                return std::string((const char*)view.addr, view.addrLen);
+            }
+            char buf[INET6_ADDRSTRLEN] = {};
+            const int family = view.atyp == ATYP_IPV4 ? AF_INET : AF_INET6;
+            if (!inet_ntop(family, (void*)view.addr, buf, sizeof(buf))) return "";
+            return std::string(buf);
+        }
+
+        // 将 UDP 头中的 IP 地址转换为 sockaddr（域名无法转换，返回 false）
+        inline bool UdpHeaderToSockaddr(const UdpHeaderView& view, sockaddr_storage* out, int* outLen) {
+            if (!view.addr || !out || !outLen) return false;
+            memset(out, 0, sizeof(sockaddr_storage));
+            if (view.atyp == ATYP_IPV4) {
+                sockaddr_in* a4 = (sockaddr_in*)out;
+                a4->sin_family = AF_INET;
+                memcpy(&a4->sin_addr, view.addr, 4);
+                a4->sin_port = htons(view.port);
+                *outLen = (int)sizeof(sockaddr_in);
+                return true;
+            }
+            if (view.atyp == ATYP_IPV6) {
+                sockaddr_in6* a6 = (sockaddr_in6*)out;
+                a6->sin6_family = AF_INET6;
+                memcpy(&a6->sin6_addr, view.addr, 16);
+                a6->sin6_port = htons(view.port);
+                *outLen = (int)sizeof(sockaddr_in6);
+                return true;
+            }
+            *outLen = 0;
+            return false;
+        }
+    } // namespace Socks5
+} // namespace Network
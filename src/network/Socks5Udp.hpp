@@ -100,22 +100,22 @@ namespace Network {
             uint8_t authRequest[3] = { Socks5::VERSION, 0x01, Socks5::AUTH_NONE };
             if (!SocketIo::SendAll(tcpSock, (const char*)authRequest, 3, sendTimeoutMs)) {
                 int err = WSAGetLastError();
-                Core::Logger::Error("SOCKS5 UDP: 发送认证协商失败, sock=" + std::to_string((unsigned long long)tcpSock) +
-                                    ", WSA错误码=" + std::to_string(err));
+                AGP_LOG_ERROR(Udp, "SOCKS5 UDP: 发送认证协商失败, sock=" + std::to_string((unsigned long long)tcpSock) +
+                                   ", WSA错误码=" + std::to_string(err));
                 return false;
             }
             uint8_t authResp[2] = {0, 0};
             if (!SocketIo::RecvExact(tcpSock, authResp, 2, recvTimeoutMs)) {
                 int err = WSAGetLastError();
-                Core::Logger::Error("SOCKS5 UDP: 读取认证响应失败, sock=" + std::to_string((unsigned long long)tcpSock) +
-                                    ", WSA错误码=" + std::to_string(err));
+                AGP_LOG_ERROR(Udp, "SOCKS5 UDP: 读取认证响应失败, sock=" + std::to_string((unsigned long long)tcpSock) +
+                                   ", WSA错误码=" + std::to_string(err));
                 return false;
             }
             if (authResp[0] != Socks5::VERSION || authResp[1] != Socks5::AUTH_NONE) {
-                Core::Logger::Error("SOCKS5 UDP: 认证协商失败, sock=" + std::to_string((unsigned long long)tcpSock) +
-                                    ", VER=" + std::to_string(authResp[0]) +
-                                    ", METHOD=" + std::to_string(authResp[1]) +
-                                    ", bytes=" + HexDump(authResp, 2, 16));
+                AGP_LOG_ERROR(Udp, "SOCKS5 UDP: 认证协商失败, sock=" + std::to_string((unsigned long long)tcpSock) +
+                                   ", VER=" + std::to_string(authResp[0]) +
+                                   ", METHOD=" + std::to_string(authResp[1]) +
+                                   ", bytes=" + HexDump(authResp, 2, 16));
                 return false;
             }
             return true;
@@ -139,9 +139,7 @@ namespace Network {
             const int recvTimeout = config.timeout.recv_ms;
             const int sendTimeout = config.timeout.send_ms;
 
-            if (Core::Logger::IsEnabled(Core::LogLevel::Debug)) {
-                Core::Logger::Debug("SOCKS5 UDP: 开始 UDP Associate, sock=" + std::to_string((unsigned long long)tcpSock));
-            }
+            AGP_LOG_DEBUG(Udp, "SOCKS5 UDP: 开始 UDP Associate, sock=" + std::to_string((unsigned long long)tcpSock));
 
             if (!NegotiateNoAuth(tcpSock, sendTimeout, recvTimeout)) {
                 return false;
@@ -192,8 +190,8 @@ namespace Network {
 
             if (!SocketIo::SendAll(tcpSock, (const char*)request.data(), (int)request.size(), sendTimeout)) {
                 int err = WSAGetLastError();
-                Core::Logger::Error("SOCKS5 UDP: 发送 UDP Associate 请求失败, sock=" + std::to_string((unsigned long long)tcpSock) +
-                                    ", WSA错误码=" + std::to_string(err));
+                AGP_LOG_ERROR(Udp, "SOCKS5 UDP: 发送 UDP Associate 请求失败, sock=" + std::to_string((unsigned long long)tcpSock) +
+                                   ", WSA错误码=" + std::to_string(err));
                 return false;
             }
 
@@ -201,19 +199,19 @@ namespace Network {
             uint8_t header[4] = {0, 0, 0, 0};
             if (!SocketIo::RecvExact(tcpSock, header, 4, recvTimeout)) {
                 int err = WSAGetLastError();
-                Core::Logger::Error("SOCKS5 UDP: 读取响应头失败, sock=" + std::to_string((unsigned long long)tcpSock) +
-                                    ", WSA错误码=" + std::to_string(err));
+                AGP_LOG_ERROR(Udp, "SOCKS5 UDP: 读取响应头失败, sock=" + std::to_string((unsigned long long)tcpSock) +
+                                   ", WSA错误码=" + std::to_string(err));
                 return false;
             }
             if (header[0] != Socks5::VERSION || header[2] != 0x00) {
-                Core::Logger::Error("SOCKS5 UDP: 响应头无效, sock=" + std::to_string((unsigned long long)tcpSock) +
-                                    ", bytes=" + HexDump(header, 4, 16));
+                AGP_LOG_ERROR(Udp, "SOCKS5 UDP: 响应头无效, sock=" + std::to_string((unsigned long long)tcpSock) +
+                                   ", bytes=" + HexDump(header, 4, 16));
                 return false;
             }
             if (header[1] != Socks5::REPLY_SUCCESS) {
-                Core::Logger::Error("SOCKS5 UDP: 服务器拒绝 UDP Associate, sock=" + std::to_string((unsigned long long)tcpSock) +
-                                    ", REP=" + std::to_string(header[1]) +
-                                    ", bytes=" + HexDump(header, 4, 16));
+                AGP_LOG_ERROR(Udp, "SOCKS5 UDP: 服务器拒绝 UDP Associate, sock=" + std::to_string((unsigned long long)tcpSock) +
+                                   ", REP=" + std::to_string(header[1]) +
+                                   ", bytes=" + HexDump(header, 4, 16));
                 return false;
             }
 
@@ -227,15 +225,15 @@ namespace Network {
                 uint8_t ip4[4] = {};
                 if (!SocketIo::RecvExact(tcpSock, ip4, 4, recvTimeout)) {
                     int err = WSAGetLastError();
-                    Core::Logger::Error("SOCKS5 UDP: 读取 BND.IPv4 失败, sock=" + std::to_string((unsigned long long)tcpSock) +
-                                        ", WSA错误码=" + std::to_string(err));
+                    AGP_LOG_ERROR(Udp, "SOCKS5 UDP: 读取 BND.IPv4 失败, sock=" + std::to_string((unsigned long long)tcpSock) +
+                                       ", WSA错误码=" + std::to_string(err));
                     return false;
                 }
                 uint8_t portBuf[2] = {};
                 if (!SocketIo::RecvExact(tcpSock, portBuf, 2, recvTimeout)) {
                     int err = WSAGetLastError();
-                    Core::Logger::Error("SOCKS5 UDP: 读取 BND.PORT 失败, sock=" + std::to_string((unsigned long long)tcpSock) +
-                                        ", WSA错误码=" + std::to_string(err));
+                    AGP_LOG_ERROR(Udp, "SOCKS5 UDP: 读取 BND.PORT 失败, sock=" + std::to_string((unsigned long long)tcpSock) +
+                                       ", WSA错误码=" + std::to_string(err));
                     return false;
                 }
                 relayPort = (uint16_t)((portBuf[0] << 8) | portBuf[1]);
@@ -251,15 +249,15 @@ namespace Network {
                 uint8_t ip6[16] = {};
                 if (!SocketIo::RecvExact(tcpSock, ip6, 16, recvTimeout)) {
                     int err = WSAGetLastError();
-                    Core::Logger::Error("SOCKS5 UDP: 读取 BND.IPv6 失败, sock=" + std::to_string((unsigned long long)tcpSock) +
-                                        ", WSA错误码=" + std::to_string(err));
+                    AGP_LOG_ERROR(Udp, "SOCKS5 UDP: 读取 BND.IPv6 失败, sock=" + std::to_string((unsigned long long)tcpSock) +
+                                       ", WSA错误码=" + std::to_string(err));
                     return false;
                 }
                 uint8_t portBuf[2] = {};
                 if (!SocketIo::RecvExact(tcpSock, portBuf, 2, recvTimeout)) {
                     int err = WSAGetLastError();
-                    Core::Logger::Error("SOCKS5 UDP: 读取 BND.PORT 失败, sock=" + std::to_string((unsigned long long)tcpSock) +
-                                        ", WSA错误码=" + std::to_string(err));
+                    AGP_LOG_ERROR(Udp, "SOCKS5 UDP: 读取 BND.PORT 失败, sock=" + std::to_string((unsigned long long)tcpSock) +
+                                       ", WSA错误码=" + std::to_string(err));
                     return false;
                 }
                 relayPort = (uint16_t)((portBuf[0] << 8) | portBuf[1]);
@@ -276,32 +274,32 @@ namespace Network {
                 uint8_t dlen = 0;
                 if (!SocketIo::RecvExact(tcpSock, &dlen, 1, recvTimeout)) {
                     int err = WSAGetLastError();
-                    Core::Logger::Error("SOCKS5 UDP: 读取 BND.DOMAIN 长度失败, sock=" + std::to_string((unsigned long long)tcpSock) +
-                                        ", WSA错误码=" + std::to_string(err));
+                    AGP_LOG_ERROR(Udp, "SOCKS5 UDP: 读取 BND.DOMAIN 长度失败, sock=" + std::to_string((unsigned long long)tcpSock) +
+                                       ", WSA错误码=" + std::to_string(err));
                     return false;
                 }
                 if (dlen > 0) {
                     std::vector<uint8_t> trash(dlen);
                     if (!SocketIo::RecvExact(tcpSock, trash.data(), (int)trash.size(), recvTimeout)) {
                         int err = WSAGetLastError();
-                        Core::Logger::Error("SOCKS5 UDP: 读取 BND.DOMAIN 失败, sock=" + std::to_string((unsigned long long)tcpSock) +
-                                            ", WSA错误码=" + std::to_string(err));
+                        AGP_LOG_ERROR(Udp, "SOCKS5 UDP: 读取 BND.DOMAIN 失败, sock=" + std::to_string((unsigned long long)tcpSock) +
+                                           ", WSA错误码=" + std::to_string(err));
                         return false;
                     }
                 }
                 uint8_t portBuf[2] = {};
                 if (!SocketIo::RecvExact(tcpSock, portBuf, 2, recvTimeout)) {
                     int err = WSAGetLastError();
-                    Core::Logger::Error("SOCKS5 UDP: 读取 BND.PORT 失败, sock=" + std::to_string((unsigned long long)tcpSock) +
-                                        ", WSA错误码=" + std::to_string(err));
+                    AGP_LOG_ERROR(Udp, "SOCKS5 UDP: 读取 BND.PORT 失败, sock=" + std::to_string((unsigned long long)tcpSock) +
+                                       ", WSA错误码=" + std::to_string(err));
                     return false;
                 }
                 relayPort = (uint16_t)((portBuf[0] << 8) | portBuf[1]);
                 needUsePeerIp = true;
             } else {
-                Core::Logger::Error("SOCKS5 UDP: 未知 ATYP, sock=" + std::to_string((unsigned long long)tcpSock) +
-                                    ", ATYP=" + std::to_string(repAtyp) +
-                                    ", bytes=" + HexDump(header, 4, 16));
+                AGP_LOG_ERROR(Udp, "SOCKS5 UDP: 未知 ATYP, sock=" + std::to_string((unsigned long long)tcpSock) +
+                                   ", ATYP=" + std::to_string(repAtyp) +
+                                   ", bytes=" + HexDump(header, 4, 16));
                 return false;
             }
 
@@ -309,7 +307,7 @@ namespace Network {
                 sockaddr_storage peerRelay{};
                 int peerRelayLen = 0;
                 if (!CopyPeerIpAsRelay(tcpSock, relayPort, &peerRelay, &peerRelayLen)) {
-                    Core::Logger::Error("SOCKS5 UDP: 获取 peer IP 作为 relay 失败, sock=" + std::to_string((unsigned long long)tcpSock));
+                    AGP_LOG_ERROR(Udp, "SOCKS5 UDP: 获取 peer IP 作为 relay 失败, sock=" + std::to_string((unsigned long long)tcpSock));
                     return false;
                 }
                 relay = peerRelay;
@@ -319,11 +317,11 @@ namespace Network {
             out->relayAddr = relay;
             out->relayAddrLen = relayLen;
 
-            if (Core::Logger::IsEnabled(Core::LogLevel::Debug)) {
+            if (AGP_LOG_ENABLED(Udp, Debug)) {
                 const std::string relayIp = SockaddrToStringNoPort((sockaddr*)&relay);
-                Core::Logger::Debug("SOCKS5 UDP: relay 获取成功, sock=" + std::to_string((unsigned long long)tcpSock) +
-                                    ", relay_ip=" + (relayIp.empty() ? std::string("(未知)") : relayIp) +
-                                    ", relay_port=" + std::to_string(relayPort));
+                AGP_LOG_DEBUG(Udp, "SOCKS5 UDP: relay 获取成功, sock=" + std::to_string((unsigned long long)tcpSock) +
+                                   ", relay_ip=" + (relayIp.empty() ? std::string("(未知)") : relayIp) +
+                                   ", relay_port=" + std::to_string(relayPort));
             }
 
             return true;
@@ -338,45 +336,21 @@ namespace Network {
         };
 
         // 将 host:port + payload 封装为 SOCKS5 UDP Request
+        // 注意：会复制 payload；Hooks 发送路径改用 Socks5::EncodeUdpHeader + WSABUF 聚合发送，此函数保留给需要整包的调用方
         inline bool Wrap(const std::string& host, uint16_t port, const uint8_t* payload, size_t payloadLen, std::vector<uint8_t>* outPacket) {
             if (!outPacket) return false;
             outPacket->clear();
 
-            // 解析 host -> ATYP + addrBytes
-            uint8_t atyp = Socks5::ATYP_DOMAIN;
-            std::vector<uint8_t> addrBytes;
-            in_addr addr4{};
-            in6_addr addr6{};
-            if (!host.empty() && inet_pton(AF_INET, host.c_str(), &addr4) == 1) {
-                atyp = Socks5::ATYP_IPV4;
-                addrBytes.resize(4);
-                memcpy(addrBytes.data(), &addr4, 4);
-            } else if (!host.empty() && inet_pton(AF_INET6, host.c_str(), &addr6) == 1) {
-                atyp = Socks5::ATYP_IPV6;
-                addrBytes.resize(16);
-                memcpy(addrBytes.data(), &addr6, 16);
-            } else {
-                // 域名
-                if (host.size() > 255) {
-                    Core::Logger::Error("SOCKS5 UDP: 域名过长，无法封装 (len=" + std::to_string(host.size()) + ")");
-                    return false;
-                }
-                atyp = Socks5::ATYP_DOMAIN;
-                addrBytes.reserve(1 + host.size());
-                addrBytes.push_back((uint8_t)host.size());
-                addrBytes.insert(addrBytes.end(), host.begin(), host.end());
+            uint8_t header[kMaxUdpHeaderBytes];
+            const size_t headerLen = Socks5::EncodeUdpHeader(host, port, header, sizeof(header));
+            if (headerLen == 0) {
+                AGP_LOG_ERROR(Udp, "SOCKS5 UDP: 域名过长，无法封装 (len=" + std::to_string(host.size()) + ")");
+                return false;
             }
 
             // RSV(2) + FRAG(1) + ATYP(1) + DST.ADDR + DST.PORT(2) + DATA
-            const size_t headerLen = 2 + 1 + 1 + addrBytes.size() + 2;
             outPacket->reserve(headerLen + payloadLen);
-            outPacket->push_back(0x00);
-            outPacket->push_back(0x00);
-            outPacket->push_back(0x00); // FRAG=0（不支持分片）
-            outPacket->push_back(atyp);
-            outPacket->insert(outPacket->end(), addrBytes.begin(), addrBytes.end());
-            outPacket->push_back((uint8_t)((port >> 8) & 0xFF));
-            outPacket->push_back((uint8_t)(port & 0xFF));
+            outPacket->insert(outPacket->end(), header, header + headerLen);
             if (payload && payloadLen > 0) {
                 outPacket->insert(outPacket->end(), payload, payload + payloadLen);
             }
@@ -0,0 +1,227 @@
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace Network {
+
+    enum class TrafficDirection : uint8_t {
+        Send = 0,
+        Recv = 1,
+    };
+
+    // 一组流量计数（读取时的聚合结果）
+    // ops 为成功完成的收发调用次数；packets 为数据报个数（仅 UDP，TCP 为 0）
+    struct TrafficTotals {
+        uint64_t bytesSent = 0;
+        uint64_t bytesRecv = 0;
+        uint64_t opsSent = 0;
+        uint64_t opsRecv = 0;
+        uint64_t packetsSent = 0;
+        uint64_t packetsRecv = 0;
+
+        TrafficTotals& operator+=(const TrafficTotals& o) {
+            bytesSent += o.bytesSent;
+            bytesRecv += o.bytesRecv;
+            opsSent += o.opsSent;
+            opsRecv += o.opsRecv;
+            packetsSent += o.packetsSent;
+            packetsRecv += o.packetsRecv;
+            return *this;
+        }
+
+        bool Empty() const { return opsSent == 0 && opsRecv == 0 && bytesSent == 0 && bytesRecv == 0; }
+    };
+
+    // 流量计数器：按 socket 计数，socket 关闭时并入按目标聚合的累计值
+    // 设计说明：
+    // - 热路径只做计数：每个线程固定落在一个分片（轮转分配，线程数超过分片数时共享），分片内按句柄映射到相邻两个槽位之一
+    //   槽位按缓存行对齐，不同线程不会在同一缓存行上争用；计数用 relaxed fetch_add，分片共享时也不会丢计数
+    // - 两个候选槽位都被其他 socket 占用时由写入方接管首选槽位：旧计数先并入分片的“其他”桶（总量仍精确，仅失去按 socket 的归属）
+    // - 读取时跨分片聚合；Close 把该 socket 在各分片的计数原子取走并清零，再按目标累加（冷路径，加锁）
+    // - 与 closesocket 竞争、晚到的计数留在无主槽位中，下次接管时并入“其他”桶，不会丢失
+    // 说明：本文件不依赖 Winsock/Logger，可在非 Windows 平台独立测试。
+    template <size_t Shards = 16, size_t SlotsPerShard = 256>
+    class TrafficCounters {
+        static_assert(Shards > 0 && (Shards & (Shards - 1)) == 0, "分片数必须为 2 的幂");
+        static_assert(SlotsPerShard >= 2 && (SlotsPerShard & (SlotsPerShard - 1)) == 0, "槽位数必须为 2 的幂且至少为 2");
+
+    public:
+        static constexpr size_t kMaxDestinations = 1024; // 超出后并入 kOtherDestination
+        static constexpr const char* kOtherDestination = "(其他)";
+
+        TrafficCounters() = default;
+        TrafficCounters(const TrafficCounters&) = delete;
+        TrafficCounters& operator=(const TrafficCounters&) = delete;
+
+        // 热路径：记录一次成功的收发（bytes 为实际收发字节数，packets 为数据报个数）
+        void Add(uintptr_t s, TrafficDirection dir, uint64_t bytes, uint64_t packets = 0) {
+            Shard& shard = m_shards[LocalShardIndex()];
+            const size_t index = SlotIndex(s);
+            Slot* slot = &shard.slots[index];
+            if (slot->key.load(std::memory_order_relaxed) != (uint64_t)s) slot = FindOrClaim(shard, index, s);
+            const size_t base = dir == TrafficDirection::Send ? 0 : 1;
+            slot->c[kBytes + base].fetch_add(bytes, std::memory_order_relaxed);
+            slot->c[kOps + base].fetch_add(1, std::memory_order_relaxed);
+            if (packets) slot->c[kPackets + base].fetch_add(packets, std::memory_order_relaxed);
+        }
+
+        // 某个 socket 当前（尚未关闭）的计数
+        TrafficTotals Socket(uintptr_t s) const {
+            TrafficTotals t;
+            for (const Shard& shard : m_shards) {
+                for (size_t index : {SlotIndex(s), SlotIndex(s) ^ 1}) {
+                    const Slot& slot = shard.slots[index];
+                    if (slot.key.load(std::memory_order_relaxed) == (uint64_t)s) t += Read(slot.c);
+                }
+            }
+            return t;
+        }
+
+        // 全部尚未关闭的 socket（按句柄聚合）
+        std::vector<std::pair<uintptr_t, TrafficTotals>> Sockets() const {
+            std::map<uintptr_t, TrafficTotals> bySocket;
+            for (const Shard& shard : m_shards) {
+                for (const Slot& slot : shard.slots) {
+                    const uint64_t key = slot.key.load(std::memory_order_relaxed);
+                    if (key == 0) continue;
+                    const TrafficTotals t = Read(slot.c);
+                    if (!t.Empty()) bySocket[(uintptr_t)key] += t;
+                }
+            }
+            return std::vector<std::pair<uintptr_t, TrafficTotals>>(bySocket.begin(), bySocket.end());
+        }
+
+        // closesocket 时调用：取走该 socket 的计数并按目标累加；返回该 socket 的累计值（用于断开日志）
+        // dest 为空表示目标未知（未经 connect 的 socket 等）
+        TrafficTotals Close(uintptr_t s, const std::string& dest) {
+            TrafficTotals t;
+            for (Shard& shard : m_shards) {
+                for (size_t index : {SlotIndex(s), SlotIndex(s) ^ 1}) {
+                    Slot& slot = shard.slots[index];
+                    uint64_t key = slot.key.load(std::memory_order_relaxed);
+                    if (key != (uint64_t)s) continue;
+                    t += Take(slot.c);
+                    slot.key.compare_exchange_strong(key, 0, std::memory_order_relaxed);
+                }
+            }
+            if (!t.Empty()) {
+                std::lock_guard<std::mutex> lock(m_destMtx);
+                auto it = m_destinations.find(dest);
+                if (it == m_destinations.end() && m_destinations.size() >= kMaxDestinations) {
+                    it = m_destinations.find(kOtherDestination);
+                    if (it == m_destinations.end()) it = m_destinations.emplace(kOtherDestination, TrafficTotals()).first;
+                } else if (it == m_destinations.end()) {
+                    it = m_destinations.emplace(dest, TrafficTotals()).first;
+                }
+                it->second += t;
+            }
+            return t;
+        }
+
+        // 已关闭 socket 按目标聚合的累计值
+        std::vector<std::pair<std::string, TrafficTotals>> Destinations() const {
+            std::lock_guard<std::mutex> lock(m_destMtx);
+            return std::vector<std::pair<std::string, TrafficTotals>>(m_destinations.begin(), m_destinations.end());
+        }
+
+        // 进程内全部流量（含尚未关闭的 socket 与被挤出槽位的计数）
+        TrafficTotals Total() const {
+            TrafficTotals t;
+            for (const Shard& shard : m_shards) {
+                t += Read(shard.other.c);
+                for (const Slot& slot : shard.slots) t += Read(slot.c);
+            }
+            std::lock_guard<std::mutex> lock(m_destMtx);
+            for (const auto& kv : m_destinations) t += kv.second;
+            return t;
+        }
+
+    private:
+        // 计数下标：[方向] 偏移 0=发送 1=接收
+        static constexpr size_t kBytes = 0;
+        static constexpr size_t kOps = 2;
+        static constexpr size_t kPackets = 4;
+        static constexpr size_t kCounters = 6;
+
+        struct alignas(64) Slot {
+            std::atomic<uint64_t> key{0}; // socket 句柄；0 为空槽位
+            std::atomic<uint64_t> c[kCounters] = {};
+        };
+
+        struct Shard {
+            Slot slots[SlotsPerShard];
+            Slot other; // 被挤出槽位的 socket 计数
+        };
+
+        static size_t LocalShardIndex() {
+            static std::atomic<uint32_t> s_next{0};
+            thread_local const size_t t_index = s_next.fetch_add(1, std::memory_order_relaxed) & (Shards - 1);
+            return t_index;
+        }
+
+        static constexpr unsigned SlotBits() {
+            unsigned bits = 0;
+            while (((size_t)1 << bits) < SlotsPerShard) ++bits;
+            return bits;
+        }
+
+        static size_t SlotIndex(uintptr_t s) {
+            // 与 SocketClassCache 相同的乘法哈希
+            return (size_t)(((uint64_t)s * 0x9E3779B97F4A7C15ull) >> (64 - SlotBits()));
+        }
+
+        static TrafficTotals Read(const std::atomic<uint64_t> (&c)[kCounters]) {
+            TrafficTotals t;
+            t.bytesSent = c[kBytes].load(std::memory_order_relaxed);
+            t.bytesRecv = c[kBytes + 1].load(std::memory_order_relaxed);
+            t.opsSent = c[kOps].load(std::memory_order_relaxed);
+            t.opsRecv = c[kOps + 1].load(std::memory_order_relaxed);
+            t.packetsSent = c[kPackets].load(std::memory_order_relaxed);
+            t.packetsRecv = c[kPackets + 1].load(std::memory_order_relaxed);
+            return t;
+        }
+
+        static TrafficTotals Take(std::atomic<uint64_t> (&c)[kCounters]) {
+            TrafficTotals t;
+            t.bytesSent = c[kBytes].exchange(0, std::memory_order_relaxed);
+            t.bytesRecv = c[kBytes + 1].exchange(0, std::memory_order_relaxed);
+            t.opsSent = c[kOps].exchange(0, std::memory_order_relaxed);
+            t.opsRecv = c[kOps + 1].exchange(0, std::memory_order_relaxed);
+            t.packetsSent = c[kPackets].exchange(0, std::memory_order_relaxed);
+            t.packetsRecv = c[kPackets + 1].exchange(0, std::memory_order_relaxed);
+            return t;
+        }
+
+        // 首选槽位未命中：查相邻槽位；都不属于该 socket 时接管空槽位（优先）或首选槽位
+        // 接管时旧计数（其他 socket 或无主的晚到计数）并入“其他”桶
+        static Slot* FindOrClaim(Shard& shard, size_t index, uintptr_t s) {
+            Slot& alt = shard.slots[index ^ 1];
+            if (alt.key.load(std::memory_order_relaxed) == (uint64_t)s) return &alt;
+            if (shard.slots[index].key.load(std::memory_order_relaxed) != 0 && alt.key.load(std::memory_order_relaxed) == 0) {
+                return Claim(shard, alt, s);
+            }
+            return Claim(shard, shard.slots[index], s);
+        }
+
+        static Slot* Claim(Shard& shard, Slot& slot, uintptr_t s) {
+            for (size_t i = 0; i < kCounters; ++i) {
+                const uint64_t v = slot.c[i].exchange(0, std::memory_order_relaxed);
+                if (v) shard.other.c[i].fetch_add(v, std::memory_order_relaxed);
+            }
+            slot.key.store((uint64_t)s, std::memory_order_relaxed);
+            return &slot;
+        }
+
+        Shard m_shards[Shards];
+        mutable std::mutex m_destMtx;
+        std::map<std::string, TrafficTotals> m_destinations;
+    };
+
+} // namespace Network
@@ -1,55 +1,92 @@
 #pragma once
 #include <winsock2.h>
+#include <algorithm>
 #include <string>
 #include "../core/Logger.hpp"
 #include "../core/Config.hpp"
+#include "TrafficCounters.hpp"
 
 namespace Network {
-    
+
     // 流量监控器
-    // 用于记录 send/recv 流量摘要
+    // - 热路径（send/recv 等 detour）只更新计数器：按 socket 的字节/调用次数/数据报个数，按线程分片，读取时聚合
+    // - socket 关闭时并入按目标的累计值；traffic_logging 开启时输出一行该连接的流量摘要
+    // - traffic_logging 开启且 traffic_sample_every > 0 时，每个线程每 N 次收发采样一次负载预览，写入独立的 .traffic.log
     class TrafficMonitor {
     public:
+        static constexpr size_t kPreviewBytes = 32;
+
         static TrafficMonitor& Instance() {
             static TrafficMonitor instance;
             return instance;
         }
-        
-        // 记录发送数据
-        void LogSend(SOCKET s, const char* buf, int len) {
-            if (!Core::Config::Instance().trafficLogging) return;
-            
-            std::string summary = FormatTrafficSummary("SEND", s, buf, len);
-            Core::Logger::Info(summary);
+
+        // 记录一次成功的发送；buf/bufLen 仅用于采样预览（首个缓冲区，可为 NULL），packets 为数据报个数（TCP 传 0）
+        void RecordSend(SOCKET s, const char* buf, size_t bufLen, uint64_t bytes, uint64_t packets) {
+            m_counters.Add((uintptr_t)s, TrafficDirection::Send, bytes, packets);
+            MaybeSample("SEND", s, buf, bufLen, bytes);
+        }
+
+        // 记录一次成功的接收
+        void RecordRecv(SOCKET s, const char* buf, size_t bufLen, uint64_t bytes, uint64_t packets) {
+            m_counters.Add((uintptr_t)s, TrafficDirection::Recv, bytes, packets);
+            MaybeSample("RECV", s, buf, bufLen, bytes);
+        }
+
+        // closesocket 成功后调用：并入按目标的累计值，按需输出该连接的流量摘要；返回该连接的累计值
+        TrafficTotals OnClose(SOCKET s, const std::string& target) {
+            const TrafficTotals t = m_counters.Close((uintptr_t)s, target);
+            if (t.Empty() || !Core::Config::Instance().trafficLogging) return t;
+            AGP_LOG_INFO(General, "[流量] sock=" + std::to_string((unsigned long long)s) +
+                                  ", target=" + (target.empty() ? std::string("(未知)") : target) +
+                                  ", " + FormatTotals(t));
+            return t;
         }
-        
-        // 记录接收数据
-        void LogRecv(SOCKET s, const char* buf, int len) {
-            if (!Core::Config::Instance().trafficLogging) return;
-            
-            std::string summary = FormatTrafficSummary("RECV", s, buf, len);
-            Core::Logger::Info(summary);
+
+        const TrafficCounters<>& Counters() const { return m_counters; }
+
+        static std::string FormatTotals(const TrafficTotals& t) {
+            std::string out = "发送=" + std::to_string(t.bytesSent) + "B/" + std::to_string(t.opsSent) + "次" +
+                              ", 接收=" + std::to_string(t.bytesRecv) + "B/" + std::to_string(t.opsRecv) + "次";
+            if (t.packetsSent || t.packetsRecv) {
+                out += ", 数据报=" + std::to_string(t.packetsSent) + "/" + std::to_string(t.packetsRecv);
+            }
+            return out;
         }
-        
+
     private:
-        // 格式化流量摘要
-        std::string FormatTrafficSummary(const char* direction, SOCKET s, const char* buf, int len) {
+        // 每线程计数到 N 才采样一次：不采样时只有一次配置读取与一次线程局部自减
+        void MaybeSample(const char* direction, SOCKET s, const char* buf, size_t bufLen, uint64_t bytes) {
+            const auto& config = Core::Config::Instance();
+            if (!config.trafficLogging || config.trafficSampleEvery <= 0) return;
+            thread_local int t_countdown = 0;
+            if (--t_countdown > 0) return;
+            t_countdown = config.trafficSampleEvery;
+            Core::Logger::WriteTrafficSample(FormatSample(direction, s, buf, bufLen, bytes));
+        }
+
+        static std::string FormatSample(const char* direction, SOCKET s, const char* buf, size_t bufLen, uint64_t bytes) {
+            static const char kHex[] = "0123456789ABCDEF";
             std::string result = "[" + std::string(direction) + "] Socket=" + std::to_string((uintptr_t)s);
-            result += " Len=" + std::to_string(len);
-            
-            // 显示前 32 字节的十六进制摘要
-            if (len > 0 && buf) {
+            result += " Len=" + std::to_string(bytes);
+
+            // 显示前 32 字节的十六进制摘要（不超出首个缓冲区）
+            const size_t available = (size_t)std::min<uint64_t>(bytes, bufLen);
+            if (available > 0 && buf) {
                 result += " Data=";
-                int displayLen = (len > 32) ? 32 : len;
-                for (int i = 0; i < displayLen; i++) {
-                    char hex[4];
-                    sprintf_s(hex, "%02X ", (unsigned char)buf[i]);
-                    result += hex;
+                const size_t displayLen = std::min<size_t>(available, kPreviewBytes);
+                for (size_t i = 0; i < displayLen; i++) {
+                    const unsigned char b = (unsigned char)buf[i];
+                    result += kHex[b >> 4];
+                    result += kHex[b & 0x0F];
+                    result += ' ';
                 }
-                if (len > 32) result += "...";
+                if (bytes > (uint64_t)displayLen) result += "...";
             }
-            
+
             return result;
         }
+
+        TrafficCounters<> m_counters;
     };
 }
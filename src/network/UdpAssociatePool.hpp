@@ -0,0 +1,244 @@
+#pragma once
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include "SocketCompat.hpp"
+
+namespace Network {
+
+    // 预建立的 SOCKS5 UDP Associate 会话（TCP 控制连接 + relay 地址）
+    struct PooledUdpAssociate {
+        SOCKET controlSock = INVALID_SOCKET;
+        sockaddr_storage relayAddr{};
+        int relayAddrLen = 0;
+        uint64_t createdMs = 0; // 池内部时钟（steady_clock 毫秒），由池填写
+    };
+
+    struct UdpAssociatePoolStats {
+        uint64_t created = 0;   // 后台成功预建的会话数
+        uint64_t claimed = 0;   // 命中池的领取次数
+        uint64_t missed = 0;    // 池为空、调用方需自行建立的次数
+        uint64_t discarded = 0; // 因过期/控制连接已断开而丢弃的会话数
+        size_t idle = 0;        // 当前池中可用会话数
+    };
+
+    // UDP Associate 预热池
+    // 设计意图：QUIC 会频繁创建短生命周期 UDP socket，每个 socket 首包前都要付出 connect + 2 RTT 的 Associate 成本；
+    // 这里由后台线程维持少量已就绪的会话，新 socket 领取即可直接发包。
+    // 说明：
+    // - 会话的建立/关闭由调用方注入（Hooks 层使用原始函数，避免重入自身 Hook）；
+    // - 领取时校验控制连接仍存活（代理关闭控制连接即意味着 Associate 失效），并丢弃超过 maxIdleMs 的会话；
+    // - 后台线程延迟到首次使用时启动，避免在 DllMain(Loader Lock) 中创建线程；
+    // - 停止时不 join（Loader Lock 中 join 会死锁）：后台线程在每次建立尝试前后检查停止信号，退出前发出“已退出”通知，
+    //   Stop(waitMs) 最多等待该通知，保证返回后线程不再调用注入的函数（它们位于即将卸载的模块中）。
+    // 说明：本文件经 SocketCompat 适配，可在非 Windows 平台独立测试。
+    class UdpAssociatePool {
+    public:
+        typedef std::function<bool(PooledUdpAssociate*)> Factory;
+        typedef std::function<void(SOCKET)> Closer;
+
+        static UdpAssociatePool& Instance() {
+            static UdpAssociatePool instance;
+            return instance;
+        }
+
+        UdpAssociatePool() = default;
+        UdpAssociatePool(const UdpAssociatePool&) = delete;
+        UdpAssociatePool& operator=(const UdpAssociatePool&) = delete;
+
+        // 启动后台补充线程（重复调用无副作用）；targetSize=0 表示禁用
+        // 上一个后台线程尚未退出时不重新启动
+        void Start(size_t targetSize, uint64_t maxIdleMs, Factory factory, Closer closer) {
+            std::lock_guard<std::mutex> lock(m_mtx);
+            if (m_started || !m_exited || targetSize == 0 || !factory) return;
+            m_started = true;
+            m_stop = false;
+            m_exited = false;
+            m_targetSize = targetSize;
+            m_maxIdleMs = maxIdleMs > 0 ? maxIdleMs : 30000;
+            m_failStreak = 0;
+            m_factory = std::move(factory);
+            m_closer = std::move(closer);
+            std::thread([this]() { RefillLoop(); }).detach();
+        }
+
+        // 领取一个可用会话；池为空时立即返回 false（不阻塞），并唤醒后台补充
+        bool TryClaim(PooledUdpAssociate* out) {
+            if (!out) return false;
+            std::deque<SOCKET> dead;
+            bool claimed = false;
+            Closer closer;
+            {
+                std::lock_guard<std::mutex> lock(m_mtx);
+                if (!m_started) return false;
+                const uint64_t now = NowMs();
+                while (!m_idle.empty()) {
+                    PooledUdpAssociate item = m_idle.front();
+                    m_idle.pop_front();
+                    if (now - item.createdMs > m_maxIdleMs || !IsControlAlive(item.controlSock)) {
+                        dead.push_back(item.controlSock);
+                        m_stats.discarded++;
+                        continue;
+                    }
+                    *out = item;
+                    m_stats.claimed++;
+                    claimed = true;
+                    break;
+                }
+                if (!claimed) m_stats.missed++;
+                closer = m_closer;
+            }
+            for (SOCKET s : dead) CloseSock(closer, s);
+            m_cv.notify_one();
+            return claimed;
+        }
+
+        // 已发出停止信号：注入的建立函数可在多个阻塞阶段之间检查，尽早放弃
+        bool Stopping() const {
+            std::lock_guard<std::mutex> lock(m_mtx);
+            return m_stop;
+        }
+
+        UdpAssociatePoolStats GetStats() const {
+            std::lock_guard<std::mutex> lock(m_mtx);
+            UdpAssociatePoolStats stats = m_stats;
+            stats.idle = m_idle.size();
+            return stats;
+        }
+
+        // 停止并关闭池中会话；waitMs>0 时最多等待后台线程退出
+        // 返回 true 表示后台线程已退出（或从未启动）；超时返回 false（线程仍在一次建立尝试中，结束后自行退出）
+        bool Stop(int waitMs = 0) {
+            std::deque<PooledUdpAssociate> idle;
+            Closer closer;
+            {
+                std::lock_guard<std::mutex> lock(m_mtx);
+                if (m_started) {
+                    m_stop = true;
+                    m_started = false;
+                    idle.swap(m_idle);
+                    closer = m_closer;
+                }
+            }
+            m_cv.notify_all();
+            for (const auto& item : idle) CloseSock(closer, item.controlSock);
+
+            std::unique_lock<std::mutex> lock(m_mtx);
+            if (waitMs > 0) {
+                m_exitCv.wait_for(lock, std::chrono::milliseconds(waitMs), [this]() { return m_exited; });
+            }
+            return m_exited;
+        }
+
+    private:
+        static uint64_t NowMs() {
+            return (uint64_t)std::chrono::duration_cast<std::chrono::milliseconds>(
+                std::chrono::steady_clock::now().time_since_epoch()).count();
+        }
+
+        // 控制连接存活检查：正常情况下代理不会在控制连接上发送数据，可读/挂断即意味着 FIN/RST（或协议异常）
+        static bool IsControlAlive(SOCKET s) {
+            if (s == INVALID_SOCKET) return false;
+            SocketCompat::PollFd pfd{};
+            pfd.fd = s;
+            pfd.events = POLLIN;
+            return SocketCompat::Poll(&pfd, 1, 0) == 0;
+        }
+
+        static void CloseSock(const Closer& closer, SOCKET s) {
+            if (s == INVALID_SOCKET) return;
+            if (closer) closer(s);
+            else closesocket(s);
+        }
+
+        void RefillLoop() {
+            uint64_t backoffMs = 0;
+            std::unique_lock<std::mutex> lock(m_mtx);
+            while (!m_stop) {
+                // 清理过期会话（代理端可能对空闲控制连接做超时回收）
+                const uint64_t now = NowMs();
+                std::deque<SOCKET> expired;
+                for (auto it = m_idle.begin(); it != m_idle.end(); ) {
+                    if (now - it->createdMs > m_maxIdleMs || !IsControlAlive(it->controlSock)) {
+                        expired.push_back(it->controlSock);
+                        m_stats.discarded++;
+                        it = m_idle.erase(it);
+                    } else {
+                        ++it;
+                    }
+                }
+
+                if (m_idle.size() >= m_targetSize || backoffMs > 0 || !expired.empty()) {
+                    Closer closer = m_closer;
+                    lock.unlock();
+                    for (SOCKET s : expired) CloseSock(closer, s);
+                    lock.lock();
+                    if (m_stop) break;
+                    if (backoffMs > 0) {
+                        // 建立失败：按退避时间等待，领取未命中的唤醒不提前重试
+                        m_cv.wait_for(lock, std::chrono::milliseconds(backoffMs), [this]() { return m_stop; });
+                        backoffMs = 0;
+                        continue;
+                    }
+                    if (m_idle.size() >= m_targetSize) {
+                        // 池已满：定期醒来清理过期会话；领取后被唤醒补充
+                        m_cv.wait_for(lock, std::chrono::milliseconds(m_maxIdleMs / 2 + 1));
+                        continue;
+                    }
+                }
+
+                // 建立会话为阻塞 I/O，放到锁外执行；前后各检查一次停止信号
+                if (m_stop) break;
+                Factory factory = m_factory;
+                Closer closer = m_closer;
+                lock.unlock();
+                PooledUdpAssociate item;
+                const bool ok = factory(&item);
+                lock.lock();
+                if (!ok) {
+                    if (m_stop) break;
+                    // 代理不可用/不支持 UDP：指数退避，避免后台线程持续冲击代理
+                    m_failStreak = m_failStreak < 6 ? m_failStreak + 1 : 6;
+                    backoffMs = 1000ULL << (m_failStreak - 1); // 1s .. 32s
+                    continue;
+                }
+                m_failStreak = 0;
+                if (m_stop || m_idle.size() >= m_targetSize) {
+                    const bool stopping = m_stop;
+                    lock.unlock();
+                    CloseSock(closer, item.controlSock);
+                    lock.lock();
+                    if (stopping) break;
+                    continue;
+                }
+                item.createdMs = NowMs();
+                m_idle.push_back(item);
+                m_stats.created++;
+            }
+
+            // 持锁发出退出通知：Stop 在同一把锁上等待，返回后本线程不再访问注入的函数
+            m_factory = nullptr;
+            m_closer = nullptr;
+            m_exited = true;
+            m_exitCv.notify_all();
+        }
+
+        mutable std::mutex m_mtx;
+        std::condition_variable m_cv;
+        std::condition_variable m_exitCv;
+        bool m_started = false;
+        bool m_stop = false;
+        bool m_exited = true; // 后台线程不在运行
+        size_t m_targetSize = 0;
+        uint64_t m_maxIdleMs = 30000;
+        uint32_t m_failStreak = 0;
+        Factory m_factory;
+        Closer m_closer;
+        std::deque<PooledUdpAssociate> m_idle;
+        UdpAssociatePoolStats m_stats;
+    };
+}
@@ -0,0 +1,116 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+#include "Socks5Protocol.hpp"
+
+namespace Network {
+
+    // SOCKS5 UDP 回包“就地接收”
+    // 思路：按 [头部暂存区(预测头长)] + [用户缓冲区...] + [尾部溢出区] 的顺序散布接收，
+    // 预测头长与实际头长一致时 payload 直接落在用户缓冲区起始处，无需任何复制；
+    // 不一致时（少见，例如回包源地址族与目标不同）再把 payload 平移到用户缓冲区起始处。
+    // 说明：本文件不依赖 Winsock 扩展/Logger，可在非 Windows 平台独立测试。
+    namespace UdpRecvInPlace {
+
+        // SOCKS5 UDP 头最大长度（与 Socks5Udp::kMaxUdpHeaderBytes 一致）
+        constexpr size_t kMaxHeaderBytes = 262;
+        // 就地接收支持的最大用户缓冲区个数（超出时调用方退回整包复制）
+        constexpr size_t kMaxUserSegments = 8;
+        // 无法预测时按 IPv4 回包头（RSV2 + FRAG1 + ATYP1 + IPv4 4 + PORT2）
+        constexpr size_t kDefaultHeaderHint = 10;
+
+        struct Segment {
+            uint8_t* data = nullptr;
+            size_t len = 0;
+        };
+
+        // 由发送侧 SOCKS5 头推测回包头长度：
+        // - IP 目标：回包源地址与目标同族，头长一致
+        // - 域名目标：代理回包通常携带解析后的 IPv4 源地址
+        inline size_t PredictHeaderLen(const uint8_t* sendHeader, size_t sendHeaderLen) {
+            if (!sendHeader || sendHeaderLen < 4) return kDefaultHeaderHint;
+            if (sendHeader[3] == Socks5::ATYP_IPV4 || sendHeader[3] == Socks5::ATYP_IPV6) return sendHeaderLen;
+            return kDefaultHeaderHint;
+        }
+
+        // 从分段布局中按逻辑偏移读取字节，返回实际读取数
+        inline size_t ReadSpan(const Segment* segs, size_t count, size_t offset, uint8_t* dst, size_t len) {
+            size_t done = 0;
+            for (size_t i = 0; i < count && done < len; ++i) {
+                const size_t segLen = segs[i].len;
+                if (offset >= segLen) {
+                    offset -= segLen;
+                    continue;
+                }
+                const size_t n = (segLen - offset < len - done) ? (segLen - offset) : (len - done);
+                if (segs[i].data) memcpy(dst + done, segs[i].data + offset, n);
+                done += n;
+                offset = 0;
+            }
+            return done;
+        }
+
+        struct Result {
+            sockaddr_storage src{};
+            int srcLen = 0;          // 域名源地址无法转换为 sockaddr 时为 0
+            size_t headerLen = 0;
+            size_t payloadLen = 0;   // 回包中的 payload 总长度
+            size_t delivered = 0;    // 已位于用户缓冲区中的字节数（< payloadLen 表示截断）
+            size_t copiedBytes = 0;  // 平移写入用户缓冲区的字节数（预测命中时为 0）
+        };
+
+        // 完成后修正
+        // - segs: [0]=头部暂存区（长度即预测头长），[1..count-2]=用户缓冲区，[count-1]=尾部溢出区
+        // - received: 本次接收的总字节数（含 SOCKS5 头）
+        // - fixup: 平移时使用的暂存区（调用方复用以避免反复分配），可为空（此时内部临时分配）
+        // 头部非法或长度不足时返回 false（与 Socks5Udp::Unwrap 的判定一致）
+        inline bool Finalize(const Segment* segs, size_t count, size_t received, std::vector<uint8_t>* fixup, Result* out) {
+            if (!segs || count < 2 || !out || received < 10) return false;
+            *out = Result{};
+
+            uint8_t header[kMaxHeaderBytes];
+            const size_t peek = received < sizeof(header) ? received : sizeof(header);
+            if (ReadSpan(segs, count, 0, header, peek) != peek) return false;
+            Socks5::UdpHeaderView view{};
+            if (!Socks5::DecodeUdpHeader(header, peek, &view)) return false;
+            Socks5::UdpHeaderToSockaddr(view, &out->src, &out->srcLen);
+
+            size_t userCap = 0;
+            for (size_t i = 1; i + 1 < count; ++i) userCap += segs[i].len;
+
+            out->headerLen = view.headerLen;
+            out->payloadLen = received - view.headerLen;
+            out->delivered = out->payloadLen < userCap ? out->payloadLen : userCap;
+            if (view.headerLen == segs[0].len || out->delivered == 0) return true;
+
+            // 预测失败：先线性化 payload，再按序写回用户缓冲区
+            std::vector<uint8_t> local;
+            std::vector<uint8_t>& tmp = fixup ? *fixup : local;
+            tmp.resize(out->delivered);
+            ReadSpan(segs, count, view.headerLen, tmp.data(), out->delivered);
+            size_t written = 0;
+            for (size_t i = 1; i + 1 < count && written < out->delivered; ++i) {
+                if (!segs[i].data || segs[i].len == 0) continue;
+                const size_t n = (segs[i].len < out->delivered - written) ? segs[i].len : (out->delivered - written);
+                memcpy(segs[i].data, tmp.data() + written, n);
+                written += n;
+            }
+            out->copiedBytes = written;
+            return true;
+        }
+
+        // 接收路径计数：用于评估每数据报的堆分配次数与复制字节数
+        struct Counters {
+            std::atomic<uint64_t> datagrams{0};
+            std::atomic<uint64_t> inPlace{0};      // 预测命中，零复制
+            std::atomic<uint64_t> shifted{0};      // 就地接收但需平移
+            std::atomic<uint64_t> copied{0};       // 退回整包复制（用户缓冲区过多等）
+            std::atomic<uint64_t> copyBytes{0};
+            std::atomic<uint64_t> allocs{0};
+        };
+
+    } // namespace UdpRecvInPlace
+} // namespace Network
@@ -0,0 +1,400 @@
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+#include "SocketCompat.hpp"
+#include "Socks5Protocol.hpp"
+
+namespace Network {
+
+    struct UdpRelayMuxStats {
+        uint64_t upPackets = 0;       // 应用 -> relay 转发的数据报
+        uint64_t upBytes = 0;
+        uint64_t downPackets = 0;     // relay -> 应用 转发的数据报
+        uint64_t downBytes = 0;
+        uint64_t dropped = 0;         // 头部无效/发送失败/无法建立上游端口而丢弃的数据报
+        uint64_t unrouted = 0;        // 所属流已淘汰、无法确定归属而丢弃的回包
+        uint64_t flowEvictions = 0;   // 因闲置或流表已满而淘汰的流
+        uint64_t flows = 0;           // 当前流数（每个应用 socket 一个）
+    };
+
+    // 中继内部 socket 使用的函数表；Hooks 层传入原始函数，避免中继自身流量重入 send/recv 等 Hook
+    // 留空的项使用系统默认实现
+    struct UdpRelaySocketApi {
+        int (WSAAPI *connectFn)(SOCKET, const struct sockaddr*, int) = nullptr;
+        int (WSAAPI *sendFn)(SOCKET, const char*, int, int) = nullptr;
+        int (WSAAPI *recvFn)(SOCKET, char*, int, int) = nullptr;
+        int (WSAAPI *sendToFn)(SOCKET, const char*, int, int, const struct sockaddr*, int) = nullptr;
+        int (WSAAPI *recvFromFn)(SOCKET, char*, int, int, struct sockaddr*, int*) = nullptr;
+        int (WSAAPI *closeFn)(SOCKET) = nullptr;
+    };
+
+    // 多路复用 UDP 中继：多个应用 UDP socket 共享一个 SOCKS5 UDP Associate
+    // 设计意图：逐 socket Associate 模式下，大量 QUIC 连接会在代理端留下同等数量的空闲 TCP 控制连接；
+    // 这里只维持一条控制连接，由后台线程在应用 socket 与代理 relay 之间转发。
+    // 工作方式：
+    // - 在 127.0.0.1 上开一个本地 UDP 端点，应用 socket 把它当作 “relay” 连接（Hooks 层封装/解封装逻辑不变）；
+    // - 每个应用 socket（按其本地来源地址区分）对应一条流，流独占一个连接到代理 relay 的上游 UDP 端口；
+    //   上行报文经该端口原样发给代理，下行回包从哪个端口收到就交回哪个应用 socket。
+    //   归属只取决于收包端口，与回包头里的来源地址无关：目标为域名（FakeIP）、多个 socket 访问同一远端都不会错投。
+    // - 流闲置超时或流表已满时淘汰，淘汰时上游端口里尚未转发的回包计入 unrouted 后丢弃。
+    // 兼容性：RFC 1928 要求 relay 只按客户端 IP 过滤数据报；Associate 请求地址为全零时，同一客户端的多个来源端口均可使用。
+    // 说明：不依赖 Logger/Config；控制连接由调用方建立后移交，所有 socket 由本对象关闭。
+    class UdpRelayMux : public std::enable_shared_from_this<UdpRelayMux> {
+    public:
+        static constexpr size_t kMaxFlows = 1024;
+        static constexpr uint64_t kFlowIdleMs = 120000;
+        static constexpr int kMaxDatagramBytes = 65535;
+
+        // 启动中继：controlSock 为已完成 UDP ASSOCIATE 的 TCP 控制连接（可为 INVALID_SOCKET，仅用于测试）
+        // 失败时返回 false 并保留 WSA 错误码；controlSock 的所有权仅在成功时转移
+        bool Start(SOCKET controlSock, const sockaddr* relayAddr, int relayAddrLen, const UdpRelaySocketApi& api = UdpRelaySocketApi()) {
+            if (!relayAddr || relayAddrLen <= 0 || relayAddrLen > (int)sizeof(m_relayAddr) || m_started.exchange(true)) {
+                WSASetLastError(WSAEINVAL);
+                return false;
+            }
+            m_api = api;
+            memset(&m_relayAddr, 0, sizeof(m_relayAddr));
+            memcpy(&m_relayAddr, relayAddr, (size_t)relayAddrLen);
+            m_relayAddrLen = relayAddrLen;
+
+            m_local = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+            if (m_local == INVALID_SOCKET) return FailStart();
+            sockaddr_in local{};
+            local.sin_family = AF_INET;
+            local.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+            local.sin_port = 0;
+            if (bind(m_local, (const sockaddr*)&local, sizeof(local)) != 0) return FailStart();
+            socklen_t localLen = sizeof(local);
+            if (getsockname(m_local, (sockaddr*)&local, &localLen) != 0) return FailStart();
+            memset(&m_localEndpoint, 0, sizeof(m_localEndpoint));
+            memcpy(&m_localEndpoint, &local, sizeof(local));
+            m_localEndpointLen = (int)sizeof(local);
+
+            // 本地端点承载所有应用 socket 的上行流量，放大收包缓冲降低突发丢包
+            const int bufBytes = 4 * 1024 * 1024;
+            setsockopt(m_local, SOL_SOCKET, SO_RCVBUF, (const char*)&bufBytes, sizeof(bufBytes));
+            unsigned long nb = 1;
+            ioctlsocket(m_local, FIONBIO, &nb);
+
+            m_control = controlSock;
+            m_alive = true;
+            // 线程持有自身引用并立即 detach：Stop 可在 Loader Lock 中调用而无需 join
+            auto self = shared_from_this();
+            std::thread([self]() { self->Loop(); }).detach();
+            return true;
+        }
+
+        // 应用 socket 应连接的本地端点（127.0.0.1:port）
+        bool GetLocalEndpoint(sockaddr_storage* out, int* outLen) const {
+            if (!out || !outLen || m_localEndpointLen <= 0) return false;
+            *out = m_localEndpoint;
+            *outLen = m_localEndpointLen;
+            return true;
+        }
+
+        // 控制连接断开或已停止后返回 false，调用方应重建
+        bool IsAlive() const { return m_alive.load(); }
+
+        // 发出停止信号；waitMs>0 时最多等待转发线程退出（DLL 卸载路径应传 0）
+        void Stop(int waitMs = 0) {
+            m_stop = true;
+            if (waitMs <= 0) return;
+            std::unique_lock<std::mutex> lock(m_exitMtx);
+            m_exitCv.wait_for(lock, std::chrono::milliseconds(waitMs), [this]() { return m_exited; });
+        }
+
+        UdpRelayMuxStats GetStats() const {
+            UdpRelayMuxStats s;
+            s.upPackets = m_upPackets.load(std::memory_order_relaxed);
+            s.upBytes = m_upBytes.load(std::memory_order_relaxed);
+            s.downPackets = m_downPackets.load(std::memory_order_relaxed);
+            s.downBytes = m_downBytes.load(std::memory_order_relaxed);
+            s.dropped = m_dropped.load(std::memory_order_relaxed);
+            s.unrouted = m_unrouted.load(std::memory_order_relaxed);
+            s.flowEvictions = m_flowEvictions.load(std::memory_order_relaxed);
+            s.flows = m_flowCount.load(std::memory_order_relaxed);
+            return s;
+        }
+
+    private:
+        // 一个应用 socket 的流：上游端口只与代理 relay 通信（已 connect），回包按收包端口归属
+        struct Flow {
+            SOCKET upstream = INVALID_SOCKET;
+            sockaddr_in app{};
+            uint64_t lastMs = 0;
+        };
+
+        static uint64_t NowMs() {
+            return (uint64_t)std::chrono::duration_cast<std::chrono::milliseconds>(
+                std::chrono::steady_clock::now().time_since_epoch()).count();
+        }
+
+        // 本地端点为 IPv4 回环，应用 socket 的来源地址（含双栈 socket）均为 IPv4
+        static uint64_t FlowKey(const sockaddr_in& app) {
+            return ((uint64_t)ntohl(app.sin_addr.s_addr) << 16) | ntohs(app.sin_port);
+        }
+
+        bool FailStart() {
+            const int err = WSAGetLastError();
+            CloseSock(m_local);
+            m_local = INVALID_SOCKET;
+            m_started = false;
+            WSASetLastError(err);
+            return false;
+        }
+
+        void CloseSock(SOCKET s) {
+            if (s == INVALID_SOCKET) return;
+            if (m_api.closeFn) m_api.closeFn(s);
+            else closesocket(s);
+        }
+
+        int ApiConnect(SOCKET s, const sockaddr* addr, int addrLen) {
+            return m_api.connectFn ? m_api.connectFn(s, addr, addrLen) : connect(s, addr, (socklen_t)addrLen);
+        }
+
+        int ApiSend(SOCKET s, const uint8_t* data, int len) {
+            return m_api.sendFn ? m_api.sendFn(s, (const char*)data, len, 0) : (int)send(s, (const char*)data, len, 0);
+        }
+
+        int ApiRecv(SOCKET s, uint8_t* buf, int cap) {
+            return m_api.recvFn ? m_api.recvFn(s, (char*)buf, cap, 0) : (int)recv(s, (char*)buf, cap, 0);
+        }
+
+        int ApiSendTo(SOCKET s, const uint8_t* data, int len, const sockaddr* to, int toLen) {
+            return m_api.sendToFn ? m_api.sendToFn(s, (const char*)data, len, 0, to, toLen)
+                                  : (int)sendto(s, (const char*)data, len, 0, to, (socklen_t)toLen);
+        }
+
+        int ApiRecvFrom(SOCKET s, uint8_t* buf, int cap, sockaddr* from, int* fromLen) {
+            if (m_api.recvFromFn) return m_api.recvFromFn(s, (char*)buf, cap, 0, from, fromLen);
+            socklen_t len = (socklen_t)*fromLen;
+            const int n = (int)recvfrom(s, (char*)buf, cap, 0, from, &len);
+            *fromLen = (int)len;
+            return n;
+        }
+
+        // 控制连接：代理正常情况下不会发送数据，可读且 recv<=0 即意味着 Associate 已失效
+        bool ControlClosed() {
+            char probe[64];
+            const int n = ApiRecv(m_control, (uint8_t*)probe, (int)sizeof(probe));
+            if (n > 0) return false;
+            if (n == 0) return true;
+            const int err = WSAGetLastError();
+            return err != WSAEWOULDBLOCK && err != WSAEINPROGRESS;
+        }
+
+        // 为新的应用 socket 建立上游端口；流表已满时先淘汰
+        Flow* OpenFlow(uint64_t key, const sockaddr_in& app, uint64_t now) {
+            if (m_flows.size() >= kMaxFlows) {
+                SweepFlows(now);
+                if (m_flows.size() >= kMaxFlows) EvictLeastRecent();
+            }
+            SOCKET s = socket(m_relayAddr.ss_family, SOCK_DGRAM, IPPROTO_UDP);
+            if (s == INVALID_SOCKET) return nullptr;
+            if (ApiConnect(s, (const sockaddr*)&m_relayAddr, m_relayAddrLen) != 0) {
+                CloseSock(s);
+                return nullptr;
+            }
+            const int bufBytes = 512 * 1024;
+            setsockopt(s, SOL_SOCKET, SO_RCVBUF, (const char*)&bufBytes, sizeof(bufBytes));
+            unsigned long nb = 1;
+            ioctlsocket(s, FIONBIO, &nb);
+            Flow& flow = m_flows[key];
+            flow.upstream = s;
+            flow.app = app;
+            flow.lastMs = now;
+            m_flowCount.store(m_flows.size(), std::memory_order_relaxed);
+            return &flow;
+        }
+
+        // 关闭上游端口；其中尚未转发的回包已无法交回应用 socket，计入 unrouted
+        void CloseFlow(Flow& flow, std::vector<uint8_t>& buf) {
+            for (int i = 0; i < 64; ++i) {
+                if (ApiRecv(flow.upstream, buf.data(), (int)buf.size()) <= 0) break;
+                m_unrouted.fetch_add(1, std::memory_order_relaxed);
+            }
+            CloseSock(flow.upstream);
+            flow.upstream = INVALID_SOCKET;
+            m_flowEvictions.fetch_add(1, std::memory_order_relaxed);
+        }
+
+        void EvictLeastRecent() {
+            auto oldest = m_flows.end();
+            for (auto it = m_flows.begin(); it != m_flows.end(); ++it) {
+                if (oldest == m_flows.end() || it->second.lastMs < oldest->second.lastMs) oldest = it;
+            }
+            if (oldest == m_flows.end()) return;
+            CloseFlow(oldest->second, m_drainBuf);
+            m_flows.erase(oldest);
+            m_flowCount.store(m_flows.size(), std::memory_order_relaxed);
+        }
+
+        void SweepFlows(uint64_t now) {
+            for (auto it = m_flows.begin(); it != m_flows.end(); ) {
+                if (now - it->second.lastMs > kFlowIdleMs) {
+                    CloseFlow(it->second, m_drainBuf);
+                    it = m_flows.erase(it);
+                } else {
+                    ++it;
+                }
+            }
+            m_flowCount.store(m_flows.size(), std::memory_order_relaxed);
+        }
+
+        void HandleUpstream(uint8_t* buf, int len, const sockaddr_storage& from, int fromLen) {
+            Socks5::UdpHeaderView view;
+            if (from.ss_family != AF_INET || fromLen < (int)sizeof(sockaddr_in) ||
+                !Socks5::DecodeUdpHeader(buf, (size_t)len, &view)) {
+                m_dropped.fetch_add(1, std::memory_order_relaxed);
+                return;
+            }
+            sockaddr_in app;
+            memcpy(&app, &from, sizeof(app));
+            const uint64_t key = FlowKey(app);
+            const uint64_t now = NowMs();
+            Flow* flow = nullptr;
+            auto it = m_flows.find(key);
+            if (it != m_flows.end()) {
+                flow = &it->second;
+                flow->lastMs = now;
+            } else {
+                flow = OpenFlow(key, app, now);
+                if (!flow) {
+                    m_dropped.fetch_add(1, std::memory_order_relaxed);
+                    return;
+                }
+            }
+
+            if (ApiSend(flow->upstream, buf, len) != len) {
+                m_dropped.fetch_add(1, std::memory_order_relaxed);
+                return;
+            }
+            m_upPackets.fetch_add(1, std::memory_order_relaxed);
+            m_upBytes.fetch_add((uint64_t)len, std::memory_order_relaxed);
+        }
+
+        void HandleDownstream(const Flow& flow, uint8_t* buf, int len) {
+            Socks5::UdpHeaderView view;
+            if (!Socks5::DecodeUdpHeader(buf, (size_t)len, &view)) {
+                m_dropped.fetch_add(1, std::memory_order_relaxed);
+                return;
+            }
+            if (ApiSendTo(m_local, buf, len, (const sockaddr*)&flow.app, (int)sizeof(flow.app)) != len) {
+                m_dropped.fetch_add(1, std::memory_order_relaxed);
+                return;
+            }
+            m_downPackets.fetch_add(1, std::memory_order_relaxed);
+            m_downBytes.fetch_add((uint64_t)len, std::memory_order_relaxed);
+        }
+
+        void Loop() {
+            std::vector<uint8_t> buf((size_t)kMaxDatagramBytes);
+            m_drainBuf.resize((size_t)kMaxDatagramBytes);
+            std::vector<SocketCompat::PollFd> fds;
+            std::vector<uint64_t> fdKeys; // fds[flowBase + i] 对应的流
+            uint64_t lastSweepMs = NowMs();
+            while (!m_stop.load()) {
+                fds.clear();
+                fdKeys.clear();
+                SocketCompat::PollFd pfd{};
+                pfd.fd = m_local;
+                pfd.events = POLLIN;
+                fds.push_back(pfd);
+                const bool hasControl = m_control != INVALID_SOCKET;
+                if (hasControl) {
+                    pfd.fd = m_control;
+                    fds.push_back(pfd);
+                }
+                const size_t flowBase = fds.size();
+                for (const auto& kv : m_flows) {
+                    pfd.fd = kv.second.upstream;
+                    fds.push_back(pfd);
+                    fdKeys.push_back(kv.first);
+                }
+                // 定期醒来检查停止信号
+                const int rc = SocketCompat::Poll(fds.data(), (unsigned long)fds.size(), 200);
+                if (rc < 0) break;
+
+                if (hasControl && (fds[1].revents & (POLLIN | POLLERR | POLLHUP)) && ControlClosed()) break;
+
+                // 每次唤醒各自最多处理一批，避免单方向突发饿死另一方向
+                if (fds[0].revents & (POLLIN | POLLERR)) {
+                    for (int i = 0; i < 64; ++i) {
+                        sockaddr_storage from{};
+                        int fromLen = (int)sizeof(from);
+                        const int n = ApiRecvFrom(m_local, buf.data(), kMaxDatagramBytes, (sockaddr*)&from, &fromLen);
+                        if (n <= 0) break;
+                        HandleUpstream(buf.data(), n, from, fromLen);
+                    }
+                }
+                for (size_t i = 0; i < fdKeys.size(); ++i) {
+                    const SocketCompat::PollFd& f = fds[flowBase + i];
+                    if (!(f.revents & (POLLIN | POLLERR))) continue;
+                    // 上行处理中可能淘汰/重建流：以 socket 是否一致确认仍是同一条流
+                    auto it = m_flows.find(fdKeys[i]);
+                    if (it == m_flows.end() || it->second.upstream != f.fd) continue;
+                    for (int n = 0; n < 64; ++n) {
+                        const int got = ApiRecv(it->second.upstream, buf.data(), kMaxDatagramBytes);
+                        if (got <= 0) break; // 含 ICMP 不可达（WSAECONNRESET/ECONNREFUSED），忽略
+                        HandleDownstream(it->second, buf.data(), got);
+                    }
+                }
+
+                const uint64_t now = NowMs();
+                if (now - lastSweepMs >= 5000) {
+                    SweepFlows(now);
+                    lastSweepMs = now;
+                }
+            }
+
+            m_alive = false;
+            for (auto& kv : m_flows) CloseSock(kv.second.upstream);
+            m_flows.clear();
+            m_flowCount.store(0, std::memory_order_relaxed);
+            CloseSock(m_local);
+            CloseSock(m_control);
+            {
+                std::lock_guard<std::mutex> lock(m_exitMtx);
+                m_exited = true;
+            }
+            m_exitCv.notify_all();
+        }
+
+        std::atomic<bool> m_started{false};
+        std::atomic<bool> m_stop{false};
+        std::atomic<bool> m_alive{false};
+        UdpRelaySocketApi m_api;
+        SOCKET m_control = INVALID_SOCKET;
+        SOCKET m_local = INVALID_SOCKET;
+        sockaddr_storage m_relayAddr{};
+        int m_relayAddrLen = 0;
+        sockaddr_storage m_localEndpoint{};
+        int m_localEndpointLen = 0;
+
+        // 仅由转发线程访问，无需加锁
+        std::unordered_map<uint64_t, Flow> m_flows;
+        std::vector<uint8_t> m_drainBuf;
+
+        std::atomic<uint64_t> m_upPackets{0};
+        std::atomic<uint64_t> m_upBytes{0};
+        std::atomic<uint64_t> m_downPackets{0};
+        std::atomic<uint64_t> m_downBytes{0};
+        std::atomic<uint64_t> m_dropped{0};
+        std::atomic<uint64_t> m_unrouted{0};
+        std::atomic<uint64_t> m_flowEvictions{0};
+        std::atomic<uint64_t> m_flowCount{0};
+
+        std::mutex m_exitMtx;
+        std::condition_variable m_exitCv;
+        bool m_exited = false;
+    };
+}
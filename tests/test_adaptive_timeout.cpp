@@ -0,0 +1,124 @@
+#include <cassert>
+#include <cstdint>
+#include <thread>
+#include <vector>
+
+#include "network/AdaptiveTimeout.hpp"
+
+using Network::AdaptiveTimeoutOptions;
+using Network::RttEstimator;
+
+static AdaptiveTimeoutOptions Options(uint32_t minMs, uint32_t minSamples) {
+    AdaptiveTimeoutOptions o;
+    o.minMs = minMs;
+    o.minSamples = minSamples;
+    return o;
+}
+
+// 样本不足时使用固定超时
+static void TestColdStart() {
+    RttEstimator e(Options(100, 3));
+    assert(e.TimeoutMs(5000) == 5000);
+    e.AddSample(20000);
+    e.AddSample(20000);
+    assert(e.TimeoutMs(5000) == 5000);
+    e.AddSample(20000);
+    assert(e.TimeoutMs(5000) < 5000);
+}
+
+// RFC 6298 更新：首样本 SRTT=R、RTTVAR=R/2；之后按 1/8、1/4 平滑
+static void TestEstimate() {
+    RttEstimator e(Options(1, 1));
+    e.AddSample(100000); // 100ms
+    auto s = e.GetStats();
+    assert(s.srttUs == 100000 && s.rttvarUs == 50000 && s.samples == 1);
+    assert(e.TimeoutMs(15000) == 300); // 100 + 4*50
+    e.AddSample(60000);
+    s = e.GetStats();
+    assert(s.rttvarUs == (3 * 50000 + 40000) / 4);
+    assert(s.srttUs == (7 * 100000 + 60000) / 8);
+
+    // 稳定的往返时间：偏差收敛，超时逼近 SRTT
+    RttEstimator stable(Options(1, 1));
+    for (int i = 0; i < 200; ++i) stable.AddSample(50000);
+    assert(stable.GetStats().srttUs == 50000);
+    assert(stable.TimeoutMs(15000) <= 52);
+
+    // 抖动：偏差放大超时，容忍偶发的慢样本
+    RttEstimator jitter(Options(1, 1));
+    for (int i = 0; i < 200; ++i) jitter.AddSample(i % 2 ? 20000 : 80000);
+    const uint32_t t = jitter.TimeoutMs(15000);
+    assert(t >= 80 && t <= 400);
+}
+
+// 下限与上限
+static void TestClamp() {
+    RttEstimator fast(Options(200, 1));
+    for (int i = 0; i < 50; ++i) fast.AddSample(1000);
+    assert(fast.TimeoutMs(5000) == 200);
+    assert(fast.TimeoutMs(150) == 150); // 固定超时小于下限时以固定超时为准
+
+    RttEstimator slow(Options(200, 1));
+    for (int i = 0; i < 10; ++i) slow.AddSample(10000000); // 10s
+    assert(slow.TimeoutMs(5000) == 5000);
+}
+
+// 超时退避：逐次翻倍直到固定超时；下一个成功样本复位
+static void TestBackoff() {
+    RttEstimator e(Options(100, 1));
+    for (int i = 0; i < 50; ++i) e.AddSample(10000);
+    assert(e.TimeoutMs(5000) == 100);
+    e.OnTimeout();
+    assert(e.TimeoutMs(5000) == 200);
+    e.OnTimeout();
+    assert(e.TimeoutMs(5000) == 400);
+    for (int i = 0; i < 10; ++i) e.OnTimeout();
+    assert(e.TimeoutMs(5000) == 5000);
+    assert(e.GetStats().timeouts == 12 && e.GetStats().backoff == AdaptiveTimeoutOptions().maxBackoff);
+    e.AddSample(10000);
+    assert(e.GetStats().backoff == 0);
+    assert(e.TimeoutMs(5000) == 100);
+}
+
+static void TestRegistry() {
+    auto& reg = Network::UpstreamRttRegistry::Instance();
+    reg.Clear();
+    auto a = reg.Get("127.0.0.1:7890", Options(100, 1));
+    auto b = reg.Get("127.0.0.1:7890", Options(999, 9)); // options 以首次为准
+    auto c = reg.Get("10.0.0.1:1080", Options(100, 1));
+    assert(a == b && a != c);
+    a->connect.AddSample(5000);
+    assert(b->connect.GetStats().samples == 1 && b->greeting.GetStats().samples == 0);
+    assert(b->connect.TimeoutMs(5000) == 100);
+    reg.Clear();
+    assert(reg.Get("127.0.0.1:7890", Options(100, 1))->connect.GetStats().samples == 0);
+    reg.Clear();
+}
+
+// 并发采样与读取：样本数守恒，估计值落在样本范围内
+static void TestConcurrent() {
+    RttEstimator e(Options(1, 1));
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 4; ++t) {
+        threads.emplace_back([&, t]() {
+            for (int i = 0; i < 5000; ++i) {
+                e.AddSample(10000 + (uint64_t)t * 1000);
+                (void)e.TimeoutMs(5000);
+            }
+        });
+    }
+    for (auto& th : threads) th.join();
+    const auto s = e.GetStats();
+    assert(s.samples == 20000);
+    assert(s.srttUs >= 10000 && s.srttUs <= 13000);
+}
+
+int main() {
+    TestColdStart();
+    TestEstimate();
+    TestClamp();
+    TestBackoff();
+    TestRegistry();
+    TestConcurrent();
+    return 0;
+}
@@ -0,0 +1,129 @@
+#include <atomic>
+#include <cassert>
+#include <cstdint>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "core/AsyncLog.hpp"
+
+using Core::AsyncLogWriter;
+using Core::LogRing;
+
+// 收集 sink 输出的行与丢弃汇总
+struct Collector {
+    std::mutex mtx;
+    std::vector<std::string> lines;
+    uint64_t dropped = 0;
+    size_t batches = 0;
+
+    void operator()(const std::string& batch, uint64_t droppedSinceLast) {
+        std::lock_guard<std::mutex> lock(mtx);
+        std::istringstream in(batch);
+        std::string line;
+        while (std::getline(in, line)) lines.push_back(line);
+        dropped += droppedSinceLast;
+        ++batches;
+    }
+};
+
+static void TestRing() {
+    LogRing<4> ring;
+    std::string out;
+    assert(ring.Empty() && !ring.TryPop(&out));
+    for (int i = 0; i < 4; ++i) {
+        std::string s = "l" + std::to_string(i);
+        assert(ring.TryPush(std::move(s)));
+    }
+    std::string extra = "full";
+    assert(!ring.TryPush(std::move(extra)));
+    assert(extra == "full"); // 失败时不移动
+    for (int i = 0; i < 4; ++i) {
+        assert(ring.TryPop(&out) && out == "l" + std::to_string(i));
+    }
+    assert(ring.Empty());
+    // 回绕后继续可用
+    assert(ring.TryPush(std::string("again")) && ring.TryPop(&out) && out == "again");
+}
+
+// 未启动时拒绝入队（调用方走同步写入）
+static void TestNotRunning() {
+    Collector c;
+    AsyncLogWriter<8> writer([&c](const std::string& b, uint64_t d) { c(b, d); });
+    std::string line = "sync";
+    assert(writer.Submit(std::move(line), false) == AsyncLogWriter<8>::SubmitResult::NotRunning);
+    assert(line == "sync");
+}
+
+// 写线程未取数据时队列写满：普通行丢弃并计数，汇总随下一批交给 sink
+static void TestDropAndSummary() {
+    Collector c;
+    using Writer = AsyncLogWriter<8>;
+    Writer writer([&c](const std::string& b, uint64_t d) { c(b, d); });
+    writer.BeginAccepting();
+    for (int i = 0; i < 8; ++i) {
+        assert(writer.Submit("q" + std::to_string(i), false) == Writer::SubmitResult::Queued);
+    }
+    assert(writer.Submit(std::string("x"), false) == Writer::SubmitResult::Dropped);
+    assert(writer.Submit(std::string("y"), true) == Writer::SubmitResult::Dropped); // 退让后仍满
+    assert(writer.Dropped() == 2);
+
+    writer.RequestStop();
+    assert(writer.Drain(100));
+    assert(c.lines.size() == 8 && c.lines.front() == "q0" && c.lines.back() == "q7");
+    assert(c.dropped == 2 && writer.Written() == 8);
+    assert(writer.Submit(std::string("late"), false) == Writer::SubmitResult::NotRunning);
+}
+
+// 多生产者 + 写线程：容量足够时不丢行，且同一生产者的行保持顺序
+static void TestConcurrentOrder() {
+    Collector c;
+    using Writer = AsyncLogWriter<1024>;
+    Writer writer([&c](const std::string& b, uint64_t d) { c(b, d); });
+    writer.BeginAccepting();
+    std::thread consumer([&writer]() { writer.RunWriterLoop(); });
+
+    const int kThreads = 8;
+    const int kLines = 20000;
+    std::vector<std::thread> producers;
+    for (int t = 0; t < kThreads; ++t) {
+        producers.emplace_back([&writer, t]() {
+            for (int i = 0; i < kLines; ++i) {
+                std::string line = std::to_string(t) + ":" + std::to_string(i);
+                // 重要行在队列满时会退让重试；此处以普通行 + 自旋重试模拟“不丢”的生产者
+                while (writer.Submit(std::move(line), false) != Writer::SubmitResult::Queued) {
+                    line = std::to_string(t) + ":" + std::to_string(i);
+                    std::this_thread::yield();
+                }
+            }
+        });
+    }
+    for (auto& p : producers) p.join();
+    writer.RequestStop();
+    assert(writer.WaitStopped(5000));
+    consumer.join();
+
+    std::vector<int> next(kThreads, 0);
+    size_t total = 0;
+    for (const auto& line : c.lines) {
+        const size_t colon = line.find(':');
+        if (colon == std::string::npos) continue;
+        const int t = std::stoi(line.substr(0, colon));
+        const int i = std::stoi(line.substr(colon + 1));
+        assert(i == next[(size_t)t]);
+        ++next[(size_t)t];
+        ++total;
+    }
+    assert(total == (size_t)kThreads * kLines);
+    assert(writer.Written() == total && writer.Enqueued() == total);
+}
+
+int main() {
+    TestRing();
+    TestNotRunning();
+    TestDropAndSummary();
+    TestConcurrentOrder();
+    return 0;
+}
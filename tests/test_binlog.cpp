@@ -0,0 +1,213 @@
+#include <cassert>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "core/BinLog.hpp"
+
+using namespace Core;
+
+static std::string Text(LogEvent ev, const std::vector<LogArg>& args) {
+    std::string out;
+    FormatLogEvent(out, GetLogEventInfo(ev).format, args.data(), args.size());
+    return out;
+}
+
+static LogAddr V4(uint8_t a, uint8_t b, uint8_t c, uint8_t d, uint16_t port) {
+    LogAddr addr;
+    addr.family = 4;
+    addr.port = port;
+    addr.bytes[0] = a;
+    addr.bytes[1] = b;
+    addr.bytes[2] = c;
+    addr.bytes[3] = d;
+    return addr;
+}
+
+static LogAddr V6(const uint16_t (&groups)[8], uint16_t port) {
+    LogAddr addr;
+    addr.family = 6;
+    addr.port = port;
+    for (int i = 0; i < 8; ++i) {
+        addr.bytes[i * 2] = (uint8_t)(groups[i] >> 8);
+        addr.bytes[i * 2 + 1] = (uint8_t)groups[i];
+    }
+    return addr;
+}
+
+static std::string AddrText(const LogAddr& a) {
+    std::string out;
+    AppendLogAddr(out, a);
+    return out;
+}
+
+// 文本渲染与原先的字符串拼接结果一致
+static void TestTextFormat() {
+    int dummy = 0;
+    const auto args = MakeLogArgs((unsigned long long)1234, V4(10, 0, 0, 1, 443), (unsigned long)16, (void*)&dummy);
+    const std::string expect = "ConnectEx: 调用, sock=1234, dst=10.0.0.1:443, send_len=16, overlapped=" +
+                               std::to_string((unsigned long long)(uintptr_t)&dummy);
+    assert(Text(LogEvent::ConnectExCall, {args.begin(), args.end()}) == expect);
+
+    const std::string host = "example.com";
+    const auto args2 = MakeLogArgs("WSAConnect", (unsigned long long)7, LogHost(host), (uint16_t)80);
+    assert(Text(LogEvent::ConnectUdpDirect, {args2.begin(), args2.end()}) ==
+           "WSAConnect: UDP 直连, sock=7, target=example.com:80");
+
+    // 参数不足时保留占位符
+    assert(Text(LogEvent::CloseSocketDone, {}) == "closesocket: 完成, sock={}");
+    assert(AddrText(LogAddr()) == "(未知)");
+}
+
+static void TestIpv6Format() {
+    assert(AddrText(V6({0x2001, 0xdb8, 0, 0, 0, 0, 0, 1}, 443)) == "2001:db8::1:443");
+    assert(AddrText(V6({0, 0, 0, 0, 0, 0, 0, 1}, 53)) == "::1:53");
+    assert(AddrText(V6({1, 2, 3, 4, 5, 6, 7, 8}, 1)) == "1:2:3:4:5:6:7:8:1");
+    assert(AddrText(V6({1, 0, 2, 3, 4, 5, 6, 7}, 1)) == "1:0:2:3:4:5:6:7:1"); // 单个零组不压缩
+    assert(AddrText(V6({1, 0, 0, 2, 0, 0, 0, 3}, 1)) == "1:0:0:2::3:1");      // 压缩最长的一段
+    assert(AddrText(V6({0, 0, 0, 0, 0, 0xffff, 0x0102, 0x0304}, 80)) == "::ffff:1.2.3.4:80");
+}
+
+struct Collected {
+    std::vector<std::string> messages;
+    std::vector<BinLog::DecodedEvent> events;
+};
+
+// 去掉 "[时间] [PID:x][TID:y] [等级] " 前缀，只比较消息正文（时间戳依赖本地时区）
+static std::string MessageOf(const std::string& line) {
+    size_t pos = 0;
+    for (int i = 0; i < 3; ++i) pos = line.find("] ", pos) + 2;
+    return line.substr(pos);
+}
+
+static BinLog::DecodeStats DecodeAll(const std::string& data, Collected* out) {
+    BinLog::Reader reader;
+    return reader.Decode((const uint8_t*)data.data(), data.size(),
+                         [out](const std::string& line, const BinLog::DecodedEvent& ev) {
+                             out->messages.push_back(MessageOf(line));
+                             out->events.push_back(ev);
+                         });
+}
+
+static void TestRoundTrip() {
+    StringInterner interner;
+    std::string file;
+    BinLog::AppendSessionHeader(file, &interner);
+
+    const std::string host = "api.example.com";
+    const auto a1 = MakeLogArgs((unsigned long long)5, LogHost(host), (uint16_t)443);
+    const auto a2 = MakeLogArgs((unsigned long long)6, LogHost(host), (uint16_t)443, LogHost(host), 7890);
+    const auto a3 = MakeLogArgs((unsigned long long)9, -10054);
+    assert(BinLog::AppendEventRecord(file, &interner, LogEvent::BypassLoopback, LogLevel::Debug, 1700000000000000ull,
+                                     100, 200, a1.data(), a1.size()));   // 首次出现：写出定义
+    assert(!BinLog::AppendEventRecord(file, &interner, LogEvent::BypassProxySelf, LogLevel::Debug, 1700000000000001ull,
+                                      100, 201, a2.data(), a2.size())); // 已驻留：只写 ID
+    BinLog::AppendEventRecord(file, &interner, LogEvent::ShutdownFailed, LogLevel::Debug, 1700000000000002ull, 100, 202,
+                              a3.data(), a3.size());
+    assert(interner.Size() == 1);
+
+    Collected got;
+    const auto st = DecodeAll(file, &got);
+    assert(st.sessions == 1 && st.events == 3 && st.strings == 1 && st.trailingBytes == 0);
+    assert(got.messages[0] == Text(LogEvent::BypassLoopback, {a1.begin(), a1.end()}));
+    assert(got.messages[1] == Text(LogEvent::BypassProxySelf, {a2.begin(), a2.end()}));
+    assert(got.messages[2] == "shutdown: 失败, sock=9, WSA错误码=-10054");
+    assert(got.events[1].pid == 100 && got.events[1].tid == 201 && got.events[1].tsUs == 1700000000000001ull);
+
+    // 已驻留主机名的事件记录远小于对应的文本行
+    std::string record;
+    BinLog::AppendEventRecord(record, &interner, LogEvent::BypassProxySelf, LogLevel::Debug, 1700000000000001ull, 100,
+                              201, a2.data(), a2.size());
+    const std::string textLine = "[2026-01-11 12:00:00] [PID:100][TID:201] [调试] " + got.messages[1];
+    assert(record.size() * 3 < textLine.size());
+}
+
+// 多线程入队时定义记录可能晚于引用它的事件：会话内先收集再渲染
+static void TestLateDefinition() {
+    StringInterner writerSide;
+    std::string file;
+    BinLog::AppendSessionHeader(file, nullptr);
+
+    const std::string host = "late.example";
+    std::string definition;
+    const auto args = MakeLogArgs((unsigned long long)1, LogHost(host), (uint16_t)80);
+    // 线程 A 驻留并写出“定义 + 事件”，但线程 B 的事件（只含 ID）先进入文件
+    BinLog::AppendEventRecord(definition, &writerSide, LogEvent::BypassLoopback, LogLevel::Debug, 1, 1, 1,
+                              args.data(), args.size());
+    std::string referenceOnly;
+    BinLog::AppendEventRecord(referenceOnly, &writerSide, LogEvent::BypassLoopback, LogLevel::Debug, 2, 1, 2,
+                              args.data(), args.size());
+    file += referenceOnly;
+    file += definition;
+
+    Collected got;
+    DecodeAll(file, &got);
+    assert(got.messages.size() == 2);
+    assert(got.messages[0] == "BYPASS(loopback): sock=1, target=late.example:80");
+    assert(got.messages[1] == got.messages[0]);
+}
+
+// 截断/重启：末尾不完整记录被忽略；新会话重置字符串表
+static void TestSessionsAndTruncation() {
+    StringInterner first;
+    std::string file;
+    BinLog::AppendSessionHeader(file, &first);
+    const std::string hostA = "a.example";
+    const auto argsA = MakeLogArgs((unsigned long long)1, LogHost(hostA), (uint16_t)1);
+    BinLog::AppendEventRecord(file, &first, LogEvent::BypassLoopback, LogLevel::Debug, 1, 1, 1, argsA.data(), argsA.size());
+
+    StringInterner second; // 同 PID 重启：ID 从 1 重新分配
+    BinLog::AppendSessionHeader(file, &second);
+    const std::string hostB = "b.example";
+    const auto argsB = MakeLogArgs((unsigned long long)2, LogHost(hostB), (uint16_t)2);
+    BinLog::AppendEventRecord(file, &second, LogEvent::BypassLoopback, LogLevel::Debug, 2, 1, 1, argsB.data(), argsB.size());
+    const size_t complete = file.size();
+    BinLog::AppendEventRecord(file, &second, LogEvent::BypassLoopback, LogLevel::Debug, 3, 1, 1, argsB.data(), argsB.size());
+    file.resize(complete + 3); // 最后一条写到一半
+
+    Collected got;
+    const auto st = DecodeAll(file, &got);
+    assert(st.sessions == 2 && st.events == 2 && st.trailingBytes == 3);
+    assert(got.messages[0] == "BYPASS(loopback): sock=1, target=a.example:1");
+    assert(got.messages[1] == "BYPASS(loopback): sock=2, target=b.example:2");
+
+    // 没有文件头的数据不会被当作日志解析
+    Collected none;
+    const std::string garbage = "plain text log line\n";
+    assert(DecodeAll(garbage, &none).sessions == 0 && none.messages.empty());
+}
+
+// 驻留上限：超出后改为内联字符串，仍可正确解码
+static void TestInternLimit() {
+    StringInterner interner;
+    bool isNew = false;
+    assert(interner.Intern(std::string(StringInterner::kMaxLength + 1, 'x'), &isNew) == 0 && !isNew);
+    assert(interner.Intern("", &isNew) == 0);
+    std::vector<std::string> hosts;
+    for (size_t i = 0; i < StringInterner::kMaxEntries; ++i) hosts.push_back("h" + std::to_string(i));
+    for (const auto& h : hosts) assert(interner.Intern(h, &isNew) != 0 && isNew);
+    assert(interner.Intern("overflow", &isNew) == 0);
+    assert(interner.Intern("h7", &isNew) == 8 && !isNew);
+
+    std::string file;
+    BinLog::AppendSessionHeader(file, &interner);
+    const std::string host = "overflow.example";
+    const auto args = MakeLogArgs((unsigned long long)3, LogHost(host), (uint16_t)443);
+    assert(!BinLog::AppendEventRecord(file, &interner, LogEvent::BypassLoopback, LogLevel::Debug, 1, 1, 1, args.data(),
+                                      args.size()));
+    Collected got;
+    const auto st = DecodeAll(file, &got);
+    assert(st.strings == StringInterner::kMaxEntries);
+    assert(got.messages.back() == "BYPASS(loopback): sock=3, target=overflow.example:443");
+}
+
+int main() {
+    TestTextFormat();
+    TestIpv6Format();
+    TestRoundTrip();
+    TestLateDefinition();
+    TestSessionsAndTruncation();
+    TestInternLimit();
+    return 0;
+}
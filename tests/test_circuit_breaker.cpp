@@ -0,0 +1,257 @@
+#include <cassert>
+#include <atomic>
+#include <cstdint>
+#include <thread>
+
+#ifdef _WIN32
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#include <winsock2.h>
+#include <ws2tcpip.h>
+typedef SOCKET TestSocket;
+static const TestSocket kInvalidSocket = INVALID_SOCKET;
+static void CloseTestSocket(TestSocket s) { closesocket(s); }
+#else
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+typedef int TestSocket;
+static const TestSocket kInvalidSocket = -1;
+static void CloseTestSocket(TestSocket s) { close(s); }
+#endif
+
+#include "network/CircuitBreaker.hpp"
+#include "network/HandshakeResult.hpp"
+
+using Network::CircuitBreaker;
+using Network::CircuitBreakerOptions;
+using Network::CircuitState;
+using Network::CircuitTransition;
+
+// 模拟“时好时坏”的上游代理：在线时回应 SOCKS5 无认证协商(05 00)，离线时接受后立即断开
+struct FlappingProxy {
+    TestSocket listener = kInvalidSocket;
+    uint16_t port = 0;
+    std::atomic<bool> up{true};
+    std::atomic<bool> stop{false};
+    std::thread worker;
+
+    bool Start() {
+        listener = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+        if (listener == kInvalidSocket) return false;
+        sockaddr_in addr{};
+        addr.sin_family = AF_INET;
+        addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        addr.sin_port = 0;
+        if (bind(listener, (sockaddr*)&addr, sizeof(addr)) != 0) return false;
+        if (listen(listener, 16) != 0) return false;
+        socklen_t len = sizeof(addr);
+        if (getsockname(listener, (sockaddr*)&addr, &len) != 0) return false;
+        port = ntohs(addr.sin_port);
+        worker = std::thread([this]() {
+            while (!stop.load()) {
+                TestSocket c = accept(listener, nullptr, nullptr);
+                if (c == kInvalidSocket) continue;
+                if (up.load()) {
+                    char greeting[3] = {0};
+                    if (recv(c, greeting, 3, 0) == 3 && greeting[0] == 0x05) {
+                        const char reply[2] = {0x05, 0x00};
+                        send(c, reply, 2, 0);
+                    }
+                }
+                CloseTestSocket(c);
+            }
+        });
+        return true;
+    }
+
+    void Stop() {
+        stop = true;
+        // 唤醒阻塞中的 accept
+        TestSocket s = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+        sockaddr_in addr{};
+        addr.sin_family = AF_INET;
+        addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        addr.sin_port = htons(port);
+        connect(s, (sockaddr*)&addr, sizeof(addr));
+        CloseTestSocket(s);
+        worker.join();
+        CloseTestSocket(listener);
+    }
+};
+
+// 一次“连接代理 + 最小 SOCKS5 协商”，等价于 Hooks 中 connect + DoProxyHandshake 的成败判定
+static bool ProbeProxy(uint16_t port) {
+    TestSocket s = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+    if (s == kInvalidSocket) return false;
+    sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    addr.sin_port = htons(port);
+    bool ok = false;
+    if (connect(s, (sockaddr*)&addr, sizeof(addr)) == 0) {
+        const char greeting[3] = {0x05, 0x01, 0x00};
+        char reply[2] = {0};
+        ok = send(s, greeting, 3, 0) == 3 && recv(s, reply, 2, 0) == 2 && reply[0] == 0x05 && reply[1] == 0x00;
+    }
+    CloseTestSocket(s);
+    return ok;
+}
+
+// 经熔断器发起一次连接；返回值：1=成功，0=失败，-1=被熔断拒绝（未触达代理）
+static int AttemptViaBreaker(CircuitBreaker& breaker, uint64_t nowMs, uint16_t port, int* probesSent) {
+    if (!breaker.Allow(nowMs)) return -1;
+    (*probesSent)++;
+    const bool ok = ProbeProxy(port);
+    if (ok) breaker.RecordSuccess(nowMs);
+    else breaker.RecordFailure(nowMs);
+    return ok ? 1 : 0;
+}
+
+static void TestStateMachine() {
+    CircuitBreakerOptions opt;
+    opt.failureThreshold = 3;
+    opt.cooldownMs = 1000;
+    opt.halfOpenProbes = 1;
+    CircuitBreaker cb(opt);
+    CircuitTransition t;
+
+    // 未达阈值不熔断；成功会清零连续失败计数
+    cb.RecordFailure(0);
+    cb.RecordFailure(0);
+    cb.RecordSuccess(0);
+    cb.RecordFailure(0);
+    cb.RecordFailure(0);
+    assert(cb.GetStats().state == CircuitState::Closed);
+    cb.RecordFailure(10, &t);
+    assert(t.changed && t.from == CircuitState::Closed && t.to == CircuitState::Open);
+    assert(t.consecutiveFailures == 3);
+
+    // 冷却期内拒绝
+    assert(!cb.Allow(500));
+    assert(cb.RemainingCooldownMs(500) == 510);
+    assert(cb.GetStats().rejected == 1);
+
+    // 冷却结束：仅放行 1 个探测
+    assert(cb.Allow(1010, &t));
+    assert(t.changed && t.to == CircuitState::HalfOpen);
+    assert(!cb.Allow(1020));
+
+    // 探测失败：重新熔断，冷却期从失败时刻重新计算
+    cb.RecordFailure(1100, &t);
+    assert(t.changed && t.from == CircuitState::HalfOpen && t.to == CircuitState::Open);
+    assert(!cb.Allow(2000));
+    assert(cb.Allow(2100));
+
+    // 探测结果丢失（未上报）：超过 cooldown 后重新放行探测，避免卡死在 half-open
+    assert(!cb.Allow(2500));
+    assert(cb.Allow(3100));
+
+    // 探测成功：恢复 closed
+    cb.RecordSuccess(3200, &t);
+    assert(t.changed && t.from == CircuitState::HalfOpen && t.to == CircuitState::Closed);
+    const auto stats = cb.GetStats();
+    assert(stats.state == CircuitState::Closed);
+    assert(stats.consecutiveFailures == 0);
+    assert(stats.opened == 2);
+    assert(stats.halfOpened == 2);
+    assert(stats.closed == 1);
+}
+
+static void TestFlappingProxy() {
+    FlappingProxy proxy;
+    const bool started = proxy.Start();
+    assert(started);
+    (void)started;
+
+    CircuitBreakerOptions opt;
+    opt.failureThreshold = 3;
+    opt.cooldownMs = 1000;
+    CircuitBreaker cb(opt);
+    uint64_t now = 0;
+    int probesSent = 0;
+
+    // 在线：正常放行
+    for (int i = 0; i < 5; ++i) {
+        assert(AttemptViaBreaker(cb, now, proxy.port, &probesSent) == 1);
+        now += 10;
+    }
+    assert(probesSent == 5);
+
+    // 离线：前 3 次真实失败后熔断，后续请求不再触达代理
+    proxy.up = false;
+    probesSent = 0;
+    int rejected = 0;
+    for (int i = 0; i < 50; ++i) {
+        const int r = AttemptViaBreaker(cb, now, proxy.port, &probesSent);
+        assert(r != 1);
+        if (r == -1) rejected++;
+        now += 10;
+    }
+    assert(probesSent == 3);
+    assert(rejected == 47);
+    assert(cb.GetStats().state == CircuitState::Open);
+
+    // 仍离线：冷却结束后的探测失败，重新熔断
+    now += 1000;
+    assert(AttemptViaBreaker(cb, now, proxy.port, &probesSent) == 0);
+    assert(cb.GetStats().state == CircuitState::Open);
+    assert(AttemptViaBreaker(cb, now + 10, proxy.port, &probesSent) == -1);
+
+    // 恢复在线：下一次探测成功后立即恢复 closed
+    proxy.up = true;
+    now += 1000;
+    assert(AttemptViaBreaker(cb, now, proxy.port, &probesSent) == 1);
+    assert(cb.GetStats().state == CircuitState::Closed);
+    assert(AttemptViaBreaker(cb, now + 10, proxy.port, &probesSent) == 1);
+
+    proxy.Stop();
+}
+
+// 握手失败分类：代理按协议应答“目标失败”时代理可用，计为成功；应用反复重试单个失效目标不会打开熔断
+static void TestTargetErrorsKeepBreakerClosed() {
+    using Network::HandshakeResult;
+    assert(Network::ClassifySocks5Reply(0x00) == HandshakeResult::Ok);
+    assert(Network::ClassifySocks5Reply(0x01) == HandshakeResult::TargetError);
+    assert(Network::ClassifySocks5Reply(0x04) == HandshakeResult::TargetError);
+    assert(Network::ClassifySocks5Reply(0x05) == HandshakeResult::TargetError);
+    assert(Network::ClassifySocks5Reply(0x07) == HandshakeResult::ProxyError);
+    assert(Network::ClassifyHttpConnectStatus(200) == HandshakeResult::Ok);
+    assert(Network::ClassifyHttpConnectStatus(502) == HandshakeResult::TargetError);
+    assert(Network::ClassifyHttpConnectStatus(504) == HandshakeResult::TargetError);
+    assert(Network::ClassifyHttpConnectStatus(407) == HandshakeResult::ProxyError);
+    assert(Network::ClassifyHttpConnectStatus(0) == HandshakeResult::ProxyError);
+
+    CircuitBreakerOptions opt;
+    opt.failureThreshold = 3;
+    CircuitBreaker cb(opt);
+    auto report = [&](HandshakeResult r, uint64_t now) {
+        if (r == HandshakeResult::ProxyError) cb.RecordFailure(now);
+        else cb.RecordSuccess(now);
+    };
+    for (uint64_t now = 0; now < 20; ++now) {
+        assert(cb.Allow(now));
+        report(Network::ClassifySocks5Reply(0x05), now);
+    }
+    assert(cb.GetStats().state == CircuitState::Closed);
+    for (uint64_t now = 20; now < 23; ++now) report(HandshakeResult::ProxyError, now);
+    assert(cb.GetStats().state == CircuitState::Open);
+}
+
+int main() {
+#ifdef _WIN32
+    WSADATA wsa{};
+    const int wsaRc = WSAStartup(MAKEWORD(2, 2), &wsa);
+    assert(wsaRc == 0);
+    (void)wsaRc;
+#endif
+    TestStateMachine();
+    TestFlappingProxy();
+    TestTargetErrorsKeepBreakerClosed();
+#ifdef _WIN32
+    WSACleanup();
+#endif
+    return 0;
+}
@@ -0,0 +1,332 @@
+#include <cassert>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "core/ConnTrace.hpp"
+
+using Core::ConnTrace;
+using Core::ConnTraceRecord;
+using Core::HdrHistogram;
+using Core::TraceSpan;
+using Core::TraceStage;
+
+static bool Contains(const std::string& text, const std::string& needle) {
+    return text.find(needle) != std::string::npos;
+}
+
+// 测试中在堆上创建独立实例（追踪表较大，且不与 Instance() 共享状态）
+static std::unique_ptr<ConnTrace> NewTrace(uint32_t sampleEvery) {
+    std::unique_ptr<ConnTrace> t(new ConnTrace());
+    t->Configure(true, sampleEvery);
+    return t;
+}
+
+// 档位：线性段逐一计数，之后每段 16 档，上界单调且相对误差不超过 1/16
+static void TestHdrBuckets() {
+    for (uint64_t v = 0; v < 32; ++v) {
+        assert(HdrHistogram::BucketOf(v) == v);
+        assert(HdrHistogram::UpperBound(v) == v);
+    }
+    assert(HdrHistogram::BucketOf(32) == 32);
+    assert(HdrHistogram::BucketOf(33) == 32);
+    assert(HdrHistogram::BucketOf(34) == 33);
+    uint64_t prevUpper = 0;
+    for (size_t i = 0; i + 1 < HdrHistogram::kBuckets; ++i) {
+        const uint64_t upper = HdrHistogram::UpperBound(i);
+        assert(i == 0 || upper > prevUpper);
+        assert(HdrHistogram::BucketOf(upper) == i);
+        assert(HdrHistogram::BucketOf(upper + 1) == i + 1);
+        prevUpper = upper;
+    }
+    for (uint64_t v : {100ull, 1000ull, 123456ull, 987654321ull}) {
+        const uint64_t upper = HdrHistogram::UpperBound(HdrHistogram::BucketOf(v));
+        assert(upper >= v && (upper - v) * 16 <= v);
+    }
+    assert(HdrHistogram::BucketOf(~0ull) == HdrHistogram::kBuckets - 1);
+}
+
+static void TestHdrPercentiles() {
+    HdrHistogram h;
+    assert(h.Read().Percentile(0.5) == 0);
+    for (uint64_t v = 1; v <= 1000; ++v) h.Record(v);
+    h.Record(1000000);
+    const auto s = h.Read();
+    assert(s.count == 1001 && s.max == 1000000);
+    assert(s.sum == 500500 + 1000000);
+    const uint64_t p50 = s.Percentile(0.5);
+    assert(p50 >= 500 && p50 <= 500 + 500 / 16);
+    const uint64_t p99 = s.Percentile(0.99);
+    assert(p99 >= 990 && p99 <= 1000);
+    assert(s.Percentile(1.0) == 1000000);
+    assert(s.Percentile(0.0) == 1);
+}
+
+static ConnTraceRecord MakeRecord() {
+    ConnTraceRecord r;
+    r.ts[(size_t)TraceStage::DnsStart] = 100;
+    r.ts[(size_t)TraceStage::DnsDone] = 150;
+    r.ts[(size_t)TraceStage::ConnectStart] = 200;
+    r.ts[(size_t)TraceStage::ProxyConnected] = 300;
+    r.ts[(size_t)TraceStage::GreetingDone] = 320;
+    r.ts[(size_t)TraceStage::TunnelReady] = 400;
+    r.ts[(size_t)TraceStage::FirstSend] = 410;
+    r.ts[(size_t)TraceStage::FirstRecv] = 500;
+    return r;
+}
+
+static void TestSpans() {
+    ConnTraceRecord r = MakeRecord();
+    uint64_t a = 0, b = 0;
+    assert(r.Span(TraceSpan::Dns, &a, &b) && a == 100 && b == 150);
+    assert(r.Span(TraceSpan::ProxyConnect, &a, &b) && a == 200 && b == 300);
+    assert(r.Span(TraceSpan::Greeting, &a, &b) && a == 300 && b == 320);
+    assert(r.Span(TraceSpan::Connect, &a, &b) && a == 320 && b == 400);
+    assert(r.Span(TraceSpan::FirstSend, &a, &b) && a == 400 && b == 410);
+    assert(r.Span(TraceSpan::FirstByte, &a, &b) && a == 410 && b == 500);
+    assert(r.Span(TraceSpan::Total, &a, &b) && a == 100 && b == 500);
+
+    // HTTP CONNECT：无 greeting，CONNECT 从代理连接完成算起；无 DNS 时总耗时从 connect 入口算起
+    r.ts[(size_t)TraceStage::GreetingDone] = 0;
+    r.ts[(size_t)TraceStage::DnsStart] = 0;
+    r.ts[(size_t)TraceStage::DnsDone] = 0;
+    assert(!r.Span(TraceSpan::Greeting, &a, &b));
+    assert(!r.Span(TraceSpan::Dns, &a, &b));
+    assert(r.Span(TraceSpan::Connect, &a, &b) && a == 300 && b == 400);
+    assert(r.Span(TraceSpan::Total, &a, &b) && a == 200 && b == 500);
+
+    // 服务端先发：首字节早于首次发送时从隧道就绪算起
+    r.ts[(size_t)TraceStage::FirstSend] = 600;
+    assert(r.Span(TraceSpan::FirstByte, &a, &b) && a == 400 && b == 500);
+
+    // 握手中途失败：后续阶段缺失
+    ConnTraceRecord failed;
+    failed.ts[(size_t)TraceStage::ConnectStart] = 10;
+    failed.ts[(size_t)TraceStage::ProxyConnected] = 20;
+    assert(failed.Span(TraceSpan::ProxyConnect, &a, &b));
+    assert(!failed.Span(TraceSpan::Connect, &a, &b));
+    assert(!failed.Span(TraceSpan::Total, &a, &b));
+}
+
+// 完整生命周期：握手期间的收发不计入，隧道就绪后的首次发送/接收计入，首字节即结束
+static void TestLifecycle() {
+    auto t = NewTrace(1);
+    assert(t->Begin(7, "example.com", 443, 1000));
+    t->Mark(7, TraceStage::ProxyConnected, 1100);
+    t->OnSend(7, 1110); // SOCKS5 问候
+    t->OnRecv(7, 1120);
+    t->Mark(7, TraceStage::GreetingDone, 1130);
+    t->Mark(7, TraceStage::GreetingDone, 9999); // 只取第一次
+    t->Mark(7, TraceStage::TunnelReady, 1200);
+    t->OnSend(7, 1250);
+    t->OnSend(7, 1260);
+    assert(t->GetStats().completed == 0);
+    t->OnRecv(7, 1400);
+    t->OnRecv(7, 1500); // 已结束
+    t->Finish(7, false);
+
+    const auto stats = t->GetStats();
+    assert(stats.begun == 1 && stats.completed == 1 && stats.abandoned == 0 && stats.sampled == 1);
+    assert(t->ReadSpan(TraceSpan::ProxyConnect).count == 1 && t->ReadSpan(TraceSpan::ProxyConnect).max == 100);
+    assert(t->ReadSpan(TraceSpan::Greeting).max == 30);
+    assert(t->ReadSpan(TraceSpan::Connect).max == 70);
+    assert(t->ReadSpan(TraceSpan::FirstSend).max == 50);
+    assert(t->ReadSpan(TraceSpan::FirstByte).max == 150);
+    assert(t->ReadSpan(TraceSpan::Total).max == 400);
+    assert(t->ReadSpan(TraceSpan::Dns).count == 0);
+
+    const auto samples = t->Samples();
+    assert(samples.size() == 1);
+    assert(samples[0].socket == 7 && samples[0].host == "example.com" && samples[0].port == 443 && !samples[0].failed);
+    assert(samples[0].At(TraceStage::GreetingDone) == 1130 && samples[0].At(TraceStage::FirstRecv) == 1400);
+}
+
+static void TestFailureAndAbandon() {
+    auto t = NewTrace(1);
+    assert(t->Begin(9, "a.test", 80, 10));
+    t->Mark(9, TraceStage::ProxyConnected, 20);
+    t->Finish(9, true);
+    t->Finish(9, false); // closesocket：已结束
+    assert(t->Begin(10, "b.test", 80, 10));
+    t->Mark(10, TraceStage::TunnelReady, 30);
+    t->Finish(10, false);
+    // 同一句柄重复 Begin：旧记录按放弃处理
+    assert(t->Begin(11, "c.test", 80, 10));
+    assert(t->Begin(11, "c.test", 80, 40));
+
+    const auto stats = t->GetStats();
+    assert(stats.begun == 4 && stats.failed == 1 && stats.abandoned == 2 && stats.completed == 0);
+    const auto samples = t->Samples();
+    assert(samples.size() == 3);
+    size_t failed = 0;
+    for (const auto& r : samples) failed += r.failed ? 1 : 0;
+    assert(failed == 1);
+
+    // 未追踪的 socket 与未启用时均为空操作
+    t->Mark(12345, TraceStage::TunnelReady);
+    t->OnRecv(12345);
+    t->Configure(false, 1);
+    assert(!t->Begin(12, "d.test", 80, 10));
+    assert(t->GetStats().begun == 4);
+}
+
+// 同一对候选槽位都被占用时放弃追踪，释放后可再次使用
+static void TestSlotExhaustion() {
+    auto t = NewTrace(0);
+    std::vector<uint64_t> sameSlot;
+    size_t first = ~(size_t)0;
+    for (uint64_t s = 1; sameSlot.size() < 3 && s < 1000000; ++s) {
+        const size_t idx = (size_t)((s * 0x9E3779B97F4A7C15ull) >> (64 - 10)) & ~(size_t)1;
+        if (first == ~(size_t)0) first = idx;
+        if (idx == first) sameSlot.push_back(s);
+    }
+    assert(sameSlot.size() == 3);
+    assert(t->Begin(sameSlot[0], "x", 1, 1));
+    assert(t->Begin(sameSlot[1], "x", 1, 1));
+    assert(!t->Begin(sameSlot[2], "x", 1, 1));
+    assert(t->GetStats().dropped == 1);
+    t->Mark(sameSlot[2], TraceStage::TunnelReady, 5); // 未追踪：不得写入他人的槽位
+    t->Finish(sameSlot[0], false);
+    assert(t->Begin(sameSlot[2], "x", 1, 1));
+    t->Finish(sameSlot[1], false);
+    t->Finish(sameSlot[2], false);
+    assert(t->ReadSpan(TraceSpan::Connect).count == 0);
+    assert(t->Samples().empty());
+}
+
+// DNS：同线程解析后对同一域名（或解析出的 IP）的连接取用一次；其他线程、过期、不同域名不取用
+static void TestDnsAssociation() {
+    auto t = NewTrace(1);
+    ConnTrace::NoteDns("example.com", 1000, 1500);
+    assert(t->Begin(1, "other.com", 443, 2000));
+    assert(t->Begin(2, "example.com", 443, 2000));
+    assert(t->Begin(3, "example.com", 443, 2100)); // 已被取用
+    std::thread([&]() {
+        ConnTrace::NoteDns("thread.com", 1000, 1500);
+    }).join();
+    assert(t->Begin(4, "thread.com", 443, 2000));
+    ConnTrace::NoteDns("ip.com", 3000, 3500);
+    assert(t->Begin(5, "10.0.0.1", 443, 3600));
+    ConnTrace::NoteDns("late.com", 3000, 3500);
+    assert(t->Begin(6, "late.com", 443, 3500 + ConnTrace::kDnsMatchWindowUs + 1));
+    for (uint64_t s = 1; s <= 6; ++s) t->Finish(s, false);
+
+    const auto samples = t->Samples();
+    assert(samples.size() == 6);
+    for (const auto& r : samples) {
+        const bool hasDns = r.At(TraceStage::DnsDone) != 0;
+        assert(hasDns == (r.socket == 2 || r.socket == 5));
+        if (r.socket == 2) assert(r.At(TraceStage::DnsStart) == 1000 && r.At(TraceStage::DnsDone) == 1500);
+    }
+    assert(t->ReadSpan(TraceSpan::Dns).count == 2);
+}
+
+// 采样：每 N 个连接保留一个；环形缓冲只保留最近 kSampleRing 条，按开始时间排序
+static void TestSampling() {
+    auto t = NewTrace(3);
+    for (uint64_t s = 1; s <= 9; ++s) {
+        assert(t->Begin(s, "h", 1, s * 10));
+        t->Finish(s, false);
+    }
+    assert(t->GetStats().sampled == 3 && t->Samples().size() == 3);
+
+    auto all = NewTrace(1);
+    for (uint64_t s = 1; s <= ConnTrace::kSampleRing + 20; ++s) {
+        assert(all->Begin(s, "h", 1, s * 10));
+        all->Finish(s, false);
+    }
+    const auto samples = all->Samples();
+    assert(samples.size() == ConnTrace::kSampleRing);
+    assert(samples.front().socket == 21 && samples.back().socket == ConnTrace::kSampleRing + 20);
+    for (size_t i = 1; i < samples.size(); ++i) {
+        assert(samples[i - 1].At(TraceStage::ConnectStart) < samples[i].At(TraceStage::ConnectStart));
+    }
+}
+
+static void TestChromeTrace() {
+    ConnTraceRecord ok = MakeRecord();
+    ok.socket = 42;
+    ok.host = "we\"ird\\host";
+    ok.port = 443;
+    ConnTraceRecord failed;
+    failed.socket = 43;
+    failed.host = "fail.test";
+    failed.port = 80;
+    failed.failed = true;
+    failed.ts[(size_t)TraceStage::ConnectStart] = 1000;
+    failed.ts[(size_t)TraceStage::ProxyConnected] = 1200;
+
+    const std::string json = Core::RenderChromeTrace({ok, failed}, 1234);
+    assert(json.rfind("{\"displayTimeUnit\":\"ms\",\"traceEvents\":[", 0) == 0);
+    assert(Contains(json, "\"args\":{\"name\":\"antigravity-proxy 1234\"}"));
+    assert(Contains(json, "\"args\":{\"name\":\"we\\\"ird\\\\host:443 sock=42\"}"));
+    assert(Contains(json, "{\"name\":\"dns\",\"cat\":\"conn\",\"ph\":\"X\",\"pid\":1234,\"tid\":1,\"ts\":100,\"dur\":50}"));
+    assert(Contains(json, "{\"name\":\"connection\",\"cat\":\"conn\",\"ph\":\"X\",\"pid\":1234,\"tid\":1,\"ts\":100,\"dur\":400}"));
+    assert(Contains(json, "{\"name\":\"proxy_connect\",\"cat\":\"conn\",\"ph\":\"X\",\"pid\":1234,\"tid\":2,\"ts\":1000,\"dur\":200}"));
+    assert(Contains(json, "\"name\":\"handshake_failed\",\"cat\":\"conn\",\"ph\":\"i\",\"s\":\"t\",\"pid\":1234,\"tid\":2,\"ts\":1200}"));
+    assert(!Contains(json, "\"tid\":1,\"ts\":500}")); // 成功的连接无失败标记
+    assert(json.compare(json.size() - 3, 3, "]}\n") == 0);
+
+    const std::string empty = Core::RenderChromeTrace({}, 1);
+    assert(Contains(empty, "process_name") && !Contains(empty, "\"ph\":\"X\""));
+}
+
+// 多线程并发 Begin/Mark/OnSend/OnRecv/Finish：计数守恒，采样记录各时间点自洽
+static void TestConcurrent() {
+    auto t = NewTrace(4);
+    const int kThreads = 4;
+    const uint64_t kPerThread = 20000;
+    std::vector<std::thread> threads;
+    for (int th = 0; th < kThreads; ++th) {
+        threads.emplace_back([&, th]() {
+            for (uint64_t i = 0; i < kPerThread; ++i) {
+                const uint64_t s = (uint64_t)th * 1000000 + i + 1;
+                const uint64_t base = i * 10 + 1;
+                if (!t->Begin(s, "h", 443, base)) continue;
+                t->Mark(s, TraceStage::ProxyConnected, base + 1);
+                t->Mark(s, TraceStage::TunnelReady, base + 2);
+                t->OnSend(s, base + 3);
+                if (i % 3 == 0) t->Finish(s, false);
+                else if (i % 3 == 1) t->Finish(s, true);
+                t->OnRecv(s, base + 4);
+                t->Finish(s, false);
+            }
+        });
+    }
+    std::atomic<bool> done{false};
+    std::thread reader([&]() {
+        while (!done.load()) {
+            for (const auto& r : t->Samples()) {
+                assert(r.At(TraceStage::ProxyConnected) == r.At(TraceStage::ConnectStart) + 1);
+                assert(r.host == "h" && r.port == 443);
+            }
+        }
+    });
+    for (auto& th : threads) th.join();
+    done = true;
+    reader.join();
+
+    const auto s = t->GetStats();
+    assert(s.begun + s.dropped == (uint64_t)kThreads * kPerThread);
+    assert(s.completed + s.failed + s.abandoned == s.begun);
+    assert(t->ReadSpan(TraceSpan::ProxyConnect).count == s.begun);
+    assert(t->ReadSpan(TraceSpan::FirstByte).count == s.completed);
+    assert(t->ReadSpan(TraceSpan::ProxyConnect).max == 1);
+}
+
+int main() {
+    TestHdrBuckets();
+    TestHdrPercentiles();
+    TestSpans();
+    TestLifecycle();
+    TestFailureAndAbandon();
+    TestSlotExhaustion();
+    TestDnsAssociation();
+    TestSampling();
+    TestChromeTrace();
+    TestConcurrent();
+    return 0;
+}
@@ -0,0 +1,68 @@
+#include <cassert>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "network/ExpiringSlab.hpp"
+
+using Network::ExpiringSlab;
+
+static void TestTakeAndGeneration() {
+    ExpiringSlab<std::string, 16, 10> slab;
+    const auto a = slab.Insert("a", 1000, 100);
+    assert(a != 0 && slab.Size() == 1 && slab.Contains(a));
+    std::string out;
+    assert(slab.Take(a, &out) && out == "a");
+    assert(!slab.Take(a, &out)); // 已取走
+
+    // 槽位复用后旧句柄失效
+    const auto b = slab.Insert("b", 1000, 100);
+    assert((b & 0xFFFFFFFFu) == (a & 0xFFFFFFFFu) && b != a);
+    assert(!slab.Contains(a) && slab.Contains(b));
+    assert(!slab.Erase(a));
+    assert(slab.Erase(b) && slab.Size() == 0);
+}
+
+static void TestExpire() {
+    ExpiringSlab<int, 16, 10> slab;
+    std::vector<int> expired;
+    auto collect = [&](uint64_t, int&& v) { expired.push_back(v); };
+
+    const auto h1 = slab.Insert(1, 1000, 50);  // 到期 1050
+    const auto h2 = slab.Insert(2, 1000, 120); // 到期 1120
+    const auto h3 = slab.Insert(3, 1005, 50);  // 到期 1055
+    assert(slab.Expire(1040, collect) == 0);
+    assert(slab.Take(h3, nullptr));            // 完成的条目不会再到期
+    assert(slab.Expire(1060, collect) == 1 && expired == std::vector<int>{1});
+    assert(!slab.Contains(h1) && slab.Contains(h2));
+    assert(slab.Expire(1119, collect) == 0);
+    assert(slab.Expire(1130, collect) == 1 && expired.back() == 2);
+    assert(slab.Size() == 0);
+
+    // 长时间未推进（超过一整圈）仍能取出全部到期条目，未到期的保留
+    for (int i = 0; i < 40; ++i) slab.Insert(i, 2000 + (uint64_t)i * 7, 100);
+    const auto late = slab.Insert(99, 5000, 100);
+    expired.clear();
+    assert(slab.Expire(4000, collect) == 40);
+    assert(slab.Contains(late));
+    assert(slab.Expire(5100, collect) == 1 && expired.back() == 99);
+
+    // TTL 超过时间轮跨度时截断，仍可到期
+    slab.Insert(7, 10000, 100000);
+    assert(slab.Expire(10000 + ExpiringSlab<int, 16, 10>::kSpanMs, collect) == 1);
+
+    // 到期时间不在刻度边界上：最多延后一个粒度取出，而不是等待下一圈
+    slab.Insert(9, 20003, 50); // 到期 20053
+    assert(slab.Expire(20055, collect) == 0);
+    assert(slab.Expire(20060, collect) == 1 && expired.back() == 9);
+
+    slab.Insert(8, 20000, 50);
+    slab.Clear();
+    assert(slab.Size() == 0 && slab.Expire(30000, collect) == 0);
+}
+
+int main() {
+    TestTakeAndGeneration();
+    TestExpire();
+    return 0;
+}
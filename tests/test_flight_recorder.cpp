@@ -0,0 +1,167 @@
+#include <cassert>
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "core/FlightRecorder.hpp"
+
+using namespace Core;
+using Entry = FlightRecorder::Entry;
+
+static const uint64_t kBase = 1767225600ull * 1000000; // 整秒
+static std::atomic<uint64_t> g_now{kBase};
+static std::atomic<uint32_t> g_nextTid{1};
+
+static uint64_t FakeNow() { return g_now.fetch_add(1, std::memory_order_relaxed); }
+
+static uint32_t FakeThreadId() {
+    thread_local uint32_t t_tid = g_nextTid.fetch_add(1);
+    return t_tid;
+}
+
+static std::string Render(LogEvent ev, const LogArg* args, size_t count) {
+    std::string out;
+    FormatLogEvent(out, GetLogEventInfo(ev).format, args, count);
+    return out;
+}
+
+// 槽位内联的参数渲染结果与直接格式化一致（整数/负数/字符串/IPv4/IPv6）
+static void TestRecordAndRender() {
+    FlightRecorder rec(&FakeNow, &FakeThreadId);
+    const std::string host = "api.example.com";
+    rec.Record(LogEvent::BypassLoopback, 5ull, LogHost(host), (uint16_t)443);
+
+    LogAddr v6;
+    v6.family = 6;
+    v6.port = 8443;
+    v6.bytes[0] = 0x20;
+    v6.bytes[1] = 0x01;
+    v6.bytes[15] = 0x01;
+    const auto args = MakeLogArgs("WSAConnect", 18446744073709551615ull, v6, -10035, 28);
+    rec.Record(LogEvent::ConnectCall, args.data(), args.size());
+
+    const auto entries = rec.Collect(0, 100);
+    assert(entries.size() == 2);
+    assert(entries[0].event == LogEvent::BypassLoopback && entries[0].tid == FakeThreadId());
+    assert(entries[0].text == "BYPASS(loopback): sock=5, target=api.example.com:443");
+    assert(entries[1].text == Render(LogEvent::ConnectCall, args.data(), args.size()));
+    assert(entries[0].tsUs < entries[1].tsUs);
+}
+
+// 超长字符串截断（不拆开 UTF-8 字符）；放不下的参数显示为 "..."
+static void TestTruncation() {
+    FlightRecorder rec(&FakeNow, &FakeThreadId);
+    std::string longHost;
+    for (int i = 0; i < 40; ++i) longHost += "域";
+    rec.Record(LogEvent::BypassLoopback, 1ull, LogHost(longHost), (uint16_t)80);
+    const std::string filler(60, 'x');
+    rec.Record(LogEvent::BypassProxySelf, 2ull, LogHost(filler), (uint16_t)80, LogHost(filler), (uint16_t)7890);
+
+    const auto entries = rec.Collect(0, 100);
+    assert(entries.size() == 2);
+    const std::string& t = entries[0].text;
+    const size_t dots = t.find("...:80");
+    assert(dots != std::string::npos);
+    const std::string kept = t.substr(std::string("BYPASS(loopback): sock=1, target=").size(),
+                                      dots - std::string("BYPASS(loopback): sock=1, target=").size());
+    assert(!kept.empty() && kept.size() % 3 == 0 && longHost.compare(0, kept.size(), kept) == 0);
+
+    // 第二个字符串只剩部分空间：截断；其后的端口已放不下，显示为 "..."
+    assert(entries[1].text == "BYPASS(proxy-self): sock=2, target=" + filler + ":80, proxy=" + filler.substr(0, 8) + "...:...");
+}
+
+// 环满后覆盖最旧的事件；sinceUs 与 maxEvents 过滤
+static void TestWrapAndFilter() {
+    FlightRecorder rec(&FakeNow, &FakeThreadId);
+    const size_t total = FlightRecorder::kSlotsPerThread + 44;
+    for (size_t i = 0; i < total; ++i) rec.Record(LogEvent::CloseSocketDone, (unsigned long long)i);
+
+    auto entries = rec.Collect(0, 100000);
+    assert(entries.size() == FlightRecorder::kSlotsPerThread);
+    assert(entries.front().text == "closesocket: 完成, sock=44");
+    assert(entries.back().text == "closesocket: 完成, sock=" + std::to_string(total - 1));
+
+    entries = rec.Collect(0, 10);
+    assert(entries.size() == 10 && entries.front().text == "closesocket: 完成, sock=" + std::to_string(total - 10));
+
+    const uint64_t since = entries[4].tsUs;
+    entries = rec.Collect(since, 100000);
+    assert(entries.size() == 5 && entries.front().text == "closesocket: 完成, sock=" + std::to_string(total - 5));
+
+    rec.SetEnabled(false);
+    rec.Record(LogEvent::CloseSocketDone, 99999ull);
+    assert(rec.Collect(since, 100000).size() == 5);
+}
+
+// 转储行格式：缩进 + 本地时间（含毫秒）+ TID + 正文
+static void TestAppendEntries() {
+    Entry e;
+    e.tsUs = kBase + 123456;
+    e.tid = 77;
+    e.event = LogEvent::CloseSocketDone;
+    e.text = "closesocket: 完成, sock=1";
+    std::string out;
+    FlightRecorder::AppendEntries(out, {e, e}, "    ");
+    const std::string stamp = BinLog::FormatTimestamp(e.tsUs).substr(11);
+    const std::string line = "    [" + stamp + ".123] [TID:77] closesocket: 完成, sock=1\n";
+    assert(out == line + line);
+}
+
+// 多线程写入与转储并发：每条事件的参数相互校验，读到的记录不可能是新旧混合
+static void TestConcurrentWritersAndReader() {
+    FlightRecorder rec(&FakeNow, &FakeThreadId);
+    std::atomic<bool> stop{false};
+    std::atomic<bool> bad{false};
+    std::vector<std::thread> writers;
+    for (int t = 0; t < 4; ++t) {
+        writers.emplace_back([&]() {
+            for (uint64_t i = 0; !stop.load(std::memory_order_relaxed) && i < 200000; ++i) {
+                rec.Record(LogEvent::RoutePort, (unsigned long long)i, (uint16_t)(i & 0xFFFF),
+                           (i & 1) ? "proxy" : "not-allowed");
+            }
+        });
+    }
+    size_t seen = 0;
+    // 单核机器上写线程可能尚未被调度：至少读到一批记录再结束（写线程写满 200000 条后自行退出，不会死等）
+    for (int round = 0; round < 200 || seen == 0; ++round) {
+        for (const Entry& e : rec.Collect(0, 100000)) {
+            unsigned long long sock = 0;
+            unsigned port = 0;
+            char decision[32] = {0};
+            if (sscanf(e.text.c_str(), "路由: sock=%llu, 端口=%u, 端口决策=%31s", &sock, &port, decision) != 3 ||
+                port != (sock & 0xFFFF) || std::string(decision) != ((sock & 1) ? "proxy" : "not-allowed")) {
+                bad.store(true);
+            }
+            ++seen;
+        }
+    }
+    stop.store(true);
+    for (auto& w : writers) w.join();
+    assert(!bad.load());
+    assert(seen > 0);
+}
+
+// 线程退出后归还环：后续线程复用，线程数累计超过上限也不会丢失记录能力
+static void TestRingReuse() {
+    FlightRecorder rec(&FakeNow, &FakeThreadId);
+    for (size_t i = 0; i < FlightRecorder::kMaxThreads + 50; ++i) {
+        std::thread([&rec, i]() { rec.Record(LogEvent::CloseSocketDone, (unsigned long long)i); }).join();
+    }
+    assert(rec.UnrecordedThreads() == 0);
+    const auto entries = rec.Collect(0, 1);
+    assert(entries.size() == 1);
+    assert(entries[0].text == "closesocket: 完成, sock=" + std::to_string(FlightRecorder::kMaxThreads + 49));
+}
+
+int main() {
+    TestRecordAndRender();
+    TestTruncation();
+    TestWrapAndFilter();
+    TestAppendEntries();
+    TestConcurrentWritersAndReader();
+    TestRingReuse();
+    return 0;
+}
@@ -0,0 +1,229 @@
+#include <cassert>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <thread>
+#include <vector>
+
+#include "network/HappyEyeballs.hpp"
+
+using Network::HappyEyeballs::Candidate;
+using Network::HappyEyeballs::RaceResult;
+using Clock = std::chrono::steady_clock;
+
+static std::atomic<int> g_connectCalls{0};
+static std::atomic<int> g_closeCalls{0};
+
+static int WSAAPI CountingConnect(SOCKET s, const sockaddr* addr, int len) {
+    g_connectCalls++;
+    return connect(s, addr, (Network::SocketCompat::SockLen)len);
+}
+
+static int WSAAPI CountingClose(SOCKET s) {
+    g_closeCalls++;
+    return closesocket(s);
+}
+
+static Candidate LoopbackV4(uint16_t port) {
+    Candidate c;
+    auto* sin = (sockaddr_in*)&c.addr;
+    sin->sin_family = AF_INET;
+    sin->sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    sin->sin_port = htons(port);
+    c.addrLen = (int)sizeof(sockaddr_in);
+    return c;
+}
+
+static Candidate V6(uint16_t port, uint8_t last) {
+    Candidate c;
+    auto* sin6 = (sockaddr_in6*)&c.addr;
+    sin6->sin6_family = AF_INET6;
+    sin6->sin6_addr.s6_addr[15] = last;
+    sin6->sin6_port = htons(port);
+    c.addrLen = (int)sizeof(sockaddr_in6);
+    return c;
+}
+
+static uint16_t PortOf(const Candidate& c) {
+    return c.addr.ss_family == AF_INET ? ntohs(((const sockaddr_in*)&c.addr)->sin_port)
+                                       : ntohs(((const sockaddr_in6*)&c.addr)->sin6_port);
+}
+
+static SOCKET Listen(int backlog, uint16_t* port) {
+    SOCKET s = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+    assert(s != INVALID_SOCKET);
+    sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    assert(bind(s, (const sockaddr*)&addr, sizeof(addr)) == 0);
+    assert(listen(s, backlog) == 0);
+    Network::SocketCompat::SockLen len = sizeof(addr);
+    assert(getsockname(s, (sockaddr*)&addr, &len) == 0);
+    *port = ntohs(addr.sin_port);
+    return s;
+}
+
+// 已释放的回环端口：connect 立即被拒绝
+static uint16_t RefusedPort() {
+    uint16_t port = 0;
+    SOCKET s = Listen(1, &port);
+    closesocket(s);
+    return port;
+}
+
+// 黑洞：监听队列已满且从不 accept，新的 SYN 被丢弃，connect 一直处于进行中
+// 说明：依赖 Linux 队列满时丢弃 SYN 的行为；其他平台（Windows 回复 RST）上 Holds() 为 false，相关用例跳过
+struct Blackhole {
+    SOCKET listener = INVALID_SOCKET;
+    std::vector<SOCKET> fillers;
+    uint16_t port = 0;
+
+    Blackhole() {
+        listener = Listen(0, &port);
+        const Candidate c = LoopbackV4(port);
+        for (int i = 0; i < 4; ++i) {
+            SOCKET f = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+            unsigned long nb = 1;
+            ioctlsocket(f, FIONBIO, &nb);
+            connect(f, (const sockaddr*)&c.addr, c.addrLen);
+            fillers.push_back(f);
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    }
+
+    bool Holds() const {
+        const Candidate c = LoopbackV4(port);
+        SOCKET s = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+        unsigned long nb = 1;
+        ioctlsocket(s, FIONBIO, &nb);
+        connect(s, (const sockaddr*)&c.addr, c.addrLen);
+        Network::SocketCompat::PollFd pfd{};
+        pfd.fd = s;
+        pfd.events = POLLOUT;
+        const bool pending = Network::SocketCompat::Poll(&pfd, 1, 100) == 0;
+        closesocket(s);
+        return pending;
+    }
+
+    ~Blackhole() {
+        for (SOCKET f : fillers) closesocket(f);
+        closesocket(listener);
+    }
+};
+
+static long long MsSince(Clock::time_point start) {
+    return std::chrono::duration_cast<std::chrono::milliseconds>(Clock::now() - start).count();
+}
+
+// 按族交替，首选族在前；同族内保持原有顺序
+static void TestInterleave() {
+    std::vector<Candidate> in = {LoopbackV4(1), LoopbackV4(2), V6(3, 1), V6(4, 1), V6(5, 1)};
+    auto out = Network::HappyEyeballs::Interleave(in, AF_INET6);
+    assert(out.size() == 5);
+    const uint16_t expect6[] = {3, 1, 4, 2, 5};
+    for (size_t i = 0; i < out.size(); ++i) assert(PortOf(out[i]) == expect6[i]);
+
+    out = Network::HappyEyeballs::Interleave(in, AF_INET);
+    const uint16_t expect4[] = {1, 3, 2, 4, 5};
+    for (size_t i = 0; i < out.size(); ++i) assert(PortOf(out[i]) == expect4[i]);
+
+    // 只有一个地址族：顺序不变
+    std::vector<Candidate> only4 = {LoopbackV4(7), LoopbackV4(8)};
+    out = Network::HappyEyeballs::Interleave(only4, AF_INET6);
+    assert(out.size() == 2 && PortOf(out[0]) == 7 && PortOf(out[1]) == 8);
+    assert(Network::HappyEyeballs::Interleave({}, AF_INET6).empty());
+}
+
+// 首选候选先连通：不发起后续候选
+static void TestFirstWins() {
+    uint16_t p1 = 0, p2 = 0;
+    SOCKET l1 = Listen(8, &p1);
+    SOCKET l2 = Listen(8, &p2);
+    g_connectCalls = 0;
+    RaceResult r;
+    assert(Network::HappyEyeballs::Race({LoopbackV4(p1), LoopbackV4(p2)}, 500, 3000, CountingConnect, CountingClose, &r));
+    assert(r.sock != INVALID_SOCKET && r.winnerIndex == 0 && r.attempts == 1);
+    assert(g_connectCalls == 1);
+    closesocket(r.sock);
+    closesocket(l1);
+    closesocket(l2);
+}
+
+// 首选候选被黑洞：错峰时间到后发起下一个候选，胜出后关闭仍在进行中的尝试
+static void TestStaggerAfterBlackhole() {
+    Blackhole hole;
+    if (!hole.Holds()) return;
+    uint16_t good = 0;
+    SOCKET l = Listen(8, &good);
+    g_connectCalls = 0;
+    g_closeCalls = 0;
+    RaceResult r;
+    const auto start = Clock::now();
+    assert(Network::HappyEyeballs::Race({LoopbackV4(hole.port), LoopbackV4(good)}, 100, 3000,
+                                        CountingConnect, CountingClose, &r));
+    const long long elapsed = MsSince(start);
+    assert(r.winnerIndex == 1 && r.attempts == 2);
+    assert(elapsed >= 90 && elapsed < 1000);
+    assert(g_connectCalls == 2 && g_closeCalls == 1);
+    closesocket(r.sock);
+    closesocket(l);
+}
+
+// 首选候选被拒绝：不等错峰时间，立即发起下一个候选
+static void TestFastFailover() {
+    uint16_t good = 0;
+    SOCKET l = Listen(8, &good);
+    RaceResult r;
+    const auto start = Clock::now();
+    assert(Network::HappyEyeballs::Race({LoopbackV4(RefusedPort()), LoopbackV4(good)}, 1000, 3000,
+                                        CountingConnect, CountingClose, &r));
+    assert(MsSince(start) < 500);
+    assert(r.winnerIndex == 1 && r.attempts == 2);
+    closesocket(r.sock);
+    closesocket(l);
+}
+
+// 全部失败：返回最后一个错误码
+static void TestAllFail() {
+    RaceResult r;
+    assert(!Network::HappyEyeballs::Race({LoopbackV4(RefusedPort()), LoopbackV4(RefusedPort())}, 100, 3000,
+                                         CountingConnect, CountingClose, &r));
+    assert(r.sock == INVALID_SOCKET && r.attempts == 2);
+    assert(r.lastError == WSAECONNREFUSED && WSAGetLastError() == WSAECONNREFUSED);
+    assert(!Network::HappyEyeballs::Race({}, 100, 3000, CountingConnect, CountingClose, &r));
+    assert(WSAGetLastError() == WSAEINVAL);
+}
+
+// 整体预算耗尽：WSAETIMEDOUT，在途尝试全部关闭
+static void TestTimeout() {
+    Blackhole hole;
+    if (!hole.Holds()) return;
+    g_closeCalls = 0;
+    RaceResult r;
+    const auto start = Clock::now();
+    assert(!Network::HappyEyeballs::Race({LoopbackV4(hole.port)}, 50, 200, CountingConnect, CountingClose, &r));
+    const long long elapsed = MsSince(start);
+    assert(elapsed >= 190 && elapsed < 1000);
+    assert(r.lastError == WSAETIMEDOUT && r.attempts == 1);
+    assert(g_closeCalls == 1);
+}
+
+int main() {
+#ifdef _WIN32
+    WSADATA wsa{};
+    const int wsaRc = WSAStartup(MAKEWORD(2, 2), &wsa);
+    assert(wsaRc == 0);
+    (void)wsaRc;
+#endif
+    TestInterleave();
+    TestFirstWins();
+    TestStaggerAfterBlackhole();
+    TestFastFailover();
+    TestAllFail();
+    TestTimeout();
+#ifdef _WIN32
+    WSACleanup();
+#endif
+    return 0;
+}
@@ -0,0 +1,96 @@
+#include <cassert>
+#include <atomic>
+#include <cstdint>
+#include <thread>
+#include <vector>
+
+#include "core/LogLimiter.hpp"
+
+using namespace Core;
+using Decision = LogRateLimiter::Decision;
+
+static const uint64_t kT0 = 1000000; // 单调毫秒（任意非零起点）
+
+// 突发用完后抑制；按速率补充令牌，而不是永久静默
+static void TestBurstAndRefill() {
+    static LogRateLimiter limiter("test.cpp:1", LogModule::Udp, LogLevel::Warn);
+    for (int i = 0; i < 5; ++i) assert(limiter.Acquire(kT0, 5, 6).allowed);
+    assert(!limiter.Acquire(kT0, 5, 6).allowed);
+    assert(!limiter.Acquire(kT0 + 9999, 5, 6).allowed); // 6 条/分钟：10 秒补 1 条
+    assert(limiter.Acquire(kT0 + 10000, 5, 6).allowed);
+    assert(!limiter.Acquire(kT0 + 10001, 5, 6).allowed);
+
+    // 高频调用不会让补充进度丢失（每次只差不到一个千分之一令牌）
+    uint64_t t = kT0 + 10001;
+    int allowed = 0;
+    for (int i = 0; i < 20000; ++i, ++t) allowed += limiter.Acquire(t, 5, 6).allowed ? 1 : 0;
+    assert(allowed == 1 || allowed == 2);
+
+    // 长时间空闲后最多恢复到突发上限
+    allowed = 0;
+    for (int i = 0; i < 10; ++i) allowed += limiter.Acquire(kT0 + 3600000, 5, 6).allowed ? 1 : 0;
+    assert(allowed == 5);
+}
+
+// 抑制计数每个汇总周期最多汇报一次，汇报后清零
+static void TestSummary() {
+    static LogRateLimiter limiter("test.cpp:2", LogModule::Route, LogLevel::Info);
+    assert(limiter.Acquire(kT0, 1, 0).allowed);
+    for (int i = 0; i < 7; ++i) {
+        const Decision d = limiter.Acquire(kT0 + 1000 + i, 1, 0);
+        assert(!d.allowed && d.suppressed == 0);
+    }
+    Decision d = limiter.Acquire(kT0 + LogRateLimiter::kSummaryIntervalMs, 1, 0);
+    assert(!d.allowed && d.suppressed == 8 && d.windowMs == LogRateLimiter::kSummaryIntervalMs);
+    d = limiter.Acquire(kT0 + LogRateLimiter::kSummaryIntervalMs + 1, 1, 0);
+    assert(d.suppressed == 0);
+
+    // 退出前强制汇报，不等周期；没有新抑制时不汇报
+    Decision out;
+    assert(limiter.TakeSummary(kT0 + LogRateLimiter::kSummaryIntervalMs + 5, true, &out) && out.suppressed == 1);
+    assert(!limiter.TakeSummary(kT0 + LogRateLimiter::kSummaryIntervalMs + 6, true, &out));
+}
+
+// 每个限流器独立计费，并都能在全局链表中找到
+static void TestRegistry() {
+    static LogRateLimiter a("test.cpp:3", LogModule::General, LogLevel::Warn);
+    static LogRateLimiter b("test.cpp:4", LogModule::General, LogLevel::Warn);
+    assert(a.Acquire(kT0, 1, 0).allowed && !a.Acquire(kT0, 1, 0).allowed);
+    assert(b.Acquire(kT0, 1, 0).allowed);
+    int found = 0;
+    LogRateLimiter::ForEach([&](LogRateLimiter& l) {
+        if (&l == &a || &l == &b) ++found;
+    });
+    assert(found == 2);
+}
+
+// 并发取令牌：放行数不超过突发上限，放行 + 汇报的抑制数 = 总调用数
+static void TestConcurrent() {
+    static LogRateLimiter limiter("test.cpp:5", LogModule::Udp, LogLevel::Warn);
+    std::atomic<uint64_t> allowed{0};
+    std::atomic<uint64_t> reported{0};
+    std::vector<std::thread> threads;
+    const int perThread = 50000;
+    for (int t = 0; t < 4; ++t) {
+        threads.emplace_back([&]() {
+            for (int i = 0; i < perThread; ++i) {
+                const Decision d = limiter.Acquire(kT0, 100, 0);
+                if (d.allowed) allowed.fetch_add(1);
+                reported.fetch_add(d.suppressed);
+            }
+        });
+    }
+    for (auto& t : threads) t.join();
+    Decision out;
+    if (limiter.TakeSummary(kT0, true, &out)) reported.fetch_add(out.suppressed);
+    assert(allowed.load() == 100);
+    assert(allowed.load() + reported.load() == 4ull * perThread);
+}
+
+int main() {
+    TestBurstAndRefill();
+    TestSummary();
+    TestRegistry();
+    TestConcurrent();
+    return 0;
+}
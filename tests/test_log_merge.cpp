@@ -0,0 +1,100 @@
+#include <cassert>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "core/LogMerge.hpp"
+
+using namespace Core;
+using LogMerge::Entry;
+
+// 与 Logger 相同格式的文本行（时间为本地时间，测试不依赖时区）
+static std::string TextLine(uint64_t tsUs, uint32_t pid, const char* msg) {
+    return "[" + BinLog::FormatTimestamp(tsUs) + "] [PID:" + std::to_string(pid) + "][TID:1] [信息] " + msg;
+}
+
+static std::vector<Entry> Text(const std::string& data) {
+    return LogMerge::ReadTextLog(data.data(), data.size());
+}
+
+static std::vector<std::string> MergeAll(const std::vector<std::vector<Entry>>& sources) {
+    std::vector<std::string> out;
+    LogMerge::Merge(sources, [&out](const Entry& e, size_t) { out.push_back(e.text); });
+    return out;
+}
+
+static const uint64_t kBase = 1767225600ull * 1000000; // 整秒
+
+static void TestParseTextLog() {
+    const std::string data = "orphan before first stamp\n" + TextLine(kBase, 42, "a") + "\r\n" +
+                             "  continuation line\n\n" + TextLine(kBase + 2000000, 42, "b") + "\n" +
+                             "[not a stamp] text\n" + TextLine(kBase + 3000000, 7, "c"); // 末行无换行
+    const auto entries = Text(data);
+    assert(entries.size() == 4);
+    assert(entries[0].tsUs == 0 && entries[0].text == "orphan before first stamp");
+    assert(entries[1].tsUs == (int64_t)kBase && entries[1].pid == 42);
+    assert(entries[1].text == TextLine(kBase, 42, "a") + "\n  continuation line");
+    assert(entries[2].tsUs == (int64_t)kBase + 2000000);
+    assert(entries[2].text == TextLine(kBase + 2000000, 42, "b") + "\n[not a stamp] text");
+    assert(entries[3].pid == 7 && entries[3].text == TextLine(kBase + 3000000, 7, "c"));
+
+    // 旧格式（无 PID）仍可解析时间戳
+    const auto noPid = Text("[2026-01-11 12:00:00] [信息] x\n");
+    assert(noPid.size() == 1 && noPid[0].pid == 0 && noPid[0].tsUs != 0);
+}
+
+// 多个进程的文本日志按时间交织；同一时间按来源顺序，来源内部顺序不变
+static void TestMergeText() {
+    const auto a = Text(TextLine(kBase, 1, "a0") + "\n" + TextLine(kBase + 2000000, 1, "a2") + "\n" +
+                        TextLine(kBase + 2000000, 1, "a2b") + "\n");
+    const auto b = Text(TextLine(kBase + 1000000, 2, "b1") + "\n" + TextLine(kBase + 2000000, 2, "b2") + "\n" +
+                        TextLine(kBase + 5000000, 2, "b5") + "\n");
+    const auto merged = MergeAll({a, b});
+    const std::vector<std::string> expect = {
+        TextLine(kBase, 1, "a0"),           TextLine(kBase + 1000000, 2, "b1"), TextLine(kBase + 2000000, 1, "a2"),
+        TextLine(kBase + 2000000, 1, "a2b"), TextLine(kBase + 2000000, 2, "b2"), TextLine(kBase + 5000000, 2, "b5"),
+    };
+    assert(merged == expect);
+
+    // 来源内部时间回退（多线程入队顺序与取时间戳顺序不同）时不重排
+    const auto c = Text(TextLine(kBase + 3000000, 3, "c3") + "\n" + TextLine(kBase + 1000000, 3, "c1") + "\n");
+    const auto m2 = MergeAll({c, b});
+    assert(m2.size() == 5 && m2[0] == TextLine(kBase + 1000000, 2, "b1"));
+    assert(m2[2] == TextLine(kBase + 3000000, 3, "c3") && m2[3] == TextLine(kBase + 1000000, 3, "c1"));
+
+    assert(MergeAll({}).empty() && MergeAll({{}, {}}).empty());
+}
+
+// 二进制与文本日志混合合并：二进制事件渲染为文本行，按微秒时间戳参与排序
+static void TestMergeBinary() {
+    StringInterner interner;
+    std::string file;
+    BinLog::AppendSessionHeader(file, &interner);
+    const std::string host = "api.example.com";
+    const auto args = MakeLogArgs((unsigned long long)5, LogHost(host), (uint16_t)443);
+    BinLog::AppendEventRecord(file, &interner, LogEvent::BypassLoopback, LogLevel::Debug, kBase + 500000, 9, 10,
+                              args.data(), args.size());
+    BinLog::AppendEventRecord(file, &interner, LogEvent::BypassLoopback, LogLevel::Debug, kBase + 1500000, 9, 10,
+                              args.data(), args.size());
+
+    const uint8_t* bytes = (const uint8_t*)file.data();
+    assert(LogMerge::IsBinaryLog(bytes, file.size()));
+    const std::string textFile = TextLine(kBase + 1000000, 1, "t1") + "\n";
+    assert(!LogMerge::IsBinaryLog((const uint8_t*)textFile.data(), textFile.size()));
+
+    BinLog::DecodeStats st;
+    const auto bin = LogMerge::ReadBinaryLog(bytes, file.size(), &st);
+    assert(st.events == 2 && bin.size() == 2 && bin[0].pid == 9 && bin[0].tsUs == (int64_t)kBase + 500000);
+    assert(bin[0].text.find("BYPASS(loopback): sock=5, target=api.example.com:443") != std::string::npos);
+
+    std::vector<uint32_t> pids;
+    LogMerge::Merge({Text(textFile), bin}, [&pids](const Entry& e, size_t) { pids.push_back(e.pid); });
+    assert((pids == std::vector<uint32_t>{9, 1, 9}));
+}
+
+int main() {
+    TestParseTextLog();
+    TestMergeText();
+    TestMergeBinary();
+    return 0;
+}
@@ -0,0 +1,99 @@
+#include <cassert>
+#include <atomic>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "core/LogEvents.hpp"
+
+using namespace Core;
+
+static_assert(IsLogLevelCompiledIn(LogLevel::Debug), "默认构建保留全部等级");
+static_assert(LogEventLevel(LogEvent::LogDropped) == LogLevel::Warn, "事件等级可在编译期取得");
+static_assert(LogEventModule(LogEvent::ConnectUdpRelay) == LogModule::Udp, "事件模块可在编译期取得");
+
+static void TestModuleNames() {
+    LogModule m = LogModule::General;
+    assert(TryParseLogModule("fakeip", &m) && m == LogModule::FakeIP);
+    assert(TryParseLogModule("SOCKS5", &m) && m == LogModule::Socks5);
+    assert(TryParseLogModule("Inject", &m) && m == LogModule::Inject);
+    assert(!TryParseLogModule("dns", &m) && m == LogModule::Inject); // 不识别时不修改
+    for (size_t i = 0; i < static_cast<size_t>(LogModule::Count); ++i) {
+        const LogModule module = static_cast<LogModule>(i);
+        assert(TryParseLogModule(LogModuleName(module), &m) && m == module);
+    }
+}
+
+// 编译期访问器与运行期事件目录一致
+static void TestEventCatalog() {
+    for (size_t i = 0; i < static_cast<size_t>(LogEvent::Count); ++i) {
+        const LogEvent ev = static_cast<LogEvent>(i);
+        assert(GetLogEventInfo(ev).level == LogEventLevel(ev));
+        assert(GetLogEventInfo(ev).module == LogEventModule(ev));
+    }
+}
+
+static void TestOverrides() {
+    LogLevelTable table(LogLevel::Info);
+    assert(!table.IsEnabled(LogModule::FakeIP, LogLevel::Debug));
+    assert(table.IsEnabled(LogModule::Socks5, LogLevel::Info));
+
+    // 只打开 FakeIP 的调试日志，不连带其他模块
+    table.SetModule(LogModule::FakeIP, LogLevel::Debug);
+    assert(table.IsEnabled(LogModule::FakeIP, LogLevel::Debug));
+    assert(!table.IsEnabled(LogModule::Socks5, LogLevel::Debug));
+    assert(!table.IsEnabled(LogModule::General, LogLevel::Debug));
+
+    // 模块可比全局更克制
+    table.SetModule(LogModule::Route, LogLevel::Warn);
+    assert(!table.IsEnabled(LogModule::Route, LogLevel::Info));
+    assert(table.IsEnabled(LogModule::Route, LogLevel::Warn));
+
+    // 全局等级变化不影响已覆盖的模块
+    table.SetGlobal(LogLevel::Error);
+    assert(table.Global() == LogLevel::Error);
+    assert(!table.IsEnabled(LogModule::Udp, LogLevel::Warn));
+    assert(table.Effective(LogModule::Route) == LogLevel::Warn);
+    assert(table.Effective(LogModule::FakeIP) == LogLevel::Debug);
+    assert(table.HasOverride(LogModule::FakeIP) && !table.HasOverride(LogModule::Udp));
+
+    table.ClearModule(LogModule::FakeIP);
+    assert(table.Effective(LogModule::FakeIP) == LogLevel::Error);
+    table.ClearAllModules();
+    assert(table.Effective(LogModule::Route) == LogLevel::Error && !table.HasOverride(LogModule::Route));
+}
+
+// 热路径读取与配置写入并发：读到的阈值只可能是新旧两值之一
+static void TestConcurrentReaders() {
+    LogLevelTable table(LogLevel::Info);
+    std::atomic<bool> stop{false};
+    std::atomic<bool> bad{false};
+    std::vector<std::thread> readers;
+    for (int t = 0; t < 4; ++t) {
+        readers.emplace_back([&]() {
+            while (!stop.load(std::memory_order_relaxed)) {
+                const LogLevel e = table.Effective(LogModule::Socks5);
+                if (e != LogLevel::Info && e != LogLevel::Debug) bad.store(true);
+                (void)table.IsEnabled(LogModule::Udp, LogLevel::Debug);
+            }
+        });
+    }
+    for (int i = 0; i < 2000; ++i) {
+        if (i & 1) {
+            table.SetModule(LogModule::Socks5, LogLevel::Debug);
+        } else {
+            table.ClearAllModules();
+        }
+    }
+    stop.store(true);
+    for (auto& r : readers) r.join();
+    assert(!bad.load());
+}
+
+int main() {
+    TestModuleNames();
+    TestEventCatalog();
+    TestOverrides();
+    TestConcurrentReaders();
+    return 0;
+}
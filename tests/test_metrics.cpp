@@ -0,0 +1,248 @@
+#include <cassert>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "core/Metrics.hpp"
+#include "network/MetricsServer.hpp"
+
+using Core::LatencyHistogram;
+using Core::PrometheusText;
+using Network::MetricsServer;
+
+static bool Contains(const std::string& text, const std::string& needle) {
+    return text.find(needle) != std::string::npos;
+}
+
+// 多线程累加：总量精确
+static void TestShardedCounter() {
+    Core::ShardedCounter<4> counter;
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 6; ++t) {
+        threads.emplace_back([&]() {
+            for (int i = 0; i < 50000; ++i) counter.Add();
+        });
+    }
+    for (auto& th : threads) th.join();
+    counter.Add(7);
+    assert(counter.Value() == 6ull * 50000 + 7);
+}
+
+// 桶归属（边界值计入该桶）、累计计数与 +Inf
+static void TestHistogram() {
+    LatencyHistogram h;
+    h.Observe(0);
+    h.Observe(1000);     // = 1ms 边界
+    h.Observe(1001);     // 5ms 桶
+    h.Observe(300000);   // 500ms 桶
+    h.Observe(60000000); // 超出最后一个边界
+    const auto s = h.Read();
+    assert(s.count == 5);
+    assert(s.sumUs == 0 + 1000 + 1001 + 300000 + 60000000);
+    assert(s.cumulative[0] == 2);
+    assert(s.cumulative[1] == 3);
+    assert(s.cumulative[6] == 3);
+    assert(s.cumulative[7] == 4);
+    assert(s.cumulative[LatencyHistogram::kBuckets - 1] == 4);
+
+    Core::LabeledHistograms labeled;
+    labeled.Get("socks5://127.0.0.1:7890").Observe(2000);
+    labeled.Get("socks5://127.0.0.1:7890").Observe(3000);
+    for (size_t i = 0; i < Core::LabeledHistograms::kMaxSeries + 3; ++i) {
+        labeled.Get("p" + std::to_string(i)).Observe(1);
+    }
+    const auto series = labeled.Read();
+    assert(series.size() == Core::LabeledHistograms::kMaxSeries + 1);
+    bool sawProxy = false;
+    for (const auto& kv : series) {
+        if (kv.first == "socks5://127.0.0.1:7890") sawProxy = kv.second.count == 2;
+    }
+    assert(sawProxy);
+}
+
+// 文本格式：HELP/TYPE、标签转义、直方图序列
+static void TestPrometheusText() {
+    PrometheusText text;
+    text.Family("agp_connects_total", "counter", "按路由动作统计的连接数\n第二行");
+    text.Sample("agp_connects_total", {{"action", "proxy"}, {"reason", "rule"}}, (uint64_t)3);
+    text.Sample("agp_connects_total", {{"action", "we\"ird\\x\ny"}}, (uint64_t)1);
+    text.Family("agp_up", "gauge", "up");
+    text.Sample("agp_up", {}, (uint64_t)1);
+    text.Family("agp_ratio", "gauge", "ratio");
+    text.Sample("agp_ratio", {}, 0.25);
+
+    LatencyHistogram h;
+    h.Observe(2000);
+    h.Observe(20000);
+    text.Family("agp_handshake_seconds", "histogram", "握手耗时");
+    text.Histogram("agp_handshake_seconds", {{"proxy", "http://p:8080"}}, h.Read());
+    text.Family("agp_conn_stage_seconds", "summary", "阶段耗时");
+    text.Summary("agp_conn_stage_seconds", {{"stage", "dns"}}, {{0.5, 0.002}, {0.999, 1.5}}, 3.25, 7);
+
+    const std::string out = text.Take();
+    assert(Contains(out, "# HELP agp_connects_total 按路由动作统计的连接数\\n第二行\n"));
+    assert(Contains(out, "# TYPE agp_connects_total counter\n"));
+    assert(Contains(out, "agp_connects_total{action=\"proxy\",reason=\"rule\"} 3\n"));
+    assert(Contains(out, "agp_connects_total{action=\"we\\\"ird\\\\x\\ny\"} 1\n"));
+    assert(Contains(out, "\nagp_up 1\n"));
+    assert(Contains(out, "\nagp_ratio 0.250000\n"));
+    assert(Contains(out, "agp_handshake_seconds_bucket{proxy=\"http://p:8080\",le=\"0.001\"} 0\n"));
+    assert(Contains(out, "agp_handshake_seconds_bucket{proxy=\"http://p:8080\",le=\"0.005\"} 1\n"));
+    assert(Contains(out, "agp_handshake_seconds_bucket{proxy=\"http://p:8080\",le=\"0.025\"} 2\n"));
+    assert(Contains(out, "agp_handshake_seconds_bucket{proxy=\"http://p:8080\",le=\"10\"} 2\n"));
+    assert(Contains(out, "agp_handshake_seconds_bucket{proxy=\"http://p:8080\",le=\"+Inf\"} 2\n"));
+    assert(Contains(out, "agp_handshake_seconds_sum{proxy=\"http://p:8080\"} 0.022000\n"));
+    assert(Contains(out, "agp_handshake_seconds_count{proxy=\"http://p:8080\"} 2\n"));
+    assert(Contains(out, "# TYPE agp_conn_stage_seconds summary\n"));
+    assert(Contains(out, "agp_conn_stage_seconds{stage=\"dns\",quantile=\"0.5\"} 0.002000\n"));
+    assert(Contains(out, "agp_conn_stage_seconds{stage=\"dns\",quantile=\"0.999\"} 1.500000\n"));
+    assert(Contains(out, "agp_conn_stage_seconds_sum{stage=\"dns\"} 3.250000\n"));
+    assert(Contains(out, "agp_conn_stage_seconds_count{stage=\"dns\"} 7\n"));
+}
+
+static void TestParseRequestLine() {
+    Network::HttpRequestLine req;
+    assert(Network::ParseHttpRequestLine("GET /metrics HTTP/1.1\r\nHost: x\r\n\r\n", &req));
+    assert(req.method == "GET" && req.path == "/metrics");
+    assert(Network::ParseHttpRequestLine("HEAD /metrics?x=1 HTTP/1.0\r\n\r\n", &req));
+    assert(req.method == "HEAD" && req.path == "/metrics");
+    assert(!Network::ParseHttpRequestLine("GET /metrics\r\n\r\n", &req));
+    assert(!Network::ParseHttpRequestLine("GET  HTTP/1.1\r\n\r\n", &req));
+    assert(!Network::ParseHttpRequestLine("GET metrics HTTP/1.1\r\n\r\n", &req));
+    assert(!Network::ParseHttpRequestLine("\x16\x03\x01\x02\x00", &req));
+}
+
+// 发送原始请求并读到对端关闭
+static std::string Fetch(uint16_t port, const std::string& request) {
+    SOCKET s = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+    assert(s != INVALID_SOCKET);
+    sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    addr.sin_port = htons(port);
+    assert(connect(s, (const sockaddr*)&addr, sizeof(addr)) == 0);
+    if (!request.empty()) assert(send(s, request.data(), (int)request.size(), 0) == (int)request.size());
+    std::string out;
+    char buf[4096];
+    for (;;) {
+        const int n = (int)recv(s, buf, (int)sizeof(buf), 0);
+        if (n <= 0) break;
+        out.append(buf, (size_t)n);
+    }
+    closesocket(s);
+    return out;
+}
+
+static void TestServerRoundTrip() {
+    std::atomic<int> renders{0};
+    auto server = std::make_shared<MetricsServer>();
+    server->AddPage("/trace", "application/json", []() { return std::string("{\"traceEvents\":[]}"); });
+    const bool started = server->Start(0, 1, [&]() {
+        renders.fetch_add(1);
+        PrometheusText text;
+        text.Family("agp_up", "gauge", "up");
+        text.Sample("agp_up", {}, (uint64_t)1);
+        return text.Take();
+    });
+    assert(started);
+    assert(server->Port() != 0);
+
+    const std::string ok = Fetch(server->Port(), "GET /metrics HTTP/1.1\r\nHost: 127.0.0.1\r\n\r\n");
+    assert(ok.compare(0, 15, "HTTP/1.1 200 OK") == 0);
+    assert(Contains(ok, "Content-Type: text/plain; version=0.0.4"));
+    assert(Contains(ok, "Content-Length: " + std::to_string(strlen("# HELP agp_up up\n# TYPE agp_up gauge\nagp_up 1\n"))));
+    assert(Contains(ok, "\r\n\r\n# HELP agp_up up\n# TYPE agp_up gauge\nagp_up 1\n"));
+
+    // 请求头分多次到达
+    {
+        SOCKET s = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+        sockaddr_in addr{};
+        addr.sin_family = AF_INET;
+        addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        addr.sin_port = htons(server->Port());
+        assert(connect(s, (const sockaddr*)&addr, sizeof(addr)) == 0);
+        assert(send(s, "GET /met", 8, 0) == 8);
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        assert(send(s, "rics HTTP/1.1\r\n\r\n", 17, 0) == 17);
+        std::string out;
+        char buf[1024];
+        int n;
+        while ((n = (int)recv(s, buf, (int)sizeof(buf), 0)) > 0) out.append(buf, (size_t)n);
+        closesocket(s);
+        assert(out.compare(0, 15, "HTTP/1.1 200 OK") == 0);
+    }
+
+    const std::string head = Fetch(server->Port(), "HEAD /metrics HTTP/1.1\r\n\r\n");
+    assert(head.compare(0, 15, "HTTP/1.1 200 OK") == 0);
+    assert(head.size() >= 4 && head.compare(head.size() - 4, 4, "\r\n\r\n") == 0);
+
+    // 附加页面：不计入抓取次数；Start 之后不再接受新页面
+    const std::string page = Fetch(server->Port(), "GET /trace HTTP/1.1\r\n\r\n");
+    assert(page.compare(0, 15, "HTTP/1.1 200 OK") == 0);
+    assert(Contains(page, "Content-Type: application/json\r\n"));
+    assert(Contains(page, "\r\n\r\n{\"traceEvents\":[]}"));
+    server->AddPage("/late", "text/plain", []() { return std::string("late"); });
+    assert(Fetch(server->Port(), "GET /late HTTP/1.1\r\n\r\n").compare(0, 12, "HTTP/1.1 404") == 0);
+
+    assert(Fetch(server->Port(), "GET / HTTP/1.1\r\n\r\n").compare(0, 12, "HTTP/1.1 404") == 0);
+    assert(Fetch(server->Port(), "POST /metrics HTTP/1.1\r\n\r\n").compare(0, 12, "HTTP/1.1 405") == 0);
+    assert(Fetch(server->Port(), "garbage\r\n\r\n").empty());
+
+    const auto stats = server->GetStats();
+    assert(stats.scrapes == 3 && stats.requests == 7 && stats.rejected == 1);
+    assert(renders.load() == 3);
+
+    // 停止后线程退出并关闭监听 socket
+    server->Stop(2000);
+    SOCKET s = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+    sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    addr.sin_port = htons(server->Port());
+    assert(connect(s, (const sockaddr*)&addr, sizeof(addr)) != 0);
+    closesocket(s);
+}
+
+// 首选端口被占用时顺延到下一个端口；范围内全部占用则失败
+static void TestPortFallback() {
+    auto first = std::make_shared<MetricsServer>();
+    assert(first->Start(0, 1, []() { return std::string(); }));
+    const uint16_t busy = first->Port();
+
+    auto second = std::make_shared<MetricsServer>();
+    if (busy < 65535) {
+        if (second->Start(busy, 2, []() { return std::string("x"); })) {
+            assert(second->Port() == busy + 1);
+            second->Stop(2000);
+        }
+        // busy+1 恰好被其他进程占用时 Start 失败，不视为测试失败
+    }
+
+    auto third = std::make_shared<MetricsServer>();
+    assert(!third->Start(busy, 1, []() { return std::string(); }));
+    first->Stop(2000);
+}
+
+int main() {
+#ifdef _WIN32
+    WSADATA wsa{};
+    const int wsaRc = WSAStartup(MAKEWORD(2, 2), &wsa);
+    assert(wsaRc == 0);
+    (void)wsaRc;
+#endif
+    TestShardedCounter();
+    TestHistogram();
+    TestPrometheusText();
+    TestParseRequestLine();
+    TestServerRoundTrip();
+    TestPortFallback();
+#ifdef _WIN32
+    WSACleanup();
+#endif
+    return 0;
+}
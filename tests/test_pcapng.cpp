@@ -0,0 +1,305 @@
+#include <cassert>
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "network/Pcapng.hpp"
+
+using namespace Network;
+
+// 最小的 pcapng 读取器：按块解析，校验首尾长度一致
+struct Block {
+    uint32_t type;
+    std::string body; // 不含类型与首尾长度
+};
+
+static uint32_t Le32(const std::string& s, size_t off) {
+    return (uint32_t)(uint8_t)s[off] | ((uint32_t)(uint8_t)s[off + 1] << 8) |
+           ((uint32_t)(uint8_t)s[off + 2] << 16) | ((uint32_t)(uint8_t)s[off + 3] << 24);
+}
+
+static uint16_t Be16(const std::string& s, size_t off) {
+    return (uint16_t)(((uint8_t)s[off] << 8) | (uint8_t)s[off + 1]);
+}
+
+static uint32_t Be32(const std::string& s, size_t off) {
+    return ((uint32_t)Be16(s, off) << 16) | Be16(s, off + 2);
+}
+
+static std::vector<Block> ParseBlocks(const std::string& file) {
+    std::vector<Block> blocks;
+    size_t off = 0;
+    while (off < file.size()) {
+        assert(off + 12 <= file.size());
+        const uint32_t type = Le32(file, off);
+        const uint32_t len = Le32(file, off + 4);
+        assert(len % 4 == 0 && len >= 12 && off + len <= file.size());
+        assert(Le32(file, off + len - 4) == len);
+        blocks.push_back(Block{type, file.substr(off + 8, len - 12)});
+        off += len;
+    }
+    return blocks;
+}
+
+// 反码求和校验：包含校验和字段在内的和应为 0xFFFF
+static uint16_t OnesSum(const std::string& s, size_t off, size_t len, uint32_t sum = 0) {
+    for (size_t i = 0; i + 1 < len; i += 2) sum += Be16(s, off + i);
+    if (len & 1) sum += (uint32_t)((uint8_t)s[off + len - 1] << 8);
+    while (sum >> 16) sum = (sum & 0xFFFF) + (sum >> 16);
+    return (uint16_t)sum;
+}
+
+struct Packet {
+    uint32_t caplen;
+    uint32_t origlen;
+    std::string data;
+};
+
+static std::vector<Packet> Packets(const std::vector<Block>& blocks) {
+    std::vector<Packet> out;
+    for (const Block& b : blocks) {
+        if (b.type != 6) continue;
+        const uint32_t caplen = Le32(b.body, 12);
+        out.push_back(Packet{caplen, Le32(b.body, 16), b.body.substr(20, caplen)});
+    }
+    return out;
+}
+
+static CaptureEndpoint V4(uint32_t ip, uint16_t port) {
+    CaptureEndpoint ep;
+    ep.family = 4;
+    ep.addr[0] = (uint8_t)(ip >> 24);
+    ep.addr[1] = (uint8_t)(ip >> 16);
+    ep.addr[2] = (uint8_t)(ip >> 8);
+    ep.addr[3] = (uint8_t)ip;
+    ep.port = port;
+    return ep;
+}
+
+template <typename Ring>
+static void PushOpen(Ring& ring, uint64_t flow, const CaptureFlowInfo& info, uint64_t ts) {
+    uint8_t buf[kCaptureFlowInfoMaxBytes];
+    CaptureRecord rec;
+    rec.type = CaptureRecordType::FlowOpen;
+    rec.flow = flow;
+    rec.tsUs = ts;
+    rec.capLen = (uint32_t)SerializeCaptureFlowInfo(info, buf);
+    const CaptureSegment seg{buf, rec.capLen};
+    assert(ring.TryPush(rec, &seg, 1));
+}
+
+template <typename Ring>
+static bool PushData(Ring& ring, uint64_t flow, CaptureDirection dir, const CaptureSegment* segs, size_t count,
+                     uint32_t bytes, uint32_t snap, uint64_t ts) {
+    CaptureRecord rec;
+    rec.flow = flow;
+    rec.dir = dir;
+    rec.tsUs = ts;
+    rec.origLen = bytes;
+    rec.capLen = bytes < snap ? bytes : snap;
+    return ring.TryPush(rec, segs, count);
+}
+
+template <typename Ring>
+static void DrainInto(Ring& ring, PcapngWriter& writer, std::string* out) {
+    while (ring.Consume([&](const CaptureRecord& rec, const uint8_t* payload) { writer.Append(rec, payload, out); })) {
+    }
+}
+
+// TCP 流：握手 + 分散缓冲区发送 + 截断接收 + FIN；序号、长度与校验和均可被标准工具接受
+static std::string TestTcpFlow() {
+    CaptureRing<8, 512> ring;
+    PcapngWriter writer(64);
+    std::string file;
+    writer.BeginSection(&file);
+
+    CaptureFlowInfo info;
+    info.proto = 6;
+    info.local = V4(0xC0A80002, 50000); // 192.168.0.2:50000
+    info.remote.port = 443;             // 域名目标：占位地址 + NRB
+    info.host = "api.example.com";
+    PushOpen(ring, 100, info, 1000);
+
+    const char part1[] = "GET / HTTP/1.1\r\n";
+    const char part2[] = "Host: api.example.com\r\n\r\n";
+    const CaptureSegment segs[2] = {{part1, sizeof(part1) - 1}, {part2, sizeof(part2) - 1}};
+    const uint32_t sendLen = (uint32_t)(sizeof(part1) - 1 + sizeof(part2) - 1);
+    assert(PushData(ring, 100, CaptureDirection::Send, segs, 2, sendLen, 64, 1001));
+
+    std::string reply(300, 'r');
+    const CaptureSegment rseg{reply.data(), reply.size()};
+    assert(PushData(ring, 100, CaptureDirection::Recv, &rseg, 1, (uint32_t)reply.size(), 64, 1002));
+
+    CaptureRecord close;
+    close.type = CaptureRecordType::FlowClose;
+    close.flow = 100;
+    close.tsUs = 1003;
+    assert(ring.TryPush(close, nullptr, 0));
+
+    DrainInto(ring, writer, &file);
+    writer.AppendStatistics(1004, writer.PacketsWritten(), 0, &file);
+    assert(writer.FlowCount() == 0);
+
+    const auto blocks = ParseBlocks(file);
+    assert(blocks[0].type == 0x0A0D0D0A && Le32(blocks[0].body, 0) == 0x1A2B3C4D);
+    assert(blocks[1].type == 1 && (Le32(blocks[1].body, 0) & 0xFFFF) == PcapngWriter::kLinkTypeRaw);
+    assert(blocks[2].type == 4); // NRB 先于使用占位地址的报文
+    assert(blocks[2].body.find("api.example.com") != std::string::npos);
+    assert(blocks.back().type == 5);
+
+    const auto packets = Packets(blocks);
+    assert(packets.size() == 7); // SYN, SYN/ACK, ACK, 请求, 响应, FIN, ACK
+    for (const Packet& p : packets) {
+        assert(p.data[0] == 0x45);
+        assert(Be16(p.data, 2) == p.origlen);   // IP 总长度为完整长度
+        assert(OnesSum(p.data, 0, 20) == 0xFFFF); // IPv4 头校验和
+        assert((uint8_t)p.data[9] == 6);
+    }
+    const uint32_t remote = Be32(packets[0].data, 16);
+    assert((remote >> 28) == 0xF);
+    assert(Be16(packets[0].data, 20) == 50000 && Be16(packets[0].data, 22) == 443);
+    assert((uint8_t)packets[0].data[33] == 0x02 && (uint8_t)packets[1].data[33] == 0x12);
+
+    // 请求：完整负载，TCP 校验和有效，序号 1
+    const Packet& req = packets[3];
+    assert(req.caplen == 40 + sendLen && req.data.substr(40) == std::string(part1) + part2);
+    assert(Be32(req.data, 24) == 1 && Be32(req.data, 28) == 1);
+    const uint32_t tcpLen = req.origlen - 20;
+    const uint32_t pseudo = OnesSum(req.data, 12, 8) + 6 + tcpLen;
+    assert(OnesSum(req.data, 20, tcpLen, pseudo) == 0xFFFF);
+
+    // 响应：截断到 snaplen，origlen 保留完整长度；方向相反，确认号推进到请求之后
+    const Packet& resp = packets[4];
+    assert(resp.caplen == 40 + 64 && resp.origlen == 40 + 300);
+    assert(Be32(resp.data, 12) == remote && Be16(resp.data, 20) == 443);
+    assert(Be32(resp.data, 24) == 1 && Be32(resp.data, 28) == 1 + sendLen);
+
+    // FIN 的序号在请求之后
+    assert((uint8_t)packets[5].data[33] == 0x11 && Be32(packets[5].data, 24) == 1 + sendLen);
+    return file;
+}
+
+// UDP（IPv6）流：无握手，UDP 长度与校验和正确；未知流的数据被跳过
+static void TestUdpV6AndUnknownFlow() {
+    CaptureRing<8, 512> ring;
+    PcapngWriter writer(256);
+    std::string file;
+    writer.BeginSection(&file);
+
+    CaptureFlowInfo info;
+    info.proto = 17;
+    info.local.family = 6;
+    info.local.addr[15] = 2;
+    info.local.port = 5353;
+    info.remote.family = 6;
+    info.remote.addr[0] = 0x20;
+    info.remote.addr[1] = 0x01;
+    info.remote.addr[15] = 9;
+    info.remote.port = 443;
+    PushOpen(ring, 7, info, 10);
+
+    const char dgram[] = "quic-initial";
+    const CaptureSegment seg{dgram, sizeof(dgram) - 1};
+    assert(PushData(ring, 7, CaptureDirection::Send, &seg, 1, (uint32_t)seg.len, 256, 11));
+    assert(PushData(ring, 8, CaptureDirection::Send, &seg, 1, (uint32_t)seg.len, 256, 12)); // 没有 FlowOpen
+    DrainInto(ring, writer, &file);
+
+    const auto packets = Packets(ParseBlocks(file));
+    assert(packets.size() == 1);
+    const Packet& p = packets[0];
+    assert((uint8_t)p.data[0] == 0x60 && (uint8_t)p.data[6] == 17);
+    assert(Be16(p.data, 4) == 8 + seg.len && Be16(p.data, 44) == 8 + seg.len);
+    const uint32_t udpLen = 8 + (uint32_t)seg.len;
+    const uint32_t pseudo = OnesSum(p.data, 8, 32) + 17 + udpLen;
+    assert(OnesSum(p.data, 40, udpLen, pseudo) == 0xFFFF);
+}
+
+// 超过单个 IP 报文上限的发送拆分为多个报文，序号连续
+static void TestLargeSendSplit() {
+    CaptureRing<4, 512> ring;
+    PcapngWriter writer(32);
+    std::string file;
+    CaptureFlowInfo info;
+    info.local = V4(0x0A000001, 1000);
+    info.remote = V4(0x0A000002, 80);
+    PushOpen(ring, 1, info, 1);
+    std::string big(32, 'b');
+    const CaptureSegment seg{big.data(), big.size()};
+    assert(PushData(ring, 1, CaptureDirection::Send, &seg, 1, 200000, 32, 2));
+    DrainInto(ring, writer, &file);
+
+    const auto packets = Packets(ParseBlocks(file));
+    assert(packets.size() == 3 + 4); // 握手 + ceil(200000 / kMaxSegmentPayload)
+    uint32_t expectSeq = 1;
+    uint64_t total = 0;
+    for (size_t i = 3; i < packets.size(); ++i) {
+        assert(Be32(packets[i].data, 24) == expectSeq);
+        const uint32_t payload = packets[i].origlen - 40;
+        expectSeq += payload;
+        total += payload;
+    }
+    assert(total == 200000);
+    assert(packets[3].caplen == 40 + 32 && packets[4].caplen == 40);
+}
+
+// 环满时 TryPush 失败（由调用方计入丢弃），消费后可继续写入；多生产者写入不丢记录
+static void TestRingConcurrent() {
+    static CaptureRing<64, 512> ring;
+    const char payload[16] = "0123456789abcde";
+    const CaptureSegment seg{payload, sizeof(payload)};
+    std::vector<std::thread> producers;
+    std::vector<uint64_t> pushed(4, 0);
+    std::atomic<int> running{4};
+    for (int t = 0; t < 4; ++t) {
+        producers.emplace_back([&, t]() {
+            for (int i = 0; i < 20000; ++i) {
+                if (PushData(ring, (uint64_t)t + 1, CaptureDirection::Send, &seg, 1, 16, 16, (uint64_t)i)) ++pushed[t];
+            }
+            running.fetch_sub(1);
+        });
+    }
+    uint64_t consumed = 0;
+    bool intact = true;
+    auto consume = [&]() {
+        return ring.Consume([&](const CaptureRecord& rec, const uint8_t* data) {
+            intact = intact && rec.capLen == 16 && memcmp(data, payload, 16) == 0;
+            ++consumed;
+        });
+    };
+    while (running.load() > 0) {
+        if (!consume()) std::this_thread::yield();
+    }
+    for (auto& th : producers) th.join();
+    while (consume()) {
+    }
+    assert(intact);
+    assert(consumed == pushed[0] + pushed[1] + pushed[2] + pushed[3]);
+}
+
+int main(int argc, char** argv) {
+    const std::string file = TestTcpFlow();
+    TestUdpV6AndUnknownFlow();
+    TestLargeSendSplit();
+    TestRingConcurrent();
+
+    // 写出样例文件；系统装有 tcpdump 时用它读回（可传入路径后用 Wireshark 打开人工查看）
+    const std::string path = argc > 1 ? argv[1] : "test_pcapng_sample.pcapng";
+    {
+        std::ofstream out(path, std::ios::binary | std::ios::trunc);
+        out.write(file.data(), (std::streamsize)file.size());
+        assert(out.good());
+    }
+#ifndef _WIN32
+    if (std::system("command -v tcpdump >/dev/null 2>&1") == 0) {
+        const std::string cmd = "tcpdump -nr '" + path + "' >/dev/null 2>&1";
+        assert(std::system(cmd.c_str()) == 0);
+    }
+#endif
+    return 0;
+}
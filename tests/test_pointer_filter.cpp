@@ -0,0 +1,65 @@
+#include <cassert>
+#include <cstdint>
+#include <thread>
+#include <vector>
+
+#include "network/PointerFilter.hpp"
+
+using Network::PointerFilter;
+
+static void TestBasic() {
+    PointerFilter<64> filter;
+    int a = 0, b = 0;
+    assert(!filter.MayContain(&a));
+    assert(!filter.MayContain(nullptr));
+    filter.Add(&a);
+    assert(filter.MayContain(&a));
+    filter.Add(&a); // 计数型：重复登记需对应次数的 Remove
+    filter.Remove(&a);
+    assert(filter.MayContain(&a));
+    filter.Remove(&a);
+    assert(!filter.MayContain(&a));
+
+    filter.Add(&b);
+    filter.Clear();
+    assert(!filter.MayContain(&b));
+}
+
+// 单槽位：所有指针冲突，只会产生假阳性，不会产生假阴性
+static void TestCollision() {
+    PointerFilter<1> filter;
+    int a = 0, b = 0;
+    filter.Add(&a);
+    assert(filter.MayContain(&b));
+    filter.Add(&b);
+    filter.Remove(&a);
+    assert(filter.MayContain(&b));
+    filter.Remove(&b);
+    assert(!filter.MayContain(&a) && !filter.MayContain(&b));
+}
+
+// 并发：各线程登记/摘除自己的指针，登记期间必须可见
+static void TestConcurrent() {
+    PointerFilter<16> filter;
+    std::vector<std::thread> threads;
+    std::vector<uint64_t> objs(8 * 8);
+    for (int t = 0; t < 8; ++t) {
+        threads.emplace_back([&filter, &objs, t]() {
+            const void* p = &objs[(size_t)t * 8];
+            for (int i = 0; i < 100000; ++i) {
+                filter.Add(p);
+                assert(filter.MayContain(p));
+                filter.Remove(p);
+            }
+        });
+    }
+    for (auto& th : threads) th.join();
+    for (size_t i = 0; i < objs.size(); i += 8) assert(!filter.MayContain(&objs[i]));
+}
+
+int main() {
+    TestBasic();
+    TestCollision();
+    TestConcurrent();
+    return 0;
+}
@@ -0,0 +1,162 @@
+#include <cassert>
+#include <cstdint>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "network/RoutePreference.hpp"
+
+using Network::RouteChoice;
+using Network::RoutePreferenceOptions;
+using Network::RoutePreferenceTable;
+
+static const uint64_t kHour = 3600ull * 1000;
+
+static RoutePreferenceOptions Options(size_t maxEntries = 4096) {
+    RoutePreferenceOptions o;
+    o.halfLifeMs = 24 * kHour;
+    o.maxEntries = maxEntries;
+    return o;
+}
+
+// 首次探测结果即生效；主机名大小写与结尾的点不区分
+static void TestLearn() {
+    RoutePreferenceTable t(Options());
+    const uint64_t now = 1000 * kHour;
+    assert(t.Decide("cn.example.com", now) == RouteChoice::Probe);
+    t.Record("CN.Example.com.", RouteChoice::Direct, now);
+    assert(t.Decide("cn.example.com", now) == RouteChoice::Direct);
+    t.Record("blocked.example.org", RouteChoice::Proxy, now);
+    assert(t.Decide("blocked.example.org", now) == RouteChoice::Proxy);
+    assert(t.Decide("other.example.org", now) == RouteChoice::Probe);
+    t.Record("", RouteChoice::Direct, now);
+    t.Record("x.example", RouteChoice::Probe, now);
+    assert(t.GetStats().entries == 2);
+    assert(t.GetStats().directUpdates == 1 && t.GetStats().proxyUpdates == 1);
+}
+
+// 半衰期衰减：约 1 个半衰期后回到探测；多次同向结果延长有效期
+static void TestDecay() {
+    RoutePreferenceTable t(Options());
+    const uint64_t now = 1000 * kHour;
+    t.Record("a.example", RouteChoice::Direct, now);
+    int32_t score = 0;
+    assert(t.Score("a.example", now, &score) && score == 500);
+    assert(t.Score("a.example", now + 24 * kHour, &score) && score == 250);
+    assert(t.Decide("a.example", now + kHour) == RouteChoice::Probe); // 500 开始衰减即低于阈值
+
+    t.Record("b.example", RouteChoice::Direct, now);
+    t.Record("b.example", RouteChoice::Direct, now);
+    t.Record("b.example", RouteChoice::Direct, now);
+    assert(t.Score("b.example", now, &score) && score == 875);
+    assert(t.Decide("b.example", now + 12 * kHour) == RouteChoice::Direct);
+    assert(t.Decide("b.example", now + 24 * kHour) == RouteChoice::Probe);
+
+    // 时钟回拨不放大分数
+    assert(t.Score("b.example", now - kHour, &score) && score == 875);
+}
+
+// 学习为直连后一次失败即退回探测，再失败则偏向代理
+static void TestFailureFeedback() {
+    RoutePreferenceTable t(Options());
+    const uint64_t now = 1000 * kHour;
+    for (int i = 0; i < 8; ++i) t.Record("flaky.example", RouteChoice::Direct, now);
+    assert(t.Decide("flaky.example", now) == RouteChoice::Direct);
+    t.Record("flaky.example", RouteChoice::Proxy, now);
+    assert(t.Decide("flaky.example", now) == RouteChoice::Probe);
+    t.Record("flaky.example", RouteChoice::Proxy, now);
+    assert(t.Decide("flaky.example", now) == RouteChoice::Proxy);
+}
+
+// 条目上限：淘汰最久未更新的条目
+static void TestEviction() {
+    RoutePreferenceTable t(Options(3));
+    const uint64_t now = 1000 * kHour;
+    t.Record("a", RouteChoice::Direct, now + 1);
+    t.Record("b", RouteChoice::Direct, now + 2);
+    t.Record("c", RouteChoice::Direct, now + 3);
+    t.Record("a", RouteChoice::Direct, now + 4); // 已有条目：不淘汰
+    assert(t.GetStats().entries == 3 && t.GetStats().evictions == 0);
+    t.Record("d", RouteChoice::Proxy, now + 5);
+    assert(t.GetStats().entries == 3 && t.GetStats().evictions == 1);
+    assert(t.Decide("b", now + 5) == RouteChoice::Probe);
+    assert(t.Decide("a", now + 5) == RouteChoice::Direct);
+    assert(t.Decide("d", now + 5) == RouteChoice::Proxy);
+}
+
+// 序列化往返；合并时以更新时间较新者为准；无效行与已衰减的条目跳过
+static void TestSerialize() {
+    const uint64_t now = 1000 * kHour;
+    RoutePreferenceTable a(Options());
+    a.Record("direct.example", RouteChoice::Direct, now);
+    a.Record("proxy.example", RouteChoice::Proxy, now);
+    a.Record("stale.example", RouteChoice::Direct, now - 24 * 10 * kHour); // 10 个半衰期前
+    const std::string text = a.Serialize(now);
+    assert(text.find("direct.example\t500\t") != std::string::npos);
+    assert(text.find("proxy.example\t-500\t") != std::string::npos);
+    assert(text.find("stale.example") == std::string::npos);
+
+    RoutePreferenceTable b(Options());
+    assert(b.Load(text, now) == 2);
+    assert(b.Decide("direct.example", now) == RouteChoice::Direct);
+    assert(b.Decide("proxy.example", now) == RouteChoice::Proxy);
+
+    // 本地更新较新：文件中的旧结论不覆盖
+    b.Record("direct.example", RouteChoice::Proxy, now + 10);
+    b.Record("direct.example", RouteChoice::Proxy, now + 10);
+    assert(b.Load(text, now + 10) == 0);
+    assert(b.Decide("direct.example", now + 10) == RouteChoice::Proxy);
+
+    // 文件较新：采纳
+    RoutePreferenceTable c(Options());
+    c.Record("proxy.example", RouteChoice::Direct, now - kHour);
+    assert(c.Load(text, now) == 2);
+    assert(c.Decide("proxy.example", now) == RouteChoice::Proxy);
+
+    const std::string junk =
+        "# comment\n"
+        "\n"
+        "ok.example\t-800\t" + std::to_string(now) + "\t1\t3\r\n"
+        "bad score\t500\t1\t0\t0\n"
+        "toolarge.example\t1001\t1\t0\t0\n"
+        "neg.example\t--5\t1\t0\t0\n"
+        "fields.example\t500\t1\t0\n"
+        "overflow.example\t500\t99999999999999999999999\t0\t0\n"
+        "\t500\t1\t0\t0\n"
+        "tail.example\t700\t" + std::to_string(now);
+    RoutePreferenceTable d(Options());
+    assert(d.Load(junk, now) == 1);
+    int32_t score = 0;
+    assert(d.Score("ok.example", now, &score) && score == -800);
+    assert(d.GetStats().entries == 1);
+}
+
+// 并发记录与查询：计数守恒
+static void TestConcurrent() {
+    RoutePreferenceTable t(Options(64));
+    const uint64_t now = 1000 * kHour;
+    std::vector<std::thread> threads;
+    for (int i = 0; i < 4; ++i) {
+        threads.emplace_back([&t, i, now]() {
+            for (int n = 0; n < 2000; ++n) {
+                const std::string host = "h" + std::to_string((n + i) % 100) + ".example";
+                t.Record(host, (n & 1) ? RouteChoice::Direct : RouteChoice::Proxy, now + (uint64_t)n);
+                (void)t.Decide(host, now + (uint64_t)n);
+            }
+        });
+    }
+    for (auto& th : threads) th.join();
+    const auto s = t.GetStats();
+    assert(s.directUpdates + s.proxyUpdates == 8000);
+    assert(s.entries <= 64);
+}
+
+int main() {
+    TestLearn();
+    TestDecay();
+    TestFailureFeedback();
+    TestEviction();
+    TestSerialize();
+    TestConcurrent();
+    return 0;
+}
@@ -0,0 +1,114 @@
+#include <cassert>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "core/RuntimePolicy.hpp"
+
+using namespace Core;
+
+static void TestParse() {
+    UdpMode udp = UdpMode::Block;
+    assert(ParseUdpMode("proxy", &udp) && udp == UdpMode::Proxy);
+    assert(!ParseUdpMode("quic", &udp) && udp == UdpMode::Proxy); // 无法识别时不修改
+    DnsMode dns = DnsMode::Proxy;
+    assert(ParseDnsMode("", &dns) && dns == DnsMode::Direct);     // 空值与历史语义一致：直连
+    Ipv6Mode v6 = Ipv6Mode::Proxy;
+    assert(ParseIpv6Mode("block", &v6) && v6 == Ipv6Mode::Block);
+    UdpRelayMode relay = UdpRelayMode::PerSocket;
+    assert(ParseUdpRelayMode("mux", &relay) && relay == UdpRelayMode::Mux);
+}
+
+static void TestPortBitmap() {
+    PortBitmap ports;
+    assert(ports.AllowAll() && ports.Test(12345));
+    ports.Assign({0, 80, 443, 65535});
+    assert(!ports.AllowAll());
+    assert(ports.Test(0) && ports.Test(80) && ports.Test(443) && ports.Test(65535));
+    assert(!ports.Test(81) && !ports.Test(444) && !ports.Test(65534));
+    ports.Assign({});
+    assert(ports.Test(81));
+}
+
+static void TestProcessNames() {
+    RuntimePolicy p;
+    assert(p.ShouldInject("anything.exe")); // 空列表 = 全部进程
+    p.targetProcesses.Assign({"Language_Server_Windows", "Antigravity.exe", ""});
+    assert(p.ShouldInject("antigravity.exe"));
+    assert(p.ShouldInject("ANTIGRAVITY.EXE"));
+    assert(p.ShouldInject("language_server_windows_x64.exe")); // 子串匹配
+    assert(!p.ShouldInject("chrome.exe"));
+    assert(!p.ShouldInject("anti"));
+
+    p.childInjectionExclude.Assign({"CrashPad"});
+    assert(p.IsChildInjectionExcluded("crashpad_handler.exe"));
+    assert(!p.ShouldInjectChildProcess("crashpad_handler.exe"));
+    assert(!p.ShouldInjectChildProcess("chrome.exe"));
+    assert(p.ShouldInjectChildProcess("Antigravity.exe"));
+    p.childInjectionMode = ChildInjectionMode::Inherit;
+    assert(p.ShouldInjectChildProcess("chrome.exe"));
+    assert(!p.ShouldInjectChildProcess("CRASHPAD_handler.exe"));
+}
+
+static void TestConnectPrologue() {
+    RuntimePolicy p;
+    ConnectFacts f;
+    assert(DecideConnectPrologue(p, f) == ConnectPrologue::Continue);
+
+    f.socket = SocketKind::Datagram;
+    f.port = 443;
+    assert(DecideConnectPrologue(p, f) == ConnectPrologue::UdpBlocked);
+    f.port = 53;
+    assert(DecideConnectPrologue(p, f) == ConnectPrologue::UdpBlockException);
+    f.port = 443;
+    f.loopback = true;
+    assert(DecideConnectPrologue(p, f) == ConnectPrologue::UdpBlockException);
+    p.udp = UdpMode::Proxy;
+    assert(DecideConnectPrologue(p, f) == ConnectPrologue::UdpProxy);
+    p.udp = UdpMode::Direct;
+    assert(DecideConnectPrologue(p, f) == ConnectPrologue::UdpDirect);
+    f.socket = SocketKind::Other;
+    assert(DecideConnectPrologue(p, f) == ConnectPrologue::NonStreamDirect);
+
+    f = ConnectFacts{};
+    f.addr = AddrKind::IPv6;
+    assert(DecideConnectPrologue(p, f) == ConnectPrologue::Continue);
+    p.ipv6 = Ipv6Mode::Block;
+    assert(DecideConnectPrologue(p, f) == ConnectPrologue::Ipv6Blocked);
+    f.addr = AddrKind::IPv4MappedIPv6; // v4-mapped 不受 ipv6_mode 影响
+    assert(DecideConnectPrologue(p, f) == ConnectPrologue::Continue);
+    p.ipv6 = Ipv6Mode::Direct;
+    f.addr = AddrKind::IPv6;
+    assert(DecideConnectPrologue(p, f) == ConnectPrologue::Ipv6Direct);
+    f.addr = AddrKind::Other;
+    assert(DecideConnectPrologue(p, f) == ConnectPrologue::FamilyBlocked);
+
+    // 未配置代理：不查询 socket 类型，IPv6 / 非 IP 地址族直连
+    p.proxyEnabled = false;
+    assert(DecideConnectPrologue(p, f) == ConnectPrologue::FamilyNoProxy);
+    f.addr = AddrKind::IPv6;
+    assert(DecideConnectPrologue(p, f) == ConnectPrologue::Ipv6NoProxy);
+    f.socket = SocketKind::Datagram;
+    assert(DecideConnectPrologue(p, f) == ConnectPrologue::Ipv6NoProxy);
+}
+
+static void TestConnectPort() {
+    RuntimePolicy p;
+    p.allowedPorts.Assign({80, 443});
+    assert(DecideConnectPort(p, 443) == PortDecision::Proxy);
+    assert(DecideConnectPort(p, 8080) == PortDecision::NotAllowed);
+    assert(DecideConnectPort(p, 53) == PortDecision::DnsDirect);
+    p.dns = DnsMode::Proxy;
+    assert(DecideConnectPort(p, 53) == PortDecision::NotAllowed); // 走代理仍受白名单约束
+    p.allowedPorts.Assign({});
+    assert(DecideConnectPort(p, 53) == PortDecision::Proxy);
+}
+
+int main() {
+    TestParse();
+    TestPortBitmap();
+    TestProcessNames();
+    TestConnectPrologue();
+    TestConnectPort();
+    return 0;
+}
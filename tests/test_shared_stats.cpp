@@ -0,0 +1,223 @@
+#include <cassert>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "core/SharedStats.hpp"
+
+namespace SS = Core::SharedStats;
+
+static uint64_t CurrentPid() {
+#ifdef _WIN32
+    return (uint64_t)GetCurrentProcessId();
+#else
+    return (uint64_t)getpid();
+#endif
+}
+
+// 值初始化得到全零段，与新建的共享内存一致
+static std::unique_ptr<SS::Segment> NewSegment() {
+    std::unique_ptr<SS::Segment> seg(new SS::Segment());
+    assert(SS::InitSegment(seg.get()));
+    assert(SS::IsValid(seg.get()));
+    return seg;
+}
+
+static SS::ProcessSample MakeSample(uint64_t v, size_t flows) {
+    SS::ProcessSample s;
+    for (auto& c : s.counters) c = v;
+    s.activeFlows = flows;
+    for (size_t i = 0; i < flows; ++i) {
+        SS::FlowSample f;
+        f.socket = 100 + i;
+        f.route = (SS::FlowRoute)(i % 4);
+        f.port = (uint16_t)(443 + i);
+        f.host = "h" + std::to_string(v) + ".example.com";
+        f.upstream = "socks5://127.0.0.1:7890";
+        f.bytesSent = v;
+        f.bytesRecv = v * 2;
+        f.ageMs = v;
+        s.flows.push_back(f);
+    }
+    return s;
+}
+
+static void TestAtomicText() {
+    Core::AtomicText<16> t{};
+    t.Store("");
+    assert(t.Load().empty());
+    t.Store("chrome.exe");
+    assert(t.Load() == "chrome.exe");
+    t.Store("0123456789abcdefXYZ");
+    assert(t.Load() == "0123456789abcde"); // 截断并保留结尾 0
+}
+
+static void TestInitRejectsForeignLayout() {
+    std::unique_ptr<SS::Segment> seg(new SS::Segment());
+    seg->magic.store(SS::kMagic);
+    seg->version.store(SS::kVersion + 1);
+    assert(!SS::InitSegment(seg.get()));
+    SS::SlotWriter w;
+    assert(!w.Attach(seg.get(), 1, "x", 1000));
+    assert(SS::ReadAll(*seg, 1000).empty());
+}
+
+static void TestPublishAndRead() {
+    auto seg = NewSegment();
+    SS::SlotWriter a, b;
+    assert(a.Attach(seg.get(), 11, "a.exe", 1000));
+    assert(b.Attach(seg.get(), 22, "b.exe", 1000));
+    assert(a.SlotIndex() != b.SlotIndex());
+
+    assert(a.Publish(MakeSample(5, 3), 2000));
+    assert(b.Publish(MakeSample(7, SS::kMaxFlows + 10), 2000)); // 超出部分不发布
+
+    auto views = SS::ReadAll(*seg, 2500);
+    assert(views.size() == 2);
+    const SS::ProcessView& va = views[0].pid == 11 ? views[0] : views[1];
+    const SS::ProcessView& vb = views[0].pid == 11 ? views[1] : views[0];
+    assert(va.name == "a.exe" && va.startMs == 1000 && va.heartbeatMs == 2000 && !va.stale);
+    assert(va.sample.counters[SS::kBytesRecv] == 5 && va.sample.activeFlows == 3);
+    assert(va.sample.flows.size() == 3);
+    assert(va.sample.flows[2].socket == 102 && va.sample.flows[2].port == 445);
+    assert(va.sample.flows[2].route == SS::FlowRoute::ProxyTcp);
+    assert(va.sample.flows[2].host == "h5.example.com" && va.sample.flows[2].upstream == "socks5://127.0.0.1:7890");
+    assert(va.sample.flows[2].bytesRecv == 10);
+    assert(vb.sample.flows.size() == SS::kMaxFlows && vb.sample.activeFlows == SS::kMaxFlows + 10);
+
+    // 连接表缩短后旧条目不再可见
+    assert(b.Publish(MakeSample(8, 1), 3000));
+    SS::ProcessView v;
+    assert(SS::ReadSlot(*seg, b.SlotIndex(), 3000, &v));
+    assert(v.sample.flows.size() == 1 && v.sample.counters[SS::kConnectsProxy] == 8);
+
+    // 释放后槽位空闲，可被新进程占用
+    const size_t freed = a.SlotIndex();
+    a.Detach();
+    assert(!SS::ReadSlot(*seg, freed, 3000, &v));
+    assert(SS::ReadAll(*seg, 3000).size() == 1);
+    SS::SlotWriter c;
+    assert(c.Attach(seg.get(), 33, "c.exe", 4000));
+    assert(c.SlotIndex() == freed);
+    assert(SS::ReadSlot(*seg, freed, 4000, &v) && v.pid == 33 && v.name == "c.exe" && v.sample.flows.empty());
+}
+
+// 心跳过期的槽位标记为失联，并可被新进程接管；原占有者随后发布失败
+static void TestStaleReclaim() {
+    auto seg = NewSegment();
+    std::vector<std::unique_ptr<SS::SlotWriter>> writers;
+    for (size_t i = 0; i < SS::kMaxProcesses; ++i) {
+        writers.emplace_back(new SS::SlotWriter());
+        assert(writers.back()->Attach(seg.get(), 1000 + i, "p", 1000));
+    }
+    SS::SlotWriter extra;
+    assert(!extra.Attach(seg.get(), 5000, "late", 1000)); // 全部占满
+
+    for (size_t i = 1; i < SS::kMaxProcesses; ++i) assert(writers[i]->Publish(MakeSample(i, 0), 20000));
+    auto views = SS::ReadAll(*seg, 20000);
+    assert(views.size() == SS::kMaxProcesses);
+    size_t stale = 0;
+    for (const auto& v : views) stale += v.stale ? 1 : 0;
+    assert(stale == 1);
+
+    assert(extra.Attach(seg.get(), 5000, "late", 20000));
+    assert(extra.SlotIndex() == writers[0]->SlotIndex());
+    assert(!writers[0]->StillOwned());
+    assert(!writers[0]->Publish(MakeSample(1, 0), 20001));
+    writers[0]->Detach(); // 已被接管：不得释放新占有者的槽位
+    SS::ProcessView v;
+    assert(SS::ReadSlot(*seg, extra.SlotIndex(), 20001, &v) && v.pid == 5000 && !v.stale);
+}
+
+// 单写者持续发布、多个读者并发读取：每次读到的计数、连接表都来自同一次发布
+static void TestConcurrentReaders() {
+    auto seg = NewSegment();
+    SS::SlotWriter w;
+    assert(w.Attach(seg.get(), 77, "w", 1));
+    std::atomic<bool> done{false};
+    std::atomic<uint64_t> consistent{0};
+    std::vector<std::thread> readers;
+    for (int r = 0; r < 3; ++r) {
+        readers.emplace_back([&]() {
+            while (!done.load()) {
+                SS::ProcessView v;
+                if (!SS::ReadSlot(*seg, w.SlotIndex(), 1, &v, UINT64_MAX / 2)) continue;
+                const uint64_t x = v.sample.counters[0];
+                for (uint64_t c : v.sample.counters) assert(c == x);
+                assert(v.sample.flows.size() == x % 5);
+                for (const auto& f : v.sample.flows) {
+                    assert(f.bytesSent == x && f.host == "h" + std::to_string(x) + ".example.com");
+                }
+                consistent.fetch_add(1);
+            }
+        });
+    }
+    for (uint64_t i = 1; i <= 20000; ++i) {
+        assert(w.Publish(MakeSample(i, i % 5), 1));
+        if (i % 64 == 0) std::this_thread::yield();
+    }
+    while (consistent.load() < 100) std::this_thread::yield();
+    done = true;
+    for (auto& t : readers) t.join();
+}
+
+// 命名映射 + 发布线程：查看器以只读方式打开同一段读到本进程的槽位；Stop 后槽位释放
+static void TestMappingRoundTrip() {
+#ifdef _WIN32
+    const std::string name = "Local\\AntigravityProxyStatsTest" + std::to_string(CurrentPid());
+#else
+    const std::string name = "/agp_stats_test_" + std::to_string(CurrentPid());
+#endif
+    SS::Mapping::Remove(name.c_str());
+    SS::Mapping missing;
+    assert(!missing.Open(name.c_str(), false));
+
+    std::atomic<uint64_t> collects{0};
+    auto pub = std::make_shared<SS::Publisher>();
+    const bool started = pub->Start(name.c_str(), CurrentPid(), "test_shared_stats", 20, [&](SS::ProcessSample* s) {
+        const uint64_t n = collects.fetch_add(1) + 1;
+        s->counters[SS::kBytesSent] = n;
+        s->activeFlows = 1;
+        SS::FlowSample f;
+        f.socket = 9;
+        f.route = SS::FlowRoute::Direct;
+        f.port = 80;
+        f.host = "example.com";
+        s->flows.push_back(f);
+    });
+    assert(started);
+
+    SS::Mapping viewer;
+    assert(viewer.Open(name.c_str(), false));
+    const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+    std::vector<SS::ProcessView> views;
+    while (std::chrono::steady_clock::now() < deadline) {
+        views = SS::ReadAll(*viewer.Get(), SS::WallClockMs());
+        if (!views.empty() && views[0].sample.counters[SS::kBytesSent] >= 2) break;
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    assert(views.size() == 1);
+    assert(views[0].pid == CurrentPid() && views[0].name == "test_shared_stats");
+    assert(views[0].sample.counters[SS::kBytesSent] >= 2);
+    assert(views[0].sample.flows.size() == 1 && views[0].sample.flows[0].host == "example.com");
+    assert(views[0].sample.flows[0].route == SS::FlowRoute::Direct && views[0].sample.flows[0].port == 80);
+
+    pub->Stop(2000);
+    assert(SS::ReadAll(*viewer.Get(), SS::WallClockMs()).empty());
+    viewer.Close();
+    SS::Mapping::Remove(name.c_str());
+}
+
+int main() {
+    TestAtomicText();
+    TestInitRejectsForeignLayout();
+    TestPublishAndRead();
+    TestStaleReclaim();
+    TestConcurrentReaders();
+    TestMappingRoundTrip();
+    return 0;
+}
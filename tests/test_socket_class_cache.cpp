@@ -0,0 +1,78 @@
+#include <cassert>
+#include <atomic>
+#include <cstdint>
+#include <thread>
+#include <vector>
+
+#include "network/SocketClassCache.hpp"
+
+using Network::SocketClass;
+using Network::SocketClassCache;
+
+static void TestBasic() {
+    SocketClassCache<64> cache;
+    assert(cache.Get(100) == SocketClass::Unknown);
+    cache.Set(100, SocketClass::DirectTcp);
+    assert(cache.Get(100) == SocketClass::DirectTcp);
+    assert(Network::IsStreamSocketClass(cache.Get(100)));
+
+    // 首次分类不覆盖已写入的更具体状态
+    cache.Set(104, SocketClass::ProxiedUdp);
+    assert(cache.Publish(104, SocketClass::Udp) == SocketClass::ProxiedUdp);
+    assert(cache.Publish(108, SocketClass::Udp) == SocketClass::Udp);
+    assert(Network::IsDatagramSocketClass(cache.Get(108)));
+
+    // 失效只清除仍属于该句柄的槽位
+    cache.Invalidate(100);
+    assert(cache.Get(100) == SocketClass::Unknown);
+    cache.Invalidate(100);
+    assert(cache.Get(104) == SocketClass::ProxiedUdp);
+
+    // 0 / INVALID_SOCKET 不缓存
+    cache.Set(0, SocketClass::DirectTcp);
+    assert(cache.Get(0) == SocketClass::Unknown);
+    cache.Set(~(uintptr_t)0, SocketClass::DirectTcp);
+    assert(cache.Get(~(uintptr_t)0) == SocketClass::Unknown);
+
+    cache.Clear();
+    assert(cache.Get(104) == SocketClass::Unknown);
+}
+
+// 槽位冲突：后写入者覆盖，先写入的句柄退化为未命中（绝不返回其他句柄的分类）
+static void TestCollision() {
+    SocketClassCache<1> cache;
+    cache.Set(4, SocketClass::DirectTcp);
+    cache.Set(8, SocketClass::Udp);
+    assert(cache.Get(4) == SocketClass::Unknown);
+    assert(cache.Get(8) == SocketClass::Udp);
+    cache.Invalidate(4); // 不属于 4 的槽位不应被清除
+    assert(cache.Get(8) == SocketClass::Udp);
+}
+
+// 并发：每个线程只写自己的句柄，读到的分类必须属于本句柄
+static void TestConcurrent() {
+    SocketClassCache<16> cache;
+    std::atomic<bool> mismatch{false};
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 8; ++t) {
+        threads.emplace_back([&cache, &mismatch, t]() {
+            const uintptr_t s = (uintptr_t)(t + 1) * 4;
+            const SocketClass mine = (t % 2) ? SocketClass::Udp : SocketClass::DirectTcp;
+            for (int i = 0; i < 100000; ++i) {
+                cache.Publish(s, mine);
+                const SocketClass got = cache.Get(s);
+                if (got != SocketClass::Unknown && got != mine) mismatch.store(true);
+                if (i % 7 == 0) cache.Invalidate(s);
+            }
+        });
+    }
+    for (auto& th : threads) th.join();
+    assert(!mismatch.load());
+}
+
+int main() {
+    TestBasic();
+    TestCollision();
+    TestConcurrent();
+    return 0;
+}
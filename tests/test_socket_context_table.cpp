@@ -0,0 +1,122 @@
+#include <cassert>
+#include <atomic>
+#include <cstdint>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "network/SocketContextTable.hpp"
+
+using Network::RefCounted;
+using Network::RefPtr;
+using Network::RefTable;
+using Network::ShardedTable;
+
+static std::atomic<int> g_liveRecords{0};
+
+struct Record : RefCounted<Record> {
+    explicit Record(uintptr_t k) : key(k) { g_liveRecords.fetch_add(1); }
+    ~Record() { g_liveRecords.fetch_sub(1); }
+    uintptr_t key = 0;
+    std::atomic<uint64_t> hits{0};
+};
+
+// 与 unordered_map 对照的随机增删查，覆盖墓碑复用与扩容重建
+static void TestShardedTableMatchesReference() {
+    ShardedTable<uintptr_t, uint64_t, 4> table;
+    std::unordered_map<uintptr_t, uint64_t> ref;
+    uint64_t rng = 0x1234567;
+    for (int i = 0; i < 200000; ++i) {
+        rng = rng * 6364136223846793005ull + 1442695040888963407ull;
+        const uintptr_t key = (uintptr_t)(((rng >> 33) % 3000) * 4); // 模拟 SOCKET：4 字节对齐
+        const int op = (int)((rng >> 20) % 3);
+        if (op == 0) {
+            const bool inserted = table.InsertOrAssign(key, (uint64_t)i);
+            assert(inserted == (ref.find(key) == ref.end()));
+            (void)inserted;
+            ref[key] = (uint64_t)i;
+        } else if (op == 1) {
+            uint64_t v = 0;
+            const bool erased = table.Erase(key, &v);
+            auto it = ref.find(key);
+            assert(erased == (it != ref.end()));
+            if (erased) {
+                assert(v == it->second);
+                ref.erase(it);
+            }
+        } else {
+            uint64_t v = 0;
+            const bool found = table.Find(key, &v);
+            auto it = ref.find(key);
+            assert(found == (it != ref.end()));
+            if (found) assert(v == it->second);
+        }
+        assert(table.Size() == ref.size());
+    }
+    const size_t removed = table.EraseIf([](uintptr_t key, uint64_t&) { return (key / 4) % 2 == 0; });
+    size_t expected = 0;
+    for (auto& kv : ref) if ((kv.first / 4) % 2 == 0) ++expected;
+    assert(removed == expected);
+    (void)expected;
+    (void)removed;
+}
+
+static void TestRefTableLifetime() {
+    RefTable<uintptr_t, Record, 8> table;
+    {
+        RefPtr<Record> a = table.FindOrCreate(100, []() { return new Record(100); });
+        RefPtr<Record> b = table.FindOrCreate(100, []() { return new Record(999); });
+        assert(a.get() == b.get());
+        assert(g_liveRecords.load() == 1);
+        assert(a->RefCount() == 3); // 表 + a + b
+
+        // 摘除后在外持有者仍可安全使用，最后一个引用释放时销毁
+        RefPtr<Record> removed = table.Remove(100);
+        assert(removed.get() == a.get());
+        assert(!table.Find(100));
+        a->hits.fetch_add(1);
+    }
+    assert(g_liveRecords.load() == 0);
+
+    // 句柄复用：同一键重新创建得到新记录
+    RefPtr<Record> first = table.FindOrCreate(8, []() { return new Record(8); });
+    table.Remove(8);
+    RefPtr<Record> second = table.FindOrCreate(8, []() { return new Record(8); });
+    assert(first.get() != second.get());
+    first = RefPtr<Record>();
+    int drained = 0;
+    table.Drain([&drained](uintptr_t, RefPtr<Record> r) { if (r) ++drained; });
+    assert(drained == 1);
+    second = RefPtr<Record>();
+    assert(g_liveRecords.load() == 0);
+}
+
+// 并发：多个线程对同一批键反复创建/查找/摘除，记录数最终归零且无重复创建泄漏
+static void TestRefTableConcurrent() {
+    RefTable<uintptr_t, Record, 16> table;
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 8; ++t) {
+        threads.emplace_back([&table, t]() {
+            for (int i = 0; i < 50000; ++i) {
+                const uintptr_t key = (uintptr_t)(((i * 7 + t) % 64) * 4 + 4);
+                if (i % 5 == 0) {
+                    table.Remove(key);
+                } else if (auto r = table.FindOrCreate(key, [key]() { return new Record(key); })) {
+                    assert(r->key == key);
+                    r->hits.fetch_add(1, std::memory_order_relaxed);
+                }
+            }
+        });
+    }
+    for (auto& th : threads) th.join();
+    table.Drain([](uintptr_t, RefPtr<Record>) {});
+    assert(table.Size() == 0);
+    assert(g_liveRecords.load() == 0);
+}
+
+int main() {
+    TestShardedTableMatchesReference();
+    TestRefTableLifetime();
+    TestRefTableConcurrent();
+    return 0;
+}
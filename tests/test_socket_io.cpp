@@ -0,0 +1,250 @@
+#include <cassert>
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "network/SocketIo.hpp"
+
+namespace SocketIo = Network::SocketIo;
+using Clock = std::chrono::steady_clock;
+
+struct Pair {
+    SOCKET a = INVALID_SOCKET; // 客户端
+    SOCKET b = INVALID_SOCKET; // 服务端 accept 得到的一端
+};
+
+static void SetNonBlocking(SOCKET s, bool on) {
+    unsigned long mode = on ? 1 : 0;
+    assert(ioctlsocket(s, FIONBIO, &mode) == 0);
+}
+
+static void SetSendBuffer(SOCKET s, int bytes) {
+    assert(setsockopt(s, SOL_SOCKET, SO_SNDBUF, (const char*)&bytes, sizeof(bytes)) == 0);
+}
+
+static SOCKET ListenLoopback(uint16_t* port) {
+    SOCKET l = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+    assert(l != INVALID_SOCKET);
+    sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    assert(bind(l, (const sockaddr*)&addr, sizeof(addr)) == 0);
+    assert(listen(l, 4) == 0);
+    Network::SocketCompat::SockLen len = sizeof(addr);
+    assert(getsockname(l, (sockaddr*)&addr, &len) == 0);
+    *port = ntohs(addr.sin_port);
+    return l;
+}
+
+// 回环 TCP 连接对，两端均为非阻塞（模拟被应用设为非阻塞的 socket）
+static Pair MakePair() {
+    uint16_t port = 0;
+    SOCKET l = ListenLoopback(&port);
+    Pair p;
+    p.a = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+    assert(p.a != INVALID_SOCKET);
+    sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    addr.sin_port = htons(port);
+    assert(connect(p.a, (const sockaddr*)&addr, sizeof(addr)) == 0);
+    p.b = accept(l, nullptr, nullptr);
+    assert(p.b != INVALID_SOCKET);
+    closesocket(l);
+    SetNonBlocking(p.a, true);
+    SetNonBlocking(p.b, true);
+    return p;
+}
+
+static void ClosePair(const Pair& p) {
+    if (p.a != INVALID_SOCKET) closesocket(p.a);
+    if (p.b != INVALID_SOCKET) closesocket(p.b);
+}
+
+static long long ElapsedMs(Clock::time_point since) {
+    return (long long)std::chrono::duration_cast<std::chrono::milliseconds>(Clock::now() - since).count();
+}
+
+// 数据已就绪：一次收发完成
+static void TestFastPath() {
+    Pair p = MakePair();
+    assert(SocketIo::SendAll(p.a, "hello", 5, 1000));
+    uint8_t buf[5] = {};
+    assert(SocketIo::RecvExact(p.b, buf, 5, 1000));
+    assert(std::string((const char*)buf, 5) == "hello");
+    ClosePair(p);
+}
+
+// 大块数据：发送缓冲区写满后等待可写，接收端分批读取；内容与顺序不变
+static void TestLargeTransfer() {
+    Pair p = MakePair();
+    SetSendBuffer(p.a, 8192);
+    const int total = 4 * 1024 * 1024;
+    std::vector<char> data((size_t)total);
+    for (int i = 0; i < total; ++i) data[(size_t)i] = (char)(i * 131 + 7);
+
+    std::vector<uint8_t> got((size_t)total);
+    bool recvOk = false;
+    std::thread reader([&]() {
+        // 分多次读取，每次按不同长度，覆盖部分读与等待可读
+        int off = 0;
+        int chunk = 1;
+        recvOk = true;
+        while (off < total && recvOk) {
+            const int n = (total - off) < chunk ? (total - off) : chunk;
+            recvOk = SocketIo::RecvExact(p.b, got.data() + off, n, 5000);
+            off += n;
+            chunk = chunk * 3 % 65521 + 1;
+        }
+    });
+    assert(SocketIo::SendAll(p.a, data.data(), total, 5000));
+    reader.join();
+    assert(recvOk);
+    for (int i = 0; i < total; ++i) assert((char)got[(size_t)i] == data[(size_t)i]);
+    ClosePair(p);
+}
+
+// 超时：整个操作共用一个截止时间；返回 false 并设置 WSAETIMEDOUT
+static void TestTimeout() {
+    Pair p = MakePair();
+    uint8_t buf[4] = {};
+    auto start = Clock::now();
+    assert(!SocketIo::RecvExact(p.b, buf, 4, 100));
+    assert(WSAGetLastError() == WSAETIMEDOUT);
+    long long ms = ElapsedMs(start);
+    assert(ms >= 90 && ms < 2000);
+
+    // 陆续到达的数据不会延长截止时间：每 40ms 到 1 字节，共需 4 字节，截止时间 100ms
+    std::thread writer([&]() {
+        for (int i = 0; i < 4; ++i) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(40));
+            (void)send(p.a, "x", 1, 0);
+        }
+    });
+    start = Clock::now();
+    assert(!SocketIo::RecvExact(p.b, buf, 4, 100));
+    assert(WSAGetLastError() == WSAETIMEDOUT);
+    ms = ElapsedMs(start);
+    assert(ms < 1000);
+    writer.join();
+
+    // 发送缓冲区一直满：SendAll 超时
+    SetSendBuffer(p.a, 4096);
+    std::vector<char> big(8 * 1024 * 1024, 'y');
+    start = Clock::now();
+    assert(!SocketIo::SendAll(p.a, big.data(), (int)big.size(), 100));
+    assert(WSAGetLastError() == WSAETIMEDOUT);
+    assert(ElapsedMs(start) < 2000);
+    ClosePair(p);
+
+    assert(!SocketIo::WaitReadable(INVALID_SOCKET, 10));
+    assert(WSAGetLastError() == WSAEINVAL);
+}
+
+// 对端关闭：接收返回 WSAECONNRESET
+static void TestPeerClose() {
+    Pair p = MakePair();
+    assert(SocketIo::SendAll(p.a, "ab", 2, 1000));
+    std::thread closer([&]() {
+        std::this_thread::sleep_for(std::chrono::milliseconds(30));
+        closesocket(p.a);
+    });
+    uint8_t buf[4] = {};
+    assert(!SocketIo::RecvExact(p.b, buf, 4, 2000));
+    assert(WSAGetLastError() == WSAECONNRESET);
+    assert(buf[0] == 'a' && buf[1] == 'b');
+    closer.join();
+    p.a = INVALID_SOCKET;
+    ClosePair(p);
+}
+
+// RecvUntil：只读到分隔符为止，不吞掉之后的数据；超过上限返回 WSAEMSGSIZE
+static void TestRecvUntil() {
+    Pair p = MakePair();
+    std::thread writer([&]() {
+        const char* parts[] = {"HTTP/1.1 200 OK\r", "\n\r", "\n", "TUNNEL"};
+        for (const char* part : parts) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+            (void)send(p.a, part, (int)std::string(part).size(), 0);
+        }
+    });
+    std::string head;
+    assert(SocketIo::RecvUntil(p.b, &head, "\r\n\r\n", 2000, 1024));
+    assert(head == "HTTP/1.1 200 OK\r\n\r\n");
+    writer.join();
+    uint8_t rest[6] = {};
+    assert(SocketIo::RecvExact(p.b, rest, 6, 1000));
+    assert(std::string((const char*)rest, 6) == "TUNNEL");
+
+    assert(SocketIo::SendAll(p.a, "0123456789", 10, 1000));
+    assert(!SocketIo::RecvUntil(p.b, &head, "\r\n", 1000, 8));
+    assert(WSAGetLastError() == WSAEMSGSIZE);
+    assert(head == "01234567");
+    assert(!SocketIo::RecvUntil(p.b, nullptr, "\r\n", 1000, 8));
+    assert(WSAGetLastError() == WSAEINVAL);
+    ClosePair(p);
+}
+
+// 非阻塞 connect：监听端口成功；已关闭端口返回具体错误（SO_ERROR）
+static void TestWaitConnect() {
+    uint16_t port = 0;
+    SOCKET l = ListenLoopback(&port);
+    sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    addr.sin_port = htons(port);
+
+    SOCKET s = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+    SetNonBlocking(s, true);
+    int rc = connect(s, (const sockaddr*)&addr, sizeof(addr));
+    assert(rc == 0 || WSAGetLastError() == WSAEWOULDBLOCK || WSAGetLastError() == WSAEINPROGRESS);
+    assert(SocketIo::WaitConnect(s, 2000));
+    closesocket(s);
+
+    closesocket(l); // 端口关闭后连接被拒绝
+    s = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+    SetNonBlocking(s, true);
+    rc = connect(s, (const sockaddr*)&addr, sizeof(addr));
+    if (rc != 0 && (WSAGetLastError() == WSAEWOULDBLOCK || WSAGetLastError() == WSAEINPROGRESS)) {
+        assert(!SocketIo::WaitConnect(s, 5000));
+    }
+    assert(WSAGetLastError() == WSAECONNREFUSED);
+    closesocket(s);
+}
+
+// Deadline：首次取剩余时间时开始计时；之后单调递减，到期为 0
+static void TestDeadline() {
+    SocketIo::Deadline d(50);
+    assert(d.RemainingMs() == 50);
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    const int left = d.RemainingMs();
+    assert(left > 0 && left <= 35);
+    std::this_thread::sleep_for(std::chrono::milliseconds(60));
+    assert(d.RemainingMs() == 0);
+    assert(WSAGetLastError() == WSAETIMEDOUT);
+
+    SocketIo::Deadline fallback(0); // 非正值使用默认超时
+    assert(fallback.RemainingMs() == SocketIo::NormalizeTimeoutMs(0));
+}
+
+int main() {
+#ifdef _WIN32
+    WSADATA wsa{};
+    const int wsaRc = WSAStartup(MAKEWORD(2, 2), &wsa);
+    assert(wsaRc == 0);
+    (void)wsaRc;
+#endif
+    TestFastPath();
+    TestLargeTransfer();
+    TestTimeout();
+    TestPeerClose();
+    TestRecvUntil();
+    TestWaitConnect();
+    TestDeadline();
+#ifdef _WIN32
+    WSACleanup();
+#endif
+    return 0;
+}
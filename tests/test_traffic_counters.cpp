@@ -0,0 +1,109 @@
+#include <cassert>
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "network/TrafficCounters.hpp"
+
+using Network::TrafficCounters;
+using Network::TrafficDirection;
+using Network::TrafficTotals;
+
+// 按 socket 计数，关闭后并入按目标的累计值
+static void TestSocketAndDestination() {
+    TrafficCounters<4, 64> counters;
+    counters.Add(100, TrafficDirection::Send, 10);
+    counters.Add(100, TrafficDirection::Send, 5);
+    counters.Add(100, TrafficDirection::Recv, 1200);
+    counters.Add(104, TrafficDirection::Send, 7, 1);
+
+    TrafficTotals t = counters.Socket(100);
+    assert(t.bytesSent == 15 && t.opsSent == 2 && t.bytesRecv == 1200 && t.opsRecv == 1 && t.packetsSent == 0);
+    assert(counters.Sockets().size() == 2);
+
+    t = counters.Close(100, "api.example.com:443");
+    assert(t.bytesSent == 15 && t.bytesRecv == 1200);
+    assert(counters.Socket(100).Empty());
+    counters.Add(108, TrafficDirection::Recv, 3);
+    counters.Close(108, "api.example.com:443");
+
+    const auto dests = counters.Destinations();
+    assert(dests.size() == 1 && dests[0].first == "api.example.com:443");
+    assert(dests[0].second.bytesSent == 15 && dests[0].second.bytesRecv == 1203 && dests[0].second.opsRecv == 2);
+
+    // 总量 = 已关闭 + 尚未关闭
+    t = counters.Total();
+    assert(t.bytesSent == 22 && t.bytesRecv == 1203 && t.packetsSent == 1);
+
+    // 句柄复用：关闭后同一句柄重新计数
+    counters.Add(100, TrafficDirection::Send, 1);
+    assert(counters.Socket(100).bytesSent == 1);
+}
+
+// 槽位冲突：被挤出的 socket 计数并入“其他”桶，总量不丢
+static void TestEviction() {
+    TrafficCounters<1, 2> counters; // 两个槽位：第三个 socket 必然挤出一个
+    counters.Add(1, TrafficDirection::Send, 10);
+    counters.Add(2, TrafficDirection::Send, 20);
+    counters.Add(3, TrafficDirection::Send, 30);
+    assert(counters.Socket(3).bytesSent == 30);
+    assert(counters.Sockets().size() == 2);
+    assert(counters.Socket(1).bytesSent + counters.Socket(2).bytesSent < 30);
+    assert(counters.Total().bytesSent == 60 && counters.Total().opsSent == 3);
+}
+
+// 目标数量上限：超出后并入 "(其他)"
+static void TestDestinationCap() {
+    TrafficCounters<1, 16> counters;
+    using C = TrafficCounters<1, 16>;
+    for (size_t i = 0; i < C::kMaxDestinations + 5; ++i) {
+        counters.Add(4, TrafficDirection::Send, 1);
+        counters.Close(4, "host" + std::to_string(i) + ":443");
+    }
+    const auto dests = counters.Destinations();
+    assert(dests.size() == C::kMaxDestinations + 1);
+    uint64_t other = 0;
+    for (const auto& kv : dests) {
+        if (kv.first == C::kOtherDestination) other = kv.second.bytesSent;
+    }
+    assert(other == 5);
+}
+
+// 多线程写入（分片共享、同一 socket 跨线程）并与关闭/读取并发：总量精确
+static void TestConcurrent() {
+    TrafficCounters<2, 64> counters; // 分片少于线程数：覆盖共享分片的路径
+    std::atomic<bool> go{false};
+    std::vector<std::thread> threads;
+    const int perThread = 100000;
+    for (int t = 0; t < 4; ++t) {
+        threads.emplace_back([&, t]() {
+            while (!go.load()) std::this_thread::yield();
+            for (int i = 0; i < perThread; ++i) {
+                const uintptr_t s = 4 + (uintptr_t)((i + t) % 8) * 4;
+                counters.Add(s, (i & 1) ? TrafficDirection::Recv : TrafficDirection::Send, 3);
+            }
+        });
+    }
+    threads.emplace_back([&]() {
+        while (!go.load()) std::this_thread::yield();
+        for (int i = 0; i < 2000; ++i) {
+            counters.Close(4 + (uintptr_t)(i % 8) * 4, "t:1");
+            (void)counters.Total();
+        }
+    });
+    go.store(true);
+    for (auto& th : threads) th.join();
+    const TrafficTotals t = counters.Total();
+    assert(t.opsSent + t.opsRecv == 4ull * perThread);
+    assert(t.bytesSent + t.bytesRecv == 12ull * perThread);
+}
+
+int main() {
+    TestSocketAndDestination();
+    TestEviction();
+    TestDestinationCap();
+    TestConcurrent();
+    return 0;
+}
@@ -0,0 +1,229 @@
+#include <cassert>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "network/UdpAssociatePool.hpp"
+
+using Network::PooledUdpAssociate;
+using Network::UdpAssociatePool;
+using Clock = std::chrono::steady_clock;
+
+// 模拟代理：每次建立会话即一条回环 TCP 连接，服务端一侧由测试持有，关闭它即模拟代理断开控制连接
+struct FakeProxy {
+    SOCKET listener = INVALID_SOCKET;
+    sockaddr_in addr{};
+    std::mutex mtx;
+    std::vector<SOCKET> serverSides;
+    std::atomic<int> factoryCalls{0};
+    std::atomic<int> closed{0};
+
+    FakeProxy() {
+        listener = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+        assert(listener != INVALID_SOCKET);
+        addr.sin_family = AF_INET;
+        addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        assert(bind(listener, (const sockaddr*)&addr, sizeof(addr)) == 0);
+        assert(listen(listener, 16) == 0);
+        Network::SocketCompat::SockLen len = sizeof(addr);
+        assert(getsockname(listener, (sockaddr*)&addr, &len) == 0);
+    }
+
+    ~FakeProxy() {
+        CloseServerSides();
+        closesocket(listener);
+    }
+
+    bool Create(PooledUdpAssociate* out) {
+        factoryCalls++;
+        SOCKET c = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+        if (c == INVALID_SOCKET) return false;
+        if (connect(c, (const sockaddr*)&addr, sizeof(addr)) != 0) {
+            closesocket(c);
+            return false;
+        }
+        SOCKET s = accept(listener, nullptr, nullptr);
+        if (s == INVALID_SOCKET) {
+            closesocket(c);
+            return false;
+        }
+        {
+            std::lock_guard<std::mutex> lock(mtx);
+            serverSides.push_back(s);
+        }
+        out->controlSock = c;
+        out->relayAddrLen = (int)sizeof(sockaddr_in);
+        return true;
+    }
+
+    void Close(SOCKET s) {
+        closed++;
+        closesocket(s);
+    }
+
+    void CloseServerSides() {
+        std::lock_guard<std::mutex> lock(mtx);
+        for (SOCKET s : serverSides) closesocket(s);
+        serverSides.clear();
+    }
+
+    UdpAssociatePool::Factory Factory() {
+        return [this](PooledUdpAssociate* out) { return Create(out); };
+    }
+
+    UdpAssociatePool::Closer Closer() {
+        return [this](SOCKET s) { Close(s); };
+    }
+};
+
+template <typename Pred>
+static bool WaitFor(Pred pred, int timeoutMs) {
+    const auto deadline = Clock::now() + std::chrono::milliseconds(timeoutMs);
+    while (Clock::now() < deadline) {
+        if (pred()) return true;
+        std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    }
+    return pred();
+}
+
+// 后台补充到目标数量；领取后补回
+static void TestRefill() {
+    FakeProxy proxy;
+    UdpAssociatePool pool;
+    PooledUdpAssociate item;
+    assert(!pool.TryClaim(&item)); // 未启动
+    pool.Start(2, 30000, proxy.Factory(), proxy.Closer());
+    assert(WaitFor([&]() { return pool.GetStats().idle == 2; }, 2000));
+    assert(pool.GetStats().created == 2);
+
+    assert(pool.TryClaim(&item));
+    assert(item.controlSock != INVALID_SOCKET && item.relayAddrLen == (int)sizeof(sockaddr_in));
+    assert(WaitFor([&]() { return pool.GetStats().idle == 2; }, 2000));
+    const auto stats = pool.GetStats();
+    assert(stats.created == 3 && stats.claimed == 1 && stats.missed == 0);
+    closesocket(item.controlSock);
+
+    assert(pool.Stop(2000));
+    assert(proxy.closed == 2); // 池中剩余会话由 Stop 关闭
+    assert(!pool.TryClaim(&item));
+}
+
+// 控制连接被代理关闭：领取时丢弃，不交给调用方
+static void TestStaleControlEviction() {
+    FakeProxy proxy;
+    UdpAssociatePool pool;
+    pool.Start(2, 30000, proxy.Factory(), proxy.Closer());
+    assert(WaitFor([&]() { return pool.GetStats().idle == 2; }, 2000));
+
+    proxy.CloseServerSides();
+    std::this_thread::sleep_for(std::chrono::milliseconds(20)); // 等 FIN 到达
+    PooledUdpAssociate item;
+    const bool claimed = pool.TryClaim(&item);
+    auto stats = pool.GetStats();
+    assert(stats.discarded >= 2);
+    if (claimed) {
+        // 只可能是丢弃后新补充的会话：对端仍在
+        Network::SocketCompat::PollFd pfd{};
+        pfd.fd = item.controlSock;
+        pfd.events = POLLIN;
+        assert(Network::SocketCompat::Poll(&pfd, 1, 0) == 0);
+        closesocket(item.controlSock);
+    }
+    assert(proxy.closed >= 2);
+
+    // 过期会话同样被丢弃
+    assert(pool.Stop(2000));
+    UdpAssociatePool shortLived;
+    shortLived.Start(1, 30, proxy.Factory(), proxy.Closer());
+    assert(WaitFor([&]() { return shortLived.GetStats().created >= 1; }, 2000));
+    std::this_thread::sleep_for(std::chrono::milliseconds(60));
+    assert(WaitFor([&]() { return shortLived.GetStats().discarded >= 1; }, 2000));
+    assert(shortLived.Stop(2000));
+}
+
+// 建立失败按退避等待：领取未命中的唤醒不会让后台线程立刻重试
+static void TestBackoff() {
+    std::atomic<int> calls{0};
+    UdpAssociatePool pool;
+    pool.Start(2, 30000, [&](PooledUdpAssociate*) { calls++; return false; }, nullptr);
+    assert(WaitFor([&]() { return calls.load() >= 1; }, 2000));
+    PooledUdpAssociate item;
+    for (int i = 0; i < 20; ++i) {
+        assert(!pool.TryClaim(&item));
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    assert(calls.load() == 1); // 首次退避 1s
+    assert(pool.GetStats().missed == 20);
+    const auto start = Clock::now();
+    assert(pool.Stop(2000)); // 退避等待中也能立即退出
+    assert(Clock::now() - start < std::chrono::milliseconds(500));
+}
+
+// Stop：后台线程正在建立会话时，等待其结束并退出；返回后不再调用注入的函数
+static void TestStopDuringFactory() {
+    FakeProxy proxy;
+    std::atomic<int> inFactory{0};
+    std::atomic<int> calls{0};
+    std::atomic<int> closerCalls{0};
+    UdpAssociatePool pool;
+    pool.Start(4, 30000,
+               [&](PooledUdpAssociate* out) {
+                   calls++;
+                   inFactory = 1;
+                   std::this_thread::sleep_for(std::chrono::milliseconds(150));
+                   const bool ok = proxy.Create(out);
+                   inFactory = 0;
+                   return ok;
+               },
+               [&](SOCKET s) {
+                   closerCalls++;
+                   closesocket(s);
+               });
+    assert(WaitFor([&]() { return inFactory.load() == 1; }, 2000));
+    const auto start = Clock::now();
+    assert(pool.Stop(2000));
+    assert(Clock::now() - start < std::chrono::milliseconds(1000));
+    assert(inFactory.load() == 0);
+    const int callsAtStop = calls.load();
+    const int closesAtStop = closerCalls.load();
+    assert(closesAtStop >= 1); // 停止期间建立完成的会话被关闭，不入池
+    std::this_thread::sleep_for(std::chrono::milliseconds(300));
+    assert(calls.load() == callsAtStop);
+    assert(closerCalls.load() == closesAtStop);
+    assert(pool.GetStats().idle == 0);
+
+    // 超时：线程仍在建立会话时返回 false；之后可再次等待到退出
+    UdpAssociatePool slow;
+    slow.Start(1, 30000,
+               [&](PooledUdpAssociate*) {
+                   inFactory = 1;
+                   std::this_thread::sleep_for(std::chrono::milliseconds(200));
+                   inFactory = 0;
+                   return false;
+               },
+               nullptr);
+    assert(WaitFor([&]() { return inFactory.load() == 1; }, 2000));
+    assert(!slow.Stop(10));
+    assert(slow.Stop(2000));
+    assert(inFactory.load() == 0);
+}
+
+int main() {
+#ifdef _WIN32
+    WSADATA wsa{};
+    const int wsaRc = WSAStartup(MAKEWORD(2, 2), &wsa);
+    assert(wsaRc == 0);
+    (void)wsaRc;
+#endif
+    TestRefill();
+    TestStaleControlEviction();
+    TestBackoff();
+    TestStopDuringFactory();
+#ifdef _WIN32
+    WSACleanup();
+#endif
+    return 0;
+}
@@ -0,0 +1,167 @@
+#include <cassert>
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <thread>
+#include <vector>
+
+#include "network/SlabPool.hpp"
+#include "network/UdpRecvInPlace.hpp"
+
+using Network::UdpRecvInPlace::Finalize;
+using Network::UdpRecvInPlace::Result;
+using Network::UdpRecvInPlace::Segment;
+
+// 模拟内核散布接收：按 [scratch(预测头长)] + user... + [tail] 顺序写入 datagram，返回写入字节数
+static size_t ScatterInto(Segment* segs, size_t count, const std::vector<uint8_t>& datagram) {
+    size_t pos = 0;
+    for (size_t i = 0; i < count && pos < datagram.size(); ++i) {
+        const size_t n = (datagram.size() - pos < segs[i].len) ? (datagram.size() - pos) : segs[i].len;
+        memcpy(segs[i].data, datagram.data() + pos, n);
+        pos += n;
+    }
+    return pos;
+}
+
+static std::vector<uint8_t> MakeDatagram(const char* host, uint16_t port, size_t payloadLen) {
+    uint8_t header[Network::UdpRecvInPlace::kMaxHeaderBytes];
+    const size_t headerLen = Network::Socks5::EncodeUdpHeader(host, port, header, sizeof(header));
+    assert(headerLen > 0);
+    std::vector<uint8_t> datagram(header, header + headerLen);
+    for (size_t i = 0; i < payloadLen; ++i) datagram.push_back((uint8_t)(i * 7 + 1));
+    return datagram;
+}
+
+static bool PayloadMatches(const std::vector<uint8_t>& user, size_t len) {
+    for (size_t i = 0; i < len; ++i) {
+        if (user[i] != (uint8_t)(i * 7 + 1)) return false;
+    }
+    return true;
+}
+
+// 用两个用户缓冲区（跨段平移更容易出错）验证一次接收
+static Result RunCase(const char* replyHost, size_t predicted, size_t payloadLen, size_t user0, size_t user1,
+                      std::vector<uint8_t>* joined) {
+    uint8_t scratch[Network::UdpRecvInPlace::kMaxHeaderBytes] = {};
+    uint8_t tail[Network::UdpRecvInPlace::kMaxHeaderBytes] = {};
+    std::vector<uint8_t> u0(user0), u1(user1);
+    Segment segs[4];
+    segs[0] = {scratch, predicted};
+    segs[1] = {u0.data(), u0.size()};
+    segs[2] = {u1.data(), u1.size()};
+    segs[3] = {tail, sizeof(tail)};
+
+    const std::vector<uint8_t> datagram = MakeDatagram(replyHost, 4433, payloadLen);
+    const size_t received = ScatterInto(segs, 4, datagram);
+    assert(received == datagram.size());
+
+    std::vector<uint8_t> fixup;
+    Result r{};
+    const bool ok = Finalize(segs, 4, received, &fixup, &r);
+    assert(ok);
+    (void)ok;
+    joined->assign(u0.begin(), u0.end());
+    joined->insert(joined->end(), u1.begin(), u1.end());
+    return r;
+}
+
+static void TestPredictionHit() {
+    std::vector<uint8_t> joined;
+    const Result r = RunCase("203.0.113.9", 10, 1200, 700, 1000, &joined);
+    assert(r.headerLen == 10);
+    assert(r.payloadLen == 1200 && r.delivered == 1200);
+    assert(r.copiedBytes == 0);
+    assert(PayloadMatches(joined, 1200));
+    assert(r.srcLen == (int)sizeof(sockaddr_in));
+    const sockaddr_in* a4 = (const sockaddr_in*)&r.src;
+    assert(ntohs(a4->sin_port) == 4433);
+}
+
+static void TestPredictionMiss() {
+    std::vector<uint8_t> joined;
+    // 预测 IPv4 头，实际 IPv6 头：payload 起始位于 user 段内，需要左移
+    Result r = RunCase("2001:db8::1", 10, 1200, 700, 1000, &joined);
+    assert(r.headerLen == 22 && r.delivered == 1200 && r.copiedBytes == 1200);
+    assert(PayloadMatches(joined, 1200));
+    assert(r.srcLen == (int)sizeof(sockaddr_in6));
+
+    // 预测 IPv6 头，实际 IPv4 头：payload 前 12 字节落在 scratch 中，需要右移
+    r = RunCase("203.0.113.9", 22, 1200, 700, 1000, &joined);
+    assert(r.headerLen == 10 && r.delivered == 1200 && r.copiedBytes == 1200);
+    assert(PayloadMatches(joined, 1200));
+
+    // 域名源地址：payload 正确但无法回填 sockaddr
+    r = RunCase("relay.example", 10, 64, 32, 64, &joined);
+    assert(r.srcLen == 0 && r.delivered == 64);
+    assert(PayloadMatches(joined, 64));
+}
+
+static void TestTruncation() {
+    std::vector<uint8_t> joined;
+    // payload 超出用户缓冲区：多余部分落入 tail，delivered < payloadLen 由调用方报告 WSAEMSGSIZE
+    const Result r = RunCase("203.0.113.9", 10, 1200, 500, 500, &joined);
+    assert(r.payloadLen == 1200 && r.delivered == 1000);
+    assert(PayloadMatches(joined, 1000));
+}
+
+static void TestRejectsNonSocks5() {
+    uint8_t scratch[10] = {};
+    std::vector<uint8_t> user(64, 0);
+    uint8_t tail[16] = {};
+    Segment segs[3] = {{scratch, sizeof(scratch)}, {user.data(), user.size()}, {tail, sizeof(tail)}};
+    scratch[0] = 0x16; // 非 RSV=0：例如直连 TLS/QUIC 数据
+    Result r{};
+    assert(!Finalize(segs, 3, 40, nullptr, &r));
+    scratch[0] = 0x00;
+    scratch[2] = 0x01; // FRAG != 0
+    scratch[3] = Network::Socks5::ATYP_IPV4;
+    assert(!Finalize(segs, 3, 40, nullptr, &r));
+}
+
+struct PoolItem {
+    uint64_t owner = 0;
+    uint8_t pad[120] = {};
+};
+
+static void TestSlabPool() {
+    Network::SlabPool<PoolItem, 4> pool;
+    PoolItem* items[5] = {};
+    for (int i = 0; i < 5; ++i) items[i] = pool.Acquire();
+    for (int i = 0; i < 4; ++i) assert(pool.Owns(items[i]));
+    assert(!pool.Owns(items[4])); // 耗尽后退化为堆分配
+    assert(pool.GetStats().heapFallbacks == 1 && pool.GetStats().inUse == 5);
+    for (int i = 0; i < 5; ++i) pool.Release(items[i]);
+    assert(pool.GetStats().inUse == 0);
+    // 归还后复用槽位，不再走堆
+    PoolItem* again = pool.Acquire();
+    assert(pool.Owns(again));
+    pool.Release(again);
+
+    // 并发借还：同一槽位不得同时被两个线程持有
+    Network::SlabPool<PoolItem, 64> shared;
+    std::atomic<bool> conflict{false};
+    std::vector<std::thread> threads;
+    for (int t = 1; t <= 8; ++t) {
+        threads.emplace_back([&shared, &conflict, t]() {
+            for (int i = 0; i < 20000; ++i) {
+                PoolItem* item = shared.Acquire();
+                item->owner = (uint64_t)t;
+                std::this_thread::yield();
+                if (item->owner != (uint64_t)t) conflict.store(true);
+                shared.Release(item);
+            }
+        });
+    }
+    for (auto& th : threads) th.join();
+    assert(!conflict.load());
+    assert(shared.GetStats().inUse == 0);
+}
+
+int main() {
+    TestPredictionHit();
+    TestPredictionMiss();
+    TestTruncation();
+    TestRejectsNonSocks5();
+    TestSlabPool();
+    return 0;
+}
@@ -0,0 +1,199 @@
+// 实时查看各被注入进程的流量与活跃连接（读取 metrics.shared_memory 开启后发布的共享统计段）
+// 用法：agtop [--once] [--interval <ms>] [--flows <N>] [--all] [--name <段名>]
+// - 默认每 --interval 毫秒（默认 1000）刷新一屏：每个进程一行（速率、累计字节、按去向的连接数），其下列出字节数最多的 N 个连接
+// - --once：采样两次（间隔 --interval）后输出一屏并退出，便于脚本/管道使用
+// - --flows：每个进程显示的连接数，默认 10，0 表示只显示进程行
+// - --all：同时显示心跳超时（进程已崩溃未释放）的槽位
+// - --name：共享段名，默认与 DLL 一致
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "core/SharedStats.hpp"
+
+namespace SS = Core::SharedStats;
+
+static std::string FormatBytes(double v) {
+    static const char* const kUnits[] = {"B", "KB", "MB", "GB", "TB"};
+    size_t u = 0;
+    while (v >= 1024.0 && u + 1 < sizeof(kUnits) / sizeof(kUnits[0])) {
+        v /= 1024.0;
+        ++u;
+    }
+    char buf[32];
+    snprintf(buf, sizeof(buf), u == 0 ? "%.0f %s" : "%.1f %s", v, kUnits[u]);
+    return buf;
+}
+
+static std::string FormatRate(bool known, uint64_t cur, uint64_t prev, double seconds) {
+    if (!known || seconds <= 0 || cur < prev) return "-";
+    return FormatBytes((double)(cur - prev) / seconds) + "/s";
+}
+
+static std::string FormatAge(uint64_t ms) {
+    if (ms == 0) return "-";
+    const uint64_t s = ms / 1000;
+    char buf[32];
+    if (s < 60) snprintf(buf, sizeof(buf), "%llus", (unsigned long long)s);
+    else if (s < 3600) snprintf(buf, sizeof(buf), "%llum%02llus", (unsigned long long)(s / 60), (unsigned long long)(s % 60));
+    else snprintf(buf, sizeof(buf), "%lluh%02llum", (unsigned long long)(s / 3600), (unsigned long long)(s / 60 % 60));
+    return buf;
+}
+
+// 上一帧的累计值：进程按 (PID, 启动时间) 区分，避免 PID 复用时算出错误速率；连接按 (PID, socket)
+struct Previous {
+    std::map<std::pair<uint64_t, uint64_t>, SS::ProcessSample> processes;
+    std::map<std::pair<uint64_t, uint64_t>, std::pair<uint64_t, uint64_t>> flows;
+    std::chrono::steady_clock::time_point at;
+    bool valid = false;
+};
+
+static void Render(const std::vector<SS::ProcessView>& views, const Previous& prev, double seconds,
+                   size_t maxFlows, bool clear) {
+    if (clear) fputs("\x1b[H\x1b[2J", stdout);
+
+    uint64_t totalSent = 0, totalRecv = 0, prevSent = 0, prevRecv = 0, active = 0;
+    bool allKnown = prev.valid;
+    for (const auto& v : views) {
+        totalSent += v.sample.counters[SS::kBytesSent];
+        totalRecv += v.sample.counters[SS::kBytesRecv];
+        active += v.sample.activeFlows;
+        auto it = prev.processes.find({v.pid, v.startMs});
+        if (it == prev.processes.end()) {
+            allKnown = false;
+            continue;
+        }
+        prevSent += it->second.counters[SS::kBytesSent];
+        prevRecv += it->second.counters[SS::kBytesRecv];
+    }
+    printf("agtop  进程=%zu  活跃连接=%llu  发送=%s  接收=%s  累计发送=%s  累计接收=%s\n\n", views.size(),
+           (unsigned long long)active, FormatRate(allKnown, totalSent, prevSent, seconds).c_str(),
+           FormatRate(allKnown, totalRecv, prevRecv, seconds).c_str(), FormatBytes((double)totalSent).c_str(),
+           FormatBytes((double)totalRecv).c_str());
+    printf("%-8s %-22s %12s %12s %10s %10s %6s %6s %6s %6s %6s\n", "PID", "进程", "发送/s", "接收/s", "累计发送",
+           "累计接收", "代理", "直连", "绕过", "拒绝", "连接");
+
+    for (const auto& v : views) {
+        const auto it = prev.processes.find({v.pid, v.startMs});
+        const bool known = prev.valid && it != prev.processes.end();
+        const auto& c = v.sample.counters;
+        printf("%-8llu %-22s %12s %12s %10s %10s %6llu %6llu %6llu %6llu %6llu%s\n", (unsigned long long)v.pid,
+               v.name.substr(0, 22).c_str(),
+               FormatRate(known, c[SS::kBytesSent], known ? it->second.counters[SS::kBytesSent] : 0, seconds).c_str(),
+               FormatRate(known, c[SS::kBytesRecv], known ? it->second.counters[SS::kBytesRecv] : 0, seconds).c_str(),
+               FormatBytes((double)c[SS::kBytesSent]).c_str(), FormatBytes((double)c[SS::kBytesRecv]).c_str(),
+               (unsigned long long)c[SS::kConnectsProxy], (unsigned long long)c[SS::kConnectsDirect],
+               (unsigned long long)c[SS::kConnectsBypass], (unsigned long long)c[SS::kConnectsRejected],
+               (unsigned long long)v.sample.activeFlows, v.stale ? "  (失联)" : "");
+
+        const size_t n = std::min(maxFlows, v.sample.flows.size());
+        for (size_t i = 0; i < n; ++i) {
+            const SS::FlowSample& f = v.sample.flows[i];
+            const auto fit = prev.flows.find({v.pid, f.socket});
+            const bool fknown = prev.valid && fit != prev.flows.end();
+            const std::string target = f.host.empty() ? std::string("(未知)") : (f.host + ":" + std::to_string(f.port));
+            printf("    %-40s %-9s %-28s %12s %12s %10s %8s\n", target.substr(0, 40).c_str(), SS::FlowRouteName(f.route),
+                   (f.upstream.empty() ? std::string("-") : f.upstream).substr(0, 28).c_str(),
+                   FormatRate(fknown, f.bytesSent, fknown ? fit->second.first : 0, seconds).c_str(),
+                   FormatRate(fknown, f.bytesRecv, fknown ? fit->second.second : 0, seconds).c_str(),
+                   FormatBytes((double)(f.bytesSent + f.bytesRecv)).c_str(), FormatAge(f.ageMs).c_str());
+        }
+        if (v.sample.activeFlows > n && maxFlows > 0) {
+            printf("    ... 另有 %llu 个连接\n", (unsigned long long)(v.sample.activeFlows - n));
+        }
+    }
+    fflush(stdout);
+}
+
+static void Remember(const std::vector<SS::ProcessView>& views, Previous* prev) {
+    prev->processes.clear();
+    prev->flows.clear();
+    for (const auto& v : views) {
+        prev->processes[{v.pid, v.startMs}] = v.sample;
+        for (const auto& f : v.sample.flows) prev->flows[{v.pid, f.socket}] = {f.bytesSent, f.bytesRecv};
+    }
+    prev->at = std::chrono::steady_clock::now();
+    prev->valid = true;
+}
+
+static void PrintUsage() {
+    fprintf(stderr, "用法: agtop [--once] [--interval <ms>] [--flows <N>] [--all] [--name <段名>]\n");
+}
+
+int main(int argc, char** argv) {
+    bool once = false;
+    bool all = false;
+    int intervalMs = 1000;
+    size_t maxFlows = 10;
+    std::string name = SS::kDefaultSegmentName;
+    for (int i = 1; i < argc; ++i) {
+        const bool hasValue = i + 1 < argc;
+        if (strcmp(argv[i], "--once") == 0) {
+            once = true;
+        } else if (strcmp(argv[i], "--all") == 0) {
+            all = true;
+        } else if (strcmp(argv[i], "--interval") == 0 && hasValue) {
+            intervalMs = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--flows") == 0 && hasValue) {
+            maxFlows = (size_t)strtoul(argv[++i], nullptr, 10);
+        } else if (strcmp(argv[i], "--name") == 0 && hasValue) {
+            name = argv[++i];
+        } else {
+            PrintUsage();
+            return 2;
+        }
+    }
+    if (intervalMs < 100) intervalMs = 100;
+
+#ifdef _WIN32
+    // 让控制台解释 ANSI 清屏序列
+    HANDLE out = GetStdHandle(STD_OUTPUT_HANDLE);
+    DWORD mode = 0;
+    if (!once && out != INVALID_HANDLE_VALUE && GetConsoleMode(out, &mode)) {
+        SetConsoleMode(out, mode | ENABLE_VIRTUAL_TERMINAL_PROCESSING);
+    }
+#endif
+
+    SS::Mapping mapping;
+    Previous prev;
+    for (;;) {
+        if (!mapping.Get() && !mapping.Open(name.c_str(), false)) {
+            // Windows 上最后一个发布进程退出后段即销毁：持续模式下等待进程出现
+            if (once) {
+                fprintf(stderr, "未找到共享统计段 %s（需在配置中开启 metrics.shared_memory，且有被注入进程在运行）\n", name.c_str());
+                return 1;
+            }
+            fputs("\x1b[H\x1b[2J", stdout);
+            printf("agtop  等待共享统计段 %s ...\n", name.c_str());
+            fflush(stdout);
+            std::this_thread::sleep_for(std::chrono::milliseconds(intervalMs));
+            continue;
+        }
+        if (!SS::IsValid(mapping.Get())) {
+            fprintf(stderr, "共享统计段布局不匹配（agtop 与 DLL 版本不一致）\n");
+            return 1;
+        }
+
+        std::vector<SS::ProcessView> views = SS::ReadAll(*mapping.Get(), SS::WallClockMs());
+        if (!all) {
+            views.erase(std::remove_if(views.begin(), views.end(), [](const SS::ProcessView& v) { return v.stale; }),
+                        views.end());
+        }
+        std::sort(views.begin(), views.end(), [](const SS::ProcessView& a, const SS::ProcessView& b) {
+            return a.pid < b.pid;
+        });
+        const auto now = std::chrono::steady_clock::now();
+        const double seconds = prev.valid ? std::chrono::duration<double>(now - prev.at).count() : 0.0;
+        if (!once || prev.valid) Render(views, prev, seconds, maxFlows, !once);
+        if (once && prev.valid) return 0;
+        Remember(views, &prev);
+        std::this_thread::sleep_for(std::chrono::milliseconds(intervalMs));
+    }
+}